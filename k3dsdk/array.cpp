@@ -20,18 +20,54 @@
 #include <k3dsdk/array.h>
 #include <k3dsdk/iomanip.h>
 
+#include <glib.h>
+
 namespace k3d
 {
 
 /////////////////////////////////////////////////////////////////////////////
 // array
 
-array::array()
+namespace detail
+{
+
+/// Stores the most-recently assigned array generation.  This is pointer-sized, since a 32-bit gint could wrap in a long session and reuse generations.
+static volatile gpointer array_generation = 0;
+
+/// Returns a new, unique array generation
+uint_t next_array_generation()
+{
+	gpointer current = 0;
+	gpointer next = 0;
+	do
+	{
+		current = g_atomic_pointer_get(&array_generation);
+		next = GSIZE_TO_POINTER(GPOINTER_TO_SIZE(current) + 1);
+	}
+	while(!g_atomic_pointer_compare_and_exchange(&array_generation, current, next));
+
+	return GPOINTER_TO_SIZE(next);
+}
+
+} // namespace detail
+
+array::array() :
+	m_generation(detail::next_array_generation()),
+	m_frozen(false)
 {
 }
 
 array::array(const metadata_t& Metadata) :
-	metadata(Metadata)
+	metadata(Metadata),
+	m_generation(detail::next_array_generation()),
+	m_frozen(false)
+{
+}
+
+array::array(const array& Other) :
+	metadata(Other.metadata),
+	m_generation(detail::next_array_generation()),
+	m_frozen(false)
 {
 }
 
@@ -39,6 +75,14 @@ array::~array()
 {
 }
 
+array& array::operator=(const array& Other)
+{
+	metadata = Other.metadata;
+	m_generation = detail::next_array_generation();
+	m_frozen = false;
+	return *this;
+}
+
 void array::set_metadata_value(const string_t& Name, const string_t& Value)
 {
 	metadata[Name] = Value;
@@ -67,6 +111,27 @@ void array::erase_metadata_value(const string_t& Name)
 	metadata.erase(Name);
 }
 
+uint_t array::generation() const
+{
+	return m_generation;
+}
+
+void array::touch()
+{
+	m_generation = detail::next_array_generation();
+	m_frozen = false;
+}
+
+bool_t array::frozen() const
+{
+	return m_frozen;
+}
+
+void array::freeze() const
+{
+	m_frozen = true;
+}
+
 /////////////////////////////////////////////////////////////////////////////
 // operator<<
 
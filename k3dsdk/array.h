@@ -38,8 +38,11 @@ public:
 
 	array();
 	array(const metadata_t& Metadata);
+	array(const array& Other);
 	virtual ~array();
 
+	array& operator=(const array& Other);
+
 	/// Returns the string representation for the type stored by this array. 
 	virtual const string_t type_string() const = 0;
 	/// Prints the array contents to a stream.
@@ -73,11 +76,42 @@ public:
 	/// Erases an existing name-value pair
 	void erase_metadata_value(const string_t& Name);
 
+	/// Returns a value that identifies the current contents of this array, for use as a key when caching data derived from it.
+	/// Generations are unique across all arrays, and a new generation is assigned whenever an array is created, copied,
+	/// or handed-out for modification by pipeline_data::writable().
+	uint_t generation() const;
+	/// Assigns a new generation to this array.  Call this if you modify an array without going through pipeline_data::writable().
+	void touch();
+	/// Returns true iff this array has been shared through pipeline_data since it was created or last handed-out for modification.
+	/// Code that still holds a mutable reference to an array that isn't frozen may legitimately modify it at any time, so only
+	/// the generations of frozen arrays can be used as cache keys.
+	bool_t frozen() const;
+	/// Marks this array as frozen, see frozen().
+	void freeze() const;
+
 protected:
 	/// Storage for array metadata
 	metadata_t metadata;
+
+private:
+	/// Stores the array generation
+	uint_t m_generation;
+	/// Set to true once the array is shared, see frozen()
+	mutable bool_t m_frozen;
 };
 
+/// Overload of pipeline_data_writable() that assigns a new generation to arrays that are about to be modified
+inline void pipeline_data_writable(array* const Array)
+{
+	Array->touch();
+}
+
+/// Overload of pipeline_data_shared() that freezes arrays once they are shared
+inline void pipeline_data_shared(array* const Array)
+{
+	Array->freeze();
+}
+
 /// Serialization
 std::ostream& operator<<(std::ostream& Stream, const array& RHS);
 
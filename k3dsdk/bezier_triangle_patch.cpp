@@ -127,7 +127,9 @@ const_primitive* validate(const mesh& Mesh, const mesh::primitive& Primitive)
 
 	try
 	{
-		require_valid_primitive(Mesh, Primitive);
+		const bool_t cached = valid_primitive_cached(Mesh, Primitive);
+		if(!cached)
+			require_valid_primitive(Mesh, Primitive);
 
 		const table& patch_structure = require_structure(Primitive, "patch");
 		const table& vertex_structure = require_structure(Primitive, "vertex");
@@ -147,24 +149,30 @@ const_primitive* validate(const mesh& Mesh, const mesh::primitive& Primitive)
 		require_metadata(Primitive, patch_selections, "patch_selections", metadata::key::role(), metadata::value::selection_role());
 		require_metadata(Primitive, patch_points, "patch_points", metadata::key::domain(), metadata::value::point_indices_domain());
 
-		k3d::uint_t num_control_points = 0;
-		const k3d::uint_t num_patches = patch_selections.size();
-		for(k3d::uint_t patch = 0; patch != num_patches; ++patch)
+		if(!cached)
 		{
-			const k3d::uint_t patch_size = (patch_orders[patch] * (patch_orders[patch] + 1)) / 2;
-			num_control_points += patch_size;
-			if (patch < num_patches-1 && patch_first_points[patch] + patch_size != patch_first_points[patch+1])
+			k3d::uint_t num_control_points = 0;
+			const k3d::uint_t num_patches = patch_selections.size();
+			for(k3d::uint_t patch = 0; patch != num_patches; ++patch)
 			{
-				std::ostringstream buffer;
-				buffer << "[" << Primitive.type << "] primitive [patch_first_points[" << (patch+1)
-				       << "]] incorrect value [" << patch_first_points[patch+1]
-				       << "], expected [" << (patch_first_points[patch] + patch_size) << "]";
-				throw std::runtime_error(buffer.str());
+				const k3d::uint_t patch_size = (patch_orders[patch] * (patch_orders[patch] + 1)) / 2;
+				num_control_points += patch_size;
+				if (patch < num_patches-1 && patch_first_points[patch] + patch_size != patch_first_points[patch+1])
+				{
+					std::ostringstream buffer;
+					buffer << "[" << Primitive.type << "] primitive [patch_first_points[" << (patch+1)
+					       << "]] incorrect value [" << patch_first_points[patch+1]
+					       << "], expected [" << (patch_first_points[patch] + patch_size) << "]";
+					throw std::runtime_error(buffer.str());
+				}
 			}
+			require_table_row_count(Primitive, vertex_structure, "vertex", num_control_points);
 		}
-		require_table_row_count(Primitive, vertex_structure, "vertex", num_control_points);
 		require_table_row_count(Primitive, parameter_attributes, "parameter", patch_structure.row_count() * 3);
 
+		if(!cached)
+			cache_valid_primitive(Mesh, Primitive);
+
 		return new const_primitive(patch_first_points, patch_orders, patch_selections, patch_materials, patch_points, patch_point_weights, constant_attributes, patch_attributes, parameter_attributes, vertex_attributes);
 	}
 	catch(std::exception& e)
@@ -108,7 +108,9 @@ const_primitive* validate(const mesh& Mesh, const mesh::primitive& Primitive)
 
 	try
 	{
-		require_valid_primitive(Mesh, Primitive);
+		const bool_t cached = valid_primitive_cached(Mesh, Primitive);
+		if(!cached)
+			require_valid_primitive(Mesh, Primitive);
 
 		const table& patch_structure = require_structure(Primitive, "patch");
 		const table& vertex_structure = require_structure(Primitive, "vertex");
@@ -128,6 +130,9 @@ const_primitive* validate(const mesh& Mesh, const mesh::primitive& Primitive)
 		require_table_row_count(Primitive, vertex_structure, "vertex", patch_structure.row_count() * 16);
 		require_table_row_count(Primitive, parameter_attributes, "parameter", patch_structure.row_count() * 4);
 
+		if(!cached)
+			cache_valid_primitive(Mesh, Primitive);
+
 		return new const_primitive(patch_selections, patch_materials, patch_points, constant_attributes, patch_attributes, parameter_attributes, vertex_attributes);
 	}
 	catch(std::exception& e)
@@ -152,7 +152,9 @@ const_primitive* validate(const mesh& Mesh, const mesh::primitive& Primitive)
 
 	try
 	{
-		require_valid_primitive(Mesh, Primitive);
+		const bool_t cached = valid_primitive_cached(Mesh, Primitive);
+		if(!cached)
+			require_valid_primitive(Mesh, Primitive);
 
 		const mesh::table_t& surface_structure = require_structure(Primitive, "surface");
 		const mesh::table_t& vertex_structure = require_structure(Primitive, "vertex");
@@ -181,6 +183,9 @@ const_primitive* validate(const mesh& Mesh, const mesh::primitive& Primitive)
 
 		/** \todo Validate table lengths here */
 
+		if(!cached)
+			cache_valid_primitive(Mesh, Primitive);
+
 		return new const_primitive(first_primitives, primitive_counts, first_operators, operator_counts, materials, primitives, primitive_first_floats, primitive_float_counts, operators, operator_first_operands, operator_operand_counts, floats, operands, constant_attributes, surface_attributes, parameter_attributes, vertex_attributes);
 	}
 	catch(std::exception& e)
@@ -0,0 +1,139 @@
+// K-3D
+// Copyright (c) 1995-2010, Timothy M. Shead
+//
+// Contact: tshead@k-3d.com
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+/** \file
+	\author Timothy M. Shead (tshead@k-3d.com)
+*/
+
+#include <k3dsdk/bounding_volume_hierarchy.h>
+
+#include <algorithm>
+
+namespace k3d
+{
+
+namespace detail
+{
+
+/// Maximum number of items stored in a leaf node
+const uint_t bvh_leaf_size = 8;
+
+/// Orders items by the position of their centers along one axis
+class bvh_center_order
+{
+public:
+	bvh_center_order(const std::vector<point3>& Centers, const uint_t Axis) :
+		centers(Centers),
+		axis(Axis)
+	{
+	}
+
+	bool operator()(const uint_t A, const uint_t B) const
+	{
+		return centers[A][axis] < centers[B][axis];
+	}
+
+private:
+	const std::vector<point3>& centers;
+	const uint_t axis;
+};
+
+} // namespace detail
+
+void bounding_volume_hierarchy::build(const std::vector<bounding_box3>& Boxes)
+{
+	m_boxes = Boxes;
+	m_items.resize(Boxes.size());
+	m_nodes.clear();
+
+	if(Boxes.empty())
+		return;
+
+	std::vector<point3> centers(Boxes.size());
+	for(uint_t i = 0; i != Boxes.size(); ++i)
+	{
+		m_items[i] = i;
+		centers[i] = Boxes[i].empty() ? point3(0, 0, 0) : Boxes[i].center();
+	}
+
+	// A binary tree with leaves of at-least half the maximum leaf size never needs more than this many nodes ...
+	m_nodes.reserve(4 * Boxes.size() / detail::bvh_leaf_size + 1);
+	build(0, Boxes.size(), centers);
+}
+
+uint_t bounding_volume_hierarchy::build(const uint_t Begin, const uint_t End, const std::vector<point3>& Centers)
+{
+	const uint_t index = m_nodes.size();
+	m_nodes.push_back(node());
+
+	bounding_box3 box;
+	bounding_box3 center_box;
+	for(uint_t i = Begin; i != End; ++i)
+	{
+		box.insert(m_boxes[m_items[i]]);
+		center_box.insert(Centers[m_items[i]]);
+	}
+
+	m_nodes[index].box = box;
+
+	if(End - Begin <= detail::bvh_leaf_size)
+	{
+		m_nodes[index].leaf = true;
+		m_nodes[index].begin = Begin;
+		m_nodes[index].end = End;
+		return index;
+	}
+
+	// Split at the median along the axis where item centers are most spread-out ...
+	uint_t axis = 0;
+	if(center_box.height() > center_box.width())
+		axis = 1;
+	if(center_box.depth() > std::max(center_box.width(), center_box.height()))
+		axis = 2;
+
+	const uint_t middle = Begin + (End - Begin) / 2;
+	std::nth_element(m_items.begin() + Begin, m_items.begin() + middle, m_items.begin() + End, detail::bvh_center_order(Centers, axis));
+
+	const uint_t left = build(Begin, middle, Centers);
+	const uint_t right = build(middle, End, Centers);
+
+	m_nodes[index].leaf = false;
+	m_nodes[index].begin = left;
+	m_nodes[index].end = right;
+
+	return index;
+}
+
+uint_t bounding_volume_hierarchy::size() const
+{
+	return m_items.size();
+}
+
+bool_t bounding_volume_hierarchy::empty() const
+{
+	return m_items.empty();
+}
+
+const bounding_box3 bounding_volume_hierarchy::bounds() const
+{
+	return m_nodes.empty() ? bounding_box3() : m_nodes[0].box;
+}
+
+} // namespace k3d
+
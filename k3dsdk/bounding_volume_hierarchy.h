@@ -0,0 +1,104 @@
+#ifndef K3DSDK_BOUNDING_VOLUME_HIERARCHY_H
+#define K3DSDK_BOUNDING_VOLUME_HIERARCHY_H
+
+// K-3D
+// Copyright (c) 1995-2010, Timothy M. Shead
+//
+// Contact: tshead@k-3d.com
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+/** \file
+	\author Timothy M. Shead (tshead@k-3d.com)
+*/
+
+#include <k3dsdk/bounding_box3.h>
+#include <k3dsdk/types.h>
+
+#include <vector>
+
+namespace k3d
+{
+
+/// Stores a static bounding-volume hierarchy (a binary tree of axis-aligned bounding boxes) over a collection of items,
+/// so that spatial queries only need to visit the items whose bounds overlap the query.  Items are identified by their
+/// index in the collection of boxes used to build the hierarchy.
+class bounding_volume_hierarchy
+{
+public:
+	/// Builds the hierarchy for a collection of item bounding boxes, replacing any previous contents
+	void build(const std::vector<bounding_box3>& Boxes);
+
+	/// Calls Visitor(Item) for every item whose bounding box satisfies Overlaps(Box).  Overlaps() must be conservative,
+	/// i.e. it must return true for any box that contains another box for which it would return true.
+	template<typename OverlapsT, typename VisitorT>
+	void traverse(const OverlapsT& Overlaps, VisitorT& Visitor) const
+	{
+		if(m_nodes.empty())
+			return;
+
+		std::vector<uint_t> stack(1, 0);
+		while(!stack.empty())
+		{
+			const node& current = m_nodes[stack.back()];
+			stack.pop_back();
+
+			if(!Overlaps(current.box))
+				continue;
+
+			if(current.leaf)
+			{
+				for(uint_t i = current.begin; i != current.end; ++i)
+				{
+					if(Overlaps(m_boxes[m_items[i]]))
+						Visitor(m_items[i]);
+				}
+			}
+			else
+			{
+				stack.push_back(current.begin);
+				stack.push_back(current.end);
+			}
+		}
+	}
+
+	/// Returns the number of items in the hierarchy
+	uint_t size() const;
+	/// Returns true iff the hierarchy is empty
+	bool_t empty() const;
+	/// Returns the bounds of every item in the hierarchy
+	const bounding_box3 bounds() const;
+
+private:
+	struct node
+	{
+		bounding_box3 box;
+		/// True for leaf nodes, which store the half-open range [begin, end) of m_items.  Interior nodes store the indices of their two children instead.
+		bool_t leaf;
+		uint_t begin;
+		uint_t end;
+	};
+
+	uint_t build(const uint_t Begin, const uint_t End, const std::vector<point3>& Centers);
+
+	std::vector<bounding_box3> m_boxes;
+	std::vector<uint_t> m_items;
+	std::vector<node> m_nodes;
+};
+
+} // namespace k3d
+
+#endif // !K3DSDK_BOUNDING_VOLUME_HIERARCHY_H
+
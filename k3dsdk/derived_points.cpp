@@ -0,0 +1,161 @@
+// K-3D
+// Copyright (c) 1995-2010, Timothy M. Shead
+//
+// Contact: tshead@k-3d.com
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+/** \file
+	\author Timothy M. Shead (tshead@k-3d.com)
+*/
+
+#include <k3dsdk/derived_points.h>
+#include <k3dsdk/parallel/blocked_range.h>
+#include <k3dsdk/parallel/parallel_for.h>
+#include <k3dsdk/parallel/threads.h>
+#include <k3dsdk/result.h>
+
+#include <algorithm>
+
+namespace k3d
+{
+
+namespace detail
+{
+
+/// Evaluates a range of derived points
+class evaluate_derived_points
+{
+public:
+	evaluate_derived_points(const mesh::indices_t& FirstSources, const mesh::counts_t& SourceCounts, const mesh::indices_t& Sources, const mesh::weights_t& Weights, const mesh::points_t& InputPoints, mesh::points_t& OutputPoints) :
+		m_first_sources(FirstSources),
+		m_source_counts(SourceCounts),
+		m_sources(Sources),
+		m_weights(Weights),
+		m_input_points(InputPoints),
+		m_output_points(OutputPoints)
+	{
+	}
+
+	void operator()(const parallel::blocked_range<uint_t>& Range) const
+	{
+		const uint_t point_end = Range.end();
+		for(uint_t point = Range.begin(); point != point_end; ++point)
+		{
+			const uint_t source_begin = m_first_sources[point];
+			const uint_t source_end = source_begin + m_source_counts[point];
+
+			// Copies are the common case, so keep them exact ...
+			if(m_source_counts[point] == 1 && m_weights[source_begin] == 1.0)
+			{
+				m_output_points[point] = m_input_points[m_sources[source_begin]];
+				continue;
+			}
+
+			point3 average(0, 0, 0);
+			for(uint_t source = source_begin; source != source_end; ++source)
+				average += to_vector(m_weights[source] * m_input_points[m_sources[source]]);
+			m_output_points[point] = average;
+		}
+	}
+
+private:
+	const mesh::indices_t& m_first_sources;
+	const mesh::counts_t& m_source_counts;
+	const mesh::indices_t& m_sources;
+	const mesh::weights_t& m_weights;
+	const mesh::points_t& m_input_points;
+	mesh::points_t& m_output_points;
+};
+
+} // namespace detail
+
+derived_points::derived_points() :
+	m_input_size(0)
+{
+}
+
+void derived_points::reset(const uint_t InputPointCount)
+{
+	m_first_sources.clear();
+	m_source_counts.clear();
+	m_sources.clear();
+	m_weights.clear();
+	m_input_size = 0;
+
+	m_first_sources.reserve(InputPointCount);
+	m_source_counts.reserve(InputPointCount);
+	m_sources.reserve(InputPointCount);
+	m_weights.reserve(InputPointCount);
+	for(uint_t point = 0; point != InputPointCount; ++point)
+		push_back(point);
+}
+
+void derived_points::push_back(const uint_t InputPoint)
+{
+	m_first_sources.push_back(m_sources.size());
+	m_source_counts.push_back(1);
+	m_sources.push_back(InputPoint);
+	m_weights.push_back(1.0);
+	m_input_size = std::max(m_input_size, InputPoint + 1);
+}
+
+void derived_points::push_back(const uint_t Count, const uint_t* Points, const double_t* Weights)
+{
+	const uint_t first_source = m_sources.size();
+
+	// Expand each output point into the input points it was derived from, so evaluation never depends on evaluation order ...
+	for(uint_t i = 0; i != Count; ++i)
+	{
+		if(!Weights[i])
+			continue;
+
+		return_if_fail(Points[i] < m_first_sources.size());
+
+		const uint_t source_begin = m_first_sources[Points[i]];
+		const uint_t source_end = source_begin + m_source_counts[Points[i]];
+		for(uint_t source = source_begin; source != source_end; ++source)
+		{
+			m_sources.push_back(m_sources[source]);
+			m_weights.push_back(Weights[i] * m_weights[source]);
+		}
+	}
+
+	m_first_sources.push_back(first_source);
+	m_source_counts.push_back(m_sources.size() - first_source);
+}
+
+uint_t derived_points::size() const
+{
+	return m_first_sources.size();
+}
+
+uint_t derived_points::input_size() const
+{
+	return m_input_size;
+}
+
+void derived_points::evaluate(const mesh::points_t& InputPoints, mesh::points_t& OutputPoints) const
+{
+	return_if_fail(InputPoints.size() >= m_input_size);
+
+	OutputPoints.resize(m_first_sources.size());
+	parallel::parallel_for(
+		parallel::blocked_range<uint_t>(0, m_first_sources.size(), parallel::grain_size()),
+		detail::evaluate_derived_points(m_first_sources, m_source_counts, m_sources, m_weights, InputPoints, OutputPoints));
+}
+
+} // namespace k3d
+
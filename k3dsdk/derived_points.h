@@ -0,0 +1,66 @@
+#ifndef K3DSDK_DERIVED_POINTS_H
+#define K3DSDK_DERIVED_POINTS_H
+
+// K-3D
+// Copyright (c) 1995-2010, Timothy M. Shead
+//
+// Contact: tshead@k-3d.com
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+/** \file
+	\author Timothy M. Shead (tshead@k-3d.com)
+*/
+
+#include <k3dsdk/mesh.h>
+
+namespace k3d
+{
+
+/// Records how each point in a modifier's output mesh was derived from the points in its input mesh - either as a copy of
+/// one input point, or as a weighted average of several - so that modifiers which change topology can re-evaluate their
+/// output points cheaply when only the input points have moved.
+class derived_points
+{
+public:
+	derived_points();
+
+	/// Discards every recorded point, then records output points that are copies of input points [0, InputPointCount)
+	void reset(const uint_t InputPointCount = 0);
+	/// Records an output point that is a copy of the given input point
+	void push_back(const uint_t InputPoint);
+	/// Records an output point that is a weighted average of previously-recorded output points
+	void push_back(const uint_t Count, const uint_t* Points, const double_t* Weights);
+
+	/// Returns the number of recorded output points
+	uint_t size() const;
+	/// Returns the number of input points required by evaluate()
+	uint_t input_size() const;
+
+	/// Re-evaluates every recorded output point from the given input points
+	void evaluate(const mesh::points_t& InputPoints, mesh::points_t& OutputPoints) const;
+
+private:
+	mesh::indices_t m_first_sources;
+	mesh::counts_t m_source_counts;
+	mesh::indices_t m_sources;
+	mesh::weights_t m_weights;
+	uint_t m_input_size;
+};
+
+} // namespace k3d
+
+#endif // !K3DSDK_DERIVED_POINTS_H
+
@@ -23,14 +23,99 @@
 #include <k3dsdk/selection.h>
 #include <k3dsdk/string_cast.h>
 
+#include <boost/ptr_container/ptr_vector.hpp>
 #include <boost/scoped_ptr.hpp>
 
+#include <algorithm>
+#include <map>
+
 namespace k3d
 {
 
 namespace geometry
 {
 
+namespace detail
+{
+
+/// Stores a collection of non-overlapping, weighted index ranges.  Assigning a weight to a range replaces the weights of any
+/// ranges that it overlaps, so assigning a sequence of selection records produces the same weights as replaying them in-order.
+class range_map
+{
+public:
+	void assign(const uint_t Begin, const uint_t End, const double_t Weight)
+	{
+		if(End <= Begin)
+			return;
+
+		// Trim a range that starts before Begin and overlaps it, keeping any part that extends beyond End ...
+		ranges_t::iterator range = m_ranges.lower_bound(Begin);
+		if(range != m_ranges.begin())
+		{
+			ranges_t::iterator previous = range;
+			--previous;
+			if(previous->second.end > Begin)
+			{
+				const range_t original = previous->second;
+				previous->second.end = Begin;
+				if(original.end > End)
+					m_ranges.insert(std::make_pair(End, range_t(original.end, original.weight)));
+			}
+		}
+
+		// Remove ranges that start within [Begin, End), keeping any part that extends beyond End ...
+		while(range != m_ranges.end() && range->first < End)
+		{
+			if(range->second.end > End)
+				m_ranges.insert(std::make_pair(End, range->second));
+			m_ranges.erase(range++);
+		}
+
+		m_ranges.insert(std::make_pair(Begin, range_t(End, Weight)));
+	}
+
+	/// Appends the stored ranges to a set of arrays in ascending order, combining adjacent ranges with the same weight
+	void copy(mesh::indices_t& IndexBegin, mesh::indices_t& IndexEnd, mesh::selection_t& Weight) const
+	{
+		const uint_t first_range = IndexBegin.size();
+		for(ranges_t::const_iterator range = m_ranges.begin(); range != m_ranges.end(); ++range)
+		{
+			if(IndexBegin.size() != first_range && IndexEnd.back() == range->first && Weight.back() == range->second.weight)
+			{
+				IndexEnd.back() = range->second.end;
+				continue;
+			}
+
+			IndexBegin.push_back(range->first);
+			IndexEnd.push_back(range->second.end);
+			Weight.push_back(range->second.weight);
+		}
+	}
+
+	bool_t empty() const
+	{
+		return m_ranges.empty();
+	}
+
+private:
+	struct range_t
+	{
+		range_t(const uint_t End, const double_t Weight) :
+			end(End),
+			weight(Weight)
+		{
+		}
+
+		uint_t end;
+		double_t weight;
+	};
+
+	typedef std::map<uint_t, range_t> ranges_t;
+	ranges_t m_ranges;
+};
+
+} // namespace detail
+
 namespace point_selection
 {
 
@@ -166,6 +251,8 @@ void merge(const_storage& Storage, mesh& Mesh)
 {
 	if(!Mesh.point_selection)
 		return;
+	if(Storage.index_begin.empty())
+		return;
 
 	mesh::selection_t& point_selection = Mesh.point_selection.writable();
 	const uint_t point_selection_count = point_selection.size();
@@ -426,63 +513,77 @@ void append(storage& Storage, const double_t Weight)
 class merge_primitive_selection
 {
 public:
-	merge_primitive_selection(const_storage& Storage, const string_t& PrimitiveSelectionType, const uint_t PrimitiveFirstRange, const uint_t PrimitiveRangeCount) :
+	merge_primitive_selection(const_storage& Storage, const std::vector<string_t>& PrimitiveSelectionTypes, const std::vector<uint_t>& Components) :
 		m_storage(Storage),
-		m_primitive_selection_type(PrimitiveSelectionType),
-		m_primitive_first_range(PrimitiveFirstRange),
-		m_primitive_range_count(PrimitiveRangeCount)
+		m_primitive_selection_types(PrimitiveSelectionTypes),
+		m_components(Components)
 	{
 	}
 
 	void operator()(const string_t& StructureName, table& Structure, const string_t& ArrayName, pipeline_data<array>& Array)
 	{
-		if(StructureName != m_primitive_selection_type)
-			return;
-
 		if(Array->get_metadata_value(metadata::key::role()) != metadata::value::selection_role())
 			return;
 
-		mesh::selection_t* const array = dynamic_cast<mesh::selection_t*>(&Array.writable());
-		if(!array)
-		{
-			log() << error << "unexpected type for array [" << ArrayName << "] with k3d:selection-component = " << m_primitive_selection_type << std::endl;
-			return;
-		}
-
-		const uint_t range_begin = m_primitive_first_range;
-		const uint_t range_end = range_begin + m_primitive_range_count;
-		for(uint_t range = range_begin; range != range_end; ++range)
+		mesh::selection_t* array = 0;
+		for(std::vector<uint_t>::const_iterator component = m_components.begin(); component != m_components.end(); ++component)
 		{
-			std::fill(
-				array->begin() + std::min(array->size(), m_storage.index_begin[range]),
-				array->begin() + std::min(array->size(), m_storage.index_end[range]),
-				m_storage.weight[range]);
+			if(StructureName != m_primitive_selection_types[*component])
+				continue;
+
+			if(!array)
+			{
+				array = dynamic_cast<mesh::selection_t*>(&Array.writable());
+				if(!array)
+				{
+					log() << error << "unexpected type for array [" << ArrayName << "] with k3d:selection-component = " << StructureName << std::endl;
+					return;
+				}
+			}
+
+			const uint_t range_begin = m_storage.primitive_first_range[*component];
+			const uint_t range_end = range_begin + m_storage.primitive_range_count[*component];
+			for(uint_t range = range_begin; range != range_end; ++range)
+			{
+				const uint_t index_begin = std::min(array->size(), m_storage.index_begin[range]);
+				const uint_t index_end = std::min(array->size(), std::max(m_storage.index_begin[range], m_storage.index_end[range]));
+				std::fill(array->begin() + index_begin, array->begin() + index_end, m_storage.weight[range]);
+			}
 		}
 	}
 
 private:
 	const_storage& m_storage;
-	const string_t& m_primitive_selection_type;
-	const uint_t m_primitive_first_range;
-	const uint_t m_primitive_range_count;
+	const std::vector<string_t>& m_primitive_selection_types;
+	const std::vector<uint_t>& m_components;
 };
 
 void merge(const_storage& Storage, mesh& Mesh)
 {
 	const uint_t mesh_primitive_count = static_cast<uint_t>(Mesh.primitives.size());
 	const uint_t component_count = Storage.primitive_begin.size();
+
+	std::vector<string_t> primitive_selection_types(component_count);
 	for(uint_t component = 0; component != component_count; ++component)
-	{
-		const uint_t primitive_begin = std::min(mesh_primitive_count, Storage.primitive_begin[component]);
-		const uint_t primitive_end = std::min(mesh_primitive_count, std::max(primitive_begin, Storage.primitive_end[component]));
-		const string_t primitive_selection_type = string_cast(static_cast<k3d::selection::type>(Storage.primitive_selection_type[component]));
-		const uint_t primitive_first_range = Storage.primitive_first_range[component];
-		const uint_t primitive_range_count = Storage.primitive_range_count[component];
+		primitive_selection_types[component] = string_cast(static_cast<k3d::selection::type>(Storage.primitive_selection_type[component]));
 
-		for(uint_t primitive = primitive_begin; primitive != primitive_end; ++primitive)
+	// Apply every component that affects a primitive in a single visit to its arrays ...
+	std::vector<uint_t> components;
+	for(uint_t primitive = 0; primitive != mesh_primitive_count; ++primitive)
+	{
+		components.clear();
+		for(uint_t component = 0; component != component_count; ++component)
 		{
-			mesh::visit_arrays(Mesh.primitives[primitive].writable(), merge_primitive_selection(Storage, primitive_selection_type, primitive_first_range, primitive_range_count));
+			const uint_t primitive_begin = std::min(mesh_primitive_count, Storage.primitive_begin[component]);
+			const uint_t primitive_end = std::min(mesh_primitive_count, std::max(primitive_begin, Storage.primitive_end[component]));
+			if(primitive_begin <= primitive && primitive < primitive_end)
+				components.push_back(component);
 		}
+
+		if(components.empty())
+			continue;
+
+		mesh::visit_arrays(Mesh.primitives[primitive].writable(), merge_primitive_selection(Storage, primitive_selection_types, components));
 	}
 }
 
@@ -511,6 +612,135 @@ k3d::selection::set create(const double_t Weight)
 	return result;
 }
 
+const k3d::selection::set compact(const k3d::selection::set& Set)
+{
+	k3d::selection::set results;
+	k3d::selection::set other_storage;
+
+	// Point and primitive selections affect different arrays, so their relative order doesn't matter,
+	// and each can be reduced to a single storage object ...
+	detail::range_map points;
+	bool_t found_points = false;
+
+	typedef std::map<uint_t, detail::range_map> primitive_ranges_t;
+	typedef std::map<int32_t, std::vector<std::pair<const primitive_selection::const_storage*, uint_t> > > primitive_components_t;
+	primitive_components_t primitive_components;
+	std::vector<int32_t> primitive_selection_types;
+	boost::ptr_vector<primitive_selection::const_storage> primitive_storage;
+
+	for(k3d::selection::set::const_iterator storage = Set.begin(); storage != Set.end(); ++storage)
+	{
+		boost::scoped_ptr<point_selection::const_storage> point_selection_storage(point_selection::validate(**storage));
+		if(point_selection_storage)
+		{
+			found_points = true;
+			const uint_t record_count = point_selection_storage->index_begin.size();
+			for(uint_t record = 0; record != record_count; ++record)
+				points.assign(point_selection_storage->index_begin[record], point_selection_storage->index_end[record], point_selection_storage->weight[record]);
+			continue;
+		}
+
+		primitive_selection::const_storage* const primitive_selection_storage = primitive_selection::validate(**storage);
+		if(primitive_selection_storage)
+		{
+			primitive_storage.push_back(primitive_selection_storage);
+			const uint_t component_count = primitive_selection_storage->primitive_begin.size();
+			for(uint_t component = 0; component != component_count; ++component)
+			{
+				const int32_t selection_type = primitive_selection_storage->primitive_selection_type[component];
+				if(!primitive_components.count(selection_type))
+					primitive_selection_types.push_back(selection_type);
+				primitive_components[selection_type].push_back(std::make_pair(primitive_selection_storage, component));
+			}
+			continue;
+		}
+
+		other_storage.push_back(*storage);
+	}
+
+	if(found_points)
+	{
+		boost::scoped_ptr<point_selection::storage> point_selection_storage(point_selection::create(results));
+		points.copy(point_selection_storage->index_begin, point_selection_storage->index_end, point_selection_storage->weight);
+	}
+
+	if(primitive_storage.size())
+	{
+		boost::scoped_ptr<primitive_selection::storage> primitive_selection_storage(primitive_selection::create(results));
+
+		for(std::vector<int32_t>::const_iterator selection_type = primitive_selection_types.begin(); selection_type != primitive_selection_types.end(); ++selection_type)
+		{
+			const std::vector<std::pair<const primitive_selection::const_storage*, uint_t> >& components = primitive_components[*selection_type];
+
+			// Split the primitives into intervals where the same components apply ...
+			std::vector<uint_t> boundaries;
+			for(uint_t i = 0; i != components.size(); ++i)
+			{
+				const primitive_selection::const_storage& storage = *components[i].first;
+				const uint_t component = components[i].second;
+				boundaries.push_back(storage.primitive_begin[component]);
+				boundaries.push_back(std::max(storage.primitive_begin[component], storage.primitive_end[component]));
+			}
+			std::sort(boundaries.begin(), boundaries.end());
+			boundaries.erase(std::unique(boundaries.begin(), boundaries.end()), boundaries.end());
+
+			// Replay the components for each interval, combining adjacent intervals that end-up with the same ranges ...
+			for(uint_t interval = 0; interval + 1 < boundaries.size(); ++interval)
+			{
+				const uint_t primitive_begin = boundaries[interval];
+				const uint_t primitive_end = boundaries[interval + 1];
+
+				detail::range_map ranges;
+				for(uint_t i = 0; i != components.size(); ++i)
+				{
+					const primitive_selection::const_storage& storage = *components[i].first;
+					const uint_t component = components[i].second;
+					if(storage.primitive_begin[component] > primitive_begin || std::max(storage.primitive_begin[component], storage.primitive_end[component]) < primitive_end)
+						continue;
+
+					const uint_t range_begin = storage.primitive_first_range[component];
+					const uint_t range_end = range_begin + storage.primitive_range_count[component];
+					for(uint_t range = range_begin; range != range_end; ++range)
+						ranges.assign(storage.index_begin[range], storage.index_end[range], storage.weight[range]);
+				}
+
+				if(ranges.empty())
+					continue;
+
+				mesh::indices_t index_begin;
+				mesh::indices_t index_end;
+				mesh::selection_t weight;
+				ranges.copy(index_begin, index_end, weight);
+
+				const uint_t previous = primitive_selection_storage->primitive_begin.size() - 1;
+				if(primitive_selection_storage->primitive_begin.size()
+					&& primitive_selection_storage->primitive_selection_type[previous] == *selection_type
+					&& primitive_selection_storage->primitive_end[previous] == primitive_begin
+					&& primitive_selection_storage->primitive_range_count[previous] == index_begin.size()
+					&& std::equal(index_begin.begin(), index_begin.end(), primitive_selection_storage->index_begin.begin() + primitive_selection_storage->primitive_first_range[previous])
+					&& std::equal(index_end.begin(), index_end.end(), primitive_selection_storage->index_end.begin() + primitive_selection_storage->primitive_first_range[previous])
+					&& std::equal(weight.begin(), weight.end(), primitive_selection_storage->weight.begin() + primitive_selection_storage->primitive_first_range[previous]))
+				{
+					primitive_selection_storage->primitive_end[previous] = primitive_end;
+					continue;
+				}
+
+				primitive_selection_storage->primitive_begin.push_back(primitive_begin);
+				primitive_selection_storage->primitive_end.push_back(primitive_end);
+				primitive_selection_storage->primitive_selection_type.push_back(*selection_type);
+				primitive_selection_storage->primitive_first_range.push_back(primitive_selection_storage->index_begin.size());
+				primitive_selection_storage->primitive_range_count.push_back(index_begin.size());
+				primitive_selection_storage->index_begin.insert(primitive_selection_storage->index_begin.end(), index_begin.begin(), index_begin.end());
+				primitive_selection_storage->index_end.insert(primitive_selection_storage->index_end.end(), index_end.begin(), index_end.end());
+				primitive_selection_storage->weight.insert(primitive_selection_storage->weight.end(), weight.begin(), weight.end());
+			}
+		}
+	}
+
+	k3d::selection::set::append(other_storage, results);
+	return results;
+}
+
 void merge(const k3d::selection::set& Set, mesh& Mesh)
 {
 	for(k3d::selection::set::const_iterator storage = Set.begin(); storage != Set.end(); ++storage)
@@ -183,6 +183,10 @@ namespace selection
 /// Returns a selection set that applies a uniform weight to every component.
 /// Useful for "select all" and "deselect all".
 k3d::selection::set create(const double_t Weight);
+/// Returns a selection set that produces the same result as the given set when merged with any mesh, using the fewest possible records:
+/// overlapping ranges are resolved in favor of later records, adjacent ranges with the same weight are combined, and records that are
+/// completely overridden by later records are dropped.  Useful to keep selections that are built-up interactively from growing without bound.
+const k3d::selection::set compact(const k3d::selection::set& Set);
 /// Merges a selection set with the selections in a mesh.
 void merge(const k3d::selection::set& Set, mesh& Mesh);
 
@@ -30,6 +30,7 @@
 namespace k3d
 {
 
+namespace filesystem { class path; }
 class inetwork_render_frame;
 	
 /// Abstract interface encapsulating a render job containing zero-to-many frames to be rendered
@@ -39,6 +40,8 @@ class inetwork_render_job :
 public:
 	/// Adds a new "frame" to the job, to be rendered when the job is run
 	virtual inetwork_render_frame& create_frame(const string_t& FrameName) = 0;
+	/// Returns a unique filepath that can be used as an input file shared by every frame in the job
+	virtual const filesystem::path add_file(const string_t& Name) = 0;
 
 protected:
 	inetwork_render_job() {}
@@ -25,6 +25,7 @@
 */
 
 #include <k3dsdk/iunknown.h>
+#include <k3dsdk/shader_collection_ri.h>
 #include <k3dsdk/types.h>
 
 namespace k3d
@@ -47,6 +48,8 @@ public:
 	virtual bool_t installed() = 0;
 	/// Compiles the given shader source code, placing the results into the global shader cache
 	virtual bool_t compile_shader(const filesystem::path& Shader) = 0;
+	/// Compiles a set of shaders, placing the results into the global shader cache.  Implementations may compile shaders in parallel.
+	virtual bool_t compile_shaders(const shader_collection::shaders_t& Shaders) = 0;
 	/// Renders the given RIB file
 	virtual bool_t render(inetwork_render_frame& Frame, const filesystem::path& RIB) = 0;
 
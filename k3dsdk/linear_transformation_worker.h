@@ -0,0 +1,101 @@
+#ifndef K3DSDK_LINEAR_TRANSFORMATION_WORKER_H
+#define K3DSDK_LINEAR_TRANSFORMATION_WORKER_H
+
+// K-3D
+// Copyright (c) 1995-2008, Timothy M. Shead
+//
+// Contact: tshead@k-3d.com
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+/** \file
+	\author Timothy M. Shead (tshead@k-3d.com)
+*/
+
+#include <k3dsdk/algebra.h>
+#include <k3dsdk/mesh.h>
+#include <k3dsdk/parallel/blocked_range.h>
+#include <k3dsdk/parallel/parallel_for.h>
+#include <k3dsdk/parallel/threads.h>
+
+namespace k3d
+{
+
+/// Helper class that can apply a linear transformation to a collection of points.
+/// Designed for compatibility with k3d::parallel::parallel_for().
+class linear_transformation_worker
+{
+public:
+
+	linear_transformation_worker(const mesh::points_t& InputPoints, const mesh::selection_t& PointSelection, mesh::points_t& OutputPoints, const matrix4& Transformation) :
+		input_points(InputPoints),
+		point_selection(PointSelection),
+		output_points(OutputPoints),
+		transformation(Transformation)
+	{
+	}
+	
+	void operator()(const parallel::blocked_range<uint_t>& range) const
+	{
+		const uint_t point_begin = range.begin();
+		const uint_t point_end = range.end();
+		for(uint_t point = point_begin; point != point_end; ++point)
+			output_points[point] = mix(input_points[point], transformation * input_points[point], point_selection[point]);
+	}
+
+private:
+	const mesh::points_t& input_points;
+	const mesh::selection_t& point_selection;
+	mesh::points_t& output_points;
+	const matrix4& transformation;
+};
+
+/// Helper class that can apply a linear transformation to a subset of a collection of points, leaving the rest untouched.
+/// Designed for compatibility with k3d::parallel::parallel_for(), using a range of indices into the subset.
+class selected_linear_transformation_worker
+{
+public:
+
+	selected_linear_transformation_worker(const mesh::points_t& InputPoints, const mesh::selection_t& PointSelection, const mesh::indices_t& SelectedPoints, mesh::points_t& OutputPoints, const matrix4& Transformation) :
+		input_points(InputPoints),
+		point_selection(PointSelection),
+		selected_points(SelectedPoints),
+		output_points(OutputPoints),
+		transformation(Transformation)
+	{
+	}
+	
+	void operator()(const parallel::blocked_range<uint_t>& range) const
+	{
+		const uint_t index_begin = range.begin();
+		const uint_t index_end = range.end();
+		for(uint_t index = index_begin; index != index_end; ++index)
+		{
+			const uint_t point = selected_points[index];
+			output_points[point] = mix(input_points[point], transformation * input_points[point], point_selection[point]);
+		}
+	}
+
+private:
+	const mesh::points_t& input_points;
+	const mesh::selection_t& point_selection;
+	const mesh::indices_t& selected_points;
+	mesh::points_t& output_points;
+	const matrix4& transformation;
+};
+
+} // namespace k3d
+
+#endif // !K3DSDK_LINEAR_TRANSFORMATION_WORKER_H
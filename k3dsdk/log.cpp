@@ -22,7 +22,10 @@
 #include <k3dsdk/result.h>
 #include <k3dsdk/system.h>
 
+#include <glibmm/thread.h>
+
 #include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <sstream>
@@ -35,12 +38,16 @@
 
 #elif defined K3D_API_DARWIN
 
+	#include <signal.h>
 	#include <syslog.h>
+	#include <unistd.h>
 
 #else
 
+	#include <signal.h>
 	#include <syslog.h>
 	#include <execinfo.h>
+	#include <unistd.h>
 
 #endif
 
@@ -157,7 +164,8 @@ void log_cerr(const time_t Timestamp, const log_level_t Level, const std::string
 
 void log_file(const time_t Timestamp, const log_level_t Level, const std::string& Message)
 {
-  static std::ofstream logfile((system::get_home_directory() / k3d::filesystem::generic_path(".k3d") / k3d::filesystem::generic_path("k3d.log")).native_filesystem_string().c_str());
+  // Never destroyed, so messages can still be written while the log writer shuts down at exit ...
+  static std::ofstream& logfile = *new std::ofstream((system::get_home_directory() / k3d::filesystem::generic_path(".k3d") / k3d::filesystem::generic_path("k3d.log")).native_filesystem_string().c_str());
   if(Level > g_log_minimum_level)
     return;
 
@@ -259,35 +267,532 @@ void log_output_debug_string(const time_t Timestamp, const log_level_t Level, co
 #endif // !K3D_API_WIN32
 
 ///////////////////////////////////////////////////////////
-// signal_buf
+// log_message
 
-/// When attached to an output stream, emits a signal containing each line of output
-class signal_buf :
-	public std::streambuf
+/// Stores a complete line of log output, queued for delivery to the built-in log sinks.  An empty message is a request to flush the sinks.
+struct log_message
+{
+	log_message(const time_t Timestamp, const log_level_t Level, const std::string& Message) :
+		timestamp(Timestamp),
+		level(Level),
+		message(Message),
+		next(0)
+	{
+	}
+
+	time_t timestamp;
+	log_level_t level;
+	std::string message;
+	log_message* next;
+};
+
+///////////////////////////////////////////////////////////
+// log_writer
+
+/// Delivers log messages to the built-in sinks (console, log file, cache, and syslog) on a background thread, so threads that log
+/// never block on slow sinks, such as log files on network filesystems.  Producers push messages onto a lock-free stack, which the
+/// writer thread drains in batches, restoring their original order.  Consecutive identical messages are written once, followed by
+/// a count of the repetitions.
+///
+/// Slots connected with connect_log_message() are also called on the writer thread, one message at a time and in order, so a slow
+/// observer never blocks the threads that log.  Observers that update a user interface must hand messages off to their UI thread,
+/// and must be disconnected with disconnect_log_message(), which waits for any call in progress, before they are destroyed.
+///
+/// At exit, the writer thread delivers every queued message and is joined before the log's globals are destroyed; anything logged
+/// after that is delivered synchronously.  If the process crashes, a fatal signal handler writes whatever is still queued.
+class log_writer
 {
 public:
-	signal_buf() :
-		m_stream(0)
+	static log_writer& instance()
+	{
+		// Never destroyed, so messages logged during static destruction are still delivered (synchronously, after shutdown()) ...
+		static log_writer* const writer = create();
+		return *writer;
+	}
+
+	sigc::connection connect(const sigc::slot<void, const time_t, const log_level_t, const std::string&>& Slot)
+	{
+		Glib::RecMutex::Lock lock(m_signal_mutex);
+		return m_signal.connect(Slot);
+	}
+
+	/// Disconnects an observer.  Holds the same lock as deliver(), so once this returns the observer isn't being called, and won't be again.
+	void disconnect(sigc::connection& Connection)
+	{
+		Glib::RecMutex::Lock lock(m_signal_mutex);
+		Connection.disconnect();
+	}
+
+	/// Queues a message for delivery to the sinks and observers.  Critical messages are often the last thing logged before a crash,
+	/// so they are written to the sinks (but not necessarily passed to observers) before returning.
+	void push(const time_t Timestamp, const log_level_t Level, const std::string& Message)
+	{
+		push(new log_message(Timestamp, Level, Message));
+
+		if(Level == K3D_LOG_LEVEL_CRITICAL && !g_atomic_int_get(&m_synchronous) && Glib::Thread::self() != m_thread)
+			wait(m_sunk, static_cast<guint>(g_atomic_int_get(&m_pushed)), 10.0);
+	}
+
+	/// Waits until every message queued so far has been delivered, or until Timeout seconds elapse.  Returns true iff every message was delivered.
+	bool_t flush(const double_t Timeout)
+	{
+		if(g_atomic_int_get(&m_synchronous))
+		{
+			Glib::Mutex::Lock lock(m_sink_mutex);
+			report_repetitions();
+			return true;
+		}
+
+		// The writer thread can't wait for itself (e.g. an observer that flushes the log) ...
+		if(Glib::Thread::self() == m_thread)
+			return false;
+
+		push(new log_message(0, K3D_LOG_LEVEL_DEBUG, std::string()));
+		return wait(m_written, static_cast<guint>(g_atomic_int_get(&m_pushed)), Timeout);
+	}
+
+	/// Calls a slot for every message in the log cache
+	void get_cache(const sigc::slot<void, const time_t, const log_level_t, const std::string&>& Slot)
+	{
+		flush(1.0);
+
+		std::vector<time_t> timestamps;
+		std::vector<log_level_t> levels;
+		std::vector<std::string> messages;
+		{
+			Glib::Mutex::Lock lock(m_sink_mutex);
+			timestamps = g_log_timestamp_cache;
+			levels = g_log_level_cache;
+			messages = g_log_message_cache;
+		}
+
+		for(size_t i = 0; i != timestamps.size(); ++i)
+			Slot(timestamps[i], levels[i], messages[i]);
+	}
+
+	/// Delivers queued messages at exit and joins the writer thread, then switches to synchronous delivery for any messages
+	/// logged during the rest of static destruction.  Does nothing if the log was never used.
+	static void shutdown()
+	{
+		log_writer* const writer = static_cast<log_writer*>(g_atomic_pointer_get(&s_writer));
+		if(!writer || !writer->m_thread)
+			return;
+
+		writer->flush(2.0);
+		g_atomic_int_set(&writer->m_synchronous, 1);
+
+		{
+			Glib::Mutex::Lock lock(writer->m_mutex);
+			writer->m_stopping = true;
+			writer->m_wake.signal();
+		}
+
+		writer->m_thread->join();
+		writer->m_thread = 0;
+
+		// Deliver anything queued by threads that raced the switch to synchronous delivery ...
+		writer->deliver(writer->take());
+
+		Glib::Mutex::Lock lock(writer->m_sink_mutex);
+		writer->report_repetitions();
+	}
+
+private:
+	log_writer() :
+		m_head(0),
+		m_pushed(0),
+		m_synchronous(1),
+		m_thread(0),
+		m_stopping(false),
+		m_sunk(0),
+		m_written(0),
+		m_last_timestamp(0),
+		m_last_level(K3D_LOG_LEVEL_DEBUG),
+		m_repetitions(0)
+	{
+	}
+
+	static log_writer* create()
+	{
+#ifdef G_THREADS_ENABLED
+		if(!Glib::thread_supported())
+			Glib::thread_init();
+#endif // G_THREADS_ENABLED
+
+		log_writer* const writer = new log_writer();
+
+#ifdef G_THREADS_ENABLED
+		try
+		{
+			writer->m_thread = Glib::Thread::create(sigc::mem_fun(*writer, &log_writer::run), true);
+			writer->m_synchronous = 0;
+		}
+		catch(Glib::ThreadError&)
+		{
+		}
+#endif // G_THREADS_ENABLED
+
+		g_atomic_pointer_set(&s_writer, writer);
+
+#ifndef K3D_API_WIN32
+		if(writer->m_thread)
+			install_crash_handlers();
+#endif // !K3D_API_WIN32
+
+		return writer;
+	}
+
+	/// Returns true iff counter A is behind counter B, allowing for the counters wrapping around
+	static bool_t behind(const guint A, const guint B)
+	{
+		return static_cast<gint>(A - B) < 0;
+	}
+
+	/// Waits until Counter reaches Target, or until Timeout seconds elapse.  Returns true iff Counter reached Target.
+	bool_t wait(const guint& Counter, const guint Target, const double_t Timeout)
+	{
+		Glib::TimeVal end;
+		end.assign_current_time();
+		end.add_microseconds(static_cast<long>(Timeout * 1000000));
+
+		Glib::Mutex::Lock lock(m_mutex);
+		while(behind(Counter, Target))
+		{
+			if(!m_written_cond.timed_wait(m_mutex, end))
+				return false;
+		}
+
+		return true;
+	}
+
+#ifndef K3D_API_WIN32
+
+	/// Installs on_fatal_signal() for signals that terminate the process with a core dump, unless the application has its own handlers
+	static void install_crash_handlers()
+	{
+		const int signals[] = { SIGABRT, SIGBUS, SIGFPE, SIGILL, SIGSEGV };
+		for(size_t i = 0; i != sizeof(signals) / sizeof(signals[0]); ++i)
+		{
+			struct sigaction previous;
+			if(0 != sigaction(signals[i], 0, &previous))
+				continue;
+			if((previous.sa_flags & SA_SIGINFO) || previous.sa_handler != SIG_DFL)
+				continue;
+
+			struct sigaction action;
+			std::memset(&action, 0, sizeof(action));
+			action.sa_handler = on_fatal_signal;
+			sigemptyset(&action.sa_mask);
+			action.sa_flags = SA_RESETHAND | SA_NODEFER;
+			sigaction(signals[i], &action, 0);
+		}
+	}
+
+	/// Writes queued messages before the process dies.  The handler resets itself on entry, so re-raising the signal terminates the process as usual.
+	static void on_fatal_signal(int Signal)
+	{
+		log_writer* const writer = static_cast<log_writer*>(g_atomic_pointer_get(&s_writer));
+		if(writer)
+			writer->emergency_flush();
+
+		raise(Signal);
+	}
+
+	/// Best-effort delivery of queued messages from a fatal signal handler.  Gives the writer thread up to a second to finish writing the
+	/// messages it has already taken, then writes the rest to the sinks (the process is crashing, so this is worth the risk).  If the sinks
+	/// stay busy (e.g. because this thread crashed while writing to them), messages go to stderr using only calls that are safe in a signal handler.
+	void emergency_flush()
 	{
-		connect(sigc::ptr_fun(log_cerr));
-		connect(sigc::ptr_fun(log_cache));
-    connect(sigc::ptr_fun(log_file));
+		bool_t locked = m_sink_mutex.trylock();
+		for(int i = 0; !locked && i != 100; ++i)
+		{
+			usleep(10000);
+			locked = m_sink_mutex.trylock();
+		}
+
+		log_message* const messages = take();
+
+		if(locked)
+		{
+			for(log_message* message = messages; message; message = message->next)
+				write(*message);
+			report_repetitions();
+			m_sink_mutex.unlock();
+			return;
+		}
+
+		for(log_message* message = messages; message; message = message->next)
+		{
+			if(!message->message.empty())
+				::write(STDERR_FILENO, message->message.data(), message->message.size());
+		}
+	}
+
+#endif // !K3D_API_WIN32
+
+	void push(log_message* Message)
+	{
+		if(g_atomic_int_get(&m_synchronous))
+		{
+			Message->next = 0;
+			deliver(Message);
+			return;
+		}
+
+		gpointer head = 0;
+		do
+		{
+			head = g_atomic_pointer_get(&m_head);
+			Message->next = static_cast<log_message*>(head);
+		}
+		while(!g_atomic_pointer_compare_and_exchange(&m_head, head, Message));
+
+		g_atomic_int_inc(&m_pushed);
+
+		// The writer drains the whole queue at once, so it only needs to be woken when the queue was empty ...
+		if(!head)
+		{
+			Glib::Mutex::Lock lock(m_mutex);
+			m_wake.signal();
+		}
+	}
+
+	void run()
+	{
+		while(true)
+		{
+			log_message* const messages = take();
+			if(!messages)
+			{
+				bool_t pending = false;
+				{
+					Glib::Mutex::Lock lock(m_sink_mutex);
+					pending = m_repetitions;
+				}
+
+				// Sleep until messages arrive, reporting suppressed repetitions if the log stays idle ...
+				bool_t idle = false;
+				{
+					Glib::Mutex::Lock lock(m_mutex);
+					if(!g_atomic_pointer_get(&m_head))
+					{
+						// ... or stop, once shutdown() has asked us to and the queue is empty ...
+						if(m_stopping)
+							return;
+
+						if(pending)
+						{
+							Glib::TimeVal end;
+							end.assign_current_time();
+							end.add_seconds(1);
+							idle = !m_wake.timed_wait(m_mutex, end);
+						}
+						else
+						{
+							m_wake.wait(m_mutex);
+						}
+					}
+				}
+
+				if(idle)
+				{
+					Glib::Mutex::Lock lock(m_sink_mutex);
+					report_repetitions();
+				}
+
+				continue;
+			}
+
+			const guint count = write(messages);
+			{
+				Glib::Mutex::Lock lock(m_mutex);
+				m_sunk += count;
+				m_written_cond.broadcast();
+			}
+
+			notify(messages);
+			{
+				Glib::Mutex::Lock lock(m_mutex);
+				m_written += count;
+				m_written_cond.broadcast();
+			}
+		}
+	}
+
+	/// Takes every queued message at once, returning them in their original order
+	log_message* take()
+	{
+		gpointer head = 0;
+		do
+		{
+			head = g_atomic_pointer_get(&m_head);
+		}
+		while(head && !g_atomic_pointer_compare_and_exchange(&m_head, head, 0));
+
+		log_message* messages = 0;
+		for(log_message* message = static_cast<log_message*>(head); message; )
+		{
+			log_message* const next = message->next;
+			message->next = messages;
+			messages = message;
+			message = next;
+		}
+
+		return messages;
+	}
+
+	/// Delivers a list of messages to the sinks, then to observers, and deletes them
+	void deliver(log_message* Messages)
+	{
+		write(Messages);
+		notify(Messages);
+	}
+
+	/// Delivers a list of messages to the sinks.  Returns the number of messages written.
+	guint write(log_message* Messages)
+	{
+		guint count = 0;
+
+		Glib::Mutex::Lock lock(m_sink_mutex);
+		for(log_message* message = Messages; message; message = message->next, ++count)
+			write(*message);
+
+		return count;
+	}
+
+	/// Passes a list of messages to observers, and deletes them.  Observers are notified without holding m_sink_mutex, so they can
+	/// log (and read the log cache) themselves.
+	void notify(log_message* Messages)
+	{
+		Glib::RecMutex::Lock lock(m_signal_mutex);
+		while(Messages)
+		{
+			log_message* const next = Messages->next;
+			if(!Messages->message.empty())
+				m_signal.emit(Messages->timestamp, Messages->level, Messages->message);
+			delete Messages;
+			Messages = next;
+		}
+	}
+
+	/// Delivers a message to the sinks, suppressing consecutive repetitions (the caller must hold m_sink_mutex)
+	void write(const log_message& Message)
+	{
+		if(Message.message.empty())
+		{
+			report_repetitions();
+			return;
+		}
+
+		if(Message.level == m_last_level && Message.message == m_last_message)
+		{
+			m_last_timestamp = Message.timestamp;
+			++m_repetitions;
+			return;
+		}
+
+		report_repetitions();
+
+		m_last_level = Message.level;
+		m_last_message = Message.message;
+
+		write(Message.timestamp, Message.level, Message.message);
+	}
+
+	/// Delivers a summary of suppressed repetitions to the sinks (the caller must hold m_sink_mutex)
+	void report_repetitions()
+	{
+		if(!m_repetitions)
+			return;
+
+		std::ostringstream buffer;
+		buffer << "last message repeated " << m_repetitions << " times\n";
+		m_repetitions = 0;
+
+		write(m_last_timestamp, m_last_level, buffer.str());
+	}
+
+	void write(const time_t Timestamp, const log_level_t Level, const std::string& Message)
+	{
+		log_cerr(Timestamp, Level, Message);
+		log_cache(Timestamp, Level, Message);
+		log_file(Timestamp, Level, Message);
 
 #ifdef K3D_API_WIN32
-		connect(sigc::ptr_fun(log_output_debug_string));
+		log_output_debug_string(Timestamp, Level, Message);
 #else // K3D_API_WIN32
-		connect(sigc::ptr_fun(log_syslog));
+		log_syslog(Timestamp, Level, Message);
 #endif // !K3D_API_WIN32
 	}
 
-	void init(std::ostream& Stream)
+	/// Lock-free stack of queued messages, most-recent first
+	volatile gpointer m_head;
+	/// Number of messages queued, updated atomically.  This and the other counters wrap around, so they are compared using behind().
+	volatile gint m_pushed;
+	/// Non-zero if messages are delivered on the calling thread (no writer thread, or after shutdown)
+	volatile gint m_synchronous;
+	/// The writer thread, or 0 if messages are delivered synchronously
+	Glib::Thread* m_thread;
+
+	/// Protects m_sunk, m_written and m_stopping, used to wake the writer and to wait for it
+	Glib::Mutex m_mutex;
+	/// Set by shutdown() to stop the writer thread once the queue is empty
+	bool_t m_stopping;
+	Glib::Cond m_wake;
+	Glib::Cond m_written_cond;
+	/// Number of messages written to the sinks
+	guint m_sunk;
+	/// Number of messages written to the sinks and passed to observers
+	guint m_written;
+
+	/// Serializes access to the sinks, the log cache, and the repetition state
+	Glib::Mutex m_sink_mutex;
+	time_t m_last_timestamp;
+	log_level_t m_last_level;
+	std::string m_last_message;
+	uint_t m_repetitions;
+
+	Glib::RecMutex m_signal_mutex;
+	sigc::signal<void, const time_t, const log_level_t, const std::string&> m_signal;
+
+	/// The writer, once created, for shutdown()
+	static volatile gpointer s_writer;
+};
+
+volatile gpointer log_writer::s_writer = 0;
+
+///////////////////////////////////////////////////////////
+// log_writer_shutdown
+
+/// Shuts down the log writer during static destruction.  Defined after the globals used by the sinks, so it is destroyed
+/// (and the writer thread joined) before they are.
+class log_writer_shutdown
+{
+public:
+	~log_writer_shutdown()
 	{
-		m_stream = &Stream;
+		log_writer::shutdown();
 	}
+};
 
-	sigc::connection connect(const sigc::slot<void, const time_t, const log_level_t, const std::string&>& Slot)
+log_writer_shutdown g_log_writer_shutdown;
+
+///////////////////////////////////////////////////////////
+// signal_buf
+
+/// When attached to an output stream, queues each line of output for the log writer
+class signal_buf :
+	public std::streambuf
+{
+public:
+	signal_buf() :
+		m_stream(0)
 	{
-		return m_signal.connect(Slot);
+	}
+
+	void init(std::ostream& Stream)
+	{
+		m_stream = &Stream;
 	}
 
 protected:
@@ -303,7 +808,7 @@ protected:
 			const time_t current_time = time(0);
 			const log_level_t current_log_level = static_cast<log_level_t>(log_level(*m_stream));
 
-			m_signal.emit(current_time, current_log_level, m_buffer);
+			log_writer::instance().push(current_time, current_log_level, m_buffer);
 			m_buffer.clear();
 
 			log_level(*m_stream) = 0;
@@ -315,7 +820,6 @@ protected:
 private:
 	std::ostream* m_stream;
 	std::string m_buffer;
-	sigc::signal<void, const time_t, const log_level_t, const std::string&> m_signal;
 };
 
 ///////////////////////////////////////////////////////////
@@ -336,6 +840,7 @@ private:
 ///////////////////////////////////////////////////////////
 // log_stream
 
+/// Provides a separate log stream for each thread, so partial lines logged by different threads never interleave
 class log_stream :
 	private virtual log_stream_init,
 	public std::ostream
@@ -343,13 +848,22 @@ class log_stream :
 public:
 	static log_stream& instance()
 	{
+		// Initializes threading before creating thread-local storage ...
+		log_writer::instance();
+
+#ifdef G_THREADS_ENABLED
+		static Glib::Private<log_stream> streams;
+		log_stream* stream = streams.get();
+		if(!stream)
+		{
+			stream = new log_stream();
+			streams.set(stream);
+		}
+		return *stream;
+#else // G_THREADS_ENABLED
 		static log_stream m_instance;
 		return m_instance;
-	}
-
-	sigc::connection connect(const sigc::slot<void, const time_t, const log_level_t, const std::string&>& Slot)
-	{
-		return log_stream_init::buf()->connect(Slot);
+#endif // !G_THREADS_ENABLED
 	}
 
 private:
@@ -459,7 +973,15 @@ void log_minimum_level(const log_level_t Level)
 
 sigc::connection connect_log_message(const sigc::slot<void, const time_t, const log_level_t, const std::string&>& Slot)
 {
-	return detail::log_stream::instance().connect(Slot);
+	return detail::log_writer::instance().connect(Slot);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// disconnect_log_message
+
+void disconnect_log_message(sigc::connection& Connection)
+{
+	detail::log_writer::instance().disconnect(Connection);
 }
 
 /////////////////////////////////////////////////////////////////////////////
@@ -467,8 +989,15 @@ sigc::connection connect_log_message(const sigc::slot<void, const time_t, const
 
 void get_log_cache(const sigc::slot<void, const time_t, const log_level_t, const std::string&>& Slot)
 {
-	for(size_t i = 0; i != detail::g_log_timestamp_cache.size(); ++i)
-		Slot(detail::g_log_timestamp_cache[i], detail::g_log_level_cache[i], detail::g_log_message_cache[i]);
+	detail::log_writer::instance().get_cache(Slot);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// log_flush
+
+bool_t log_flush(const double_t Timeout)
+{
+	return detail::log_writer::instance().flush(Timeout);
 }
 
 } // namespace k3d
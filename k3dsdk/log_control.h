@@ -50,10 +50,19 @@ void log_syslog(bool_t Enable);
 void log_minimum_level(const log_level_t Level);
 
 
-/// Connects a slot to a signal that will be emitted whenever messages are added to the log 
+/// Connects a slot to a signal that will be emitted whenever messages are added to the log.  The slot is called on the log's
+/// writer thread (so it must not touch user interface objects directly), in order, and never concurrently.  Observers must be
+/// disconnected with disconnect_log_message() before they are destroyed, since sigc::trackable's automatic disconnection isn't
+/// synchronized with the writer thread.
 sigc::connection connect_log_message(const sigc::slot<void, const time_t, const log_level_t, const string_t&>& Slot);
+/// Disconnects a slot connected with connect_log_message(), waiting for it to return if the writer thread is calling it.  Once this
+/// returns, the slot won't be called again.
+void disconnect_log_message(sigc::connection& Connection);
 /// Retrieves the current contents of the log cache by repeatedly calling the given slot
 void get_log_cache(const sigc::slot<void, const time_t, const log_level_t, const string_t&>& Slot);
+/// Waits until every message logged so far has been written to the console, log file, syslog, and log cache, and passed to
+/// observers (which happens asynchronously), or until Timeout seconds have elapsed.  Returns true iff every message was written.
+bool_t log_flush(const double_t Timeout = 5.0);
 
 } // namespace k3d
 
@@ -28,7 +28,9 @@
 
 #include <boost/scoped_ptr.hpp>
 
+#include <algorithm>
 #include <iterator>
+#include <limits>
 #include <map>
 
 namespace k3d
@@ -113,7 +115,8 @@ namespace detail
 {
 
 /// Helper function used by lookup_unused_points()
-void mark_used_points(const mesh::indices_t& PrimitivePoints, mesh::bools_t& UnusedPoints)
+template<typename IndicesT>
+void mark_used_points(const IndicesT& PrimitivePoints, mesh::bools_t& UnusedPoints)
 {
 	const uint_t begin = 0;
 	const uint_t end = PrimitivePoints.size();
@@ -136,6 +139,8 @@ struct mark_used_primitive_points
 
 		if(const mesh::indices_t* const array = dynamic_cast<const mesh::indices_t*>(Array.get()))
 			mark_used_points(*array, unused_points);
+		else if(const mesh::compact_indices_t* const array = dynamic_cast<const mesh::compact_indices_t*>(Array.get()))
+			mark_used_points(*array, unused_points);
 	}
 
 	mesh::bools_t& unused_points;
@@ -203,7 +208,8 @@ namespace detail
 {
 
 /// Helper function used by delete_points()
-void remap_points(mesh::indices_t& PrimitivePoints, const mesh::indices_t& PointMap)
+template<typename IndicesT>
+void remap_points(IndicesT& PrimitivePoints, const mesh::indices_t& PointMap)
 {
 	const uint_t begin = 0;
 	const uint_t end = PrimitivePoints.size();
@@ -226,6 +232,8 @@ struct remap_primitive_points
 
 		if(mesh::indices_t* const array = dynamic_cast<mesh::indices_t*>(&Array.writable()))
 			remap_points(*array, point_map);
+		else if(mesh::compact_indices_t* const array = dynamic_cast<mesh::compact_indices_t*>(&Array.writable()))
+			remap_points(*array, point_map);
 	}
 
 	const mesh::indices_t& point_map;
@@ -300,6 +308,22 @@ public:
 		if(Array->get_metadata_value(metadata::key::domain()) != metadata::value::point_indices_domain())
 			return;
 
+		// Compact indices are widened if the offset would overflow them ...
+		if(const mesh::compact_indices_t* const compact = dynamic_cast<const mesh::compact_indices_t*>(Array.get()))
+		{
+			const uint_t max = compact->empty() ? 0 : *std::max_element(compact->begin(), compact->end());
+			if(max + offset <= std::numeric_limits<uint32_t>::max())
+			{
+				mesh::compact_indices_t& array = dynamic_cast<mesh::compact_indices_t&>(Array.writable());
+				std::transform(array.begin(), array.end(), array.begin(), std::bind2nd(std::plus<uint32_t>(), static_cast<uint32_t>(offset)));
+				return;
+			}
+
+			uint_t_array* const array = new uint_t_array(compact->begin(), compact->end());
+			array->set_metadata(compact->get_metadata());
+			Array.create(array);
+		}
+
 		uint_t_array* const array = dynamic_cast<uint_t_array*>(&Array.writable());
 		if(!array)
 		{
@@ -383,6 +407,32 @@ mesh::primitive& mesh::primitives_t::create(const string_t& Type)
 	return back().create(new mesh::primitive(Type));
 }
 
+////////////////////////////////////////////////////////////////////////////////////
+// pipeline_data_shared
+
+namespace detail
+{
+
+void freeze_arrays(const mesh::named_tables_t& Tables)
+{
+	for(mesh::named_tables_t::const_iterator table = Tables.begin(); table != Tables.end(); ++table)
+	{
+		for(mesh::table_t::const_iterator array = table->second.begin(); array != table->second.end(); ++array)
+		{
+			if(array->second)
+				array->second->freeze();
+		}
+	}
+}
+
+} // namespace detail
+
+void pipeline_data_shared(mesh::primitive* const Primitive)
+{
+	detail::freeze_arrays(Primitive->structure);
+	detail::freeze_arrays(Primitive->attributes);
+}
+
 ////////////////////////////////////////////////////////////////////////////////////
 // operator<<
 
@@ -46,6 +46,8 @@ public:
 
 	/// Defines storage for a collection of indices.
 	typedef uint_t_array indices_t;
+	/// Defines compact storage for a collection of indices, for primitives with fewer than 2^32 components.
+	typedef typed_array<uint32_t> compact_indices_t;
 	/// Defines storage for a collection of counts.
 	typedef uint_t_array counts_t;
 	/// Defines storage for a collection of orders.
@@ -199,6 +201,9 @@ public:
 	static void append(const mesh& Source, mesh& Target, uint_t* const PointBegin = 0, uint_t* const PointEnd = 0, uint_t* const PrimitiveBegin = 0, uint_t* const PrimitiveEnd = 0);
 };
 
+/// Overload of pipeline_data_shared() that freezes the arrays of shared primitives (see array::frozen())
+void pipeline_data_shared(mesh::primitive* const Primitive);
+
 /// Stream serialization
 std::ostream& operator<<(std::ostream& Stream, const mesh& RHS);
 std::ostream& operator<<(std::ostream& Stream, const mesh::primitive& RHS);
@@ -0,0 +1,196 @@
+// K-3D
+// Copyright (c) 1995-2010, Timothy M. Shead
+//
+// Contact: tshead@k-3d.com
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+/** \file
+	\author Timothy M. Shead (tshead@k-3d.com)
+*/
+
+#include <k3dsdk/difference.h>
+#include <k3dsdk/geometry.h>
+#include <k3dsdk/idocument.h>
+#include <k3dsdk/ipipeline.h>
+#include <k3dsdk/ipipeline_profiler.h>
+#include <k3dsdk/linear_transformation_worker.h>
+#include <k3dsdk/mesh_linear_deformation_modifier.h>
+
+#include <boost/scoped_ptr.hpp>
+
+#include <algorithm>
+
+namespace k3d
+{
+
+namespace detail
+{
+
+/// Returns true iff two selection sets are identical
+bool_t same_selection(const selection::set& A, const selection::set& B)
+{
+	const difference::accumulator result = difference::test(A, B);
+	return boost::accumulators::min(result.exact) && boost::accumulators::max(result.ulps) <= 0;
+}
+
+/// Returns true iff a selection weight is either fully-selected or unselected
+bool_t binary_weight(const double_t Weight)
+{
+	return Weight == 0 || Weight == 1;
+}
+
+/// Returns true iff every point is either fully-selected or unselected after merging a selection set with a mesh.
+/// Transformations can only be combined under this condition, since blending with partial weights isn't linear.
+/// Only point selections affect point weights, so we examine their records and the mesh point selection in-place
+/// instead of merging them.  Records with partial weights are treated conservatively, even if a later record overrides them.
+bool_t binary_point_selection(const selection::set& Selection, const mesh& Mesh)
+{
+	if(!Mesh.point_selection)
+		return true;
+
+	const mesh::selection_t& point_selection = *Mesh.point_selection;
+	const uint_t point_count = point_selection.size();
+
+	std::vector<std::pair<uint_t, uint_t> > ranges;
+	for(selection::set::const_iterator storage = Selection.begin(); storage != Selection.end(); ++storage)
+	{
+		boost::scoped_ptr<geometry::point_selection::const_storage> point_selection_storage(geometry::point_selection::validate(**storage));
+		if(!point_selection_storage)
+			continue;
+
+		const uint_t record_count = point_selection_storage->index_begin.size();
+		for(uint_t record = 0; record != record_count; ++record)
+		{
+			const uint_t index_begin = std::min(point_count, point_selection_storage->index_begin[record]);
+			const uint_t index_end = std::min(point_count, std::max(point_selection_storage->index_begin[record], point_selection_storage->index_end[record]));
+			if(index_begin == index_end)
+				continue;
+
+			if(!binary_weight(point_selection_storage->weight[record]))
+				return false;
+
+			ranges.push_back(std::make_pair(index_begin, index_end));
+		}
+	}
+
+	for(uint_t point = 0; point != point_count; ++point)
+	{
+		if(binary_weight(point_selection[point]))
+			continue;
+
+		// A partial input weight is fine, so long as the selection overwrites it ...
+		bool_t overwritten = false;
+		for(uint_t range = 0; range != ranges.size() && !overwritten; ++range)
+			overwritten = ranges[range].first <= point && point < ranges[range].second;
+
+		if(!overwritten)
+			return false;
+	}
+
+	return true;
+}
+
+} // namespace detail
+
+mesh_linear_deformation_modifier::mesh_linear_deformation_modifier(iplugin_factory& Factory, idocument& Document) :
+	base(Factory, Document),
+	m_combined_modifiers_valid(false)
+{
+	m_input_mesh.changed_signal().connect(sigc::mem_fun(*this, &mesh_linear_deformation_modifier::on_invalidate_combined_modifiers));
+	m_mesh_selection.changed_signal().connect(sigc::mem_fun(*this, &mesh_linear_deformation_modifier::on_invalidate_combined_modifiers));
+}
+
+const mesh* mesh_linear_deformation_modifier::input_mesh()
+{
+	// Any change upstream or to our selection shows up as a change to our input or selection, so the chain only needs to be found once ...
+	if(m_combined_modifiers_valid)
+		return m_combined_modifiers.empty() ? base::input_mesh() : m_combined_modifiers.back()->m_input_mesh.pipeline_value();
+
+	m_combined_modifiers_valid = true;
+	m_combined_modifiers.clear();
+
+	// Look for a chain of upstream modifiers that apply their transformations to the same points ...
+	const selection::set selection = m_mesh_selection.pipeline_value();
+	for(mesh_linear_deformation_modifier* modifier = upstream_modifier(*this); modifier; modifier = upstream_modifier(*modifier))
+	{
+		if(!detail::same_selection(modifier->m_mesh_selection.pipeline_value(), selection))
+			break;
+
+		m_combined_modifiers.push_back(modifier);
+	}
+
+	// If we found one, take our input from the start of the chain, skipping the intermediate nodes entirely ...
+	if(!m_combined_modifiers.empty())
+	{
+		const mesh* const input = m_combined_modifiers.back()->m_input_mesh.pipeline_value();
+		if(input && detail::binary_point_selection(selection, *input))
+			return input;
+
+		m_combined_modifiers.clear();
+	}
+
+	return base::input_mesh();
+}
+
+void mesh_linear_deformation_modifier::on_deform_mesh(const mesh::points_t& InputPoints, const mesh::selection_t& PointSelection, mesh::points_t& OutputPoints)
+{
+	ipipeline_profiler::profile profile(document().pipeline_profiler(), *this, "Deform Mesh");
+	const matrix4 transformation = combined_transformation_matrix();
+
+	parallel::parallel_for(
+		parallel::blocked_range<uint_t>(0, OutputPoints.size(), parallel::grain_size()),
+		linear_transformation_worker(InputPoints, PointSelection, OutputPoints, transformation));
+}
+
+void mesh_linear_deformation_modifier::on_deform_selected_points(const mesh::points_t& InputPoints, const mesh::selection_t& PointSelection, const mesh::indices_t& SelectedPoints, mesh::points_t& OutputPoints)
+{
+	ipipeline_profiler::profile profile(document().pipeline_profiler(), *this, "Deform Mesh");
+	const matrix4 transformation = combined_transformation_matrix();
+
+	parallel::parallel_for(
+		parallel::blocked_range<uint_t>(0, SelectedPoints.size(), parallel::grain_size()),
+		selected_linear_transformation_worker(InputPoints, PointSelection, SelectedPoints, OutputPoints, transformation));
+}
+
+mesh_linear_deformation_modifier* mesh_linear_deformation_modifier::upstream_modifier(mesh_linear_deformation_modifier& Modifier)
+{
+	iproperty* const source = document().pipeline().dependency(Modifier.m_input_mesh);
+	if(!source)
+		return 0;
+
+	mesh_linear_deformation_modifier* const upstream = dynamic_cast<mesh_linear_deformation_modifier*>(source->property_node());
+	if(!upstream || source != &upstream->mesh_source_output())
+		return 0;
+
+	return upstream;
+}
+
+const matrix4 mesh_linear_deformation_modifier::combined_transformation_matrix()
+{
+	matrix4 result = transformation_matrix();
+	for(uint_t i = 0; i != m_combined_modifiers.size(); ++i)
+		result = result * m_combined_modifiers[i]->transformation_matrix();
+
+	return result;
+}
+
+void mesh_linear_deformation_modifier::on_invalidate_combined_modifiers(ihint*)
+{
+	m_combined_modifiers_valid = false;
+}
+
+} // namespace k3d
+
@@ -0,0 +1,75 @@
+#ifndef K3DSDK_MESH_LINEAR_DEFORMATION_MODIFIER_H
+#define K3DSDK_MESH_LINEAR_DEFORMATION_MODIFIER_H
+
+// K-3D
+// Copyright (c) 1995-2010, Timothy M. Shead
+//
+// Contact: tshead@k-3d.com
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+/** \file
+	\author Timothy M. Shead (tshead@k-3d.com)
+*/
+
+#include <k3dsdk/algebra.h>
+#include <k3dsdk/mesh_simple_deformation_modifier.h>
+
+#include <vector>
+
+namespace k3d
+{
+
+/// Mesh modifier implementation for use in plugins that transform selected mesh points with a single matrix.  To create a plugin, derive from
+/// mesh_linear_deformation_modifier and implement the transformation_matrix() method.
+///
+/// When the input mesh comes directly from other linear deformation modifiers with the same selection, their matrices are combined with
+/// ours and applied to their input in a single pass, so the intermediate nodes never copy or transform the points unless something
+/// else requests their output.
+class mesh_linear_deformation_modifier :
+	public mesh_simple_deformation_modifier
+{
+	typedef mesh_simple_deformation_modifier base;
+
+public:
+	mesh_linear_deformation_modifier(iplugin_factory& Factory, idocument& Document);
+
+protected:
+	const mesh* input_mesh();
+
+private:
+	void on_deform_mesh(const mesh::points_t& InputPoints, const mesh::selection_t& PointSelection, mesh::points_t& OutputPoints);
+	void on_deform_selected_points(const mesh::points_t& InputPoints, const mesh::selection_t& PointSelection, const mesh::indices_t& SelectedPoints, mesh::points_t& OutputPoints);
+
+	/// Implement this method in derived classes to return the transformation that will be applied to selected points.
+	virtual const matrix4 transformation_matrix() = 0;
+
+	/// Returns the linear deformation modifier (if any) whose output is connected to a modifier's input
+	mesh_linear_deformation_modifier* upstream_modifier(mesh_linear_deformation_modifier& Modifier);
+	/// Returns the combination of our transformation with the transformations of any upstream modifiers that we're standing-in for
+	const matrix4 combined_transformation_matrix();
+
+	void on_invalidate_combined_modifiers(ihint* Hint);
+
+	/// Stores the upstream modifiers whose transformations we apply, nearest-first
+	std::vector<mesh_linear_deformation_modifier*> m_combined_modifiers;
+	/// Set to true when m_combined_modifiers matches the current pipeline and selection
+	bool_t m_combined_modifiers_valid;
+};
+
+} // namespace k3d
+
+#endif // !K3DSDK_MESH_LINEAR_DEFORMATION_MODIFIER_H
+
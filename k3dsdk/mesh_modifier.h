@@ -27,6 +27,7 @@
 
 #include <k3d-i18n-config.h>
 #include <k3dsdk/data.h>
+#include <k3dsdk/hints.h>
 #include <k3dsdk/idocument.h>
 #include <k3dsdk/imesh_sink.h>
 #include <k3dsdk/imesh_source.h>
@@ -46,9 +47,10 @@ public:
 	mesh_modifier(iplugin_factory& Factory, idocument& Document) :
 		base_t(Factory, Document),
 		m_input_mesh(init_owner(*this) + init_name("input_mesh") + init_label(_("Input Mesh")) + init_description(_("Input mesh")) + init_value<mesh*>(0)),
-		m_output_mesh(init_owner(*this) + init_name("output_mesh") + init_label(_("Output Mesh")) + init_description(_("Output mesh")))
+		m_output_mesh(init_owner(*this) + init_name("output_mesh") + init_label(_("Output Mesh")) + init_description(_("Output mesh"))),
+		m_geometry_updates(false)
 	{
-		m_input_mesh.changed_signal().connect(make_reset_mesh_slot());
+		m_input_mesh.changed_signal().connect(sigc::mem_fun(*this, &mesh_modifier<base_t>::on_input_mesh_changed));
 
 		m_output_mesh.set_initialize_slot(sigc::mem_fun(*this, &mesh_modifier<base_t>::initialize_mesh));
 		m_output_mesh.set_update_slot(sigc::mem_fun(*this, &mesh_modifier<base_t>::update_mesh));
@@ -75,13 +77,37 @@ public:
 	}
 
 protected:
+	/// Call this from derived-class constructors to have input changes with a hint::mesh_geometry_changed hint (only the input points moved)
+	/// handled by on_update_mesh() instead of on_create_mesh().  Derived classes that do so must re-evaluate their output points from the
+	/// input points in on_update_mesh(), typically using k3d::derived_points.
+	void enable_geometry_updates()
+	{
+		m_geometry_updates = true;
+	}
+
+	/// Returns the mesh that will be passed to on_create_mesh() and on_update_mesh(), which is normally the value of the input mesh property.
+	/// Derived classes may override this to take their input from further upstream, when they can do the work of the nodes in-between themselves.
+	virtual const mesh* input_mesh()
+	{
+		return m_input_mesh.pipeline_value();
+	}
+
 	k3d_data(mesh*, data::immutable_name, data::change_signal, data::no_undo, data::local_storage, data::no_constraint, data::read_only_property, data::no_serialization) m_input_mesh;
 	k3d_data(mesh*, data::immutable_name, data::change_signal, data::no_undo, data::pointer_storage, data::no_constraint, data::read_only_property, data::no_serialization) m_output_mesh;
 
 private:
+	void on_input_mesh_changed(ihint* Hint)
+	{
+		// Point indices in the input hint don't apply to our output, so downstream nodes have to assume that any point could have moved ...
+		if(m_geometry_updates && dynamic_cast<hint::mesh_geometry_changed*>(Hint))
+			m_output_mesh.update(hint::mesh_geometry_changed::instance());
+		else
+			m_output_mesh.reset(0, Hint);
+	}
+
 	void initialize_mesh(mesh& Output)
 	{
-		if(const mesh* const input = m_input_mesh.pipeline_value())
+		if(const mesh* const input = input_mesh())
 		{
 			base_t::document().pipeline_profiler().start_execution(*this, "Create Mesh");
 			on_create_mesh(*input, Output);
@@ -95,7 +121,7 @@ private:
 
 	void update_mesh(mesh& Output)
 	{
-		if(const mesh* const input = m_input_mesh.pipeline_value())
+		if(const mesh* const input = input_mesh())
 		{
 			base_t::document().pipeline_profiler().start_execution(*this, "Update Mesh");
 			on_update_mesh(*input, Output);
@@ -105,6 +131,8 @@ private:
 
 	virtual void on_create_mesh(const mesh& Input, mesh& Output) = 0;
 	virtual void on_update_mesh(const mesh& Input, mesh& Output) = 0;
+
+	bool_t m_geometry_updates;
 };
 
 } // namespace k3d
@@ -0,0 +1,598 @@
+// K-3D
+// Copyright (c) 1995-2010, Timothy M. Shead
+//
+// Contact: tshead@k-3d.com
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+/** \file
+	\author Timothy M. Shead (tshead@k-3d.com)
+*/
+
+#include <k3dsdk/mesh_picker.h>
+#include <k3dsdk/polyhedron.h>
+#include <k3dsdk/result.h>
+
+#include <boost/scoped_ptr.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace k3d
+{
+
+namespace detail
+{
+
+/// Defines a plane in homogeneous coordinates - a point p is inside the plane iff dot(plane, p) >= 0
+typedef point4 homogeneous_plane;
+
+inline double_t plane_distance(const homogeneous_plane& Plane, const point4& Point)
+{
+	return Plane[0] * Point[0] + Plane[1] * Point[1] + Plane[2] * Point[2] + Plane[3] * Point[3];
+}
+
+/// Returns the six planes that bound the OpenGL clip volume (-w <= x, y, z <= w) in clip coordinates
+const std::vector<homogeneous_plane> clip_planes()
+{
+	std::vector<homogeneous_plane> results;
+	results.push_back(homogeneous_plane(1, 0, 0, 1));
+	results.push_back(homogeneous_plane(-1, 0, 0, 1));
+	results.push_back(homogeneous_plane(0, 1, 0, 1));
+	results.push_back(homogeneous_plane(0, -1, 0, 1));
+	results.push_back(homogeneous_plane(0, 0, 1, 1));
+	results.push_back(homogeneous_plane(0, 0, -1, 1));
+	return results;
+}
+
+/// Returns the clip-volume planes transformed into object coordinates
+const std::vector<homogeneous_plane> object_planes(const matrix4& ObjectToClip)
+{
+	const std::vector<homogeneous_plane> planes = clip_planes();
+
+	std::vector<homogeneous_plane> results;
+	for(uint_t i = 0; i != planes.size(); ++i)
+	{
+		homogeneous_plane plane(0, 0, 0, 0);
+		for(uint_t j = 0; j != 4; ++j)
+		{
+			for(uint_t k = 0; k != 4; ++k)
+				plane[j] += planes[i][k] * ObjectToClip[k][j];
+		}
+		results.push_back(plane);
+	}
+	return results;
+}
+
+/// Conservatively tests whether a bounding box is (partially) inside a set of planes, for traversing bounding-volume hierarchies
+class inside_planes
+{
+public:
+	inside_planes(const std::vector<homogeneous_plane>& Planes) :
+		planes(Planes)
+	{
+	}
+
+	bool_t operator()(const bounding_box3& Box) const
+	{
+		if(Box.empty())
+			return false;
+
+		for(uint_t i = 0; i != planes.size(); ++i)
+		{
+			const homogeneous_plane& plane = planes[i];
+			const point4 corner(
+				plane[0] > 0 ? Box.px : Box.nx,
+				plane[1] > 0 ? Box.py : Box.ny,
+				plane[2] > 0 ? Box.pz : Box.nz,
+				1);
+			if(plane_distance(plane, corner) < 0)
+				return false;
+		}
+
+		return true;
+	}
+
+private:
+	const std::vector<homogeneous_plane>& planes;
+};
+
+/// Conservatively tests whether a bounding box intersects a ray, for traversing bounding-volume hierarchies
+class intersects_ray
+{
+public:
+	intersects_ray(const line3& Ray) :
+		ray(Ray)
+	{
+	}
+
+	bool_t operator()(const bounding_box3& Box) const
+	{
+		if(Box.empty())
+			return false;
+
+		const double_t minimum[3] = { Box.nx, Box.ny, Box.nz };
+		const double_t maximum[3] = { Box.px, Box.py, Box.pz };
+
+		double_t near = 0;
+		double_t far = std::numeric_limits<double_t>::max();
+		for(uint_t i = 0; i != 3; ++i)
+		{
+			if(ray.direction[i] == 0)
+			{
+				if(ray.point[i] < minimum[i] || ray.point[i] > maximum[i])
+					return false;
+				continue;
+			}
+
+			double_t t1 = (minimum[i] - ray.point[i]) / ray.direction[i];
+			double_t t2 = (maximum[i] - ray.point[i]) / ray.direction[i];
+			if(t1 > t2)
+				std::swap(t1, t2);
+
+			near = std::max(near, t1);
+			far = std::min(far, t2);
+			if(near > far)
+				return false;
+		}
+
+		return true;
+	}
+
+private:
+	const line3& ray;
+};
+
+/// Collects the items visited in a bounding-volume hierarchy
+class collect_items
+{
+public:
+	collect_items(std::vector<uint_t>& Items) :
+		items(Items)
+	{
+	}
+
+	void operator()(const uint_t Item)
+	{
+		items.push_back(Item);
+	}
+
+private:
+	std::vector<uint_t>& items;
+};
+
+/// Converts a clip-space depth to the integer window depth used by OpenGL selection hit records
+inline GLuint window_depth(const point4& Clip)
+{
+	const double_t depth = std::max(0.0, std::min(1.0, ((Clip[2] / Clip[3]) + 1.0) * 0.5));
+	return static_cast<GLuint>(depth * static_cast<double_t>(std::numeric_limits<GLuint>::max()));
+}
+
+/// Clips a polygon in homogeneous coordinates against a plane (Sutherland-Hodgman)
+void clip_polygon(const homogeneous_plane& Plane, const std::vector<point4>& Input, std::vector<point4>& Output)
+{
+	Output.clear();
+
+	const uint_t count = Input.size();
+	for(uint_t i = 0; i != count; ++i)
+	{
+		const point4& current = Input[i];
+		const point4& next = Input[(i + 1) % count];
+
+		const double_t current_distance = plane_distance(Plane, current);
+		const double_t next_distance = plane_distance(Plane, next);
+
+		if(current_distance >= 0)
+			Output.push_back(current);
+
+		if((current_distance >= 0) != (next_distance >= 0))
+		{
+			const double_t t = current_distance / (current_distance - next_distance);
+			Output.push_back(point4(
+				current[0] + t * (next[0] - current[0]),
+				current[1] + t * (next[1] - current[1]),
+				current[2] + t * (next[2] - current[2]),
+				current[3] + t * (next[3] - current[3])));
+		}
+	}
+}
+
+/// Returns the generations of the mesh arrays that a picker depends on
+const std::vector<uint_t> picker_generations(const mesh& Mesh)
+{
+	std::vector<uint_t> results;
+	results.push_back(Mesh.points ? Mesh.points->generation() : 0);
+	results.push_back(Mesh.primitives.size());
+
+	for(mesh::primitives_t::const_iterator primitive = Mesh.primitives.begin(); primitive != Mesh.primitives.end(); ++primitive)
+	{
+		boost::scoped_ptr<polyhedron::const_primitive> polyhedron(polyhedron::validate(Mesh, **primitive));
+		if(!polyhedron)
+		{
+			results.push_back(0);
+			continue;
+		}
+
+		results.push_back(polyhedron->shell_types.generation());
+		results.push_back(polyhedron->face_first_loops.generation());
+		results.push_back(polyhedron->face_loop_counts.generation());
+		results.push_back(polyhedron->loop_first_edges.generation());
+		results.push_back(polyhedron->clockwise_edges.generation());
+		results.push_back(polyhedron->vertex_points.generation());
+	}
+
+	return results;
+}
+
+/// Appends a selection record containing a component to a collection of records
+void append_record(const selection::record& Prefix, const GLuint ZMin, const GLuint ZMax, const selection::token& Primitive, const selection::token& Component, selection::records& Records)
+{
+	Records.push_back(Prefix);
+	selection::record& record = Records.back();
+	record.zmin = ZMin;
+	record.zmax = ZMax;
+	if(Primitive.type != selection::NONE)
+		record.tokens.push_back(Primitive);
+	record.tokens.push_back(Component);
+}
+
+} // namespace detail
+
+/////////////////////////////////////////////////////////////////////////////
+// mesh_picker
+
+mesh_picker::mesh_picker(const mesh& Mesh) :
+	m_generations(detail::picker_generations(Mesh))
+{
+	if(!Mesh.points)
+		return;
+
+	const mesh::points_t& points = *Mesh.points;
+
+	std::vector<bounding_box3> boxes(points.size());
+	for(uint_t point = 0; point != points.size(); ++point)
+		boxes[point].insert(points[point]);
+	m_points.build(boxes);
+
+	// Edges are found through the faces that contain them, so we only need hierarchies for points and faces ...
+	std::vector<bounding_box3> face_boxes;
+	for(uint_t primitive = 0; primitive != Mesh.primitives.size(); ++primitive)
+	{
+		boost::scoped_ptr<polyhedron::const_primitive> polyhedron(polyhedron::validate(Mesh, *Mesh.primitives[primitive]));
+		m_sds.push_back(polyhedron && polyhedron::is_sds(*polyhedron));
+		if(!polyhedron)
+			continue;
+
+		const uint_t face_count = polyhedron->face_first_loops.size();
+		for(uint_t face = 0; face != face_count; ++face)
+		{
+			// Holes are always inside the outer loop, so it's enough to bound the outer loop ...
+			bounding_box3 box;
+			const uint_t first_edge = polyhedron->loop_first_edges[polyhedron->face_first_loops[face]];
+			for(uint_t edge = first_edge; ; )
+			{
+				box.insert(points[polyhedron->vertex_points[edge]]);
+
+				edge = polyhedron->clockwise_edges[edge];
+				if(edge == first_edge)
+					break;
+			}
+			face_boxes.push_back(box);
+
+			const component item = { primitive, face };
+			m_face_components.push_back(item);
+		}
+	}
+
+	m_faces.build(face_boxes);
+}
+
+bool_t mesh_picker::supported(const mesh& Mesh)
+{
+	for(mesh::primitives_t::const_iterator primitive = Mesh.primitives.begin(); primitive != Mesh.primitives.end(); ++primitive)
+	{
+		boost::scoped_ptr<polyhedron::const_primitive> polyhedron(polyhedron::validate(Mesh, **primitive));
+		if(!polyhedron)
+			return false;
+		if(polyhedron::is_sds(*polyhedron))
+			return false;
+	}
+
+	return true;
+}
+
+bool_t mesh_picker::up_to_date(const mesh& Mesh) const
+{
+	return detail::picker_generations(Mesh) == m_generations;
+}
+
+void mesh_picker::pick_points(const mesh& Mesh, const matrix4& ObjectToClip, const selection::record& Prefix, selection::records& Records) const
+{
+	return_if_fail(Mesh.points);
+	const mesh::points_t& points = *Mesh.points;
+
+	const std::vector<detail::homogeneous_plane> planes = detail::object_planes(ObjectToClip);
+
+	std::vector<uint_t> candidates;
+	detail::collect_items collect(candidates);
+	m_points.traverse(detail::inside_planes(planes), collect);
+	std::sort(candidates.begin(), candidates.end());
+
+	for(uint_t i = 0; i != candidates.size(); ++i)
+	{
+		const uint_t point = candidates[i];
+		const point4 clip = ObjectToClip * point4(points[point][0], points[point][1], points[point][2], 1);
+		if(clip[3] <= 0 || std::fabs(clip[0]) > clip[3] || std::fabs(clip[1]) > clip[3] || std::fabs(clip[2]) > clip[3])
+			continue;
+
+		const GLuint depth = detail::window_depth(clip);
+		detail::append_record(Prefix, depth, depth, selection::token(), selection::token(selection::POINT, point), Records);
+	}
+}
+
+void mesh_picker::pick_edges(const mesh& Mesh, const matrix4& ObjectToClip, const selection::record& Prefix, selection::records& Records) const
+{
+	return_if_fail(Mesh.points);
+	const mesh::points_t& points = *Mesh.points;
+
+	const std::vector<detail::homogeneous_plane> planes = detail::object_planes(ObjectToClip);
+	const std::vector<detail::homogeneous_plane> clip_planes = detail::clip_planes();
+
+	std::vector<uint_t> candidates;
+	detail::collect_items collect(candidates);
+	m_faces.traverse(detail::inside_planes(planes), collect);
+	std::sort(candidates.begin(), candidates.end());
+
+	boost::scoped_ptr<polyhedron::const_primitive> polyhedron;
+	uint_t polyhedron_index = 0;
+
+	for(uint_t i = 0; i != candidates.size(); ++i)
+	{
+		const component& face = m_face_components[candidates[i]];
+		if(!polyhedron || polyhedron_index != face.primitive)
+		{
+			polyhedron.reset(polyhedron::validate(Mesh, *Mesh.primitives[face.primitive]));
+			polyhedron_index = face.primitive;
+			return_if_fail(polyhedron);
+		}
+
+		const uint_t loop_begin = polyhedron->face_first_loops[face.index];
+		const uint_t loop_end = loop_begin + polyhedron->face_loop_counts[face.index];
+		for(uint_t loop = loop_begin; loop != loop_end; ++loop)
+		{
+			const uint_t first_edge = polyhedron->loop_first_edges[loop];
+			for(uint_t edge = first_edge; ; )
+			{
+				const point3& a = points[polyhedron->vertex_points[edge]];
+				const point3& b = points[polyhedron->vertex_points[polyhedron->clockwise_edges[edge]]];
+				const point4 start = ObjectToClip * point4(a[0], a[1], a[2], 1);
+				const point4 end = ObjectToClip * point4(b[0], b[1], b[2], 1);
+
+				// Clip the edge against the clip volume (Liang-Barsky) ...
+				double_t t0 = 0;
+				double_t t1 = 1;
+				for(uint_t j = 0; j != clip_planes.size() && t0 <= t1; ++j)
+				{
+					const double_t d0 = detail::plane_distance(clip_planes[j], start);
+					const double_t d1 = detail::plane_distance(clip_planes[j], end);
+
+					if(d0 < 0 && d1 < 0)
+						t0 = 2;
+					else if(d0 < 0)
+						t0 = std::max(t0, d0 / (d0 - d1));
+					else if(d1 < 0)
+						t1 = std::min(t1, d0 / (d0 - d1));
+				}
+
+				if(t0 <= t1)
+				{
+					const point4 clipped_start = (1 - t0) * start + t0 * end;
+					const point4 clipped_end = (1 - t1) * start + t1 * end;
+					if(clipped_start[3] > 0 && clipped_end[3] > 0)
+					{
+						const GLuint start_depth = detail::window_depth(clipped_start);
+						const GLuint end_depth = detail::window_depth(clipped_end);
+						detail::append_record(Prefix, std::min(start_depth, end_depth), std::max(start_depth, end_depth), selection::token(selection::PRIMITIVE, face.primitive), selection::token(selection::EDGE, edge), Records);
+					}
+				}
+
+				edge = polyhedron->clockwise_edges[edge];
+				if(edge == first_edge)
+					break;
+			}
+		}
+	}
+}
+
+void mesh_picker::pick_faces(const mesh& Mesh, const matrix4& ObjectToClip, const bool_t Backfacing, const bool_t InsideOut, const selection::record& Prefix, selection::records& Records) const
+{
+	return_if_fail(Mesh.points);
+	const mesh::points_t& points = *Mesh.points;
+
+	const std::vector<detail::homogeneous_plane> planes = detail::object_planes(ObjectToClip);
+	const std::vector<detail::homogeneous_plane> clip_planes = detail::clip_planes();
+
+	std::vector<uint_t> candidates;
+	detail::collect_items collect(candidates);
+	m_faces.traverse(detail::inside_planes(planes), collect);
+	std::sort(candidates.begin(), candidates.end());
+
+	boost::scoped_ptr<polyhedron::const_primitive> polyhedron;
+	uint_t polyhedron_index = 0;
+
+	std::vector<point4> polygon;
+	std::vector<point4> clipped;
+
+	for(uint_t i = 0; i != candidates.size(); ++i)
+	{
+		const component& face = m_face_components[candidates[i]];
+		if(m_sds[face.primitive])
+			continue;
+
+		if(!polyhedron || polyhedron_index != face.primitive)
+		{
+			polyhedron.reset(polyhedron::validate(Mesh, *Mesh.primitives[face.primitive]));
+			polyhedron_index = face.primitive;
+			return_if_fail(polyhedron);
+		}
+
+		polygon.clear();
+		const uint_t first_edge = polyhedron->loop_first_edges[polyhedron->face_first_loops[face.index]];
+		for(uint_t edge = first_edge; ; )
+		{
+			const point3& point = points[polyhedron->vertex_points[edge]];
+			polygon.push_back(ObjectToClip * point4(point[0], point[1], point[2], 1));
+
+			edge = polyhedron->clockwise_edges[edge];
+			if(edge == first_edge)
+				break;
+		}
+
+		for(uint_t j = 0; j != clip_planes.size() && !polygon.empty(); ++j)
+		{
+			detail::clip_polygon(clip_planes[j], polygon, clipped);
+			polygon.swap(clipped);
+		}
+		if(polygon.size() < 3)
+			continue;
+
+		// Match OpenGL backface culling, which uses the winding of the projected polygon ...
+		if(!Backfacing)
+		{
+			double_t area = 0;
+			for(uint_t j = 0; j != polygon.size(); ++j)
+			{
+				const point4& a = polygon[j];
+				const point4& b = polygon[(j + 1) % polygon.size()];
+				area += (a[0] / a[3]) * (b[1] / b[3]) - (b[0] / b[3]) * (a[1] / a[3]);
+			}
+
+			if(InsideOut ? !(area > 0) : !(area < 0))
+				continue;
+		}
+
+		GLuint zmin = std::numeric_limits<GLuint>::max();
+		GLuint zmax = 0;
+		for(uint_t j = 0; j != polygon.size(); ++j)
+		{
+			const GLuint depth = detail::window_depth(polygon[j]);
+			zmin = std::min(zmin, depth);
+			zmax = std::max(zmax, depth);
+		}
+
+		detail::append_record(Prefix, zmin, zmax, selection::token(selection::PRIMITIVE, face.primitive), selection::token(selection::FACE, face.index), Records);
+	}
+}
+
+bool_t mesh_picker::intersect(const mesh& Mesh, const line3& Ray, uint_t& Primitive, uint_t& Face, double_t& Distance) const
+{
+	return_val_if_fail(Mesh.points, false);
+	const mesh::points_t& points = *Mesh.points;
+
+	std::vector<uint_t> candidates;
+	detail::collect_items collect(candidates);
+	m_faces.traverse(detail::intersects_ray(Ray), collect);
+	std::sort(candidates.begin(), candidates.end());
+
+	boost::scoped_ptr<polyhedron::const_primitive> polyhedron;
+	uint_t polyhedron_index = 0;
+
+	bool_t found = false;
+	for(uint_t i = 0; i != candidates.size(); ++i)
+	{
+		const component& face = m_face_components[candidates[i]];
+		if(m_sds[face.primitive])
+			continue;
+
+		if(!polyhedron || polyhedron_index != face.primitive)
+		{
+			polyhedron.reset(polyhedron::validate(Mesh, *Mesh.primitives[face.primitive]));
+			polyhedron_index = face.primitive;
+			return_val_if_fail(polyhedron, false);
+		}
+
+		const uint_t first_edge = polyhedron->loop_first_edges[polyhedron->face_first_loops[face.index]];
+		const vector3 normal = to_vector(polyhedron::normal(polyhedron->vertex_points, polyhedron->clockwise_edges, points, first_edge));
+		const double_t denominator = normal * Ray.direction;
+		if(!denominator)
+			continue;
+
+		const double_t t = (normal * (points[polyhedron->vertex_points[first_edge]] - Ray.point)) / denominator;
+		if(t < 0 || (found && t >= Distance))
+			continue;
+
+		// Project the intersection and the face loops onto the plane where the face is largest, and test for containment (even-odd rule, so holes are handled) ...
+		const point3 intersection = Ray.point + t * Ray.direction;
+		uint_t axis = 0;
+		if(std::fabs(normal[1]) > std::fabs(normal[axis]))
+			axis = 1;
+		if(std::fabs(normal[2]) > std::fabs(normal[axis]))
+			axis = 2;
+		const uint_t u = (axis + 1) % 3;
+		const uint_t v = (axis + 2) % 3;
+
+		bool_t inside = false;
+		const uint_t loop_begin = polyhedron->face_first_loops[face.index];
+		const uint_t loop_end = loop_begin + polyhedron->face_loop_counts[face.index];
+		for(uint_t loop = loop_begin; loop != loop_end; ++loop)
+		{
+			const uint_t loop_first_edge = polyhedron->loop_first_edges[loop];
+			for(uint_t edge = loop_first_edge; ; )
+			{
+				const point3& a = points[polyhedron->vertex_points[edge]];
+				const point3& b = points[polyhedron->vertex_points[polyhedron->clockwise_edges[edge]]];
+
+				if((a[v] > intersection[v]) != (b[v] > intersection[v]))
+				{
+					if(intersection[u] < a[u] + (intersection[v] - a[v]) * (b[u] - a[u]) / (b[v] - a[v]))
+						inside = !inside;
+				}
+
+				edge = polyhedron->clockwise_edges[edge];
+				if(edge == loop_first_edge)
+					break;
+			}
+		}
+
+		if(!inside)
+			continue;
+
+		found = true;
+		Primitive = face.primitive;
+		Face = face.index;
+		Distance = t;
+	}
+
+	return found;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// pick_matrix
+
+const matrix4 pick_matrix(const rectangle& Region, const double_t ViewportWidth, const double_t ViewportHeight)
+{
+	const rectangle region = rectangle::normalize(Region);
+	return_val_if_fail(region.width() > 0 && region.height() > 0, identity3());
+
+	const double_t x = region.x1 + (region.width() * 0.5);
+	const double_t y = ViewportHeight - (region.y1 + (region.height() * 0.5));
+
+	return translate3((ViewportWidth - 2 * x) / region.width(), (ViewportHeight - 2 * y) / region.height(), 0)
+		* scale3(ViewportWidth / region.width(), ViewportHeight / region.height(), 1);
+}
+
+} // namespace k3d
+
@@ -0,0 +1,95 @@
+#ifndef K3DSDK_MESH_PICKER_H
+#define K3DSDK_MESH_PICKER_H
+
+// K-3D
+// Copyright (c) 1995-2010, Timothy M. Shead
+//
+// Contact: tshead@k-3d.com
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+/** \file
+	\author Timothy M. Shead (tshead@k-3d.com)
+*/
+
+#include <k3dsdk/algebra.h>
+#include <k3dsdk/bounding_volume_hierarchy.h>
+#include <k3dsdk/line3.h>
+#include <k3dsdk/mesh.h>
+#include <k3dsdk/rectangle.h>
+#include <k3dsdk/selection.h>
+
+#include <vector>
+
+namespace k3d
+{
+
+/// Answers component picking queries for the points, edges, and faces of a mesh on the CPU, using bounding-volume hierarchies
+/// built once per mesh, instead of re-rendering the mesh in OpenGL selection mode.  Query results are the same selection records
+/// that the OpenGL point, edge, and face painters generate, so they can be used interchangeably.
+///
+/// Only meshes for which supported() returns true can be picked.  A picker doesn't keep references to the mesh it was built from -
+/// callers pass the mesh to every query, and must use up_to_date() to check that the mesh hasn't been modified in the meantime.
+class mesh_picker
+{
+public:
+	/// Builds the hierarchies for a mesh
+	explicit mesh_picker(const mesh& Mesh);
+
+	/// Returns true iff every primitive in the mesh is a (non-SDS) polyhedron, i.e. iff the picker will return the same results as the OpenGL painters
+	static bool_t supported(const mesh& Mesh);
+	/// Returns true iff the mesh points and polyhedron topology are unchanged since the picker was built
+	bool_t up_to_date(const mesh& Mesh) const;
+
+	/// Appends a record to Records for every mesh point within the OpenGL clip volume, where ObjectToClip maps from object
+	/// coordinates to clip coordinates.  Each record contains the tokens from Prefix, followed by a POINT token.
+	void pick_points(const mesh& Mesh, const matrix4& ObjectToClip, const selection::record& Prefix, selection::records& Records) const;
+	/// Appends a record to Records for every polyhedron edge that intersects the OpenGL clip volume.  Each record contains
+	/// the tokens from Prefix, followed by PRIMITIVE and EDGE tokens.
+	void pick_edges(const mesh& Mesh, const matrix4& ObjectToClip, const selection::record& Prefix, selection::records& Records) const;
+	/// Appends a record to Records for every polyhedron face that intersects the OpenGL clip volume.  Unless Backfacing is true, faces
+	/// facing away from the viewer are ignored (InsideOut swaps front and back, for object transformations that change handedness).
+	/// Each record contains the tokens from Prefix, followed by PRIMITIVE and FACE tokens.
+	void pick_faces(const mesh& Mesh, const matrix4& ObjectToClip, const bool_t Backfacing, const bool_t InsideOut, const selection::record& Prefix, selection::records& Records) const;
+
+	/// Finds the nearest polyhedron face intersected by a ray in object coordinates, returns false if the ray doesn't intersect any face.
+	/// Distance is measured in multiples of the ray direction.
+	bool_t intersect(const mesh& Mesh, const line3& Ray, uint_t& Primitive, uint_t& Face, double_t& Distance) const;
+
+private:
+	/// Identifies a polyhedron face
+	struct component
+	{
+		uint_t primitive;
+		uint_t index;
+	};
+
+	std::vector<uint_t> m_generations;
+
+	bounding_volume_hierarchy m_points;
+	bounding_volume_hierarchy m_faces;
+	std::vector<component> m_face_components;
+	/// Stores true for each primitive that is a subdivision surface (whose faces can't be picked)
+	std::vector<bool_t> m_sds;
+};
+
+/// Returns a matrix that maps the given region of a viewport (in widget coordinates, with the origin at the upper-left corner) to the
+/// OpenGL clip volume, when pre-multiplied with a projection matrix.  This is the same matrix that gluPickMatrix() generates.
+const matrix4 pick_matrix(const rectangle& Region, const double_t ViewportWidth, const double_t ViewportHeight);
+
+} // namespace k3d
+
+#endif // !K3DSDK_MESH_PICKER_H
+
@@ -22,21 +22,46 @@
  */
 
 #include <k3dsdk/geometry.h>
+#include <k3dsdk/hints.h>
 #include <k3dsdk/mesh_simple_deformation_modifier.h>
 
 namespace k3d
 {
 
 mesh_simple_deformation_modifier::mesh_simple_deformation_modifier(iplugin_factory& Factory, idocument& Document) :
-	base(Factory, Document)
+	base(Factory, Document),
+	m_selected_points_valid(false)
 {
 	m_mesh_selection.changed_signal().connect(make_reset_mesh_slot());
+
+	m_input_mesh.changed_signal().connect(sigc::mem_fun(*this, &mesh_simple_deformation_modifier::on_invalidate_selected_points));
+	m_mesh_selection.changed_signal().connect(sigc::mem_fun(*this, &mesh_simple_deformation_modifier::on_invalidate_selected_points));
+}
+
+sigc::slot<void, ihint*> mesh_simple_deformation_modifier::make_update_mesh_slot()
+{
+	return sigc::mem_fun(*this, &mesh_simple_deformation_modifier::on_schedule_update);
 }
 
 void mesh_simple_deformation_modifier::on_create_mesh(const mesh& Input, mesh& Output)
 {
 	Output = Input;
 	geometry::selection::merge(m_mesh_selection.pipeline_value(), Output);
+
+	// Keep track of the points that can be deformed, so updates can skip the rest ...
+	m_selected_points.clear();
+	if(Output.point_selection)
+	{
+		const mesh::selection_t& point_selection = *Output.point_selection;
+		const uint_t point_begin = 0;
+		const uint_t point_end = point_selection.size();
+		for(uint_t point = point_begin; point != point_end; ++point)
+		{
+			if(point_selection[point])
+				m_selected_points.push_back(point);
+		}
+	}
+	m_selected_points_valid = true;
 }
 
 void mesh_simple_deformation_modifier::on_update_mesh(const mesh& Input, mesh& Output)
@@ -57,7 +82,35 @@ void mesh_simple_deformation_modifier::on_update_mesh(const mesh& Input, mesh& O
 	mesh::points_t& output_points = Output.points.writable();
 	document().pipeline_profiler().finish_execution(*this, "Copy points");
 
-	on_deform_mesh(input_points, selection, output_points);
+	// Unselected output points still match the input, since they were copied in on_create_mesh() and any change to the input or selection causes a reset ...
+	if(m_selected_points_valid)
+		on_deform_selected_points(input_points, selection, m_selected_points, output_points);
+	else
+		on_deform_mesh(input_points, selection, output_points);
+}
+
+void mesh_simple_deformation_modifier::on_deform_selected_points(const mesh::points_t& InputPoints, const mesh::selection_t& PointSelection, const mesh::indices_t& SelectedPoints, mesh::points_t& OutputPoints)
+{
+	on_deform_mesh(InputPoints, PointSelection, OutputPoints);
+}
+
+void mesh_simple_deformation_modifier::on_schedule_update(ihint* Hint)
+{
+	// Without an up-to-date list of selected points, downstream nodes have to assume that anything could change ...
+	if(!m_selected_points_valid)
+	{
+		m_output_mesh.update(Hint);
+		return;
+	}
+
+	hint::mesh_geometry_changed hint;
+	hint.changed_points = m_selected_points;
+	m_output_mesh.update(&hint);
+}
+
+void mesh_simple_deformation_modifier::on_invalidate_selected_points(ihint*)
+{
+	m_selected_points_valid = false;
 }
 
 } // namespace k3d
@@ -40,12 +40,28 @@ class mesh_simple_deformation_modifier :
 public:
 	mesh_simple_deformation_modifier(iplugin_factory& Factory, idocument& Document);
 
+	/// Returns a slot that will schedule an update of the output mesh, notifying downstream nodes which points will change.
+	/// Hides mesh_modifier::make_update_mesh_slot(), so derived classes get the more specific notification automatically.
+	sigc::slot<void, ihint*> make_update_mesh_slot();
+
 private:
 	void on_create_mesh(const mesh& Input, mesh& Output);
 	void on_update_mesh(const mesh& Input, mesh& Output);
 
 	/// Implement this method in derived classes and deform the output mesh using its input points and selection.
 	virtual void on_deform_mesh(const mesh::points_t& InputPoints, const mesh::selection_t& PointSelection, mesh::points_t& OutputPoints) = 0;
+	/// Optionally override this method in derived classes to deform only the given points (the points with non-zero selection weight),
+	/// instead of every point in the mesh.  The remaining output points are guaranteed to match their input positions.
+	/// The default implementation calls on_deform_mesh().
+	virtual void on_deform_selected_points(const mesh::points_t& InputPoints, const mesh::selection_t& PointSelection, const mesh::indices_t& SelectedPoints, mesh::points_t& OutputPoints);
+
+	void on_schedule_update(ihint* Hint);
+	void on_invalidate_selected_points(ihint* Hint);
+
+	/// Stores the indices of points with non-zero selection weight, which are the only points that will ever be deformed
+	mesh::indices_t m_selected_points;
+	/// Set to true when m_selected_points matches the current input and selection
+	bool_t m_selected_points_valid;
 };
 
 } // namespace k3d
@@ -29,13 +29,13 @@ namespace k3d
 ///////////////////////////////////////////////////////////////////////////
 // named_arrays
 
-const array* named_arrays::lookup(const string_t& Name) const
+const array* named_arrays::lookup(const symbol& Name) const
 {
 	const_iterator result = find(Name);
 	return result == end() ? static_cast<const array*>(0) : result->second.get();
 }
 
-array* named_arrays::writable(const string_t& Name)
+array* named_arrays::writable(const symbol& Name)
 {
 	iterator result = find(Name);
 	return result == end() ? static_cast<array*>(0) : &result->second.writable();
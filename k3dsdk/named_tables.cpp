@@ -26,13 +26,13 @@ namespace k3d
 ///////////////////////////////////////////////////////////////////////////
 // named_tables
 
-const table* named_tables::lookup(const string_t& Name) const
+const table* named_tables::lookup(const symbol& Name) const
 {
 	const_iterator result = find(Name);
 	return result == end() ? static_cast<table*>(0) : &result->second;
 }
 
-table* named_tables::writable(const string_t& Name)
+table* named_tables::writable(const symbol& Name)
 {
 	iterator result = find(Name);
 	return result == end() ? static_cast<table*>(0) : &result->second;
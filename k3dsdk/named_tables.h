@@ -28,13 +28,13 @@ namespace k3d
 /// Defines a collection of named table objects.  The length of the individual
 /// table objects may vary.
 class named_tables :
-	public std::map<string_t, table>
+	public std::map<symbol, table>
 {
 public:
 	/// Return an attribute_array by name, or NULL
-	const table* lookup(const string_t& Name) const;
+	const table* lookup(const symbol& Name) const;
 	/// Return an attribute_array by name, or NULL
-	table* writable(const string_t& Name);
+	table* writable(const symbol& Name);
 	/// Returns the difference between two collections, using the imprecise semantics of difference::test().
 	void difference(const named_tables& Other, difference::accumulator& Result) const;
 };
@@ -265,6 +265,22 @@ public:
 		return m_frames.back();
 	}
 
+	const filesystem::path add_file(const string_t& Name)
+	{
+		// Sanity checks ...
+		assert_warning(Name.size());
+
+		// Make sure the filepath is unique, and doesn't collide with a frame directory or the job's own control files ...
+		unsigned long index = 0;
+		string_t name = Name;
+		while(std::count(m_files.begin(), m_files.end(), name) || name == "control.k3d" || name == "ready" || filesystem::exists(m_Path / filesystem::generic_path(name)))
+			name = Name + '-' + string_cast(++index);
+
+		m_files.push_back(name);
+
+		return m_Path / filesystem::generic_path(name);
+	}
+
 	bool write_control_files()
 	{
 		// Create a control file for each frame ...
@@ -303,6 +319,9 @@ public:
 
 private:
 	const filesystem::path m_Path;
+	/// Stores the set of input files shared by every frame in the job
+	typedef std::vector<string_t> files_t;
+	files_t m_files;
 
 	typedef std::list<network_render_frame> frames_t;
 	frames_t m_frames;
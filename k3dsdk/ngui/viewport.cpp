@@ -40,8 +40,11 @@
 #include <k3dsdk/iscripted_action.h>
 #include <k3dsdk/iselectable.h>
 #include <k3dsdk/imatrix_source.h>
+#include <k3dsdk/imesh_source.h>
+#include <k3dsdk/irenderable_gl.h>
 #include <k3dsdk/linear_curve.h>
 #include <k3dsdk/mesh.h>
+#include <k3dsdk/mesh_picker.h>
 #include <k3dsdk/ngui/document_state.h>
 #include <k3dsdk/ngui/modifiers.h>
 #include <k3dsdk/ngui/selection.h>
@@ -65,9 +68,11 @@
 #include <gtk/gtkmain.h>
 
 #include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
 
 #include <cassert>
 #include <iomanip>
+#include <map>
 #include <sstream>
 
 using namespace k3d::selection;
@@ -397,6 +402,10 @@ public:
 	typedef std::vector<GLuint> gl_selection_buffer_t;
 	gl_selection_buffer_t m_selection_buffer;
 
+	/// Caches CPU pickers for the meshes of selected nodes, so picking mesh components doesn't require OpenGL selection
+	typedef std::map<const k3d::mesh*, boost::shared_ptr<k3d::mesh_picker> > mesh_pickers_t;
+	mesh_pickers_t m_mesh_pickers;
+
 	// Buffers parameters from the most-recent render
 	GLdouble m_gl_view_matrix[16];
 	GLdouble m_gl_projection_matrix[16];
@@ -1322,7 +1331,15 @@ const k3d::selection::records control::get_selection(const k3d::gl::selection_st
 {
 	k3d::selection::records selection;
 
-	const unsigned int hit_count = select(SelectionState, SelectionRegion, ViewMatrix, ProjectionMatrix, Viewport);
+	// If we can pick mesh components on the CPU, we only need OpenGL selection for the active tool ...
+	std::vector<std::pair<k3d::inode*, const k3d::mesh*> > meshes;
+	const k3d::bool_t pick_meshes_on_cpu = get_pickable_meshes(SelectionState, meshes);
+
+	k3d::gl::selection_state tool_selection_state(SelectionState);
+	if(pick_meshes_on_cpu)
+		tool_selection_state.select_component.clear();
+
+	const unsigned int hit_count = select(tool_selection_state, SelectionRegion, ViewMatrix, ProjectionMatrix, Viewport);
 
 	for(detail::hit_iterator hit(m_implementation->m_selection_buffer, hit_count); hit != detail::hit_iterator(); ++hit)
 	{
@@ -1341,9 +1358,112 @@ const k3d::selection::records control::get_selection(const k3d::gl::selection_st
 		selection.push_back(record);
 	}
 
+	if(pick_meshes_on_cpu)
+		pick_meshes(SelectionState, meshes, ViewMatrix, ProjectionMatrix, selection);
+
 	return selection;
 }
 
+k3d::bool_t control::get_pickable_meshes(const k3d::gl::selection_state& SelectionState, std::vector<std::pair<k3d::inode*, const k3d::mesh*> >& Meshes)
+{
+	// We only handle component selection for selected nodes ...
+	if(!SelectionState.exclude_unselected_nodes)
+		return false;
+
+	// ... and only for the component types that mesh_picker implements ...
+	for(std::set<k3d::selection::type>::const_iterator component = SelectionState.select_component.begin(); component != SelectionState.select_component.end(); ++component)
+	{
+		switch(*component)
+		{
+			case k3d::selection::POINT:
+			case k3d::selection::EDGE:
+			case k3d::selection::FACE:
+				break;
+			default:
+				return false;
+		}
+	}
+
+	// We need valid matrices from OpenGL selection ...
+	if(!m_implementation->m_camera.internal_value() || !is_realized() || !get_width() || !get_height())
+		return false;
+
+	const k3d::nodes_t nodes = selection::state(m_implementation->m_document_state.document()).selected_nodes();
+	for(k3d::nodes_t::const_iterator node = nodes.begin(); node != nodes.end(); ++node)
+	{
+		if(!dynamic_cast<k3d::gl::irenderable*>(*node))
+			continue;
+
+		if(k3d::iproperty* const visible = k3d::property::get(**node, "viewport_visible"))
+		{
+			if(!k3d::property::pipeline_value<k3d::bool_t>(*visible))
+				continue;
+		}
+
+		// Anything other than a mesh is drawn by its own OpenGL selection code ...
+		if(!dynamic_cast<k3d::imesh_source*>(*node))
+			return false;
+
+		// Meshes without painters aren't drawn at all ...
+		k3d::iproperty* const painter = k3d::property::get(**node, "gl_painter");
+		if(!painter)
+			return false;
+		if(!k3d::property::pipeline_value<k3d::inode*>(*painter))
+			continue;
+
+		const k3d::mesh* const mesh = selection::get_mesh(*node, 0);
+		if(!mesh)
+			continue;
+
+		// Every selected mesh must be pickable, or OpenGL selection has to handle all of them.  Note that primitives
+		// without points (such as quadrics) aren't supported, so they're never skipped here ...
+		if(!k3d::mesh_picker::supported(*mesh))
+			return false;
+
+		// A supported mesh without points has nothing to pick ...
+		if(!mesh->points)
+			continue;
+
+		Meshes.push_back(std::make_pair(*node, mesh));
+	}
+
+	return true;
+}
+
+void control::pick_meshes(const k3d::gl::selection_state& SelectionState, const std::vector<std::pair<k3d::inode*, const k3d::mesh*> >& Meshes, GLdouble ViewMatrix[16], GLdouble ProjectionMatrix[16], k3d::selection::records& Records)
+{
+	// Note: the projection matrix includes the pick matrix, so the OpenGL clip volume is the selection region ...
+	const k3d::matrix4 view_projection = k3d::gl::matrix(ProjectionMatrix) * k3d::gl::matrix(ViewMatrix);
+
+	implementation::mesh_pickers_t pickers;
+	for(std::vector<std::pair<k3d::inode*, const k3d::mesh*> >::const_iterator node_mesh = Meshes.begin(); node_mesh != Meshes.end(); ++node_mesh)
+	{
+		k3d::inode& node = *node_mesh->first;
+		const k3d::mesh& mesh = *node_mesh->second;
+
+		// Reuse pickers for meshes that haven't changed, discarding the rest ...
+		boost::shared_ptr<k3d::mesh_picker> picker = m_implementation->m_mesh_pickers[&mesh];
+		if(!picker || !picker->up_to_date(mesh))
+			picker.reset(new k3d::mesh_picker(mesh));
+		pickers[&mesh] = picker;
+
+		const k3d::matrix4 node_matrix = k3d::node_to_world_matrix(node);
+		const k3d::matrix4 object_to_clip = view_projection * node_matrix;
+
+		k3d::selection::record prefix = k3d::selection::make_record(&node);
+		prefix.tokens.push_back(k3d::selection::token(k3d::selection::MESH, 0));
+
+		if(SelectionState.select_component.count(k3d::selection::POINT))
+			picker->pick_points(mesh, object_to_clip, prefix, Records);
+		if(SelectionState.select_component.count(k3d::selection::EDGE))
+			picker->pick_edges(mesh, object_to_clip, prefix, Records);
+		if(SelectionState.select_component.count(k3d::selection::FACE))
+			picker->pick_faces(mesh, object_to_clip, SelectionState.select_backfacing, k3d::inside_out(node_matrix), prefix, Records);
+	}
+
+	m_implementation->m_mesh_pickers.swap(pickers);
+}
+
 bool control::on_redraw()
 {
 	// If we're minimized, we're done ...
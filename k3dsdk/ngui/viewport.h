@@ -39,6 +39,10 @@
 #include <k3dsdk/selection.h>
 #include <k3dsdk/signal_system.h>
 
+#include <utility>
+#include <vector>
+
+namespace k3d { class mesh; }
 namespace k3d { namespace gl { class selection_state;
 class context;
 } }
@@ -163,6 +167,10 @@ private:
 	const k3d::selection::records get_selection(const k3d::gl::selection_state& SelectionState, const k3d::rectangle& SelectionRegion);
 	/// Returns an OpenGL selection as a collection of records
 	const k3d::selection::records get_selection(const k3d::gl::selection_state& SelectionState, const k3d::rectangle& SelectionRegion, GLdouble ViewMatrix[16], GLdouble ProjectionMatrix[16], GLint Viewport[4]);
+	/// Returns the selected nodes and meshes whose components can be picked on the CPU, or false if OpenGL selection is required
+	k3d::bool_t get_pickable_meshes(const k3d::gl::selection_state& SelectionState, std::vector<std::pair<k3d::inode*, const k3d::mesh*> >& Meshes);
+	/// Appends component selection records for meshes to a selection, picking on the CPU
+	void pick_meshes(const k3d::gl::selection_state& SelectionState, const std::vector<std::pair<k3d::inode*, const k3d::mesh*> >& Meshes, GLdouble ViewMatrix[16], GLdouble ProjectionMatrix[16], k3d::selection::records& Records);
 
 	/// Renders the current view to disk
 	k3d::bool_t save_frame(k3d::icamera& Camera, const k3d::filesystem::path& OutputImage, const k3d::bool_t ViewCompletedImage);
@@ -29,19 +29,29 @@ namespace k3d
 namespace noise
 {
 
-//////////////////////////////////////////////////////////////////////////////
-// classic3
+namespace
+{
 
 inline int32_t fastfloor(double_t x)
 {
 	return x > 0 ? static_cast<int32_t>(x) : static_cast<int32_t>(x - 1);
 }
 
-inline double_t dot(int32_t g[], double_t x, double_t y, double_t z)
+inline double_t dot(const int32_t g[], double_t x, double_t y)
+{
+	return g[0]*x + g[1]*y;
+}
+
+inline double_t dot(const int32_t g[], double_t x, double_t y, double_t z)
 {
 	return g[0]*x + g[1]*y + g[2]*z;
 }
 
+inline double_t dot(const int32_t g[], double_t x, double_t y, double_t z, double_t w)
+{
+	return g[0]*x + g[1]*y + g[2]*z + g[3]*w;
+}
+
 inline double_t mix(double_t a, double_t b, double_t t)
 {
 	return (1-t)*a + t*b;
@@ -52,13 +62,29 @@ inline double_t fade(double_t t)
 	return t*t*t*(t*(t*6-15)+10);
 }
 
-int32_t classic3::grad3[][3] = {
-		{1,1,0}, {-1,1,0}, {1,-1,0}, {-1,-1,0},
-		{1,0,1}, {-1,0,1}, {1,0,-1}, {-1,0,-1},
-		{0,1,1}, {0,-1,1}, {0,1,-1}, {0,-1,-1}
-		};
+const int32_t grad2[][2] = {
+	{1,1}, {-1,1}, {1,-1}, {-1,-1},
+	{1,0}, {-1,0}, {0,1}, {0,-1}
+	};
+
+const int32_t grad3[][3] = {
+	{1,1,0}, {-1,1,0}, {1,-1,0}, {-1,-1,0},
+	{1,0,1}, {-1,0,1}, {1,0,-1}, {-1,0,-1},
+	{0,1,1}, {0,-1,1}, {0,1,-1}, {0,-1,-1}
+	};
+
+const int32_t grad4[][4] = {
+	{0,1,1,1}, {0,1,1,-1}, {0,1,-1,1}, {0,1,-1,-1},
+	{0,-1,1,1}, {0,-1,1,-1}, {0,-1,-1,1}, {0,-1,-1,-1},
+	{1,0,1,1}, {1,0,1,-1}, {1,0,-1,1}, {1,0,-1,-1},
+	{-1,0,1,1}, {-1,0,1,-1}, {-1,0,-1,1}, {-1,0,-1,-1},
+	{1,1,0,1}, {1,1,0,-1}, {1,-1,0,1}, {1,-1,0,-1},
+	{-1,1,0,1}, {-1,1,0,-1}, {-1,-1,0,1}, {-1,-1,0,-1},
+	{1,1,1,0}, {1,1,-1,0}, {1,-1,1,0}, {1,-1,-1,0},
+	{-1,1,1,0}, {-1,1,-1,0}, {-1,-1,1,0}, {-1,-1,-1,0}
+	};
 
-int32_t classic3::p[] = {
+const int32_t p[] = {
 	151,160,137,91,90,15,
 	131,13,201,95,96,53,194,233,7,225,140,36,103,30,69,142,8,99,37,240,21,10,23,
 	190, 6,148,247,120,234,75,0,26,197,62,94,252,219,203,117,35,11,32,57,177,33,
@@ -74,83 +100,557 @@ int32_t classic3::p[] = {
 	138,236,205,93,222,114,67,29,24,72,243,141,128,195,78,66,215,61,156,180
 	};
 
-int32_t classic3::perm[512];
+/// Returns Ken Perlin's permutation of an index, repeating every 256 entries.  Wrapping here, instead of in a doubled table that has to be
+/// filled at runtime, leaves no shared state to initialize before generators can be used from multiple threads.
+inline int32_t perm(const int32_t i)
+{
+	return p[i & 255];
+}
+
+const uint_t block_size = detail::block_size;
+
+} // namespace
+
+//////////////////////////////////////////////////////////////////////////////
+// classic2
+
+double_t classic2::operator()(double_t X, double_t Y) const
+{
+	double_t result;
+	(*this)(1, &X, &Y, &result);
+	return result;
+}
+
+void classic2::operator()(const uint_t Count, const double_t* X, const double_t* Y, double_t* Results) const
+{
+	int32_t cx[block_size], cy[block_size];
+	double_t fx[block_size], fy[block_size];
+	double_t u[block_size], v[block_size];
+
+	for(uint_t begin = 0; begin < Count; begin += block_size)
+	{
+		const uint_t count = std::min(block_size, Count - begin);
+		const double_t* const x = X + begin;
+		const double_t* const y = Y + begin;
+		double_t* const results = Results + begin;
+
+		// Find the unit grid cell containing each point, and the point's position within the cell ...
+		for(uint_t i = 0; i != count; ++i)
+		{
+			cx[i] = fastfloor(x[i]);
+			cy[i] = fastfloor(y[i]);
+			fx[i] = x[i] - cx[i];
+			fy[i] = y[i] - cy[i];
+		}
+
+		// Compute the fade curves ...
+		for(uint_t i = 0; i != count; ++i)
+		{
+			u[i] = fade(fx[i]);
+			v[i] = fade(fy[i]);
+		}
+
+		// Blend the contributions from the gradients at each corner ...
+		for(uint_t i = 0; i != count; ++i)
+		{
+			const int32_t ix = cx[i] & 255;
+			const int32_t iy = cy[i] & 255;
+
+			const double_t n00 = dot(grad2[perm(ix+perm(iy)) % 8], fx[i], fy[i]);
+			const double_t n10 = dot(grad2[perm(ix+1+perm(iy)) % 8], fx[i]-1, fy[i]);
+			const double_t n01 = dot(grad2[perm(ix+perm(iy+1)) % 8], fx[i], fy[i]-1);
+			const double_t n11 = dot(grad2[perm(ix+1+perm(iy+1)) % 8], fx[i]-1, fy[i]-1);
+
+			results[i] = mix(mix(n00, n10, u[i]), mix(n01, n11, u[i]), v[i]);
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// classic3
 
 classic3::classic3()
 {
-	static bool_t initialized = false;
-	if(!initialized)
+}
+
+double_t classic3::operator()(double_t X, double_t Y, double_t Z) const
+{
+	double_t result;
+	(*this)(1, &X, &Y, &Z, &result);
+	return result;
+}
+
+void classic3::operator()(const uint_t Count, const double_t* X, const double_t* Y, const double_t* Z, double_t* Results) const
+{
+	int32_t cx[block_size], cy[block_size], cz[block_size];
+	double_t fx[block_size], fy[block_size], fz[block_size];
+	double_t u[block_size], v[block_size], w[block_size];
+
+	for(uint_t begin = 0; begin < Count; begin += block_size)
+	{
+		const uint_t count = std::min(block_size, Count - begin);
+		const double_t* const x = X + begin;
+		const double_t* const y = Y + begin;
+		const double_t* const z = Z + begin;
+		double_t* const results = Results + begin;
+
+		// Find the unit grid cell containing each point, and the point's position within the cell ...
+		for(uint_t i = 0; i != count; ++i)
+		{
+			cx[i] = fastfloor(x[i]);
+			cy[i] = fastfloor(y[i]);
+			cz[i] = fastfloor(z[i]);
+			fx[i] = x[i] - cx[i];
+			fy[i] = y[i] - cy[i];
+			fz[i] = z[i] - cz[i];
+		}
+
+		// Compute the fade curves ...
+		for(uint_t i = 0; i != count; ++i)
+		{
+			u[i] = fade(fx[i]);
+			v[i] = fade(fy[i]);
+			w[i] = fade(fz[i]);
+		}
+
+		// Blend the contributions from the gradients at each corner ...
+		for(uint_t i = 0; i != count; ++i)
+		{
+			// Wrap the integer cells at 255 (smaller integer period can be introduced here)
+			const int32_t ix = cx[i] & 255;
+			const int32_t iy = cy[i] & 255;
+			const int32_t iz = cz[i] & 255;
+
+			// Calculate a set of eight hashed gradient indices
+			const int32_t gi000 = perm(ix+perm(iy+perm(iz))) % 12;
+			const int32_t gi001 = perm(ix+perm(iy+perm(iz+1))) % 12;
+			const int32_t gi010 = perm(ix+perm(iy+1+perm(iz))) % 12;
+			const int32_t gi011 = perm(ix+perm(iy+1+perm(iz+1))) % 12;
+			const int32_t gi100 = perm(ix+1+perm(iy+perm(iz))) % 12;
+			const int32_t gi101 = perm(ix+1+perm(iy+perm(iz+1))) % 12;
+			const int32_t gi110 = perm(ix+1+perm(iy+1+perm(iz))) % 12;
+			const int32_t gi111 = perm(ix+1+perm(iy+1+perm(iz+1))) % 12;
+
+			// Calculate noise contributions from each of the eight corners
+			const double_t n000 = dot(grad3[gi000], fx[i], fy[i], fz[i]);
+			const double_t n100 = dot(grad3[gi100], fx[i]-1, fy[i], fz[i]);
+			const double_t n010 = dot(grad3[gi010], fx[i], fy[i]-1, fz[i]);
+			const double_t n110 = dot(grad3[gi110], fx[i]-1, fy[i]-1, fz[i]);
+			const double_t n001 = dot(grad3[gi001], fx[i], fy[i], fz[i]-1);
+			const double_t n101 = dot(grad3[gi101], fx[i]-1, fy[i], fz[i]-1);
+			const double_t n011 = dot(grad3[gi011], fx[i], fy[i]-1, fz[i]-1);
+			const double_t n111 = dot(grad3[gi111], fx[i]-1, fy[i]-1, fz[i]-1);
+
+			// Interpolate along x, then y, then z
+			const double_t nx00 = mix(n000, n100, u[i]);
+			const double_t nx01 = mix(n001, n101, u[i]);
+			const double_t nx10 = mix(n010, n110, u[i]);
+			const double_t nx11 = mix(n011, n111, u[i]);
+			const double_t nxy0 = mix(nx00, nx10, v[i]);
+			const double_t nxy1 = mix(nx01, nx11, v[i]);
+			results[i] = mix(nxy0, nxy1, w[i]);
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// classic4
+
+double_t classic4::operator()(double_t X, double_t Y, double_t Z, double_t W) const
+{
+	double_t result;
+	(*this)(1, &X, &Y, &Z, &W, &result);
+	return result;
+}
+
+void classic4::operator()(const uint_t Count, const double_t* X, const double_t* Y, const double_t* Z, const double_t* W, double_t* Results) const
+{
+	int32_t cx[block_size], cy[block_size], cz[block_size], cw[block_size];
+	double_t fx[block_size], fy[block_size], fz[block_size], fw[block_size];
+	double_t u[block_size], v[block_size], s[block_size], t[block_size];
+
+	for(uint_t begin = 0; begin < Count; begin += block_size)
+	{
+		const uint_t count = std::min(block_size, Count - begin);
+		const double_t* const x = X + begin;
+		const double_t* const y = Y + begin;
+		const double_t* const z = Z + begin;
+		const double_t* const w = W + begin;
+		double_t* const results = Results + begin;
+
+		// Find the unit grid cell containing each point, and the point's position within the cell ...
+		for(uint_t i = 0; i != count; ++i)
+		{
+			cx[i] = fastfloor(x[i]);
+			cy[i] = fastfloor(y[i]);
+			cz[i] = fastfloor(z[i]);
+			cw[i] = fastfloor(w[i]);
+			fx[i] = x[i] - cx[i];
+			fy[i] = y[i] - cy[i];
+			fz[i] = z[i] - cz[i];
+			fw[i] = w[i] - cw[i];
+		}
+
+		// Compute the fade curves ...
+		for(uint_t i = 0; i != count; ++i)
+		{
+			u[i] = fade(fx[i]);
+			v[i] = fade(fy[i]);
+			s[i] = fade(fz[i]);
+			t[i] = fade(fw[i]);
+		}
+
+		// Blend the contributions from the gradients at each corner, interpolating along x, then y, then z, then w ...
+		for(uint_t i = 0; i != count; ++i)
+		{
+			const int32_t ix = cx[i] & 255;
+			const int32_t iy = cy[i] & 255;
+			const int32_t iz = cz[i] & 255;
+			const int32_t iw = cw[i] & 255;
+
+			double_t n[16];
+			for(int32_t corner = 0; corner != 16; ++corner)
+			{
+				const int32_t dx = corner & 1;
+				const int32_t dy = (corner >> 1) & 1;
+				const int32_t dz = (corner >> 2) & 1;
+				const int32_t dw = (corner >> 3) & 1;
+				const int32_t gi = perm(ix+dx+perm(iy+dy+perm(iz+dz+perm(iw+dw)))) % 32;
+				n[corner] = dot(grad4[gi], fx[i]-dx, fy[i]-dy, fz[i]-dz, fw[i]-dw);
+			}
+
+			for(int32_t j = 0; j != 8; ++j)
+				n[j] = mix(n[2*j], n[2*j+1], u[i]);
+			for(int32_t j = 0; j != 4; ++j)
+				n[j] = mix(n[2*j], n[2*j+1], v[i]);
+			for(int32_t j = 0; j != 2; ++j)
+				n[j] = mix(n[2*j], n[2*j+1], s[i]);
+
+			results[i] = mix(n[0], n[1], t[i]);
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// simplex2
+
+double_t simplex2::operator()(double_t X, double_t Y) const
+{
+	double_t result;
+	(*this)(1, &X, &Y, &result);
+	return result;
+}
+
+void simplex2::operator()(const uint_t Count, const double_t* X, const double_t* Y, double_t* Results) const
+{
+	// Skewing and unskewing factors for 2 dimensions
+	const double_t F2 = 0.5 * (std::sqrt(3.0) - 1.0);
+	const double_t G2 = (3.0 - std::sqrt(3.0)) / 6.0;
+
+	int32_t ci[block_size], cj[block_size];
+	double_t x0[block_size], y0[block_size];
+
+	for(uint_t begin = 0; begin < Count; begin += block_size)
 	{
-		initialized = true;
-		for(int32_t i = 0; i < 512; ++i)
-			perm[i] = p[i & 255];
+		const uint_t count = std::min(block_size, Count - begin);
+		const double_t* const x = X + begin;
+		const double_t* const y = Y + begin;
+		double_t* const results = Results + begin;
+
+		// Skew the input space to find the simplex cell containing each point, and the point's distance from the cell origin ...
+		for(uint_t i = 0; i != count; ++i)
+		{
+			const double_t s = (x[i] + y[i]) * F2;
+			ci[i] = fastfloor(x[i] + s);
+			cj[i] = fastfloor(y[i] + s);
+			const double_t t = (ci[i] + cj[i]) * G2;
+			x0[i] = x[i] - (ci[i] - t);
+			y0[i] = y[i] - (cj[i] - t);
+		}
+
+		// Sum the contributions from the three simplex corners ...
+		for(uint_t i = 0; i != count; ++i)
+		{
+			// Determine which triangle of the cell the point is in
+			const int32_t i1 = x0[i] > y0[i] ? 1 : 0;
+			const int32_t j1 = 1 - i1;
+
+			const double_t x1 = x0[i] - i1 + G2;
+			const double_t y1 = y0[i] - j1 + G2;
+			const double_t x2 = x0[i] - 1.0 + 2.0 * G2;
+			const double_t y2 = y0[i] - 1.0 + 2.0 * G2;
+
+			const int32_t ii = ci[i] & 255;
+			const int32_t jj = cj[i] & 255;
+
+			double_t n = 0;
+
+			double_t t0 = 0.5 - x0[i]*x0[i] - y0[i]*y0[i];
+			if(t0 > 0)
+			{
+				t0 *= t0;
+				n += t0 * t0 * dot(grad3[perm(ii+perm(jj)) % 12], x0[i], y0[i]);
+			}
+
+			double_t t1 = 0.5 - x1*x1 - y1*y1;
+			if(t1 > 0)
+			{
+				t1 *= t1;
+				n += t1 * t1 * dot(grad3[perm(ii+i1+perm(jj+j1)) % 12], x1, y1);
+			}
+
+			double_t t2 = 0.5 - x2*x2 - y2*y2;
+			if(t2 > 0)
+			{
+				t2 *= t2;
+				n += t2 * t2 * dot(grad3[perm(ii+1+perm(jj+1)) % 12], x2, y2);
+			}
+
+			results[i] = 70.0 * n;
+		}
 	}
 }
 
-double_t classic3::operator()(double_t x, double_t y, double_t z) const
-{
-	// Find unit grid cell containing point
-	int32_t X = fastfloor(x);
-	int32_t Y = fastfloor(y);
-	int32_t Z = fastfloor(z);
-
-	// Get relative xyz coordinates of point within that cell
-	x = x - X;
-	y = y - Y;
-	z = z - Z;
-
-	// Wrap the integer cells at 255 (smaller integer period can be introduced here)
-	X = X & 255;
-	Y = Y & 255;
-	Z = Z & 255;
-
-	// Calculate a set of eight hashed gradient indices
-	int32_t gi000 = perm[X+perm[Y+perm[Z]]] % 12;
-	int32_t gi001 = perm[X+perm[Y+perm[Z+1]]] % 12;
-	int32_t gi010 = perm[X+perm[Y+1+perm[Z]]] % 12;
-	int32_t gi011 = perm[X+perm[Y+1+perm[Z+1]]] % 12;
-	int32_t gi100 = perm[X+1+perm[Y+perm[Z]]] % 12;
-	int32_t gi101 = perm[X+1+perm[Y+perm[Z+1]]] % 12;
-	int32_t gi110 = perm[X+1+perm[Y+1+perm[Z]]] % 12;
-	int32_t gi111 = perm[X+1+perm[Y+1+perm[Z+1]]] % 12;
-	// The gradients of each corner are now:
-	// g000 = grad3[gi000];
-	// g001 = grad3[gi001];
-	// g010 = grad3[gi010];
-	// g011 = grad3[gi011];
-	// g100 = grad3[gi100];
-	// g101 = grad3[gi101];
-	// g110 = grad3[gi110];
-	// g111 = grad3[gi111];
-	// Calculate noise contributions from each of the eight corners
-	double_t n000= dot(grad3[gi000], x, y, z);
-	double_t n100= dot(grad3[gi100], x-1, y, z);
-	double_t n010= dot(grad3[gi010], x, y-1, z);
-	double_t n110= dot(grad3[gi110], x-1, y-1, z);
-	double_t n001= dot(grad3[gi001], x, y, z-1);
-	double_t n101= dot(grad3[gi101], x-1, y, z-1);
-	double_t n011= dot(grad3[gi011], x, y-1, z-1);
-	double_t n111= dot(grad3[gi111], x-1, y-1, z-1);
-	// Compute the fade curve value for each of x, y, z
-	double_t u = fade(x);
-	double_t v = fade(y);
-	double_t w = fade(z);
-	// Interpolate along x the contributions from each of the corners
-	double_t nx00 = mix(n000, n100, u);
-	double_t nx01 = mix(n001, n101, u);
-	double_t nx10 = mix(n010, n110, u);
-	double_t nx11 = mix(n011, n111, u);
-	// Interpolate the four results along y
-	double_t nxy0 = mix(nx00, nx10, v);
-	double_t nxy1 = mix(nx01, nx11, v);
-	// Interpolate the two last results along z
-	double_t nxyz = mix(nxy0, nxy1, w);
-
-	return nxyz;
+//////////////////////////////////////////////////////////////////////////////
+// simplex3
+
+double_t simplex3::operator()(double_t X, double_t Y, double_t Z) const
+{
+	double_t result;
+	(*this)(1, &X, &Y, &Z, &result);
+	return result;
+}
+
+void simplex3::operator()(const uint_t Count, const double_t* X, const double_t* Y, const double_t* Z, double_t* Results) const
+{
+	// Skewing and unskewing factors for 3 dimensions
+	const double_t F3 = 1.0 / 3.0;
+	const double_t G3 = 1.0 / 6.0;
+
+	int32_t ci[block_size], cj[block_size], ck[block_size];
+	double_t x0[block_size], y0[block_size], z0[block_size];
+
+	for(uint_t begin = 0; begin < Count; begin += block_size)
+	{
+		const uint_t count = std::min(block_size, Count - begin);
+		const double_t* const x = X + begin;
+		const double_t* const y = Y + begin;
+		const double_t* const z = Z + begin;
+		double_t* const results = Results + begin;
+
+		// Skew the input space to find the simplex cell containing each point, and the point's distance from the cell origin ...
+		for(uint_t i = 0; i != count; ++i)
+		{
+			const double_t s = (x[i] + y[i] + z[i]) * F3;
+			ci[i] = fastfloor(x[i] + s);
+			cj[i] = fastfloor(y[i] + s);
+			ck[i] = fastfloor(z[i] + s);
+			const double_t t = (ci[i] + cj[i] + ck[i]) * G3;
+			x0[i] = x[i] - (ci[i] - t);
+			y0[i] = y[i] - (cj[i] - t);
+			z0[i] = z[i] - (ck[i] - t);
+		}
+
+		// Sum the contributions from the four simplex corners ...
+		for(uint_t i = 0; i != count; ++i)
+		{
+			// Rank the coordinates to determine which of the six tetrahedra of the cell the point is in
+			const int32_t xy = x0[i] >= y0[i] ? 1 : 0;
+			const int32_t yz = y0[i] >= z0[i] ? 1 : 0;
+			const int32_t xz = x0[i] >= z0[i] ? 1 : 0;
+
+			const int32_t i1 = xy & xz;
+			const int32_t j1 = (1 - xy) & yz;
+			const int32_t k1 = (1 - xz) & (1 - yz);
+			const int32_t i2 = xy | xz;
+			const int32_t j2 = (1 - xy) | yz;
+			const int32_t k2 = (1 - xz) | (1 - yz);
+
+			const double_t x1 = x0[i] - i1 + G3;
+			const double_t y1 = y0[i] - j1 + G3;
+			const double_t z1 = z0[i] - k1 + G3;
+			const double_t x2 = x0[i] - i2 + 2.0 * G3;
+			const double_t y2 = y0[i] - j2 + 2.0 * G3;
+			const double_t z2 = z0[i] - k2 + 2.0 * G3;
+			const double_t x3 = x0[i] - 1.0 + 3.0 * G3;
+			const double_t y3 = y0[i] - 1.0 + 3.0 * G3;
+			const double_t z3 = z0[i] - 1.0 + 3.0 * G3;
+
+			const int32_t ii = ci[i] & 255;
+			const int32_t jj = cj[i] & 255;
+			const int32_t kk = ck[i] & 255;
+
+			double_t n = 0;
+
+			double_t t0 = 0.6 - x0[i]*x0[i] - y0[i]*y0[i] - z0[i]*z0[i];
+			if(t0 > 0)
+			{
+				t0 *= t0;
+				n += t0 * t0 * dot(grad3[perm(ii+perm(jj+perm(kk))) % 12], x0[i], y0[i], z0[i]);
+			}
+
+			double_t t1 = 0.6 - x1*x1 - y1*y1 - z1*z1;
+			if(t1 > 0)
+			{
+				t1 *= t1;
+				n += t1 * t1 * dot(grad3[perm(ii+i1+perm(jj+j1+perm(kk+k1))) % 12], x1, y1, z1);
+			}
+
+			double_t t2 = 0.6 - x2*x2 - y2*y2 - z2*z2;
+			if(t2 > 0)
+			{
+				t2 *= t2;
+				n += t2 * t2 * dot(grad3[perm(ii+i2+perm(jj+j2+perm(kk+k2))) % 12], x2, y2, z2);
+			}
+
+			double_t t3 = 0.6 - x3*x3 - y3*y3 - z3*z3;
+			if(t3 > 0)
+			{
+				t3 *= t3;
+				n += t3 * t3 * dot(grad3[perm(ii+1+perm(jj+1+perm(kk+1))) % 12], x3, y3, z3);
+			}
+
+			results[i] = 32.0 * n;
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// simplex4
+
+double_t simplex4::operator()(double_t X, double_t Y, double_t Z, double_t W) const
+{
+	double_t result;
+	(*this)(1, &X, &Y, &Z, &W, &result);
+	return result;
+}
+
+void simplex4::operator()(const uint_t Count, const double_t* X, const double_t* Y, const double_t* Z, const double_t* W, double_t* Results) const
+{
+	// Skewing and unskewing factors for 4 dimensions
+	const double_t F4 = (std::sqrt(5.0) - 1.0) / 4.0;
+	const double_t G4 = (5.0 - std::sqrt(5.0)) / 20.0;
+
+	int32_t ci[block_size], cj[block_size], ck[block_size], cl[block_size];
+	double_t x0[block_size], y0[block_size], z0[block_size], w0[block_size];
+
+	for(uint_t begin = 0; begin < Count; begin += block_size)
+	{
+		const uint_t count = std::min(block_size, Count - begin);
+		const double_t* const x = X + begin;
+		const double_t* const y = Y + begin;
+		const double_t* const z = Z + begin;
+		const double_t* const w = W + begin;
+		double_t* const results = Results + begin;
+
+		// Skew the input space to find the simplex cell containing each point, and the point's distance from the cell origin ...
+		for(uint_t i = 0; i != count; ++i)
+		{
+			const double_t s = (x[i] + y[i] + z[i] + w[i]) * F4;
+			ci[i] = fastfloor(x[i] + s);
+			cj[i] = fastfloor(y[i] + s);
+			ck[i] = fastfloor(z[i] + s);
+			cl[i] = fastfloor(w[i] + s);
+			const double_t t = (ci[i] + cj[i] + ck[i] + cl[i]) * G4;
+			x0[i] = x[i] - (ci[i] - t);
+			y0[i] = y[i] - (cj[i] - t);
+			z0[i] = z[i] - (ck[i] - t);
+			w0[i] = w[i] - (cl[i] - t);
+		}
+
+		// Sum the contributions from the five simplex corners ...
+		for(uint_t i = 0; i != count; ++i)
+		{
+			// Rank the coordinates to determine which of the 24 simplices of the cell the point is in
+			int32_t rank_x = 0;
+			int32_t rank_y = 0;
+			int32_t rank_z = 0;
+			int32_t rank_w = 0;
+			if(x0[i] > y0[i]) ++rank_x; else ++rank_y;
+			if(x0[i] > z0[i]) ++rank_x; else ++rank_z;
+			if(x0[i] > w0[i]) ++rank_x; else ++rank_w;
+			if(y0[i] > z0[i]) ++rank_y; else ++rank_z;
+			if(y0[i] > w0[i]) ++rank_y; else ++rank_w;
+			if(z0[i] > w0[i]) ++rank_z; else ++rank_w;
+
+			const int32_t i1 = rank_x >= 3 ? 1 : 0;
+			const int32_t j1 = rank_y >= 3 ? 1 : 0;
+			const int32_t k1 = rank_z >= 3 ? 1 : 0;
+			const int32_t l1 = rank_w >= 3 ? 1 : 0;
+			const int32_t i2 = rank_x >= 2 ? 1 : 0;
+			const int32_t j2 = rank_y >= 2 ? 1 : 0;
+			const int32_t k2 = rank_z >= 2 ? 1 : 0;
+			const int32_t l2 = rank_w >= 2 ? 1 : 0;
+			const int32_t i3 = rank_x >= 1 ? 1 : 0;
+			const int32_t j3 = rank_y >= 1 ? 1 : 0;
+			const int32_t k3 = rank_z >= 1 ? 1 : 0;
+			const int32_t l3 = rank_w >= 1 ? 1 : 0;
+
+			const double_t x1 = x0[i] - i1 + G4;
+			const double_t y1 = y0[i] - j1 + G4;
+			const double_t z1 = z0[i] - k1 + G4;
+			const double_t w1 = w0[i] - l1 + G4;
+			const double_t x2 = x0[i] - i2 + 2.0 * G4;
+			const double_t y2 = y0[i] - j2 + 2.0 * G4;
+			const double_t z2 = z0[i] - k2 + 2.0 * G4;
+			const double_t w2 = w0[i] - l2 + 2.0 * G4;
+			const double_t x3 = x0[i] - i3 + 3.0 * G4;
+			const double_t y3 = y0[i] - j3 + 3.0 * G4;
+			const double_t z3 = z0[i] - k3 + 3.0 * G4;
+			const double_t w3 = w0[i] - l3 + 3.0 * G4;
+			const double_t x4 = x0[i] - 1.0 + 4.0 * G4;
+			const double_t y4 = y0[i] - 1.0 + 4.0 * G4;
+			const double_t z4 = z0[i] - 1.0 + 4.0 * G4;
+			const double_t w4 = w0[i] - 1.0 + 4.0 * G4;
+
+			const int32_t ii = ci[i] & 255;
+			const int32_t jj = cj[i] & 255;
+			const int32_t kk = ck[i] & 255;
+			const int32_t ll = cl[i] & 255;
+
+			double_t n = 0;
+
+			double_t t0 = 0.6 - x0[i]*x0[i] - y0[i]*y0[i] - z0[i]*z0[i] - w0[i]*w0[i];
+			if(t0 > 0)
+			{
+				t0 *= t0;
+				n += t0 * t0 * dot(grad4[perm(ii+perm(jj+perm(kk+perm(ll)))) % 32], x0[i], y0[i], z0[i], w0[i]);
+			}
+
+			double_t t1 = 0.6 - x1*x1 - y1*y1 - z1*z1 - w1*w1;
+			if(t1 > 0)
+			{
+				t1 *= t1;
+				n += t1 * t1 * dot(grad4[perm(ii+i1+perm(jj+j1+perm(kk+k1+perm(ll+l1)))) % 32], x1, y1, z1, w1);
+			}
+
+			double_t t2 = 0.6 - x2*x2 - y2*y2 - z2*z2 - w2*w2;
+			if(t2 > 0)
+			{
+				t2 *= t2;
+				n += t2 * t2 * dot(grad4[perm(ii+i2+perm(jj+j2+perm(kk+k2+perm(ll+l2)))) % 32], x2, y2, z2, w2);
+			}
+
+			double_t t3 = 0.6 - x3*x3 - y3*y3 - z3*z3 - w3*w3;
+			if(t3 > 0)
+			{
+				t3 *= t3;
+				n += t3 * t3 * dot(grad4[perm(ii+i3+perm(jj+j3+perm(kk+k3+perm(ll+l3)))) % 32], x3, y3, z3, w3);
+			}
+
+			double_t t4 = 0.6 - x4*x4 - y4*y4 - z4*z4 - w4*w4;
+			if(t4 > 0)
+			{
+				t4 *= t4;
+				n += t4 * t4 * dot(grad4[perm(ii+1+perm(jj+1+perm(kk+1+perm(ll+1)))) % 32], x4, y4, z4, w4);
+			}
+
+			results[i] = 27.0 * n;
+		}
+	}
 }
 
 } // namespace noise
 
 } // namespace k3d
 
-
@@ -25,16 +25,36 @@
 	\author Tim Shead (tshead@k-3d.com)
 */
 
+#include <k3dsdk/parallel/blocked_range.h>
+#include <k3dsdk/parallel/parallel_for.h>
+#include <k3dsdk/parallel/threads.h>
 #include <k3dsdk/point3.h>
 #include <k3dsdk/types.h>
 #include <boost/static_assert.hpp>
 
+#include <algorithm>
+#include <cmath>
+
 namespace k3d
 {
 
 namespace noise
 {
 
+// Each generator can evaluate a single point, or a batch of points stored as separate coordinate arrays.  Batches are processed in small
+// blocks, one stage at a time, so compilers can vectorize the arithmetic; both forms return identical values for the same point.  Use sample()
+// to spread a large batch across threads.
+
+/// Noise generator that returns "classic" Perlin 2D noise in the range (-1, 1).
+class classic2
+{
+public:
+	/// Returns a noise value in the range (-1, 1) for the given point in 2-space.
+	double_t operator()(double_t X, double_t Y) const;
+	/// Stores noise values for a batch of points in 2-space.
+	void operator()(const uint_t Count, const double_t* X, const double_t* Y, double_t* Results) const;
+};
+
 /// Noise generator that returns "classic" Perlin 3D noise in the range (-1, 1).
 class classic3
 {
@@ -43,13 +63,302 @@ public:
 
 	/// Returns a noise value in the range (-1, 1) for the given point in 3-space.
 	double_t operator()(double_t X, double_t Y, double_t Z) const;
+	/// Stores noise values for a batch of points in 3-space.
+	void operator()(const uint_t Count, const double_t* X, const double_t* Y, const double_t* Z, double_t* Results) const;
+};
+
+/// Noise generator that returns "classic" Perlin 4D noise in the range (-1, 1).
+class classic4
+{
+public:
+	/// Returns a noise value in the range (-1, 1) for the given point in 4-space.
+	double_t operator()(double_t X, double_t Y, double_t Z, double_t W) const;
+	/// Stores noise values for a batch of points in 4-space.
+	void operator()(const uint_t Count, const double_t* X, const double_t* Y, const double_t* Z, const double_t* W, double_t* Results) const;
+};
+
+/// Noise generator that returns Perlin simplex 2D noise in the range (-1, 1).
+class simplex2
+{
+public:
+	/// Returns a noise value in the range (-1, 1) for the given point in 2-space.
+	double_t operator()(double_t X, double_t Y) const;
+	/// Stores noise values for a batch of points in 2-space.
+	void operator()(const uint_t Count, const double_t* X, const double_t* Y, double_t* Results) const;
+};
+
+/// Noise generator that returns Perlin simplex 3D noise in the range (-1, 1).
+class simplex3
+{
+public:
+	/// Returns a noise value in the range (-1, 1) for the given point in 3-space.
+	double_t operator()(double_t X, double_t Y, double_t Z) const;
+	/// Stores noise values for a batch of points in 3-space.
+	void operator()(const uint_t Count, const double_t* X, const double_t* Y, const double_t* Z, double_t* Results) const;
+};
+
+/// Noise generator that returns Perlin simplex 4D noise in the range (-1, 1).
+class simplex4
+{
+public:
+	/// Returns a noise value in the range (-1, 1) for the given point in 4-space.
+	double_t operator()(double_t X, double_t Y, double_t Z, double_t W) const;
+	/// Stores noise values for a batch of points in 4-space.
+	void operator()(const uint_t Count, const double_t* X, const double_t* Y, const double_t* Z, const double_t* W, double_t* Results) const;
+};
+
+namespace detail
+{
+
+/// Number of points processed together by the batch functions
+const uint_t block_size = 64;
+
+/// Selects the batch form of a generator with the given number of dimensions
+template<uint_t Dimensions>
+struct dimensions
+{
+};
+
+template<typename GeneratorT>
+inline void evaluate(const GeneratorT& Generator, dimensions<2>, const uint_t Count, const double_t* const* Coordinates, double_t* Results)
+{
+	Generator(Count, Coordinates[0], Coordinates[1], Results);
+}
+
+template<typename GeneratorT>
+inline void evaluate(const GeneratorT& Generator, dimensions<3>, const uint_t Count, const double_t* const* Coordinates, double_t* Results)
+{
+	Generator(Count, Coordinates[0], Coordinates[1], Coordinates[2], Results);
+}
+
+template<typename GeneratorT>
+inline void evaluate(const GeneratorT& Generator, dimensions<4>, const uint_t Count, const double_t* const* Coordinates, double_t* Results)
+{
+	Generator(Count, Coordinates[0], Coordinates[1], Coordinates[2], Coordinates[3], Results);
+}
+
+/// Sums octaves of a generator for a batch of points, scaling each octave by Lacunarity in frequency and Gain in amplitude.  If Absolute is true,
+/// sums the absolute value of each octave instead.
+template<uint_t Dimensions, typename GeneratorT>
+void octaves(const GeneratorT& Generator, const uint_t Octaves, const double_t Lacunarity, const double_t Gain, const bool_t Absolute, const uint_t Count, const double_t* const* Coordinates, double_t* Results)
+{
+	double_t scaled[Dimensions][block_size];
+	const double_t* scaled_coordinates[Dimensions];
+	for(uint_t d = 0; d != Dimensions; ++d)
+		scaled_coordinates[d] = scaled[d];
+
+	double_t octave[block_size];
+
+	for(uint_t begin = 0; begin < Count; begin += block_size)
+	{
+		const uint_t count = std::min(block_size, Count - begin);
+		double_t* const results = Results + begin;
+		std::fill(results, results + count, 0.0);
+
+		double_t frequency = 1.0;
+		double_t amplitude = 1.0;
+		for(uint_t o = 0; o != Octaves; ++o)
+		{
+			for(uint_t d = 0; d != Dimensions; ++d)
+			{
+				const double_t* const coordinates = Coordinates[d] + begin;
+				for(uint_t i = 0; i != count; ++i)
+					scaled[d][i] = coordinates[i] * frequency;
+			}
+
+			evaluate(Generator, dimensions<Dimensions>(), count, scaled_coordinates, octave);
+
+			if(Absolute)
+			{
+				for(uint_t i = 0; i != count; ++i)
+					results[i] += amplitude * std::abs(octave[i]);
+			}
+			else
+			{
+				for(uint_t i = 0; i != count; ++i)
+					results[i] += amplitude * octave[i];
+			}
+
+			frequency *= Lacunarity;
+			amplitude *= Gain;
+		}
+	}
+}
+
+/// Evaluates ranges of a batch in parallel
+template<uint_t Dimensions, typename GeneratorT>
+class sample_worker
+{
+public:
+	sample_worker(const GeneratorT& Generator, const double_t* const* Coordinates, double_t* Results) :
+		m_generator(Generator),
+		m_coordinates(Coordinates),
+		m_results(Results)
+	{
+	}
+
+	void operator()(const parallel::blocked_range<uint_t>& Range) const
+	{
+		const double_t* coordinates[Dimensions];
+		for(uint_t d = 0; d != Dimensions; ++d)
+			coordinates[d] = m_coordinates[d] + Range.begin();
+
+		evaluate(m_generator, dimensions<Dimensions>(), Range.end() - Range.begin(), coordinates, m_results + Range.begin());
+	}
+
+private:
+	const GeneratorT& m_generator;
+	const double_t* const* m_coordinates;
+	double_t* m_results;
+};
+
+} // namespace detail
+
+/// Noise generator that sums octaves of another generator ("fractional Brownian motion"), for use wherever the underlying generator can be used.
+template<typename GeneratorT>
+class fbm
+{
+public:
+	fbm(const uint_t Octaves = 6, const double_t Lacunarity = 2.0, const double_t Gain = 0.5, const GeneratorT& Generator = GeneratorT()) :
+		m_generator(Generator),
+		m_octaves(Octaves),
+		m_lacunarity(Lacunarity),
+		m_gain(Gain)
+	{
+	}
+
+	double_t operator()(double_t X, double_t Y) const
+	{
+		double_t result;
+		(*this)(1, &X, &Y, &result);
+		return result;
+	}
+
+	double_t operator()(double_t X, double_t Y, double_t Z) const
+	{
+		double_t result;
+		(*this)(1, &X, &Y, &Z, &result);
+		return result;
+	}
+
+	double_t operator()(double_t X, double_t Y, double_t Z, double_t W) const
+	{
+		double_t result;
+		(*this)(1, &X, &Y, &Z, &W, &result);
+		return result;
+	}
+
+	void operator()(const uint_t Count, const double_t* X, const double_t* Y, double_t* Results) const
+	{
+		const double_t* const coordinates[] = { X, Y };
+		detail::octaves<2>(m_generator, m_octaves, m_lacunarity, m_gain, false, Count, coordinates, Results);
+	}
+
+	void operator()(const uint_t Count, const double_t* X, const double_t* Y, const double_t* Z, double_t* Results) const
+	{
+		const double_t* const coordinates[] = { X, Y, Z };
+		detail::octaves<3>(m_generator, m_octaves, m_lacunarity, m_gain, false, Count, coordinates, Results);
+	}
+
+	void operator()(const uint_t Count, const double_t* X, const double_t* Y, const double_t* Z, const double_t* W, double_t* Results) const
+	{
+		const double_t* const coordinates[] = { X, Y, Z, W };
+		detail::octaves<4>(m_generator, m_octaves, m_lacunarity, m_gain, false, Count, coordinates, Results);
+	}
+
+private:
+	GeneratorT m_generator;
+	uint_t m_octaves;
+	double_t m_lacunarity;
+	double_t m_gain;
+};
+
+/// Noise generator that sums the absolute value of octaves of another generator ("turbulence"), for use wherever the underlying generator can be used.
+template<typename GeneratorT>
+class turbulence
+{
+public:
+	turbulence(const uint_t Octaves = 6, const double_t Lacunarity = 2.0, const double_t Gain = 0.5, const GeneratorT& Generator = GeneratorT()) :
+		m_generator(Generator),
+		m_octaves(Octaves),
+		m_lacunarity(Lacunarity),
+		m_gain(Gain)
+	{
+	}
+
+	double_t operator()(double_t X, double_t Y) const
+	{
+		double_t result;
+		(*this)(1, &X, &Y, &result);
+		return result;
+	}
+
+	double_t operator()(double_t X, double_t Y, double_t Z) const
+	{
+		double_t result;
+		(*this)(1, &X, &Y, &Z, &result);
+		return result;
+	}
+
+	double_t operator()(double_t X, double_t Y, double_t Z, double_t W) const
+	{
+		double_t result;
+		(*this)(1, &X, &Y, &Z, &W, &result);
+		return result;
+	}
+
+	void operator()(const uint_t Count, const double_t* X, const double_t* Y, double_t* Results) const
+	{
+		const double_t* const coordinates[] = { X, Y };
+		detail::octaves<2>(m_generator, m_octaves, m_lacunarity, m_gain, true, Count, coordinates, Results);
+	}
+
+	void operator()(const uint_t Count, const double_t* X, const double_t* Y, const double_t* Z, double_t* Results) const
+	{
+		const double_t* const coordinates[] = { X, Y, Z };
+		detail::octaves<3>(m_generator, m_octaves, m_lacunarity, m_gain, true, Count, coordinates, Results);
+	}
+
+	void operator()(const uint_t Count, const double_t* X, const double_t* Y, const double_t* Z, const double_t* W, double_t* Results) const
+	{
+		const double_t* const coordinates[] = { X, Y, Z, W };
+		detail::octaves<4>(m_generator, m_octaves, m_lacunarity, m_gain, true, Count, coordinates, Results);
+	}
 
 private:
-	static int32_t grad3[][3];
-	static int32_t p[];
-	static int32_t perm[512];
+	GeneratorT m_generator;
+	uint_t m_octaves;
+	double_t m_lacunarity;
+	double_t m_gain;
 };
 
+/// Stores noise values for a batch of points in 2-space, split across threads.  Every point is evaluated independently, so the results don't
+/// depend on the number of threads.
+template<typename GeneratorT>
+void sample(const GeneratorT& Generator, const uint_t Count, const double_t* X, const double_t* Y, double_t* Results)
+{
+	const double_t* const coordinates[] = { X, Y };
+	parallel::parallel_for(parallel::blocked_range<uint_t>(0, Count, std::max(detail::block_size, parallel::grain_size())), detail::sample_worker<2, GeneratorT>(Generator, coordinates, Results));
+}
+
+/// Stores noise values for a batch of points in 3-space, split across threads.  Every point is evaluated independently, so the results don't
+/// depend on the number of threads.
+template<typename GeneratorT>
+void sample(const GeneratorT& Generator, const uint_t Count, const double_t* X, const double_t* Y, const double_t* Z, double_t* Results)
+{
+	const double_t* const coordinates[] = { X, Y, Z };
+	parallel::parallel_for(parallel::blocked_range<uint_t>(0, Count, std::max(detail::block_size, parallel::grain_size())), detail::sample_worker<3, GeneratorT>(Generator, coordinates, Results));
+}
+
+/// Stores noise values for a batch of points in 4-space, split across threads.  Every point is evaluated independently, so the results don't
+/// depend on the number of threads.
+template<typename GeneratorT>
+void sample(const GeneratorT& Generator, const uint_t Count, const double_t* X, const double_t* Y, const double_t* Z, const double_t* W, double_t* Results)
+{
+	const double_t* const coordinates[] = { X, Y, Z, W };
+	parallel::parallel_for(parallel::blocked_range<uint_t>(0, Count, std::max(detail::block_size, parallel::grain_size())), detail::sample_worker<4, GeneratorT>(Generator, coordinates, Results));
+}
+
 /// Helper function that maps 3D noise to 3D objects including point3, vector3, normal3, and texture3.
 template<typename ValueT, typename GeneratorT>
 const ValueT map3(const GeneratorT& Generator, double_t X, double_t Y, double_t Z)
@@ -161,7 +161,9 @@ const_primitive* validate(const mesh& Mesh, const mesh::primitive& Primitive)
 
 	try
 	{
-		require_valid_primitive(Mesh, Primitive);
+		const bool_t cached = valid_primitive_cached(Mesh, Primitive);
+		if(!cached)
+			require_valid_primitive(Mesh, Primitive);
 
 		const mesh::table_t& constant_structure = require_structure(Primitive, "constant");
 		const mesh::table_t& curve_structure = require_structure(Primitive, "curve");
@@ -186,12 +188,18 @@ const_primitive* validate(const mesh& Mesh, const mesh::primitive& Primitive)
 		require_metadata(Primitive, curve_selections, "curve_selections", metadata::key::role(), metadata::value::selection_role());
 		require_metadata(Primitive, curve_points, "curve_points", metadata::key::domain(), metadata::value::point_indices_domain());
 
-		require_table_row_count(Primitive, vertex_structure, "vertex", std::accumulate(curve_point_counts.begin(), curve_point_counts.end(), 0));
-		require_table_row_count(Primitive, knot_structure, "knots",
-			std::accumulate(curve_point_counts.begin(), curve_point_counts.end(), 0)
-			+ std::accumulate(curve_orders.begin(), curve_orders.end(), 0));
+		if(!cached)
+		{
+			require_table_row_count(Primitive, vertex_structure, "vertex", std::accumulate(curve_point_counts.begin(), curve_point_counts.end(), 0));
+			require_table_row_count(Primitive, knot_structure, "knots",
+				std::accumulate(curve_point_counts.begin(), curve_point_counts.end(), 0)
+				+ std::accumulate(curve_orders.begin(), curve_orders.end(), 0));
+		}
 		require_table_row_count(Primitive, parameter_attributes, "parameter", curve_structure.row_count() * 2);
 
+		if(!cached)
+			cache_valid_primitive(Mesh, Primitive);
+
 		return new const_primitive(material, curve_first_points, curve_point_counts, curve_orders, curve_first_knots, curve_selections, curve_points,curve_point_weights, curve_knots, constant_attributes, curve_attributes, parameter_attributes, vertex_attributes);
 	}
 	catch(std::exception& e)
@@ -275,7 +275,9 @@ const_primitive* validate(const mesh& Mesh, const mesh::primitive& Primitive)
 
 	try
 	{
-		require_valid_primitive(Mesh, Primitive);
+		const bool_t cached = valid_primitive_cached(Mesh, Primitive);
+		if(!cached)
+			require_valid_primitive(Mesh, Primitive);
 
 		const mesh::table_t& patch_structure = require_structure(Primitive, "patch");
 		const mesh::table_t& vertex_structure = require_structure(Primitive, "vertex");
@@ -324,14 +326,20 @@ const_primitive* validate(const mesh& Mesh, const mesh::primitive& Primitive)
 		require_metadata(Primitive, patch_selections, "patch_selections", metadata::key::role(), metadata::value::selection_role());
 		require_metadata(Primitive, patch_points, "patch_points", metadata::key::domain(), metadata::value::point_indices_domain());
 
-		require_table_row_count(Primitive, u_knot_structure, "u_knot",
-			std::accumulate(patch_u_point_counts.begin(), patch_u_point_counts.end(), 0)
-			+ std::accumulate(patch_u_orders.begin(), patch_u_orders.end(), 0));
-		require_table_row_count(Primitive, v_knot_structure, "v_knot",
-			std::accumulate(patch_v_point_counts.begin(), patch_v_point_counts.end(), 0)
-			+ std::accumulate(patch_v_orders.begin(), patch_v_orders.end(), 0));
+		if(!cached)
+		{
+			require_table_row_count(Primitive, u_knot_structure, "u_knot",
+				std::accumulate(patch_u_point_counts.begin(), patch_u_point_counts.end(), 0)
+				+ std::accumulate(patch_u_orders.begin(), patch_u_orders.end(), 0));
+			require_table_row_count(Primitive, v_knot_structure, "v_knot",
+				std::accumulate(patch_v_point_counts.begin(), patch_v_point_counts.end(), 0)
+				+ std::accumulate(patch_v_orders.begin(), patch_v_orders.end(), 0));
+		}
 		require_table_row_count(Primitive, parameter_attributes, "parameter", patch_structure.row_count() * 4);
 
+		if(!cached)
+			cache_valid_primitive(Mesh, Primitive);
+
 	return new const_primitive(
 		patch_first_points,
 		patch_u_point_counts,
@@ -120,7 +120,9 @@ const_primitive* validate(const mesh& Mesh, const mesh::primitive& Primitive)
 
 	try
 	{
-		require_valid_primitive(Mesh, Primitive);
+		const bool_t cached = valid_primitive_cached(Mesh, Primitive);
+		if(!cached)
+			require_valid_primitive(Mesh, Primitive);
 
 		const mesh::table_t& surface_structure = require_structure(Primitive, "surface");
 
@@ -140,6 +142,9 @@ const_primitive* validate(const mesh& Mesh, const mesh::primitive& Primitive)
 
 		require_table_row_count(Primitive, parameter_attributes, "parameter", surface_structure.row_count() * 4);
 
+		if(!cached)
+			cache_valid_primitive(Mesh, Primitive);
+
 		return new const_primitive(matrices, materials, radii, z_min, z_max, sweep_angles, selections, constant_attributes, surface_attributes, parameter_attributes);
 	}
 	catch(std::exception& e)
@@ -0,0 +1,187 @@
+#ifndef K3DSDK_PARALLEL_REDUCTION_TREE_H
+#define K3DSDK_PARALLEL_REDUCTION_TREE_H
+
+// K-3D
+// Copyright (c) 1995-2010, Timothy M. Shead
+//
+// Contact: tshead@k-3d.com
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+/** \file
+	\author Tim Shead (tshead@k-3d.com)
+*/
+
+#include <k3dsdk/parallel/blocked_range.h>
+#include <k3dsdk/parallel/parallel_for.h>
+
+#include <boost/shared_ptr.hpp>
+
+#include <vector>
+
+namespace k3d
+{
+
+namespace parallel
+{
+
+namespace detail
+{
+
+/// Stores one node of a reduction_tree
+template<typename ValueT>
+struct reduction_node
+{
+	typedef boost::shared_ptr<const ValueT> value_ptr;
+
+	/// The operands this node was computed from (right is empty for the odd operand at the end of a tree level, which is passed-through unchanged)
+	value_ptr left;
+	value_ptr right;
+	value_ptr result;
+};
+
+/// Computes a set of independent reduction_tree nodes
+template<typename ValueT, typename OperationT>
+class reduction_worker
+{
+public:
+	reduction_worker(std::vector<reduction_node<ValueT> >& Nodes, const std::vector<uint_t>& Stale, const OperationT& Operation) :
+		m_nodes(Nodes),
+		m_stale(Stale),
+		m_operation(Operation)
+	{
+	}
+
+	void operator()(const blocked_range<uint_t>& Range) const
+	{
+		for(uint_t i = Range.begin(); i != Range.end(); ++i)
+		{
+			reduction_node<ValueT>& node = m_nodes[m_stale[i]];
+			node.result = m_operation(*node.left, *node.right);
+		}
+	}
+
+private:
+	std::vector<reduction_node<ValueT> >& m_nodes;
+	const std::vector<uint_t>& m_stale;
+	const OperationT& m_operation;
+};
+
+} // namespace detail
+
+/// Reduces a sequence of operands using an associative binary operation, combining them pairwise as a balanced binary tree:
+/// reducing a, b, c, d, e computes ((a.b).(c.d)).e.  Intermediate results are kept between calls to reduce(), so when an operand
+/// changes only the log2(N) nodes on its path to the root are recomputed, and nodes on the same level of the tree are computed in parallel.
+///
+/// Operands and results are compared by identity, not value, so callers must supply a new object whenever an operand changes.
+/// The operation must be safe to call concurrently with distinct operands, and return a new result object for each call:
+///
+/// \code
+/// struct concatenate
+/// {
+///   boost::shared_ptr<const string_t> operator()(const string_t& A, const string_t& B) const
+///   {
+///     return boost::shared_ptr<const string_t>(new string_t(A + B));
+///   }
+/// };
+/// \endcode
+template<typename ValueT>
+class reduction_tree
+{
+public:
+	typedef boost::shared_ptr<const ValueT> value_ptr;
+
+	reduction_tree() :
+		m_operation_count(0)
+	{
+	}
+
+	/// Returns the reduction of a sequence of operands, which is empty if there are no operands
+	template<typename OperationT>
+	const value_ptr reduce(const std::vector<value_ptr>& Operands, const OperationT& Operation)
+	{
+		m_operation_count = 0;
+
+		if(Operands.empty())
+		{
+			m_levels.clear();
+			return value_ptr();
+		}
+
+		std::vector<value_ptr> inputs(Operands);
+		uint_t level = 0;
+		for(; inputs.size() > 1; ++level)
+		{
+			if(m_levels.size() <= level)
+				m_levels.resize(level + 1);
+
+			std::vector<detail::reduction_node<ValueT> >& nodes = m_levels[level];
+			nodes.resize((inputs.size() + 1) / 2);
+
+			// Identify nodes whose operands have changed ...
+			std::vector<uint_t> stale;
+			for(uint_t i = 0; i != nodes.size(); ++i)
+			{
+				detail::reduction_node<ValueT>& node = nodes[i];
+				const value_ptr& left = inputs[2 * i];
+				const value_ptr right = 2 * i + 1 < inputs.size() ? inputs[2 * i + 1] : value_ptr();
+
+				if(node.result && node.left == left && node.right == right)
+					continue;
+
+				node.left = left;
+				node.right = right;
+				node.result = right ? value_ptr() : left;
+
+				if(right)
+					stale.push_back(i);
+			}
+
+			// Recompute them in parallel ...
+			parallel_for(blocked_range<uint_t>(0, stale.size(), 1), detail::reduction_worker<ValueT, OperationT>(nodes, stale, Operation));
+			m_operation_count += stale.size();
+
+			inputs.resize(nodes.size());
+			for(uint_t i = 0; i != nodes.size(); ++i)
+				inputs[i] = nodes[i].result;
+		}
+
+		m_levels.resize(level);
+		return inputs.front();
+	}
+
+	/// Returns the number of times the operation was called by the most recent call to reduce()
+	uint_t operation_count() const
+	{
+		return m_operation_count;
+	}
+
+	/// Discards all intermediate results
+	void clear()
+	{
+		m_levels.clear();
+	}
+
+private:
+	std::vector<std::vector<detail::reduction_node<ValueT> > > m_levels;
+	uint_t m_operation_count;
+};
+
+} // namespace parallel
+
+} // namespace k3d
+
+#endif // !K3DSDK_PARALLEL_REDUCTION_TREE_H
+
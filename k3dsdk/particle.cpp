@@ -90,7 +90,9 @@ const_primitive* validate(const mesh& Mesh, const mesh::primitive& Primitive)
 
 	try
 	{
-		require_valid_primitive(Mesh, Primitive);
+		const bool_t cached = valid_primitive_cached(Mesh, Primitive);
+		if(!cached)
+			require_valid_primitive(Mesh, Primitive);
 
 		const table& constant_structure = require_structure(Primitive, "constant");
 		const table& vertex_structure = require_structure(Primitive, "vertex");
@@ -105,6 +107,9 @@ const_primitive* validate(const mesh& Mesh, const mesh::primitive& Primitive)
 
 		require_table_row_count(Primitive, vertex_attributes, "vertex", vertex_structure.row_count());
 
+		if(!cached)
+			cache_valid_primitive(Mesh, Primitive);
+
 		return new const_primitive(material, points, constant_attributes, vertex_attributes);
 	}
 	catch(std::exception& e)
@@ -48,6 +48,18 @@ public:
 	}
 };
 
+/// Called by pipeline_data::writable() whenever it hands-out a mutable reference to existing data.  Overload this
+/// (in the namespace of your type) for types that need to know when they may be about to be modified.
+inline void pipeline_data_writable(const void*)
+{
+}
+
+/// Called by pipeline_data whenever existing data becomes shared by more than one pipeline_data instance.  Overload this
+/// (in the namespace of your type) for types that need to know when they can no longer be legitimately modified in-place.
+inline void pipeline_data_shared(const void*)
+{
+}
+
 template<typename T>
 class pipeline_data
 {
@@ -64,6 +76,8 @@ public:
 		storage(Other.storage),
 		originator(false)
 	{
+		if(storage)
+			pipeline_data_shared(storage.get());
 	}
 
 	pipeline_data(T* Other) :
@@ -119,7 +133,10 @@ public:
 	T& writable()
 	{
 		if(originator)
+		{
+			pipeline_data_writable(storage.get());
 			return *storage;
+		}
 
 		storage.reset(pipeline_data_traits<T>::clone(*storage));
 		originator = true;
@@ -135,6 +152,8 @@ public:
 	{
 		storage = Other.storage;
 		originator = false;
+		if(storage)
+			pipeline_data_shared(storage.get());
 		return *this;
 	}
 
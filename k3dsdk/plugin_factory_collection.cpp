@@ -21,6 +21,7 @@
 	\author Tim Shead (tshead@k-3d.com)
 */
 
+#include <k3d-version-config.h>
 #include <k3dsdk/fstream.h>
 #include <k3dsdk/iapplication_plugin_factory.h>
 #include <k3dsdk/idocument_plugin_factory.h>
@@ -30,6 +31,8 @@
 #include <k3d-i18n-config.h>
 #include <k3dsdk/log.h>
 #include <k3dsdk/os_load_module.h>
+#include <k3dsdk/parallel/blocked_range.h>
+#include <k3dsdk/parallel/parallel_for.h>
 #include <k3dsdk/plugin_factory_collection.h>
 #include <k3dsdk/result.h>
 #include <k3dsdk/string_cast.h>
@@ -38,6 +41,7 @@
 #include <k3dsdk/type_registry.h>
 #include <k3dsdk/xml.h>
 
+#include <cstring>
 #include <iostream>
 
 namespace k3d
@@ -372,133 +376,586 @@ private:
 	const iplugin_factory::metadata_t m_metadata;
 };
 
-} // namespace detail
+/////////////////////////////////////////////////////////////////////////////
+// proxy_record
+
+/// Stores the description of one proxied plugin factory, as read from a module proxy file
+struct proxy_record
+{
+	proxy_record() :
+		quality(iplugin_factory::EXPERIMENTAL)
+	{
+	}
+
+	std::string name;
+	uuid factory_id;
+	std::string short_description;
+	iplugin_factory::quality_t quality;
+	std::string type;
+	iplugin_factory::categories_t categories;
+	std::vector<std::string> interfaces;
+	iplugin_factory::metadata_t metadata;
+};
 
 /////////////////////////////////////////////////////////////////////////////
-// plugin_factory_collection::implementation
+// module_record
 
-struct plugin_factory_collection::implementation
+/// Stores the contents of one module proxy file, along with the timestamps and sizes used to decide whether it is stale
+struct module_record
 {
-	bool proxy_module(const filesystem::path& Path, const filesystem::path& ProxyPath)
+	module_record() :
+		module_modified(0),
+		proxy_modified(0),
+		module_size(0),
+		proxy_size(0),
+		valid(false)
 	{
-		m_message_signal.emit(string_cast(boost::format(_("Proxying plugin module %1%")) % Path.native_utf8_string().raw()));
+	}
 
-		try
-		{
-			filesystem::ifstream proxy_stream(ProxyPath);
-			xml::element xml_document;
-			proxy_stream >> xml_document;
+	filesystem::path module;
+	filesystem::path proxy;
+	time_t module_modified;
+	time_t proxy_modified;
+	/// Modification times only have one-second resolution, so sizes are compared too
+	uint64_t module_size;
+	uint64_t proxy_size;
+	/// Set to true iff the proxy was parsed successfully
+	bool_t valid;
+	std::vector<proxy_record> plugins;
+	/// Stores problems found while parsing the proxy, to be logged by the caller
+	std::vector<std::string> warnings;
+};
 
-			if(xml_document.name != "k3dml")
-				throw std::runtime_error("Not a k3dml document");
+/// Converts the text of a proxy quality attribute, returning false for unknown values.  Unlike operator>>, this doesn't log.
+bool_t parse_quality(const std::string& Text, iplugin_factory::quality_t& Quality)
+{
+	if(Text == "stable")
+		Quality = iplugin_factory::STABLE;
+	else if(Text == "experimental")
+		Quality = iplugin_factory::EXPERIMENTAL;
+	else if(Text == "deprecated")
+		Quality = iplugin_factory::DEPRECATED;
+	else
+		return false;
 
-			xml::element* const xml_module = xml::find_element(xml_document, "module");
-			if(!xml_module)
-				throw std::runtime_error("Missing <module> tag");
+	return true;
+}
 
-			xml::element* const xml_plugins = xml::find_element(*xml_module, "plugins");
-			if(!xml_plugins)
-				throw std::runtime_error("Missing <plugins> tag");
+/// Parses a module proxy file.  This doesn't emit signals or touch the type registry, and problems with the proxy contents are
+/// returned in Warnings instead of being logged.  The only logging comes from the XML parser, and k3d::log() is thread-safe, so
+/// this may be called concurrently.
+bool_t parse_proxy(const filesystem::path& ProxyPath, std::vector<proxy_record>& Plugins, std::vector<std::string>& Warnings)
+{
+	try
+	{
+		filesystem::ifstream proxy_stream(ProxyPath);
+		xml::element xml_document;
+		proxy_stream >> xml_document;
 
-			for(xml::element::elements_t::iterator xml_plugin = xml_plugins->children.begin(); xml_plugin != xml_plugins->children.end(); ++xml_plugin)
-			{
-				if(xml_plugin->name != "plugin")
-					continue;
+		if(xml_document.name != "k3dml")
+			throw std::runtime_error("Not a k3dml document");
 
-				const std::string factory_name = xml::attribute_text(*xml_plugin, "name");
-				m_message_signal.emit(string_cast(boost::format(_("Proxying plugin %1%")) % factory_name));
+		xml::element* const xml_module = xml::find_element(xml_document, "module");
+		if(!xml_module)
+			throw std::runtime_error("Missing <module> tag");
 
-				const uuid plugin_factory_id = xml::attribute_value<uuid>(*xml_plugin, "factory_id", uuid::null());
-				if(plugin_factory_id == uuid::null())
-				{
-					log() << error << "Plugin " << factory_name << " with missing factory ID will not be loaded" << std::endl;
-					continue;
-				}
+		xml::element* const xml_plugins = xml::find_element(*xml_module, "plugins");
+		if(!xml_plugins)
+			throw std::runtime_error("Missing <plugins> tag");
 
-				// Ensure we don't have any duplicate factory IDs ...
-				if(std::count_if(m_factories.begin(), m_factories.end(), detail::same_factory_id(plugin_factory_id)))
-				{
-					log() << error << "Plugin " << factory_name << " with duplicate factory ID " << plugin_factory_id << " will not be loaded" << std::endl;
-					continue;
-				}
+		for(xml::element::elements_t::iterator xml_plugin = xml_plugins->children.begin(); xml_plugin != xml_plugins->children.end(); ++xml_plugin)
+		{
+			if(xml_plugin->name != "plugin")
+				continue;
 
-				// Warn if we have duplicate names ...
-				if(std::count_if(m_factories.begin(), m_factories.end(), detail::same_name(factory_name)))
-				{
-					log() << error << "Plugin factory [" << plugin_factory_id << "] with duplicate name [" << factory_name << "] will not be loaded." << std::endl;
-					continue;
-				}
+			Plugins.push_back(proxy_record());
+			proxy_record& plugin = Plugins.back();
 
-				const std::string plugin_short_description = xml::element_text(*xml_plugin, "short_description");
-				const iplugin_factory::quality_t plugin_quality = xml::attribute_value<iplugin_factory::quality_t>(*xml_plugin, "quality", iplugin_factory::EXPERIMENTAL);
-				const std::string plugin_type = xml::attribute_text(*xml_plugin, "type");
+			plugin.name = xml::attribute_text(*xml_plugin, "name");
+			plugin.factory_id = xml::attribute_value<uuid>(*xml_plugin, "factory_id", uuid::null());
+			plugin.short_description = xml::element_text(*xml_plugin, "short_description");
+			const std::string quality = xml::attribute_text(*xml_plugin, "quality");
+			if(!quality.empty() && !parse_quality(quality, plugin.quality))
+				Warnings.push_back("Plugin " + plugin.name + " has unknown quality [" + quality + "]");
+			plugin.type = xml::attribute_text(*xml_plugin, "type");
 
-				iplugin_factory::categories_t plugin_categories;
-				if(xml::element* const xml_categories = xml::find_element(*xml_plugin, "categories"))
+			if(xml::element* const xml_categories = xml::find_element(*xml_plugin, "categories"))
+			{
+				for(xml::element::elements_t::iterator xml_category = xml_categories->children.begin(); xml_category != xml_categories->children.end(); ++xml_category)
 				{
-					for(xml::element::elements_t::iterator xml_category = xml_categories->children.begin(); xml_category != xml_categories->children.end(); ++xml_category)
-					{
-						if(xml_category->name != "category")
-							continue;
+					if(xml_category->name != "category")
+						continue;
 
-						plugin_categories.push_back(xml_category->text);
-					}
+					plugin.categories.push_back(xml_category->text);
 				}
+			}
 
-				iplugin_factory::interfaces_t plugin_interfaces;
-				if(xml::element* const xml_interfaces = xml::find_element(*xml_plugin, "interfaces"))
+			if(xml::element* const xml_interfaces = xml::find_element(*xml_plugin, "interfaces"))
+			{
+				for(xml::element::elements_t::iterator xml_interface = xml_interfaces->children.begin(); xml_interface != xml_interfaces->children.end(); ++xml_interface)
 				{
-					for(xml::element::elements_t::iterator xml_interface = xml_interfaces->children.begin(); xml_interface != xml_interfaces->children.end(); ++xml_interface)
-					{
-						if(xml_interface->name != "interface")
-							continue;
+					if(xml_interface->name != "interface")
+						continue;
 
-						plugin_interfaces.push_back(type_id(xml_interface->text));
-					}
+					plugin.interfaces.push_back(xml_interface->text);
 				}
-				plugin_interfaces.erase(std::find(plugin_interfaces.begin(), plugin_interfaces.end(), static_cast<std::type_info*>(0)), plugin_interfaces.end());
+			}
 
-				iplugin_factory::metadata_t metadata;
-				if(xml::element* const xml_metadata = xml::find_element(*xml_plugin, "metadata"))
+			if(xml::element* const xml_metadata = xml::find_element(*xml_plugin, "metadata"))
+			{
+				for(xml::element::elements_t::iterator xml_pair = xml_metadata->children.begin(); xml_pair != xml_metadata->children.end(); ++xml_pair)
 				{
-					for(xml::element::elements_t::iterator xml_pair = xml_metadata->children.begin(); xml_pair != xml_metadata->children.end(); ++xml_pair)
-					{
-						if(xml_pair->name != "pair")
-							continue;
+					if(xml_pair->name != "pair")
+						continue;
 
-						metadata.insert(std::make_pair(xml::attribute_text(*xml_pair, "name"), xml::attribute_text(*xml_pair, "value")));
-					}
+					plugin.metadata.insert(std::make_pair(xml::attribute_text(*xml_pair, "name"), xml::attribute_text(*xml_pair, "value")));
 				}
+			}
+		}
 
-				if(plugin_type == "application")
-				{
-					m_factories.insert(new detail::application_plugin_factory_proxy(plugin_factory_id, factory_name, plugin_short_description, plugin_categories, plugin_quality, plugin_interfaces, metadata));
-				}
-				else if(plugin_type == "document")
-				{
-					m_factories.insert(new detail::document_plugin_factory_proxy(plugin_factory_id, factory_name, plugin_short_description, plugin_categories, plugin_quality, plugin_interfaces, metadata));
-				}
-				else
-				{
-					log() << error << "Unknown plugin factory type " << plugin_type << " will be ignored" << std::endl;
-					continue;
-				}
+		return true;
+	}
+	catch(std::exception& e)
+	{
+		Plugins.clear();
+		return false;
+	}
+
+	return false;
+}
+
+/// Parses a range of module proxy files in parallel
+class parse_proxy_worker
+{
+public:
+	parse_proxy_worker(std::vector<module_record>& Records) :
+		m_records(Records)
+	{
+	}
+
+	void operator()(const parallel::blocked_range<uint_t>& Range) const
+	{
+		for(uint_t i = Range.begin(); i != Range.end(); ++i)
+			m_records[i].valid = parse_proxy(m_records[i].proxy, m_records[i].plugins, m_records[i].warnings);
+	}
+
+private:
+	std::vector<module_record>& m_records;
+};
+
+/////////////////////////////////////////////////////////////////////////////
+// plugin registry files
+
+/// Names the file that caches the proxies for every module in a plugin directory
+const char* const registry_file_name = "plugins.registry";
+/// Identifies a plugin registry file, and the version of its layout
+const char* const registry_magic = "K-3D plugin registry 2";
+/// Detects registry files written on a machine with different byte-order
+const uint32_t registry_byte_order = 0x01020304;
 
-				detail::proxied_modules[plugin_factory_id] = Path;
-				detail::proxied_factories[plugin_factory_id] = 0;
+/// Serializes plugin registry data to a buffer, in native byte-order
+class registry_writer
+{
+public:
+	registry_writer(std::string& Buffer) :
+		m_buffer(Buffer)
+	{
+	}
+
+	void write(const uint32_t Value)
+	{
+		m_buffer.append(reinterpret_cast<const char*>(&Value), sizeof(Value));
+	}
+
+	void write(const int64_t Value)
+	{
+		m_buffer.append(reinterpret_cast<const char*>(&Value), sizeof(Value));
+	}
+
+	void write(const uint64_t Value)
+	{
+		m_buffer.append(reinterpret_cast<const char*>(&Value), sizeof(Value));
+	}
+
+	void write(const std::string& Value)
+	{
+		write(static_cast<uint32_t>(Value.size()));
+		m_buffer.append(Value);
+	}
+
+	void write(const uuid& Value)
+	{
+		m_buffer.append(reinterpret_cast<const char*>(Value.begin()), Value.size());
+	}
+
+private:
+	std::string& m_buffer;
+};
+
+/// Deserializes plugin registry data from a buffer, failing (instead of reading out-of-bounds) if the buffer is truncated
+class registry_reader
+{
+public:
+	registry_reader(const std::string& Buffer) :
+		m_buffer(Buffer),
+		m_position(0)
+	{
+	}
+
+	bool_t read(uint32_t& Value)
+	{
+		return read_bytes(&Value, sizeof(Value));
+	}
+
+	bool_t read(int64_t& Value)
+	{
+		return read_bytes(&Value, sizeof(Value));
+	}
+
+	bool_t read(uint64_t& Value)
+	{
+		return read_bytes(&Value, sizeof(Value));
+	}
+
+	bool_t read(std::string& Value)
+	{
+		uint32_t size = 0;
+		if(!read(size) || size > m_buffer.size() - m_position)
+			return false;
+
+		Value.assign(m_buffer, m_position, size);
+		m_position += size;
+		return true;
+	}
+
+	bool_t read(uuid& Value)
+	{
+		return read_bytes(Value.begin(), Value.size());
+	}
+
+private:
+	bool_t read_bytes(void* const Value, const uint_t Size)
+	{
+		if(Size > m_buffer.size() - m_position)
+			return false;
+
+		std::memcpy(Value, m_buffer.data() + m_position, Size);
+		m_position += Size;
+		return true;
+	}
+
+	const std::string& m_buffer;
+	uint_t m_position;
+};
+
+/// Reads the cached proxies for a plugin directory.  Returns true iff the registry exists and matches the given modules,
+/// in which case the cached plugins are copied into Records.
+bool_t read_registry(const filesystem::path& RegistryPath, std::vector<module_record>& Records)
+{
+	if(!filesystem::exists(RegistryPath))
+		return false;
+
+	// Read the entire registry with a single request, instead of one round-trip per proxy file ...
+	std::string buffer;
+	{
+		filesystem::ifstream stream(RegistryPath);
+		stream.seekg(0, std::ios::end);
+		const std::streamoff size = stream.tellg();
+		if(size <= 0)
+			return false;
+		buffer.resize(size);
+		stream.seekg(0, std::ios::beg);
+		if(!stream.read(&buffer[0], size))
+			return false;
+	}
+
+	registry_reader reader(buffer);
+
+	std::string magic;
+	std::string version;
+	uint32_t byte_order = 0;
+	uint32_t module_count = 0;
+	if(!reader.read(magic) || magic != registry_magic)
+		return false;
+	if(!reader.read(byte_order) || byte_order != registry_byte_order)
+		return false;
+	if(!reader.read(version) || version != K3D_VERSION)
+		return false;
+	if(!reader.read(module_count) || module_count != Records.size())
+		return false;
+
+	std::vector<module_record> records(Records);
+	for(uint_t i = 0; i != records.size(); ++i)
+	{
+		module_record& record = records[i];
+
+		std::string module_name;
+		int64_t module_modified = 0;
+		int64_t proxy_modified = 0;
+		uint64_t module_size = 0;
+		uint64_t proxy_size = 0;
+		uint32_t valid = 0;
+		uint32_t warning_count = 0;
+		uint32_t plugin_count = 0;
+		if(!reader.read(module_name) || !reader.read(module_modified) || !reader.read(proxy_modified) || !reader.read(module_size) || !reader.read(proxy_size))
+			return false;
+
+		// The registry is stale if modules have been added, removed, or rebuilt ...
+		if(module_name != record.module.leaf().raw() || module_modified != record.module_modified || proxy_modified != record.proxy_modified)
+			return false;
+
+		// ... including within the one-second resolution of a modification time ...
+		if(module_size != record.module_size || proxy_size != record.proxy_size)
+			return false;
+
+		if(!reader.read(valid) || !reader.read(warning_count))
+			return false;
+		record.valid = valid;
+
+		record.warnings.resize(warning_count);
+		for(uint_t j = 0; j != record.warnings.size(); ++j)
+		{
+			if(!reader.read(record.warnings[j]))
+				return false;
+		}
+
+		if(!reader.read(plugin_count))
+			return false;
+		record.plugins.resize(plugin_count);
+		for(uint_t j = 0; j != record.plugins.size(); ++j)
+		{
+			proxy_record& plugin = record.plugins[j];
+
+			uint32_t quality = 0;
+			uint32_t category_count = 0;
+			uint32_t interface_count = 0;
+			uint32_t metadata_count = 0;
+			if(!reader.read(plugin.name) || !reader.read(plugin.factory_id) || !reader.read(plugin.short_description) || !reader.read(quality) || !reader.read(plugin.type))
+				return false;
+			plugin.quality = static_cast<iplugin_factory::quality_t>(quality);
+
+			if(!reader.read(category_count))
+				return false;
+			plugin.categories.resize(category_count);
+			for(uint_t k = 0; k != plugin.categories.size(); ++k)
+			{
+				if(!reader.read(plugin.categories[k]))
+					return false;
 			}
 
-			return true;
+			if(!reader.read(interface_count))
+				return false;
+			plugin.interfaces.resize(interface_count);
+			for(uint_t k = 0; k != plugin.interfaces.size(); ++k)
+			{
+				if(!reader.read(plugin.interfaces[k]))
+					return false;
+			}
+
+			if(!reader.read(metadata_count))
+				return false;
+			for(uint_t k = 0; k != metadata_count; ++k)
+			{
+				std::string name;
+				std::string value;
+				if(!reader.read(name) || !reader.read(value))
+					return false;
+				plugin.metadata.insert(std::make_pair(name, value));
+			}
+		}
+	}
+
+	Records.swap(records);
+	return true;
+}
+
+/// Writes the proxies for a plugin directory to its registry.  The registry is written to a temporary file then renamed,
+/// so concurrent processes never see a partially-written registry.  Returns false if the directory isn't writable.
+bool_t write_registry(const filesystem::path& RegistryPath, const std::vector<module_record>& Records)
+{
+	std::string buffer;
+	registry_writer writer(buffer);
+
+	writer.write(std::string(registry_magic));
+	writer.write(registry_byte_order);
+	writer.write(std::string(K3D_VERSION));
+	writer.write(static_cast<uint32_t>(Records.size()));
+
+	for(std::vector<module_record>::const_iterator record = Records.begin(); record != Records.end(); ++record)
+	{
+		writer.write(record->module.leaf().raw());
+		writer.write(static_cast<int64_t>(record->module_modified));
+		writer.write(static_cast<int64_t>(record->proxy_modified));
+		writer.write(record->module_size);
+		writer.write(record->proxy_size);
+		writer.write(static_cast<uint32_t>(record->valid));
+
+		writer.write(static_cast<uint32_t>(record->warnings.size()));
+		for(std::vector<std::string>::const_iterator warning = record->warnings.begin(); warning != record->warnings.end(); ++warning)
+			writer.write(*warning);
+
+		writer.write(static_cast<uint32_t>(record->plugins.size()));
+
+		for(std::vector<proxy_record>::const_iterator plugin = record->plugins.begin(); plugin != record->plugins.end(); ++plugin)
+		{
+			writer.write(plugin->name);
+			writer.write(plugin->factory_id);
+			writer.write(plugin->short_description);
+			writer.write(static_cast<uint32_t>(plugin->quality));
+			writer.write(plugin->type);
+
+			writer.write(static_cast<uint32_t>(plugin->categories.size()));
+			for(iplugin_factory::categories_t::const_iterator category = plugin->categories.begin(); category != plugin->categories.end(); ++category)
+				writer.write(*category);
+
+			writer.write(static_cast<uint32_t>(plugin->interfaces.size()));
+			for(std::vector<std::string>::const_iterator iface = plugin->interfaces.begin(); iface != plugin->interfaces.end(); ++iface)
+				writer.write(*iface);
+
+			writer.write(static_cast<uint32_t>(plugin->metadata.size()));
+			for(iplugin_factory::metadata_t::const_iterator pair = plugin->metadata.begin(); pair != plugin->metadata.end(); ++pair)
+			{
+				writer.write(pair->first);
+				writer.write(pair->second);
+			}
 		}
-		catch(std::exception& e)
+	}
+
+	const filesystem::path temp_path = RegistryPath + ("." + string_cast(uuid::random()));
+	{
+		filesystem::ofstream stream(temp_path);
+		if(!stream)
+			return false;
+		stream.write(buffer.data(), buffer.size());
+		if(!stream)
 		{
-			log() << error << "Error proxying plugin module " << ProxyPath.native_console_string() << std::endl;
+			stream.close();
+			filesystem::remove(temp_path);
 			return false;
 		}
+	}
 
+	if(!filesystem::rename(temp_path, RegistryPath))
+	{
+		filesystem::remove(temp_path);
 		return false;
 	}
 
+	return true;
+}
+
+} // namespace detail
+
+/////////////////////////////////////////////////////////////////////////////
+// plugin_factory_collection::implementation
+
+struct plugin_factory_collection::implementation
+{
+	bool proxy_module(const filesystem::path& Path, const filesystem::path& ProxyPath)
+	{
+		std::vector<detail::proxy_record> plugins;
+		std::vector<std::string> warnings;
+		const bool_t valid = detail::parse_proxy(ProxyPath, plugins, warnings);
+
+		for(std::vector<std::string>::const_iterator message = warnings.begin(); message != warnings.end(); ++message)
+			log() << warning << *message << " in " << ProxyPath.native_console_string() << std::endl;
+
+		if(!valid)
+		{
+			log() << error << "Error proxying plugin module " << ProxyPath.native_console_string() << std::endl;
+			return false;
+		}
+
+		register_proxies(Path, plugins);
+		return true;
+	}
+
+	/// Creates proxy factories for the plugins in a module
+	void register_proxies(const filesystem::path& Path, const std::vector<detail::proxy_record>& Plugins)
+	{
+		m_message_signal.emit(string_cast(boost::format(_("Proxying plugin module %1%")) % Path.native_utf8_string().raw()));
+
+		for(std::vector<detail::proxy_record>::const_iterator plugin = Plugins.begin(); plugin != Plugins.end(); ++plugin)
+		{
+			const std::string& factory_name = plugin->name;
+			m_message_signal.emit(string_cast(boost::format(_("Proxying plugin %1%")) % factory_name));
+
+			const uuid& plugin_factory_id = plugin->factory_id;
+			if(plugin_factory_id == uuid::null())
+			{
+				log() << error << "Plugin " << factory_name << " with missing factory ID will not be loaded" << std::endl;
+				continue;
+			}
+
+			// Ensure we don't have any duplicate factory IDs ...
+			if(std::count_if(m_factories.begin(), m_factories.end(), detail::same_factory_id(plugin_factory_id)))
+			{
+				log() << error << "Plugin " << factory_name << " with duplicate factory ID " << plugin_factory_id << " will not be loaded" << std::endl;
+				continue;
+			}
+
+			// Warn if we have duplicate names ...
+			if(std::count_if(m_factories.begin(), m_factories.end(), detail::same_name(factory_name)))
+			{
+				log() << error << "Plugin factory [" << plugin_factory_id << "] with duplicate name [" << factory_name << "] will not be loaded." << std::endl;
+				continue;
+			}
+
+			iplugin_factory::interfaces_t plugin_interfaces;
+			for(std::vector<std::string>::const_iterator iface = plugin->interfaces.begin(); iface != plugin->interfaces.end(); ++iface)
+				plugin_interfaces.push_back(type_id(*iface));
+			plugin_interfaces.erase(std::find(plugin_interfaces.begin(), plugin_interfaces.end(), static_cast<std::type_info*>(0)), plugin_interfaces.end());
+
+			if(plugin->type == "application")
+			{
+				m_factories.insert(new detail::application_plugin_factory_proxy(plugin_factory_id, factory_name, plugin->short_description, plugin->categories, plugin->quality, plugin_interfaces, plugin->metadata));
+			}
+			else if(plugin->type == "document")
+			{
+				m_factories.insert(new detail::document_plugin_factory_proxy(plugin_factory_id, factory_name, plugin->short_description, plugin->categories, plugin->quality, plugin_interfaces, plugin->metadata));
+			}
+			else
+			{
+				log() << error << "Unknown plugin factory type " << plugin->type << " will be ignored" << std::endl;
+				continue;
+			}
+
+			detail::proxied_modules[plugin_factory_id] = Path;
+			detail::proxied_factories[plugin_factory_id] = 0;
+		}
+	}
+
+	/// Returns the proxies for every proxied module in a directory, reading them from the directory's registry if it is
+	/// up-to-date, or parsing them in parallel and (if possible) rewriting the registry if it isn't.
+	void proxy_modules(const filesystem::path& Directory, std::vector<detail::module_record>& Records)
+	{
+		if(Records.empty())
+			return;
+
+		const filesystem::path registry_path = Directory / filesystem::generic_path(detail::registry_file_name);
+		if(!detail::read_registry(registry_path, Records))
+		{
+			m_message_signal.emit(string_cast(boost::format(_("Updating plugin registry %1%")) % registry_path.native_utf8_string().raw()));
+
+			parallel::parallel_for(
+				parallel::blocked_range<uint_t>(0, Records.size(), 1),
+				detail::parse_proxy_worker(Records));
+
+			if(!detail::write_registry(registry_path, Records))
+				log() << info << "Couldn't update plugin registry " << registry_path.native_console_string() << std::endl;
+		}
+
+		// Report problems the same way whether the proxies were parsed or cached ...
+		for(std::vector<detail::module_record>::const_iterator record = Records.begin(); record != Records.end(); ++record)
+		{
+			for(std::vector<std::string>::const_iterator message = record->warnings.begin(); message != record->warnings.end(); ++message)
+				log() << warning << *message << " in " << record->proxy.native_console_string() << std::endl;
+
+			if(!record->valid)
+				log() << error << "Error proxying plugin module " << record->proxy.native_console_string() << std::endl;
+		}
+	}
+
 	/// Stores a signal that will be emitted to display loading progress
 	detail::message_signal_t m_message_signal;
 	/// Stores the set of available plugin factories
@@ -570,11 +1027,52 @@ void plugin_factory_collection::load_modules(const filesystem::path& Path, const
 		files.push_back(*path);
 	std::sort(files.begin(), files.end());
 
-	// Load modules
+	// Get the proxies for every module that has one, all at once ...
+	std::vector<detail::module_record> records;
+	if(LoadProxies == LOAD_PROXIES)
+	{
+		for(std::vector<filesystem::path>::const_iterator file = files.begin(); file != files.end(); ++file)
+		{
+			if(filesystem::extension(*file).lowercase().raw() != ".module")
+				continue;
+
+			detail::module_record record;
+			record.module = *file;
+			record.proxy = *file + ".proxy";
+			if(!system::file_modification_time(record.proxy, record.proxy_modified))
+				continue;
+			if(!system::file_modification_time(record.module, record.module_modified))
+				continue;
+			if(!system::file_size(record.proxy, record.proxy_size))
+				continue;
+			if(!system::file_size(record.module, record.module_size))
+				continue;
+
+			records.push_back(record);
+		}
+
+		m_implementation->proxy_modules(Path, records);
+	}
+
+	// Load modules, in the same order whether they're proxied or not
+	std::vector<detail::module_record>::const_iterator record = records.begin();
 	for(std::vector<filesystem::path>::const_iterator file = files.begin(); file != files.end(); ++file)
 	{
-		if(!filesystem::is_directory(*file))
-			load_module(*file, LoadProxies);
+		if(filesystem::is_directory(*file))
+			continue;
+
+		if(record != records.end() && record->module == *file)
+		{
+			const bool_t valid = record->valid;
+			if(valid)
+				m_implementation->register_proxies(record->module, record->plugins);
+			++record;
+
+			if(valid)
+				continue;
+		}
+
+		load_module(*file, IGNORE_PROXIES);
 	}
 
 	// Optionally descend recursively into subdirectories ...
@@ -60,7 +60,9 @@ public:
 	void bind_module(const std::string& ModuleName, register_plugins_entry_point RegisterPlugins);
 	/// Loads a single plugin module
 	void load_module(const filesystem::path& Path, const load_proxy_t LoadProxies);
-	/// Loads plugin modules from a directory, optionally descending recursively into subdirectories
+	/// Loads plugin modules from a directory, optionally descending recursively into subdirectories.  When loading proxies,
+	/// the proxies for every module in a directory are cached in a "plugins.registry" file, which is rebuilt whenever a module
+	/// or proxy is added, removed, or modified.
 	void load_modules(const filesystem::path& Path, const bool Recursive, const load_proxy_t LoadProxies);
 	/// Loads plugin modules from zero-to-many directories, optionally descending recursively into each directory
 	void load_modules(const std::string& Paths, const bool Recursive, const load_proxy_t LoadProxies);
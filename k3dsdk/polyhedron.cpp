@@ -22,6 +22,7 @@
 	\author Bart Janssens (bart.janssens@lid.kviv.be)
 */
 
+#include <k3dsdk/derived_points.h>
 #include <k3dsdk/table_copier.h>
 #include <k3dsdk/metadata_keys.h>
 #include <k3dsdk/parallel/blocked_range.h>
@@ -34,9 +35,14 @@
 #include <k3dsdk/triangulator.h>
 
 #include <boost/scoped_ptr.hpp>
+#include <boost/weak_ptr.hpp>
+
+#include <glibmm/thread.h>
 
 #include <functional>
 #include <iterator>
+#include <limits>
+#include <map>
 #include <numeric>
 #include <sstream>
 #include <stdexcept>
@@ -47,6 +53,257 @@ namespace k3d
 namespace polyhedron
 {
 
+namespace detail
+{
+
+/// Interned structure, attribute, and array names, so create() and validate() don't look them up on every call
+struct names_t
+{
+	names_t() :
+		shell_table("shell"),
+		face_table("face"),
+		loop_table("loop"),
+		edge_table("edge"),
+		vertex_table("vertex"),
+		constant_table("constant"),
+		shell_types("shell_types"),
+		face_shells("face_shells"),
+		face_first_loops("face_first_loops"),
+		face_loop_counts("face_loop_counts"),
+		face_selections("face_selections"),
+		face_materials("face_materials"),
+		loop_first_edges("loop_first_edges"),
+		clockwise_edges("clockwise_edges"),
+		edge_selections("edge_selections"),
+		vertex_points("vertex_points"),
+		vertex_selections("vertex_selections")
+	{
+	}
+
+	const symbol shell_table;
+	const symbol face_table;
+	const symbol loop_table;
+	const symbol edge_table;
+	const symbol vertex_table;
+	const symbol constant_table;
+	const symbol shell_types;
+	const symbol face_shells;
+	const symbol face_first_loops;
+	const symbol face_loop_counts;
+	const symbol face_selections;
+	const symbol face_materials;
+	const symbol loop_first_edges;
+	const symbol clockwise_edges;
+	const symbol edge_selections;
+	const symbol vertex_points;
+	const symbol vertex_selections;
+};
+
+static const names_t& names()
+{
+	static const names_t result;
+	return result;
+}
+
+/// Returns a topology array stored using either k3d::uint_t or compact 32-bit indices, throws an exception otherwise
+const array& require_index_array(const mesh::primitive& Primitive, const mesh::table_t& Table, const symbol& Name)
+{
+	const array* const result = Table.lookup(Name);
+	if(!dynamic_cast<const mesh::indices_t*>(result) && !dynamic_cast<const mesh::compact_indices_t*>(result))
+		throw std::runtime_error("[" + Primitive.type + "] primitive missing array [" + Name.str() + "]");
+
+	return *result;
+}
+
+/// Returns the sum of a counts array
+template<typename CountsT>
+uint_t sum(const CountsT& Counts)
+{
+	return std::accumulate(Counts.begin(), Counts.end(), uint_t(0));
+}
+
+/// Returns the sum of a counts array stored using either index width
+uint_t sum(const array& Counts)
+{
+	if(const mesh::compact_indices_t* const compact = dynamic_cast<const mesh::compact_indices_t*>(&Counts))
+		return sum(*compact);
+
+	return sum(dynamic_cast<const mesh::indices_t&>(Counts));
+}
+
+/// Returns true iff every face refers to an existing shell
+template<typename FaceShellsT>
+bool_t check_face_shells(const FaceShellsT& FaceShells, const uint_t ShellCount)
+{
+	const uint_t face_begin = 0;
+	const uint_t face_end = face_begin + FaceShells.size();
+	for(uint_t face = face_begin; face != face_end; ++face)
+	{
+		if(FaceShells[face] >= ShellCount)
+		{
+			log() << error << "face shell out-of-bounds for face " << face << ": " << FaceShells[face] << " >= " << ShellCount << std::endl;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/// Returns true iff every face refers to an existing shell, for face shells stored using either index width
+bool_t check_face_shells(const array& FaceShells, const uint_t ShellCount)
+{
+	if(const mesh::compact_indices_t* const compact = dynamic_cast<const mesh::compact_indices_t*>(&FaceShells))
+		return check_face_shells(*compact, ShellCount);
+
+	return check_face_shells(dynamic_cast<const mesh::indices_t&>(FaceShells), ShellCount);
+}
+
+/// Returns true iff every loop is a closed cycle of in-bounds edges
+template<typename LoopFirstEdgesT, typename ClockwiseEdgesT>
+bool_t check_edge_loops(const LoopFirstEdgesT& LoopFirstEdges, const ClockwiseEdgesT& ClockwiseEdges)
+{
+	const uint_t loop_begin = 0;
+	const uint_t loop_end = loop_begin + LoopFirstEdges.size();
+
+	const uint_t edge_begin = 0;
+	const uint_t edge_end = edge_begin + ClockwiseEdges.size();
+
+	for(uint_t loop = loop_begin; loop != loop_end; ++loop)
+	{
+		const uint_t first_edge = LoopFirstEdges[loop];
+		if(first_edge >= edge_end)
+		{
+			log() << error << "loop first edge index out-of-bounds for loop " << loop << std::endl;
+			return false;
+		}
+
+		uint_t edge_slow = first_edge;
+		uint_t edge_fast = first_edge;
+		uint_t cycle_count = 0;
+		while(true)
+		{
+			edge_slow = ClockwiseEdges[edge_slow];
+			if(edge_slow >= edge_end)
+			{
+				log() << error << "clockwise edge index out-of-bounds for edge " << edge_slow << std::endl;
+				return false;
+			}
+
+			edge_fast = ClockwiseEdges[edge_fast];
+			if(edge_fast >= edge_end)
+			{
+				log() << error << "clockwise edge index out-of-bounds for edge " << edge_fast << std::endl;
+				return false;
+			}
+			edge_fast = ClockwiseEdges[edge_fast];
+			if(edge_fast >= edge_end)
+			{
+				log() << error << "clockwise edge index out-of-bounds for edge " << edge_fast << std::endl;
+				return false;
+			}
+
+			if(edge_slow == edge_fast)
+				++cycle_count;
+
+			if(cycle_count > 2)
+			{
+				log() << error << "infinite loop at loop index " << loop << std::endl;
+				return false;
+			}
+
+			if(edge_slow == first_edge)
+				break;
+		}
+	}
+
+	return true;
+}
+
+/// Returns true iff every loop is a closed cycle of in-bounds edges, for clockwise edges stored using either index width
+template<typename LoopFirstEdgesT>
+bool_t check_edge_loops(const LoopFirstEdgesT& LoopFirstEdges, const array& ClockwiseEdges)
+{
+	if(const mesh::compact_indices_t* const compact = dynamic_cast<const mesh::compact_indices_t*>(&ClockwiseEdges))
+		return check_edge_loops(LoopFirstEdges, *compact);
+
+	return check_edge_loops(LoopFirstEdges, dynamic_cast<const mesh::indices_t&>(ClockwiseEdges));
+}
+
+/// Returns true iff every loop is a closed cycle of in-bounds edges, for loops and edges stored using either index width
+bool_t check_edge_loops(const array& LoopFirstEdges, const array& ClockwiseEdges)
+{
+	if(const mesh::compact_indices_t* const compact = dynamic_cast<const mesh::compact_indices_t*>(&LoopFirstEdges))
+		return check_edge_loops(*compact, ClockwiseEdges);
+
+	return check_edge_loops(dynamic_cast<const mesh::indices_t&>(LoopFirstEdges), ClockwiseEdges);
+}
+
+/// Caches k3d::uint_t copies of frozen compact arrays by generation, so consumers holding validated primitives at the same time (painters
+/// drawing the same mesh, for instance) share one copy instead of each widening their own.  Entries only hold weak references, and
+/// expire along with the last primitive using them, so an array that is validated again later is widened again.
+static std::map<uint_t, boost::weak_ptr<const mesh::indices_t> > expanded_cache;
+
+/// Creates the expanded array cache mutex.  Glib mutexes constructed before Glib::thread_init() don't lock, so this can't be done during static initialization.
+static Glib::Mutex* create_expanded_cache_mutex()
+{
+	if(!Glib::thread_supported())
+		Glib::thread_init();
+
+	return new Glib::Mutex();
+}
+
+/// Serializes access to the expanded array cache, since primitives may be validated concurrently
+static Glib::Mutex& expanded_cache_mutex()
+{
+	static Glib::Mutex* const mutex = create_expanded_cache_mutex();
+	return *mutex;
+}
+
+/// Returns a topology array as k3d::uint_t indices, widening compact arrays into a copy that is kept alive by Expanded
+const mesh::indices_t& require_indices(const array& Indices, std::vector<boost::shared_ptr<const mesh::indices_t> >& Expanded)
+{
+	const mesh::compact_indices_t* const compact = dynamic_cast<const mesh::compact_indices_t*>(&Indices);
+	if(!compact)
+		return dynamic_cast<const mesh::indices_t&>(Indices);
+
+	boost::shared_ptr<const mesh::indices_t> result;
+	if(compact->frozen())
+	{
+		Glib::Mutex::Lock lock(expanded_cache_mutex());
+		std::map<uint_t, boost::weak_ptr<const mesh::indices_t> >::iterator cached = expanded_cache.find(compact->generation());
+		if(cached != expanded_cache.end())
+			result = cached->second.lock();
+	}
+
+	if(!result)
+	{
+		mesh::indices_t* const expanded = new mesh::indices_t(compact->begin(), compact->end());
+		expanded->set_metadata(compact->get_metadata());
+		result.reset(expanded);
+
+		if(compact->frozen())
+		{
+			Glib::Mutex::Lock lock(expanded_cache_mutex());
+			if(expanded_cache.size() > 1024)
+			{
+				for(std::map<uint_t, boost::weak_ptr<const mesh::indices_t> >::iterator entry = expanded_cache.begin(); entry != expanded_cache.end(); )
+				{
+					if(entry->second.expired())
+						expanded_cache.erase(entry++);
+					else
+						++entry;
+				}
+			}
+			expanded_cache[compact->generation()] = result;
+		}
+	}
+
+	Expanded.push_back(result);
+	return *result;
+}
+
+} // namespace detail
+
 /////////////////////////////////////////////////////////////////////////////////////////////
 // const_primitive
 
@@ -147,26 +404,28 @@ primitive::primitive(
 
 primitive* create(mesh::primitive& GenericPrimitive)
 {
+	const detail::names_t& names = detail::names();
+
 	GenericPrimitive.type = "polyhedron";
 	GenericPrimitive.structure.clear();
 	GenericPrimitive.attributes.clear();
 
 	primitive* const result = new primitive(
-		GenericPrimitive.structure["shell"].create<typed_array<int32_t> >("shell_types"),
-		GenericPrimitive.structure["face"].create<mesh::indices_t>("face_shells"),
-		GenericPrimitive.structure["face"].create<mesh::indices_t>("face_first_loops"),
-		GenericPrimitive.structure["face"].create<mesh::counts_t>("face_loop_counts"),
-		GenericPrimitive.structure["face"].create<mesh::selection_t>("face_selections"),
-		GenericPrimitive.structure["face"].create<mesh::materials_t>("face_materials"),
-		GenericPrimitive.structure["loop"].create<mesh::indices_t>("loop_first_edges"),
-		GenericPrimitive.structure["edge"].create<mesh::indices_t>("clockwise_edges"),
-		GenericPrimitive.structure["edge"].create<mesh::selection_t>("edge_selections"),
-		GenericPrimitive.structure["vertex"].create<mesh::indices_t>("vertex_points"),
-		GenericPrimitive.structure["vertex"].create<mesh::selection_t>("vertex_selections"),
-		GenericPrimitive.attributes["constant"],
-		GenericPrimitive.attributes["face"],
-		GenericPrimitive.attributes["edge"],
-		GenericPrimitive.attributes["vertex"]
+		GenericPrimitive.structure[names.shell_table].create<typed_array<int32_t> >(names.shell_types),
+		GenericPrimitive.structure[names.face_table].create<mesh::indices_t>(names.face_shells),
+		GenericPrimitive.structure[names.face_table].create<mesh::indices_t>(names.face_first_loops),
+		GenericPrimitive.structure[names.face_table].create<mesh::counts_t>(names.face_loop_counts),
+		GenericPrimitive.structure[names.face_table].create<mesh::selection_t>(names.face_selections),
+		GenericPrimitive.structure[names.face_table].create<mesh::materials_t>(names.face_materials),
+		GenericPrimitive.structure[names.loop_table].create<mesh::indices_t>(names.loop_first_edges),
+		GenericPrimitive.structure[names.edge_table].create<mesh::indices_t>(names.clockwise_edges),
+		GenericPrimitive.structure[names.edge_table].create<mesh::selection_t>(names.edge_selections),
+		GenericPrimitive.structure[names.vertex_table].create<mesh::indices_t>(names.vertex_points),
+		GenericPrimitive.structure[names.vertex_table].create<mesh::selection_t>(names.vertex_selections),
+		GenericPrimitive.attributes[names.constant_table],
+		GenericPrimitive.attributes[names.face_table],
+		GenericPrimitive.attributes[names.edge_table],
+		GenericPrimitive.attributes[names.vertex_table]
 		);
 
 	result->face_selections.set_metadata_value(metadata::key::role(), metadata::value::selection_role());
@@ -266,101 +525,79 @@ const_primitive* validate(const mesh& Mesh, const mesh::primitive& Primitive)
 
 	try
 	{
-		require_valid_primitive(Mesh, Primitive);
-
-		const mesh::table_t& shell_structure = require_structure(Primitive, "shell");
-		const mesh::table_t& face_structure = require_structure(Primitive, "face");
-		const mesh::table_t& loop_structure = require_structure(Primitive, "loop");
-		const mesh::table_t& edge_structure = require_structure(Primitive, "edge");
-		const mesh::table_t& vertex_structure = require_structure(Primitive, "vertex");
-
-		const mesh::table_t& constant_attributes = require_attributes(Primitive, "constant");
-		const mesh::table_t& face_attributes = require_attributes(Primitive, "face");
-		const mesh::table_t& edge_attributes = require_attributes(Primitive, "edge");
-		const mesh::table_t& vertex_attributes = require_attributes(Primitive, "vertex");
-
-		const typed_array<int32_t>& shell_types = require_array<typed_array<int32_t> >(Primitive, shell_structure, "shell_types");
-		const mesh::indices_t& face_shells = require_array<mesh::indices_t>(Primitive, face_structure, "face_shells");
-		const mesh::indices_t& face_first_loops = require_array<mesh::indices_t>(Primitive, face_structure, "face_first_loops");
-		const mesh::counts_t& face_loop_counts = require_array<mesh::counts_t>(Primitive, face_structure, "face_loop_counts");
-		const mesh::selection_t& face_selections = require_array<mesh::selection_t>(Primitive, face_structure, "face_selections");
-		const mesh::materials_t& face_materials = require_array<mesh::materials_t>(Primitive, face_structure, "face_materials");
-		const mesh::indices_t& loop_first_edges = require_array<mesh::indices_t>(Primitive, loop_structure, "loop_first_edges");
-		const mesh::indices_t& clockwise_edges = require_array<mesh::indices_t>(Primitive, edge_structure, "clockwise_edges");
-		const mesh::selection_t& edge_selections = require_array<mesh::selection_t>(Primitive, edge_structure, "edge_selections");
-		const mesh::indices_t& vertex_points = require_array<mesh::indices_t>(Primitive, vertex_structure, "vertex_points");
-		const mesh::selection_t& vertex_selections = require_array<mesh::selection_t>(Primitive, vertex_structure, "vertex_selections");
+		const detail::names_t& names = detail::names();
+
+		const bool_t cached = valid_primitive_cached(Mesh, Primitive);
+		if(!cached)
+			require_valid_primitive(Mesh, Primitive);
+
+		const mesh::table_t& shell_structure = require_structure(Primitive, names.shell_table);
+		const mesh::table_t& face_structure = require_structure(Primitive, names.face_table);
+		const mesh::table_t& loop_structure = require_structure(Primitive, names.loop_table);
+		const mesh::table_t& edge_structure = require_structure(Primitive, names.edge_table);
+		const mesh::table_t& vertex_structure = require_structure(Primitive, names.vertex_table);
+
+		const mesh::table_t& constant_attributes = require_attributes(Primitive, names.constant_table);
+		const mesh::table_t& face_attributes = require_attributes(Primitive, names.face_table);
+		const mesh::table_t& edge_attributes = require_attributes(Primitive, names.edge_table);
+		const mesh::table_t& vertex_attributes = require_attributes(Primitive, names.vertex_table);
+
+		// Index arrays may be stored using compact 32-bit indices, so they are checked in-place, and only widened afterwards ...
+		const typed_array<int32_t>& shell_types = require_array<typed_array<int32_t> >(Primitive, shell_structure, names.shell_types);
+		const array& face_shells = detail::require_index_array(Primitive, face_structure, names.face_shells);
+		const array& face_first_loops = detail::require_index_array(Primitive, face_structure, names.face_first_loops);
+		const array& face_loop_counts = detail::require_index_array(Primitive, face_structure, names.face_loop_counts);
+		const mesh::selection_t& face_selections = require_array<mesh::selection_t>(Primitive, face_structure, names.face_selections);
+		const mesh::materials_t& face_materials = require_array<mesh::materials_t>(Primitive, face_structure, names.face_materials);
+		const array& loop_first_edges = detail::require_index_array(Primitive, loop_structure, names.loop_first_edges);
+		const array& clockwise_edges = detail::require_index_array(Primitive, edge_structure, names.clockwise_edges);
+		const mesh::selection_t& edge_selections = require_array<mesh::selection_t>(Primitive, edge_structure, names.edge_selections);
+		const array& vertex_points = detail::require_index_array(Primitive, vertex_structure, names.vertex_points);
+		const mesh::selection_t& vertex_selections = require_array<mesh::selection_t>(Primitive, vertex_structure, names.vertex_selections);
 
 		require_metadata(Primitive, face_selections, "face_selections", metadata::key::role(), metadata::value::selection_role());
 		require_metadata(Primitive, edge_selections, "edge_selections", metadata::key::role(), metadata::value::selection_role());
 		require_metadata(Primitive, vertex_points, "vertex_points", metadata::key::domain(), metadata::value::point_indices_domain());
 		require_metadata(Primitive, vertex_selections, "vertex_selections", metadata::key::role(), metadata::value::selection_role());
 
-		require_table_row_count(Primitive, loop_structure, "loop", std::accumulate(face_loop_counts.begin(), face_loop_counts.end(), 0));
+		if(!cached)
+			require_table_row_count(Primitive, loop_structure, "loop", detail::sum(face_loop_counts));
 		require_table_row_count(Primitive, vertex_structure, "vertex", edge_structure.row_count());
 
-		// Check for out-of-bound shell indices ...
-		const uint_t face_begin = 0;
-		const uint_t face_end = face_begin + face_shells.size();
-		for(uint_t face = face_begin; face != face_end; ++face)
+		// Unchanged primitives that have already been validated can skip the (expensive) topology checks ...
+		if(!cached)
 		{
-			if(face_shells[face] >= shell_types.size())
-			{
-				log() << error << "face shell out-of-bounds for face " << face << ": " << face_shells[face] << " >= " << shell_types.size() << std::endl;
+			// Check for out-of-bound shell indices ...
+			if(!detail::check_face_shells(face_shells, shell_types.size()))
 				return 0;
-			}	
-		}
-
-		// Check for out-of-bound indices and infinite loops in our edge lists ...
-		const uint_t loop_begin = 0;
-		const uint_t loop_end = loop_begin + loop_first_edges.size();
-
-		const uint_t edge_begin = 0;
-		const uint_t edge_end = edge_begin + clockwise_edges.size();
 
-		for(uint_t loop = loop_begin; loop != loop_end; ++loop)
-		{
-			const uint_t first_edge = loop_first_edges[loop];
-			if(first_edge >= edge_end)
-			{
-				log() << error << "loop first edge index out-of-bounds for loop " << loop << std::endl;
+			// Check for out-of-bound indices and infinite loops in our edge lists ...
+			if(!detail::check_edge_loops(loop_first_edges, clockwise_edges))
 				return 0;
-			}
-
-			uint_t edge_slow = first_edge;
-			uint_t edge_fast = first_edge;
-			uint_t cycle_count = 0;
-			while(true)
-			{
-				edge_slow = clockwise_edges[edge_slow];
-				if(edge_slow >= edge_end)
-				{
-					log() << error << "clockwise edge index out-of-bounds for edge " << edge_slow << std::endl;
-					return 0;
-				}
-
-				edge_fast = clockwise_edges[clockwise_edges[edge_fast]];
-				if(edge_fast >= edge_end)
-				{
-					log() << error << "clockwise edge index out-of-bounds for edge " << edge_fast << std::endl;
-					return 0;
-				}
-
-				if(edge_slow == edge_fast)
-					++cycle_count;
-
-				if(cycle_count > 2)
-				{
-					log() << error << "infinite loop at loop index " << loop << std::endl;
-					return 0;
-				}
-
-				if(edge_slow == first_edge)
-					break;
-			}
 		}
 
-		return new const_primitive(shell_types, face_shells, face_first_loops, face_loop_counts, face_selections, face_materials, loop_first_edges, clockwise_edges, edge_selections, vertex_points, vertex_selections, constant_attributes, face_attributes, edge_attributes, vertex_attributes);
+		if(!cached)
+			cache_valid_primitive(Mesh, Primitive);
+
+		std::vector<boost::shared_ptr<const mesh::indices_t> > expanded;
+		const_primitive* const result = new const_primitive(
+			shell_types,
+			detail::require_indices(face_shells, expanded),
+			detail::require_indices(face_first_loops, expanded),
+			detail::require_indices(face_loop_counts, expanded),
+			face_selections,
+			face_materials,
+			detail::require_indices(loop_first_edges, expanded),
+			detail::require_indices(clockwise_edges, expanded),
+			edge_selections,
+			detail::require_indices(vertex_points, expanded),
+			vertex_selections,
+			constant_attributes,
+			face_attributes,
+			edge_attributes,
+			vertex_attributes);
+		result->expanded_arrays.swap(expanded);
+		return result;
 	}
 	catch(std::exception& e)
 	{
@@ -377,30 +614,36 @@ primitive* validate(const mesh& Mesh, mesh::primitive& Primitive)
 
 	try
 	{
+		const detail::names_t& names = detail::names();
+
+		// Callers may modify the topology, so compact arrays are converted back to k3d::uint_t storage in-place, and the primitive
+		// stays that way ...
+		expand(Primitive);
+
 		require_valid_primitive(Mesh, Primitive);
 
-		mesh::table_t& shell_structure = require_structure(Primitive, "shell");
-		mesh::table_t& face_structure = require_structure(Primitive, "face");
-		mesh::table_t& loop_structure = require_structure(Primitive, "loop");
-		mesh::table_t& edge_structure = require_structure(Primitive, "edge");
-		mesh::table_t& vertex_structure = require_structure(Primitive, "vertex");
-
-		mesh::table_t& constant_attributes = require_attributes(Primitive, "constant");
-		mesh::table_t& face_attributes = require_attributes(Primitive, "face");
-		mesh::table_t& edge_attributes = require_attributes(Primitive, "edge");
-		mesh::table_t& vertex_attributes = require_attributes(Primitive, "vertex");
-
-		typed_array<int32_t>& shell_types = require_array<typed_array<int32_t> >(Primitive, shell_structure, "shell_types");
-		mesh::indices_t& face_shells = require_array<mesh::indices_t>(Primitive, face_structure, "face_shells");
-		mesh::indices_t& face_first_loops = require_array<mesh::indices_t>(Primitive, face_structure, "face_first_loops");
-		mesh::counts_t& face_loop_counts = require_array<mesh::counts_t>(Primitive, face_structure, "face_loop_counts");
-		mesh::selection_t& face_selections = require_array<mesh::selection_t>(Primitive, face_structure, "face_selections");
-		mesh::materials_t& face_materials = require_array<mesh::materials_t>(Primitive, face_structure, "face_materials");
-		mesh::indices_t& loop_first_edges = require_array<mesh::indices_t>(Primitive, loop_structure, "loop_first_edges");
-		mesh::indices_t& clockwise_edges = require_array<mesh::indices_t>(Primitive, edge_structure, "clockwise_edges");
-		mesh::selection_t& edge_selections = require_array<mesh::selection_t>(Primitive, edge_structure, "edge_selections");
-		mesh::indices_t& vertex_points = require_array<mesh::indices_t>(Primitive, vertex_structure, "vertex_points");
-		mesh::selection_t& vertex_selections = require_array<mesh::selection_t>(Primitive, vertex_structure, "vertex_selections");
+		mesh::table_t& shell_structure = require_structure(Primitive, names.shell_table);
+		mesh::table_t& face_structure = require_structure(Primitive, names.face_table);
+		mesh::table_t& loop_structure = require_structure(Primitive, names.loop_table);
+		mesh::table_t& edge_structure = require_structure(Primitive, names.edge_table);
+		mesh::table_t& vertex_structure = require_structure(Primitive, names.vertex_table);
+
+		mesh::table_t& constant_attributes = require_attributes(Primitive, names.constant_table);
+		mesh::table_t& face_attributes = require_attributes(Primitive, names.face_table);
+		mesh::table_t& edge_attributes = require_attributes(Primitive, names.edge_table);
+		mesh::table_t& vertex_attributes = require_attributes(Primitive, names.vertex_table);
+
+		typed_array<int32_t>& shell_types = require_array<typed_array<int32_t> >(Primitive, shell_structure, names.shell_types);
+		mesh::indices_t& face_shells = require_array<mesh::indices_t>(Primitive, face_structure, names.face_shells);
+		mesh::indices_t& face_first_loops = require_array<mesh::indices_t>(Primitive, face_structure, names.face_first_loops);
+		mesh::counts_t& face_loop_counts = require_array<mesh::counts_t>(Primitive, face_structure, names.face_loop_counts);
+		mesh::selection_t& face_selections = require_array<mesh::selection_t>(Primitive, face_structure, names.face_selections);
+		mesh::materials_t& face_materials = require_array<mesh::materials_t>(Primitive, face_structure, names.face_materials);
+		mesh::indices_t& loop_first_edges = require_array<mesh::indices_t>(Primitive, loop_structure, names.loop_first_edges);
+		mesh::indices_t& clockwise_edges = require_array<mesh::indices_t>(Primitive, edge_structure, names.clockwise_edges);
+		mesh::selection_t& edge_selections = require_array<mesh::selection_t>(Primitive, edge_structure, names.edge_selections);
+		mesh::indices_t& vertex_points = require_array<mesh::indices_t>(Primitive, vertex_structure, names.vertex_points);
+		mesh::selection_t& vertex_selections = require_array<mesh::selection_t>(Primitive, vertex_structure, names.vertex_selections);
 
 		require_metadata(Primitive, face_selections, "face_selections", metadata::key::role(), metadata::value::selection_role());
 		require_metadata(Primitive, edge_selections, "edge_selections", metadata::key::role(), metadata::value::selection_role());
@@ -492,6 +735,63 @@ primitive* validate(const mesh& Mesh, pipeline_data<mesh::primitive>& Primitive)
   return validate(Mesh, Primitive.writable());
 }
 
+/////////////////////////////////////////////////////////////////////////////////////////////
+// compact
+
+uint_t compact(mesh::primitive& Primitive)
+{
+	if(Primitive.type != "polyhedron")
+		return 0;
+
+	uint_t result = 0;
+	for(mesh::named_tables_t::iterator structure = Primitive.structure.begin(); structure != Primitive.structure.end(); ++structure)
+	{
+		for(mesh::table_t::iterator array = structure->second.begin(); array != structure->second.end(); ++array)
+		{
+			const mesh::indices_t* const indices = dynamic_cast<const mesh::indices_t*>(array->second.get());
+			if(!indices)
+				continue;
+
+			if(!indices->empty() && *std::max_element(indices->begin(), indices->end()) > std::numeric_limits<uint32_t>::max())
+				continue;
+
+			mesh::compact_indices_t* const compact_indices = new mesh::compact_indices_t(indices->begin(), indices->end());
+			compact_indices->set_metadata(indices->get_metadata());
+			array->second.create(compact_indices);
+			++result;
+		}
+	}
+
+	return result;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////
+// expand
+
+uint_t expand(mesh::primitive& Primitive)
+{
+	if(Primitive.type != "polyhedron")
+		return 0;
+
+	uint_t result = 0;
+	for(mesh::named_tables_t::iterator structure = Primitive.structure.begin(); structure != Primitive.structure.end(); ++structure)
+	{
+		for(mesh::table_t::iterator array = structure->second.begin(); array != structure->second.end(); ++array)
+		{
+			const mesh::compact_indices_t* const compact_indices = dynamic_cast<const mesh::compact_indices_t*>(array->second.get());
+			if(!compact_indices)
+				continue;
+
+			mesh::indices_t* const indices = new mesh::indices_t(compact_indices->begin(), compact_indices->end());
+			indices->set_metadata(compact_indices->get_metadata());
+			array->second.create(indices);
+			++result;
+		}
+	}
+
+	return result;
+}
+
 /////////////////////////////////////////////////////////////////////////////////////////////
 // add_triangle
 
@@ -978,13 +1278,72 @@ namespace detail
 /////////////////////////////////////////////////////////////////////////////////////////////
 // find_companion_worker
 
+/// Adapts per-point edge lists for use with find_companion_worker
+class point_edge_lists
+{
+public:
+	point_edge_lists(const std::vector<mesh::indices_t>& PointEdges) :
+		m_point_edges(PointEdges)
+	{
+	}
+
+	uint_t begin(const uint_t Point) const
+	{
+		return 0;
+	}
+
+	uint_t end(const uint_t Point) const
+	{
+		return m_point_edges[Point].size();
+	}
+
+	uint_t edge(const uint_t Point, const uint_t Index) const
+	{
+		return m_point_edges[Point][Index];
+	}
+
+private:
+	const std::vector<mesh::indices_t>& m_point_edges;
+};
+
+/// Adapts a compact point-edge lookup for use with find_companion_worker
+class compact_point_edges
+{
+public:
+	compact_point_edges(const mesh::compact_indices_t& PointFirstEdges, const mesh::compact_indices_t& PointEdges) :
+		m_point_first_edges(PointFirstEdges),
+		m_point_edges(PointEdges)
+	{
+	}
+
+	uint_t begin(const uint_t Point) const
+	{
+		return m_point_first_edges[Point];
+	}
+
+	uint_t end(const uint_t Point) const
+	{
+		return m_point_first_edges[Point + 1];
+	}
+
+	uint_t edge(const uint_t, const uint_t Index) const
+	{
+		return m_point_edges[Index];
+	}
+
+private:
+	const mesh::compact_indices_t& m_point_first_edges;
+	const mesh::compact_indices_t& m_point_edges;
+};
+
+template<typename PointEdgesT>
 class find_companion_worker
 {
 public:
 	find_companion_worker(
 		const mesh::indices_t& VertexPoints,
 		const mesh::indices_t& ClockwiseEdges,
-		const std::vector<mesh::indices_t>& PointEdges,
+		const PointEdgesT& PointEdges,
 		mesh::bools_t& BoundaryEdges,
 		mesh::indices_t& AdjacentEdges) :
 			m_edge_points(VertexPoints),
@@ -1004,13 +1363,12 @@ public:
 			const uint_t vertex1 = m_edge_points[edge];
 			const uint_t vertex2 = m_edge_points[m_clockwise_edges[edge]];
 
-			const mesh::indices_t& point_edges = m_point_edges[vertex2];
-			const uint_t first_index = 0;
-			const uint_t last_index = point_edges.size();
+			const uint_t first_index = m_point_edges.begin(vertex2);
+			const uint_t last_index = m_point_edges.end(vertex2);
 			m_adjacent_edges[edge] = edge;
 			for(uint_t i = first_index; i != last_index; ++i)
 			{
-				const uint_t companion = point_edges[i];
+				const uint_t companion = m_point_edges.edge(vertex2, i);
 				if(m_edge_points[m_clockwise_edges[companion]] == vertex1)
 				{
 					m_boundary_edges[edge] = false;
@@ -1024,7 +1382,7 @@ public:
 private:
 	const mesh::indices_t& m_edge_points;
 	const mesh::indices_t& m_clockwise_edges;
-	const std::vector<mesh::indices_t>& m_point_edges;
+	const PointEdgesT m_point_edges;
 	mesh::bools_t& m_boundary_edges;
 	mesh::indices_t& m_adjacent_edges;
 };
@@ -1054,11 +1412,15 @@ class create_triangles :
 	typedef triangulator base;
 
 public:
-	mesh::primitive* process(const mesh& Input, const const_primitive& Polyhedron, mesh& Output)
+	mesh::primitive* process(const mesh& Input, const const_primitive& Polyhedron, mesh& Output, derived_points* const OutputPoints)
 	{
 		// Allocate new data structures for our output ...
 		input_polyhedron = &Polyhedron;
 
+		output_derived_points = OutputPoints;
+		if(output_derived_points)
+			output_derived_points->reset(Input.points->size());
+
 		mesh::primitive* const result = new mesh::primitive();
 		output_polyhedron.reset(create(*result));
 
@@ -1122,6 +1484,9 @@ private:
 
 		point_attributes_copier->push_back(4, Vertices, Weights);
 
+		if(output_derived_points)
+			output_derived_points->push_back(4, Vertices, Weights);
+
 		new_edge_attributes[NewVertex] = new_edge_record(Edges, Weights);
 	}
 
@@ -1202,6 +1567,7 @@ private:
 
 	mesh::points_t* output_points;
 	mesh::selection_t* output_point_selection;
+	derived_points* output_derived_points;
 	boost::scoped_ptr<primitive> output_polyhedron;
 
 	boost::shared_ptr<table_copier> face_attributes_copier;
@@ -1250,8 +1616,6 @@ void create_edge_adjacency_lookup(const mesh::indices_t& VertexPoints, const mes
 	const k3d::uint_t count = VertexPoints.empty() ? 0 : *std::max_element(VertexPoints.begin(), VertexPoints.end()) + 1;
 	if(!count)
 		return;
-	std::vector<mesh::indices_t> point_edges(count);
-	create_point_out_edge_lookup(VertexPoints, ClockwiseEdges, point_edges);
 
 	BoundaryEdges.assign(VertexPoints.size(), true);
 	AdjacentEdges.assign(VertexPoints.size(), 0);
@@ -1259,10 +1623,24 @@ void create_edge_adjacency_lookup(const mesh::indices_t& VertexPoints, const mes
 	const uint_t edge_begin = 0;
 	const uint_t edge_end = edge_begin + VertexPoints.size();
 	
+	// Use a compact point-to-edge lookup wherever it can hold the edge indices, since it takes a fraction of the memory traffic of per-point lists ...
+	mesh::compact_indices_t point_first_edges;
+	mesh::compact_indices_t point_edges;
+	if(create_point_out_edge_lookup(count, VertexPoints, point_first_edges, point_edges))
+	{
+		k3d::parallel::parallel_for(
+					k3d::parallel::blocked_range<uint_t>(edge_begin, edge_end, k3d::parallel::grain_size()),
+					detail::find_companion_worker<detail::compact_point_edges>(VertexPoints, ClockwiseEdges, detail::compact_point_edges(point_first_edges, point_edges), BoundaryEdges, AdjacentEdges));
+		return;
+	}
+
+	std::vector<mesh::indices_t> point_edge_lists(count);
+	create_point_out_edge_lookup(VertexPoints, ClockwiseEdges, point_edge_lists);
+
 	// Making this parallel decreases running time by 20 % on a Pentium D. 
 	k3d::parallel::parallel_for(
 				k3d::parallel::blocked_range<uint_t>(edge_begin, edge_end, k3d::parallel::grain_size()),
-				detail::find_companion_worker(VertexPoints, ClockwiseEdges, point_edges, BoundaryEdges, AdjacentEdges));
+				detail::find_companion_worker<detail::point_edge_lists>(VertexPoints, ClockwiseEdges, detail::point_edge_lists(point_edge_lists), BoundaryEdges, AdjacentEdges));
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////
@@ -1390,6 +1768,51 @@ void create_point_out_edge_lookup(const mesh& Mesh, const const_primitive& Polyh
 	create_point_out_edge_lookup(Polyhedron.vertex_points, Polyhedron.clockwise_edges, AdjacencyList);
 }
 
+namespace detail
+{
+
+/// Creates a point-to-out-edge lookup using whatever index width the arrays store
+template<typename ArrayT>
+void create_point_out_edge_lookup(const uint_t PointCount, const mesh::indices_t& VertexPoints, ArrayT& PointFirstEdges, ArrayT& PointEdges)
+{
+	typedef typename ArrayT::value_type value_t;
+
+	// Count the out-edges for each point, then convert the counts into offsets (a counting sort keeps edges in ascending order) ...
+	PointFirstEdges.assign(PointCount + 1, 0);
+
+	const uint_t edge_begin = 0;
+	const uint_t edge_end = edge_begin + VertexPoints.size();
+	for(uint_t edge = edge_begin; edge != edge_end; ++edge)
+		++PointFirstEdges[VertexPoints[edge] + 1];
+
+	for(uint_t point = 0; point != PointCount; ++point)
+		PointFirstEdges[point + 1] += PointFirstEdges[point];
+
+	ArrayT cursors(PointFirstEdges.begin(), PointFirstEdges.end() - 1);
+	PointEdges.resize(VertexPoints.size());
+	for(uint_t edge = edge_begin; edge != edge_end; ++edge)
+		PointEdges[cursors[VertexPoints[edge]]++] = static_cast<value_t>(edge);
+}
+
+} // namespace detail
+
+bool_t create_point_out_edge_lookup(const uint_t PointCount, const mesh::indices_t& VertexPoints, mesh::compact_indices_t& PointFirstEdges, mesh::compact_indices_t& PointEdges)
+{
+	PointFirstEdges.clear();
+	PointEdges.clear();
+
+	if(VertexPoints.size() > std::numeric_limits<uint32_t>::max())
+		return false;
+
+	detail::create_point_out_edge_lookup(PointCount, VertexPoints, PointFirstEdges, PointEdges);
+	return true;
+}
+
+void create_point_out_edge_lookup(const uint_t PointCount, const mesh::indices_t& VertexPoints, mesh::indices_t& PointFirstEdges, mesh::indices_t& PointEdges)
+{
+	detail::create_point_out_edge_lookup(PointCount, VertexPoints, PointFirstEdges, PointEdges);
+}
+
 /////////////////////////////////////////////////////////////////////////////////////////////
 // create_point_in_edge_lookup
 
@@ -1562,9 +1985,9 @@ void mark_coplanar_edges(const mesh::indices_t& Companions,
 ////////////////////////////////////////////
 // triangulate
 
-mesh::primitive* triangulate(const mesh& Input, const const_primitive& Polyhedron, mesh& Output)
+mesh::primitive* triangulate(const mesh& Input, const const_primitive& Polyhedron, mesh& Output, derived_points* const OutputPoints)
 {
-	return detail::create_triangles().process(Input, Polyhedron, Output);
+	return detail::create_triangles().process(Input, Polyhedron, Output, OutputPoints);
 }
 
 ////////////////////////////////////////////
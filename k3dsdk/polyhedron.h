@@ -27,9 +27,13 @@
 
 #include <k3dsdk/mesh.h>
 
+#include <boost/shared_ptr.hpp>
+
 namespace k3d
 {
 
+class derived_points;
+
 namespace polyhedron
 {
 
@@ -82,6 +86,9 @@ public:
 	const mesh::table_t& face_attributes;
 	const mesh::table_t& edge_attributes;
 	const mesh::table_t& vertex_attributes;
+
+	/// Keeps alive the k3d::uint_t copies of any compact topology arrays, which the references above point into
+	std::vector<boost::shared_ptr<const mesh::indices_t> > expanded_arrays;
 };
 
 /// Gathers the member arrays of a polyhedron primitive into a convenient package
@@ -140,15 +147,25 @@ primitive* create(mesh& Mesh, const mesh::points_t& Vertices, const mesh::counts
 primitive* create(mesh& Mesh, const mesh::points_t& Vertices, const mesh::counts_t& VertexCounts, const mesh::indices_t& VertexIndices, const mesh::texture_coordinates_t& TextureCoordinates, imaterial* const Material);
 
 /// Tests the given mesh primitive to see if it is a valid polyhedron, returning references to its member arrays, or NULL.
-/// The caller is responsible for the lifetime of the returned object.
+/// The caller is responsible for the lifetime of the returned object.  Compact topology arrays are widened into k3d::uint_t copies
+/// owned by the returned object, so they take as much memory as full-width arrays while it is alive.
 const_primitive* validate(const mesh& Mesh, const mesh::primitive& GenericPrimitive);
 /// Tests the given mesh primitive to see if it is a valid polyhedron, returning references to its member arrays, or NULL.
-/// The caller is responsible for the lifetime of the returned object.
+/// The caller is responsible for the lifetime of the returned object.  Note that this calls expand() first, so any compact
+/// topology arrays are permanently converted back to k3d::uint_t storage.
 primitive* validate(const mesh& Mesh, mesh::primitive& GenericPrimitive);
 /// Tests the given mesh primitive to see if it is a valid polyhedron, returning references to its member arrays, or NULL.
-/// The caller is responsible for the lifetime of the returned object.
+/// The caller is responsible for the lifetime of the returned object.  Like the overload above, this expands any compact topology arrays.
 primitive* validate(const mesh& Mesh, pipeline_data<mesh::primitive>& GenericPrimitive);
 
+/// Converts the topology arrays of a polyhedron to compact 32-bit storage, which is half the size for as long as the mesh is stored
+/// or saved.  Arrays containing values that can't be stored in 32 bits are left unchanged.  validate() accepts either form, so
+/// callers can continue to use k3d::uint_t indices, but it doesn't read the compact arrays in-place (see above).  Returns the
+/// number of arrays converted.
+uint_t compact(mesh::primitive& GenericPrimitive);
+/// Converts any compact topology arrays in a polyhedron back to k3d::uint_t storage.  Returns the number of arrays converted.
+uint_t expand(mesh::primitive& GenericPrimitive);
+
 /// Adds a triangle to an existing polyhedron shell.  Preconditions: the polyhedron must already contain at least one shell.
 void add_triangle(mesh& Mesh, primitive& Polyhedron, const uint_t Shell, const uint_t V1, const uint_t V2, const uint_t V3, imaterial* const Material);
 /// Adds a quadrilateral to an existing polyhedron shell.  Preconditions: the polyhedron must already contain at least one shell.
@@ -213,6 +230,11 @@ void create_point_face_lookup(const mesh& Mesh, const const_primitive& Polyhedro
 
 /// Creates an adjacency list for fast lookup from a vertex to its out-edges.
 void create_point_out_edge_lookup(const mesh& Mesh, const const_primitive& Polyhedron, std::vector<mesh::indices_t>& AdjacencyList);
+/// Creates a compact lookup from a vertex to its out-edges, which are PointEdges[PointFirstEdges[point]] through PointEdges[PointFirstEdges[point + 1] - 1]
+/// in ascending order.  Indices are stored using 32 bits, so this returns false (leaving both arrays empty) for polyhedra with 2^32 or more edges.
+bool_t create_point_out_edge_lookup(const uint_t PointCount, const mesh::indices_t& VertexPoints, mesh::compact_indices_t& PointFirstEdges, mesh::compact_indices_t& PointEdges);
+/// Creates the same lookup as above using k3d::uint_t indices, for polyhedra of any size.
+void create_point_out_edge_lookup(const uint_t PointCount, const mesh::indices_t& VertexPoints, mesh::indices_t& PointFirstEdges, mesh::indices_t& PointEdges);
 /// Creates an adjacency list for fast lookup from a vertex to its in-edges.
 void create_point_in_edge_lookup(const mesh& Mesh, const const_primitive& Polyhedron, std::vector<mesh::indices_t>& AdjacencyList);
 /// Creates an adjacency list for fast lookup from a vertex to its incident (in- or out-) edges.
@@ -246,8 +268,9 @@ void mark_coplanar_edges(const mesh::indices_t& Companions,
 		mesh::indices_t& RedundantEdges,
 		const double_t Threshold = 1e-8);
 
-/// Triangulates the input polyhedron, storing the resulting primitive and storing point data in Output
-mesh::primitive* triangulate(const mesh& Input, const const_primitive& Polyhedron, mesh& Output);
+/// Triangulates the input polyhedron, storing the resulting primitive and storing point data in Output.  If OutputPoints
+/// isn't NULL, it is reset to record how each output point was derived from the input points.
+mesh::primitive* triangulate(const mesh& Input, const const_primitive& Polyhedron, mesh& Output, derived_points* const OutputPoints = 0);
 
 /// Removes edges, loops, and faces from a polyhedron, cleaning-up references and attributes.
 void delete_components(const mesh& Mesh, primitive& Polyhedron, const mesh::bools_t& RemovePoints, mesh::bools_t& RemoveEdges, mesh::bools_t& RemoveLoops, mesh::bools_t& RemoveFaces);
@@ -21,6 +21,12 @@
 #include <k3dsdk/metadata_keys.h>
 #include <k3dsdk/primitive_validation.h>
 
+#include <boost/functional/hash.hpp>
+
+#include <glibmm/thread.h>
+
+#include <set>
+
 namespace k3d
 {
 
@@ -80,13 +86,22 @@ static void require_valid_table(const mesh& Mesh, const string_t& Name, const ta
 
 			require_valid_points(Mesh);
 
-			const mesh::indices_t* const indices = dynamic_cast<const mesh::indices_t*>(current_array);
-			if(!indices)
+			if(const mesh::indices_t* const indices = dynamic_cast<const mesh::indices_t*>(current_array))
+			{
+				const mesh::indices_t::const_iterator max = std::max_element(indices->begin(), indices->end());
+				if(max != indices->end() && *max >= Mesh.points->size())
+					throw std::runtime_error("Point indices array out-of-bounds.");
+			}
+			else if(const mesh::compact_indices_t* const indices = dynamic_cast<const mesh::compact_indices_t*>(current_array))
+			{
+				const mesh::compact_indices_t::const_iterator max = std::max_element(indices->begin(), indices->end());
+				if(max != indices->end() && *max >= Mesh.points->size())
+					throw std::runtime_error("Point indices array out-of-bounds.");
+			}
+			else
+			{
 				throw std::runtime_error("Point indices array must be an index type.");
-
-			const mesh::indices_t::const_iterator max = std::max_element(indices->begin(), indices->end());
-			if(max != indices->end() && *max >= Mesh.points->size())
-				throw std::runtime_error("Point indices array out-of-bounds.");
+			}
 		}
 	}
 }
@@ -117,42 +132,150 @@ void require_valid_primitive(const mesh& Mesh, const mesh::primitive& Primitive)
 	}
 }
 
-const mesh::table_t& require_structure(const mesh::primitive& Primitive, const string_t& Name)
+namespace detail
+{
+
+/// Identifies the contents of a primitive (and the mesh point data it depends on) by array generation
+typedef std::vector<uint_t> validation_key_t;
+
+/// Appends the generation of an array to a validation key, returns false if the array isn't frozen (see array::frozen())
+static bool_t append_validation_key(const array* const Array, validation_key_t& Key)
+{
+	if(Array && !Array->frozen())
+		return false;
+
+	Key.push_back(Array ? Array->generation() : 0);
+	return true;
+}
+
+static bool_t append_validation_key(const symbol& Name, const table& Table, validation_key_t& Key, std::size_t& Names)
+{
+	boost::hash_combine(Names, Name);
+	for(table::const_iterator array_iterator = Table.begin(); array_iterator != Table.end(); ++array_iterator)
+	{
+		boost::hash_combine(Names, array_iterator->first);
+		if(!append_validation_key(array_iterator->second.get(), Key))
+			return false;
+	}
+
+	return true;
+}
+
+/// Computes the validation key for a primitive, returns false if the primitive can't be cached because some of its arrays
+/// may still be modified through outstanding mutable references
+static bool_t validation_key(const mesh& Mesh, const mesh::primitive& Primitive, validation_key_t& Key)
+{
+	Key.reserve(32);
+
+	// Reserve the first element for a hash of the primitive type and table / array names ...
+	Key.push_back(0);
+	std::size_t names = boost::hash<string_t>()(Primitive.type);
+
+	if(!append_validation_key(Mesh.points.get(), Key))
+		return false;
+	if(!append_validation_key(Mesh.point_selection.get(), Key))
+		return false;
+
+	static const symbol point_attributes("point_attributes");
+	if(!append_validation_key(point_attributes, Mesh.point_attributes, Key, names))
+		return false;
+
+	for(mesh::named_tables_t::const_iterator structure = Primitive.structure.begin(); structure != Primitive.structure.end(); ++structure)
+	{
+		if(!append_validation_key(structure->first, structure->second, Key, names))
+			return false;
+	}
+
+	for(mesh::named_tables_t::const_iterator attributes = Primitive.attributes.begin(); attributes != Primitive.attributes.end(); ++attributes)
+	{
+		if(!append_validation_key(attributes->first, attributes->second, Key, names))
+			return false;
+	}
+
+	Key[0] = names;
+	return true;
+}
+
+/// Stores the keys of primitives that have passed validation.  Because generations are never reused, stale keys
+/// simply never match again, so we only need to keep the cache from growing without bound.
+static std::set<validation_key_t> validation_cache;
+/// Creates the validation cache mutex.  Glib mutexes constructed before Glib::thread_init() don't lock, so this can't be done during static initialization.
+static Glib::Mutex* create_validation_cache_mutex()
+{
+	if(!Glib::thread_supported())
+		Glib::thread_init();
+
+	return new Glib::Mutex();
+}
+
+/// Serializes access to the validation cache, since primitives may be validated concurrently
+static Glib::Mutex& validation_cache_mutex()
+{
+	static Glib::Mutex* const mutex = create_validation_cache_mutex();
+	return *mutex;
+}
+
+} // namespace detail
+
+bool_t valid_primitive_cached(const mesh& Mesh, const mesh::primitive& Primitive)
+{
+	detail::validation_key_t key;
+	if(!detail::validation_key(Mesh, Primitive, key))
+		return false;
+
+	Glib::Mutex::Lock lock(detail::validation_cache_mutex());
+	return detail::validation_cache.count(key) ? true : false;
+}
+
+void cache_valid_primitive(const mesh& Mesh, const mesh::primitive& Primitive)
+{
+	detail::validation_key_t key;
+	if(!detail::validation_key(Mesh, Primitive, key))
+		return;
+
+	Glib::Mutex::Lock lock(detail::validation_cache_mutex());
+	if(detail::validation_cache.size() > 4096)
+		detail::validation_cache.clear();
+
+	detail::validation_cache.insert(key);
+}
+
+const mesh::table_t& require_structure(const mesh::primitive& Primitive, const symbol& Name)
 {
 	const table* const structure = Primitive.structure.lookup(Name);
 
 	if(!structure)
-		throw std::runtime_error("[" + Primitive.type + "] primitive missing structure [" + Name + "]");
+		throw std::runtime_error("[" + Primitive.type + "] primitive missing structure [" + Name.str() + "]");
 
 	return *structure;
 }
 
-mesh::table_t& require_structure(mesh::primitive& Primitive, const string_t& Name)
+mesh::table_t& require_structure(mesh::primitive& Primitive, const symbol& Name)
 {
 	table* const structure = Primitive.structure.writable(Name);
 
 	if(!structure)
-		throw std::runtime_error("[" + Primitive.type + "] primitive missing structure [" + Name + "]");
+		throw std::runtime_error("[" + Primitive.type + "] primitive missing structure [" + Name.str() + "]");
 
 	return *structure;
 }
 
-const mesh::table_t& require_attributes(const mesh::primitive& Primitive, const string_t& Name)
+const mesh::table_t& require_attributes(const mesh::primitive& Primitive, const symbol& Name)
 {
 	const table* const attributes = Primitive.attributes.lookup(Name);
 
 	if(!attributes)
-		throw std::runtime_error("[" + Primitive.type + "] primitive missing attributes [" + Name + "]");
+		throw std::runtime_error("[" + Primitive.type + "] primitive missing attributes [" + Name.str() + "]");
 
 	return *attributes;
 }
 
-mesh::table_t& require_attributes(mesh::primitive& Primitive, const string_t& Name)
+mesh::table_t& require_attributes(mesh::primitive& Primitive, const symbol& Name)
 {
 	table* const attributes = Primitive.attributes.writable(Name);
 
 	if(!attributes)
-		throw std::runtime_error("[" + Primitive.type + "] primitive missing attributes [" + Name + "]");
+		throw std::runtime_error("[" + Primitive.type + "] primitive missing attributes [" + Name.str() + "]");
 
 	return *attributes;
 }
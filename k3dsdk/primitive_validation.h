@@ -50,38 +50,47 @@ void require_valid_points(const mesh& Mesh);
 /// * Validates that matching structure and attribute tables contain the same number of rows.
 void require_valid_primitive(const mesh& Mesh, const mesh::primitive& Primitive);
 
+/// Returns true iff the given primitive has already passed validation (see cache_valid_primitive()), and none of its arrays
+/// (nor the mesh point data) has been modified since, so validate() implementations can skip their expensive checks.
+/// The cache is keyed on array generations, so it relies on arrays being modified via pipeline_data::writable(), and
+/// primitives are only cached once all of their arrays are frozen (shared), see array::frozen().
+bool_t valid_primitive_cached(const mesh& Mesh, const mesh::primitive& Primitive);
+/// Records that the given primitive has passed validation.  Only call this from the const version of validate(),
+/// since callers of the non-const version are free to modify the arrays they receive.
+void cache_valid_primitive(const mesh& Mesh, const mesh::primitive& Primitive);
+
 /// Tests a primitive to verify that it contains the named structure table, throws an exception otherwise.
-const mesh::table_t& require_structure(const mesh::primitive& Primitive, const string_t& Name);
+const mesh::table_t& require_structure(const mesh::primitive& Primitive, const symbol& Name);
 /// Tests a primitive to verify that it contains the named structure table, throws an exception otherwise.
-mesh::table_t& require_structure(mesh::primitive& Primitive, const string_t& Name);
+mesh::table_t& require_structure(mesh::primitive& Primitive, const symbol& Name);
 /// Tests a primitive to verify that it contains the named attribute table, throws an exception otherwise.
-const mesh::table_t& require_attributes(const mesh::primitive& Primitive, const string_t& Name);
+const mesh::table_t& require_attributes(const mesh::primitive& Primitive, const symbol& Name);
 /// Tests a primitive to verify that it contains the named attribute table, throws an exception otherwise.
-mesh::table_t& require_attributes(mesh::primitive& Primitive, const string_t& Name);
+mesh::table_t& require_attributes(mesh::primitive& Primitive, const symbol& Name);
 
 /// Tests a table to verify that it matches the given row count, throws an exception otherwise.
 void require_table_row_count(const mesh::primitive& Primitive, const table& Table, const string_t& TableName, const uint_t RowCount);
 
 /// Tests a table to verify that it contains an array with given name and type, throws an exception otherwise.
 template<typename ArrayT>
-const ArrayT& require_array(const mesh::primitive& Primitive, const mesh::table_t& Table, const string_t& Name)
+const ArrayT& require_array(const mesh::primitive& Primitive, const mesh::table_t& Table, const symbol& Name)
 {
 	const ArrayT* const array = Table.lookup<ArrayT>(Name);
 
 	if(!array)
-		throw std::runtime_error("[" + Primitive.type + "] primitive missing array [" + Name + "]");
+		throw std::runtime_error("[" + Primitive.type + "] primitive missing array [" + Name.str() + "]");
 
 	return *array;
 }
 
 /// Tests a table to verify that it contains an array with given name and type, throws an exception otherwise.
 template<typename ArrayT>
-ArrayT& require_array(mesh::primitive& Primitive, mesh::table_t& Table, const string_t& Name)
+ArrayT& require_array(mesh::primitive& Primitive, mesh::table_t& Table, const symbol& Name)
 {
 	ArrayT* const array = Table.writable<ArrayT>(Name);
 
 	if(!array)
-		throw std::runtime_error("[" + Primitive.type + "] primitive missing array [" + Name + "]");
+		throw std::runtime_error("[" + Primitive.type + "] primitive missing array [" + Name.str() + "]");
 
 	return *array;
 }
@@ -0,0 +1,434 @@
+#ifndef K3DSDK_PYTHON_ARRAY_BUFFER_PYTHON_H
+#define K3DSDK_PYTHON_ARRAY_BUFFER_PYTHON_H
+
+// K-3D
+// Copyright (c) 1995-2010, Timothy M. Shead
+//
+// Contact: tshead@k-3d.com
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+/** \file
+	\brief Exposes the storage of K-3D arrays to Python through the buffer protocol (which NumPy uses to share storage)
+	\author Timothy M. Shead (tshead@k-3d.com)
+*/
+
+#include <k3dsdk/python/instance_wrapper_python.h>
+
+#include <k3dsdk/algebra.h>
+#include <k3dsdk/array.h>
+#include <k3dsdk/color.h>
+#include <k3dsdk/normal3.h>
+#include <k3dsdk/point2.h>
+#include <k3dsdk/point3.h>
+#include <k3dsdk/point4.h>
+#include <k3dsdk/texture3.h>
+#include <k3dsdk/vector2.h>
+#include <k3dsdk/vector3.h>
+
+#include <boost/python/class.hpp>
+#include <boost/python/extract.hpp>
+#include <boost/static_assert.hpp>
+#include <boost/type_traits/is_const.hpp>
+#include <boost/utility/enable_if.hpp>
+
+#include <cstring>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+
+namespace k3d
+{
+
+namespace python
+{
+
+namespace buffer
+{
+
+/// Describes a scalar type in terms of the Python struct module ("format") and NumPy ("kind") type codes
+template<typename T>
+class scalar_traits
+{
+};
+
+#define K3D_PYTHON_BUFFER_SCALAR(type, Format, Kind) \
+	template<> \
+	class scalar_traits<type> \
+	{ \
+	public: \
+		static const char* format() { return Format; } \
+		static char kind() { return Kind; } \
+	};
+
+K3D_PYTHON_BUFFER_SCALAR(double_t, "d", 'f')
+K3D_PYTHON_BUFFER_SCALAR(int8_t, "b", 'i')
+K3D_PYTHON_BUFFER_SCALAR(int16_t, "h", 'i')
+K3D_PYTHON_BUFFER_SCALAR(int32_t, "i", 'i')
+K3D_PYTHON_BUFFER_SCALAR(int64_t, "q", 'i')
+K3D_PYTHON_BUFFER_SCALAR(uint8_t, "B", 'u')
+K3D_PYTHON_BUFFER_SCALAR(uint16_t, "H", 'u')
+K3D_PYTHON_BUFFER_SCALAR(uint32_t, "I", 'u')
+K3D_PYTHON_BUFFER_SCALAR(uint64_t, "Q", 'u')
+
+#undef K3D_PYTHON_BUFFER_SCALAR
+
+/// Describes the memory layout of array elements, each of which is a scalar, a vector of Rows scalars, or a Rows x Columns matrix of scalars.
+/// Element types without a specialization (booleans, which are bit-packed, strings, node and material pointers) aren't exposed through the buffer protocol.
+template<typename T>
+class element_traits
+{
+public:
+	static const bool_t supported = false;
+};
+
+template<typename ScalarT, int Rows = 0, int Columns = 0>
+class element_layout
+{
+public:
+	typedef ScalarT scalar_type;
+	static const bool_t supported = true;
+	/// Number of buffer dimensions, including the array index
+	static const int ndim = 1 + (Rows ? 1 : 0) + (Columns ? 1 : 0);
+
+	static void shape(Py_ssize_t* Shape)
+	{
+		if(Rows)
+			Shape[1] = Rows;
+		if(Columns)
+			Shape[2] = Columns;
+	}
+};
+
+template<> class element_traits<double_t> : public element_layout<double_t> {};
+template<> class element_traits<int8_t> : public element_layout<int8_t> {};
+template<> class element_traits<int16_t> : public element_layout<int16_t> {};
+template<> class element_traits<int32_t> : public element_layout<int32_t> {};
+template<> class element_traits<int64_t> : public element_layout<int64_t> {};
+template<> class element_traits<uint8_t> : public element_layout<uint8_t> {};
+template<> class element_traits<uint16_t> : public element_layout<uint16_t> {};
+template<> class element_traits<uint32_t> : public element_layout<uint32_t> {};
+template<> class element_traits<uint64_t> : public element_layout<uint64_t> {};
+template<> class element_traits<color> : public element_layout<double_t, 3> {};
+template<> class element_traits<matrix4> : public element_layout<double_t, 4, 4> {};
+template<> class element_traits<normal3> : public element_layout<double_t, 3> {};
+template<> class element_traits<point2> : public element_layout<double_t, 2> {};
+template<> class element_traits<point3> : public element_layout<double_t, 3> {};
+template<> class element_traits<point4> : public element_layout<double_t, 4> {};
+template<> class element_traits<texture3> : public element_layout<double_t, 3> {};
+template<> class element_traits<vector2> : public element_layout<double_t, 2> {};
+template<> class element_traits<vector3> : public element_layout<double_t, 3> {};
+
+BOOST_STATIC_ASSERT(sizeof(color) == 3 * sizeof(double_t));
+BOOST_STATIC_ASSERT(sizeof(matrix4) == 16 * sizeof(double_t));
+BOOST_STATIC_ASSERT(sizeof(normal3) == 3 * sizeof(double_t));
+BOOST_STATIC_ASSERT(sizeof(point2) == 2 * sizeof(double_t));
+BOOST_STATIC_ASSERT(sizeof(point3) == 3 * sizeof(double_t));
+BOOST_STATIC_ASSERT(sizeof(point4) == 4 * sizeof(double_t));
+BOOST_STATIC_ASSERT(sizeof(texture3) == 3 * sizeof(double_t));
+BOOST_STATIC_ASSERT(sizeof(vector2) == 2 * sizeof(double_t));
+BOOST_STATIC_ASSERT(sizeof(vector3) == 3 * sizeof(double_t));
+
+/// Returns true iff the host is little-endian
+inline bool_t little_endian()
+{
+	const uint16_t value = 1;
+	return *reinterpret_cast<const uint8_t*>(&value) == 1;
+}
+
+/// Returns true iff a buffer with the given struct-module format and item size contains values of the given scalar type (a NULL format means unsigned bytes)
+template<typename ScalarT>
+bool_t compatible_format(const char* Format, const Py_ssize_t ItemSize)
+{
+	if(ItemSize != sizeof(ScalarT))
+		return false;
+
+	if(!Format)
+		Format = "B";
+
+	// Skip native / standard byte-order prefixes, rejecting foreign byte-orders for multi-byte values ...
+	if(*Format == '@' || *Format == '=')
+		++Format;
+	else if(*Format == '<')
+	{
+		if(!little_endian() && sizeof(ScalarT) > 1)
+			return false;
+		++Format;
+	}
+	else if(*Format == '>' || *Format == '!')
+	{
+		if(little_endian() && sizeof(ScalarT) > 1)
+			return false;
+		++Format;
+	}
+
+	if(!Format[0] || Format[1])
+		return false;
+
+	char kind = 0;
+	switch(Format[0])
+	{
+		case 'e':
+		case 'f':
+		case 'd':
+			kind = 'f';
+			break;
+		case 'b':
+		case 'h':
+		case 'i':
+		case 'l':
+		case 'q':
+		case 'n':
+			kind = 'i';
+			break;
+		case 'B':
+		case 'H':
+		case 'I':
+		case 'L':
+		case 'Q':
+		case 'N':
+			kind = 'u';
+			break;
+	}
+
+	return kind == scalar_traits<ScalarT>::kind();
+}
+
+/// Returns the number of buffer views currently exported for each array.  Arrays with exported views can't be resized,
+/// since that could reallocate the storage the views point to.  Access is serialized by the Python global interpreter lock.
+inline std::map<const k3d::array*, uint_t>& exports()
+{
+	static std::map<const k3d::array*, uint_t> results;
+	return results;
+}
+
+/// Raises a Python BufferError if an array has exported buffer views, call this before doing anything that could resize the array
+inline void require_resizable(const k3d::array& Array)
+{
+	if(!exports().count(&Array))
+		return;
+
+	PyErr_SetString(PyExc_BufferError, "cannot resize an array while buffer views of its storage exist");
+	boost::python::throw_error_already_set();
+}
+
+/// Assigns a new generation to arrays that are exported writable, since they can be modified through the view at any time (see k3d::array::generation())
+inline void touch(k3d::array& Array)
+{
+	Array.touch();
+}
+
+inline void touch(const k3d::array&)
+{
+}
+
+/// Stores the state of an exported buffer view, which must remain valid until the view is released
+struct export_state
+{
+	/// Storage for shape and strides
+	Py_ssize_t dimensions[6];
+	/// The exported array
+	const k3d::array* array;
+};
+
+/// Implements the Python buffer protocol for a wrapped array.  Arrays of const elements
+/// are exported read-only, others are exported writable.
+template<typename array_type>
+class interface
+{
+public:
+	typedef instance_wrapper<array_type> wrapper_type;
+	typedef typename array_type::value_type value_type;
+	typedef element_traits<value_type> traits;
+	typedef typename traits::scalar_type scalar_type;
+	static const bool_t writable = !boost::is_const<array_type>::value;
+
+	/// Adds the buffer protocol to a wrapper class
+	static void define(boost::python::class_<wrapper_type>& Class)
+	{
+		PyTypeObject* const type = reinterpret_cast<PyTypeObject*>(Class.ptr());
+		type->tp_as_buffer->bf_getbuffer = &get_buffer;
+		type->tp_as_buffer->bf_releasebuffer = &release_buffer;
+#if PY_MAJOR_VERSION < 3
+		type->tp_flags |= Py_TPFLAGS_HAVE_NEWBUFFER;
+#endif
+	}
+
+	/// Replaces the contents of an array with the contents of a buffer, returns false if Value doesn't support the buffer protocol
+	static bool_t assign(array_type& Array, const boost::python::object& Value)
+	{
+#if PY_MAJOR_VERSION < 3
+		// Python 2 objects such as array.array only support the old buffer protocol ...
+		if(!PyObject_CheckBuffer(Value.ptr()))
+		{
+			if(!PyObject_HasAttrString(Value.ptr(), "typecode"))
+				return false;
+
+			const void* data = 0;
+			Py_ssize_t length = 0;
+			if(0 != PyObject_AsReadBuffer(Value.ptr(), &data, &length))
+			{
+				PyErr_Clear();
+				return false;
+			}
+
+			const string_t typecode = boost::python::extract<string_t>(Value.attr("typecode"));
+			const Py_ssize_t itemsize = boost::python::extract<Py_ssize_t>(Value.attr("itemsize"));
+			copy(Array, data, length, typecode.c_str(), itemsize);
+			return true;
+		}
+#else
+		if(!PyObject_CheckBuffer(Value.ptr()))
+			return false;
+#endif
+
+		Py_buffer view;
+		if(0 != PyObject_GetBuffer(Value.ptr(), &view, PyBUF_FORMAT | PyBUF_C_CONTIGUOUS))
+			boost::python::throw_error_already_set();
+
+		try
+		{
+			copy(Array, view.buf, view.len, view.format, view.itemsize);
+		}
+		catch(...)
+		{
+			PyBuffer_Release(&view);
+			throw;
+		}
+
+		PyBuffer_Release(&view);
+		return true;
+	}
+
+private:
+	static void copy(array_type& Array, const void* Data, const Py_ssize_t Length, const char* Format, const Py_ssize_t ItemSize)
+	{
+		if(!compatible_format<scalar_type>(Format, ItemSize))
+		{
+			std::ostringstream message;
+			message << "buffer format '" << (Format ? Format : "B") << "' with item size " << ItemSize << " doesn't match array format '" << scalar_traits<scalar_type>::format() << "'";
+			throw std::invalid_argument(message.str());
+		}
+
+		if(Length % sizeof(value_type))
+			throw std::invalid_argument("buffer length isn't a whole number of array elements");
+
+		if(Array.size() != static_cast<uint_t>(Length / sizeof(value_type)))
+			require_resizable(Array);
+
+		Array.resize(Length / sizeof(value_type));
+		if(Length)
+			std::memmove(&Array[0], Data, Length);
+	}
+
+	static int get_buffer(PyObject* Exporter, Py_buffer* View, int Flags)
+	{
+		View->obj = 0;
+
+		boost::python::extract<wrapper_type&> self(Exporter);
+		array_type* const array = self.check() ? self().wrapped_ptr() : 0;
+		if(!array)
+		{
+			PyErr_SetString(PyExc_BufferError, "wrapped array is null");
+			return -1;
+		}
+
+		if((Flags & PyBUF_WRITABLE) && !writable)
+		{
+			PyErr_SetString(PyExc_BufferError, "array is read-only");
+			return -1;
+		}
+
+		export_state* const state = new export_state();
+		state->array = array;
+
+		Py_ssize_t* const dimensions = state->dimensions;
+		dimensions[0] = array->size();
+		traits::shape(dimensions);
+		dimensions[traits::ndim + traits::ndim - 1] = sizeof(scalar_type);
+		for(int i = traits::ndim - 1; i > 0; --i)
+			dimensions[traits::ndim + i - 1] = dimensions[traits::ndim + i] * dimensions[i];
+
+		// Empty arrays still need a valid address ...
+		static scalar_type empty_storage = scalar_type();
+
+		View->buf = array->empty() ? static_cast<void*>(&empty_storage) : const_cast<value_type*>(&(*array)[0]);
+		View->obj = Exporter;
+		Py_INCREF(Exporter);
+		View->len = array->size() * sizeof(value_type);
+		View->readonly = !writable;
+		View->itemsize = sizeof(scalar_type);
+		View->format = (Flags & PyBUF_FORMAT) ? const_cast<char*>(scalar_traits<scalar_type>::format()) : 0;
+		View->ndim = traits::ndim;
+		View->shape = (Flags & PyBUF_ND) == PyBUF_ND ? dimensions : 0;
+		View->strides = (Flags & PyBUF_STRIDES) == PyBUF_STRIDES ? dimensions + traits::ndim : 0;
+		View->suboffsets = 0;
+		View->internal = state;
+
+		// Without shape information, consumers see the storage as a flat sequence of bytes ...
+		if(!View->shape)
+			View->ndim = 1;
+
+		++exports()[array];
+		touch(*array);
+
+		return 0;
+	}
+
+	static void release_buffer(PyObject*, Py_buffer* View)
+	{
+		export_state* const state = static_cast<export_state*>(View->internal);
+
+		std::map<const k3d::array*, uint_t>::iterator count = exports().find(state->array);
+		if(count != exports().end() && 0 == --count->second)
+			exports().erase(count);
+
+		delete state;
+	}
+};
+
+/// Adds the buffer protocol to a wrapper class, if the wrapped array has a supported element type
+template<typename array_type>
+void define_interface(boost::python::class_<instance_wrapper<array_type> >& Class, typename boost::enable_if_c<element_traits<typename array_type::value_type>::supported>::type* = 0)
+{
+	interface<array_type>::define(Class);
+}
+
+template<typename array_type>
+void define_interface(boost::python::class_<instance_wrapper<array_type> >&, typename boost::disable_if_c<element_traits<typename array_type::value_type>::supported>::type* = 0)
+{
+}
+
+/// Replaces the contents of an array with the contents of a buffer, returns false if the array element type or Value don't support the buffer protocol
+template<typename array_type>
+bool_t assign(array_type& Array, const boost::python::object& Value, typename boost::enable_if_c<element_traits<typename array_type::value_type>::supported>::type* = 0)
+{
+	return interface<array_type>::assign(Array, Value);
+}
+
+template<typename array_type>
+bool_t assign(array_type&, const boost::python::object&, typename boost::disable_if_c<element_traits<typename array_type::value_type>::supported>::type* = 0)
+{
+	return false;
+}
+
+} // namespace buffer
+
+} // namespace python
+
+} // namespace k3d
+
+#endif // !K3DSDK_PYTHON_ARRAY_BUFFER_PYTHON_H
+
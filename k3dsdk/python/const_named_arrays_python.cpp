@@ -40,7 +40,7 @@ static list keys(const_named_arrays_wrapper& Self)
 	list results;
 
 	for(k3d::named_arrays::const_iterator array = Self.wrapped().begin(); array != Self.wrapped().end(); ++array)
-		results.append(array->first);
+		results.append(array->first.str());
 
 	return results;
 }
@@ -50,7 +50,7 @@ static list keys(const_named_tables_wrapper& Self)
 	list results;
 
 	for(k3d::named_tables::const_iterator table = Self.wrapped().begin(); table != Self.wrapped().end(); ++table)
-		results.append(table->first);
+		results.append(table->first.str());
 
 	return results;
 }
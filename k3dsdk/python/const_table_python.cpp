@@ -40,7 +40,7 @@ static list keys(const_table_wrapper& Self)
 	list results;
 
 	for(k3d::table::const_iterator array = Self.wrapped().begin(); array != Self.wrapped().end(); ++array)
-		results.append(array->first);
+		results.append(array->first.str());
 
 	return results;
 }
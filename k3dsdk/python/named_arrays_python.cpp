@@ -78,7 +78,7 @@ static list keys(named_arrays_wrapper& Self)
 	list results;
 
 	for(k3d::named_arrays::const_iterator array = Self.wrapped().begin(); array != Self.wrapped().end(); ++array)
-		results.append(array->first);
+		results.append(array->first.str());
 
 	return results;
 }
@@ -115,6 +115,16 @@ public:
 		return wrap_owned(k3d::polyhedron::validate(Mesh.wrapped(), Primitive.wrapped()));
 	}
 
+	static uint_t compact(mesh_primitive_wrapper& Primitive)
+	{
+		return k3d::polyhedron::compact(Primitive.wrapped());
+	}
+
+	static uint_t expand(mesh_primitive_wrapper& Primitive)
+	{
+		return k3d::polyhedron::expand(Primitive.wrapped());
+	}
+
 	static bool_t is_triangles(polyhedron::const_primitive::wrapper& Polyhedron)
 	{
 		return k3d::polyhedron::is_triangles(Polyhedron.wrapped());
@@ -148,6 +158,12 @@ void define_namespace_polyhedron()
 		.def("validate", &polyhedron::validate)
 		.def("validate", &polyhedron::validate_const)
 		.staticmethod("validate")
+		.def("compact", &polyhedron::compact,
+			"Stores the topology arrays of a polyhedron using 32-bit indices where they fit, returning the number of arrays converted.")
+		.staticmethod("compact")
+		.def("expand", &polyhedron::expand,
+			"Converts any 32-bit topology arrays of a polyhedron back to full-width indices, returning the number of arrays converted.")
+		.staticmethod("expand")
 		.def("is_triangles", &polyhedron::is_triangles)
 		.def("is_triangles", &polyhedron::is_triangles2)
 		.staticmethod("is_triangles")
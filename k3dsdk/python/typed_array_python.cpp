@@ -23,6 +23,7 @@
 
 #include <boost/python.hpp>
 
+#include <k3dsdk/python/array_buffer_python.h>
 #include <k3dsdk/python/iunknown_python.h>
 #include <k3dsdk/python/typed_array_python.h>
 #include <k3dsdk/python/utility_python.h>
@@ -105,6 +106,7 @@ static const string_t array_str(instance_wrapper<array_type>& Self)
 template<typename array_type>
 static void append(instance_wrapper<array_type>& Self, const typename array_type::value_type& Value)
 {
+	buffer::require_resizable(Self.wrapped());
 	Self.wrapped().push_back(Value);
 }
 
@@ -133,11 +135,18 @@ static void append_inode(instance_wrapper<k3d::typed_array<k3d::inode*> >& Self,
 }
 
 template<typename array_type>
-static void assign(instance_wrapper<array_type>& Self, const boost::python::list& Value)
+static void assign(instance_wrapper<array_type>& Self, const boost::python::object& Value)
 {
 	array_type& storage = Self.wrapped();
 
+	// Copy buffers (array.array, numpy arrays, other K-3D arrays) in bulk ...
+	if(buffer::assign(storage, Value))
+		return;
+
 	const uint_t count = boost::python::len(Value);
+	if(count != storage.size())
+		buffer::require_resizable(storage);
+
 	storage.resize(count);
 	for(uint_t i = 0; i != count; ++i)
 		storage[i] = boost::python::extract<typename array_type::value_type>(Value[i]);
@@ -219,7 +228,8 @@ static void define_class_typed_array(const char* const ClassName, const char* co
 {
 	typedef instance_wrapper<array_type> wrapper_type;
 
-	boost::python::class_<wrapper_type>(ClassName, DocString, boost::python::no_init)
+	boost::python::class_<wrapper_type> wrapper_class(ClassName, DocString, boost::python::no_init);
+	wrapper_class
 		.def("__len__", &utility::wrapped_len<wrapper_type>)
 		.def("__getitem__", &utility::wrapped_get_item<wrapper_type, typename array_type::value_type>)
 		.def("__setitem__", &set_item<array_type>)
@@ -227,12 +237,14 @@ static void define_class_typed_array(const char* const ClassName, const char* co
 		.def("append", &append<array_type>,
 			"Append a value to the end of the array, growing its size by one.")
 		.def("assign", &assign<array_type>,
-			"Replace the contents of the array with a list of values.")
+			"Replace the contents of the array with a list of values, or with the contents of an object that supports the buffer protocol.")
 		.def("set_metadata_value", &set_metadata_value<wrapper_type>)
 		.def("get_metadata_value", &get_metadata_value<wrapper_type>)
 		.def("get_metadata", &get_metadata<wrapper_type>)
 		.def("erase_metadata_value", &erase_metadata_value<wrapper_type>)
 		;
+
+	buffer::define_interface<array_type>(wrapper_class);
 }
 
 template<>
@@ -95,7 +95,7 @@ void replace_selection(const nodes_t& Nodes, const UpdatePolicyT& UpdatePolicy,
 		const k3d::selection::set current_selection =
 			boost::any_cast<k3d::selection::set>(mesh_selection_sink->mesh_selection_sink_input().property_internal_value());
 
-		property::set_internal_value(mesh_selection_sink->mesh_selection_sink_input(), UpdatePolicy(*mesh, current_selection));
+		property::set_internal_value(mesh_selection_sink->mesh_selection_sink_input(), k3d::geometry::selection::compact(UpdatePolicy(*mesh, current_selection)));
 		property::set_internal_value(**node, "show_component_selection", VisibleSelection);
 	}
 }
@@ -278,7 +278,7 @@ void merge_interactive_selection(const nodes_t& Nodes, const UpdatePolicyT& Upda
 		const k3d::selection::set current_selection =
 			boost::any_cast<k3d::selection::set>(mesh_selection_sink->mesh_selection_sink_input().property_internal_value());
 
-		property::set_internal_value(mesh_selection_sink->mesh_selection_sink_input(), UpdatePolicy(*node, *mesh, current_selection, InteractiveSelection));
+		property::set_internal_value(mesh_selection_sink->mesh_selection_sink_input(), k3d::geometry::selection::compact(UpdatePolicy(*node, *mesh, current_selection, InteractiveSelection)));
 		property::set_internal_value(**node, "show_component_selection", true);
 	}
 }
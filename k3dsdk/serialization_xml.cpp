@@ -54,9 +54,21 @@
 #include <k3dsdk/xml.h>
 #include <k3dsdk/xpath.h>
 
+#include <k3dsdk/parallel/blocked_range.h>
+#include <k3dsdk/parallel/parallel_for.h>
+
 #include <boost/lexical_cast.hpp>
+#include <boost/mpl/bool.hpp>
 #include <boost/mpl/for_each.hpp>
 #include <boost/scoped_ptr.hpp>
+#include <boost/spirit/include/classic_core.hpp>
+#include <boost/spirit/include/classic_push_back_actor.hpp>
+#include <boost/static_assert.hpp>
+
+#include <glib.h>
+
+#include <algorithm>
+#include <cctype>
 
 namespace k3d
 {
@@ -1684,14 +1696,138 @@ void load_array_metadata(const element& Storage, array& Array, const ipersistent
 }
 
 /////////////////////////////////////////////////////////////////////////////
-// load_array
+// integer_text
+
+/// Parses a chunk of whitespace-separated integers, returning true iff the whole chunk was parsed
+template<typename component_type, typename parser_type>
+struct integer_text
+{
+	static bool_t parse(const char* Begin, const char* End, std::vector<component_type>& Components)
+	{
+		using namespace boost::spirit::classic;
+		return boost::spirit::classic::parse(Begin, End, *(parser_type()[push_back_a(Components)]) >> end_p, space_p).full;
+	}
+};
+
+/////////////////////////////////////////////////////////////////////////////
+// double_text
+
+/// Parses a chunk of whitespace-separated doubles, returning true iff the whole chunk was parsed.  Uses g_ascii_strtod(), which
+/// (unlike the Spirit real_parser) rounds correctly, so saved values round-trip exactly, and ignores the current locale.
+struct double_text
+{
+	static bool_t parse(const char* Begin, const char* End, std::vector<double_t>& Components)
+	{
+		while(true)
+		{
+			while(Begin != End && std::isspace(static_cast<unsigned char>(*Begin)))
+				++Begin;
+			if(Begin == End)
+				return true;
+
+			// Chunks always end at whitespace or the end of the text, so g_ascii_strtod() can't read past End ...
+			char* value_end = 0;
+			const double_t value = g_ascii_strtod(Begin, &value_end);
+			if(value_end == Begin || value_end > End)
+				return false;
+
+			Components.push_back(value);
+			Begin = value_end;
+		}
+	}
+};
+
+/////////////////////////////////////////////////////////////////////////////
+// array_text
+
+/// Describes the text representation of array values that can be parsed without iostreams: each value is
+/// stored as count consecutive numbers of component_type.  Values without a specialization are parsed using iostreams.
+template<typename value_type>
+struct array_text
+{
+	typedef boost::mpl::false_ numeric;
+};
+
+#define K3D_ARRAY_TEXT(value_type, component, parser, component_count) \
+template<> \
+struct array_text<value_type> \
+{ \
+	typedef boost::mpl::true_ numeric; \
+	typedef component component_type; \
+	typedef parser text_type; \
+	static const uint_t count = component_count; \
+	BOOST_STATIC_ASSERT(sizeof(value_type) == count * sizeof(component_type)); \
+};
+
+#define K3D_INTEGER_TEXT(type, parser) integer_text<type, boost::spirit::classic::parser<type> >
+
+K3D_ARRAY_TEXT(color, double_t, double_text, 3)
+K3D_ARRAY_TEXT(double_t, double_t, double_text, 1)
+K3D_ARRAY_TEXT(int16_t, int16_t, K3D_INTEGER_TEXT(int16_t, int_parser), 1)
+K3D_ARRAY_TEXT(int32_t, int32_t, K3D_INTEGER_TEXT(int32_t, int_parser), 1)
+K3D_ARRAY_TEXT(int64_t, int64_t, K3D_INTEGER_TEXT(int64_t, int_parser), 1)
+K3D_ARRAY_TEXT(matrix4, double_t, double_text, 16)
+K3D_ARRAY_TEXT(normal3, double_t, double_text, 3)
+K3D_ARRAY_TEXT(point2, double_t, double_text, 2)
+K3D_ARRAY_TEXT(point3, double_t, double_text, 3)
+K3D_ARRAY_TEXT(point4, double_t, double_text, 4)
+K3D_ARRAY_TEXT(texture3, double_t, double_text, 3)
+K3D_ARRAY_TEXT(uint16_t, uint16_t, K3D_INTEGER_TEXT(uint16_t, uint_parser), 1)
+K3D_ARRAY_TEXT(uint32_t, uint32_t, K3D_INTEGER_TEXT(uint32_t, uint_parser), 1)
+K3D_ARRAY_TEXT(uint64_t, uint64_t, K3D_INTEGER_TEXT(uint64_t, uint_parser), 1)
+K3D_ARRAY_TEXT(vector2, double_t, double_text, 2)
+K3D_ARRAY_TEXT(vector3, double_t, double_text, 3)
+
+#undef K3D_INTEGER_TEXT
+
+#undef K3D_ARRAY_TEXT
+
+/////////////////////////////////////////////////////////////////////////////
+// parse_components
+
+/// Parses chunks of whitespace-separated numbers in parallel
+template<typename traits>
+class parse_components
+{
+public:
+	typedef typename traits::component_type component_type;
+
+	parse_components(const string_t& Text, const std::vector<uint_t>& Boundaries, std::vector<std::vector<component_type> >& Components, std::vector<uint8_t>& Complete) :
+		m_text(Text),
+		m_boundaries(Boundaries),
+		m_components(Components),
+		m_complete(Complete)
+	{
+	}
+
+	void operator()(const parallel::blocked_range<uint_t>& Range) const
+	{
+		for(uint_t chunk = Range.begin(); chunk != Range.end(); ++chunk)
+		{
+			const char* const begin = m_text.data() + m_boundaries[chunk];
+			const char* const end = m_text.data() + m_boundaries[chunk + 1];
+
+			m_complete[chunk] = traits::text_type::parse(begin, end, m_components[chunk]);
+		}
+	}
+
+private:
+	const string_t& m_text;
+	const std::vector<uint_t>& m_boundaries;
+	std::vector<std::vector<component_type> >& m_components;
+	std::vector<uint8_t>& m_complete;
+};
 
+/////////////////////////////////////////////////////////////////////////////
+// load_values
+
+/// Loads array values using iostreams
 template<typename array_type>
-void load_array(const element& Storage, array_type& Array, const ipersistent::load_context& Context)
+void load_values(const string_t& Text, array_type& Array, boost::mpl::false_)
 {
 	typename array_type::value_type value;
 
-	std::istringstream buffer(Storage.text);
+	std::istringstream buffer(Text);
 	while(true)
 	{
 		buffer >> value;
@@ -1701,48 +1837,92 @@ void load_array(const element& Storage, array_type& Array, const ipersistent::lo
 
 		Array.push_back(value);
 	}
-
-	load_array_metadata(Storage, Array, Context);
 }
 
-/////////////////////////////////////////////////////////////////////////////
-// load_array
-
-void load_array(const element& Storage, typed_array<int8_t>& Array, const ipersistent::load_context& Context)
+/// Loads numeric array values, parsing large arrays in parallel chunks.  As with iostreams, parsing stops at the first malformed value.
+template<typename array_type>
+void load_values(const string_t& Text, array_type& Array, boost::mpl::true_)
 {
-	int16_t value;
+	typedef array_text<typename array_type::value_type> traits;
+	typedef typename traits::component_type component_type;
 
-	std::istringstream buffer(Storage.text);
-	while(true)
+	// Split the text into chunks at whitespace ...
+	static const uint_t chunk_size = 1024 * 1024;
+
+	std::vector<uint_t> boundaries(1, 0);
+	for(uint_t boundary = chunk_size; boundary < Text.size(); boundary += chunk_size)
 	{
-		buffer >> value;
+		while(boundary < Text.size() && !std::isspace(static_cast<unsigned char>(Text[boundary])))
+			++boundary;
+		boundaries.push_back(boundary);
+	}
+	boundaries.push_back(Text.size());
 
-		if(!buffer)
+	const uint_t chunk_count = boundaries.size() - 1;
+	std::vector<std::vector<component_type> > components(chunk_count);
+	std::vector<uint8_t> complete(chunk_count, false);
+	parallel::parallel_for(parallel::blocked_range<uint_t>(0, chunk_count, 1), parse_components<traits>(Text, boundaries, components, complete));
+
+	// Ignore everything after the first malformed chunk ...
+	uint_t component_count = 0;
+	for(uint_t chunk = 0; chunk != chunk_count; ++chunk)
+	{
+		component_count += components[chunk].size();
+		if(!complete[chunk])
 			break;
+	}
+
+	const uint_t value_count = component_count / traits::count;
+	const uint_t offset = Array.size();
+	Array.resize(offset + value_count);
+	if(!value_count)
+		return;
 
-		Array.push_back(static_cast<int8_t>(value));
+	// Copy components into place, releasing chunks as we go ...
+	component_type* output = reinterpret_cast<component_type*>(&Array[offset]);
+	component_type* const output_end = output + (value_count * traits::count);
+	for(uint_t chunk = 0; output != output_end; ++chunk)
+	{
+		const uint_t count = std::min(static_cast<uint_t>(components[chunk].size()), static_cast<uint_t>(output_end - output));
+		output = std::copy(components[chunk].begin(), components[chunk].begin() + count, output);
+		std::vector<component_type>().swap(components[chunk]);
 	}
+}
 
+/////////////////////////////////////////////////////////////////////////////
+// load_array
+
+template<typename array_type>
+void load_array(const element& Storage, array_type& Array, const ipersistent::load_context& Context)
+{
+	load_values(Storage.text, Array, typename array_text<typename array_type::value_type>::numeric());
 	load_array_metadata(Storage, Array, Context);
 }
 
 /////////////////////////////////////////////////////////////////////////////
 // load_array
 
-void load_array(const element& Storage, typed_array<uint8_t>& Array, const ipersistent::load_context& Context)
+void load_array(const element& Storage, typed_array<int8_t>& Array, const ipersistent::load_context& Context)
 {
-	uint16_t value;
+	typed_array<int16_t> values;
+	load_values(Storage.text, values, boost::mpl::true_());
 
-	std::istringstream buffer(Storage.text);
-	while(true)
-	{
-		buffer >> value;
+	Array.resize(values.size());
+	std::copy(values.begin(), values.end(), Array.begin());
 
-		if(!buffer)
-			break;
+	load_array_metadata(Storage, Array, Context);
+}
 
-		Array.push_back(static_cast<uint8_t>(value));
-	}
+/////////////////////////////////////////////////////////////////////////////
+// load_array
+
+void load_array(const element& Storage, typed_array<uint8_t>& Array, const ipersistent::load_context& Context)
+{
+	typed_array<uint16_t> values;
+	load_values(Storage.text, values, boost::mpl::true_());
+
+	Array.resize(values.size());
+	std::copy(values.begin(), values.end(), Array.begin());
 
 	load_array_metadata(Storage, Array, Context);
 }
@@ -1752,23 +1932,17 @@ void load_array(const element& Storage, typed_array<uint8_t>& Array, const ipers
 
 void load_array(const element& Storage, uint_t_array& Array, const ipersistent::load_context& Context)
 {
-	uint64_t value;
-
-	std::istringstream buffer(Storage.text);
-	while(true)
-	{
-		buffer >> value;
+	typed_array<uint64_t> values;
+	load_values(Storage.text, values, boost::mpl::true_());
 
-		if(!buffer)
-			break;
-
-		/** \note We clamp 64-bit values on 32-bit platforms.  This makes selections work. */
-		#if defined K3D_UINT_T_32_BITS
-			value = std::min(uint64_t(uint_t(-1)), value);
-		#endif 
+	/** \note We clamp 64-bit values on 32-bit platforms.  This makes selections work. */
+	#if defined K3D_UINT_T_32_BITS
+		for(typed_array<uint64_t>::iterator value = values.begin(); value != values.end(); ++value)
+			*value = std::min(uint64_t(uint_t(-1)), *value);
+	#endif 
 
-		Array.push_back(value);
-	}
+	Array.resize(values.size());
+	std::copy(values.begin(), values.end(), Array.begin());
 
 	load_array_metadata(Storage, Array, Context);
 }
@@ -1830,27 +2004,106 @@ void load_array(const element& Storage, typed_array<inode*>& Array, const ipersi
 }
 
 /////////////////////////////////////////////////////////////////////////////
-// load_array
+// array_loader
 
-template<typename array_type>
-void load_array(const element& Container, const string_t& Storage, pipeline_data<array_type>& Array, const ipersistent::load_context& Context)
+/// Collects the arrays in a mesh or selection as they're created, so their text can be parsed in parallel once the structure is in place.
+/// The text of each array is released from the XML once it has been parsed, so peak memory use doesn't include both representations of every array.
+class array_loader
 {
-	const element* const storage = find_element(Container, Storage);
-	if(!storage)
-		return;
+public:
+	array_loader(const ipersistent::load_context& Context) :
+		m_context(Context)
+	{
+	}
 
-	array_type* const array = Array ? &Array.writable() : &Array.create();
-	load_array(*storage, *array, Context);
-}
+	template<typename array_type>
+	void add(element& Storage, array_type& Array)
+	{
+		const load_t load = { &Storage, &Array, &load_deferred<array_type> };
+		m_loads.push_back(load);
+	}
+
+	/// Arrays of object references are loaded immediately, since the persistent lookup isn't thread-safe
+	void add(element& Storage, typed_array<imaterial*>& Array)
+	{
+		load_array(Storage, Array, m_context);
+		release(Storage);
+	}
+
+	/// Arrays of object references are loaded immediately, since the persistent lookup isn't thread-safe
+	void add(element& Storage, typed_array<inode*>& Array)
+	{
+		load_array(Storage, Array, m_context);
+		release(Storage);
+	}
+
+	/// Parses every array that has been added
+	void execute()
+	{
+		parallel::parallel_for(parallel::blocked_range<uint_t>(0, m_loads.size(), 1), execute_loads(m_loads, m_context));
+		m_loads.clear();
+	}
+
+private:
+	struct load_t
+	{
+		element* storage;
+		array* target;
+		void (*function)(const element&, array&, const ipersistent::load_context&);
+	};
+
+	template<typename array_type>
+	static void load_deferred(const element& Storage, array& Array, const ipersistent::load_context& Context)
+	{
+		load_array(Storage, static_cast<array_type&>(Array), Context);
+	}
+
+	static void release(element& Storage)
+	{
+		string_t().swap(Storage.text);
+		element::elements_t().swap(Storage.children);
+	}
+
+	class execute_loads
+	{
+	public:
+		execute_loads(const std::vector<load_t>& Loads, const ipersistent::load_context& Context) :
+			m_loads(Loads),
+			m_context(Context)
+		{
+		}
+
+		void operator()(const parallel::blocked_range<uint_t>& Range) const
+		{
+			for(uint_t i = Range.begin(); i != Range.end(); ++i)
+			{
+				const load_t& load = m_loads[i];
+				load.function(*load.storage, *load.target, m_context);
+				release(*load.storage);
+			}
+		}
+
+	private:
+		const std::vector<load_t>& m_loads;
+		const ipersistent::load_context& m_context;
+	};
+
+	const ipersistent::load_context& m_context;
+	std::vector<load_t> m_loads;
+};
+
+/////////////////////////////////////////////////////////////////////////////
+// load_array
 
 template<typename array_type>
-void load_array(const element& Container, const string_t& Storage, array_type& Array, const ipersistent::load_context& Context)
+void load_array(element& Container, const string_t& Storage, pipeline_data<array_type>& Array, array_loader& Loader)
 {
-	const element* const storage = find_element(Container, Storage);
+	element* const storage = find_element(Container, Storage);
 	if(!storage)
 		return;
 
-	load_array(*storage, Array, Context);
+	array_type* const array = Array ? &Array.writable() : &Array.create();
+	Loader.add(*storage, *array);
 }
 
 /////////////////////////////////////////////////////////////////////////////
@@ -1860,19 +2113,19 @@ template<typename arrays_t>
 class load_typed_array
 {
 public:
-	load_typed_array(const element& Storage, const string_t& Name, const string_t& Type, arrays_t& Arrays, const ipersistent::load_context& Context, k3d::bool_t& Loaded) :
+	load_typed_array(element& Storage, const string_t& Name, const string_t& Type, arrays_t& Arrays, array_loader& Loader, k3d::bool_t& Loaded) :
 		storage(Storage),
 		name(Name),
 		type(Type),
 		arrays(Arrays),
-		context(Context),
+		loader(Loader),
 		loaded(Loaded)
 	{
 		if(type == "k3d::uint_t")
 		{
 			loaded = true;
 			uint_t_array* const array = new uint_t_array();
-			load_array(storage, *array, context);
+			loader.add(storage, *array);
 			arrays.insert(std::make_pair(name, array));
 		}
 	}
@@ -1887,17 +2140,17 @@ public:
 		{
 			loaded = true;
 			typed_array<T>* const array = new typed_array<T>();
-			load_array(storage, *array, context);
+			loader.add(storage, *array);
 			arrays.insert(std::make_pair(name, array));
 		}
 	}
 
 private:
-	const element& storage;
+	element& storage;
 	const string_t& name;
 	const string_t& type;
 	arrays_t& arrays;
-	const ipersistent::load_context& context;
+	array_loader& loader;
 	k3d::bool_t& loaded;
 };
 
@@ -1905,11 +2158,11 @@ private:
 // load_arrays
 
 template<typename arrays_t>
-void load_arrays(const element& Container, arrays_t& Arrays, const ipersistent::load_context& Context)
+void load_arrays(element& Container, arrays_t& Arrays, array_loader& Loader)
 {
 	for(size_t i = 0; i != Container.children.size(); ++i)
 	{
-		const element& storage = Container.children[i];
+		element& storage = Container.children[i];
 
 		if(storage.name != "array")
 			continue;
@@ -1935,7 +2188,7 @@ void load_arrays(const element& Container, arrays_t& Arrays, const ipersistent::
 		}
 
 		bool loaded = false;
-		boost::mpl::for_each<named_array_types>(load_typed_array<arrays_t>(storage, name, type, Arrays, Context, loaded));
+		boost::mpl::for_each<named_array_types>(load_typed_array<arrays_t>(storage, name, type, Arrays, Loader, loaded));
 		if(!loaded)
 			log() << error << "array [" << name << "] with unknown type [" << type << "] will not be loaded" << std::endl;
 	}
@@ -1944,25 +2197,25 @@ void load_arrays(const element& Container, arrays_t& Arrays, const ipersistent::
 /////////////////////////////////////////////////////////////////////////////
 // load_arrays
 
-void load_arrays(const element& Container, const string_t& Storage, mesh::named_arrays_t& Arrays, const ipersistent::load_context& Context)
+void load_arrays(element& Container, const string_t& Storage, mesh::named_arrays_t& Arrays, array_loader& Loader)
 {
-	const element* const container = find_element(Container, Storage);
+	element* const container = find_element(Container, Storage);
 	if(!container)
 		return;
 
-	load_arrays<mesh::named_arrays_t>(*container, Arrays, Context);
+	load_arrays<mesh::named_arrays_t>(*container, Arrays, Loader);
 }
 
 /////////////////////////////////////////////////////////////////////////////
 // load_arrays
 
-void load_arrays(const element& Container, const string_t& Storage, mesh::table_t& Table, const ipersistent::load_context& Context)
+void load_arrays(element& Container, const string_t& Storage, mesh::table_t& Table, array_loader& Loader)
 {
-	const element* const container = find_element(Container, Storage);
+	element* const container = find_element(Container, Storage);
 	if(!container)
 		return;
 
-	load_arrays<mesh::table_t>(*container, Table, Context);
+	load_arrays<mesh::table_t>(*container, Table, Loader);
 }
 
 } // namespace detail
@@ -2014,42 +2267,45 @@ void save(const mesh& Mesh, element& Container, const ipersistent::save_context&
 
 void load(mesh& Mesh, element& Container, const ipersistent::load_context& Context)
 {
-	detail::load_array(Container, "points", Mesh.points, Context);
-	detail::load_array(Container, "point_selection", Mesh.point_selection, Context);
-	detail::load_arrays(Container, "point_attributes", Mesh.point_attributes, Context);
+	// Create every array first, then parse them in parallel ...
+	detail::array_loader loader(Context);
 
-	if(const element* const xml_primitives = find_element(Container, "primitives"))
+	detail::load_array(Container, "points", Mesh.points, loader);
+	detail::load_array(Container, "point_selection", Mesh.point_selection, loader);
+	detail::load_arrays(Container, "point_attributes", Mesh.point_attributes, loader);
+
+	if(element* const xml_primitives = find_element(Container, "primitives"))
 	{
-		for(element::elements_t::const_iterator xml_primitive = xml_primitives->children.begin(); xml_primitive != xml_primitives->children.end(); ++xml_primitive)
+		for(element::elements_t::iterator xml_primitive = xml_primitives->children.begin(); xml_primitive != xml_primitives->children.end(); ++xml_primitive)
 		{
 			if(xml_primitive->name != "primitive")
 				continue;
 
 			mesh::primitive& primitive = Mesh.primitives.create(attribute_text(*xml_primitive, "type"));
 
-			if(const element* const xml_structure = find_element(*xml_primitive, "structure"))
+			if(element* const xml_structure = find_element(*xml_primitive, "structure"))
 			{
-				for(element::elements_t::const_iterator xml_table = xml_structure->children.begin(); xml_table != xml_structure->children.end(); ++xml_table)
+				for(element::elements_t::iterator xml_table = xml_structure->children.begin(); xml_table != xml_structure->children.end(); ++xml_table)
 				{
 					if(xml_table->name != "table")
 						continue;
 
 					mesh::table_t arrays;
-					detail::load_arrays(*xml_table, arrays, Context);
+					detail::load_arrays(*xml_table, arrays, loader);
 
 					primitive.structure.insert(std::make_pair(attribute_text(*xml_table, "type"), arrays));
 				}
 			}
 
-			if(const element* const xml_attributes = find_element(*xml_primitive, "attributes"))
+			if(element* const xml_attributes = find_element(*xml_primitive, "attributes"))
 			{
-				for(element::elements_t::const_iterator xml_table = xml_attributes->children.begin(); xml_table != xml_attributes->children.end(); ++xml_table)
+				for(element::elements_t::iterator xml_table = xml_attributes->children.begin(); xml_table != xml_attributes->children.end(); ++xml_table)
 				{
 					if(xml_table->name != "table")
 						continue;
 
 					mesh::table_t arrays;
-					detail::load_arrays(*xml_table, arrays, Context);
+					detail::load_arrays(*xml_table, arrays, loader);
 
 					primitive.attributes.insert(std::make_pair(attribute_text(*xml_table, "type"), arrays));
 				}
@@ -2057,6 +2313,8 @@ void load(mesh& Mesh, element& Container, const ipersistent::load_context& Conte
 		}
 	}
 
+	loader.execute();
+
 /** \todo Remove this block of code no later than version 1.0
 
 This code has been left in-place in-case we ever need to load a K-3D file that contains pre-generic-primitive data.
@@ -2247,18 +2505,22 @@ void save(const selection::set& Selection, element& Container, const ipersistent
 
 void load(selection::set& Selection, element& Container, const ipersistent::load_context& Context)
 {
-	if(const element* const xml_set = find_element(Container, "set"))
+	detail::array_loader loader(Context);
+
+	if(element* const xml_set = find_element(Container, "set"))
 	{
-		for(element::elements_t::const_iterator xml_storage = xml_set->children.begin(); xml_storage != xml_set->children.end(); ++xml_storage)
+		for(element::elements_t::iterator xml_storage = xml_set->children.begin(); xml_storage != xml_set->children.end(); ++xml_storage)
 		{
 			if(xml_storage->name != "storage")
 				continue;
 
 			selection::storage& storage = Selection.create(attribute_text(*xml_storage, "type"));
-			if(const element* const xml_structure = find_element(*xml_storage, "structure"))
-				detail::load_arrays(*xml_structure, storage.structure, Context);
+			if(element* const xml_structure = find_element(*xml_storage, "structure"))
+				detail::load_arrays(*xml_structure, storage.structure, loader);
 		}
 	}
+
+	loader.execute();
 }
 
 /** \todo Remove this block of code no later than version 1.0
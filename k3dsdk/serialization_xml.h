@@ -32,12 +32,12 @@ void load_pipeline(idocument& Document, element& XML, const ipersistent::load_co
 
 /// Serializes a mesh to XML 
 void save(const mesh& Mesh, element& Container, const ipersistent::save_context& Context);
-/// Loads a mesh from XML 
+/// Loads a mesh from XML.  Array text is parsed in parallel, and released from the XML once it has been loaded.
 void load(mesh& Mesh, element& Container, const ipersistent::load_context& Context);
 
 /// Serializes a selection to XML 
 void save(const selection::set& Selection, element& Container, const ipersistent::save_context& Context);
-/// Loads a selection from XML 
+/// Loads a selection from XML.  Array text is released from the XML once it has been loaded.
 void load(selection::set& Selection, element& Container, const ipersistent::load_context& Context);
 
 } // namespace xml
@@ -0,0 +1,366 @@
+// K-3D
+// Copyright (c) 1995-2010, Timothy M. Shead
+//
+// Contact: tshead@k-3d.com
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+/** \file
+	\author Timothy M. Shead (tshead@k-3d.com)
+*/
+
+#include <k3dsdk/fstream.h>
+#include <k3dsdk/log.h>
+#include <k3dsdk/parallel/blocked_range.h>
+#include <k3dsdk/parallel/parallel_for.h>
+#include <k3dsdk/result.h>
+#include <k3dsdk/shader_cache.h>
+#include <k3dsdk/shader_compiler_ri.h>
+#include <k3dsdk/share.h>
+#include <k3dsdk/system.h>
+
+#include <boost/cstdint.hpp>
+
+#include <algorithm>
+#include <iomanip>
+#include <set>
+#include <sstream>
+
+namespace k3d
+{
+
+namespace ri
+{
+
+namespace detail
+{
+
+/// Reads the contents of a file into a string, returns false if the file can't be read
+bool_t read_file(const filesystem::path& File, string_t& Contents)
+{
+	filesystem::ifstream stream(File);
+	if(!stream.good())
+		return false;
+
+	std::ostringstream buffer;
+	buffer << stream.rdbuf();
+	Contents = buffer.str();
+	return true;
+}
+
+/// Computes a 64-bit FNV-1a hash incrementally.  We use our own hash instead of boost::hash, because cache keys must be stable across builds and platforms.
+class fnv1a
+{
+public:
+	fnv1a() :
+		m_hash(0xcbf29ce484222325ULL)
+	{
+	}
+
+	void append(const string_t& Data)
+	{
+		for(string_t::const_iterator c = Data.begin(); c != Data.end(); ++c)
+		{
+			m_hash ^= static_cast<unsigned char>(*c);
+			m_hash *= 0x100000001b3ULL;
+		}
+
+		// Hash a separator so that "ab" + "c" and "a" + "bc" produce different results ...
+		m_hash ^= 0xff;
+		m_hash *= 0x100000001b3ULL;
+	}
+
+	const string_t hex() const
+	{
+		std::ostringstream buffer;
+		buffer << std::hex << std::setfill('0') << std::setw(16) << m_hash;
+		return buffer.str();
+	}
+
+private:
+	boost::uint64_t m_hash;
+};
+
+/// Returns a stable key that identifies the directory containing a shader source file
+const string_t source_directory_key(const filesystem::path& Shader)
+{
+	fnv1a hash;
+	hash.append(Shader.branch_path().native_utf8_string().raw());
+	return hash.hex();
+}
+
+/// Extracts the file names from any #include directives in shader source code
+void parse_includes(const string_t& Source, std::vector<std::pair<string_t, bool_t> >& Includes)
+{
+	std::istringstream stream(Source);
+	for(string_t line; std::getline(stream, line); )
+	{
+		string_t::size_type i = line.find_first_not_of(" \t");
+		if(i == string_t::npos || line[i] != '#')
+			continue;
+
+		i = line.find_first_not_of(" \t", i + 1);
+		if(i == string_t::npos || line.compare(i, 7, "include") != 0)
+			continue;
+
+		i = line.find_first_not_of(" \t", i + 7);
+		if(i == string_t::npos || (line[i] != '"' && line[i] != '<'))
+			continue;
+
+		const char terminator = line[i] == '"' ? '"' : '>';
+		const string_t::size_type end = line.find(terminator, i + 1);
+		if(end == string_t::npos)
+			continue;
+
+		Includes.push_back(std::make_pair(line.substr(i + 1, end - i - 1), terminator == '"'));
+	}
+}
+
+void shader_dependencies(const filesystem::path& File, const string_t& Source, const std::vector<filesystem::path>& IncludePaths, std::set<filesystem::path>& Visited, std::vector<filesystem::path>& Dependencies)
+{
+	std::vector<std::pair<string_t, bool_t> > includes;
+	parse_includes(Source, includes);
+
+	for(std::vector<std::pair<string_t, bool_t> >::const_iterator include = includes.begin(); include != includes.end(); ++include)
+	{
+		// Quoted includes are searched relative to the including file first ...
+		std::vector<filesystem::path> search_paths;
+		if(include->second)
+			search_paths.push_back(File.branch_path());
+		search_paths.insert(search_paths.end(), IncludePaths.begin(), IncludePaths.end());
+
+		for(std::vector<filesystem::path>::const_iterator search_path = search_paths.begin(); search_path != search_paths.end(); ++search_path)
+		{
+			const filesystem::path candidate = *search_path / filesystem::generic_path(include->first);
+			if(!filesystem::exists(candidate))
+				continue;
+
+			if(Visited.insert(candidate).second)
+			{
+				string_t source;
+				if(read_file(candidate, source))
+				{
+					Dependencies.push_back(candidate);
+					shader_dependencies(candidate, source, IncludePaths, Visited, Dependencies);
+				}
+			}
+			break;
+		}
+	}
+}
+
+/// Returns the standard include paths for a shader
+const std::vector<filesystem::path> include_paths(const filesystem::path& Shader)
+{
+	std::vector<filesystem::path> results;
+	results.push_back(Shader.branch_path());
+	results.push_back(share_path() / filesystem::generic_path("shaders"));
+	return results;
+}
+
+/// Replaces every occurrence of a token in a string
+void replace_all(string_t& Text, const string_t& Token, const string_t& Replacement)
+{
+	for(string_t::size_type i = Text.find(Token); i != string_t::npos; i = Text.find(Token, i + Replacement.size()))
+		Text.replace(i, Token.size(), Replacement);
+}
+
+/// Stores the state of a single shader compilation
+struct compile_job
+{
+	filesystem::path shader;
+	string_t key;
+	filesystem::path object;
+	string_t command;
+};
+
+/// Runs shader compilers in parallel
+class compile_worker
+{
+public:
+	compile_worker(const std::vector<compile_job>& Jobs, std::vector<int>& Results) :
+		jobs(Jobs),
+		results(Results)
+	{
+	}
+
+	void operator()(const parallel::blocked_range<uint_t>& Range) const
+	{
+		for(uint_t i = Range.begin(); i != Range.end(); ++i)
+			results[i] = system::spawn_sync(jobs[i].command) ? 1 : 0;
+	}
+
+private:
+	const std::vector<compile_job>& jobs;
+	std::vector<int>& results;
+};
+
+} // namespace detail
+
+const std::vector<filesystem::path> shader_dependencies(const filesystem::path& Shader, const std::vector<filesystem::path>& IncludePaths)
+{
+	std::vector<filesystem::path> results;
+
+	string_t source;
+	if(!detail::read_file(Shader, source))
+		return results;
+
+	std::set<filesystem::path> visited;
+	visited.insert(Shader);
+	detail::shader_dependencies(Shader, source, IncludePaths, visited, results);
+
+	return results;
+}
+
+const string_t shader_cache_name(const filesystem::path& Shader, const string_t& Name)
+{
+	if(Shader.empty())
+		return Name;
+
+	return detail::source_directory_key(Shader) + "/" + Name;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// shader_compiler
+
+shader_compiler::shader_compiler(const string_t& Command, const string_t& BinaryExtension) :
+	m_command(Command),
+	m_binary_extension(BinaryExtension)
+{
+}
+
+const string_t shader_compiler::key(const filesystem::path& Shader) const
+{
+	detail::fnv1a hash;
+	hash.append(m_command);
+	hash.append(m_binary_extension);
+
+	string_t source;
+	detail::read_file(Shader, source);
+	hash.append(Shader.native_utf8_string().raw());
+	hash.append(source);
+
+	std::vector<filesystem::path> dependencies = shader_dependencies(Shader, detail::include_paths(Shader));
+	std::sort(dependencies.begin(), dependencies.end());
+	for(std::vector<filesystem::path>::const_iterator dependency = dependencies.begin(); dependency != dependencies.end(); ++dependency)
+	{
+		string_t dependency_source;
+		detail::read_file(*dependency, dependency_source);
+		hash.append(dependency->native_utf8_string().raw());
+		hash.append(dependency_source);
+	}
+
+	return hash.hex();
+}
+
+const filesystem::path shader_compiler::binary_path(const filesystem::path& Shader) const
+{
+	return shader_cache_path() / filesystem::generic_path(detail::source_directory_key(Shader)) / filesystem::generic_path(filesystem::replace_extension(Shader, m_binary_extension).leaf());
+}
+
+bool_t shader_compiler::compile(const filesystem::path& Shader) const
+{
+	shader_collection::shaders_t shaders;
+	shaders.insert(Shader);
+	return compile(shaders);
+}
+
+bool_t shader_compiler::compile(const shader_collection::shaders_t& Shaders) const
+{
+	const filesystem::path global_source_directory = share_path() / filesystem::generic_path("shaders");
+
+	// Figure-out which shaders need to be compiled ...
+	std::vector<detail::compile_job> cached;
+	std::vector<detail::compile_job> jobs;
+	for(shader_collection::shaders_t::const_iterator shader = Shaders.begin(); shader != Shaders.end(); ++shader)
+	{
+		detail::compile_job job;
+		job.shader = *shader;
+		job.key = key(*shader);
+		job.object = shader_cache_path() / filesystem::generic_path("objects") / filesystem::generic_path(job.key) / filesystem::generic_path(filesystem::replace_extension(*shader, m_binary_extension).leaf());
+
+		if(filesystem::exists(job.object))
+		{
+			cached.push_back(job);
+			continue;
+		}
+
+		filesystem::create_directories(job.object.branch_path());
+
+		job.command = m_command;
+		detail::replace_all(job.command, "$SOURCE_DIRECTORY", shader->branch_path().native_filesystem_string());
+		detail::replace_all(job.command, "$SOURCE", shader->native_filesystem_string());
+		detail::replace_all(job.command, "$GLOBAL_DIRECTORY", global_source_directory.native_filesystem_string());
+		detail::replace_all(job.command, "$BINARY_DIRECTORY", job.object.branch_path().native_filesystem_string());
+		detail::replace_all(job.command, "$BINARY", job.object.native_filesystem_string());
+
+		jobs.push_back(job);
+	}
+
+	// Run the compiler for every shader that wasn't cached ...
+	std::vector<int> results(jobs.size(), 0);
+	k3d::parallel::parallel_for(
+		k3d::parallel::blocked_range<uint_t>(0, jobs.size(), 1),
+		detail::compile_worker(jobs, results));
+
+	bool_t success = true;
+	for(uint_t i = 0; i != jobs.size(); ++i)
+	{
+		if(!results[i])
+		{
+			log() << error << "Error compiling shader [" << jobs[i].shader.native_console_string() << "]" << std::endl;
+			success = false;
+			continue;
+		}
+
+		if(!filesystem::exists(jobs[i].object))
+		{
+			log() << warning << "Shader compiler did not create [" << jobs[i].object.native_console_string() << "], shader will not be cached" << std::endl;
+			continue;
+		}
+
+		cached.push_back(jobs[i]);
+	}
+
+	// Publish compiled binaries where renderers can find them, unless they're already there ...
+	for(std::vector<detail::compile_job>::const_iterator job = cached.begin(); job != cached.end(); ++job)
+	{
+		const filesystem::path binary = binary_path(job->shader);
+		const filesystem::path stamp = binary + string_t(".key");
+
+		string_t published_key;
+		if(filesystem::exists(binary) && detail::read_file(stamp, published_key) && published_key == job->key)
+			continue;
+
+		filesystem::remove(binary);
+		filesystem::create_directories(binary.branch_path());
+		if(!filesystem::copy_file(job->object, binary))
+		{
+			log() << error << "Error copying [" << job->object.native_console_string() << "] to [" << binary.native_console_string() << "]" << std::endl;
+			success = false;
+			continue;
+		}
+
+		filesystem::ofstream stamp_stream(stamp);
+		stamp_stream << job->key;
+	}
+
+	return success;
+}
+
+} // namespace ri
+
+} // namespace k3d
+
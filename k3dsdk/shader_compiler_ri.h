@@ -0,0 +1,85 @@
+#ifndef K3DSDK_SHADER_COMPILER_RI_H
+#define K3DSDK_SHADER_COMPILER_RI_H
+
+// K-3D
+// Copyright (c) 1995-2010, Timothy M. Shead
+//
+// Contact: tshead@k-3d.com
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+/** \file
+	\author Timothy M. Shead (tshead@k-3d.com)
+*/
+
+#include <k3dsdk/path.h>
+#include <k3dsdk/shader_collection_ri.h>
+
+#include <vector>
+
+namespace k3d
+{
+
+namespace ri
+{
+
+/// Returns the set of files #included (directly or indirectly) by a shader, searching the shader's own directory and then the given include paths.
+/// Includes that can't be found are ignored (the shader compiler will report them).
+const std::vector<filesystem::path> shader_dependencies(const filesystem::path& Shader, const std::vector<filesystem::path>& IncludePaths);
+
+/// Returns the name that RIB files use to reference a shader compiled by shader_compiler: the shader name, prefixed with a shader cache
+/// subdirectory that is unique to the directory containing the shader source.  Returns Name unchanged if Shader is empty (renderer built-in shaders).
+const string_t shader_cache_name(const filesystem::path& Shader, const string_t& Name);
+
+/////////////////////////////////////////////////////////////////////////////
+// shader_compiler
+
+/// Compiles RenderMan shaders into the global shader cache on behalf of a RenderMan engine.
+///
+/// Compiled binaries are stored in the cache keyed on a hash of the shader source, every file it #includes,
+/// and the compiler command line, so editing an include file triggers recompilation.  The binary for the most-recently-used
+/// version of each shader is then copied into a per-source-directory subdirectory of the shader cache (see shader_cache_name()),
+/// where renderers look for it by name, so shaders that happen to share a filename never overwrite one-another's binaries.
+class shader_compiler
+{
+public:
+	/// Command is a template for the compiler command-line, in which the following tokens are replaced:
+	/// $SOURCE with the shader source file, $SOURCE_DIRECTORY with the directory containing the source file,
+	/// $GLOBAL_DIRECTORY with the K-3D shader directory, $BINARY with the compiled binary file, and
+	/// $BINARY_DIRECTORY with the directory that will contain the compiled binary.  BinaryExtension is the
+	/// extension (including the leading dot) that the compiler uses for its binaries.
+	shader_compiler(const string_t& Command, const string_t& BinaryExtension);
+
+	/// Compiles a single shader (if it isn't already cached), returns true on success
+	bool_t compile(const filesystem::path& Shader) const;
+	/// Compiles a set of shaders, running the compiler for every shader that isn't already cached in parallel.  Returns true iff every shader compiled successfully.
+	bool_t compile(const shader_collection::shaders_t& Shaders) const;
+
+	/// Returns the cache key for a shader
+	const string_t key(const filesystem::path& Shader) const;
+	/// Returns the path to the binary that renderers will load for a shader
+	const filesystem::path binary_path(const filesystem::path& Shader) const;
+
+private:
+	const string_t m_command;
+	const string_t m_binary_extension;
+};
+
+} // namespace ri
+
+} // namespace k3d
+
+#endif // !K3DSDK_SHADER_COMPILER_RI_H
+
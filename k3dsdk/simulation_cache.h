@@ -0,0 +1,122 @@
+#ifndef K3DSDK_SIMULATION_CACHE_H
+#define K3DSDK_SIMULATION_CACHE_H
+
+// K-3D
+// Copyright (c) 1995-2010, Timothy M. Shead
+//
+// Contact: tshead@k-3d.com
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+/** \file
+	\author Timothy M. Shead (tshead@k-3d.com)
+*/
+
+#include <k3dsdk/types.h>
+
+#include <cmath>
+#include <map>
+#include <vector>
+
+namespace k3d
+{
+
+/// Stores per-frame checkpoints of simulation state, so that simulations can read back previously-computed frames, and resume from the nearest earlier checkpoint when the user scrubs backwards or jumps in time.
+/// Each checkpoint is stored as a flat array of doubles, which keeps the cache compact and makes it trivial for simulations to pack / unpack their state.
+class simulation_cache
+{
+public:
+	/// Storage for a single checkpoint
+	typedef std::vector<double_t> state_t;
+
+	simulation_cache() :
+		m_tolerance(1e-9)
+	{
+	}
+
+	/// Stores a checkpoint for the given time, replacing any existing checkpoint for the same time
+	void store(const double_t Time, const state_t& State)
+	{
+		checkpoints_t::iterator checkpoint = m_checkpoints.lower_bound(Time - m_tolerance);
+		if(checkpoint != m_checkpoints.end() && checkpoint->first <= Time + m_tolerance)
+			checkpoint->second = State;
+		else
+			m_checkpoints.insert(checkpoint, std::make_pair(Time, State));
+	}
+
+	/// Returns the checkpoint stored for the given time, or NULL
+	const state_t* lookup(const double_t Time) const
+	{
+		checkpoints_t::const_iterator checkpoint = m_checkpoints.lower_bound(Time - m_tolerance);
+		if(checkpoint != m_checkpoints.end() && checkpoint->first <= Time + m_tolerance)
+			return &checkpoint->second;
+		return 0;
+	}
+
+	/// Returns the latest checkpoint at-or-before the given time, storing its time in CheckpointTime.  Returns NULL if there is no such checkpoint.
+	const state_t* nearest(const double_t Time, double_t& CheckpointTime) const
+	{
+		checkpoints_t::const_iterator checkpoint = m_checkpoints.upper_bound(Time + m_tolerance);
+		if(checkpoint == m_checkpoints.begin())
+			return 0;
+
+		--checkpoint;
+		CheckpointTime = checkpoint->first;
+		return &checkpoint->second;
+	}
+
+	/// Returns the index of the fixed-size simulation step nearest to the given time, with times before zero mapping to the initial state.
+	/// Simulations that always advance in whole steps on this grid produce the same state for a given time whether they got there by
+	/// playing every frame or by jumping directly from an earlier checkpoint.
+	static int64_t step_index(const double_t Time, const double_t StepSize)
+	{
+		return Time > 0 ? static_cast<int64_t>(std::floor(Time / StepSize + 0.5)) : 0;
+	}
+
+	/// Discards every checkpoint after the given time
+	void invalidate_after(const double_t Time)
+	{
+		m_checkpoints.erase(m_checkpoints.upper_bound(Time + m_tolerance), m_checkpoints.end());
+	}
+
+	/// Discards every checkpoint.  Call this whenever a parameter that affects the simulation changes.
+	void clear()
+	{
+		m_checkpoints.clear();
+	}
+
+	/// Returns the number of stored checkpoints
+	uint_t size() const
+	{
+		return m_checkpoints.size();
+	}
+
+	/// Returns true iff there are no stored checkpoints
+	bool_t empty() const
+	{
+		return m_checkpoints.empty();
+	}
+
+private:
+	typedef std::map<double_t, state_t> checkpoints_t;
+
+	const double_t m_tolerance;
+	checkpoints_t m_checkpoints;
+};
+
+} // namespace k3d
+
+#endif // !K3DSDK_SIMULATION_CACHE_H
+
@@ -0,0 +1,116 @@
+// K-3D
+// Copyright (c) 1995-2010, Timothy M. Shead
+//
+// Contact: tshead@k-3d.com
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+/** \file
+	\author Tim Shead (tshead@k-3d.com)
+*/
+
+#include <k3dsdk/fstream.h>
+#include <k3dsdk/gzstream.h>
+#include <k3dsdk/inetwork_render_job.h>
+#include <k3dsdk/irenderable_ri.h>
+#include <k3dsdk/log.h>
+#include <k3dsdk/render_state_ri.h>
+#include <k3dsdk/static_geometry_archives_ri.h>
+#include <k3dsdk/stream_io_ri.h>
+#include <k3dsdk/stream_ri.h>
+
+#include <boost/functional/hash.hpp>
+#include <boost/scoped_ptr.hpp>
+
+#include <sstream>
+
+namespace k3d
+{
+
+namespace ri
+{
+
+/////////////////////////////////////////////////////////////////////////////
+// static_geometry_archives
+
+static_geometry_archives::static_geometry_archives(inetwork_render_job& Job, const bool_t Compress) :
+	m_job(Job),
+	m_compress(Compress)
+{
+}
+
+void static_geometry_archives::render(irenderable& Renderable, const render_state& State, stream& Stream, std::ostream& RIBFile)
+{
+	// Capture the object's RIB into a buffer, allocating handles where the frame's stream left off ...
+	light_handle light_handles = 0;
+	object_handle object_handles = 0;
+	Stream.get_handles(light_handles, object_handles);
+
+	std::ostringstream buffer;
+	std::streamoff header_size = 0;
+	{
+		stream capture(buffer);
+		header_size = buffer.tellp();
+		capture.set_binary_encoding(binary_encoding(RIBFile));
+		capture.set_handles(light_handles, object_handles);
+
+		const render_state state(State.frame, capture, State.shaders, State.projection, State.render_context, State.sample_times, State.sample_index, State.camera_matrix);
+		Renderable.renderman_render(state);
+
+		capture.get_handles(light_handles, object_handles);
+	}
+
+	// Keep the frame's handles consistent with any handles the object allocated, whether its RIB is inline or archived ...
+	Stream.set_handles(light_handles, object_handles);
+
+	// Note that every handle the object allocates or references appears in its RIB, so unchanged RIB implies unchanged handles ...
+	const std::string rib = buffer.str();
+	const std::size_t hash = boost::hash<std::string>()(rib);
+
+	record& object_record = m_records[&Renderable];
+
+	// The object changed (or this is the first frame), so start over ...
+	if(object_record.hash != hash || object_record.size != rib.size())
+	{
+		object_record.hash = hash;
+		object_record.size = rib.size();
+		object_record.archive = filesystem::path();
+
+		RIBFile << rib.substr(header_size);
+		return;
+	}
+
+	// The object didn't change since the previous frame, so write an archive that every frame in the job can share, the first time around ...
+	if(object_record.archive.empty())
+	{
+		const filesystem::path archive = m_job.add_file("static-geometry.rib");
+		boost::scoped_ptr<std::ostream> archive_file(m_compress ? static_cast<std::ostream*>(new filesystem::ogzstream(archive)) : static_cast<std::ostream*>(new filesystem::ofstream(archive)));
+		if(!archive_file->good())
+		{
+			log() << error << "Error opening static geometry archive [" << archive.native_console_string() << "]" << std::endl;
+			RIBFile << rib.substr(header_size);
+			return;
+		}
+
+		*archive_file << rib;
+		object_record.archive = archive;
+	}
+
+	Stream.RiReadArchive(object_record.archive);
+}
+
+} // namespace ri
+
+} // namespace k3d
@@ -0,0 +1,82 @@
+#ifndef K3DSDK_STATIC_GEOMETRY_ARCHIVES_RI_H
+#define K3DSDK_STATIC_GEOMETRY_ARCHIVES_RI_H
+
+// K-3D
+// Copyright (c) 1995-2010, Timothy M. Shead
+//
+// Contact: tshead@k-3d.com
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+/** \file
+	\author Tim Shead (tshead@k-3d.com)
+*/
+
+#include <k3dsdk/path.h>
+
+#include <iosfwd>
+#include <map>
+
+namespace k3d
+{
+
+class inetwork_render_job;
+
+namespace ri
+{
+
+class irenderable;
+class render_state;
+class stream;
+
+/// Keeps track of the RIB generated for each renderable over the course of an animation render.  Renderables whose RIB
+/// doesn't change from one frame to the next are written once to an archive shared by every frame in the job, which
+/// subsequent frames reference with ReadArchive instead of repeating the geometry.
+class static_geometry_archives
+{
+public:
+	static_geometry_archives(inetwork_render_job& Job, const bool_t Compress);
+
+	/// Renders an object into the given RIB file, either inline or by referencing a shared archive.  Stream must be the
+	/// RIB stream writing to RIBFile - its light and object handles are kept consistent with any handles allocated by the object.
+	void render(irenderable& Renderable, const render_state& State, stream& Stream, std::ostream& RIBFile);
+
+private:
+	struct record
+	{
+		record() :
+			hash(0),
+			size(0)
+		{
+		}
+
+		/// Stores a hash of the RIB generated for the object in the most recent frame
+		std::size_t hash;
+		/// Stores the size of the RIB generated for the object in the most recent frame
+		std::size_t size;
+		/// Stores the path to a shared archive containing the object's RIB, or an empty path
+		filesystem::path archive;
+	};
+
+	inetwork_render_job& m_job;
+	const bool_t m_compress;
+	std::map<irenderable*, record> m_records;
+};
+
+} // namespace ri
+
+} // namespace k3d
+
+#endif // !K3DSDK_STATIC_GEOMETRY_ARCHIVES_RI_H
@@ -24,7 +24,15 @@
 
 #include <k3dsdk/stream_io_ri.h>
 #include <k3dsdk/texture3.h>
+
+#include <glibmm/thread.h>
+
+#include <boost/cstdint.hpp>
+
+#include <cstring>
+#include <map>
 #include <set>
+#include <sstream>
 
 namespace k3d
 {
@@ -77,19 +85,21 @@ bool print_parameter(const std::string& Type, std::ostream& Stream, const parame
 	if(array_t* const array = dynamic_cast<array_t*>(RHS.storage.get()))
 	{
 		// First, print the parameter name, with optional inline type info (only if inlining is enabled and the type isn't predefined) ...
-		Stream << "\"";
+		std::ostringstream name;
 
 		if(inline_types(Stream))
 		{
 			if(!detail::predefined_types().count(RHS.name))
 			{
-				Stream << RHS.storage_class << " " << Type << " ";
+				name << RHS.storage_class << " " << Type << " ";
 				if(RHS.tuple_size > 1)
-					Stream << "[" << RHS.tuple_size << "] ";
+					name << "[" << RHS.tuple_size << "] ";
 			}
 		}
 
-		Stream << RHS.name << "\" ";
+		name << RHS.name;
+
+		Stream << format_string(name.str()) << " ";
 
 		// Next, print the parameter values
 		Stream << format_array(array->begin(), array->end());
@@ -100,6 +110,127 @@ bool print_parameter(const std::string& Type, std::ostream& Stream, const parame
 	return false;
 }
 
+/// Returns storage for the binary encoding flag of an output stream
+long& binary_encoding_storage(std::ios& Stream)
+{
+	static const int index = std::ios_base::xalloc();
+	return Stream.iword(index);
+}
+
+/// Returns storage for the set of encoded requests that have already been defined in an output stream (256 bits, stored 32 bits at-a-time)
+long& defined_requests_storage(std::ios& Stream, const unsigned char Code)
+{
+	static const int indices[] =
+	{
+		std::ios_base::xalloc(), std::ios_base::xalloc(), std::ios_base::xalloc(), std::ios_base::xalloc(),
+		std::ios_base::xalloc(), std::ios_base::xalloc(), std::ios_base::xalloc(), std::ios_base::xalloc()
+	};
+
+	return Stream.iword(indices[Code / 32]);
+}
+
+/// Creates the mutex for request codes.  Glib mutexes constructed before Glib::thread_init() don't lock, so this can't be done during static initialization.
+Glib::Mutex* create_request_codes_mutex()
+{
+	if(!Glib::thread_supported())
+		Glib::thread_init();
+
+	return new Glib::Mutex();
+}
+
+/// Serializes access to the process-wide encoded request codes, since RIB may be written from more than one thread
+Glib::Mutex& request_codes_mutex()
+{
+	static Glib::Mutex* const mutex = create_request_codes_mutex();
+	return *mutex;
+}
+
+/// Returns the (process-wide) code assigned to an encoded request.  Because codes never change once assigned,
+/// RIB fragments encoded separately (e.g. archives) can be concatenated without their definitions conflicting.
+/// Returns -1 once all 256 codes have been assigned.
+int request_code(const char* const Name)
+{
+	Glib::Mutex::Lock lock(request_codes_mutex());
+
+	typedef std::map<std::string, int> codes_t;
+	static codes_t codes;
+
+	codes_t::iterator code = codes.find(Name);
+	if(code != codes.end())
+		return code->second;
+
+	if(codes.size() > 255)
+		return -1;
+
+	const int new_code = codes.size();
+	codes.insert(std::make_pair(std::string(Name), new_code));
+	return new_code;
+}
+
+/// Writes an unsigned value as a big-endian sequence of bytes
+void write_big_endian(std::ostream& Stream, const boost::uint32_t Value, const unsigned int ByteCount)
+{
+	for(unsigned int i = ByteCount; i != 0; --i)
+		Stream.put(static_cast<char>((Value >> ((i - 1) * 8)) & 0xff));
+}
+
+/// Returns the number of bytes required to store an unsigned length
+unsigned int length_bytes(const boost::uint32_t Value)
+{
+	if(Value < 0x100)
+		return 1;
+	if(Value < 0x10000)
+		return 2;
+	if(Value < 0x1000000)
+		return 3;
+	return 4;
+}
+
+void write_binary_string(std::ostream& Stream, const string& Value)
+{
+	if(Value.size() < 16)
+	{
+		Stream.put(static_cast<char>(0220 + Value.size()));
+	}
+	else
+	{
+		const unsigned int byte_count = length_bytes(Value.size());
+		Stream.put(static_cast<char>(0240 + byte_count - 1));
+		write_big_endian(Stream, Value.size(), byte_count);
+	}
+
+	Stream.write(Value.data(), Value.size());
+}
+
+void write_binary_integer(std::ostream& Stream, const integer Value)
+{
+	// Use the smallest encoding that can't be mistaken for a negative number ...
+	unsigned int byte_count = 4;
+	if(Value >= 0 && Value < 0x80)
+		byte_count = 1;
+	else if(Value >= 0 && Value < 0x8000)
+		byte_count = 2;
+	else if(Value >= 0 && Value < 0x800000)
+		byte_count = 3;
+
+	Stream.put(static_cast<char>(0200 + byte_count - 1));
+	write_big_endian(Stream, static_cast<boost::uint32_t>(Value), byte_count);
+}
+
+void write_binary_floats(std::ostream& Stream, const std::vector<float>& Values)
+{
+	const unsigned int byte_count = length_bytes(Values.size());
+	Stream.put(static_cast<char>(0310 + byte_count - 1));
+	write_big_endian(Stream, Values.size(), byte_count);
+
+	for(std::vector<float>::const_iterator value = Values.begin(); value != Values.end(); ++value)
+	{
+		boost::uint32_t bits;
+		std::memcpy(&bits, &(*value), sizeof(bits));
+		write_big_endian(Stream, bits, 4);
+	}
+}
+
 } // namespace detail
 
 ///////////////////////////////////////////////////////////////////////////////////
@@ -152,6 +283,57 @@ bool set_inline_types(std::ostream& Stream, const bool Enabled)
 	return old_state;
 }
 
+///////////////////////////////////////////////////////////////////////////////////////
+// binary_encoding
+
+bool binary_encoding(std::ostream& Stream)
+{
+	return detail::binary_encoding_storage(Stream) ? true : false;
+}
+
+bool set_binary_encoding(std::ostream& Stream, const bool Enabled)
+{
+	bool old_state = detail::binary_encoding_storage(Stream) ? true : false;
+	detail::binary_encoding_storage(Stream) = Enabled;
+	return old_state;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+// format_request
+
+format_request::format_request(const char* const Name) :
+	name(Name)
+{
+}
+
+std::ostream& operator<<(std::ostream& Stream, const format_request& RHS)
+{
+	if(binary_encoding(Stream))
+	{
+		const int code = detail::request_code(RHS.name);
+		if(code >= 0)
+		{
+			// Define the encoded request the first time it's used in this stream ...
+			long& defined_requests = detail::defined_requests_storage(Stream, code);
+			const unsigned long mask = 1UL << (code % 32);
+			if(!(static_cast<unsigned long>(defined_requests) & mask))
+			{
+				Stream.put(static_cast<char>(0314));
+				Stream.put(static_cast<char>(code));
+				detail::write_binary_string(Stream, RHS.name);
+				defined_requests = static_cast<long>(static_cast<unsigned long>(defined_requests) | mask);
+			}
+
+			Stream.put(static_cast<char>(0246));
+			Stream.put(static_cast<char>(code));
+			return Stream;
+		}
+	}
+
+	Stream << RHS.name;
+	return Stream;
+}
+
 /////////////////////////////////////////////////////////////////////////////////////////////////
 // format_string
 
@@ -162,6 +344,12 @@ format_string::format_string(const string& Token) :
 
 std::ostream& operator<<(std::ostream& Stream, const format_string& RHS)
 {
+	if(binary_encoding(Stream))
+	{
+		detail::write_binary_string(Stream, RHS.token);
+		return Stream;
+	}
+
 	Stream << "\"" << RHS.token << "\"";
 	return Stream;
 }
@@ -176,6 +364,19 @@ format_matrix::format_matrix(const matrix& Matrix) :
 
 std::ostream& operator<<(std::ostream& Stream, const format_matrix& RHS)
 {
+	if(binary_encoding(Stream))
+	{
+		std::vector<float> floats;
+		for(int i = 0; i != 4; ++i)
+		{
+			for(int j = 0; j != 4; ++j)
+				floats.push_back(RHS.m[j][i]);
+		}
+		detail::write_binary_floats(Stream, floats);
+
+		return Stream;
+	}
+
 	Stream << "[";
 	for(int i = 0; i != 4; ++i)
 	{
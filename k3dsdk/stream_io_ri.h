@@ -24,8 +24,12 @@
 	\author Tim Shead (tshead@k-3d.com)
 */
 
+#include <k3dsdk/texture3.h>
 #include <k3dsdk/types_ri.h>
 
+#include <iterator>
+#include <vector>
+
 namespace k3d
 {
 
@@ -40,6 +44,133 @@ bool inline_types(std::ostream& Stream);
 /// iostream-compatible manipulator that controls whether inline types are enabled for an output stream
 bool set_inline_types(std::ostream& Stream, const bool Enabled);
 
+/// iostream-compatible manipulator that returns true iff the binary RIB encoding is enabled for an output stream
+bool binary_encoding(std::ostream& Stream);
+/// iostream-compatible manipulator that controls whether an output stream uses the binary RIB encoding for requests, strings, and arrays
+bool set_binary_encoding(std::ostream& Stream, const bool Enabled);
+
+namespace detail
+{
+
+/// Writes a string using the binary RIB encoding
+void write_binary_string(std::ostream& Stream, const string& Value);
+/// Writes an integer using the binary RIB encoding
+void write_binary_integer(std::ostream& Stream, const integer Value);
+/// Writes an array of floats using the binary RIB encoding
+void write_binary_floats(std::ostream& Stream, const std::vector<float>& Values);
+
+inline void append_floats(std::vector<float>& Floats, const real Value)
+{
+	Floats.push_back(Value);
+}
+
+inline void append_floats(std::vector<float>& Floats, const point& Value)
+{
+	Floats.insert(Floats.end(), Value.n, Value.n + 3);
+}
+
+inline void append_floats(std::vector<float>& Floats, const vector& Value)
+{
+	Floats.insert(Floats.end(), Value.n, Value.n + 3);
+}
+
+inline void append_floats(std::vector<float>& Floats, const normal& Value)
+{
+	Floats.insert(Floats.end(), Value.n, Value.n + 3);
+}
+
+inline void append_floats(std::vector<float>& Floats, const texture3& Value)
+{
+	Floats.insert(Floats.end(), Value.n, Value.n + 3);
+}
+
+inline void append_floats(std::vector<float>& Floats, const color& Value)
+{
+	Floats.push_back(Value.red);
+	Floats.push_back(Value.green);
+	Floats.push_back(Value.blue);
+}
+
+inline void append_floats(std::vector<float>& Floats, const hpoint& Value)
+{
+	Floats.insert(Floats.end(), Value.n, Value.n + 4);
+}
+
+inline void append_floats(std::vector<float>& Floats, const matrix& Value)
+{
+	for(int i = 0; i != 4; ++i)
+		Floats.insert(Floats.end(), Value[i].n, Value[i].n + 4);
+}
+
+/// Writes arrays using the binary RIB encoding, returning false for value types without a binary encoding (which are written as ASCII instead)
+template<typename value_t>
+class binary_array
+{
+public:
+	template<typename iterator_t>
+	static bool write(std::ostream& Stream, const iterator_t Begin, const iterator_t End)
+	{
+		return false;
+	}
+};
+
+/// Writes arrays of floating-point values as a single encoded float array
+template<typename value_t, int tuple_size>
+class binary_float_array
+{
+public:
+	template<typename iterator_t>
+	static bool write(std::ostream& Stream, const iterator_t Begin, const iterator_t End)
+	{
+		std::vector<float> floats;
+		floats.reserve(tuple_size * std::distance(Begin, End));
+		for(iterator_t value = Begin; value != End; ++value)
+			append_floats(floats, *value);
+
+		write_binary_floats(Stream, floats);
+		return true;
+	}
+};
+
+/// Writes arrays of integer values as a sequence of encoded integers
+class binary_integer_array
+{
+public:
+	template<typename iterator_t>
+	static bool write(std::ostream& Stream, const iterator_t Begin, const iterator_t End)
+	{
+		Stream << "[";
+		for(iterator_t value = Begin; value != End; ++value)
+			write_binary_integer(Stream, static_cast<integer>(*value));
+		Stream << "]";
+		return true;
+	}
+};
+
+template<> class binary_array<integer> : public binary_integer_array {};
+template<> class binary_array<unsigned_integer> : public binary_integer_array {};
+template<> class binary_array<real> : public binary_float_array<real, 1> {};
+template<> class binary_array<point> : public binary_float_array<point, 3> {};
+template<> class binary_array<vector> : public binary_float_array<vector, 3> {};
+template<> class binary_array<normal> : public binary_float_array<normal, 3> {};
+template<> class binary_array<texture3> : public binary_float_array<texture3, 3> {};
+template<> class binary_array<color> : public binary_float_array<color, 3> {};
+template<> class binary_array<hpoint> : public binary_float_array<hpoint, 4> {};
+template<> class binary_array<matrix> : public binary_float_array<matrix, 16> {};
+
+} // namespace detail
+
+/// Formats a RIB request name, using an encoded request when the binary encoding is enabled; designed to be used as an inline formatting object
+class format_request
+{
+public:
+	explicit format_request(const char* const Name);
+	friend std::ostream& operator<<(std::ostream& Stream, const format_request& RHS);
+
+private:
+	const char* const name;
+};
+
 /// Formats a string with real-quotes for inclusion in a RIB file; designed to be used as an inline formatting object
 class format_string
 {
@@ -75,6 +206,9 @@ public:
 
 	friend std::ostream& operator << (std::ostream& Stream, const format_array_t& RHS)
 	{
+		if(binary_encoding(Stream) && detail::binary_array<value_t>::write(Stream, RHS.begin, RHS.end))
+			return Stream;
+
 		Stream << "[ ";
 		std::copy(RHS.begin, RHS.end, std::ostream_iterator<value_t>(Stream, " "));
 		Stream << "]";
@@ -100,6 +234,16 @@ public:
 
 	friend std::ostream& operator << (std::ostream& Stream, const format_array_t& RHS)
 	{
+		if(binary_encoding(Stream))
+		{
+			Stream << "[";
+			for(iterator_t element = RHS.begin; element != RHS.end; ++element)
+				detail::write_binary_string(Stream, *element);
+			Stream << "]";
+
+			return Stream;
+		}
+
 		Stream << "[ ";
 		for(iterator_t element = RHS.begin; element != RHS.end; ++element)
 			Stream << format_string(*element) << " ";
@@ -45,6 +45,12 @@ public:
 	~stream();
 
 	bool set_inline_types(const bool Inline);
+	/// Controls whether RIB is written using the binary encoding, returns the previous state
+	bool set_binary_encoding(const bool Binary);
+	/// Returns the most recently-allocated light and object handles
+	void get_handles(light_handle& LightHandle, object_handle& ObjectHandle) const;
+	/// Continues allocating light and object handles after the given values, so RIB written to more than one stream can be combined without handle conflicts
+	void set_handles(const light_handle LightHandle, const object_handle ObjectHandle);
 	void use_shader(const path& Path);
 
 	const light_handle RiAreaLightSourceV(const path& Path, const string& Name, const parameter_list& Parameters = parameter_list());
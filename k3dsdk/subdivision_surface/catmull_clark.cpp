@@ -37,6 +37,8 @@
 
 #include <boost/scoped_ptr.hpp>
 
+#include <limits>
+
 namespace k3d
 {
 
@@ -55,18 +57,113 @@ template<class ArrayT> void cumulative_sum(ArrayT& Array)
 		Array[i] += Array[i-1];
 }
 
-/// True if Face is the first face containing Point
-k3d::bool_t first_corner(const k3d::uint_t Face, const k3d::uint_t Point, const std::vector<k3d::mesh::indices_t>& PointFaces)
+/// Stores an index array using 32 bits per index whenever every value fits, falling back to k3d::uint_t otherwise
+class index_array
+{
+public:
+	index_array() :
+		m_compact(true)
+	{
+	}
+
+	/// Chooses the storage width for values up to and including MaximumValue, discarding the current contents
+	void set_maximum(const k3d::uint_t MaximumValue)
+	{
+		m_compact = MaximumValue <= std::numeric_limits<uint32_t>::max();
+		m_compact_indices.clear();
+		m_indices.clear();
+	}
+
+	k3d::bool_t compact() const
+	{
+		return m_compact;
+	}
+
+	k3d::mesh::compact_indices_t& compact_indices()
+	{
+		return m_compact_indices;
+	}
+
+	k3d::mesh::indices_t& indices()
+	{
+		return m_indices;
+	}
+
+	void assign(const k3d::uint_t Count, const k3d::uint_t Value)
+	{
+		if(m_compact)
+			m_compact_indices.assign(Count, static_cast<uint32_t>(Value));
+		else
+			m_indices.assign(Count, Value);
+	}
+
+	void set(const k3d::uint_t Index, const k3d::uint_t Value)
+	{
+		if(m_compact)
+			m_compact_indices[Index] = static_cast<uint32_t>(Value);
+		else
+			m_indices[Index] = Value;
+	}
+
+	k3d::uint_t operator[](const k3d::uint_t Index) const
+	{
+		return m_compact ? m_compact_indices[Index] : m_indices[Index];
+	}
+
+private:
+	k3d::bool_t m_compact;
+	k3d::mesh::compact_indices_t m_compact_indices;
+	k3d::mesh::indices_t m_indices;
+};
+
+/// Stores the lowest-numbered face containing each point, so first_corner() doesn't need a full point-face adjacency list
+void create_point_first_face_lookup(const k3d::uint_t PointCount, const k3d::polyhedron::const_primitive& Polyhedron, index_array& PointFirstFaces)
 {
-	const k3d::mesh::indices_t& faces = PointFaces[Point];
 	const k3d::uint_t face_begin = 0;
-	const k3d::uint_t face_end = faces.size();
-	for(k3d::uint_t i = face_begin; i != face_end; ++i)
+	const k3d::uint_t face_end = face_begin + Polyhedron.face_first_loops.size();
+
+	// Points that don't belong to any face store the face count, so the lookup needs room for one more than the largest face index ...
+	PointFirstFaces.set_maximum(face_end);
+	PointFirstFaces.assign(PointCount, face_end);
+
+	for(k3d::uint_t face = face_end; face != face_begin; )
 	{
-		if(faces[i] < Face)
-			return false;
+		--face;
+		const k3d::uint_t loop_begin = Polyhedron.face_first_loops[face];
+		const k3d::uint_t loop_end = loop_begin + Polyhedron.face_loop_counts[face];
+		for(k3d::uint_t loop = loop_begin; loop != loop_end; ++loop)
+		{
+			const k3d::uint_t first_edge = Polyhedron.loop_first_edges[loop];
+			for(k3d::uint_t edge = first_edge; ;)
+			{
+				PointFirstFaces.set(Polyhedron.vertex_points[edge], face);
+
+				edge = Polyhedron.clockwise_edges[edge];
+				if(edge == first_edge)
+					break;
+			}
+		}
 	}
-	return true;
+}
+
+/// Creates the lookup from each point to its outgoing edges, falling back to k3d::uint_t indices for polyhedra with 2^32 or more edges
+void create_point_out_edge_lookup(const k3d::uint_t PointCount, const k3d::mesh::indices_t& VertexPoints, index_array& PointFirstOutEdges, index_array& PointOutEdges)
+{
+	PointFirstOutEdges.set_maximum(VertexPoints.size());
+	PointOutEdges.set_maximum(VertexPoints.size());
+
+	if(PointFirstOutEdges.compact() && k3d::polyhedron::create_point_out_edge_lookup(PointCount, VertexPoints, PointFirstOutEdges.compact_indices(), PointOutEdges.compact_indices()))
+		return;
+
+	PointFirstOutEdges.set_maximum(std::numeric_limits<k3d::uint_t>::max());
+	PointOutEdges.set_maximum(std::numeric_limits<k3d::uint_t>::max());
+	k3d::polyhedron::create_point_out_edge_lookup(PointCount, VertexPoints, PointFirstOutEdges.indices(), PointOutEdges.indices());
+}
+
+/// True if Face is the first face containing Point
+k3d::bool_t first_corner(const k3d::uint_t Face, const k3d::uint_t Point, const index_array& PointFirstFaces)
+{
+	return Face <= PointFirstFaces[Point];
 }
 
 /// Stores references to commonly used arrays, and defines some common checks for faces and edges
@@ -144,14 +241,14 @@ class per_face_component_counter
 public:
 	per_face_component_counter(const mesh_arrays& MeshArrays,
 			const k3d::mesh::indices_t& EdgePoints,
-			const std::vector<k3d::mesh::indices_t>& PointFaces,
+			const index_array& PointFirstFaces,
 			k3d::mesh::counts_t& FaceSubfaceCounts,
 			k3d::mesh::counts_t& FaceSubloopCounts,
 			k3d::mesh::counts_t& FaceEdgeCounts,
 			k3d::mesh::counts_t& FacePointCounts) :
 		m_mesh_arrays(MeshArrays),
 		m_edge_points(EdgePoints),
-		m_point_faces(PointFaces),
+		m_point_first_faces(PointFirstFaces),
 		m_face_subface_counts(FaceSubfaceCounts),
 		m_face_subloop_counts(FaceSubloopCounts),
 		m_face_edge_counts(FaceEdgeCounts),
@@ -188,7 +285,7 @@ public:
 					
 					// Count the new corner points, respecting face order
 					
-					if(first_corner(Face, m_edge_points[m_mesh_arrays.clockwise_edges[edge]], m_point_faces))
+					if(first_corner(Face, m_edge_points[m_mesh_arrays.clockwise_edges[edge]], m_point_first_faces))
 					{
 						++point_count;
 					}
@@ -215,7 +312,7 @@ public:
 					++point_count; // Count the midpoint
 				}
 				
-				if(first_corner(Face, m_edge_points[m_mesh_arrays.clockwise_edges[edge]], m_point_faces))
+				if(first_corner(Face, m_edge_points[m_mesh_arrays.clockwise_edges[edge]], m_point_first_faces))
 					++point_count;
 				
 				edge = m_mesh_arrays.clockwise_edges[edge];
@@ -228,7 +325,7 @@ public:
 private:
 	const mesh_arrays& m_mesh_arrays;
 	const k3d::mesh::indices_t& m_edge_points;
-	const std::vector<k3d::mesh::indices_t>& m_point_faces;
+	const index_array& m_point_first_faces;
 	k3d::mesh::counts_t& m_face_subface_counts;
 	k3d::mesh::counts_t& m_face_subloop_counts;
 	k3d::mesh::counts_t& m_face_edge_counts;
@@ -241,7 +338,7 @@ class point_index_calculator
 public:
 	point_index_calculator(const mesh_arrays& MeshArrays,
 			const k3d::mesh::indices_t& EdgePoints,
-			std::vector<k3d::mesh::indices_t>& PointFaces,
+			const index_array& PointFirstFaces,
 			const k3d::mesh::counts_t& FacePointCounts,
 			k3d::mesh::indices_t& CornerPoints,
 			k3d::mesh::indices_t& EdgeMidpoints,
@@ -249,7 +346,7 @@ public:
 			) :
 				m_mesh_arrays(MeshArrays),
 				m_edge_points(EdgePoints),
-				m_point_faces(PointFaces),
+				m_point_first_faces(PointFirstFaces),
 				m_face_point_counts(FacePointCounts),
 				m_corner_points(CornerPoints),
 				m_edge_midpoints(EdgeMidpoints),
@@ -268,7 +365,7 @@ public:
 				const k3d::uint_t first_edge = m_mesh_arrays.loop_first_edges[loop];
 				for(k3d::uint_t edge = first_edge; ; )
 				{
-					if(first_corner(Face, m_edge_points[m_mesh_arrays.clockwise_edges[edge]], m_point_faces))
+					if(first_corner(Face, m_edge_points[m_mesh_arrays.clockwise_edges[edge]], m_point_first_faces))
 					{
 						const k3d::uint_t clockwise = m_mesh_arrays.clockwise_edges[edge]; 
 						m_corner_points[m_edge_points[clockwise]] = point_count;
@@ -296,7 +393,7 @@ public:
 					++point_count; // Count the midpoint
 				}
 				
-				if(first_corner(Face, m_edge_points[m_mesh_arrays.clockwise_edges[edge]], m_point_faces))
+				if(first_corner(Face, m_edge_points[m_mesh_arrays.clockwise_edges[edge]], m_point_first_faces))
 				{ 
 					m_corner_points[m_edge_points[clockwise]] = point_count;
 					++point_count;
@@ -312,7 +409,7 @@ public:
 private:
 	const mesh_arrays& m_mesh_arrays;
 	const k3d::mesh::indices_t& m_edge_points;
-	std::vector<k3d::mesh::indices_t>& m_point_faces;
+	const index_array& m_point_first_faces;
 	const k3d::mesh::counts_t& m_face_point_counts;
 	k3d::mesh::indices_t& m_corner_points;
 	k3d::mesh::indices_t& m_edge_midpoints;
@@ -750,7 +847,8 @@ public:
 			const k3d::mesh::indices_t& CornerPoints,
 			const k3d::mesh::indices_t& EdgeMidpoints,
 			const k3d::mesh::indices_t& FaceCenters,
-			const std::vector<k3d::mesh::indices_t>& PointOutEdges,
+			const index_array& PointFirstOutEdges,
+			const index_array& PointOutEdges,
 			const k3d::mesh::points_t& InputPoints,
 			k3d::mesh::points_t& OutputPoints,
 			k3d::table_copier& PointAttributesCopier,
@@ -761,6 +859,7 @@ public:
 		m_edge_midpoints(EdgeMidpoints),
 		m_face_centers(FaceCenters),
 		m_input_points(InputPoints),
+		m_point_first_out_edges(PointFirstOutEdges),
 		m_point_out_edges(PointOutEdges),
 		m_output_points(OutputPoints),
 		m_point_attributes_copier(PointAttributesCopier),
@@ -778,13 +877,12 @@ public:
 		// Get the number of outbound affected and boundary edges
 		k3d::uint_t affected_edge_count = 0;
 		k3d::uint_t boundary_edge_count = 0;
-		const k3d::mesh::indices_t& out_edges = m_point_out_edges[Point];
-		const k3d::uint_t valence = out_edges.size();
-		const k3d::uint_t start_index = 0;
-		const k3d::uint_t end_index = valence;
+		const k3d::uint_t start_index = m_point_first_out_edges[Point];
+		const k3d::uint_t end_index = m_point_first_out_edges[Point + 1];
+		const k3d::uint_t valence = end_index - start_index;
 		for(k3d::uint_t index = start_index; index != end_index; ++index)
 		{
-			const k3d::uint_t edge = out_edges[index];
+			const k3d::uint_t edge = m_point_out_edges[index];
 			const k3d::uint_t face = m_mesh_arrays.edge_faces[edge];
 			if(m_mesh_arrays.is_affected(face))
 				++affected_edge_count;
@@ -802,7 +900,7 @@ public:
 			k3d::mesh::indices_t face_indices(valence + 1); // indices of neighbor faces face vertices, for vertex attribute data
 			for(k3d::uint_t index = start_index; index != end_index; ++index)
 			{
-				const k3d::uint_t edge = out_edges[index];
+				const k3d::uint_t edge = m_point_out_edges[index];
 				const k3d::uint_t clockwise = m_mesh_arrays.clockwise_edges[edge];
 				const k3d::uint_t face = m_mesh_arrays.edge_faces[edge];
 				const k3d::vector3 next_corner = k3d::to_vector(m_input_points[m_input_edge_points[clockwise]]);
@@ -830,7 +928,7 @@ public:
 			k3d::uint_t boundary_indices[] = {m_corner_points[Point], 0};
 			for(k3d::uint_t index = start_index; index != end_index; ++index)
 			{
-				const k3d::uint_t edge = out_edges[index];
+				const k3d::uint_t edge = m_point_out_edges[index];
 				// we might also need to account for the counter-clockwise edge, since point_edges only stores outbound edges
 				k3d::uint_t counter_clockwise = edge;
 				for(; ;)
@@ -864,7 +962,8 @@ private:
 	const k3d::mesh::indices_t& m_corner_points;
 	const k3d::mesh::indices_t& m_edge_midpoints;
 	const k3d::mesh::indices_t& m_face_centers;
-	const std::vector<k3d::mesh::indices_t>& m_point_out_edges;
+	const index_array& m_point_first_out_edges;
+	const index_array& m_point_out_edges;
 	const k3d::mesh::points_t& m_input_points;
 	k3d::mesh::points_t& m_output_points;
 	k3d::table_copier& m_point_attributes_copier;
@@ -926,8 +1025,6 @@ public:
 		{
 			topology_data_t& topology_data = m_topology_data[level];
 			const k3d::mesh::points_t& input_points = level == 0 ? InputPoints : m_intermediate_points[level - 1];
-			k3d::mesh points_mesh; // temporary mesh so we have the point count in a form that is compatible with the lookup functions in k3d::polyhedron
-			points_mesh.points.create().resize(input_points.size());
 			boost::scoped_ptr<const k3d::polyhedron::const_primitive> input_polyhedron_ptr(0);
 			if (level != 0)
 			{
@@ -956,8 +1053,8 @@ public:
 			// Get the "companion" edge for each edge
 			k3d::mesh::bools_t boundary_edges;
 			k3d::polyhedron::create_edge_adjacency_lookup(input_polyhedron.vertex_points, input_polyhedron.clockwise_edges, boundary_edges, topology_data.companions);
-			std::vector<k3d::mesh::indices_t> point_faces;
-			k3d::polyhedron::create_point_face_lookup(points_mesh, input_polyhedron, point_faces);
+			detail::index_array point_first_faces;
+			detail::create_point_first_face_lookup(input_points.size(), input_polyhedron, point_first_faces);
 
 			// For each edge, get the face it belongs to
 			topology_data.edge_faces.resize(input_edge_count);
@@ -969,7 +1066,7 @@ public:
 			k3d::mesh::indices_t face_point_counts(input_face_count);
 			detail::per_face_component_counter per_face_component_counter(mesh_arrays,
 						input_polyhedron.vertex_points,
-						point_faces,
+						point_first_faces,
 						topology_data.face_subface_counts,
 						face_subloop_counts,
 						face_edge_counts,
@@ -991,7 +1088,7 @@ public:
 			topology_data.face_centers.resize(input_polyhedron.face_first_loops.size());
 			detail::point_index_calculator point_index_calculator(mesh_arrays,					
 					input_polyhedron.vertex_points,
-					point_faces,
+					point_first_faces,
 					face_point_counts,
 					topology_data.corner_points,
 					topology_data.edge_midpoints,
@@ -1046,7 +1143,7 @@ public:
 			output_polyhedron.edge_selections.assign(output_polyhedron.vertex_points.size(), 0.0);
 			
 			// Calculate vertex valences, needed for corner point updates.
-			k3d::polyhedron::create_point_out_edge_lookup(points_mesh, input_polyhedron, topology_data.point_out_edges);
+			detail::create_point_out_edge_lookup(input_points.size(), input_polyhedron.vertex_points, topology_data.point_first_out_edges, topology_data.point_out_edges);
 
 			// Assign a default vertex selection
 			output_polyhedron.vertex_selections = input_polyhedron.vertex_selections;
@@ -1147,6 +1244,7 @@ public:
 					topology_data.corner_points,
 					topology_data.edge_midpoints,
 					topology_data.face_centers,
+					topology_data.point_first_out_edges,
 					topology_data.point_out_edges,
 					input_points,
 					output_points,
@@ -1205,9 +1303,9 @@ public:
 				c0 = m_topology_data[level].corner_points[c0];
 				c1 = m_topology_data[level].corner_points[c1];
 				const k3d::uint_t midpoint = m_topology_data[level].edge_midpoints[first_edge];
-				const k3d::mesh::indices_t& point_edges = m_topology_data[level+1].point_out_edges[c0];
-				const k3d::uint_t point_edge_begin = 0;
-				const k3d::uint_t point_edge_end = point_edges.size();
+				const detail::index_array& point_edges = m_topology_data[level+1].point_out_edges;
+				const k3d::uint_t point_edge_begin = m_topology_data[level+1].point_first_out_edges[c0];
+				const k3d::uint_t point_edge_end = m_topology_data[level+1].point_first_out_edges[c0 + 1];
 				const polyhedron& polyhedron_at_level = m_intermediate_polyhedra[level];
 				const k3d::mesh::indices_t& edge_points = polyhedron_at_level.vertex_points;
 				const k3d::mesh::indices_t& clockwise_edges = polyhedron_at_level.clockwise_edges;
@@ -1311,7 +1409,8 @@ private:
 		k3d::mesh::indices_t face_centers; // Face center index, for each face (if any)
 		k3d::mesh::indices_t companions; // Companion edges
 		k3d::mesh::indices_t edge_faces; // For each original edge, the original owning face
-		std::vector<k3d::mesh::indices_t> point_out_edges; // Outgoing edge adjacency list
+		detail::index_array point_first_out_edges; // Offset of the first outgoing edge for each point, plus a final end offset
+		detail::index_array point_out_edges; // Outgoing edges, grouped by point
 		k3d::mesh::counts_t face_subface_counts; // Cumulative subface count for each input face (needed to copy uniform and face varying data)
 	};
 	
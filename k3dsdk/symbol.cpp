@@ -0,0 +1,227 @@
+// K-3D
+// Copyright (c) 1995-2010, Timothy M. Shead
+//
+// Contact: tshead@k-3d.com
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+/** \file
+	\author Timothy M. Shead (tshead@k-3d.com)
+*/
+
+#include <k3dsdk/symbol.h>
+
+#include <boost/functional/hash.hpp>
+
+#include <glibmm/thread.h>
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <vector>
+
+namespace k3d
+{
+
+namespace detail
+{
+
+/// Stores the contents of every symbol, using an open-addressed hash table so symbols can be looked-up without creating temporary strings.
+/// Each thread also keeps a small cache of the symbols it has looked-up recently, so repeated lookups of the same names don't need the lock.
+class symbol_table
+{
+public:
+	symbol_table() :
+		m_slots(1024)
+	{
+	}
+
+	const symbol_storage* intern(const char* String, const uint_t Length)
+	{
+		// FNV-1a
+		std::size_t hash = 2166136261u;
+		for(uint_t i = 0; i != Length; ++i)
+			hash = (hash ^ static_cast<unsigned char>(String[i])) * 16777619u;
+
+		// Symbol storage is never modified or freed once created, so it's safe to compare against cached symbols without the lock ...
+		lookup_cache* cache = m_caches.get();
+		if(!cache)
+		{
+			cache = new lookup_cache();
+			m_caches.set(cache);
+		}
+
+		const symbol_storage*& cached = cache->entries[hash & (lookup_cache::size - 1)];
+		if(cached && cached->string.size() == Length && 0 == std::memcmp(cached->string.data(), String, Length))
+			return cached;
+
+		cached = lookup(String, Length, hash);
+		return cached;
+	}
+
+	uint_t count()
+	{
+		Glib::Mutex::Lock lock(m_mutex);
+		return m_storage.size();
+	}
+
+private:
+	struct lookup_cache
+	{
+		lookup_cache()
+		{
+			std::fill(entries, entries + size, static_cast<const symbol_storage*>(0));
+		}
+
+		static const uint_t size = 256;
+		const symbol_storage* entries[size];
+	};
+
+	const symbol_storage* lookup(const char* String, const uint_t Length, const std::size_t Hash)
+	{
+		Glib::Mutex::Lock lock(m_mutex);
+
+		uint_t slot = Hash & (m_slots.size() - 1);
+		for(; m_slots[slot].entry; slot = (slot + 1) & (m_slots.size() - 1))
+		{
+			const string_t& existing = m_slots[slot].entry->string;
+			if(m_slots[slot].hash == Hash && existing.size() == Length && 0 == std::memcmp(existing.data(), String, Length))
+				return m_slots[slot].entry;
+		}
+
+		// Pack the leading characters big-endian and zero-padded, so integer order matches string order ...
+		symbol_storage storage;
+		storage.string.assign(String, Length);
+		storage.order = 0;
+		for(uint_t i = 0; i != 8; ++i)
+			storage.order = (storage.order << 8) | (i < Length ? static_cast<unsigned char>(String[i]) : 0);
+
+		// std::deque never relocates existing elements when growing, so symbols remain valid ...
+		m_storage.push_back(storage);
+		m_slots[slot].hash = Hash;
+		m_slots[slot].entry = &m_storage.back();
+
+		const symbol_storage* const result = &m_storage.back();
+
+		// Keep the table at-most half full ...
+		if(2 * m_storage.size() > m_slots.size())
+			grow();
+
+		return result;
+	}
+
+	struct slot_t
+	{
+		slot_t() :
+			hash(0),
+			entry(0)
+		{
+		}
+
+		std::size_t hash;
+		const symbol_storage* entry;
+	};
+
+	void grow()
+	{
+		std::vector<slot_t> slots(2 * m_slots.size());
+		for(std::vector<slot_t>::const_iterator old_slot = m_slots.begin(); old_slot != m_slots.end(); ++old_slot)
+		{
+			if(!old_slot->entry)
+				continue;
+
+			uint_t slot = old_slot->hash & (slots.size() - 1);
+			while(slots[slot].entry)
+				slot = (slot + 1) & (slots.size() - 1);
+			slots[slot] = *old_slot;
+		}
+		m_slots.swap(slots);
+	}
+
+	Glib::Mutex m_mutex;
+	std::deque<symbol_storage> m_storage;
+	std::vector<slot_t> m_slots;
+	Glib::Private<lookup_cache> m_caches;
+};
+
+/// Creates the global symbol table.  Symbols are routinely created during static initialization, so we have to
+/// initialize threading first, or the table's mutex and thread-local storage would never be thread-safe
+symbol_table* create_symbol_table()
+{
+	if(!Glib::thread_supported())
+		Glib::thread_init();
+
+	return new symbol_table();
+}
+
+/// Returns the global symbol table, which is never destroyed, so symbols remain valid during static destruction
+symbol_table& symbols()
+{
+	static symbol_table* const table = create_symbol_table();
+	return *table;
+}
+
+} // namespace detail
+
+symbol::symbol()
+{
+	static const detail::symbol_storage* const empty = detail::symbols().intern("", 0);
+	m_storage = empty;
+}
+
+symbol::symbol(const string_t& String) :
+	m_storage(detail::symbols().intern(String.data(), String.size()))
+{
+}
+
+symbol::symbol(const char* String) :
+	m_storage(detail::symbols().intern(String, std::strlen(String)))
+{
+}
+
+const char* symbol::c_str() const
+{
+	return m_storage->string.c_str();
+}
+
+bool_t symbol::empty() const
+{
+	return m_storage->string.empty();
+}
+
+uint_t symbol::size() const
+{
+	return m_storage->string.size();
+}
+
+uint_t symbol::count()
+{
+	return detail::symbols().count();
+}
+
+std::size_t hash_value(const symbol& Symbol)
+{
+	return boost::hash<const string_t*>()(&Symbol.str());
+}
+
+std::ostream& operator<<(std::ostream& Stream, const symbol& RHS)
+{
+	Stream << RHS.str();
+	return Stream;
+}
+
+} // namespace k3d
+
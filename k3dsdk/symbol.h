@@ -0,0 +1,131 @@
+#ifndef K3DSDK_SYMBOL_H
+#define K3DSDK_SYMBOL_H
+
+// K-3D
+// Copyright (c) 1995-2010, Timothy M. Shead
+//
+// Contact: tshead@k-3d.com
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+/** \file
+	\author Timothy M. Shead (tshead@k-3d.com)
+*/
+
+#include <k3dsdk/types.h>
+
+#include <cstddef>
+#include <iosfwd>
+
+namespace k3d
+{
+
+namespace detail
+{
+
+/// Stores the contents of a symbol, along with its first eight characters packed into an integer so most comparisons don't need to examine the string
+struct symbol_storage
+{
+	string_t string;
+	uint64_t order;
+};
+
+} // namespace detail
+
+/// Stores an interned, immutable string.  Every symbol created from the same sequence of characters refers to the same shared
+/// storage, so copying a symbol or testing two symbols for equality is as cheap as copying or comparing a pointer.  Symbols are
+/// ordered lexicographically, like the strings they contain, so they can replace strings as the keys of sorted containers without
+/// changing their iteration order.
+///
+/// Symbols convert implicitly to-and-from strings, but creating a symbol from a string requires a (thread-safe) lookup in a global
+/// table, so code that uses the same name repeatedly should create the symbol once and keep it:
+///
+/// \code
+/// static const k3d::symbol clockwise_edges("clockwise_edges");
+/// const k3d::mesh::indices_t* const array = structure.lookup<k3d::mesh::indices_t>(clockwise_edges);
+/// \endcode
+///
+/// Symbol storage is never freed, so symbols should only be used for names, not arbitrary text.
+class symbol
+{
+public:
+	/// Creates the empty symbol
+	symbol();
+	/// Creates (or returns the existing) symbol for a string
+	symbol(const string_t& String);
+	/// Creates (or returns the existing) symbol for a string
+	symbol(const char* String);
+
+	/// Returns the symbol contents
+	const string_t& str() const
+	{
+		return m_storage->string;
+	}
+	/// Returns the symbol contents
+	operator const string_t&() const
+	{
+		return m_storage->string;
+	}
+	/// Returns the symbol contents as a C string
+	const char* c_str() const;
+	/// Returns true iff this is the empty symbol
+	bool_t empty() const;
+	/// Returns the length of the symbol contents
+	uint_t size() const;
+
+	bool_t operator==(const symbol& Other) const
+	{
+		return m_storage == Other.m_storage;
+	}
+
+	bool_t operator!=(const symbol& Other) const
+	{
+		return m_storage != Other.m_storage;
+	}
+
+	bool_t operator<(const symbol& Other) const
+	{
+		if(m_storage->order != Other.m_storage->order)
+			return m_storage->order < Other.m_storage->order;
+
+		return m_storage != Other.m_storage && m_storage->string < Other.m_storage->string;
+	}
+
+	/// Returns the number of distinct symbols that have been created
+	static uint_t count();
+
+private:
+	const detail::symbol_storage* m_storage;
+};
+
+inline bool_t operator==(const symbol& LHS, const string_t& RHS) { return LHS.str() == RHS; }
+inline bool_t operator==(const string_t& LHS, const symbol& RHS) { return LHS == RHS.str(); }
+inline bool_t operator==(const symbol& LHS, const char* RHS) { return LHS.str() == RHS; }
+inline bool_t operator==(const char* LHS, const symbol& RHS) { return LHS == RHS.str(); }
+inline bool_t operator!=(const symbol& LHS, const string_t& RHS) { return LHS.str() != RHS; }
+inline bool_t operator!=(const string_t& LHS, const symbol& RHS) { return LHS != RHS.str(); }
+inline bool_t operator!=(const symbol& LHS, const char* RHS) { return LHS.str() != RHS; }
+inline bool_t operator!=(const char* LHS, const symbol& RHS) { return LHS != RHS.str(); }
+
+/// Returns a hash of a symbol for use with boost::hash (note: the result is only stable for the life of the process)
+std::size_t hash_value(const symbol& Symbol);
+
+/// Serializes a symbol to a stream
+std::ostream& operator<<(std::ostream& Stream, const symbol& RHS);
+
+} // namespace k3d
+
+#endif // !K3DSDK_SYMBOL_H
+
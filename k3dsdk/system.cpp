@@ -267,6 +267,17 @@ bool file_modification_time(const filesystem::path& File, time_t& ModificationTi
 	return true;
 }
 
+bool file_size(const filesystem::path& File, uint64_t& Size)
+{
+	struct stat statistics;
+	if(-1 == stat(File.native_filesystem_string().c_str(), &statistics))
+		return false;
+
+	Size = statistics.st_size;
+
+	return true;
+}
+
 bool spawn_async(const string_t& CommandLine)
 {
 	return_val_if_fail(!CommandLine.empty(), false);
@@ -60,6 +60,8 @@ const k3d::filesystem::path find_executable(const string_t& Executable);
 
 /// Returns the most recent modification time of a file
 bool file_modification_time(const filesystem::path& File, time_t& ModificationTime);
+/// Returns the size of a file in bytes
+bool file_size(const filesystem::path& File, uint64_t& Size);
 
 /// Runs an external process asynchronously.  Note: execs the process directly, do not use shell features!  The child process will have the same environment as its parent, and the PATH environment variable will be used to lookup the binary to be executed.
 bool spawn_async(const string_t& CommandLine);
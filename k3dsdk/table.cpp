@@ -29,13 +29,13 @@ namespace k3d
 ///////////////////////////////////////////////////////////////////////////
 // table
 
-const array* table::lookup(const string_t& Name) const
+const array* table::lookup(const symbol& Name) const
 {
 	const_iterator result = find(Name);
 	return result == end() ? static_cast<const array*>(0) : result->second.get();
 }
 
-array* table::writable(const string_t& Name)
+array* table::writable(const symbol& Name)
 {
 	iterator result = find(Name);
 	return result == end() ? static_cast<array*>(0) : &result->second.writable();
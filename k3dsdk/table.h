@@ -22,6 +22,7 @@
 
 #include <k3dsdk/difference.h>
 #include <k3dsdk/pipeline_data.h>
+#include <k3dsdk/symbol.h>
 #include <k3dsdk/types.h>
 
 #include <map>
@@ -35,16 +36,18 @@ class array;
 /// Defines a heterogeneous collection of named, shared arrays of equal length.  Note that the length of every
 /// array in the collection must remain equal at all times.
 /// For a concrete list of the datatypes that can be stored using k3d::table, see k3d::named_array_types.
+/// Arrays are keyed by k3d::symbol, so code that looks-up the same array repeatedly can keep a symbol for its name
+/// instead of paying for string comparisons on every call.  Strings can still be used wherever a name is expected.
 class table :
-	public std::map<string_t, pipeline_data<array> >
+	public std::map<symbol, pipeline_data<array> >
 {
-	typedef std::map<string_t, pipeline_data<array> > base;
+	typedef std::map<symbol, pipeline_data<array> > base;
 
 public:
 	/// Creates a new array with given name and type, inserting it into the table and returning a reference to the result.
 	/** \note: An existing array with the same name will be replaced by the new array. */
 	template<typename ArrayT>
-	ArrayT& create(const string_t& Name)
+	ArrayT& create(const symbol& Name)
 	{
 		ArrayT* const array = new ArrayT();
 		(*this)[Name].create(array);
@@ -53,24 +56,24 @@ public:
 	/// Inserts a new array into the table with the given name, returning a reference to the result.
 	/** \note: An existing array with the same name will be replaced by the new array. */
 	template<typename ArrayT>
-	ArrayT& create(const string_t& Name, ArrayT* Array)
+	ArrayT& create(const symbol& Name, ArrayT* Array)
 	{
 		(*this)[Name].create(Array);
 		return *Array;
 	}
 	/// Returns an existing array with the given name, or NULL if no matching array exists.
-	const array* lookup(const string_t& Name) const;
+	const array* lookup(const symbol& Name) const;
 	/// Returns an existing array with the given name and type, or NULL if no matching array exists.
 	template<typename ArrayT>
-	const ArrayT* lookup(const string_t& Name) const
+	const ArrayT* lookup(const symbol& Name) const
 	{
 		return dynamic_cast<const ArrayT*>(lookup(Name));
 	}
 	/// Returns an existing array with the given name, or NULL if no matching array exists.
-	array* writable(const string_t& Name);
+	array* writable(const symbol& Name);
 	/// Returns an existing array with the given name and type, or NULL if no matching array exists.
 	template<typename ArrayT>
-	ArrayT* writable(const string_t& Name)
+	ArrayT* writable(const symbol& Name)
 	{
 		return dynamic_cast<ArrayT*>(writable(Name));
 	}
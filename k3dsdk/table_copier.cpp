@@ -302,6 +302,18 @@ inode* weighted_sum(const typed_array<inode*>& Source, const uint_t Count, const
 	return result;
 }
 
+/// Returns true iff an array stores indices, using either k3d::uint_t or compact 32-bit values
+bool_t index_array(const array& Array)
+{
+	return dynamic_cast<const uint_t_array*>(&Array) || dynamic_cast<const typed_array<uint32_t>*>(&Array);
+}
+
+/// Returns true iff values can be copied between two arrays, which must have the same type, or both store indices
+bool_t compatible_arrays(const array& Source, const array& Target)
+{
+	return typeid(Source) == typeid(Target) || (index_array(Source) && index_array(Target));
+}
+
 ////////////////////////////////////////////////////////////////////////////
 // table_copier::implementation
 
@@ -319,23 +331,57 @@ public:
 		const table::iterator target_begin = Target.begin();
 		const table::iterator target_end = Target.end();
 	
-		uint_t target_index = 0;
-		for(table::iterator target = target_begin; target != target_end; ++target, ++target_index)
+		if(CopyPolicy.same_names_only())
 		{
+			// Both tables are sorted by name, so arrays with matching names can be paired in a single pass ...
+			table::const_iterator source = source_begin;
+			table::iterator target = target_begin;
 			uint_t source_index = 0;
-			for(table::const_iterator source = source_begin; source != source_end; ++source, ++source_index)
+			uint_t target_index = 0;
+			while(source != source_end && target != target_end)
 			{
+				if(source->first < target->first)
+				{
+					++source;
+					++source_index;
+					continue;
+				}
+
+				if(target->first < source->first)
+				{
+					++target;
+					++target_index;
+					continue;
+				}
+
 				if(CopyPolicy.copy(source->first, *source->second.get(), target->first, *target->second.get()))
 				{
 					used_source[source_index] = true;
 					used_target[target_index] = true;
+					create_copier(*source->second, target->first, target->second);
+				}
 
-					if(!copier_factory::create_copier(*source->second, target->second.writable(), copiers))
+				++source;
+				++source_index;
+				++target;
+				++target_index;
+			}
+		}
+		else
+		{
+			uint_t target_index = 0;
+			for(table::iterator target = target_begin; target != target_end; ++target, ++target_index)
+			{
+				uint_t source_index = 0;
+				for(table::const_iterator source = source_begin; source != source_end; ++source, ++source_index)
+				{
+					if(CopyPolicy.copy(source->first, *source->second.get(), target->first, *target->second.get()))
 					{
-						log() << error << "array [" << target->first << "] of unknown type [" << demangle(typeid(*target->second)) << "] will not receive data." << std::endl;
+						used_source[source_index] = true;
+						used_target[target_index] = true;
+						create_copier(*source->second, target->first, target->second);
+						break;
 					}
-
-					break;
 				}
 			}
 		}
@@ -392,6 +438,12 @@ public:
 	}
 
 private:
+	void create_copier(const array& Source, const symbol& TargetName, pipeline_data<array>& Target)
+	{
+		if(!copier_factory::create_copier(Source, Target.writable(), copiers))
+			log() << error << "array [" << TargetName << "] of unknown type [" << demangle(typeid(*Target)) << "] will not receive data." << std::endl;
+	}
+
 	/// Abstract interface for concrete objects that provide array-copying operations
 	class array_copier
 	{
@@ -445,7 +497,7 @@ private:
 			copiers(Copiers),
 			created(Created)
 		{
-			// Special-case handling for uint_t_array ...
+			// Special-case handling for uint_t_array, which can also be copied to-and-from compact indices ...
 			if(const uint_t_array* const typed_source = dynamic_cast<const uint_t_array*>(&source))
 			{
 				if(uint_t_array* const typed_target = dynamic_cast<uint_t_array*>(&target))
@@ -453,6 +505,19 @@ private:
 					copiers.push_back(new typed_array_copier<uint_t_array>(*typed_source, *typed_target));
 					created = true;
 				}
+				else if(typed_array<uint32_t>* const typed_target = dynamic_cast<typed_array<uint32_t>*>(&target))
+				{
+					copiers.push_back(new converting_array_copier<uint_t_array, typed_array<uint32_t> >(*typed_source, *typed_target));
+					created = true;
+				}
+			}
+			else if(const typed_array<uint32_t>* const typed_source = dynamic_cast<const typed_array<uint32_t>*>(&source))
+			{
+				if(uint_t_array* const typed_target = dynamic_cast<uint_t_array*>(&target))
+				{
+					copiers.push_back(new converting_array_copier<typed_array<uint32_t>, uint_t_array>(*typed_source, *typed_target));
+					created = true;
+				}
 			}
 		}
 
@@ -493,6 +558,43 @@ private:
 			array_t& target;
 		};
 
+		/// Concrete array_copier implementation that converts values between two array types
+		template<typename source_t, typename target_t>
+		class converting_array_copier :
+			public array_copier
+		{
+		public:
+			converting_array_copier(const source_t& Source, target_t& Target) :
+				source(Source),
+				target(Target)
+			{
+			}
+
+			void push_back(const uint_t Index)
+			{
+				target.push_back(static_cast<typename target_t::value_type>(source[Index]));
+			}
+
+			void push_back(const uint_t Count, const uint_t* Indices, const double_t* Weights)
+			{
+				target.push_back(static_cast<typename target_t::value_type>(weighted_sum(source, Count, Indices, Weights)));
+			}
+			
+			void copy(const uint_t SourceIndex, const uint_t TargetIndex)
+			{
+				target[TargetIndex] = static_cast<typename target_t::value_type>(source[SourceIndex]);
+			}
+
+			void copy(const uint_t Count, const uint_t* Indices, const double_t* Weights, const uint_t TargetIndex)
+			{
+				target[TargetIndex] = static_cast<typename target_t::value_type>(weighted_sum(source, Count, Indices, Weights));
+			}
+
+		private:
+			const source_t& source;
+			target_t& target;
+		};
+
 		const array& source;
 		array& target;
 		copiers_t& copiers;
@@ -511,7 +613,7 @@ bool_t table_copier::strict_copy::copy(const string_t& SourceName, const array&
 	if(SourceName != TargetName)
 		return false;
 
-	if(typeid(Source) != typeid(Target))
+	if(!compatible_arrays(Source, Target))
 	{
 		log() << error << "Source array [" << SourceName << "] of type [" << demangle(typeid(Source)) << "] does not match target array of type [" << demangle(typeid(Target)) << "]." << std::endl;
 		return false;
@@ -520,6 +622,11 @@ bool_t table_copier::strict_copy::copy(const string_t& SourceName, const array&
 	return true;
 }
 
+bool_t table_copier::strict_copy::same_names_only() const
+{
+	return true;
+}
+
 void table_copier::strict_copy::unused_source(const string_t& SourceName, const array& Source) const
 {
 	log() << error << "Source array [" << SourceName << "] of type [" << demangle(typeid(Source)) << "] has no corresponding target and will not supply data." << std::endl;
@@ -535,7 +642,12 @@ void table_copier::strict_copy::unused_target(const string_t& TargetName, const
 
 bool_t table_copier::copy_subset::copy(const string_t& SourceName, const array& Source, const string_t& TargetName, const array& Target) const
 {
-	return SourceName == TargetName && typeid(Source) == typeid(Target);
+	return SourceName == TargetName && compatible_arrays(Source, Target);
+}
+
+bool_t table_copier::copy_subset::same_names_only() const
+{
+	return true;
 }
 
 void table_copier::copy_subset::unused_source(const string_t&, const array&) const
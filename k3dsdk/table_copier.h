@@ -49,6 +49,8 @@ public:
 		virtual void unused_source(const string_t& SourceName, const array& Source) const = 0;
 		/// Called once for each target array that isn't used.  Implementations may optionally choose to generate errors.
 		virtual void unused_target(const string_t& TargetName, const array& Target) const = 0; 
+		/// Return true iff copy() never matches arrays with different names, so table_copier can pair arrays by name instead of testing every permutation.
+		virtual bool_t same_names_only() const { return false; }
 	};
 
 	/// Strict copy policy that matches arrays by name, generating errors for all unused arrays and arrays that match names but not types.
@@ -61,6 +63,7 @@ public:
 		bool_t copy(const string_t& SourceName, const array& Source, const string_t& TargetName, const array& Target) const; 
 		void unused_source(const string_t& SourceName, const array& Source) const; 
 		void unused_target(const string_t& TargetName, const array& Target) const; 
+		bool_t same_names_only() const;
 	};
 
 	/// Copy policy that matches arrays by name, quietly ignoring unused source arrays and arrays with mismatched types. This policy is useful
@@ -73,6 +76,7 @@ public:
 		bool_t copy(const string_t& SourceName, const array& Source, const string_t& TargetName, const array& Target) const; 
 		void unused_source(const string_t& SourceName, const array& Source) const; 
 		void unused_target(const string_t& TargetName, const array& Target) const; 
+		bool_t same_names_only() const;
 	};
 
 	/// Initializes table_copier to copy data from a source table to a target table, using a copy_policy
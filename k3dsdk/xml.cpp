@@ -83,26 +83,29 @@ std::ostream& indentation(std::ostream& Stream)
 	return Stream;
 }
 
-/// Returns the input string with leading and trailing whitespace removed
-const std::string trim(const std::string& String)
+/// Removes leading and trailing whitespace from a string in-place, releasing any excess capacity
+void trim(std::string& String)
 {
-	std::string::size_type string_size = String.size();
-
-	std::string::size_type start = 0;
-	for(; start != string_size; ++start)
+	std::string::size_type end = String.size();
+	for(; end; --end)
 	{
-		if(!isspace(String[start]))
+		if(!isspace(static_cast<unsigned char>(String[end-1])))
 			break;
 	}
 
-	std::string::size_type end = string_size;
-	for(; end != start; --end)
+	std::string::size_type start = 0;
+	for(; start != end; ++start)
 	{
-		if(!isspace(String[end-1]))
+		if(!isspace(static_cast<unsigned char>(String[start])))
 			break;
 	}
 
-	return std::string(String.substr(start, end - start));
+	String.erase(end);
+	String.erase(0, start);
+
+	// Text is accumulated a piece at a time, so large strings can have up-to twice the capacity they need ...
+	if(String.capacity() > String.size() + String.size() / 4)
+		std::string(String).swap(String);
 }
 
 /// Returns the input string, with special characters encoded for XML
@@ -130,6 +133,88 @@ const std::string encode(const std::string& String)
 	return result;
 }
 
+/// Builds an element tree from parser callbacks, passing elements to an optional element_handler as they are parsed
+class tree_builder
+{
+public:
+	tree_builder(xml::element& Root, element_handler* const Handler) :
+		root(Root),
+		handler(Handler),
+		skipped(0)
+	{
+	}
+
+	template<typename char_type>
+	void start_element(const char_type* Name, const char_type** Attributes)
+	{
+		// Ignore the contents of elements that the handler skipped ...
+		if(skipped)
+		{
+			++skipped;
+			return;
+		}
+
+		xml::element* current = &root;
+		if(element_stack.empty())
+		{
+			root.name = reinterpret_cast<const char*>(Name);
+		}
+		else
+		{
+			element_stack.top()->children.push_back(xml::element(reinterpret_cast<const char*>(Name)));
+			current = &element_stack.top()->children.back();
+		}
+
+		if(Attributes)
+		{
+			for(unsigned long i = 0; Attributes[i]; i+=2)
+				current->attributes.push_back(xml::attribute(reinterpret_cast<const char*>(Attributes[i]), reinterpret_cast<const char*>(Attributes[i+1])));
+		}
+
+		element_stack.push(current);
+
+		if(handler && !handler->start_element(*current, element_stack.size() - 1))
+			skipped = 1;
+	}
+
+	void end_element()
+	{
+		if(skipped > 1)
+		{
+			--skipped;
+			return;
+		}
+		skipped = 0;
+
+		if(element_stack.empty())
+			return;
+
+		xml::element* const current = element_stack.top();
+		trim(current->text);
+		element_stack.pop();
+
+		// An element is always the last child of its parent while it's being parsed, so it can be removed cheaply ...
+		if(handler && handler->end_element(*current, element_stack.size()) && !element_stack.empty())
+			element_stack.top()->children.pop_back();
+	}
+
+	template<typename char_type>
+	void character_data(const char_type* Data, int Length)
+	{
+		if(skipped || element_stack.empty())
+			return;
+
+		element_stack.top()->text.append(reinterpret_cast<const char*>(Data), Length);
+	}
+
+private:
+	xml::element& root;
+	element_handler* const handler;
+	/// Depth of nesting within an element skipped by the handler, or zero
+	unsigned long skipped;
+	std::stack<xml::element*> element_stack;
+};
+
 #ifdef K3D_HAVE_EXPAT
 
 /// Adaptor class that uses James Clark's expat library to parse a stream into an xml::element - replace this if you prefer some other parser
@@ -138,9 +223,12 @@ class expat_parser
 public:
 	typedef expat_parser this_t;
 
-	expat_parser() :
+	expat_parser(const bool RootOnly, element_handler* const Handler) :
 		parser(XML_ParserCreate(0)),
-		root(0)
+		builder(0),
+		handler(Handler),
+		root_only(RootOnly),
+		stopped(false)
 	{
 		XML_SetUserData(parser, this);
 		XML_SetStartElementHandler(parser, raw_start_element_handler);
@@ -153,67 +241,56 @@ public:
 		XML_ParserFree(parser);
 	}
 
-	const char* error_description()
+	const std::string error_description()
 	{
-		static std::string buffer;
-		buffer = XML_ErrorString(XML_GetErrorCode(parser)) + std::string(" line: ") + string_cast(XML_GetCurrentLineNumber(parser)) + std::string(" column: ") + string_cast(XML_GetCurrentColumnNumber(parser));
-		
-		return buffer.c_str();
+		return XML_ErrorString(XML_GetErrorCode(parser)) + std::string(" line: ") + string_cast(XML_GetCurrentLineNumber(parser)) + std::string(" column: ") + string_cast(XML_GetCurrentColumnNumber(parser));
 	}
 
 	void parse(xml::element& Root, std::istream& InputStream, const std::string&, progress& Progress)
 	{
-		root = &Root;
+		tree_builder tree(Root, handler);
+		builder = &tree;
 
-		while(!element_stack.empty())
-			element_stack.pop();
-
-		std::vector<char> buffer(1024);
+		std::vector<char> buffer(64 * 1024);
 		for(InputStream.read(&buffer[0], buffer.size()); InputStream; InputStream.read(&buffer[0], buffer.size()))
 		{
 			Progress.show_activity();
 			if(XML_STATUS_ERROR == XML_Parse(parser, &buffer[0], InputStream.gcount(), false))
+			{
+				if(stopped)
+					return;
 				throw std::runtime_error(error_description());
+			}
 		}
 		Progress.show_activity();
 		if(XML_STATUS_ERROR == XML_Parse(parser, &buffer[0], InputStream.gcount(), true))
+		{
+			if(stopped)
+				return;
 			throw std::runtime_error(error_description());
+		}
 	}
 
 private:
 	void start_element_handler(const XML_Char* Name, const XML_Char** Attributes)
 	{
-		if(element_stack.empty())
-		{
-			root->name = Name;
-			element_stack.push(root);
-		}
-		else
-		{
-			element_stack.top()->children.push_back(xml::element(Name));
-			element_stack.push(&element_stack.top()->children.back());
-		}
+		builder->start_element(Name, Attributes);
 
-
-		if(Attributes)
+		if(root_only)
 		{
-			for(unsigned long i = 0; Attributes[i]; i+=2)
-				element_stack.top()->attributes.push_back(xml::attribute(Attributes[i], Attributes[i+1]));
+			stopped = true;
+			XML_StopParser(parser, XML_FALSE);
 		}
 	}
 
 	void end_element_handler(const XML_Char*)
 	{
-		if(!element_stack.empty())
-		{
-			element_stack.top()->text = trim(element_stack.top()->text);
-			element_stack.pop();
-		}
+		builder->end_element();
 	}
 
 	void character_data_handler(const XML_Char* Data, int Length)
 	{
-		element_stack.top()->text += std::string(Data, Length);
+		builder->character_data(Data, Length);
 	}
 
 	static void raw_start_element_handler(void* UserData, const XML_Char* Name, const XML_Char** Attributes)
@@ -232,22 +309,40 @@ private:
 	}
 
 	XML_Parser parser;
-	xml::element* root;
-	std::stack<xml::element*> element_stack;
+	tree_builder* builder;
+	element_handler* const handler;
+	/// Set to true if parsing should stop after the root element's start tag
+	const bool root_only;
+	bool stopped;
 };
 
 #endif // K3D_HAVE_EXPAT
 
 #ifdef K3D_HAVE_LIBXML2
 
+/// Initializes libxml2 at startup, since the first call to xmlInitParser() isn't safe when documents are parsed concurrently
+struct libxml2_initializer
+{
+	libxml2_initializer()
+	{
+		xmlInitParser();
+	}
+};
+
+static libxml2_initializer libxml2_initialize;
+
 /// Adaptor class that uses the Gnome libxml2 library to parse a stream into an xml::element - replace this if you prefer some other parser
 class libxml2_parser
 {
 public:
 	typedef libxml2_parser this_t;
 
-	libxml2_parser() :
-		root(0)
+	libxml2_parser(const bool RootOnly, element_handler* const Handler) :
+		context(0),
+		builder(0),
+		handler(Handler),
+		root_only(RootOnly),
+		stopped(false)
 	{
 		memset(&sax_handler, 0, sizeof(sax_handler));
 		sax_handler.startElement = raw_start_element_handler;
@@ -262,37 +357,42 @@ public:
 	{
 		parser_context parser(xmlCreatePushParserCtxt(&sax_handler, this, 0, 0, StreamName.c_str()));
 		xmlCtxtUseOptions(parser, XML_PARSE_NOENT);
+		context = parser;
 		
-		root = &Root;
+		tree_builder tree(Root, handler);
+		builder = &tree;
 
-		while(!element_stack.empty())
-			element_stack.pop();
-
-		std::vector<char> buffer(1024);
+		std::vector<char> buffer(64 * 1024);
 		for(InputStream.read(&buffer[0], buffer.size()); InputStream; InputStream.read(&buffer[0], buffer.size()))
 		{
 			Progress.show_activity();
 			if(XML_ERR_OK != xmlParseChunk(parser, &buffer[0], InputStream.gcount(), false))
+			{
+				if(stopped)
+					return;
 				throw std::runtime_error(error_description(parser));
+			}
 		}
 		Progress.show_activity();
 		if(XML_ERR_OK != xmlParseChunk(parser, &buffer[0], InputStream.gcount(), true))
+		{
+			if(stopped)
+				return;
 			throw std::runtime_error(error_description(parser));
+		}
 	}
 
 private:
-	const char* error_description(xmlParserCtxtPtr Context)
+	const std::string error_description(xmlParserCtxtPtr Context)
 	{
 		std::ostringstream buffer;
 
 		buffer << "XML parsing error";
 		
-		static std::string results;
-
-		results = buffer.str();
+		std::string results = buffer.str();
 		results.erase(std::remove(results.begin(), results.end(), '\n'), results.end());
 
-		return results.c_str();
+		return results;
 	}
 
 	class parser_context
@@ -317,44 +417,25 @@ private:
 		xmlParserCtxtPtr context;
 	};
 
-	// This may-or-may-not-be safe-to-do, but at least it's all in one place
-	static const char* utf8_to_char(const xmlChar* RHS)
-	{
-		return reinterpret_cast<const char*>(RHS);
-	}
-
 	void start_element_handler(const xmlChar* Name, const xmlChar** Attributes)
 	{
-		if(element_stack.empty())
-		{
-			root->name = utf8_to_char(Name);
-			element_stack.push(root);
-		}
-		else
-		{
-			element_stack.top()->children.push_back(k3d::xml::element(utf8_to_char(Name)));
-			element_stack.push(&element_stack.top()->children.back());
-		}
+		builder->start_element(Name, Attributes);
 
-		if(Attributes)
+		if(root_only)
 		{
-			for(unsigned long i = 0; Attributes[i]; i+=2)
-				element_stack.top()->attributes.push_back(k3d::xml::attribute(utf8_to_char(Attributes[i]), utf8_to_char(Attributes[i+1])));
+			stopped = true;
+			xmlStopParser(context);
 		}
 	}
 
 	void end_element_handler(const xmlChar* Name)
 	{
-		if(!element_stack.empty())
-		{
-			element_stack.top()->text = trim(element_stack.top()->text);
-			element_stack.pop();
-		}
+		builder->end_element();
 	}
 
 	void character_data_handler(const xmlChar* Data, int Length)
 	{
-		element_stack.top()->text += std::string(utf8_to_char(Data), Length);
+		builder->character_data(Data, Length);
 	}
 
 	static void raw_start_element_handler(void* UserData, const xmlChar* Name, const xmlChar** Attributes)
@@ -415,8 +496,12 @@ private:
 	}
 
 	xmlSAXHandler sax_handler;
-	k3d::xml::element* root;
-	std::stack<k3d::xml::element*> element_stack;
+	xmlParserCtxtPtr context;
+	tree_builder* builder;
+	element_handler* const handler;
+	/// Set to true if parsing should stop after the root element's start tag
+	const bool root_only;
+	bool stopped;
 };
 
 #endif // K3D_HAVE_LIBXML2
@@ -630,7 +715,19 @@ std::istream& operator>>(std::istream& Stream, element& RHS)
 
 void parse(element& Root, std::istream& InputStream, const std::string& StreamName, progress& Progress)
 {
-	detail::BACKEND_PARSER parser;
+	detail::BACKEND_PARSER parser(false, 0);
+	parser.parse(Root, InputStream, StreamName, Progress);
+}
+
+void parse(element& Root, std::istream& InputStream, const std::string& StreamName, progress& Progress, element_handler& Handler)
+{
+	detail::BACKEND_PARSER parser(false, &Handler);
+	parser.parse(Root, InputStream, StreamName, Progress);
+}
+
+void parse_root(element& Root, std::istream& InputStream, const std::string& StreamName, progress& Progress)
+{
+	detail::BACKEND_PARSER parser(true, 0);
 	parser.parse(Root, InputStream, StreamName, Progress);
 }
 
@@ -231,8 +231,28 @@ public:
 	void show_activity() {}
 };
 
+/// Abstract interface used to process elements as they are parsed, so large documents can be handled a piece at a time
+class element_handler
+{
+public:
+	/// Called once the name and attributes of an element have been parsed (Depth is zero for the root element).  Return false to skip the text and children of the element.
+	virtual bool start_element(element& Element, const unsigned long Depth) = 0;
+	/// Called once an element and its contents have been parsed.  Return true to remove the element from its parent.
+	virtual bool end_element(element& Element, const unsigned long Depth) = 0;
+
+protected:
+	element_handler() {}
+	element_handler(const element_handler&) {}
+	element_handler& operator=(const element_handler&) { return *this; }
+	virtual ~element_handler() {}
+};
+
 /// Parses an XML document from a stream.  Throws std::runtime_error if there are any problems.
 void parse(element& Root, std::istream& InputStream, const std::string& StreamName, progress& Progress);
+/// Parses an XML document from a stream, passing elements to a handler as they are parsed.  Throws std::runtime_error if there are any problems.
+void parse(element& Root, std::istream& InputStream, const std::string& StreamName, progress& Progress, element_handler& Handler);
+/// Parses the name and attributes of the root element of an XML document, without reading the rest of the stream.  Throws std::runtime_error if there are any problems.
+void parse_root(element& Root, std::istream& InputStream, const std::string& StreamName, progress& Progress);
 
 } // namespace xml
 
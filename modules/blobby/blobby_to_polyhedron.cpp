@@ -0,0 +1,1173 @@
+// K-3D
+// Copyright (c) 1995-2008, Timothy M. Shead
+//
+// Contact: tshead@k-3d.com
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+/** \file
+	\author Timothy M. Shead (tshead@k-3d.com)
+*/
+
+#include <k3d-i18n-config.h>
+#include <k3dsdk/algebra.h>
+#include <k3dsdk/blobby.h>
+#include <k3dsdk/bounding_box3.h>
+#include <k3dsdk/document_plugin_factory.h>
+#include <k3dsdk/measurement.h>
+#include <k3dsdk/mesh_modifier.h>
+#include <k3dsdk/node.h>
+#include <k3dsdk/parallel/blocked_range.h>
+#include <k3dsdk/parallel/parallel_for.h>
+#include <k3dsdk/parallel/threads.h>
+#include <k3dsdk/polyhedron.h>
+#include <k3dsdk/vector4.h>
+
+#include <boost/scoped_ptr.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <set>
+#include <vector>
+
+namespace module
+{
+
+namespace blobby
+{
+
+namespace detail
+{
+
+/// Number of grid cells along each side of a block
+const k3d::int64_t block_cells = 8;
+/// Number of field samples along each side of a block, including a one-sample apron on either side
+const k3d::int64_t block_samples = block_cells + 3;
+/// Largest number of grid cells along any axis, which keeps cell keys within 64 bits
+const k3d::int64_t maximum_cells = 1 << 20;
+/// Variadic operators with more operands than this find their active operands through the expression's parent links instead of scanning
+const k3d::uint_t scan_operand_limit = 64;
+
+/// Returns true iff the operator takes a leading operand count followed by any number of operands
+inline k3d::bool_t variadic(const k3d::int32_t Operator)
+{
+	return Operator == k3d::blobby::ADD || Operator == k3d::blobby::MULTIPLY || Operator == k3d::blobby::MAXIMUM || Operator == k3d::blobby::MINIMUM;
+}
+
+/// Returns the RenderMan blobby field for a squared distance, measured in the primitive's local space
+inline k3d::double_t falloff(const k3d::double_t Distance2)
+{
+	if(Distance2 >= 1)
+		return 0;
+
+	const k3d::double_t a = 1 - Distance2;
+	return a * a * a;
+}
+
+/// Returns the matrix stored (column-major) in a run of blobby floats
+inline k3d::matrix4 blobby_matrix(const k3d::mesh::doubles_t& Floats, const k3d::uint_t First)
+{
+	return k3d::transpose(k3d::matrix4(
+		k3d::vector4(Floats[First + 0], Floats[First + 1], Floats[First + 2], Floats[First + 3]),
+		k3d::vector4(Floats[First + 4], Floats[First + 5], Floats[First + 6], Floats[First + 7]),
+		k3d::vector4(Floats[First + 8], Floats[First + 9], Floats[First + 10], Floats[First + 11]),
+		k3d::vector4(Floats[First + 12], Floats[First + 13], Floats[First + 14], Floats[First + 15])));
+}
+
+/// Returns the world-space bounds of a local-space box
+inline const k3d::bounding_box3 transform_bounds(const k3d::matrix4& Matrix, const k3d::point3& Min, const k3d::point3& Max)
+{
+	k3d::bounding_box3 result;
+	for(k3d::uint_t corner = 0; corner != 8; ++corner)
+	{
+		result.insert(Matrix * k3d::point3(
+			corner & 1 ? Max[0] : Min[0],
+			corner & 2 ? Max[1] : Min[1],
+			corner & 4 ? Max[2] : Min[2]));
+	}
+	return result;
+}
+
+/// Returns true iff a point lies within a box
+inline k3d::bool_t contains(const k3d::bounding_box3& Box, const k3d::point3& Point)
+{
+	return Point[0] >= Box.nx && Point[0] <= Box.px && Point[1] >= Box.ny && Point[1] <= Box.py && Point[2] >= Box.nz && Point[2] <= Box.pz;
+}
+
+/// Stores one blobby primitive (ellipsoid, segment, or constant) ready for evaluation
+struct leaf
+{
+	leaf() :
+		type(k3d::blobby::CONSTANT),
+		start(0, 0, 0),
+		axis(0, 0, 0),
+		inverse_axis_length2(0),
+		inverse_radius2(0),
+		value(0)
+	{
+	}
+
+	k3d::int32_t type;
+	/// Maps world coordinates into the primitive's local coordinates
+	k3d::matrix4 inverse_matrix;
+	/// Segment start, in local coordinates
+	k3d::point3 start;
+	/// Segment end minus segment start, in local coordinates
+	k3d::vector3 axis;
+	k3d::double_t inverse_axis_length2;
+	k3d::double_t inverse_radius2;
+	/// Field value of a constant primitive
+	k3d::double_t value;
+	/// World-space region outside which the field is zero, empty for constants
+	k3d::bounding_box3 support;
+};
+
+/// Returns the field contributed by a leaf at a world-space point
+inline k3d::double_t evaluate(const leaf& Leaf, const k3d::point3& Point)
+{
+	switch(Leaf.type)
+	{
+		case k3d::blobby::ELLIPSOID:
+		{
+			return falloff(k3d::to_vector(Leaf.inverse_matrix * Point).length2());
+		}
+		case k3d::blobby::SEGMENT:
+		{
+			const k3d::vector3 offset = (Leaf.inverse_matrix * Point) - Leaf.start;
+			const k3d::double_t t = std::min(1.0, std::max(0.0, (offset * Leaf.axis) * Leaf.inverse_axis_length2));
+			return falloff((offset - t * Leaf.axis).length2() * Leaf.inverse_radius2);
+		}
+	}
+
+	return Leaf.value;
+}
+
+/// One operand of a compiled operator, either a slot holding a per-sample value or a constant
+struct operand
+{
+	operand(const k3d::int32_t Slot, const k3d::double_t Value) :
+		slot(Slot),
+		value(Value)
+	{
+	}
+
+	k3d::int32_t slot;
+	k3d::double_t value;
+};
+
+/// Applies a blobby operator to a list of operands
+inline k3d::double_t apply(const k3d::int32_t Operator, const operand* Begin, const operand* End, const k3d::double_t* Slots)
+{
+	#define K3D_BLOBBY_OPERAND(o) ((o).slot < 0 ? (o).value : Slots[(o).slot])
+
+	switch(Operator)
+	{
+		case k3d::blobby::ADD:
+		{
+			k3d::double_t result = 0;
+			for(const operand* o = Begin; o != End; ++o)
+				result += K3D_BLOBBY_OPERAND(*o);
+			return result;
+		}
+		case k3d::blobby::MULTIPLY:
+		{
+			k3d::double_t result = 1;
+			for(const operand* o = Begin; o != End; ++o)
+				result *= K3D_BLOBBY_OPERAND(*o);
+			return result;
+		}
+		case k3d::blobby::MAXIMUM:
+		{
+			if(Begin == End)
+				return 0;
+			k3d::double_t result = K3D_BLOBBY_OPERAND(*Begin);
+			for(const operand* o = Begin + 1; o != End; ++o)
+				result = std::max(result, K3D_BLOBBY_OPERAND(*o));
+			return result;
+		}
+		case k3d::blobby::MINIMUM:
+		{
+			if(Begin == End)
+				return 0;
+			k3d::double_t result = K3D_BLOBBY_OPERAND(*Begin);
+			for(const operand* o = Begin + 1; o != End; ++o)
+				result = std::min(result, K3D_BLOBBY_OPERAND(*o));
+			return result;
+		}
+		case k3d::blobby::SUBTRACT:
+		{
+			const k3d::double_t a = Begin != End ? K3D_BLOBBY_OPERAND(Begin[0]) : 0;
+			const k3d::double_t b = End - Begin > 1 ? K3D_BLOBBY_OPERAND(Begin[1]) : 0;
+			return a - b;
+		}
+		case k3d::blobby::DIVIDE:
+		{
+			const k3d::double_t a = Begin != End ? K3D_BLOBBY_OPERAND(Begin[0]) : 0;
+			const k3d::double_t b = End - Begin > 1 ? K3D_BLOBBY_OPERAND(Begin[1]) : 0;
+			return b ? a / b : 0;
+		}
+		case k3d::blobby::NEGATE:
+		{
+			return Begin != End ? -K3D_BLOBBY_OPERAND(Begin[0]) : 0;
+		}
+		case k3d::blobby::IDENTITY:
+		{
+			return Begin != End ? K3D_BLOBBY_OPERAND(Begin[0]) : 0;
+		}
+	}
+
+	#undef K3D_BLOBBY_OPERAND
+
+	return 0;
+}
+
+/// Stores the operator tree of one blobby.  Nodes are numbered as in the blobby operands array: leaves first, then operators,
+/// with the root last.  Operands that don't refer to an earlier node are replaced by an extra "null" node whose field is zero.
+struct expression
+{
+	std::vector<leaf> leaves;
+
+	std::vector<k3d::int32_t> operators;
+	std::vector<k3d::uint_t> first_operands;
+	std::vector<k3d::uint_t> operand_counts;
+	std::vector<k3d::uint_t> operands;
+	/// Stores true for each operator whose operands all share the same background
+	std::vector<k3d::bool_t> uniform;
+
+	/// Stores the field of each node far from every leaf, including the null node
+	std::vector<k3d::double_t> backgrounds;
+
+	/// Stores the operators using each node, once for every time the node appears as an operand
+	std::vector<k3d::uint_t> first_parents;
+	std::vector<k3d::uint_t> parents;
+
+	k3d::uint_t node_count() const
+	{
+		return leaves.size() + operators.size();
+	}
+
+	k3d::uint_t null_node() const
+	{
+		return node_count();
+	}
+};
+
+/// Converts one blobby from a mesh into an expression
+void create_expression(const k3d::blobby::const_primitive& Blobby, const k3d::uint_t Index, expression& Expression)
+{
+	const k3d::uint_t primitives_begin = Blobby.first_primitives[Index];
+	const k3d::uint_t primitives_end = primitives_begin + Blobby.primitive_counts[Index];
+	for(k3d::uint_t primitive = primitives_begin; primitive != primitives_end; ++primitive)
+	{
+		const k3d::uint_t first_float = Blobby.primitive_first_floats[primitive];
+		const k3d::uint_t float_count = Blobby.primitive_float_counts[primitive];
+
+		leaf result;
+		switch(Blobby.primitives[primitive])
+		{
+			case k3d::blobby::CONSTANT:
+			{
+				if(float_count >= 1)
+					result.value = Blobby.floats[first_float];
+				break;
+			}
+			case k3d::blobby::ELLIPSOID:
+			{
+				if(float_count != 16)
+					break;
+
+				const k3d::matrix4 matrix = blobby_matrix(Blobby.floats, first_float);
+				result.type = k3d::blobby::ELLIPSOID;
+				result.inverse_matrix = k3d::inverse(matrix);
+				result.support = transform_bounds(matrix, k3d::point3(-1, -1, -1), k3d::point3(1, 1, 1));
+				break;
+			}
+			case k3d::blobby::SEGMENT:
+			{
+				if(float_count != 23)
+					break;
+
+				const k3d::point3 start(Blobby.floats[first_float + 0], Blobby.floats[first_float + 1], Blobby.floats[first_float + 2]);
+				const k3d::point3 end(Blobby.floats[first_float + 3], Blobby.floats[first_float + 4], Blobby.floats[first_float + 5]);
+				const k3d::double_t radius = std::abs(Blobby.floats[first_float + 6]);
+				if(!radius)
+					break;
+
+				const k3d::matrix4 matrix = blobby_matrix(Blobby.floats, first_float + 7);
+				result.type = k3d::blobby::SEGMENT;
+				result.inverse_matrix = k3d::inverse(matrix);
+				result.start = start;
+				result.axis = end - start;
+				result.inverse_axis_length2 = result.axis.length2() ? 1 / result.axis.length2() : 0;
+				result.inverse_radius2 = 1 / (radius * radius);
+				result.support = transform_bounds(matrix,
+					k3d::point3(std::min(start[0], end[0]) - radius, std::min(start[1], end[1]) - radius, std::min(start[2], end[2]) - radius),
+					k3d::point3(std::max(start[0], end[0]) + radius, std::max(start[1], end[1]) + radius, std::max(start[2], end[2]) + radius));
+				break;
+			}
+		}
+
+		Expression.leaves.push_back(result);
+	}
+
+	const k3d::uint_t leaf_count = Expression.leaves.size();
+
+	const k3d::uint_t operators_begin = Blobby.first_operators[Index];
+	const k3d::uint_t operators_end = operators_begin + Blobby.operator_counts[Index];
+	for(k3d::uint_t op = operators_begin; op != operators_end; ++op)
+	{
+		const k3d::int32_t type = Blobby.operators[op];
+		const k3d::uint_t node = leaf_count + Expression.operators.size();
+
+		k3d::uint_t operands_begin = Blobby.operator_first_operands[op];
+		k3d::uint_t operands_end = operands_begin + Blobby.operator_operand_counts[op];
+		if(variadic(type) && operands_begin != operands_end)
+		{
+			const k3d::uint_t count = std::min<k3d::uint_t>(Blobby.operands[operands_begin], operands_end - operands_begin - 1);
+			operands_begin += 1;
+			operands_end = operands_begin + count;
+		}
+
+		Expression.operators.push_back(type);
+		Expression.first_operands.push_back(Expression.operands.size());
+		Expression.operand_counts.push_back(operands_end - operands_begin);
+		for(k3d::uint_t operand = operands_begin; operand != operands_end; ++operand)
+		{
+			const k3d::uint_t target = Blobby.operands[operand];
+			Expression.operands.push_back(target < node ? target : std::numeric_limits<k3d::uint_t>::max());
+		}
+	}
+
+	const k3d::uint_t null_node = Expression.null_node();
+	for(k3d::uint_t i = 0; i != Expression.operands.size(); ++i)
+	{
+		if(Expression.operands[i] == std::numeric_limits<k3d::uint_t>::max())
+			Expression.operands[i] = null_node;
+	}
+
+	// Compute the background field of every node, in evaluation order ...
+	Expression.backgrounds.resize(null_node + 1, 0.0);
+	for(k3d::uint_t i = 0; i != leaf_count; ++i)
+		Expression.backgrounds[i] = Expression.leaves[i].support.empty() ? Expression.leaves[i].value : 0.0;
+
+	Expression.uniform.resize(Expression.operators.size(), true);
+	std::vector<operand> constants;
+	for(k3d::uint_t op = 0; op != Expression.operators.size(); ++op)
+	{
+		constants.clear();
+		const k3d::uint_t operands_begin = Expression.first_operands[op];
+		const k3d::uint_t operands_end = operands_begin + Expression.operand_counts[op];
+		for(k3d::uint_t i = operands_begin; i != operands_end; ++i)
+		{
+			constants.push_back(operand(-1, Expression.backgrounds[Expression.operands[i]]));
+			if(constants.back().value != constants.front().value)
+				Expression.uniform[op] = false;
+		}
+
+		Expression.backgrounds[leaf_count + op] = apply(Expression.operators[op], constants.empty() ? 0 : &constants[0], constants.empty() ? 0 : &constants[0] + constants.size(), 0);
+	}
+
+	// Link every node to the operators that use it ...
+	Expression.first_parents.assign(null_node + 2, 0);
+	for(k3d::uint_t i = 0; i != Expression.operands.size(); ++i)
+		++Expression.first_parents[Expression.operands[i] + 1];
+	for(k3d::uint_t i = 1; i != Expression.first_parents.size(); ++i)
+		Expression.first_parents[i] += Expression.first_parents[i - 1];
+
+	Expression.parents.resize(Expression.operands.size());
+	std::vector<k3d::uint_t> fill(Expression.first_parents.begin(), Expression.first_parents.end() - 1);
+	for(k3d::uint_t op = 0; op != Expression.operators.size(); ++op)
+	{
+		const k3d::uint_t operands_begin = Expression.first_operands[op];
+		const k3d::uint_t operands_end = operands_begin + Expression.operand_counts[op];
+		for(k3d::uint_t i = operands_begin; i != operands_end; ++i)
+			Expression.parents[fill[Expression.operands[i]]++] = leaf_count + op;
+	}
+}
+
+/// The subset of an expression that varies within one block: the leaves whose support reaches the block, and the operators that depend on them.
+/// Everything else is folded into constants, so evaluating a sample costs time proportional to the number of nearby leaves.
+struct program
+{
+	struct instruction
+	{
+		k3d::int32_t type;
+		k3d::uint_t first_operand;
+		k3d::uint_t operand_count;
+	};
+
+	/// Leaves assigned to slots [0, leaves.size())
+	std::vector<k3d::uint_t> leaves;
+	/// Operators assigned to slots [leaves.size(), leaves.size() + operators.size()), in evaluation order
+	std::vector<k3d::uint_t> operators;
+	std::vector<instruction> instructions;
+	std::vector<operand> operands;
+
+	/// Returns the slot holding a node's per-sample value, or -1 if the node is constant within the block
+	k3d::int32_t slot(const k3d::uint_t Node) const
+	{
+		std::vector<k3d::uint_t>::const_iterator leaf = std::lower_bound(leaves.begin(), leaves.end(), Node);
+		if(leaf != leaves.end() && *leaf == Node)
+			return leaf - leaves.begin();
+
+		std::vector<k3d::uint_t>::const_iterator op = std::lower_bound(operators.begin(), operators.end(), Node);
+		if(op != operators.end() && *op == Node)
+			return leaves.size() + (op - operators.begin());
+
+		return -1;
+	}
+};
+
+/// Orders program links by operator alone
+struct first_less
+{
+	k3d::bool_t operator()(const std::pair<k3d::uint_t, k3d::uint_t>& LHS, const std::pair<k3d::uint_t, k3d::uint_t>& RHS) const
+	{
+		return LHS.first < RHS.first;
+	}
+};
+
+/// Compiles the program for a block, given the sorted list of leaves whose support reaches it
+void create_program(const expression& Expression, const k3d::uint_t* LeavesBegin, const k3d::uint_t* LeavesEnd, program& Program)
+{
+	Program.leaves.assign(LeavesBegin, LeavesEnd);
+
+	// Walk up from the active leaves, recording every (operator, operand) link along the way ...
+	std::vector<std::pair<k3d::uint_t, k3d::uint_t> > links;
+	std::set<k3d::uint_t> operators;
+	std::vector<k3d::uint_t> stack(LeavesBegin, LeavesEnd);
+	while(!stack.empty())
+	{
+		const k3d::uint_t node = stack.back();
+		stack.pop_back();
+
+		const k3d::uint_t parents_begin = Expression.first_parents[node];
+		const k3d::uint_t parents_end = Expression.first_parents[node + 1];
+		for(k3d::uint_t parent = parents_begin; parent != parents_end; ++parent)
+		{
+			const k3d::uint_t op = Expression.parents[parent];
+			links.push_back(std::make_pair(op, node));
+			if(operators.insert(op).second)
+				stack.push_back(op);
+		}
+	}
+	std::sort(links.begin(), links.end());
+	Program.operators.assign(operators.begin(), operators.end());
+
+	const k3d::uint_t leaf_count = Expression.leaves.size();
+	std::vector<operand> constants;
+	for(k3d::uint_t i = 0; i != Program.operators.size(); ++i)
+	{
+		const k3d::uint_t op = Program.operators[i] - leaf_count;
+		const k3d::int32_t type = Expression.operators[op];
+		const k3d::uint_t operands_begin = Expression.first_operands[op];
+		const k3d::uint_t operands_end = operands_begin + Expression.operand_counts[op];
+
+		program::instruction instruction;
+		instruction.type = type;
+		instruction.first_operand = Program.operands.size();
+
+		if(variadic(type))
+		{
+			// Variadic operators are commutative, so the inactive operands collapse into a single leading constant ...
+			std::vector<operand> active;
+			if(Expression.operand_counts[op] > scan_operand_limit)
+			{
+				typedef std::vector<std::pair<k3d::uint_t, k3d::uint_t> >::const_iterator iterator;
+				const std::pair<iterator, iterator> range = std::equal_range(links.begin(), links.end(), std::make_pair(Program.operators[i], 0u), first_less());
+				for(iterator link = range.first; link != range.second; ++link)
+					active.push_back(operand(Program.slot(link->second), 0));
+			}
+			else
+			{
+				for(k3d::uint_t j = operands_begin; j != operands_end; ++j)
+				{
+					const k3d::int32_t slot = Program.slot(Expression.operands[j]);
+					if(slot >= 0)
+						active.push_back(operand(slot, 0));
+				}
+			}
+
+			const k3d::uint_t inactive_count = Expression.operand_counts[op] - active.size();
+			if(inactive_count)
+			{
+				k3d::double_t constant = 0;
+				if(Expression.uniform[op])
+				{
+					const k3d::double_t background = Expression.backgrounds[Expression.operands[operands_begin]];
+					switch(type)
+					{
+						case k3d::blobby::ADD:
+							constant = inactive_count * background;
+							break;
+						case k3d::blobby::MULTIPLY:
+							constant = std::pow(background, static_cast<k3d::double_t>(inactive_count));
+							break;
+						default:
+							constant = background;
+							break;
+					}
+				}
+				else
+				{
+					constants.clear();
+					for(k3d::uint_t j = operands_begin; j != operands_end; ++j)
+					{
+						if(Program.slot(Expression.operands[j]) < 0)
+							constants.push_back(operand(-1, Expression.backgrounds[Expression.operands[j]]));
+					}
+					constant = apply(type, &constants[0], &constants[0] + constants.size(), 0);
+				}
+
+				Program.operands.push_back(operand(-1, constant));
+			}
+
+			Program.operands.insert(Program.operands.end(), active.begin(), active.end());
+		}
+		else
+		{
+			for(k3d::uint_t j = operands_begin; j != operands_end; ++j)
+			{
+				const k3d::uint_t node = Expression.operands[j];
+				Program.operands.push_back(operand(Program.slot(node), Expression.backgrounds[node]));
+			}
+		}
+
+		instruction.operand_count = Program.operands.size() - instruction.first_operand;
+		Program.instructions.push_back(instruction);
+	}
+}
+
+/// Describes the sparse grid covering one blobby
+struct grid
+{
+	k3d::point3 origin;
+	k3d::double_t cell_size;
+	/// Number of cells along each axis
+	k3d::int64_t cells[3];
+	/// Number of blocks along each axis
+	k3d::int64_t blocks[3];
+	k3d::double_t threshold;
+
+	const k3d::point3 point(const k3d::int64_t X, const k3d::int64_t Y, const k3d::int64_t Z) const
+	{
+		return k3d::point3(origin[0] + X * cell_size, origin[1] + Y * cell_size, origin[2] + Z * cell_size);
+	}
+
+	k3d::uint64_t cell_key(const k3d::int64_t X, const k3d::int64_t Y, const k3d::int64_t Z) const
+	{
+		return (static_cast<k3d::uint64_t>(Z) * cells[1] + Y) * cells[0] + X;
+	}
+
+	k3d::uint64_t block_key(const k3d::int64_t X, const k3d::int64_t Y, const k3d::int64_t Z) const
+	{
+		return (static_cast<k3d::uint64_t>(Z) * blocks[1] + Y) * blocks[0] + X;
+	}
+};
+
+/// Returns true iff a sample lies on (or beyond) the outermost layer of the grid
+inline k3d::bool_t boundary(const grid& Grid, const k3d::int64_t X, const k3d::int64_t Y, const k3d::int64_t Z)
+{
+	return X <= 0 || Y <= 0 || Z <= 0 || X >= Grid.cells[0] || Y >= Grid.cells[1] || Z >= Grid.cells[2];
+}
+
+/// Returns the field value used for a sample on the outermost layer of the grid.  Samples there are always treated as outside, which caps
+/// surfaces whose background field is at-or-above the threshold (so the region "inside" runs off to infinity) half a cell within the grid.
+inline k3d::double_t close_boundary(const k3d::double_t Value, const k3d::double_t Threshold)
+{
+	if(Value < Threshold)
+		return Value;
+
+	const k3d::double_t margin = std::max(Value - Threshold, std::max(std::abs(Threshold), 1.0) * std::numeric_limits<k3d::double_t>::epsilon() * 16);
+	return Threshold - margin;
+}
+
+/// Evaluates the whole expression at one grid sample, ignoring the per-block programs.  This is only used for the handful of cells that
+/// no block placed a vertex in, so it trades speed for simplicity.
+k3d::double_t sample(const expression& Expression, const grid& Grid, const k3d::int64_t X, const k3d::int64_t Y, const k3d::int64_t Z)
+{
+	const k3d::point3 point = Grid.point(X, Y, Z);
+	const k3d::uint_t leaf_count = Expression.leaves.size();
+
+	std::vector<k3d::double_t> values(Expression.null_node() + 1, 0.0);
+	for(k3d::uint_t i = 0; i != leaf_count; ++i)
+	{
+		const leaf& current_leaf = Expression.leaves[i];
+		values[i] = current_leaf.support.empty() ? current_leaf.value : contains(current_leaf.support, point) ? evaluate(current_leaf, point) : 0.0;
+	}
+
+	std::vector<operand> operands;
+	for(k3d::uint_t op = 0; op != Expression.operators.size(); ++op)
+	{
+		operands.clear();
+		const k3d::uint_t operands_begin = Expression.first_operands[op];
+		const k3d::uint_t operands_end = operands_begin + Expression.operand_counts[op];
+		for(k3d::uint_t i = operands_begin; i != operands_end; ++i)
+			operands.push_back(operand(Expression.operands[i], 0));
+
+		values[leaf_count + op] = apply(Expression.operators[op], operands.empty() ? 0 : &operands[0], operands.empty() ? 0 : &operands[0] + operands.size(), &values[0]);
+	}
+
+	const k3d::double_t result = values[Expression.node_count() - 1];
+	return boundary(Grid, X, Y, Z) ? close_boundary(result, Grid.threshold) : result;
+}
+
+/// Keeps edge crossings this fraction of an edge away from its ends.  A sample exactly at the threshold counts as inside, so every edge
+/// leaving it towards an outside sample would otherwise cross at the sample itself, collapsing the vertices of the cells around it onto
+/// one point (and their quads to lines).
+const k3d::double_t crossing_margin = 1.0 / 64.0;
+
+/// Returns the parameter of the point where the surface crosses an edge whose ends straddle the threshold
+inline k3d::double_t crossing(const k3d::double_t A, const k3d::double_t B, const k3d::double_t Threshold)
+{
+	return std::min(std::max((Threshold - A) / (B - A), crossing_margin), 1.0 - crossing_margin);
+}
+
+/// Returns the vertex for a cell, given the field at its eight corners, at the mean of the cell's edge crossings.  Falls back to the
+/// center of the cell if none of its edges cross the surface.
+const k3d::point3 cell_vertex(const grid& Grid, const k3d::int64_t X, const k3d::int64_t Y, const k3d::int64_t Z, const k3d::double_t* Values)
+{
+	static const k3d::uint_t cell_edges[12][2] = { {0, 1}, {2, 3}, {4, 5}, {6, 7}, {0, 2}, {1, 3}, {4, 6}, {5, 7}, {0, 4}, {1, 5}, {2, 6}, {3, 7} };
+
+	const k3d::double_t threshold = Grid.threshold;
+
+	k3d::vector3 sum(0, 0, 0);
+	k3d::uint_t crossings = 0;
+	for(k3d::uint_t edge = 0; edge != 12; ++edge)
+	{
+		const k3d::uint_t a = cell_edges[edge][0];
+		const k3d::uint_t b = cell_edges[edge][1];
+		if((Values[a] >= threshold) == (Values[b] >= threshold))
+			continue;
+
+		const k3d::double_t t = crossing(Values[a], Values[b], threshold);
+		const k3d::vector3 pa((a & 1), ((a >> 1) & 1), ((a >> 2) & 1));
+		const k3d::vector3 pb((b & 1), ((b >> 1) & 1), ((b >> 2) & 1));
+		sum += pa + t * (pb - pa);
+		++crossings;
+	}
+
+	if(!crossings)
+		return Grid.point(X, Y, Z) + k3d::vector3(0.5, 0.5, 0.5) * Grid.cell_size;
+
+	return Grid.point(X, Y, Z) + (Grid.cell_size / crossings) * sum;
+}
+
+/// Stores the block containing a group of leaves, as a range within the sorted (block, leaf) list
+struct block
+{
+	k3d::uint64_t key;
+	k3d::uint_t first;
+	k3d::uint_t count;
+};
+
+/// Stores a quadrilateral as the keys of its four cells
+struct quad
+{
+	k3d::uint64_t cells[4];
+};
+
+/// Stores the surface extracted from one block
+struct block_surface
+{
+	std::vector<std::pair<k3d::uint64_t, k3d::point3> > vertices;
+	std::vector<quad> quads;
+};
+
+/// Extracts the surface from a set of blocks in parallel.  Each block places a vertex within each of its own cells that straddles
+/// the surface (at the mean of the cell's edge crossings), and a quad around each of its own grid edges that crosses the surface.
+class surface_worker
+{
+public:
+	surface_worker(const expression& Expression, const grid& Grid, const std::vector<k3d::uint_t>& Leaves, const std::vector<block>& Blocks, std::vector<block_surface>& Surfaces) :
+		m_expression(Expression),
+		m_grid(Grid),
+		m_leaves(Leaves),
+		m_blocks(Blocks),
+		m_surfaces(Surfaces)
+	{
+	}
+
+	void operator()(const k3d::parallel::blocked_range<k3d::uint_t>& Range) const
+	{
+		const k3d::uint_t root = m_expression.node_count() - 1;
+		const k3d::double_t threshold = m_grid.threshold;
+
+		std::vector<k3d::double_t> slots;
+		std::vector<k3d::double_t> samples(block_samples * block_samples * block_samples);
+
+		for(k3d::uint_t b = Range.begin(); b != Range.end(); ++b)
+		{
+			const block& current = m_blocks[b];
+
+			program program;
+			create_program(m_expression, &m_leaves[current.first], &m_leaves[current.first] + current.count, program);
+
+			const k3d::int64_t block_x = current.key % m_grid.blocks[0];
+			const k3d::int64_t block_y = (current.key / m_grid.blocks[0]) % m_grid.blocks[1];
+			const k3d::int64_t block_z = current.key / m_grid.blocks[0] / m_grid.blocks[1];
+			const k3d::int64_t base[3] = { block_x * block_cells - 1, block_y * block_cells - 1, block_z * block_cells - 1 };
+
+			// A block whose field is constant can only contain surface where the grid boundary closes it off ...
+			const k3d::int32_t root_slot = program.slot(root);
+			const k3d::bool_t on_boundary =
+				block_x == 0 || block_y == 0 || block_z == 0 ||
+				block_x == m_grid.blocks[0] - 1 || block_y == m_grid.blocks[1] - 1 || block_z == m_grid.blocks[2] - 1;
+			if(root_slot < 0 && (!on_boundary || m_expression.backgrounds[root] < threshold))
+				continue;
+
+			// Evaluate each leaf only at the samples within its support, instead of testing every leaf against every sample ...
+			const k3d::uint_t leaf_count = program.leaves.size();
+			const k3d::uint_t slot_count = leaf_count + program.instructions.size();
+			if(root_slot >= 0)
+			{
+				slots.assign(samples.size() * slot_count, 0.0);
+				for(k3d::uint_t i = 0; i != leaf_count; ++i)
+				{
+					const leaf& current_leaf = m_expression.leaves[program.leaves[i]];
+					const k3d::double_t minimum[3] = { current_leaf.support.nx, current_leaf.support.ny, current_leaf.support.nz };
+					const k3d::double_t maximum[3] = { current_leaf.support.px, current_leaf.support.py, current_leaf.support.pz };
+
+					k3d::int64_t first[3];
+					k3d::int64_t last[3];
+					for(k3d::uint_t j = 0; j != 3; ++j)
+					{
+						first[j] = std::max<k3d::int64_t>(0, static_cast<k3d::int64_t>(std::floor((minimum[j] - m_grid.origin[j]) / m_grid.cell_size)) - base[j]);
+						last[j] = std::min<k3d::int64_t>(block_samples - 1, static_cast<k3d::int64_t>(std::ceil((maximum[j] - m_grid.origin[j]) / m_grid.cell_size)) - base[j]);
+					}
+
+					for(k3d::int64_t z = first[2]; z <= last[2]; ++z)
+					{
+						for(k3d::int64_t y = first[1]; y <= last[1]; ++y)
+						{
+							for(k3d::int64_t x = first[0]; x <= last[0]; ++x)
+							{
+								const k3d::point3 point = m_grid.point(base[0] + x, base[1] + y, base[2] + z);
+								if(contains(current_leaf.support, point))
+									slots[((z * block_samples + y) * block_samples + x) * slot_count + i] = evaluate(current_leaf, point);
+							}
+						}
+					}
+				}
+			}
+
+			// Sample the field ...
+			for(k3d::int64_t z = 0; z != block_samples; ++z)
+			{
+				for(k3d::int64_t y = 0; y != block_samples; ++y)
+				{
+					for(k3d::int64_t x = 0; x != block_samples; ++x)
+					{
+						const k3d::uint_t index = (z * block_samples + y) * block_samples + x;
+						k3d::double_t& value = samples[index];
+
+						if(root_slot < 0)
+						{
+							value = m_expression.backgrounds[root];
+						}
+						else
+						{
+							k3d::double_t* const sample_slots = &slots[index * slot_count];
+							for(k3d::uint_t i = 0; i != program.instructions.size(); ++i)
+							{
+								const program::instruction& instruction = program.instructions[i];
+								const operand* const operands = &program.operands[instruction.first_operand];
+								sample_slots[leaf_count + i] = apply(instruction.type, operands, operands + instruction.operand_count, sample_slots);
+							}
+
+							value = sample_slots[root_slot];
+						}
+
+						if(on_boundary && boundary(m_grid, base[0] + x, base[1] + y, base[2] + z))
+							value = close_boundary(value, threshold);
+					}
+				}
+			}
+
+			block_surface& surface = m_surfaces[b];
+
+			// Place a vertex in every owned cell that straddles the surface ...
+			for(k3d::int64_t z = 1; z != block_cells + 1; ++z)
+			{
+				for(k3d::int64_t y = 1; y != block_cells + 1; ++y)
+				{
+					for(k3d::int64_t x = 1; x != block_cells + 1; ++x)
+					{
+						const k3d::int64_t cell[3] = { base[0] + x, base[1] + y, base[2] + z };
+						if(cell[0] >= m_grid.cells[0] || cell[1] >= m_grid.cells[1] || cell[2] >= m_grid.cells[2])
+							continue;
+
+						k3d::double_t values[8];
+						k3d::uint_t inside = 0;
+						for(k3d::uint_t corner = 0; corner != 8; ++corner)
+						{
+							values[corner] = samples[((z + ((corner >> 2) & 1)) * block_samples + (y + ((corner >> 1) & 1))) * block_samples + (x + (corner & 1))];
+							if(values[corner] >= threshold)
+								++inside;
+						}
+						if(inside == 0 || inside == 8)
+							continue;
+
+						surface.vertices.push_back(std::make_pair(m_grid.cell_key(cell[0], cell[1], cell[2]), cell_vertex(m_grid, cell[0], cell[1], cell[2], values)));
+					}
+				}
+			}
+
+			// Connect the vertices around every owned grid edge that crosses the surface ...
+			for(k3d::int64_t z = 1; z != block_cells + 1; ++z)
+			{
+				for(k3d::int64_t y = 1; y != block_cells + 1; ++y)
+				{
+					for(k3d::int64_t x = 1; x != block_cells + 1; ++x)
+					{
+						const k3d::int64_t local[3] = { x, y, z };
+						const k3d::int64_t point[3] = { base[0] + x, base[1] + y, base[2] + z };
+						const k3d::bool_t inside = samples[(z * block_samples + y) * block_samples + x] >= threshold;
+
+						for(k3d::uint_t d = 0; d != 3; ++d)
+						{
+							const k3d::uint_t u = (d + 1) % 3;
+							const k3d::uint_t v = (d + 2) % 3;
+							if(point[d] >= m_grid.cells[d] || point[u] < 1 || point[u] >= m_grid.cells[u] || point[v] < 1 || point[v] >= m_grid.cells[v])
+								continue;
+
+							k3d::int64_t next[3] = { local[0], local[1], local[2] };
+							++next[d];
+							if(inside == (samples[(next[2] * block_samples + next[1]) * block_samples + next[0]] >= threshold))
+								continue;
+
+							// Cells around the edge, counter-clockwise when viewed looking down the edge from its far end ...
+							static const k3d::int64_t offsets[4][2] = { {-1, -1}, {0, -1}, {0, 0}, {-1, 0} };
+							quad result;
+							for(k3d::uint_t i = 0; i != 4; ++i)
+							{
+								k3d::int64_t cell[3] = { point[0], point[1], point[2] };
+								cell[u] += offsets[i][0];
+								cell[v] += offsets[i][1];
+								result.cells[inside ? i : 3 - i] = m_grid.cell_key(cell[0], cell[1], cell[2]);
+							}
+							surface.quads.push_back(result);
+						}
+					}
+				}
+			}
+		}
+	}
+
+private:
+	const expression& m_expression;
+	const grid& m_grid;
+	const std::vector<k3d::uint_t>& m_leaves;
+	const std::vector<block>& m_blocks;
+	std::vector<block_surface>& m_surfaces;
+};
+
+/// Orders surface vertices by cell key
+struct vertex_less
+{
+	k3d::bool_t operator()(const std::pair<k3d::uint64_t, k3d::point3>& LHS, const std::pair<k3d::uint64_t, k3d::point3>& RHS) const
+	{
+		return LHS.first < RHS.first;
+	}
+
+	k3d::bool_t operator()(const std::pair<k3d::uint64_t, k3d::point3>& LHS, const k3d::uint64_t RHS) const
+	{
+		return LHS.first < RHS;
+	}
+};
+
+/// Polygonizes one blobby, appending quadrilaterals to the given arrays
+void polygonize(const expression& Expression, const k3d::double_t Resolution, const k3d::double_t Threshold, k3d::mesh::points_t& Vertices, k3d::mesh::counts_t& VertexCounts, k3d::mesh::indices_t& VertexIndices)
+{
+	if(!Expression.node_count())
+		return;
+
+	// Size the grid from the leaves, so the resolution follows the elements instead of the overall extent ...
+	k3d::bounding_box3 bounds;
+	std::vector<k3d::double_t> sizes;
+	for(k3d::uint_t i = 0; i != Expression.leaves.size(); ++i)
+	{
+		const k3d::bounding_box3& support = Expression.leaves[i].support;
+		if(support.empty())
+			continue;
+
+		bounds.insert(support);
+		sizes.push_back(std::max(support.width(), std::max(support.height(), support.depth())));
+	}
+	// A blobby made of constants alone has a uniform field, so there's no finite surface to extract ...
+	if(sizes.empty())
+		return;
+
+	std::nth_element(sizes.begin(), sizes.begin() + sizes.size() / 2, sizes.end());
+	const k3d::double_t extent = std::max(bounds.width(), std::max(bounds.height(), bounds.depth()));
+
+	grid grid;
+	grid.threshold = Threshold;
+	grid.cell_size = std::max(sizes[sizes.size() / 2] / Resolution, extent / (maximum_cells - 8));
+	if(!(grid.cell_size > 0))
+		return;
+
+	grid.origin = k3d::point3(bounds.nx - 2 * grid.cell_size, bounds.ny - 2 * grid.cell_size, bounds.nz - 2 * grid.cell_size);
+	grid.cells[0] = static_cast<k3d::int64_t>(std::ceil(bounds.width() / grid.cell_size)) + 4;
+	grid.cells[1] = static_cast<k3d::int64_t>(std::ceil(bounds.height() / grid.cell_size)) + 4;
+	grid.cells[2] = static_cast<k3d::int64_t>(std::ceil(bounds.depth() / grid.cell_size)) + 4;
+	for(k3d::uint_t i = 0; i != 3; ++i)
+		grid.blocks[i] = (grid.cells[i] + block_cells - 1) / block_cells;
+
+	// Bin each leaf into every block whose samples it can reach ...
+	std::vector<std::pair<k3d::uint64_t, k3d::uint_t> > bins;
+	for(k3d::uint_t i = 0; i != Expression.leaves.size(); ++i)
+	{
+		const k3d::bounding_box3& support = Expression.leaves[i].support;
+		if(support.empty())
+			continue;
+
+		const k3d::double_t minimum[3] = { support.nx, support.ny, support.nz };
+		const k3d::double_t maximum[3] = { support.px, support.py, support.pz };
+
+		k3d::int64_t first[3];
+		k3d::int64_t last[3];
+		for(k3d::uint_t j = 0; j != 3; ++j)
+		{
+			const k3d::double_t low = std::floor((minimum[j] - grid.origin[j]) / grid.cell_size);
+			const k3d::double_t high = std::ceil((maximum[j] - grid.origin[j]) / grid.cell_size);
+			first[j] = std::max<k3d::int64_t>(0, static_cast<k3d::int64_t>(std::ceil((low - block_cells - 1) / block_cells)));
+			last[j] = std::min<k3d::int64_t>(grid.blocks[j] - 1, static_cast<k3d::int64_t>(std::floor((high + 1) / block_cells)));
+		}
+
+		for(k3d::int64_t z = first[2]; z <= last[2]; ++z)
+		{
+			for(k3d::int64_t y = first[1]; y <= last[1]; ++y)
+			{
+				for(k3d::int64_t x = first[0]; x <= last[0]; ++x)
+					bins.push_back(std::make_pair(grid.block_key(x, y, z), i));
+			}
+		}
+	}
+	std::sort(bins.begin(), bins.end());
+
+	std::vector<k3d::uint_t> leaves(bins.size());
+	std::vector<block> blocks;
+	for(k3d::uint_t i = 0; i != bins.size(); ++i)
+	{
+		leaves[i] = bins[i].second;
+		if(blocks.empty() || blocks.back().key != bins[i].first)
+		{
+			block current;
+			current.key = bins[i].first;
+			current.first = i;
+			current.count = 0;
+			blocks.push_back(current);
+		}
+		++blocks.back().count;
+	}
+	bins.clear();
+
+	// If the field far from every leaf is inside the surface, the surface is closed off at the grid boundary, so every block along the boundary
+	// has to be visited, whether or not any leaves reach it ...
+	if(Expression.backgrounds[Expression.node_count() - 1] >= Threshold)
+	{
+		std::vector<block> boundary_blocks;
+		for(k3d::int64_t z = 0; z != grid.blocks[2]; ++z)
+		{
+			for(k3d::int64_t y = 0; y != grid.blocks[1]; ++y)
+			{
+				for(k3d::int64_t x = 0; x != grid.blocks[0]; ++x)
+				{
+					if(x != 0 && y != 0 && z != 0 && x != grid.blocks[0] - 1 && y != grid.blocks[1] - 1 && z != grid.blocks[2] - 1)
+					{
+						x = grid.blocks[0] - 2;
+						continue;
+					}
+
+					block current;
+					current.key = grid.block_key(x, y, z);
+					current.first = 0;
+					current.count = 0;
+					boundary_blocks.push_back(current);
+				}
+			}
+		}
+
+		std::vector<block> merged;
+		k3d::uint_t existing = 0;
+		for(k3d::uint_t i = 0; i != boundary_blocks.size(); ++i)
+		{
+			for(; existing != blocks.size() && blocks[existing].key < boundary_blocks[i].key; ++existing)
+				merged.push_back(blocks[existing]);
+			if(existing != blocks.size() && blocks[existing].key == boundary_blocks[i].key)
+				continue;
+			merged.push_back(boundary_blocks[i]);
+		}
+		merged.insert(merged.end(), blocks.begin() + existing, blocks.end());
+		blocks.swap(merged);
+	}
+
+	// Extract the surface from each block in parallel ...
+	std::vector<block_surface> surfaces(blocks.size());
+	k3d::parallel::parallel_for(
+		k3d::parallel::blocked_range<k3d::uint_t>(0, blocks.size(), 1),
+		surface_worker(Expression, grid, leaves, blocks, surfaces));
+
+	// Stitch the blocks together ...
+	std::vector<std::pair<k3d::uint64_t, k3d::point3> > vertices;
+	for(k3d::uint_t i = 0; i != surfaces.size(); ++i)
+		vertices.insert(vertices.end(), surfaces[i].vertices.begin(), surfaces[i].vertices.end());
+	std::sort(vertices.begin(), vertices.end(), vertex_less());
+
+	// Quads always reference cells that straddle the surface, but a cell may belong to a block that didn't see it that way (its program folds
+	// constants in a different order, so samples right at the threshold can round differently).  Rather than leave a hole, evaluate the
+	// field directly for those cells ...
+	std::vector<k3d::uint64_t> missing;
+	for(k3d::uint_t i = 0; i != surfaces.size(); ++i)
+	{
+		const std::vector<quad>& quads = surfaces[i].quads;
+		for(k3d::uint_t j = 0; j != quads.size(); ++j)
+		{
+			for(k3d::uint_t k = 0; k != 4; ++k)
+			{
+				std::vector<std::pair<k3d::uint64_t, k3d::point3> >::const_iterator vertex = std::lower_bound(vertices.begin(), vertices.end(), quads[j].cells[k], vertex_less());
+				if(vertex == vertices.end() || vertex->first != quads[j].cells[k])
+					missing.push_back(quads[j].cells[k]);
+			}
+		}
+	}
+	std::sort(missing.begin(), missing.end());
+	missing.erase(std::unique(missing.begin(), missing.end()), missing.end());
+
+	for(k3d::uint_t i = 0; i != missing.size(); ++i)
+	{
+		const k3d::int64_t x = missing[i] % grid.cells[0];
+		const k3d::int64_t y = (missing[i] / grid.cells[0]) % grid.cells[1];
+		const k3d::int64_t z = missing[i] / grid.cells[0] / grid.cells[1];
+
+		k3d::double_t values[8];
+		for(k3d::uint_t corner = 0; corner != 8; ++corner)
+			values[corner] = sample(Expression, grid, x + (corner & 1), y + ((corner >> 1) & 1), z + ((corner >> 2) & 1));
+
+		vertices.push_back(std::make_pair(missing[i], cell_vertex(grid, x, y, z, values)));
+	}
+	if(missing.size())
+		std::sort(vertices.begin(), vertices.end(), vertex_less());
+
+	const k3d::uint_t vertex_offset = Vertices.size();
+	for(k3d::uint_t i = 0; i != vertices.size(); ++i)
+		Vertices.push_back(vertices[i].second);
+
+	for(k3d::uint_t i = 0; i != surfaces.size(); ++i)
+	{
+		const std::vector<quad>& quads = surfaces[i].quads;
+		for(k3d::uint_t j = 0; j != quads.size(); ++j)
+		{
+			VertexCounts.push_back(4);
+			for(k3d::uint_t k = 0; k != 4; ++k)
+				VertexIndices.push_back(vertex_offset + (std::lower_bound(vertices.begin(), vertices.end(), quads[j].cells[k], vertex_less()) - vertices.begin()));
+		}
+	}
+}
+
+} // namespace detail
+
+/////////////////////////////////////////////////////////////////////////////
+// blobby_to_polyhedron
+
+class blobby_to_polyhedron :
+	public k3d::mesh_modifier<k3d::node >
+{
+	typedef k3d::mesh_modifier<k3d::node > base;
+
+public:
+	blobby_to_polyhedron(k3d::iplugin_factory& Factory, k3d::idocument& Document) :
+		base(Factory, Document),
+		m_resolution(init_owner(*this) + init_name("resolution") + init_label(_("Resolution")) + init_description(_("Number of grid cells spanning the region of influence of a typical (median-sized) blobby element")) + init_value(16) + init_constraint(constraint::minimum<k3d::int32_t>(2))),
+		m_threshold(init_owner(*this) + init_name("threshold") + init_label(_("Threshold")) + init_description(_("Field value at which the surface is extracted")) + init_value(0.421875) + init_step_increment(0.01) + init_units(typeid(k3d::measurement::scalar)))
+	{
+		m_resolution.changed_signal().connect(make_reset_mesh_slot());
+		m_threshold.changed_signal().connect(make_reset_mesh_slot());
+	}
+
+	void on_create_mesh(const k3d::mesh& Input, k3d::mesh& Output)
+	{
+		Output = Input;
+		Output.primitives.clear();
+
+		const k3d::double_t resolution = m_resolution.pipeline_value();
+		const k3d::double_t threshold = m_threshold.pipeline_value();
+
+		for(k3d::mesh::primitives_t::const_iterator primitive = Input.primitives.begin(); primitive != Input.primitives.end(); ++primitive)
+		{
+			boost::scoped_ptr<k3d::blobby::const_primitive> blobby(k3d::blobby::validate(Input, **primitive));
+			if(!blobby)
+			{
+				Output.primitives.push_back(*primitive);
+				continue;
+			}
+
+			const k3d::uint_t blobby_begin = 0;
+			const k3d::uint_t blobby_end = blobby_begin + blobby->first_primitives.size();
+			for(k3d::uint_t b = blobby_begin; b != blobby_end; ++b)
+			{
+				detail::expression expression;
+				detail::create_expression(*blobby, b, expression);
+
+				k3d::mesh::points_t vertices;
+				k3d::mesh::counts_t vertex_counts;
+				k3d::mesh::indices_t vertex_indices;
+				detail::polygonize(expression, resolution, threshold, vertices, vertex_counts, vertex_indices);
+
+				if(vertex_counts.empty())
+					continue;
+
+				boost::scoped_ptr<k3d::polyhedron::primitive> polyhedron(k3d::polyhedron::create(Output, vertices, vertex_counts, vertex_indices, blobby->materials[b]));
+			}
+		}
+	}
+
+	void on_update_mesh(const k3d::mesh& Input, k3d::mesh& Output)
+	{
+	}
+
+	static k3d::iplugin_factory& get_factory()
+	{
+		static k3d::document_plugin_factory<blobby_to_polyhedron,
+			k3d::interface_list<k3d::imesh_source,
+			k3d::interface_list<k3d::imesh_sink > > > factory(
+				k3d::uuid(0x5c1e0a37, 0x2b9d4f61, 0x8e03c7a4, 0x61f2d9b8),
+				"BlobbyToPolyhedron",
+				_("Converts blobby implicit surfaces into polyhedra"),
+				"Blobby",
+				k3d::iplugin_factory::EXPERIMENTAL);
+
+		return factory;
+	}
+
+private:
+	k3d_data(k3d::int32_t, immutable_name, change_signal, with_undo, local_storage, with_constraint, writable_property, with_serialization) m_resolution;
+	k3d_data(k3d::double_t, immutable_name, change_signal, with_undo, local_storage, no_constraint, measurement_property, with_serialization) m_threshold;
+};
+
+/////////////////////////////////////////////////////////////////////////////
+// blobby_to_polyhedron_factory
+
+k3d::iplugin_factory& blobby_to_polyhedron_factory()
+{
+	return blobby_to_polyhedron::get_factory();
+}
+
+} // namespace blobby
+
+} // namespace module
+
@@ -40,10 +40,15 @@
 #include <k3dsdk/polyhedron.h>
 #include <k3dsdk/property.h>
 #include <k3dsdk/triangulator.h>
+#include <k3dsdk/parallel/reduction_tree.h>
 #include <k3dsdk/user_property_changed_signal.h>
 
 #include <boost/mpl/vector.hpp>
 #include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <map>
+#include <vector>
 
 #include <carve/csg.hpp>
 #include <carve/mesh.hpp>
@@ -102,6 +107,58 @@ void merge_collinear_edges(const k3d::mesh::points_t& Points, k3d::polyhedron::p
 	k3d::euler::kill_edge_and_vertex(Polyhedron, redundant_edges, boundary_edges, companions, Points.size());
 }
 
+/// Returns the index of the first polyhedron in a mesh, or the number of primitives if there isn't one
+k3d::uint_t first_polyhedron(const k3d::mesh& Mesh)
+{
+	for(k3d::uint_t primitive = 0; primitive != Mesh.primitives.size(); ++primitive)
+	{
+		boost::scoped_ptr<k3d::polyhedron::const_primitive> polyhedron(k3d::polyhedron::validate(Mesh, *Mesh.primitives[primitive]));
+		if(polyhedron.get())
+			return primitive;
+	}
+
+	return Mesh.primitives.size();
+}
+
+/// Identifies the data an input is converted from by array generation, which changes whenever an array is modified
+typedef std::vector<k3d::uint_t> operand_key_t;
+
+const operand_key_t operand_key(const k3d::mesh& Mesh, const k3d::uint_t Primitive)
+{
+	operand_key_t result;
+	result.push_back(Primitive);
+	result.push_back(Mesh.points ? Mesh.points->generation() : 0);
+
+	const k3d::mesh::primitive& primitive = *Mesh.primitives[Primitive];
+	for(k3d::mesh::named_tables_t::const_iterator structure = primitive.structure.begin(); structure != primitive.structure.end(); ++structure)
+	{
+		for(k3d::table::const_iterator array = structure->second.begin(); array != structure->second.end(); ++array)
+			result.push_back(array->second.get() ? array->second->generation() : 0);
+	}
+
+	return result;
+}
+
+/// Applies a CSG operation to a pair of Carve meshes, for use with k3d::parallel::reduction_tree
+class csg_operation
+{
+public:
+	csg_operation(const csg::CSG::OP Operation) :
+		m_operation(Operation)
+	{
+	}
+
+	boost::shared_ptr<const mesh::MeshSet<3> > operator()(const mesh::MeshSet<3>& A, const mesh::MeshSet<3>& B) const
+	{
+		// Carve doesn't modify its inputs, but doesn't take them by const pointer either ...
+		csg::CSG csg;
+		return boost::shared_ptr<const mesh::MeshSet<3> >(csg.compute(const_cast<mesh::MeshSet<3>*>(&A), const_cast<mesh::MeshSet<3>*>(&B), m_operation));
+	}
+
+private:
+	const csg::CSG::OP m_operation;
+};
+
 /// Types supported for interpolation
 typedef boost::mpl::vector<k3d::color, k3d::double_t, k3d::texture3, k3d::int32_t, k3d::uint_t> interpolation_types;
 
@@ -156,7 +213,8 @@ public:
 		base(Factory, Document),
 		m_type(init_owner(*this) + init_name("type") + init_label(_("Type")) + init_description(_("Boolean operation (intersection, union, difference, reverse difference)")) + init_value(BOOLEAN_INTERSECTION) + init_enumeration(boolean_values())),
 		m_threshold(init_owner(*this) + init_name("threshold") + init_label(_("Threshold")) + init_description(_("Controls the sensitivity for deciding when to simplify coplanar faces or collinear edges.")) + init_value(1e-8) + init_step_increment(1e-8) + init_units(typeid(k3d::measurement::scalar))),
-		m_user_property_changed_signal(*this)	
+		m_user_property_changed_signal(*this),
+		m_reduction_type(BOOLEAN_UNION)
 	{
 		m_type.changed_signal().connect(k3d::hint::converter<
 			k3d::hint::convert<k3d::hint::any, k3d::hint::none> >(make_update_mesh_slot()));
@@ -170,7 +228,7 @@ public:
 	{
 		try
 		{
-			do_boolean(Output, *this);
+			do_boolean(Output);
 		}
 		catch (std::exception& E)
 		{
@@ -205,167 +263,227 @@ private:
 		BOOLEAN_REVERSE_DIFFERENCE
 	} boolean_t;
 	
-	class boolean_functor
+	typedef mesh::MeshSet<3> meshset_t;
+	typedef k3d::parallel::reduction_tree<meshset_t> reduction_t;
+	typedef reduction_t::value_ptr meshset_ptr;
+
+	/// Stores the Carve mesh converted from one input, along with the array generations it was converted from
+	struct operand_t
 	{
-	public:
-		boolean_functor(const boolean::boolean_t BooleanType, k3d::inode& Node) : m_boolean_type(BooleanType), m_node(Node), m_sequence(1)
+		detail::operand_key_t key;
+		meshset_ptr meshset;
+	};
+	typedef std::map<k3d::iproperty*, operand_t> operands_t;
+
+	/// Triangulates the holes in the given polyhedron and converts it to a Carve mesh
+	const meshset_ptr convert(const k3d::mesh& Mesh, const k3d::uint_t Primitive, const k3d::uint_t Sequence)
+	{
+		// make a copy of the mesh, where we can alter the face selection so everything is selected
+		k3d::mesh mesh_hole_faces_selected(Mesh);
+		boost::scoped_ptr<k3d::polyhedron::primitive> polyhedron(k3d::polyhedron::validate(mesh_hole_faces_selected, mesh_hole_faces_selected.primitives[Primitive].writable()));
+		return_val_if_fail(polyhedron.get(), meshset_ptr());
+
+		const k3d::uint_t input_face_count = polyhedron->face_selections.size();
+		for(k3d::uint_t face = 0; face != input_face_count; ++face)
 		{
+			polyhedron->face_selections[face] = polyhedron->face_loop_counts[face] > 1 ? 1.0 : 0.0;
 		}
 
-		void operator()(k3d::iproperty* const Property)
+		// We triangulate the holes
+		k3d::mesh triangulated_mesh;
+
+		const k3d::string_t sequence_string = k3d::string_cast(Sequence);
+
+		document().pipeline_profiler().start_execution(*this, "Triangulate input " + sequence_string);
+		const k3d::mesh::primitive* triangulated_prim = k3d::polyhedron::triangulate(mesh_hole_faces_selected, *polyhedron, triangulated_mesh);
+		boost::scoped_ptr<k3d::polyhedron::const_primitive> triangulated_polyhedron(k3d::polyhedron::validate(triangulated_mesh, *triangulated_prim));
+		document().pipeline_profiler().finish_execution(*this, "Triangulate input " + sequence_string);
+
+		std::vector<vertex_t::vector_t> vertices;
+		std::vector<int> faces;
+		const k3d::uint_t point_count = triangulated_mesh.points->size();
+		vertices.reserve(point_count);
+		for(k3d::uint_t p_idx = 0; p_idx != point_count; ++p_idx)
+		{
+			const k3d::point3& p = triangulated_mesh.points->at(p_idx);
+			vertices.push_back(geom::VECTOR(p[0],p[1],p[2]));
+		}
+		const k3d::uint_t face_count = triangulated_polyhedron->face_first_loops.size();
+		faces.reserve(face_count+triangulated_polyhedron->vertex_points.size());
+		for(k3d::uint_t face = 0; face != face_count; ++face)
 		{
-			if(Property->property_type() == typeid(k3d::mesh*))
+			assert_error(triangulated_polyhedron->face_loop_counts[face] == 1);
+			const k3d::uint_t loop = triangulated_polyhedron->face_first_loops[face];
+			const k3d::uint_t first_edge = triangulated_polyhedron->loop_first_edges[loop];
+			faces.push_back(0); // Number of points for this face is stored first
+			int& face_num_vertices = faces.back();
+			for(k3d::uint_t edge = first_edge; ;)
 			{
-				const k3d::mesh* const input_mesh = boost::any_cast<k3d::mesh*>(k3d::property::pipeline_value(*Property));
-				if(!input_mesh)
-					throw std::runtime_error("No mesh found in property " + Property->property_name());
-				// make a copy of the mesh, where we can alter the face selection so everything is selected
-				k3d::mesh mesh_hole_faces_selected(*input_mesh);
-				boost::scoped_ptr<k3d::polyhedron::primitive> polyhedron;
-				for(k3d::mesh::primitives_t::iterator primitive = mesh_hole_faces_selected.primitives.begin(); primitive != mesh_hole_faces_selected.primitives.end(); ++primitive)
-				{
-					// We only get the first polyhedron
-					polyhedron.reset(k3d::polyhedron::validate(mesh_hole_faces_selected, primitive->writable()));
-					if(polyhedron.get())
-						break;
-				}
-				if(!polyhedron.get())
-					return;
+				++face_num_vertices;
+				faces.push_back(triangulated_polyhedron->vertex_points[edge]);
 
-				const k3d::uint_t input_face_count = polyhedron->face_selections.size();
-				for(k3d::uint_t face = 0; face != input_face_count; ++face)
-				{
-					polyhedron->face_selections[face] = polyhedron->face_loop_counts[face] > 1 ? 1.0 : 0.0;
-				}
-				
-				// We triangulate the holes
-				k3d::mesh triangulated_mesh;
-				
-				k3d::string_t boolean_op = k3d::string_cast(m_sequence - 1);
-				k3d::string_t sequence_string = k3d::string_cast(m_sequence++); 
-				
-				m_node.document().pipeline_profiler().start_execution(m_node, "Triangulate input " + sequence_string);
-				const k3d::mesh::primitive* triangulated_prim = k3d::polyhedron::triangulate(mesh_hole_faces_selected, *polyhedron, triangulated_mesh);
-				boost::scoped_ptr<k3d::polyhedron::const_primitive> triangulated_polyhedron(k3d::polyhedron::validate(triangulated_mesh, *triangulated_prim));
-				m_node.document().pipeline_profiler().finish_execution(m_node, "Triangulate input " + sequence_string);
-
-				std::vector<vertex_t::vector_t> vertices;
-				std::vector<int> faces;
-				const k3d::uint_t point_count = triangulated_mesh.points->size();
-				vertices.reserve(point_count);
-				for(k3d::uint_t p_idx = 0; p_idx != point_count; ++p_idx)
-				{
-					const k3d::point3& p = triangulated_mesh.points->at(p_idx);
-					vertices.push_back(geom::VECTOR(p[0],p[1],p[2]));
-				}
-				const k3d::uint_t face_count = triangulated_polyhedron->face_first_loops.size();
-				faces.reserve(face_count+triangulated_polyhedron->vertex_points.size());
-				for(k3d::uint_t face = 0; face != face_count; ++face)
-				{
-					assert_error(triangulated_polyhedron->face_loop_counts[face] == 1);
-					const k3d::uint_t loop = triangulated_polyhedron->face_first_loops[face];
-					const k3d::uint_t first_edge = triangulated_polyhedron->loop_first_edges[loop];
-          faces.push_back(0); // Number of points for this face is stored first
-          int& face_num_vertices = faces.back();
-					for(k3d::uint_t edge = first_edge; ;)
-					{
-            ++face_num_vertices;
-						faces.push_back(triangulated_polyhedron->vertex_points[edge]);
-
-						edge = triangulated_polyhedron->clockwise_edges[edge];
-						if(edge == first_edge)
-							break;
-					}
-				}
-				mesh::MeshSet<3>* new_mesh = new mesh::MeshSet<3>(vertices, face_count, faces);
-				if (!m_result)
-				{
-					m_result.reset(new_mesh);
-				}
-				else
-				{
-					m_node.document().pipeline_profiler().start_execution(m_node, "Execute boolean operation " + boolean_op);
-					csg::CSG::OP op = csg::CSG::UNION;
-					switch(m_boolean_type)
-					{
-						case BOOLEAN_INTERSECTION:
-							op = csg::CSG::INTERSECTION;
-							break;
-			
-						case BOOLEAN_UNION:
-							op = csg::CSG::UNION;
-							break;
-			
-						case BOOLEAN_DIFFERENCE:
-							op = csg::CSG::A_MINUS_B;
-							break;
-							
-						case BOOLEAN_REVERSE_DIFFERENCE:
-							op = csg::CSG::B_MINUS_A;
-							break;
-					}
-					csg::CSG csg;
-					boost::scoped_ptr< mesh::MeshSet<3> > operand(new_mesh);
-					m_result.reset(csg.compute(m_result.get(), operand.get(), op));
-					m_node.document().pipeline_profiler().finish_execution(m_node, "Execute boolean operation " + boolean_op);
-				}
+				edge = triangulated_polyhedron->clockwise_edges[edge];
+				if(edge == first_edge)
+					break;
 			}
 		}
 
-		const mesh::MeshSet<3>& result()
+		return meshset_ptr(new meshset_t(vertices, face_count, faces));
+	}
+
+	/// Returns the first operand minus the union of the rest.  The union is reduced as a tree, so changing one
+	/// operand only repeats log2(N) unions and one difference, instead of every difference that follows it.
+	const meshset_ptr difference(const std::vector<meshset_ptr>& Operands)
+	{
+		if(Operands.empty())
+			return meshset_ptr();
+
+		const meshset_ptr minuend = Operands.front();
+		const meshset_ptr subtrahend = m_reduction.reduce(std::vector<meshset_ptr>(Operands.begin() + 1, Operands.end()), detail::csg_operation(csg::CSG::UNION));
+		if(!subtrahend)
+			return minuend;
+
+		if(!m_difference || minuend != m_minuend || subtrahend != m_subtrahend)
+		{
+			m_minuend = minuend;
+			m_subtrahend = subtrahend;
+			m_difference = detail::csg_operation(csg::CSG::A_MINUS_B)(*minuend, *subtrahend);
+		}
+
+		return m_difference;
+	}
+
+	/// Returns the reverse difference of the operands, which is evaluated from left-to-right as op(n) - (... - (op(2) - op(1))),
+	/// since it doesn't regroup.  Each step is cached along with its operands, so only the steps following a changed operand are repeated.
+	const meshset_ptr reverse_difference(const std::vector<meshset_ptr>& Operands)
+	{
+		if(Operands.empty())
 		{
-			return *m_result;
+			m_reverse_differences.clear();
+			return meshset_ptr();
 		}
-		
-		void canonicalize()
-    {
-      m_result->canonicalize();
-    }
 
-	private:
-		const boolean::boolean_t m_boolean_type;
-		k3d::inode& m_node;
-		k3d::uint_t m_sequence;
-		boost::scoped_ptr< mesh::MeshSet<3> > m_result;
-	};
-	
+		m_reverse_differences.resize(Operands.size() - 1);
+
+		meshset_ptr result = Operands.front();
+		for(k3d::uint_t i = 1; i != Operands.size(); ++i)
+		{
+			reverse_difference_t& step = m_reverse_differences[i - 1];
+			if(!step.result || step.left != result || step.right != Operands[i])
+			{
+				step.left = result;
+				step.right = Operands[i];
+				step.result = detail::csg_operation(csg::CSG::B_MINUS_A)(*step.left, *step.right);
+			}
+			result = step.result;
+		}
+
+		return result;
+	}
+
 	/// Executes a boolean operation
-	void do_boolean(k3d::mesh& Output, k3d::inode& Node)
+	void do_boolean(k3d::mesh& Output)
 	{
 		Output = k3d::mesh();
 		const boolean_t boolean_type = m_type.pipeline_value();
-		
+
+		// Convert inputs, reusing the conversions of inputs whose arrays haven't changed since the last execution ...
+		std::vector<meshset_ptr> operands;
+		operands_t current_operands;
+
 		const k3d::iproperty_collection::properties_t properties = k3d::property::user_properties(*static_cast<k3d::iproperty_collection*>(this));
-		boolean_functor functor(boolean_type, Node);
-		for(k3d::iproperty_collection::properties_t::const_iterator property = properties.begin(); property != properties.end(); ++property)
-			functor(*property);
+		for(k3d::iproperty_collection::properties_t::const_iterator p = properties.begin(); p != properties.end(); ++p)
+		{
+			k3d::iproperty* const property = *p;
+			if(property->property_type() != typeid(k3d::mesh*))
+				continue;
+
+			const k3d::mesh* const input_mesh = boost::any_cast<k3d::mesh*>(k3d::property::pipeline_value(*property));
+			if(!input_mesh)
+				throw std::runtime_error("No mesh found in property " + property->property_name());
+
+			// We only get the first polyhedron
+			const k3d::uint_t primitive = detail::first_polyhedron(*input_mesh);
+			if(primitive == input_mesh->primitives.size())
+				continue;
+
+			operand_t& operand = current_operands[property];
+			operand.key = detail::operand_key(*input_mesh, primitive);
+
+			const operands_t::const_iterator previous = m_operands.find(property);
+			if(previous != m_operands.end() && previous->second.key == operand.key)
+				operand.meshset = previous->second.meshset;
+			else
+				operand.meshset = convert(*input_mesh, primitive, operands.size() + 1);
+
+			if(operand.meshset)
+				operands.push_back(operand.meshset);
+		}
+
+		// Forget inputs that have been removed ...
+		m_operands.swap(current_operands);
 
+		// Intermediate results are only reusable by the same operation (difference reduces a union) ...
+		const boolean_t reduction_type = boolean_type == BOOLEAN_INTERSECTION ? BOOLEAN_INTERSECTION : BOOLEAN_UNION;
+		if(reduction_type != m_reduction_type)
+		{
+			m_reduction.clear();
+			m_reduction_type = reduction_type;
+		}
+
+		document().pipeline_profiler().start_execution(*this, "Execute boolean operations");
+		meshset_ptr result;
+		switch(boolean_type)
+		{
+			case BOOLEAN_INTERSECTION:
+				result = m_reduction.reduce(operands, detail::csg_operation(csg::CSG::INTERSECTION));
+				break;
+
+			case BOOLEAN_UNION:
+				result = m_reduction.reduce(operands, detail::csg_operation(csg::CSG::UNION));
+				break;
+
+			case BOOLEAN_DIFFERENCE:
+				result = difference(operands);
+				break;
+
+			case BOOLEAN_REVERSE_DIFFERENCE:
+				result = reverse_difference(operands);
+				break;
+		}
+		document().pipeline_profiler().finish_execution(*this, "Execute boolean operations");
+
+		if(!result)
+			return;
+
+		// Canonicalize a copy, since the result may be cached ...
 		document().pipeline_profiler().start_execution(*this, "Canonicalize");
-		functor.canonicalize();
+		boost::scoped_ptr<meshset_t> canonical(result->clone());
+		canonical->canonicalize();
 		document().pipeline_profiler().finish_execution(*this, "Canonicalize");
-			
+
 		k3d::mesh::points_t vertices;
 		k3d::mesh::counts_t vertex_counts;
 		k3d::mesh::indices_t vertex_indices;
 
 		std::map<const vertex_t*, k3d::uint_t> vertex_map;
 
-		const k3d::uint_t vertex_count = functor.result().vertex_storage.size();
+		const k3d::uint_t vertex_count = canonical->vertex_storage.size();
 		vertices.reserve(vertex_count);
 		for(k3d::uint_t v_idx = 0; v_idx != vertex_count; ++v_idx)
 		{
-			const vertex_t& v = functor.result().vertex_storage[v_idx];
+			const vertex_t& v = canonical->vertex_storage[v_idx];
 			vertex_map[&v] = vertices.size();
 			vertices.push_back(k3d::point3(v.v[0], v.v[1], v.v[2]));
 		}
 
-		const const_face_iter faces_begin = functor.result().faceBegin();
-    const const_face_iter faces_end = functor.result().faceEnd();
+		const const_face_iter faces_begin = canonical->faceBegin();
+		const const_face_iter faces_end = canonical->faceEnd();
 		for(const_face_iter face_it = faces_begin; face_it != faces_end; ++face_it)
 		{
 			const face_t& f = **face_it;
-      std::vector<vertex_t*> face_verts;
-      f.getVertices(face_verts);
+			std::vector<vertex_t*> face_verts;
+			f.getVertices(face_verts);
 			const k3d::uint_t f_v_count = face_verts.size();
 			vertex_counts.push_back(f_v_count);
 			for(k3d::uint_t v_idx = 0; v_idx != f_v_count; ++v_idx)
@@ -433,6 +551,24 @@ private:
 	k3d_data(boolean_t, immutable_name, change_signal, with_undo, local_storage, no_constraint, enumeration_property, with_serialization) m_type;
 	k3d_data(k3d::double_t, immutable_name, change_signal, with_undo, local_storage, no_constraint, measurement_property, with_serialization) m_threshold;
 	k3d::user_property_changed_signal m_user_property_changed_signal;
+
+	/// Caches converted inputs, by input property
+	operands_t m_operands;
+	/// Caches intermediate results of the most recent reduction
+	reduction_t m_reduction;
+	boolean_t m_reduction_type;
+	/// Caches the most recent difference, along with its operands
+	meshset_ptr m_minuend;
+	meshset_ptr m_subtrahend;
+	meshset_ptr m_difference;
+	/// Caches each step of the most recent reverse difference
+	struct reverse_difference_t
+	{
+		meshset_ptr left;
+		meshset_ptr right;
+		meshset_ptr result;
+	};
+	std::vector<reverse_difference_t> m_reverse_differences;
 };
 
 k3d::iplugin_factory& boolean_factory()
@@ -42,10 +42,15 @@
 #include <k3dsdk/polyhedron.h>
 #include <k3dsdk/property.h>
 #include <k3dsdk/triangulator.h>
+#include <k3dsdk/parallel/reduction_tree.h>
 #include <k3dsdk/user_property_changed_signal.h>
 
 #include <boost/scoped_ptr.hpp>
 
+#include <algorithm>
+#include <map>
+#include <vector>
+
 namespace module
 {
 
@@ -97,6 +102,55 @@ void merge_collinear_edges(const k3d::mesh::points_t& Points, k3d::polyhedron::p
 
 	k3d::euler::kill_edge_and_vertex(Polyhedron, redundant_edges, boundary_edges, companions, Points.size());
 }
+
+/// Returns the index of the first polyhedron in a mesh, or the number of primitives if there isn't one
+k3d::uint_t first_polyhedron(const k3d::mesh& Mesh)
+{
+	for(k3d::uint_t primitive = 0; primitive != Mesh.primitives.size(); ++primitive)
+	{
+		boost::scoped_ptr<k3d::polyhedron::const_primitive> polyhedron(k3d::polyhedron::validate(Mesh, *Mesh.primitives[primitive]));
+		if(polyhedron.get())
+			return primitive;
+	}
+
+	return Mesh.primitives.size();
+}
+
+/// Identifies the data an input is converted from by array generation, which changes whenever an array is modified
+typedef std::vector<k3d::uint_t> operand_key_t;
+
+const operand_key_t operand_key(const k3d::mesh& Mesh, const k3d::uint_t Primitive)
+{
+	operand_key_t result;
+	result.push_back(Primitive);
+	result.push_back(Mesh.points ? Mesh.points->generation() : 0);
+
+	const k3d::mesh::primitive& primitive = *Mesh.primitives[Primitive];
+	for(k3d::mesh::named_tables_t::const_iterator structure = primitive.structure.begin(); structure != primitive.structure.end(); ++structure)
+	{
+		for(k3d::table::const_iterator array = structure->second.begin(); array != structure->second.end(); ++array)
+			result.push_back(array->second.get() ? array->second->generation() : 0);
+	}
+
+	return result;
+}
+
+/// Nef polyhedron operations for use with k3d::parallel::reduction_tree
+struct nef_union
+{
+	boost::shared_ptr<const exact_nef> operator()(const exact_nef& A, const exact_nef& B) const
+	{
+		return boost::shared_ptr<const exact_nef>(new exact_nef(A + B));
+	}
+};
+
+struct nef_intersection
+{
+	boost::shared_ptr<const exact_nef> operator()(const exact_nef& A, const exact_nef& B) const
+	{
+		return boost::shared_ptr<const exact_nef>(new exact_nef(A * B));
+	}
+};
 	
 } // namespace detail
 
@@ -114,7 +168,8 @@ public:
 		base(Factory, Document),
 		m_type(init_owner(*this) + init_name("type") + init_label(_("Type")) + init_description(_("Boolean operation (intersection, union, difference, reverse difference)")) + init_value(BOOLEAN_INTERSECTION) + init_enumeration(boolean_values())),
 		m_threshold(init_owner(*this) + init_name("threshold") + init_label(_("Threshold")) + init_description(_("Controls the sensitivity for deciding when to simplify coplanar faces or collinear edges.")) + init_value(1e-8) + init_step_increment(1e-8) + init_units(typeid(k3d::measurement::scalar))),
-		m_user_property_changed_signal(*this)	
+		m_user_property_changed_signal(*this),
+		m_reduction_type(BOOLEAN_UNION)
 	{
 		m_type.changed_signal().connect(k3d::hint::converter<
 			k3d::hint::convert<k3d::hint::any, k3d::hint::none> >(make_update_mesh_slot()));
@@ -128,7 +183,7 @@ public:
 	{
 		try
 		{
-			do_boolean<exact_nef>(Output, *this);
+			do_boolean(Output);
 
 			boost::scoped_ptr<k3d::polyhedron::primitive> output_polyhedron;
 			for(k3d::mesh::primitives_t::iterator primitive = Output.primitives.begin(); primitive != Output.primitives.end(); ++primitive)
@@ -182,108 +237,140 @@ private:
 		BOOLEAN_REVERSE_DIFFERENCE
 	} boolean_t;
 	
-	template<typename nef_t>
-	class boolean_functor
+	typedef k3d::parallel::reduction_tree<exact_nef> reduction_t;
+	typedef reduction_t::value_ptr nef_ptr;
+
+	/// Stores the Nef polyhedron converted from one input, along with the array generations it was converted from
+	struct operand_t
 	{
-	public:
-		boolean_functor(const boolean::boolean_t BooleanType, nef_t& Result, k3d::inode& Node) : m_boolean_type(BooleanType), m_result(Result), m_started(false), m_node(Node), m_sequence(1)
-		{
-		}
-		void operator()(k3d::iproperty* const Property)
+		detail::operand_key_t key;
+		nef_ptr nef;
+	};
+	typedef std::map<k3d::iproperty*, operand_t> operands_t;
+
+	/// Triangulates the given polyhedron and converts it to a Nef polyhedron, returns an empty pointer if the polyhedron isn't solid
+	const nef_ptr convert(const k3d::mesh& Mesh, const k3d::uint_t Primitive, const k3d::uint_t Sequence)
+	{
+		// make a copy of the mesh, where we can alter the face selection so everything is selected
+		k3d::mesh mesh_all_faces_selected(Mesh);
+		boost::scoped_ptr<k3d::polyhedron::primitive> polyhedron(k3d::polyhedron::validate(mesh_all_faces_selected, mesh_all_faces_selected.primitives[Primitive].writable()));
+		return_val_if_fail(polyhedron.get(), nef_ptr());
+		return_val_if_fail(k3d::polyhedron::is_solid(*polyhedron), nef_ptr());
+		polyhedron->face_selections.assign(polyhedron->face_selections.size(), 1.0);
+
+		// First triangulate inputs
+		k3d::mesh triangulated_mesh;
+
+		const k3d::string_t sequence_string = k3d::string_cast(Sequence);
+
+		document().pipeline_profiler().start_execution(*this, "Triangulate input " + sequence_string);
+		const k3d::mesh::primitive* triangulated_prim = k3d::polyhedron::triangulate(mesh_all_faces_selected, *polyhedron, triangulated_mesh);
+		boost::scoped_ptr<k3d::polyhedron::const_primitive> triangulated_polyhedron(k3d::polyhedron::validate(triangulated_mesh, *triangulated_prim));
+		document().pipeline_profiler().finish_execution(*this, "Triangulate input " + sequence_string);
+
+		document().pipeline_profiler().start_execution(*this, "Convert input " + sequence_string + " to Nef");
+		const nef_ptr operand = to_nef<exact_nef>(*triangulated_mesh.points, *triangulated_polyhedron);
+		document().pipeline_profiler().finish_execution(*this, "Convert input " + sequence_string + " to Nef");
+
+		return operand;
+	}
+
+	/// Returns the first operand minus the union of the rest.  The union is reduced as a tree, so changing one
+	/// operand only repeats log2(N) unions and one difference, instead of every difference that follows it.
+	const nef_ptr difference(const std::vector<nef_ptr>& Operands)
+	{
+		if(Operands.empty())
+			return nef_ptr();
+
+		const nef_ptr minuend = Operands.front();
+		const nef_ptr subtrahend = m_reduction.reduce(std::vector<nef_ptr>(Operands.begin() + 1, Operands.end()), detail::nef_union());
+		if(!subtrahend)
+			return minuend;
+
+		if(!m_difference || minuend != m_minuend || subtrahend != m_subtrahend)
 		{
-			if(Property->property_type() == typeid(k3d::mesh*))
-			{
-				const k3d::mesh* const input_mesh = boost::any_cast<k3d::mesh*>(k3d::property::pipeline_value(*Property));
-				if(!input_mesh)
-					throw std::runtime_error("No mesh found in property " + Property->property_name());
-				// make a copy of the mesh, where we can alter the face selection so everything is selected
-				k3d::mesh mesh_all_faces_selected(*input_mesh);
-				boost::scoped_ptr<k3d::polyhedron::primitive> polyhedron;
-				for(k3d::mesh::primitives_t::iterator primitive = mesh_all_faces_selected.primitives.begin(); primitive != mesh_all_faces_selected.primitives.end(); ++primitive)
-				{
-					// We only get the first polyhedron
-					polyhedron.reset(k3d::polyhedron::validate(mesh_all_faces_selected, primitive->writable()));
-					if(polyhedron.get())
-						break;
-				}
-				if(!polyhedron.get())
-					return;
-				return_if_fail(k3d::polyhedron::is_solid(*polyhedron));
-				polyhedron->face_selections.assign(polyhedron->face_selections.size(), 1.0);
-				
-				// First triangulate inputs
-				k3d::mesh triangulated_mesh;
-				
-				k3d::string_t boolean_op = k3d::string_cast(m_sequence - 1);
-				k3d::string_t sequence_string = k3d::string_cast(m_sequence++); 
-				
-				m_node.document().pipeline_profiler().start_execution(m_node, "Triangulate input " + sequence_string);
-				const k3d::mesh::primitive* triangulated_prim = k3d::polyhedron::triangulate(mesh_all_faces_selected, *polyhedron, triangulated_mesh);
-				boost::scoped_ptr<k3d::polyhedron::const_primitive> triangulated_polyhedron(k3d::polyhedron::validate(triangulated_mesh, *triangulated_prim));
-				m_node.document().pipeline_profiler().finish_execution(m_node, "Triangulate input " + sequence_string);
-				
-				m_node.document().pipeline_profiler().start_execution(m_node, "Convert input " + sequence_string + " to Nef");
-				boost::shared_ptr<nef_t> operand = to_nef<nef_t>(*triangulated_mesh.points, *triangulated_polyhedron);
-				m_node.document().pipeline_profiler().finish_execution(m_node, "Convert input " + sequence_string + " to Nef");
-				return_if_fail(operand.get());
-				if (!m_started)
-				{
-					m_result = *operand;
-					m_started = true;
-				}
-				else
-				{
-					m_node.document().pipeline_profiler().start_execution(m_node, "Execute boolean operation " + boolean_op);
-					switch(m_boolean_type)
-					{
-						case BOOLEAN_INTERSECTION:
-							m_result *= *operand;
-							break;
-			
-						case BOOLEAN_UNION:
-							m_result += *operand;
-							break;
-			
-						case BOOLEAN_DIFFERENCE:
-							m_result -= *operand;
-							break;
-							
-						case BOOLEAN_REVERSE_DIFFERENCE:
-							m_result -= *operand;
-							break;
-					}
-					m_node.document().pipeline_profiler().finish_execution(m_node, "Execute boolean operation " + boolean_op);
-				}
-			}
+			m_minuend = minuend;
+			m_subtrahend = subtrahend;
+			m_difference.reset(new exact_nef(*minuend - *subtrahend));
 		}
-	private:
-		const boolean::boolean_t m_boolean_type;
-		nef_t& m_result;
-		k3d::bool_t m_started;
-		k3d::inode& m_node;
-		k3d::uint_t m_sequence;
-	};
-	
-	/// Executes a boolean operation, using the given Nef polyhedron type
-	template<typename nef_t>
-	void do_boolean(k3d::mesh& Output, k3d::inode& Node)
+
+		return m_difference;
+	}
+
+	/// Executes a boolean operation
+	void do_boolean(k3d::mesh& Output)
 	{
 		Output = k3d::mesh();
-		nef_t result;
 		const boolean_t boolean_type = m_type.pipeline_value();
-		
+
+		// Convert inputs, reusing the conversions of inputs whose arrays haven't changed since the last execution ...
+		std::vector<nef_ptr> operands;
+		operands_t current_operands;
+
 		const k3d::iproperty_collection::properties_t properties = k3d::property::user_properties(*static_cast<k3d::iproperty_collection*>(this));
-		boolean_functor<nef_t> functor(boolean_type, result, Node);
-		if (boolean_type == BOOLEAN_REVERSE_DIFFERENCE)
+		for(k3d::iproperty_collection::properties_t::const_iterator p = properties.begin(); p != properties.end(); ++p)
 		{
-			std::for_each(properties.rbegin(), properties.rend(), functor);
+			k3d::iproperty* const property = *p;
+			if(property->property_type() != typeid(k3d::mesh*))
+				continue;
+
+			const k3d::mesh* const input_mesh = boost::any_cast<k3d::mesh*>(k3d::property::pipeline_value(*property));
+			if(!input_mesh)
+				throw std::runtime_error("No mesh found in property " + property->property_name());
+
+			// We only get the first polyhedron
+			const k3d::uint_t primitive = detail::first_polyhedron(*input_mesh);
+			if(primitive == input_mesh->primitives.size())
+				continue;
+
+			operand_t& operand = current_operands[property];
+			operand.key = detail::operand_key(*input_mesh, primitive);
+
+			const operands_t::const_iterator previous = m_operands.find(property);
+			if(previous != m_operands.end() && previous->second.key == operand.key)
+				operand.nef = previous->second.nef;
+			else
+				operand.nef = convert(*input_mesh, primitive, operands.size() + 1);
+
+			if(operand.nef)
+				operands.push_back(operand.nef);
 		}
-		else
+
+		// Forget inputs that have been removed ...
+		m_operands.swap(current_operands);
+
+		if(boolean_type == BOOLEAN_REVERSE_DIFFERENCE)
+			std::reverse(operands.begin(), operands.end());
+
+		// Intermediate results are only reusable by the same operation (difference reduces a union) ...
+		const boolean_t reduction_type = boolean_type == BOOLEAN_INTERSECTION ? BOOLEAN_INTERSECTION : BOOLEAN_UNION;
+		if(reduction_type != m_reduction_type)
 		{
-			std::for_each(properties.begin(), properties.end(), functor);
+			m_reduction.clear();
+			m_reduction_type = reduction_type;
+		}
+
+		document().pipeline_profiler().start_execution(*this, "Execute boolean operations");
+		nef_ptr result;
+		switch(boolean_type)
+		{
+			case BOOLEAN_INTERSECTION:
+				result = m_reduction.reduce(operands, detail::nef_intersection());
+				break;
+
+			case BOOLEAN_UNION:
+				result = m_reduction.reduce(operands, detail::nef_union());
+				break;
+
+			case BOOLEAN_DIFFERENCE:
+			case BOOLEAN_REVERSE_DIFFERENCE:
+				result = difference(operands);
+				break;
 		}
-			
-		to_mesh(result, Output, static_cast<k3d::imaterial*>(0));
+		document().pipeline_profiler().finish_execution(*this, "Execute boolean operations");
+
+		if(result)
+			to_mesh(*result, Output, static_cast<k3d::imaterial*>(0));
 	}
 
 	static const k3d::ienumeration_property::enumeration_values_t& boolean_values()
@@ -343,6 +430,16 @@ private:
 	k3d_data(boolean_t, immutable_name, change_signal, with_undo, local_storage, no_constraint, enumeration_property, with_serialization) m_type;
 	k3d_data(k3d::double_t, immutable_name, change_signal, with_undo, local_storage, no_constraint, measurement_property, with_serialization) m_threshold;
 	k3d::user_property_changed_signal m_user_property_changed_signal;
+
+	/// Caches converted inputs, by input property
+	operands_t m_operands;
+	/// Caches intermediate results of the most recent reduction
+	reduction_t m_reduction;
+	boolean_t m_reduction_type;
+	/// Caches the most recent difference, along with its operands
+	nef_ptr m_minuend;
+	nef_ptr m_subtrahend;
+	nef_ptr m_difference;
 };
 
 k3d::iplugin_factory& boolean_factory()
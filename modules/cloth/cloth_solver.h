@@ -61,6 +61,29 @@ public:
 
 	}
 
+	/// Stores the position and velocity of every particle as a simulation checkpoint
+	void save_state(std::vector<double>& State)
+	{
+		State.resize(6 * particles.size());
+		for(int i=0; i<particles.size(); i++)
+			for(int j=0; j<3; j++)
+			{
+				State[6*i+j] = particles[i].x[j];
+				State[6*i+3+j] = particles[i].v[j];
+			}
+	}
+
+	/// Restores the position and velocity of every particle from a simulation checkpoint
+	void restore_state(const std::vector<double>& State)
+	{
+		for(int i=0; i<particles.size() && 6*i+5 < State.size(); i++)
+			for(int j=0; j<3; j++)
+			{
+				particles[i].x[j] = State[6*i+j];
+				particles[i].v[j] = State[6*i+3+j];
+			}
+	}
+
 	void compute_accelerations(d_Vecf Y, d_Vecf *out, const k3d::mesh::selection_t& PointSelection)
 	{
 		static d_Vecf W;
@@ -227,7 +250,7 @@ public:
 		get_state();
 		compute_accelerations(X, &k1, PointSelection);
 		k1 = k1*dt;
-		compute_accelerations(X+k2/2, &k2, PointSelection);
+		compute_accelerations(X+k1/2, &k2, PointSelection);
 		k2 = k2*dt;
 		compute_accelerations(X+k2/2, &k3, PointSelection);
 		k3 = k3*dt;
@@ -30,6 +30,7 @@
 #include <k3dsdk/document_plugin_factory.h>
 #include <k3dsdk/measurement.h>
 #include <k3dsdk/mesh_deformation_modifier.h>
+#include <k3dsdk/simulation_cache.h>
 
 #include "d_Vec3f.h"
 #include "cloth_solver.h"
@@ -50,15 +51,36 @@ public:
 		m_time(init_owner(*this) + init_name("time") + init_label(_("Time")) + init_description(_("Controls the current time displayed in the viewports.")) + init_value(0.0) + init_step_increment(0.1) + init_units(typeid(k3d::measurement::time))),
 		m_damping(init_owner(*this) + init_name("damping") + init_label(_("Damping")) + init_description(_("Damping of cloth")) + init_value(1.0) + init_step_increment(0.1) + init_units(typeid(k3d::measurement::scalar))),
 		m_gravity(init_owner(*this) + init_name("gravity") + init_label(_("Gravity")) + init_description(_("Gravity to affect the system")) + init_value(-9.81) + init_step_increment(0.1) + init_units(typeid(k3d::measurement::scalar))),
-		m_stiffness(init_owner(*this) + init_name("stiffness") + init_label(_("Stiffness")) + init_description(_("Stiffness of cloth (k constant for spring structure)")) + init_value(20) + init_step_increment(0.1) + init_units(typeid(k3d::measurement::scalar)))
+		m_stiffness(init_owner(*this) + init_name("stiffness") + init_label(_("Stiffness")) + init_description(_("Stiffness of cloth (k constant for spring structure)")) + init_value(20) + init_step_increment(0.1) + init_units(typeid(k3d::measurement::scalar))),
+		solver(0)
 	{
+		m_input_mesh.changed_signal().connect(sigc::mem_fun(*this, &simulation::simulation_changed));
+		m_mesh_selection.changed_signal().connect(sigc::mem_fun(*this, &simulation::simulation_changed));
+		m_damping.changed_signal().connect(sigc::mem_fun(*this, &simulation::simulation_changed));
+		m_gravity.changed_signal().connect(sigc::mem_fun(*this, &simulation::simulation_changed));
+		m_stiffness.changed_signal().connect(sigc::mem_fun(*this, &simulation::simulation_changed));
+
 		m_mesh_selection.changed_signal().connect(make_reset_mesh_slot());
 		m_time.changed_signal().connect(make_update_mesh_slot());
-		first_time = true;
+		m_damping.changed_signal().connect(make_update_mesh_slot());
+		m_gravity.changed_signal().connect(make_update_mesh_slot());
+		m_stiffness.changed_signal().connect(make_update_mesh_slot());
+	}
+
+	~simulation()
+	{
+		delete solver;
+	}
+
+	/// Called whenever a parameter that affects the simulation changes, invalidating every cached frame
+	void simulation_changed(k3d::ihint*)
+	{
+		m_cache.clear();
 	}
 
 	void on_deform_mesh(const k3d::mesh& InputMesh, const k3d::mesh::points_t& InputPoints, const k3d::mesh::selection_t& PointSelection, k3d::mesh::points_t& OutputPoints)
 	{
+		const double time = m_time.pipeline_value();
 		const double damping = m_damping.pipeline_value();
 		const double gravity = m_gravity.pipeline_value();
 		const double stiffness = m_stiffness.pipeline_value();
@@ -66,20 +88,47 @@ public:
 		//const k3d::mesh::indices_t& loop_first_edges = *InputMesh.polyhedra->loop_first_edges;
 		//const k3d::mesh::indices_t& edge_points = *InputMesh.polyhedra->edge_points;
 
-		if(first_time)
+		if(!solver)
 		{
 			solver = new cloth_solver(36);
-			solver->generate_particles(InputPoints);
-			first_time = false;
-		}		
+			m_cache.clear();
+		}
+
+		// Always advance in whole steps on a fixed grid, so jumping to a time produces the same state as playing every frame up to it ...
+		const k3d::int64_t target_step = k3d::simulation_cache::step_index(time, step_size);
+
+		// Resume from the nearest checkpoint at-or-before the requested time, or start over from the input points ...
+		k3d::int64_t step = 0;
+		double checkpoint_time = 0;
+		if(const k3d::simulation_cache::state_t* const checkpoint = m_cache.nearest(target_step * step_size, checkpoint_time))
+		{
+			solver->restore_state(*checkpoint);
+			step = k3d::simulation_cache::step_index(checkpoint_time, step_size);
+		}
 		else
-		{	
-			solver->set_constants(gravity, damping, stiffness);
+		{
+			solver->generate_particles(InputPoints);
+
+			k3d::simulation_cache::state_t state;
+			solver->save_state(state);
+			m_cache.store(0, state);
+		}
 
-			for(int i=0; i<10; i++)
-				solver->rk_step(0.003, PointSelection);
+		// Integrate over the gap, checkpointing intermediate frames along the way ...
+		solver->set_constants(gravity, damping, stiffness);
+		while(step < target_step)
+		{
+			solver->rk_step(step_size, PointSelection);
+			++step;
+
+			if(step % checkpoint_interval == 0 || step == target_step)
+			{
+				k3d::simulation_cache::state_t state;
+				solver->save_state(state);
+				m_cache.store(step * step_size, state);
+			}
 		}
-		
+
 		solver->update_vertices(OutputPoints);
 	}
 
@@ -96,14 +145,22 @@ public:
 
 		return factory;
 	}
+	/// Defines the size of a single solver step, in seconds
+	static const double step_size;
+	/// Defines the number of solver steps between checkpoints
+	static const k3d::int64_t checkpoint_interval = 10;
+
 	k3d_data(double, immutable_name, change_signal, no_undo, local_storage, no_constraint, measurement_property, with_serialization) m_time;
 	k3d_data(double, immutable_name, change_signal, no_undo, local_storage, no_constraint, measurement_property, with_serialization) m_damping;
 	k3d_data(double, immutable_name, change_signal, no_undo, local_storage, no_constraint, measurement_property, with_serialization) m_gravity;
 	k3d_data(double, immutable_name, change_signal, no_undo, local_storage, no_constraint, measurement_property, with_serialization) m_stiffness;
 	cloth_solver *solver;
-	bool first_time;
+	/// Stores per-frame checkpoints of particle state
+	k3d::simulation_cache m_cache;
 };
 
+const double simulation::step_size = 0.003;
+
 } // namespace cloth
 
 } // namespace module
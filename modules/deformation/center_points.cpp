@@ -22,10 +22,9 @@
 	\author Romain Behar (romainbehar@yahoo.com)
 */
 
-#include "linear_transformation_worker.h"
-
 #include <k3d-i18n-config.h>
 #include <k3dsdk/document_plugin_factory.h>
+#include <k3dsdk/linear_transformation_worker.h>
 #include <k3dsdk/measurement.h>
 #include <k3dsdk/mesh_simple_deformation_modifier.h>
 
@@ -62,18 +61,24 @@ public:
 		if(bounds.empty())
 			return;
 
-		const bool center_x = m_center_x.pipeline_value();
-		const bool center_y = m_center_y.pipeline_value();
-		const bool center_z = m_center_z.pipeline_value();
-
-		const k3d::matrix4 transformation = k3d::translate3(k3d::vector3(
-			center_x ? -0.5 * (bounds.px + bounds.nx) : 0,
-			center_y ? -0.5 * (bounds.py + bounds.ny) : 0,
-			center_z ? -0.5 * (bounds.pz + bounds.nz) : 0));
+		const k3d::matrix4 transformation = transformation_matrix(bounds);
 
 		k3d::parallel::parallel_for(
 			k3d::parallel::blocked_range<k3d::uint_t>(0, OutputPoints.size(), k3d::parallel::grain_size()),
-			linear_transformation_worker(InputPoints, PointSelection, OutputPoints, transformation));
+			k3d::linear_transformation_worker(InputPoints, PointSelection, OutputPoints, transformation));
+	}
+
+	void on_deform_selected_points(const k3d::mesh::points_t& InputPoints, const k3d::mesh::selection_t& PointSelection, const k3d::mesh::indices_t& SelectedPoints, k3d::mesh::points_t& OutputPoints)
+	{
+		const k3d::bounding_box3 bounds = k3d::mesh::bounds(InputPoints);
+		if(bounds.empty())
+			return;
+
+		const k3d::matrix4 transformation = transformation_matrix(bounds);
+
+		k3d::parallel::parallel_for(
+			k3d::parallel::blocked_range<k3d::uint_t>(0, SelectedPoints.size(), k3d::parallel::grain_size()),
+			k3d::selected_linear_transformation_worker(InputPoints, PointSelection, SelectedPoints, OutputPoints, transformation));
 	}
 
 	static k3d::iplugin_factory& get_factory()
@@ -91,6 +96,18 @@ public:
 	}
 
 private:
+	const k3d::matrix4 transformation_matrix(const k3d::bounding_box3& Bounds)
+	{
+		const bool center_x = m_center_x.pipeline_value();
+		const bool center_y = m_center_y.pipeline_value();
+		const bool center_z = m_center_z.pipeline_value();
+
+		return k3d::translate3(k3d::vector3(
+			center_x ? -0.5 * (Bounds.px + Bounds.nx) : 0,
+			center_y ? -0.5 * (Bounds.py + Bounds.ny) : 0,
+			center_z ? -0.5 * (Bounds.pz + Bounds.nz) : 0));
+	}
+
 	k3d_data(bool, immutable_name, change_signal, with_undo, local_storage, no_constraint, writable_property, with_serialization) m_center_x;
 	k3d_data(bool, immutable_name, change_signal, with_undo, local_storage, no_constraint, writable_property, with_serialization) m_center_y;
 	k3d_data(bool, immutable_name, change_signal, with_undo, local_storage, no_constraint, writable_property, with_serialization) m_center_z;
@@ -0,0 +1,264 @@
+// K-3D
+// Copyright (c) 1995-2010, Timothy M. Shead
+//
+// Contact: tshead@k-3d.com
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+/** \file
+	\author Timothy M. Shead (tshead@k-3d.com)
+*/
+
+#include <k3d-i18n-config.h>
+#include <k3dsdk/algebra.h>
+#include <k3dsdk/axis.h>
+#include <k3dsdk/document_plugin_factory.h>
+#include <k3dsdk/log.h>
+#include <k3dsdk/measurement.h>
+#include <k3dsdk/mesh_simple_deformation_modifier.h>
+#include <k3dsdk/noise.h>
+
+namespace module
+{
+
+namespace deformation
+{
+
+/////////////////////////////////////////////////////////////////////////////
+// fractal_point_noise
+
+class fractal_point_noise :
+	public k3d::mesh_simple_deformation_modifier
+{
+	typedef k3d::mesh_simple_deformation_modifier base;
+
+public:
+	fractal_point_noise(k3d::iplugin_factory& Factory, k3d::idocument& Document) :
+		base(Factory, Document),
+		m_basis(init_owner(*this) + init_name("basis") + init_label(_("Basis")) + init_description(_("Noise generator summed at each octave")) + init_value(SIMPLEX) + init_enumeration(basis_values())),
+		m_fractal(init_owner(*this) + init_name("fractal") + init_label(_("Fractal")) + init_description(_("How octaves are combined")) + init_value(FBM) + init_enumeration(fractal_values())),
+		m_octaves(init_owner(*this) + init_name("octaves") + init_label(_("Octaves")) + init_description(_("Number of octaves to sum")) + init_value(6) + init_step_increment(1) + init_constraint(constraint::minimum<k3d::int32_t>(1)) + init_units(typeid(k3d::measurement::scalar))),
+		m_lacunarity(init_owner(*this) + init_name("lacunarity") + init_label(_("Lacunarity")) + init_description(_("Frequency multiplier between octaves")) + init_value(2.0) + init_step_increment(0.1) + init_units(typeid(k3d::measurement::scalar))),
+		m_gain(init_owner(*this) + init_name("gain") + init_label(_("Gain")) + init_description(_("Amplitude multiplier between octaves")) + init_value(0.5) + init_step_increment(0.05) + init_units(typeid(k3d::measurement::scalar))),
+		m_frequency(init_owner(*this) + init_name("frequency") + init_label(_("Frequency")) + init_description(_("Frequency of the first octave")) + init_value(0.1) + init_step_increment(0.01) + init_units(typeid(k3d::measurement::scalar))),
+		m_offset(init_owner(*this) + init_name("offset") + init_label(_("Offset")) + init_description(_("Offset added to noise coordinates")) + init_value(k3d::point3(0, 0, 0))),
+		m_amplitude(init_owner(*this) + init_name("amplitude") + init_label(_("Amplitude")) + init_description(_("Displacement scale")) + init_value(1.0) + init_step_increment(0.1) + init_units(typeid(k3d::measurement::distance))),
+		m_axis(init_owner(*this) + init_name("axis") + init_label(_("Axis")) + init_description(_("Displace points along given axis")) + init_value(k3d::Z) + init_enumeration(k3d::axis_values()))
+	{
+		m_mesh_selection.changed_signal().connect(make_update_mesh_slot());
+		m_basis.changed_signal().connect(make_update_mesh_slot());
+		m_fractal.changed_signal().connect(make_update_mesh_slot());
+		m_octaves.changed_signal().connect(make_update_mesh_slot());
+		m_lacunarity.changed_signal().connect(make_update_mesh_slot());
+		m_gain.changed_signal().connect(make_update_mesh_slot());
+		m_frequency.changed_signal().connect(make_update_mesh_slot());
+		m_offset.changed_signal().connect(make_update_mesh_slot());
+		m_amplitude.changed_signal().connect(make_update_mesh_slot());
+		m_axis.changed_signal().connect(make_update_mesh_slot());
+	}
+
+	void on_deform_mesh(const k3d::mesh::points_t& InputPoints, const k3d::mesh::selection_t& PointSelection, k3d::mesh::points_t& OutputPoints)
+	{
+		const Basis basis = m_basis.pipeline_value();
+		const Fractal fractal = m_fractal.pipeline_value();
+		const k3d::uint_t octaves = m_octaves.pipeline_value();
+		const k3d::double_t lacunarity = m_lacunarity.pipeline_value();
+		const k3d::double_t gain = m_gain.pipeline_value();
+		const k3d::double_t frequency = m_frequency.pipeline_value();
+		const k3d::point3 offset = m_offset.pipeline_value();
+		const k3d::double_t amplitude = m_amplitude.pipeline_value();
+		const k3d::axis axis = m_axis.pipeline_value();
+
+		const k3d::uint_t point_count = OutputPoints.size();
+		if(!point_count)
+			return;
+
+		std::vector<k3d::double_t> x(point_count);
+		std::vector<k3d::double_t> y(point_count);
+		std::vector<k3d::double_t> z(point_count);
+		for(k3d::uint_t point = 0; point != point_count; ++point)
+		{
+			x[point] = offset[0] + frequency * InputPoints[point][0];
+			y[point] = offset[1] + frequency * InputPoints[point][1];
+			z[point] = offset[2] + frequency * InputPoints[point][2];
+		}
+
+		std::vector<k3d::double_t> displacement(point_count);
+		switch(basis)
+		{
+			case CLASSIC:
+				sample<k3d::noise::classic3>(fractal, octaves, lacunarity, gain, point_count, &x[0], &y[0], &z[0], &displacement[0]);
+				break;
+			case SIMPLEX:
+				sample<k3d::noise::simplex3>(fractal, octaves, lacunarity, gain, point_count, &x[0], &y[0], &z[0], &displacement[0]);
+				break;
+		}
+
+		k3d::vector3 direction(0, 0, 0);
+		direction[axis] = amplitude;
+
+		for(k3d::uint_t point = 0; point != point_count; ++point)
+			OutputPoints[point] = k3d::mix(InputPoints[point], InputPoints[point] + displacement[point] * direction, PointSelection[point]);
+	}
+
+	static k3d::iplugin_factory& get_factory()
+	{
+		static k3d::document_plugin_factory<fractal_point_noise,
+			k3d::interface_list<k3d::imesh_source,
+			k3d::interface_list<k3d::imesh_sink > > > factory(
+				k3d::uuid(0x4c1e8a37, 0x92d54b06, 0xb83f71e2, 0x0da6c59b),
+				"FractalPointNoise",
+				_("Displaces mesh points along an axis using fractal noise"),
+				"Deformation",
+				k3d::iplugin_factory::EXPERIMENTAL);
+
+		return factory;
+	}
+
+private:
+	typedef enum
+	{
+		CLASSIC,
+		SIMPLEX
+	} Basis;
+
+	friend std::ostream& operator<<(std::ostream& Stream, const Basis& Value)
+	{
+		switch(Value)
+		{
+			case CLASSIC:
+				Stream << "classic";
+				break;
+			case SIMPLEX:
+				Stream << "simplex";
+				break;
+		}
+
+		return Stream;
+	}
+
+	friend std::istream& operator>>(std::istream& Stream, Basis& Value)
+	{
+		std::string text;
+		Stream >> text;
+
+		if(text == "classic")
+			Value = CLASSIC;
+		else if(text == "simplex")
+			Value = SIMPLEX;
+		else
+			k3d::log() << error << k3d_file_reference << ": unknown enumeration [" << text << "]" << std::endl;
+
+		return Stream;
+	}
+
+	static const k3d::ienumeration_property::enumeration_values_t& basis_values()
+	{
+		static k3d::ienumeration_property::enumeration_values_t values;
+		if(values.empty())
+		{
+			values.push_back(k3d::ienumeration_property::enumeration_value_t("Classic", "classic", "Classic Perlin noise"));
+			values.push_back(k3d::ienumeration_property::enumeration_value_t("Simplex", "simplex", "Perlin simplex noise"));
+		}
+
+		return values;
+	}
+
+	typedef enum
+	{
+		FBM,
+		TURBULENCE
+	} Fractal;
+
+	friend std::ostream& operator<<(std::ostream& Stream, const Fractal& Value)
+	{
+		switch(Value)
+		{
+			case FBM:
+				Stream << "fbm";
+				break;
+			case TURBULENCE:
+				Stream << "turbulence";
+				break;
+		}
+
+		return Stream;
+	}
+
+	friend std::istream& operator>>(std::istream& Stream, Fractal& Value)
+	{
+		std::string text;
+		Stream >> text;
+
+		if(text == "fbm")
+			Value = FBM;
+		else if(text == "turbulence")
+			Value = TURBULENCE;
+		else
+			k3d::log() << error << k3d_file_reference << ": unknown enumeration [" << text << "]" << std::endl;
+
+		return Stream;
+	}
+
+	static const k3d::ienumeration_property::enumeration_values_t& fractal_values()
+	{
+		static k3d::ienumeration_property::enumeration_values_t values;
+		if(values.empty())
+		{
+			values.push_back(k3d::ienumeration_property::enumeration_value_t("fBm", "fbm", "Fractional Brownian motion, a signed sum of octaves"));
+			values.push_back(k3d::ienumeration_property::enumeration_value_t("Turbulence", "turbulence", "Sum of the absolute value of octaves"));
+		}
+
+		return values;
+	}
+
+	template<typename GeneratorT>
+	static void sample(const Fractal Type, const k3d::uint_t Octaves, const k3d::double_t Lacunarity, const k3d::double_t Gain, const k3d::uint_t Count, const k3d::double_t* X, const k3d::double_t* Y, const k3d::double_t* Z, k3d::double_t* Results)
+	{
+		switch(Type)
+		{
+			case FBM:
+				k3d::noise::sample(k3d::noise::fbm<GeneratorT>(Octaves, Lacunarity, Gain), Count, X, Y, Z, Results);
+				break;
+			case TURBULENCE:
+				k3d::noise::sample(k3d::noise::turbulence<GeneratorT>(Octaves, Lacunarity, Gain), Count, X, Y, Z, Results);
+				break;
+		}
+	}
+
+	k3d_data(Basis, immutable_name, change_signal, with_undo, local_storage, no_constraint, enumeration_property, with_serialization) m_basis;
+	k3d_data(Fractal, immutable_name, change_signal, with_undo, local_storage, no_constraint, enumeration_property, with_serialization) m_fractal;
+	k3d_data(k3d::int32_t, immutable_name, change_signal, with_undo, local_storage, with_constraint, measurement_property, with_serialization) m_octaves;
+	k3d_data(k3d::double_t, immutable_name, change_signal, with_undo, local_storage, no_constraint, measurement_property, with_serialization) m_lacunarity;
+	k3d_data(k3d::double_t, immutable_name, change_signal, with_undo, local_storage, no_constraint, measurement_property, with_serialization) m_gain;
+	k3d_data(k3d::double_t, immutable_name, change_signal, with_undo, local_storage, no_constraint, measurement_property, with_serialization) m_frequency;
+	k3d_data(k3d::point3, immutable_name, change_signal, with_undo, local_storage, no_constraint, writable_property, with_serialization) m_offset;
+	k3d_data(k3d::double_t, immutable_name, change_signal, with_undo, local_storage, no_constraint, measurement_property, with_serialization) m_amplitude;
+	k3d_data(k3d::axis, immutable_name, change_signal, with_undo, local_storage, no_constraint, enumeration_property, with_serialization) m_axis;
+};
+
+/////////////////////////////////////////////////////////////////////////////
+// fractal_point_noise_factory
+
+k3d::iplugin_factory& fractal_point_noise_factory()
+{
+	return fractal_point_noise::get_factory();
+}
+
+} // namespace deformation
+
+} // namespace module
+
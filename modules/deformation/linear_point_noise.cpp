@@ -101,25 +101,54 @@ public:
 		const k3d::double_t amplitude_y = m_amplitude_y.pipeline_value();
 		const k3d::double_t amplitude_z = m_amplitude_z.pipeline_value();
 
+		const k3d::uint_t point_count = OutputPoints.size();
+		if(!point_count)
+			return;
+
+		// Evaluate the noise in batches, one component at a time, using the same per-component offsets as k3d::noise::map3() ...
+		std::vector<k3d::double_t> x(point_count);
+		std::vector<k3d::double_t> y(point_count);
+		std::vector<k3d::double_t> z(point_count);
+		for(k3d::uint_t point = 0; point != point_count; ++point)
+		{
+			x[point] = use_x ? offset_x + frequency_x * InputPoints[point][0] : 0.0;
+			y[point] = use_y ? offset_y + frequency_y * InputPoints[point][1] : 0.0;
+			z[point] = use_z ? offset_z + frequency_z * InputPoints[point][2] : 0.0;
+		}
+
+		const k3d::bool_t move[3] = { move_x, move_y, move_z };
+		const k3d::double_t component_offset[3][3] = { { 0.34, 0.66, 0.237 }, { 0.011, 0.845, 0.037 }, { 0.34, 0.12, 0.9 } };
+
 		k3d::noise::classic3 noise;
+		std::vector<k3d::double_t> sample_x(point_count);
+		std::vector<k3d::double_t> sample_y(point_count);
+		std::vector<k3d::double_t> sample_z(point_count);
+		std::vector<k3d::double_t> perturb[3];
+		for(k3d::uint_t component = 0; component != 3; ++component)
+		{
+			perturb[component].resize(point_count, 0.0);
+			if(!move[component])
+				continue;
+
+			for(k3d::uint_t point = 0; point != point_count; ++point)
+			{
+				sample_x[point] = x[point] + component_offset[component][0];
+				sample_y[point] = y[point] + component_offset[component][1];
+				sample_z[point] = z[point] + component_offset[component][2];
+			}
+
+			k3d::noise::sample(noise, point_count, &sample_x[0], &sample_y[0], &sample_z[0], &perturb[component][0]);
+		}
 
-		const k3d::uint_t point_begin = 0;
-		const k3d::uint_t point_end = point_begin + OutputPoints.size();
-		for(k3d::uint_t point = point_begin; point != point_end; ++point)
+		for(k3d::uint_t point = 0; point != point_count; ++point)
 		{
 			const k3d::point3 start = InputPoints[point];
 
-			const k3d::vector3 perturb = k3d::noise::map3<k3d::vector3>(
-				noise,
-				use_x ? offset_x + frequency_x * start[0] : 0.0,
-				use_y ? offset_y + frequency_y * start[1] : 0.0,
-				use_z ? offset_z + frequency_z * start[2] : 0.0);
-
 			const k3d::vector3 offset =
 				k3d::vector3(
-					move_x ? amplitude_x * perturb[0] : 0.0,
-					move_y ? amplitude_y * perturb[1] : 0.0,
-					move_z ? amplitude_z * perturb[2] : 0.0);
+					move_x ? amplitude_x * perturb[0][point] : 0.0,
+					move_y ? amplitude_y * perturb[1][point] : 0.0,
+					move_z ? amplitude_z * perturb[2][point] : 0.0);
 
 			OutputPoints[point] = k3d::mix(start, start + offset, PointSelection[point]);
 		}
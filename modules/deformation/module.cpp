@@ -34,6 +34,7 @@ extern k3d::iplugin_factory& bulge_points_factory();
 extern k3d::iplugin_factory& center_points_factory();
 extern k3d::iplugin_factory& cylindrical_wave_points_factory();
 extern k3d::iplugin_factory& deformation_expression_factory();
+extern k3d::iplugin_factory& fractal_point_noise_factory();
 extern k3d::iplugin_factory& linear_point_noise_factory();
 extern k3d::iplugin_factory& linear_wave_points_factory();
 extern k3d::iplugin_factory& morph_points_factory();
@@ -58,6 +59,7 @@ K3D_MODULE_START(Registry)
 	Registry.register_factory(module::deformation::center_points_factory());
 	Registry.register_factory(module::deformation::cylindrical_wave_points_factory());
 	Registry.register_factory(module::deformation::deformation_expression_factory());
+	Registry.register_factory(module::deformation::fractal_point_noise_factory());
 	Registry.register_factory(module::deformation::linear_point_noise_factory());
 	Registry.register_factory(module::deformation::linear_wave_points_factory());
 	Registry.register_factory(module::deformation::morph_points_factory());
@@ -22,12 +22,10 @@
 	\author Romain Behar (romainbehar@yahoo.com)
 */
 
-#include "linear_transformation_worker.h"
-
 #include <k3d-i18n-config.h>
 #include <k3dsdk/document_plugin_factory.h>
 #include <k3dsdk/measurement.h>
-#include <k3dsdk/mesh_simple_deformation_modifier.h>
+#include <k3dsdk/mesh_linear_deformation_modifier.h>
 
 namespace module
 {
@@ -39,9 +37,9 @@ namespace deformation
 // scale_points
 
 class scale_points :
-	public k3d::mesh_simple_deformation_modifier
+	public k3d::mesh_linear_deformation_modifier
 {
-	typedef k3d::mesh_simple_deformation_modifier base;
+	typedef k3d::mesh_linear_deformation_modifier base;
 
 public:
 	scale_points(k3d::iplugin_factory& Factory, k3d::idocument& Document) :
@@ -56,15 +54,6 @@ public:
 		m_z.changed_signal().connect(make_update_mesh_slot());
 	}
 
-	void on_deform_mesh(const k3d::mesh::points_t& InputPoints, const k3d::mesh::selection_t& PointSelection, k3d::mesh::points_t& OutputPoints)
-	{
-		const k3d::matrix4 transformation = k3d::scale3(m_x.pipeline_value(), m_y.pipeline_value(), m_z.pipeline_value());
-
-		k3d::parallel::parallel_for(
-			k3d::parallel::blocked_range<k3d::uint_t>(0, OutputPoints.size(), k3d::parallel::grain_size()),
-			linear_transformation_worker(InputPoints, PointSelection, OutputPoints, transformation));
-	}
-
 	static k3d::iplugin_factory& get_factory()
 	{
 		static k3d::document_plugin_factory<scale_points,
@@ -80,6 +69,11 @@ public:
 	}
 
 private:
+	const k3d::matrix4 transformation_matrix()
+	{
+		return k3d::scale3(m_x.pipeline_value(), m_y.pipeline_value(), m_z.pipeline_value());
+	}
+
 	k3d_data(double, immutable_name, change_signal, with_undo, local_storage, no_constraint, measurement_property, with_serialization) m_x;
 	k3d_data(double, immutable_name, change_signal, with_undo, local_storage, no_constraint, measurement_property, with_serialization) m_y;
 	k3d_data(double, immutable_name, change_signal, with_undo, local_storage, no_constraint, measurement_property, with_serialization) m_z;
@@ -22,13 +22,11 @@
 	\author Romain Behar (romainbehar@yahoo.com)
 */
 
-#include "linear_transformation_worker.h"
-
 #include <k3d-i18n-config.h>
 #include <k3dsdk/axis.h>
 #include <k3dsdk/document_plugin_factory.h>
 #include <k3dsdk/measurement.h>
-#include <k3dsdk/mesh_simple_deformation_modifier.h>
+#include <k3dsdk/mesh_linear_deformation_modifier.h>
 
 namespace module
 {
@@ -40,9 +38,9 @@ namespace deformation
 // shear_points
 
 class shear_points :
-	public k3d::mesh_simple_deformation_modifier
+	public k3d::mesh_linear_deformation_modifier
 {
-	typedef k3d::mesh_simple_deformation_modifier base;
+	typedef k3d::mesh_linear_deformation_modifier base;
 
 public:
 	shear_points(k3d::iplugin_factory& Factory, k3d::idocument& Document) :
@@ -57,26 +55,6 @@ public:
 		m_shear_factor.changed_signal().connect(make_update_mesh_slot());
 	}
 
-	void on_deform_mesh(const k3d::mesh::points_t& InputPoints, const k3d::mesh::selection_t& PointSelection, k3d::mesh::points_t& OutputPoints)
-	{
-		const k3d::axis direction = m_direction.pipeline_value();
-		const k3d::axis axis = m_axis.pipeline_value();
-		const double shear_factor = m_shear_factor.pipeline_value();
-
-		const double xy = k3d::X == direction && k3d::Y == axis ? shear_factor : 0;
-		const double xz = k3d::X == direction && k3d::Z == axis ? shear_factor : 0;
-		const double yx = k3d::Y == direction && k3d::X == axis ? shear_factor : 0;
-		const double yz = k3d::Y == direction && k3d::Z == axis ? shear_factor : 0;
-		const double zx = k3d::Z == direction && k3d::X == axis ? shear_factor : 0;
-		const double zy = k3d::Z == direction && k3d::Y == axis ? shear_factor : 0;
-
-		const k3d::matrix4 transformation = k3d::shear3(xy, xz, yx, yz, zx, zy);
-
-		k3d::parallel::parallel_for(
-			k3d::parallel::blocked_range<k3d::uint_t>(0, OutputPoints.size(), k3d::parallel::grain_size()),
-			linear_transformation_worker(InputPoints, PointSelection, OutputPoints, transformation));
-	}
-
 	static k3d::iplugin_factory& get_factory()
 	{
 		static k3d::document_plugin_factory<shear_points,
@@ -92,6 +70,22 @@ public:
 	}
 
 private:
+	const k3d::matrix4 transformation_matrix()
+	{
+		const k3d::axis direction = m_direction.pipeline_value();
+		const k3d::axis axis = m_axis.pipeline_value();
+		const double shear_factor = m_shear_factor.pipeline_value();
+
+		const double xy = k3d::X == direction && k3d::Y == axis ? shear_factor : 0;
+		const double xz = k3d::X == direction && k3d::Z == axis ? shear_factor : 0;
+		const double yx = k3d::Y == direction && k3d::X == axis ? shear_factor : 0;
+		const double yz = k3d::Y == direction && k3d::Z == axis ? shear_factor : 0;
+		const double zx = k3d::Z == direction && k3d::X == axis ? shear_factor : 0;
+		const double zy = k3d::Z == direction && k3d::Y == axis ? shear_factor : 0;
+
+		return k3d::shear3(xy, xz, yx, yz, zx, zy);
+	}
+
 	k3d_data(k3d::axis, immutable_name, change_signal, with_undo, local_storage, no_constraint, enumeration_property, with_serialization) m_direction;
 	k3d_data(k3d::axis, immutable_name, change_signal, with_undo, local_storage, no_constraint, enumeration_property, with_serialization) m_axis;
 	k3d_data(double, immutable_name, change_signal, with_undo, local_storage, no_constraint, measurement_property, with_serialization) m_shear_factor;
@@ -22,16 +22,12 @@
 	\author Timothy M. Shead (tshead@k-3d.com)
 */
 
-#include "linear_transformation_worker.h"
-
 #include <k3d-i18n-config.h>
 #include <k3dsdk/document_plugin_factory.h>
 #include <k3dsdk/measurement.h>
-#include <k3dsdk/mesh_simple_deformation_modifier.h>
+#include <k3dsdk/mesh_linear_deformation_modifier.h>
 #include <k3dsdk/transformable.h>
 
-#include <k3dsdk/ipipeline_profiler.h>
-
 namespace module
 {
 
@@ -42,9 +38,9 @@ namespace deformation
 // transform_points
 
 class transform_points :
-	public k3d::transformable<k3d::mesh_simple_deformation_modifier>
+	public k3d::transformable<k3d::mesh_linear_deformation_modifier>
 {
-	typedef k3d::transformable<k3d::mesh_simple_deformation_modifier> base;
+	typedef k3d::transformable<k3d::mesh_linear_deformation_modifier> base;
 
 public:
 	transform_points(k3d::iplugin_factory& Factory, k3d::idocument& Document) :
@@ -54,15 +50,6 @@ public:
 		m_input_matrix.changed_signal().connect(make_update_mesh_slot());
 	}
 
-	void on_deform_mesh(const k3d::mesh::points_t& InputPoints, const k3d::mesh::selection_t& PointSelection, k3d::mesh::points_t& OutputPoints)
-	{
-		k3d::ipipeline_profiler::profile profile(document().pipeline_profiler(), *this, "Deform Mesh");
-		const k3d::matrix4 transformation = m_input_matrix.pipeline_value();
-		k3d::parallel::parallel_for(
-			k3d::parallel::blocked_range<k3d::uint_t>(0, OutputPoints.size(), k3d::parallel::grain_size()),
-			linear_transformation_worker(InputPoints, PointSelection, OutputPoints, transformation));
-	}
-
 	static k3d::iplugin_factory& get_factory()
 	{
 		static k3d::document_plugin_factory<transform_points,
@@ -80,6 +67,10 @@ public:
 	}
 
 private:
+	const k3d::matrix4 transformation_matrix()
+	{
+		return m_input_matrix.pipeline_value();
+	}
 };
 
 /////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,413 @@
+// K-3D
+// Copyright (c) 1995-2006, Timothy M. Shead
+//
+// Contact: tshead@k-3d.com
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+/** \file
+	\author Timothy M. Shead (tshead@k-3d.com)
+*/
+
+#include "freetype.h"
+#include "glyph_cache.h"
+
+#include <k3dsdk/bezier.h>
+#include <k3dsdk/log.h>
+
+#include <glibmm/thread.h>
+
+#include <boost/weak_ptr.hpp>
+
+#include <map>
+
+namespace module
+{
+
+namespace freetype2
+{
+
+namespace detail
+{
+
+/// Defines a closed contour
+typedef k3d::mesh::points_t contour_t;
+/// Defines a collection of closed contours
+typedef std::vector<contour_t> contours_t;
+
+/// Returns the signed 2D area of a contour
+const k3d::double_t area(const contour_t& Contour)
+{
+	k3d::double_t result = 0;
+
+	for(k3d::uint_t i = 0; i != Contour.size(); ++i)
+		result += (Contour[i][0] * Contour[(i+1)%Contour.size()][1]) - (Contour[(i+1)%Contour.size()][0] * Contour[i][1]);
+
+	return result * 0.5;
+}
+
+/// Returns true iff a contour is clockwise
+const bool clockwise(const contour_t& Contour)
+{
+	return area(Contour) < 0;
+}
+
+/// Adds a face with holes to a glyph, skipping degenerate faces the same way k3d::polyhedron::add_face() does
+void add_face(glyph& Glyph, const contour_t& Face, const contours_t& Holes)
+{
+	if(Face.size() < 2)
+		return;
+	for(k3d::uint_t hole = 0; hole != Holes.size(); ++hole)
+	{
+		if(Holes[hole].size() < 2)
+			return;
+	}
+
+	Glyph.face_loop_counts.push_back(Holes.size() + 1);
+
+	Glyph.loop_point_counts.push_back(Face.size());
+	Glyph.points.insert(Glyph.points.end(), Face.begin(), Face.end());
+
+	for(k3d::uint_t hole = 0; hole != Holes.size(); ++hole)
+	{
+		Glyph.loop_point_counts.push_back(Holes[hole].size());
+		Glyph.points.insert(Glyph.points.end(), Holes[hole].begin(), Holes[hole].end());
+	}
+}
+
+/// Converts a freetype glyph outline into polygons
+class freetype_outline
+{
+public:
+	freetype_outline(const k3d::uint_t CurveDivisions) :
+		curve_divisions(CurveDivisions)
+	{
+		ft_outline_funcs.move_to = raw_move_to_func;
+		ft_outline_funcs.line_to = raw_line_to_func;
+		ft_outline_funcs.conic_to = raw_conic_to_func;
+		ft_outline_funcs.cubic_to = raw_cubic_to_func;
+		ft_outline_funcs.shift = 0;
+		ft_outline_funcs.delta = 0;
+	}
+
+	void convert(FT_Outline& Outline, glyph& Glyph)
+	{
+		contours.clear();
+
+		// Generate a set of closed contours ...
+		FT_Outline_Decompose(&Outline, &ft_outline_funcs, this);
+
+		// Segregate contours into faces and holes, based on their orientation (clockwise or counter-clockwise, respectively)
+		contours_t face_contours;
+		contours_t hole_contours;
+		for(contours_t::iterator contour = contours.begin(); contour != contours.end(); ++contour)
+		{
+			if(clockwise(*contour))
+				face_contours.push_back(*contour);
+			else
+				hole_contours.push_back(*contour);
+		}
+
+		// Create faces.  This is a bit of hack, because we assume that all hole contours belong to the first
+		// face contour ...
+		if(face_contours.size())
+			add_face(Glyph, face_contours[0], hole_contours);
+
+		for(k3d::uint_t i = 1; i < face_contours.size(); ++i)
+			add_face(Glyph, face_contours[i], contours_t());
+	}
+
+private:
+	void begin_contour(const k3d::point3& From)
+	{
+		contours.push_back(contour_t());
+		last_point = From;
+	}
+
+	void line_to(const k3d::point3& To)
+	{
+		contours.back().push_back(To);
+		last_point = To;
+	}
+
+	void conic_to(const k3d::point3& From, const k3d::point3& Control, const k3d::point3& To)
+	{
+		std::vector<k3d::point3> control_points;
+		control_points.push_back(From);
+		control_points.push_back(Control);
+		control_points.push_back(To);
+
+		for(k3d::uint_t i = 0; i != curve_divisions; ++i)
+		{
+			contours.back().push_back(k3d::Bezier<k3d::point3>(control_points, static_cast<k3d::double_t>(i+1) / static_cast<k3d::double_t>(curve_divisions)));
+		}
+
+		last_point = To;
+	}
+
+	void cubic_to(const k3d::point3& From, const k3d::point3& Control1, const k3d::point3& Control2, const k3d::point3& To)
+	{
+		std::vector<k3d::point3> control_points;
+		control_points.push_back(From);
+		control_points.push_back(Control1);
+		control_points.push_back(Control2);
+		control_points.push_back(To);
+
+		for(k3d::uint_t i = 0; i != curve_divisions; ++i)
+		{
+			contours.back().push_back(k3d::Bezier<k3d::point3>(control_points, static_cast<k3d::double_t>(i+1) / static_cast<k3d::double_t>(curve_divisions)));
+		}
+
+		last_point = To;
+	}
+
+	const k3d::point3 convert(const FT_Vector* RHS)
+	{
+		return k3d::point3(RHS->x, RHS->y, 0);
+	}
+
+	int move_to_func(const FT_Vector* To)
+	{
+		begin_contour(convert(To));
+		return 0;
+	}
+
+	int line_to_func(const FT_Vector* To)
+	{
+		line_to(convert(To));
+		return 0;
+	}
+
+	int conic_to_func(const FT_Vector* Control, const FT_Vector* To)
+	{
+		conic_to(last_point, convert(Control), convert(To));
+		return 0;
+	}
+
+	int cubic_to_func(const FT_Vector* Control1, const FT_Vector* Control2, const FT_Vector* To)
+	{
+		cubic_to(last_point, convert(Control1), convert(Control2), convert(To));
+		return 0;
+	}
+
+#if (((FREETYPE_MAJOR) > 2) || ((FREETYPE_MAJOR) == 2 && (FREETYPE_MINOR) >= 2))
+
+	static int raw_move_to_func(const FT_Vector* to, void* user)
+	{
+		return reinterpret_cast<freetype_outline*>(user)->move_to_func(to);
+	}
+
+	static int raw_line_to_func(const FT_Vector* to, void* user)
+	{
+		return reinterpret_cast<freetype_outline*>(user)->line_to_func(to);
+	}
+
+	static int raw_conic_to_func(const FT_Vector* control, const FT_Vector* to, void* user)
+	{
+		return reinterpret_cast<freetype_outline*>(user)->conic_to_func(control, to);
+	}
+
+	static int raw_cubic_to_func(const FT_Vector* control1, const FT_Vector* control2, const FT_Vector* to, void* user)
+	{
+		return reinterpret_cast<freetype_outline*>(user)->cubic_to_func(control1, control2, to);
+	}
+
+#else
+
+	static int raw_move_to_func(FT_Vector* to, void* user)
+	{
+		return reinterpret_cast<freetype_outline*>(user)->move_to_func(to);
+	}
+
+	static int raw_line_to_func(FT_Vector* to, void* user)
+	{
+		return reinterpret_cast<freetype_outline*>(user)->line_to_func(to);
+	}
+
+	static int raw_conic_to_func(FT_Vector* control, FT_Vector* to, void* user)
+	{
+		return reinterpret_cast<freetype_outline*>(user)->conic_to_func(control, to);
+	}
+
+	static int raw_cubic_to_func(FT_Vector* control1, FT_Vector* control2, FT_Vector* to, void* user)
+	{
+		return reinterpret_cast<freetype_outline*>(user)->cubic_to_func(control1, control2, to);
+	}
+
+#endif
+
+	const k3d::uint_t curve_divisions;
+
+	FT_Outline_Funcs ft_outline_funcs;
+
+	k3d::point3 last_point;
+	contours_t contours;
+};
+
+} // namespace detail
+
+/////////////////////////////////////////////////////////////////////////////
+// glyph
+
+glyph::glyph() :
+	advance(0)
+{
+}
+
+/////////////////////////////////////////////////////////////////////////////
+// glyph_cache::implementation
+
+class glyph_cache::implementation
+{
+public:
+	implementation(const k3d::filesystem::path& Font, const k3d::uint_t CurveDivisions) :
+		font(Font),
+		ft_face(ft_library, Font),
+		outline(CurveDivisions),
+		normalize_height(0)
+	{
+		if(ft_face.is_scalable())
+			normalize_height = 1.0 / static_cast<k3d::double_t>(ft_face->bbox.yMax - ft_face->bbox.yMin);
+	}
+
+	const k3d::filesystem::path font;
+	library ft_library;
+	face ft_face;
+	detail::freetype_outline outline;
+	k3d::double_t normalize_height;
+
+	/// Stores converted glyphs by character code, with NULL entries for glyphs that couldn't be loaded
+	typedef std::map<k3d::uint_t, glyph*> glyphs_t;
+	glyphs_t glyphs;
+	/// Serializes access to the freetype face and the glyph map
+	Glib::Mutex mutex;
+};
+
+/////////////////////////////////////////////////////////////////////////////
+// glyph_cache
+
+namespace detail
+{
+
+/// Identifies a cache by font path and curve-division setting
+typedef std::pair<k3d::string_t, k3d::uint_t> cache_key_t;
+/// Caches stay alive for as long as some node holds a reference to them
+typedef std::map<cache_key_t, boost::weak_ptr<glyph_cache> > caches_t;
+
+caches_t& caches()
+{
+	static caches_t storage;
+	return storage;
+}
+
+Glib::Mutex& caches_mutex()
+{
+	static Glib::Mutex storage;
+	return storage;
+}
+
+} // namespace detail
+
+boost::shared_ptr<glyph_cache> glyph_cache::get(const k3d::filesystem::path& Font, const k3d::uint_t CurveDivisions)
+{
+	Glib::Mutex::Lock lock(detail::caches_mutex());
+
+	const detail::cache_key_t key(Font.native_filesystem_string(), CurveDivisions);
+	boost::shared_ptr<glyph_cache> result = detail::caches()[key].lock();
+	if(result)
+		return result;
+
+	implementation* const cache = new implementation(Font, CurveDivisions);
+
+	if(!cache->ft_library)
+	{
+		k3d::log() << error << "Error initializing FreeType library" << std::endl;
+		delete cache;
+		return boost::shared_ptr<glyph_cache>();
+	}
+
+	if(!cache->ft_face)
+	{
+		k3d::log() << error << "Error opening font file: " << Font.native_console_string() << std::endl;
+		delete cache;
+		return boost::shared_ptr<glyph_cache>();
+	}
+
+	if(!cache->ft_face.is_scalable())
+	{
+		k3d::log() << error << "Not a scalable font: " << Font.native_console_string() << std::endl;
+		delete cache;
+		return boost::shared_ptr<glyph_cache>();
+	}
+
+	result.reset(new glyph_cache(cache));
+	detail::caches()[key] = result;
+
+	return result;
+}
+
+glyph_cache::glyph_cache(implementation* const Implementation) :
+	m_implementation(Implementation)
+{
+}
+
+glyph_cache::~glyph_cache()
+{
+	for(implementation::glyphs_t::iterator cached = m_implementation->glyphs.begin(); cached != m_implementation->glyphs.end(); ++cached)
+		delete cached->second;
+
+	delete m_implementation;
+}
+
+const k3d::filesystem::path& glyph_cache::font() const
+{
+	return m_implementation->font;
+}
+
+k3d::double_t glyph_cache::normalize_height() const
+{
+	return m_implementation->normalize_height;
+}
+
+const glyph* glyph_cache::lookup(const k3d::uint_t Character)
+{
+	Glib::Mutex::Lock lock(m_implementation->mutex);
+
+	implementation::glyphs_t::iterator cached = m_implementation->glyphs.find(Character);
+	if(cached != m_implementation->glyphs.end())
+		return cached->second;
+
+	face& ft_face = m_implementation->ft_face;
+
+	glyph* result = 0;
+	if(0 == FT_Load_Glyph(ft_face, FT_Get_Char_Index(ft_face, static_cast<FT_ULong>(Character)), FT_LOAD_NO_SCALE | FT_LOAD_IGNORE_TRANSFORM))
+	{
+		result = new glyph();
+		m_implementation->outline.convert(ft_face->glyph->outline, *result);
+		result->advance = ft_face->glyph->metrics.horiAdvance;
+	}
+	else
+	{
+		k3d::log() << error << "Error loading glyph for " << m_implementation->font.native_console_string() << "[" << static_cast<char>(Character) << "]" << std::endl;
+	}
+
+	m_implementation->glyphs.insert(std::make_pair(Character, result));
+	return result;
+}
+
+} // namespace freetype2
+
+} // namespace module
+
@@ -0,0 +1,86 @@
+#ifndef MODULES_FREETYPE2_GLYPH_CACHE_H
+#define MODULES_FREETYPE2_GLYPH_CACHE_H
+
+// K-3D
+// Copyright (c) 1995-2006, Timothy M. Shead
+//
+// Contact: tshead@k-3d.com
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+/** \file
+	\author Timothy M. Shead (tshead@k-3d.com)
+*/
+
+#include <k3dsdk/mesh.h>
+#include <k3dsdk/path.h>
+
+#include <boost/shared_ptr.hpp>
+
+namespace module
+{
+
+namespace freetype2
+{
+
+/// Stores the polygons converted from a glyph outline, in unscaled font units
+class glyph
+{
+public:
+	glyph();
+
+	/// Stores the points of every loop, in order
+	k3d::mesh::points_t points;
+	/// Stores the number of loops in each face (the first loop of a face is its outer boundary, the rest are holes)
+	k3d::mesh::counts_t face_loop_counts;
+	/// Stores the number of points in each loop
+	k3d::mesh::counts_t loop_point_counts;
+	/// Stores the horizontal distance from this glyph to the next
+	k3d::double_t advance;
+};
+
+/// Converts glyph outlines for one font and curve-division setting on demand, and keeps the results so that
+/// repeated characters and other nodes using the same settings never convert the same glyph twice
+class glyph_cache
+{
+public:
+	/// Returns the shared cache for a font and curve-division setting, or an empty pointer if the font can't be used
+	static boost::shared_ptr<glyph_cache> get(const k3d::filesystem::path& Font, const k3d::uint_t CurveDivisions);
+
+	~glyph_cache();
+
+	/// Returns the font path
+	const k3d::filesystem::path& font() const;
+	/// Returns the scale factor that maps the font's glyph bounding-box to unit height
+	k3d::double_t normalize_height() const;
+	/// Returns the glyph for a character code, or NULL if it can't be loaded
+	const glyph* lookup(const k3d::uint_t Character);
+
+	class implementation;
+
+private:
+	glyph_cache(implementation* const Implementation);
+	glyph_cache(const glyph_cache&);
+	glyph_cache& operator=(const glyph_cache&);
+
+	implementation* const m_implementation;
+};
+
+} // namespace freetype2
+
+} // namespace module
+
+#endif // !MODULES_FREETYPE2_GLYPH_CACHE_H
+
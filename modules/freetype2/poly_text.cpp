@@ -22,10 +22,10 @@
 */
 
 #include "freetype.h"
+#include "glyph_cache.h"
 
 #include <k3d-i18n-config.h>
 #include <k3dsdk/axis.h>
-#include <k3dsdk/bezier.h>
 #include <k3dsdk/document_plugin_factory.h>
 #include <k3dsdk/imaterial.h>
 #include <k3dsdk/material_sink.h>
@@ -39,7 +39,9 @@
 
 #include <boost/scoped_ptr.hpp>
 
+#include <algorithm>
 #include <iterator>
+#include <vector>
 
 namespace module
 {
@@ -50,209 +52,104 @@ namespace freetype2
 namespace detail
 {
 
-/// Defines a closed contour
-typedef k3d::mesh::points_t contour_t;
-/// Defines a collection of closed contours
-typedef std::vector<contour_t> contours_t;
-
 const k3d::filesystem::path default_font()
 {
 	return k3d::share_path() / k3d::filesystem::generic_path("fonts/VeraBd.ttf");
 }
 
-/// Returns the signed 2D area of a contour
-const k3d::double_t area(const contour_t& Contour)
-{
-	k3d::double_t result = 0;
-
-	for(k3d::uint_t i = 0; i != Contour.size(); ++i)
-		result += (Contour[i][0] * Contour[(i+1)%Contour.size()][1]) - (Contour[(i+1)%Contour.size()][0] * Contour[i][1]);
-
-	return result * 0.5;
-}
-
-/// Returns true iff a contour is clockwise
-const bool clockwise(const contour_t& Contour)
+/// Returns the rotation applied to each character, and the direction in which characters advance, for a given orientation
+void character_orientation(const k3d::signed_axis Orientation, k3d::matrix4& CharOrientation, k3d::vector3& OffsetDirection)
 {
-	return area(Contour) < 0;
+	switch(Orientation)
+	{
+		case k3d::PX:
+			CharOrientation = k3d::rotate3(k3d::angle_axis(k3d::radians(-90), k3d::vector3(0, 0, 1))) *
+				k3d::rotate3(k3d::angle_axis(k3d::radians(90), k3d::vector3(1, 0, 0)));
+			OffsetDirection = k3d::vector3(0, -1, 0);
+			break;
+		case k3d::NX:
+			CharOrientation = k3d::rotate3(k3d::angle_axis(k3d::radians(90), k3d::vector3(0, 0, 1))) *
+				k3d::rotate3(k3d::angle_axis(k3d::radians(90), k3d::vector3(1, 0, 0)));
+			OffsetDirection = k3d::vector3(0, 1, 0);
+			break;
+		case k3d::PY:
+			CharOrientation = k3d::rotate3(k3d::angle_axis(k3d::radians(90), k3d::vector3(1, 0, 0)));
+			OffsetDirection = k3d::vector3(1, 0, 0);
+			break;
+		case k3d::NY:
+			CharOrientation = k3d::rotate3(k3d::angle_axis(k3d::radians(180), k3d::vector3(0, 0, 1))) *
+				k3d::rotate3(k3d::angle_axis(k3d::radians(90), k3d::vector3(1, 0, 0)));
+			OffsetDirection = k3d::vector3(-1, 0, 0);
+			break;
+		case k3d::PZ:
+			CharOrientation = k3d::rotate3(k3d::angle_axis(k3d::radians(180), k3d::vector3(1, 0, 0)));
+			OffsetDirection = k3d::vector3(1, 0, 0);
+			break;
+		case k3d::NZ:
+			CharOrientation = k3d::identity3();
+			OffsetDirection = k3d::vector3(1, 0, 0);
+			break;
+	}
 }
 
-/// Adds a freetype glyph outline to a k3d::polyhedron::primitive
-class freetype_outline
+/// Records the glyph and advance of one character, and where its geometry starts in the output mesh
+struct character
 {
-public:
-	freetype_outline(const k3d::uint_t CurveDivisions) :
-		curve_divisions(CurveDivisions)
+	character(const glyph* const Glyph, const k3d::double_t Offset, const k3d::uint_t FirstPoint, const k3d::uint_t FirstFace, const k3d::uint_t FirstLoop, const k3d::uint_t FirstEdge) :
+		glyph(Glyph),
+		offset(Offset),
+		first_point(FirstPoint),
+		first_face(FirstFace),
+		first_loop(FirstLoop),
+		first_edge(FirstEdge)
 	{
-		ft_outline_funcs.move_to = raw_move_to_func;
-		ft_outline_funcs.line_to = raw_line_to_func;
-		ft_outline_funcs.conic_to = raw_conic_to_func;
-		ft_outline_funcs.cubic_to = raw_cubic_to_func;
-		ft_outline_funcs.shift = 0;
-		ft_outline_funcs.delta = 0;
 	}
 
-	void convert(FT_Outline& Outline, k3d::mesh& Mesh, k3d::polyhedron::primitive& Polyhedron, k3d::imaterial* const Material, const k3d::matrix4& Matrix)
-	{
-		contours.clear();
-
-		// Generate a set of closed contours ...
-		FT_Outline_Decompose(&Outline, &ft_outline_funcs, this);
-
-		// Segregate contours into faces and holes, based on their orientation (clockwise or counter-clockwise, respectively)
-		contours_t face_contours;
-		contours_t hole_contours;
-		for(contours_t::iterator contour = contours.begin(); contour != contours.end(); ++contour)
-		{
-			if(clockwise(*contour))
-				face_contours.push_back(*contour);
-			else
-				hole_contours.push_back(*contour);
-		}
-
-		for(k3d::uint_t i = 0; i != face_contours.size(); ++i)
-			for(k3d::uint_t j = 0; j != face_contours[i].size(); ++j)
-				face_contours[i][j] = Matrix * face_contours[i][j];
-
-		for(k3d::uint_t i = 0; i != hole_contours.size(); ++i)
-			for(k3d::uint_t j = 0; j != hole_contours[i].size(); ++j)
-				hole_contours[i][j] = Matrix * hole_contours[i][j];
-
-		// Create faces.  This is a bit of hack, because we assume that all hole contours belong to the first
-		// face contour ...
-		if(face_contours.size())
-			k3d::polyhedron::add_face(Mesh, Polyhedron, 0, face_contours[0], hole_contours, Material);
-
-		for(k3d::uint_t i = 1; i < face_contours.size(); ++i)
-			k3d::polyhedron::add_face(Mesh, Polyhedron, 0, face_contours[i], Material);
-	}
+	/// The cached glyph, or NULL if the glyph couldn't be loaded
+	const freetype2::glyph* glyph;
+	/// Distance from the start of the text, in font units
+	k3d::double_t offset;
+	k3d::uint_t first_point;
+	k3d::uint_t first_face;
+	k3d::uint_t first_loop;
+	k3d::uint_t first_edge;
+};
 
-private:
-	void begin_contour(const k3d::point3& From)
-	{
-		contours.push_back(contour_t());
-		last_point = From;
-	}
+typedef std::vector<character> characters_t;
 
-	void line_to(const k3d::point3& To)
-	{
-		contours.back().push_back(To);
-		last_point = To;
-	}
-
-	void conic_to(const k3d::point3& From, const k3d::point3& Control, const k3d::point3& To)
+/// Appends the polygons of a cached glyph to a polyhedron, in the same order as k3d::polyhedron::add_face()
+void add_glyph(const glyph& Glyph, const k3d::matrix4& Matrix, k3d::imaterial* const Material, k3d::mesh::points_t& Points, k3d::mesh::selection_t& PointSelection, k3d::polyhedron::primitive& Polyhedron)
+{
+	k3d::uint_t loop = 0;
+	k3d::uint_t point = 0;
+	for(k3d::uint_t face = 0; face != Glyph.face_loop_counts.size(); ++face)
 	{
-		std::vector<k3d::point3> control_points;
-		control_points.push_back(From);
-		control_points.push_back(Control);
-		control_points.push_back(To);
-
-		for(k3d::uint_t i = 0; i != curve_divisions; ++i)
+		Polyhedron.face_shells.push_back(0);
+		Polyhedron.face_first_loops.push_back(Polyhedron.loop_first_edges.size());
+		Polyhedron.face_loop_counts.push_back(Glyph.face_loop_counts[face]);
+		Polyhedron.face_selections.push_back(0);
+		Polyhedron.face_materials.push_back(Material);
+
+		const k3d::uint_t loop_end = loop + Glyph.face_loop_counts[face];
+		for(; loop != loop_end; ++loop)
 		{
-			contours.back().push_back(k3d::Bezier<k3d::point3>(control_points, static_cast<k3d::double_t>(i+1) / static_cast<k3d::double_t>(curve_divisions)));
-		}
-
-		last_point = To;
-	}
+			Polyhedron.loop_first_edges.push_back(Polyhedron.clockwise_edges.size());
 
-	void cubic_to(const k3d::point3& From, const k3d::point3& Control1, const k3d::point3& Control2, const k3d::point3& To)
-	{
-		std::vector<k3d::point3> control_points;
-		control_points.push_back(From);
-		control_points.push_back(Control1);
-		control_points.push_back(Control2);
-		control_points.push_back(To);
+			const k3d::uint_t point_end = point + Glyph.loop_point_counts[loop];
+			for(; point != point_end; ++point)
+			{
+				Polyhedron.vertex_points.push_back(Points.size());
+				Polyhedron.vertex_selections.push_back(0);
+				Polyhedron.clockwise_edges.push_back(Polyhedron.clockwise_edges.size() + 1);
+				Polyhedron.edge_selections.push_back(0);
 
-		for(k3d::uint_t i = 0; i != curve_divisions; ++i)
-		{
-			contours.back().push_back(k3d::Bezier<k3d::point3>(control_points, static_cast<k3d::double_t>(i+1) / static_cast<k3d::double_t>(curve_divisions)));
+				Points.push_back(Matrix * Glyph.points[point]);
+				PointSelection.push_back(0);
+			}
+			Polyhedron.clockwise_edges.back() = Polyhedron.loop_first_edges.back();
 		}
-
-		last_point = To;
-	}
-
-	const k3d::point3 convert(const FT_Vector* RHS)
-	{
-		return k3d::point3(RHS->x, RHS->y, 0);
-	}
-
-	int move_to_func(const FT_Vector* To)
-	{
-		begin_contour(convert(To));
-		return 0;
-	}
-
-	int line_to_func(const FT_Vector* To)
-	{
-		line_to(convert(To));
-		return 0;
-	}
-
-	int conic_to_func(const FT_Vector* Control, const FT_Vector* To)
-	{
-		conic_to(last_point, convert(Control), convert(To));
-		return 0;
-	}
-
-	int cubic_to_func(const FT_Vector* Control1, const FT_Vector* Control2, const FT_Vector* To)
-	{
-		cubic_to(last_point, convert(Control1), convert(Control2), convert(To));
-		return 0;
-	}
-
-#if (((FREETYPE_MAJOR) > 2) || ((FREETYPE_MAJOR) == 2 && (FREETYPE_MINOR) >= 2))
-
-	static int raw_move_to_func(const FT_Vector* to, void* user)
-	{
-		return reinterpret_cast<freetype_outline*>(user)->move_to_func(to);
-	}
-
-	static int raw_line_to_func(const FT_Vector* to, void* user)
-	{
-		return reinterpret_cast<freetype_outline*>(user)->line_to_func(to);
-	}
-
-	static int raw_conic_to_func(const FT_Vector* control, const FT_Vector* to, void* user)
-	{
-		return reinterpret_cast<freetype_outline*>(user)->conic_to_func(control, to);
-	}
-
-	static int raw_cubic_to_func(const FT_Vector* control1, const FT_Vector* control2, const FT_Vector* to, void* user)
-	{
-		return reinterpret_cast<freetype_outline*>(user)->cubic_to_func(control1, control2, to);
-	}
-
-#else
-
-	static int raw_move_to_func(FT_Vector* to, void* user)
-	{
-		return reinterpret_cast<freetype_outline*>(user)->move_to_func(to);
-	}
-
-	static int raw_line_to_func(FT_Vector* to, void* user)
-	{
-		return reinterpret_cast<freetype_outline*>(user)->line_to_func(to);
-	}
-
-	static int raw_conic_to_func(FT_Vector* control, FT_Vector* to, void* user)
-	{
-		return reinterpret_cast<freetype_outline*>(user)->conic_to_func(control, to);
 	}
-
-	static int raw_cubic_to_func(FT_Vector* control1, FT_Vector* control2, FT_Vector* to, void* user)
-	{
-		return reinterpret_cast<freetype_outline*>(user)->cubic_to_func(control1, control2, to);
-	}
-
-#endif
-
-	const k3d::uint_t curve_divisions;
-
-	FT_Outline_Funcs ft_outline_funcs;
-
-	k3d::point3 last_point;
-	contours_t contours;
-};
+}
 
 } // namespace detail
 
@@ -271,7 +168,10 @@ public:
 		m_text(init_owner(*this) + init_name("text") + init_label(_("Text")) + init_description(_("Text")) + init_value<std::string>("Text!")),
 		m_curve_divisions(init_owner(*this) + init_name("curve_divisions") + init_label(_("Curve subdivisions")) + init_description(_("Bezier curves subdivision number")) + init_value(3) + init_constraint(constraint::minimum<k3d::int32_t>(1)) + init_step_increment(1) + init_units(typeid(k3d::measurement::scalar))),
 		m_height(init_owner(*this) + init_name("height") + init_label(_("Height")) + init_description(_("Font height")) + init_value(10.0) + init_step_increment(0.01) + init_units(typeid(k3d::measurement::distance))),
-		m_orientation(init_owner(*this) + init_name("orientation") + init_label(_("Orientation")) + init_description(_("Orientation type (forward or backward along X, Y or Z axis)")) + init_value(k3d::PY) + init_enumeration(k3d::signed_axis_values()))
+		m_orientation(init_owner(*this) + init_name("orientation") + init_label(_("Orientation")) + init_description(_("Orientation type (forward or backward along X, Y or Z axis)")) + init_value(k3d::PY) + init_enumeration(k3d::signed_axis_values())),
+		m_layout_material(0),
+		m_layout_height(0),
+		m_layout_orientation(k3d::PY)
 	{
 		m_material.changed_signal().connect(k3d::hint::converter<
 			k3d::hint::convert<k3d::hint::any, k3d::hint::none> >(make_update_mesh_slot()));
@@ -282,105 +182,149 @@ public:
 		m_curve_divisions.changed_signal().connect(k3d::hint::converter<
 			k3d::hint::convert<k3d::hint::any, k3d::hint::none> >(make_update_mesh_slot()));
 		m_height.changed_signal().connect(k3d::hint::converter<
-			k3d::hint::convert<k3d::hint::any, k3d::hint::none> >(make_update_mesh_slot()));
+			k3d::hint::convert<k3d::hint::any, k3d::hint::mesh_geometry_changed> >(make_update_mesh_slot()));
 		m_orientation.changed_signal().connect(k3d::hint::converter<
-			k3d::hint::convert<k3d::hint::any, k3d::hint::none> >(make_update_mesh_slot()));
+			k3d::hint::convert<k3d::hint::any, k3d::hint::mesh_geometry_changed> >(make_update_mesh_slot()));
 	}
 
 	void on_update_mesh_topology(k3d::mesh& Output)
 	{
-		Output = k3d::mesh();
-
 		k3d::imaterial* const material = m_material.pipeline_value();
 		const k3d::filesystem::path font_path = m_font_path.pipeline_value();
 		const k3d::string_t text = m_text.pipeline_value();
 		const k3d::int32_t curve_divisions = m_curve_divisions.pipeline_value();
-		const k3d::double_t height = m_height.pipeline_value();
 
-		k3d::matrix4 char_orientation;
-		k3d::vector3 offset_direction;
-		switch(m_orientation.pipeline_value())
+		const boost::shared_ptr<glyph_cache> glyphs = glyph_cache::get(font_path, curve_divisions);
+		if(!glyphs)
 		{
-			case k3d::PX:
-				char_orientation = k3d::rotate3(k3d::angle_axis(k3d::radians(-90), k3d::vector3(0, 0, 1))) *
-					k3d::rotate3(k3d::angle_axis(k3d::radians(90), k3d::vector3(1, 0, 0)));
-				offset_direction = k3d::vector3(0, -1, 0);
-				break;
-			case k3d::NX:
-				char_orientation = k3d::rotate3(k3d::angle_axis(k3d::radians(90), k3d::vector3(0, 0, 1))) *
-					k3d::rotate3(k3d::angle_axis(k3d::radians(90), k3d::vector3(1, 0, 0)));
-				offset_direction = k3d::vector3(0, 1, 0);
-				break;
-			case k3d::PY:
-				char_orientation = k3d::rotate3(k3d::angle_axis(k3d::radians(90), k3d::vector3(1, 0, 0)));
-				offset_direction = k3d::vector3(1, 0, 0);
-				break;
-			case k3d::NY:
-				char_orientation = k3d::rotate3(k3d::angle_axis(k3d::radians(180), k3d::vector3(0, 0, 1))) *
-					k3d::rotate3(k3d::angle_axis(k3d::radians(90), k3d::vector3(1, 0, 0)));
-				offset_direction = k3d::vector3(-1, 0, 0);
-				break;
-			case k3d::PZ:
-				char_orientation = k3d::rotate3(k3d::angle_axis(k3d::radians(180), k3d::vector3(1, 0, 0)));
-				offset_direction = k3d::vector3(1, 0, 0);
-				break;
-			case k3d::NZ:
-				char_orientation = k3d::identity3();
-				offset_direction = k3d::vector3(1, 0, 0);
-				break;
-		}
-
-		library ft_library;
-		if(!ft_library)
-		{
-			k3d::log() << error << "Error initializing FreeType library" << std::endl;
+			Output = k3d::mesh();
+			m_glyphs.reset();
+			m_layout_text.clear();
+			m_layout_characters.clear();
 			return;
 		}
 
-		face ft_face(ft_library, font_path);
-		if(!ft_face)
+		// If only the text changed, keep the characters in front of the first change ...
+		boost::scoped_ptr<k3d::polyhedron::primitive> polyhedron;
+		if(glyphs == m_glyphs && material == m_layout_material && Output.points && Output.point_selection && Output.primitives.size() == 1)
+			polyhedron.reset(k3d::polyhedron::validate(Output, Output.primitives.front()));
+
+		k3d::uint_t unchanged = 0;
+		if(polyhedron)
 		{
-			k3d::log() << error << "Error opening font file: " << font_path.native_console_string() << std::endl;
-			return;
+			const k3d::uint_t common = std::min(text.size(), m_layout_text.size());
+			while(unchanged != common && text[unchanged] == m_layout_text[unchanged])
+				++unchanged;
 		}
-
-		if(!ft_face.is_scalable())
+		else
 		{
-			k3d::log() << error << "Not a scalable font: " << font_path.native_console_string() << std::endl;
-			return;
+			Output = k3d::mesh();
+			Output.points.create();
+			Output.point_selection.create();
+
+			polyhedron.reset(k3d::polyhedron::create(Output));
+			polyhedron->shell_types.push_back(k3d::polyhedron::POLYGONS);
+
+			m_glyphs = glyphs;
+			m_layout_material = material;
+			m_layout_height = m_height.pipeline_value();
+			m_layout_orientation = m_orientation.pipeline_value();
+			m_layout_characters.clear();
 		}
 
-		const k3d::double_t normalize_height = 1.0 / static_cast<k3d::double_t>(ft_face->bbox.yMax - ft_face->bbox.yMin);
-		const k3d::double_t scale = normalize_height * height;
-
-		detail::freetype_outline outline(curve_divisions);
+		k3d::mesh::points_t& points = Output.points.writable();
+		k3d::mesh::selection_t& point_selection = Output.point_selection.writable();
 
-		Output.points.create();
-		Output.point_selection.create();
+		// Remove the geometry of every character that changed ...
+		if(unchanged < m_layout_characters.size())
+		{
+			const detail::character& first = m_layout_characters[unchanged];
+
+			points.resize(first.first_point);
+			point_selection.resize(first.first_point);
+
+			polyhedron->face_shells.resize(first.first_face);
+			polyhedron->face_first_loops.resize(first.first_face);
+			polyhedron->face_loop_counts.resize(first.first_face);
+			polyhedron->face_selections.resize(first.first_face);
+			polyhedron->face_materials.resize(first.first_face);
+			polyhedron->loop_first_edges.resize(first.first_loop);
+			polyhedron->clockwise_edges.resize(first.first_edge);
+			polyhedron->edge_selections.resize(first.first_edge);
+			polyhedron->vertex_points.resize(first.first_edge);
+			polyhedron->vertex_selections.resize(first.first_edge);
+
+			m_layout_characters.erase(m_layout_characters.begin() + unchanged, m_layout_characters.end());
+		}
 
-		boost::scoped_ptr<k3d::polyhedron::primitive> polyhedron(k3d::polyhedron::create(Output));
-		polyhedron->shell_types.push_back(k3d::polyhedron::POLYGONS);
+		// Append the rest, using the same placement as the characters we kept.  If the height or orientation
+		// changed too, on_update_mesh_geometry() places everything again ...
+		k3d::matrix4 char_orientation;
+		k3d::vector3 offset_direction;
+		detail::character_orientation(m_layout_orientation, char_orientation, offset_direction);
+		const k3d::double_t scale = glyphs->normalize_height() * m_layout_height;
 
 		k3d::double_t offset = 0;
-		for(k3d::string_t::const_iterator c = text.begin(); c != text.end(); ++c)
+		if(m_layout_characters.size() && m_layout_characters.back().glyph)
+			offset = m_layout_characters.back().offset + m_layout_characters.back().glyph->advance;
+		else if(m_layout_characters.size())
+			offset = m_layout_characters.back().offset;
+
+		for(k3d::uint_t i = unchanged; i != text.size(); ++i)
 		{
-			if(0 != FT_Load_Glyph(ft_face, FT_Get_Char_Index(ft_face, static_cast<FT_ULong>(*c)), FT_LOAD_NO_SCALE | FT_LOAD_IGNORE_TRANSFORM))
-			{
-				k3d::log() << error << "Error loading glyph for " << font_path.native_console_string() << "[" << *c << "]" << std::endl;
+			const glyph* const character_glyph = glyphs->lookup(static_cast<k3d::uint_t>(text[i]));
+
+			m_layout_characters.push_back(detail::character(character_glyph, offset, points.size(), polyhedron->face_shells.size(), polyhedron->loop_first_edges.size(), polyhedron->clockwise_edges.size()));
+			if(!character_glyph)
 				continue;
-			}
 
 			const k3d::matrix4 matrix =
 				k3d::translate3(offset_direction * (offset * scale)) * char_orientation * k3d::scale3(scale);
 
-			outline.convert(ft_face->glyph->outline, Output, *polyhedron, material, matrix);
+			detail::add_glyph(*character_glyph, matrix, material, points, point_selection, *polyhedron);
 
-			offset += ft_face->glyph->metrics.horiAdvance;
+			offset += character_glyph->advance;
 		}
+
+		m_layout_text = text;
 	}
 
 	void on_update_mesh_geometry(k3d::mesh& Output)
 	{
+		const k3d::double_t height = m_height.pipeline_value();
+		const k3d::signed_axis orientation = m_orientation.pipeline_value();
+
+		if(!m_glyphs || !Output.points)
+			return;
+
+		if(height == m_layout_height && orientation == m_layout_orientation)
+			return;
+
+		k3d::matrix4 char_orientation;
+		k3d::vector3 offset_direction;
+		detail::character_orientation(orientation, char_orientation, offset_direction);
+		const k3d::double_t scale = m_glyphs->normalize_height() * height;
+
+		k3d::mesh::points_t& points = Output.points.writable();
+
+		const k3d::uint_t character_begin = 0;
+		const k3d::uint_t character_end = character_begin + m_layout_characters.size();
+		for(k3d::uint_t character = character_begin; character != character_end; ++character)
+		{
+			const detail::character& layout = m_layout_characters[character];
+			if(!layout.glyph)
+				continue;
+
+			const k3d::matrix4 matrix =
+				k3d::translate3(offset_direction * (layout.offset * scale)) * char_orientation * k3d::scale3(scale);
+
+			const k3d::mesh::points_t& glyph_points = layout.glyph->points;
+			for(k3d::uint_t point = 0; point != glyph_points.size(); ++point)
+				points[layout.first_point + point] = matrix * glyph_points[point];
+		}
+
+		m_layout_height = height;
+		m_layout_orientation = orientation;
 	}
 
 	static k3d::iplugin_factory& get_factory()
@@ -401,6 +345,15 @@ private:
 	k3d_data(k3d::int32_t, immutable_name, change_signal, with_undo, local_storage, with_constraint, measurement_property, with_serialization) m_curve_divisions;
 	k3d_data(k3d::double_t, immutable_name, change_signal, with_undo, local_storage, no_constraint, measurement_property, with_serialization) m_height;
 	k3d_data(k3d::signed_axis, immutable_name, change_signal, with_undo, local_storage, no_constraint, enumeration_property, with_serialization) m_orientation;
+
+	/// Shared cache of converted glyphs for the current font and curve divisions
+	boost::shared_ptr<glyph_cache> m_glyphs;
+	/// Stores the text, material, and placement used to generate the current output, so that edits can update it in-place
+	k3d::string_t m_layout_text;
+	detail::characters_t m_layout_characters;
+	k3d::imaterial* m_layout_material;
+	k3d::double_t m_layout_height;
+	k3d::signed_axis m_layout_orientation;
 };
 
 } // namespace freetype2
@@ -23,6 +23,7 @@
 */
 
 #include <k3d-i18n-config.h>
+#include <k3d-version-config.h>
 #include <k3dsdk/algebra.h>
 #include <k3dsdk/application_plugin_factory.h>
 #include <k3dsdk/classes.h>
@@ -52,6 +53,160 @@ namespace module
 namespace k3d_io
 {
 
+namespace detail
+{
+
+/// Creates (but doesn't load) the node described by a <node> element, returning NULL if it can't or shouldn't be loaded
+k3d::inode* create_node(const k3d::xml::element& XMLNode, k3d::idocument& Document, k3d::persistent_lookup& Lookup)
+{
+	if(k3d::xml::attribute_value<k3d::bool_t>(XMLNode, "do_not_load", false))
+		return 0;
+
+	const std::string name = k3d::xml::attribute_text(XMLNode, "name");
+	const k3d::uuid factory_id = k3d::xml::attribute_value<k3d::uuid>(XMLNode, "factory", k3d::uuid::null());
+	if(factory_id == k3d::uuid::null())
+	{
+		k3d::log() << error << "node [" << name << "] with unspecified factory ID will not be loaded" << std::endl;
+		return 0;
+	}
+
+	const k3d::ipersistent_lookup::id_type node_id = k3d::xml::attribute_value<k3d::ipersistent_lookup::id_type>(XMLNode, "id", 0);
+	if(node_id == 0)
+	{
+		k3d::log() << error << "node [" << name << "] with unspecified ID will not be loaded" << std::endl;
+		return 0;
+	}
+
+	k3d::iplugin_factory* const plugin_factory = k3d::plugin::factory::lookup(factory_id);
+	if(!plugin_factory)
+	{
+		k3d::log() << error << "node [" << name << "] with unknown factory ID [" << factory_id << "] will not be loaded" << std::endl;
+		return 0;
+	}
+
+	k3d::idocument_plugin_factory* const document_plugin_factory = dynamic_cast<k3d::idocument_plugin_factory*>(plugin_factory);
+	if(!document_plugin_factory)
+	{
+		k3d::log() << error << "Non-document plugin [" << name << "] will not be loaded" << std::endl;
+		return 0;
+	}
+
+	k3d::inode* const node = document_plugin_factory->create_plugin(*plugin_factory, Document);
+	if(!node)
+	{
+		k3d::log() << error << "Error creating node [" << name << "] instance" << std::endl;
+		return 0;
+	}
+
+	if(!dynamic_cast<k3d::ipersistent*>(node))
+	{
+		k3d::log() << error << "node [" << name << "] does not support persistence" << std::endl;
+
+		delete node;
+		return 0;
+	}
+
+	k3d::undoable_new(node, Document);
+	Lookup.insert_lookup(node_id, node);
+
+	return node;
+}
+
+/// The depth of <node> elements within a document:  <k3dml><document><nodes><node>
+const unsigned long node_depth = 3;
+
+/////////////////////////////////////////////////////////////////////////////
+// create_nodes
+
+/// Handles the first pass over a streamed document, creating every node from the attributes of its <node> element.  Node
+/// contents, and everything else at the same level as the node list, are skipped.
+class create_nodes :
+	public k3d::xml::element_handler
+{
+public:
+	create_nodes(k3d::idocument& Document, k3d::persistent_lookup& Lookup) :
+		m_document(Document),
+		m_lookup(Lookup)
+	{
+	}
+
+	bool start_element(k3d::xml::element& Element, const unsigned long Depth)
+	{
+		if(Depth == node_depth - 1)
+			return Element.name == "nodes";
+
+		if(Depth == node_depth)
+		{
+			if(Element.name == "node")
+			{
+				k3d::inode* const node = create_node(Element, m_document, m_lookup);
+				node_order.push_back(node);
+				if(node)
+					nodes.push_back(node);
+			}
+
+			return false;
+		}
+
+		return true;
+	}
+
+	bool end_element(k3d::xml::element& Element, const unsigned long Depth)
+	{
+		return Depth >= node_depth - 1;
+	}
+
+	/// Stores the nodes that were created
+	k3d::inode_collection::nodes_t nodes;
+	/// Stores one entry for every <node> element, in document order: the node created for it, or NULL
+	std::vector<k3d::inode*> node_order;
+
+private:
+	k3d::idocument& m_document;
+	k3d::persistent_lookup& m_lookup;
+};
+
+/////////////////////////////////////////////////////////////////////////////
+// load_nodes
+
+/// Handles the second pass over a streamed document, loading each node as soon as its <node> element has been parsed, then
+/// discarding the XML.  Everything else (i.e. the pipeline dependencies) is kept.
+class load_nodes :
+	public k3d::xml::element_handler
+{
+public:
+	load_nodes(const std::vector<k3d::inode*>& NodeOrder, const k3d::ipersistent::load_context& Context) :
+		m_node_order(NodeOrder),
+		m_context(Context),
+		m_current(0)
+	{
+	}
+
+	bool start_element(k3d::xml::element& Element, const unsigned long Depth)
+	{
+		return true;
+	}
+
+	bool end_element(k3d::xml::element& Element, const unsigned long Depth)
+	{
+		if(Depth != node_depth || Element.name != "node")
+			return false;
+
+		if(m_current < m_node_order.size() && m_node_order[m_current])
+			k3d::xml::load(*m_node_order[m_current], Element, m_context);
+		++m_current;
+
+		return true;
+	}
+
+private:
+	const std::vector<k3d::inode*>& m_node_order;
+	const k3d::ipersistent::load_context& m_context;
+	k3d::uint_t m_current;
+};
+
+} // namespace detail
+
 /////////////////////////////////////////////////////////////////////////////
 // document_importer
 	
@@ -70,10 +225,11 @@ public:
 
 		try
 		{
+			// We only need the root element, so don't parse the rest of the document ...
 			k3d::xml::element xml("k3dml");
 			k3d::filesystem::igzstream stream(File);
 			k3d::xml::hide_progress progress;
-			k3d::xml::parse(xml, stream, File.native_utf8_string().raw(), progress);
+			k3d::xml::parse_root(xml, stream, File.native_utf8_string().raw(), progress);
 
 			metadata.insert(std::make_pair(k3d::metadata::key::version(), k3d::xml::attribute_text(xml, "version")));
 		}
@@ -91,6 +247,66 @@ public:
 
 //		sigc::connection connection = Document.pipeline_profiler().connect_node_execution_signal(sigc::ptr_fun(&node_execution));
 
+		// Documents written by this version of K-3D don't need upgrading, so they can be streamed ...
+		const k3d::imetadata::metadata_t metadata = get_file_metadata(File);
+		const k3d::imetadata::metadata_t::const_iterator version = metadata.find(k3d::metadata::key::version());
+		const k3d::bool_t result = (version != metadata.end() && version->second == K3D_VERSION) ? stream_file(File, Document) : parse_file(File, Document);
+
+//		connection.disconnect();
+
+		return result;
+	}
+
+	/// Loads a document written by this version of K-3D without reading it into memory.  The file is read twice: the first pass
+	/// creates every node (so references between nodes can be resolved regardless of their order), and the second loads each node
+	/// as soon as its XML has been parsed, so peak memory use is bounded by the largest node rather than the whole document.
+	k3d::bool_t stream_file(const k3d::filesystem::path& File, k3d::idocument& Document)
+	{
+		const k3d::filesystem::path root_path = File.branch_path();
+		k3d::persistent_lookup persistent_lookup;
+		k3d::ipersistent::load_context context(root_path, persistent_lookup);
+
+		k3d::xml::hide_progress progress;
+
+		detail::create_nodes create_nodes(Document, persistent_lookup);
+		try
+		{
+			k3d::xml::element xml("k3dml");
+			k3d::filesystem::igzstream stream(File);
+			k3d::xml::parse(xml, stream, File.native_utf8_string().raw(), progress, create_nodes);
+			return_val_if_fail(xml.name == "k3dml", false);
+		}
+		catch(std::exception& e)
+		{
+			k3d::log() << error << e.what() << std::endl;
+			return false;
+		}
+
+		Document.nodes().add_nodes(create_nodes.nodes);
+
+		k3d::xml::element xml("k3dml");
+		try
+		{
+			detail::load_nodes load_nodes(create_nodes.node_order, context);
+			k3d::filesystem::igzstream stream(File);
+			k3d::xml::parse(xml, stream, File.native_utf8_string().raw(), progress, load_nodes);
+		}
+		catch(std::exception& e)
+		{
+			k3d::log() << error << e.what() << std::endl;
+			return false;
+		}
+
+		// Load the DAG ...
+		if(k3d::xml::element* xml_document = k3d::xml::find_element(xml, "document"))
+			k3d::xml::load_pipeline(Document, *xml_document, context);
+
+		return true;
+	}
+
+	/// Loads a document by reading it into memory, so documents from older versions of K-3D can be upgraded before they are loaded
+	k3d::bool_t parse_file(const k3d::filesystem::path& File, k3d::idocument& Document)
+	{
 		k3d::xml::element xml("k3dml");
 		try
 		{
@@ -121,7 +337,6 @@ public:
 			if(k3d::xml::element* xml_nodes = k3d::xml::find_element(*xml_document, "nodes"))
 			{
 				k3d::inode_collection::nodes_t nodes;
-				std::vector<k3d::inode*> persistent_nodes;
 				std::vector<k3d::xml::element*> node_storage;
 
 				for(k3d::xml::element::elements_t::iterator xml_node = xml_nodes->children.begin(); xml_node != xml_nodes->children.end(); ++xml_node)
@@ -129,75 +344,28 @@ public:
 					if(xml_node->name != "node")
 						continue;
 
-					if(k3d::xml::attribute_value<k3d::bool_t>(*xml_node, "do_not_load", false))
-						continue;
-
-					const std::string name = k3d::xml::attribute_text(*xml_node, "name");
-					const k3d::uuid factory_id = k3d::xml::attribute_value<k3d::uuid>(*xml_node, "factory", k3d::uuid::null());
-					if(factory_id == k3d::uuid::null())
-					{
-						k3d::log() << error << "node [" << name << "] with unspecified factory ID will not be loaded" << std::endl;
-						continue;
-					}
-
-					const k3d::ipersistent_lookup::id_type node_id = k3d::xml::attribute_value<k3d::ipersistent_lookup::id_type>(*xml_node, "id", 0);
-					if(node_id == 0)
-					{
-						k3d::log() << error << "node [" << name << "] with unspecified ID will not be loaded" << std::endl;
-						continue;
-					}
-
-					k3d::iplugin_factory* const plugin_factory = k3d::plugin::factory::lookup(factory_id);
-					if(!plugin_factory)
-					{
-						k3d::log() << error << "node [" << name << "] with unknown factory ID [" << factory_id << "] will not be loaded" << std::endl;
-						continue;
-					}
-
-					k3d::idocument_plugin_factory* const document_plugin_factory = dynamic_cast<k3d::idocument_plugin_factory*>(plugin_factory);
-					if(!document_plugin_factory)
-					{
-						k3d::log() << error << "Non-document plugin [" << name << "] will not be loaded" << std::endl;
-						continue;
-					}
-
-					k3d::inode* const node = document_plugin_factory->create_plugin(*plugin_factory, Document);
+					k3d::inode* const node = detail::create_node(*xml_node, Document, persistent_lookup);
 					if(!node)
-					{
-						k3d::log() << error << "Error creating node [" << name << "] instance" << std::endl;
-						continue;
-					}
-
-					k3d::ipersistent* const persistent = dynamic_cast<k3d::ipersistent*>(node);
-					if(!persistent)
-					{
-						k3d::log() << error << "node [" << name << "] does not support persistence" << std::endl;
-
-						delete node;
 						continue;
-					}
-
-					k3d::undoable_new(node, Document);
 
 					nodes.push_back(node);
-					persistent_nodes.push_back(node);
 					node_storage.push_back(&(*xml_node));
-
-					persistent_lookup.insert_lookup(node_id, node);
 				}
 
 				Document.nodes().add_nodes(nodes);
 
-				for(k3d::uint_t i = 0; i != persistent_nodes.size(); ++i)
-					k3d::xml::load(*persistent_nodes[i], *node_storage[i], context);
+				// Release each node's XML once it's loaded, so the document and its nodes don't have to fit in memory at the same time ...
+				for(k3d::uint_t i = 0; i != nodes.size(); ++i)
+				{
+					k3d::xml::load(*nodes[i], *node_storage[i], context);
+					*node_storage[i] = k3d::xml::element();
+				}
 			}
 
 			// Load the DAG ...
 			k3d::xml::load_pipeline(Document, *xml_document, context);
 		}
 
-//		connection.disconnect();
-
 		return true;
 	}
 
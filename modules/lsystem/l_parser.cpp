@@ -25,6 +25,7 @@
 #include <k3d-i18n-config.h>
 #include <k3dsdk/axis.h>
 #include <k3dsdk/color.h>
+#include <k3dsdk/cylinder.h>
 #include <k3dsdk/document_plugin_factory.h>
 #include <k3dsdk/file_helpers.h>
 #include <k3dsdk/fstream.h>
@@ -34,17 +35,24 @@
 #include <k3dsdk/mesh_source.h>
 #include <k3dsdk/module.h>
 #include <k3dsdk/node.h>
+#include <k3dsdk/parallel/blocked_range.h>
+#include <k3dsdk/parallel/parallel_for.h>
+#include <k3dsdk/parallel/threads.h>
 #include <k3dsdk/polyhedron.h>
 #include <k3dsdk/property.h>
 #include <k3dsdk/share.h>
 #include <k3dsdk/string_modifiers.h>
 
+#include <boost/scoped_ptr.hpp>
+
+#include <algorithm>
 #include <cmath>
+#include <deque>
 #include <fstream>
 #include <limits>
-#include <map>
 #include <sstream>
 #include <stack>
+#include <vector>
 
 namespace module
 {
@@ -59,15 +67,390 @@ namespace lparser
 // http://home.wanadoo.nl/laurens.lapre/lparser.htm
 // for more information, read share/doc/lsystem.txt
 
+/// Portable, re-entrant replacement for rand(), so that every evaluation with the same seed produces the same random sequence.
+/// This is the linear congruential generator from the C standard's example rand() implementation, seeded with the
+/// "random_seed" property.  Earlier versions of LSystemParser called srand() / rand() from the C library, so documents that
+/// use '~' rotations or mutations may grow differently than they did before, but now grow the same way on every platform.
+class random_generator
+{
+public:
+	random_generator(const unsigned long Seed) :
+		m_state(static_cast<k3d::uint32_t>(Seed))
+	{
+	}
+
+	/// Returns a random number in the range [0, 1)
+	k3d::double_t operator()()
+	{
+		m_state = m_state * 1103515245 + 12345;
+		return static_cast<k3d::double_t>((m_state / 65536) % 32768) / 32768.0;
+	}
+
+private:
+	k3d::uint32_t m_state;
+};
+
+/// Stores an L-system, loaded from a .ls file
+class grammar
+{
+public:
+	grammar() :
+		lev(0),
+		fraction(0),
+		ang(0),
+		thick(0),
+		splittable(false)
+	{
+	}
+
+	/// Returns the index of the rule that replaces a symbol
+	unsigned long rule(const char Symbol) const
+	{
+		return symbol_rules[static_cast<unsigned char>(Symbol)];
+	}
+
+	/// Returns true iff a rule is wrapped in '@' marks when expanded from the given level, for partial growth
+	bool marked(const unsigned long Rule, const unsigned long Level) const
+	{
+		return Level + 1 == lev && fraction != 0.0 && marks[Rule];
+	}
+
+	/// Returns true iff a symbol expands to itself at every level, so it needn't be expanded
+	bool constant(const char Symbol) const
+	{
+		return identities[static_cast<unsigned char>(Symbol)] && !(fraction != 0.0 && marks[rule(Symbol)]);
+	}
+
+	/// Returns true iff the complete expansion of a symbol contains balanced [] and {} pairs, and no random rotations
+	bool independent(const char Symbol) const
+	{
+		return independents[static_cast<unsigned char>(Symbol)];
+	}
+
+	/// Builds lookup tables from the rules, which must be called after loading and mutating them.  Returns false if the
+	/// recursion level had to be lowered because the production string would have grown to MaximalString symbols or more
+	bool compile(const unsigned long MaximalString)
+	{
+		// Each char gets a rule number, the first matching rule wins, and unknown chars use the last (do-nothing) rule ...
+		symbol_rules.assign(256, rules.size() - 1);
+		for(unsigned long i = rules.size(); i > 0; i--)
+		{
+			if(rules[i - 1].size())
+				symbol_rules[static_cast<unsigned char>(rules[i - 1][0])] = i - 1;
+		}
+
+		const bool complete = limit(MaximalString);
+
+		identities.assign(256, false);
+		for(unsigned long i = 0; i != 256; ++i)
+		{
+			const std::string& rule = rules[symbol_rules[i]];
+			identities[i] = rule.size() == 3 && static_cast<unsigned char>(rule[2]) == i;
+		}
+
+		// Branches can only be generated independently when brackets and braces are always copied unchanged ...
+		splittable = constant('[') && constant(']') && constant('{') && constant('}');
+
+		// Find symbols whose expansions are self-contained, starting from "all of them" and removing symbols until nothing changes ...
+		independents.assign(256, true);
+		independents[static_cast<unsigned char>('~')] = false;
+		for(bool changed = true; changed; )
+		{
+			changed = false;
+			for(unsigned long i = 0; i != 256; ++i)
+			{
+				if(!independents[i] || i == '[' || i == ']' || i == '{' || i == '}')
+					continue;
+
+				const std::string& rule = rules[symbol_rules[i]];
+				if(rule.size() >= 2 && balanced(rule, 2, rule.size()))
+					continue;
+
+				independents[i] = false;
+				changed = true;
+			}
+		}
+
+		return complete;
+	}
+
+	/// Returns true iff a range of symbols contains balanced [] and {} pairs, and only independent symbols
+	bool balanced(const std::string& Text, const unsigned long Begin, const unsigned long End) const
+	{
+		long brackets = 0;
+		long braces = 0;
+		for(unsigned long i = Begin; i != End; ++i)
+		{
+			switch(Text[i])
+			{
+				case '[':
+					++brackets;
+					break;
+				case ']':
+					if(--brackets < 0)
+						return false;
+					break;
+				case '{':
+					++braces;
+					break;
+				case '}':
+					if(--braces < 0)
+						return false;
+					break;
+				default:
+					if(!independent(Text[i]))
+						return false;
+					break;
+			}
+		}
+
+		return brackets == 0 && braces == 0;
+	}
+
+	/// Stops expanding rules at the last level whose production string is shorter than MaximalString symbols, as the
+	/// original lparser did, so mutated or deeply-nested grammars can't run away.  Lengths are counted per symbol and level,
+	/// without generating the string.  Returns false if the recursion level was lowered
+	bool limit(const unsigned long MaximalString)
+	{
+		const unsigned long max = MaximalString > 10 ? MaximalString - 10 : 1;
+
+		// lengths[i] is the length of symbol i after expanding it "level" times ...
+		std::vector<unsigned long> lengths(256, 1);
+		std::vector<unsigned long> next_lengths(256, 0);
+		for(unsigned long level = 0; level < lev; level++)
+		{
+			for(unsigned long i = 0; i != 256; ++i)
+			{
+				const std::string& rule = rules[symbol_rules[i]];
+
+				next_lengths[i] = 0;
+				for(unsigned long j = 2; j < rule.size(); ++j)
+					next_lengths[i] = std::min(max, next_lengths[i] + lengths[static_cast<unsigned char>(rule[j])]);
+			}
+
+			unsigned long length = 0;
+			for(unsigned long i = 0; i != axiom.size(); ++i)
+				length = std::min(max, length + next_lengths[static_cast<unsigned char>(axiom[i])]);
+
+			// Overflow, stop at the previous level without growing it ...
+			if(length >= max)
+			{
+				lev = level;
+				fraction = 0;
+				return false;
+			}
+
+			lengths.swap(next_lengths);
+		}
+
+		return true;
+	}
+
+	/// Axiom
+	std::string axiom;
+	/// Rules
+	std::vector<std::string> rules;
+	/// Marked rules need special processing when growing shapes are active
+	std::vector<bool> marks;
+	/// Recursion level, and the fraction of the last level that is grown
+	unsigned long lev;
+	k3d::double_t fraction;
+	/// Initial values
+	k3d::double_t ang;
+	k3d::double_t thick;
+
+private:
+	std::vector<unsigned long> symbol_rules;
+	std::vector<bool> identities;
+	std::vector<bool> independents;
+	bool splittable;
+
+	friend class production;
+};
+
+/// A range of symbols inside a [] pair that can be drawn independently of the rest of the production string
+struct branch
+{
+	branch() :
+		text(0),
+		begin(0),
+		end(0),
+		level(0)
+	{
+	}
+
+	branch(const std::string* Text, const unsigned long Begin, const unsigned long End, const unsigned long Level) :
+		text(Text),
+		begin(Begin),
+		end(End),
+		level(Level)
+	{
+	}
+
+	const std::string* text;
+	unsigned long begin;
+	unsigned long end;
+	unsigned long level;
+};
+
+/// Generates the production string of a grammar one symbol at a time, expanding rules depth-first so the whole string is never stored
+class production
+{
+public:
+	/// Generates the complete production string
+	production(const grammar& Grammar) :
+		m_grammar(Grammar),
+		m_peeked(false),
+		m_next(0),
+		m_direct(false)
+	{
+		m_frames.push_back(frame(&Grammar.axiom, 0, Grammar.axiom.size(), 0, false));
+	}
+
+	/// Generates the production of a branch
+	production(const grammar& Grammar, const branch& Branch) :
+		m_grammar(Grammar),
+		m_peeked(false),
+		m_next(0),
+		m_direct(false)
+	{
+		m_frames.push_back(frame(Branch.text, Branch.begin, Branch.end, Branch.level, false));
+	}
+
+	/// Returns the next symbol, or 0 at the end of the string
+	char get()
+	{
+		if(m_peeked)
+		{
+			m_peeked = false;
+			return m_next;
+		}
+
+		return generate();
+	}
+
+	/// Returns the next symbol without consuming it
+	char peek()
+	{
+		if(!m_peeked)
+		{
+			m_next = generate();
+			m_peeked = true;
+		}
+
+		return m_next;
+	}
+
+	/// Called after get() returns '[', removes the rest of the branch (including the closing ']') from the production string
+	/// and returns true if it can be drawn independently
+	bool split(branch& Branch)
+	{
+		if(!m_grammar.splittable || m_peeked || !m_direct || m_frames.empty())
+			return false;
+
+		frame& current = m_frames.back();
+		const std::string& text = *current.text;
+		const bool terminal = current.level == m_grammar.lev;
+
+		long depth = 0;
+		long braces = 0;
+		for(unsigned long i = current.position; i != current.end; ++i)
+		{
+			switch(text[i])
+			{
+				case '[':
+					++depth;
+					break;
+				case ']':
+					if(depth--)
+						break;
+					if(braces)
+						return false;
+
+					Branch = branch(current.text, current.position, i, current.level);
+					current.position = i + 1;
+					return true;
+				case '{':
+					++braces;
+					break;
+				case '}':
+					if(--braces < 0)
+						return false;
+					break;
+				case '~':
+					return false;
+				default:
+					if(!terminal && !m_grammar.independent(text[i]))
+						return false;
+					break;
+			}
+		}
+
+		return false;
+	}
+
+private:
+	/// Stores a partially-expanded rule
+	struct frame
+	{
+		frame(const std::string* Text, const unsigned long Begin, const unsigned long End, const unsigned long Level, const bool Marker) :
+			text(Text),
+			position(Begin),
+			end(End),
+			level(Level),
+			marker(Marker)
+		{
+		}
+
+		const std::string* text;
+		unsigned long position;
+		unsigned long end;
+		unsigned long level;
+		/// Set when the expansion must be followed by an '@' mark
+		bool marker;
+	};
+
+	char generate()
+	{
+		m_direct = false;
+		while(!m_frames.empty())
+		{
+			frame& current = m_frames.back();
+			if(current.position == current.end)
+			{
+				const bool marker = current.marker;
+				m_frames.pop_back();
+				if(marker)
+					return '@';
+
+				continue;
+			}
+
+			const char symbol = (*current.text)[current.position++];
+			if(current.level == m_grammar.lev || m_grammar.constant(symbol))
+			{
+				m_direct = true;
+				return symbol;
+			}
 
-// Rules
-std::vector<std::string> rules;
+			const unsigned long rule = m_grammar.rule(symbol);
+			const bool marker = m_grammar.marked(rule, current.level);
+			const std::string& successor = m_grammar.rules[rule];
+			m_frames.push_back(frame(&successor, std::min<unsigned long>(2, successor.size()), successor.size(), current.level + 1, marker));
+			if(marker)
+				return '@';
+		}
 
-// Marked rules need special processing when growing shapes are active
-std::vector<bool> marks;
+		return 0;
+	}
 
-// Used to build the production string
-std::string object_string;
+	const grammar& m_grammar;
+	std::vector<frame> m_frames;
+	bool m_peeked;
+	char m_next;
+	/// Set when the most recent symbol was returned directly from the top frame
+	bool m_direct;
+};
 
 // Settings stack used for solving [] references
 typedef struct s_rec
@@ -88,39 +471,7 @@ typedef struct s_rec
 	unsigned long	last_col;	// color of last object
 } s_rec;
 
-// Flags
-bool trope_set = false;
-bool rand_set = false;
-bool closed_form = false;
-bool last_recur = false; // processing the last recursion step
-
-// Init vars
-k3d::double_t		thick, min_thick = 0.0, rand_amount = 0.0;
-k3d::double_t		trope_amount = 0.0;
-unsigned long	polcount = 0;
-// Limit total generated polygons
-unsigned long	poly_limit = 500000L;
-// Set maximum production string size in kbytes
-unsigned long	max_string = 2L * 1024L * 1024L;
-unsigned long	col = 2, lev, last_col = 0;
-k3d::double_t		dis, ang, dis2, tr = 0.2;
-k3d::vector3	sky(0.0, 0.0, 1.0);
-k3d::vector3	trope;
-k3d::point3	last(1.0, 1.0, 1.0), last_v[8];
-k3d::double_t		fraction;
-k3d::point3	axis_x, axis_y, axis_z;
-
-// Stacks []
-std::stack<s_rec> stack;
-s_rec save;
-
-// Polygon stack used for solving {} references
 typedef std::vector<k3d::point3> vectors_t;
-std::stack<vectors_t> pstack;
-
-// Max size of the [] and {} stacks during drawing
-// useful during mutation
-unsigned long	max_stack_size = 1000;
 
 // Polygons
 class polygon
@@ -142,19 +493,10 @@ public:
 	}
 };
 
-
-// Store vertices and polygons
-vectors_t vertices;
 typedef std::vector<polygon> polygons_t;
-polygons_t polygons;
-k3d::signed_axis orientation;
-bool flip_normals;
 
-// Bounding-box
-k3d::bounding_box3 bounding_box;
-k3d::double_t bbox_x = 0;
-k3d::double_t bbox_y = 0;
-k3d::double_t bbox_z = 0;
+// Default maximal length of a production string, as in the original lparser
+const unsigned long max_string = 2L * 1024L * 1024L;
 
 // LViewer colors
 const unsigned long color_number = 15;
@@ -176,1415 +518,1552 @@ k3d::color colors[color_number] = {
 	k3d::color(0.9, 0.9, 0.9)
 };
 
-struct context
+/// Settings that control how a production string is drawn
+struct options
 {
-	context(k3d::mesh::points_t& Points, k3d::mesh::selection_t& PointSelection, k3d::polyhedron::primitive& Polyhedron, k3d::imaterial* const Material) :
-		points(Points),
-		point_selection(PointSelection),
-		polyhedron(Polyhedron),
-		material(Material)
+	options(const bool ClosedForm, const k3d::double_t Trope, const unsigned long MaximalStackSize, const k3d::signed_axis Orientation, const bool FlipNormals, const bool Instances, const unsigned long RandomSeed) :
+		closed_form(ClosedForm),
+		trope_amount(Trope),
+		max_stack_size(MaximalStackSize),
+		orientation(Orientation),
+		flip_normals(FlipNormals),
+		instances(Instances),
+		random_seed(RandomSeed)
 	{
 	}
 
-	k3d::mesh::points_t& points;
-	k3d::mesh::selection_t& point_selection;
-	k3d::polyhedron::primitive& polyhedron;
-	k3d::imaterial* const material;
+	/// Create closed connected cylinders
+	bool closed_form;
+	/// Amount of trope
+	k3d::double_t trope_amount;
+	/// Max size of the [] and {} stacks during drawing, useful during mutation
+	unsigned long max_stack_size;
+	/// Face orientation
+	k3d::signed_axis orientation;
+	bool flip_normals;
+	/// Emit segments as instanced cylinders instead of polygons
+	bool instances;
+	unsigned long random_seed;
 };
 
-bool add_geometry(unsigned long Color, const context& Context)
+// Update orientation and change handedness
+const k3d::point3 orient(const k3d::point3& Point, const k3d::signed_axis Orientation)
 {
-	k3d::mesh::indices_t new_points;
-	for(unsigned long t = 0; t < vertices.size(); t++)
+	switch(Orientation)
 	{
-		// Update orientation and change handedness
-		k3d::double_t x = 0;
-		k3d::double_t y = 0;
-		k3d::double_t z = 0;
-		switch(orientation)
-		{
-			case k3d::PX:
-				x = vertices[t][2];
-				y = -vertices[t][1];
-				z = vertices[t][0];
-				break;
-			case k3d::NX:
-				x = -vertices[t][2];
-				y = -vertices[t][1];
-				z = -vertices[t][0];
-				break;
-			case k3d::PY:
-				x = -vertices[t][0];
-				y = vertices[t][2];
-				z = vertices[t][1];
-				break;
-			case k3d::NY:
-				x = vertices[t][0];
-				y = -vertices[t][2];
-				z = vertices[t][1];
-				break;
-			case k3d::PZ:
-				x = -vertices[t][0];
-				y = -vertices[t][1];
-				z = vertices[t][2];
-				break;
-			case k3d::NZ:
-				x = vertices[t][0];
-				y = -vertices[t][1];
-				z = -vertices[t][2];
-				break;
-		}
+		case k3d::PX:
+			return k3d::point3(Point[2], -Point[1], Point[0]);
+		case k3d::NX:
+			return k3d::point3(-Point[2], -Point[1], -Point[0]);
+		case k3d::PY:
+			return k3d::point3(-Point[0], Point[2], Point[1]);
+		case k3d::NY:
+			return k3d::point3(Point[0], -Point[2], Point[1]);
+		case k3d::PZ:
+			return k3d::point3(-Point[0], -Point[1], Point[2]);
+		case k3d::NZ:
+			return k3d::point3(Point[0], -Point[1], -Point[2]);
+	}
 
-		const k3d::point3 point(x, y, z);
+	return k3d::point3(0, 0, 0);
+}
 
-		new_points.push_back(Context.points.size());
+/// Returns the orientation change as a matrix, for instanced geometry
+const k3d::matrix4 orientation_matrix(const k3d::signed_axis Orientation)
+{
+	const k3d::point3 x = orient(k3d::point3(1, 0, 0), Orientation);
+	const k3d::point3 y = orient(k3d::point3(0, 1, 0), Orientation);
+	const k3d::point3 z = orient(k3d::point3(0, 0, 1), Orientation);
+
+	return k3d::matrix4(
+		k3d::vector4(x[0], y[0], z[0], 0),
+		k3d::vector4(x[1], y[1], z[1], 0),
+		k3d::vector4(x[2], y[2], z[2], 0),
+		k3d::vector4(0, 0, 0, 1));
+}
 
-		Context.points.push_back(point);
-		Context.point_selection.push_back(0);
-		bounding_box.insert(point);
-	}
+/// Stores the geometry drawn from one part of the production string, so parts can be drawn in parallel and added to the mesh in-order
+struct geometry
+{
+	/// Stores oriented points
+	std::vector<k3d::point3> points;
+	/// Stores the number of points in each polygon
+	std::vector<k3d::uint_t> polygon_sizes;
+	/// Stores the points of each polygon
+	std::vector<k3d::uint_t> polygon_points;
+	/// Stores instanced segments
+	std::vector<k3d::matrix4> segment_matrices;
+	std::vector<k3d::double_t> segment_radii;
+	std::vector<k3d::double_t> segment_lengths;
+	k3d::bounding_box3 bounds;
+};
 
-	for(unsigned long t = 0; t < polygons.size(); t++)
+/// Stores the mesh arrays that geometry is added to
+struct context
+{
+	context(k3d::mesh::points_t& Points, k3d::mesh::selection_t& PointSelection, k3d::polyhedron::primitive& Polyhedron, k3d::cylinder::primitive* const Cylinders, k3d::imaterial* const Material) :
+		points(Points),
+		point_selection(PointSelection),
+		polyhedron(Polyhedron),
+		cylinders(Cylinders),
+		material(Material)
 	{
-		Context.polyhedron.face_shells.push_back(0);
-		Context.polyhedron.face_first_loops.push_back(Context.polyhedron.loop_first_edges.size());
-		Context.polyhedron.face_loop_counts.push_back(1);
-		Context.polyhedron.face_selections.push_back(0);
-		Context.polyhedron.face_materials.push_back(Context.material);
+	}
 
-		Context.polyhedron.loop_first_edges.push_back(Context.polyhedron.clockwise_edges.size());
+	void add(const geometry& Geometry)
+	{
+		const k3d::uint_t first_point = points.size();
+		points.insert(points.end(), Geometry.points.begin(), Geometry.points.end());
+		point_selection.insert(point_selection.end(), Geometry.points.size(), 0);
 
-		if(flip_normals)
+		k3d::uint_t polygon_point = 0;
+		for(k3d::uint_t i = 0; i != Geometry.polygon_sizes.size(); ++i)
 		{
-			if(polygons[t].c != polygons[t].d)
-			{
-				Context.polyhedron.clockwise_edges.push_back(Context.polyhedron.clockwise_edges.size() + 1);
-				Context.polyhedron.clockwise_edges.push_back(Context.polyhedron.clockwise_edges.size() + 1);
-				Context.polyhedron.clockwise_edges.push_back(Context.polyhedron.clockwise_edges.size() + 1);
-				Context.polyhedron.clockwise_edges.push_back(Context.polyhedron.clockwise_edges.size() - 3);
-
-				Context.polyhedron.edge_selections.push_back(0);
-				Context.polyhedron.edge_selections.push_back(0);
-				Context.polyhedron.edge_selections.push_back(0);
-				Context.polyhedron.edge_selections.push_back(0);
-
-				Context.polyhedron.vertex_points.push_back(new_points[polygons[t].a]);
-				Context.polyhedron.vertex_points.push_back(new_points[polygons[t].d]);
-				Context.polyhedron.vertex_points.push_back(new_points[polygons[t].c]);
-				Context.polyhedron.vertex_points.push_back(new_points[polygons[t].b]);
-
-				Context.polyhedron.vertex_selections.push_back(0);
-				Context.polyhedron.vertex_selections.push_back(0);
-				Context.polyhedron.vertex_selections.push_back(0);
-				Context.polyhedron.vertex_selections.push_back(0);
-			}
-			else
-			{
-				Context.polyhedron.clockwise_edges.push_back(Context.polyhedron.clockwise_edges.size() + 1);
-				Context.polyhedron.clockwise_edges.push_back(Context.polyhedron.clockwise_edges.size() + 1);
-				Context.polyhedron.clockwise_edges.push_back(Context.polyhedron.clockwise_edges.size() - 2);
-
-				Context.polyhedron.edge_selections.push_back(0);
-				Context.polyhedron.edge_selections.push_back(0);
-				Context.polyhedron.edge_selections.push_back(0);
+			polyhedron.face_shells.push_back(0);
+			polyhedron.face_first_loops.push_back(polyhedron.loop_first_edges.size());
+			polyhedron.face_loop_counts.push_back(1);
+			polyhedron.face_selections.push_back(0);
+			polyhedron.face_materials.push_back(material);
 
-				Context.polyhedron.vertex_points.push_back(new_points[polygons[t].a]);
-				Context.polyhedron.vertex_points.push_back(new_points[polygons[t].c]);
-				Context.polyhedron.vertex_points.push_back(new_points[polygons[t].b]);
+			const k3d::uint_t first_edge = polyhedron.clockwise_edges.size();
+			polyhedron.loop_first_edges.push_back(first_edge);
 
-				Context.polyhedron.vertex_selections.push_back(0);
-				Context.polyhedron.vertex_selections.push_back(0);
-				Context.polyhedron.vertex_selections.push_back(0);
+			for(k3d::uint_t j = 0; j != Geometry.polygon_sizes[i]; ++j)
+			{
+				polyhedron.clockwise_edges.push_back(polyhedron.clockwise_edges.size() + 1);
+				polyhedron.edge_selections.push_back(0);
+				polyhedron.vertex_points.push_back(first_point + Geometry.polygon_points[polygon_point++]);
+				polyhedron.vertex_selections.push_back(0);
 			}
+			polyhedron.clockwise_edges.back() = first_edge;
 		}
-		else
+
+		if(cylinders)
 		{
-			if(polygons[t].c != polygons[t].d)
+			for(k3d::uint_t i = 0; i != Geometry.segment_matrices.size(); ++i)
 			{
-				Context.polyhedron.clockwise_edges.push_back(Context.polyhedron.clockwise_edges.size() + 1);
-				Context.polyhedron.clockwise_edges.push_back(Context.polyhedron.clockwise_edges.size() + 1);
-				Context.polyhedron.clockwise_edges.push_back(Context.polyhedron.clockwise_edges.size() + 1);
-				Context.polyhedron.clockwise_edges.push_back(Context.polyhedron.clockwise_edges.size() - 3);
-
-				Context.polyhedron.edge_selections.push_back(0);
-				Context.polyhedron.edge_selections.push_back(0);
-				Context.polyhedron.edge_selections.push_back(0);
-				Context.polyhedron.edge_selections.push_back(0);
-
-				Context.polyhedron.vertex_points.push_back(new_points[polygons[t].a]);
-				Context.polyhedron.vertex_points.push_back(new_points[polygons[t].b]);
-				Context.polyhedron.vertex_points.push_back(new_points[polygons[t].c]);
-				Context.polyhedron.vertex_points.push_back(new_points[polygons[t].d]);
-
-				Context.polyhedron.vertex_selections.push_back(0);
-				Context.polyhedron.vertex_selections.push_back(0);
-				Context.polyhedron.vertex_selections.push_back(0);
-				Context.polyhedron.vertex_selections.push_back(0);
+				cylinders->matrices.push_back(Geometry.segment_matrices[i]);
+				cylinders->materials.push_back(material);
+				cylinders->radii.push_back(Geometry.segment_radii[i]);
+				cylinders->z_min.push_back(0.0);
+				cylinders->z_max.push_back(Geometry.segment_lengths[i]);
+				cylinders->sweep_angles.push_back(k3d::pi_times_2());
+				cylinders->selections.push_back(0.0);
 			}
-			else
-			{
-				Context.polyhedron.clockwise_edges.push_back(Context.polyhedron.clockwise_edges.size() + 1);
-				Context.polyhedron.clockwise_edges.push_back(Context.polyhedron.clockwise_edges.size() + 1);
-				Context.polyhedron.clockwise_edges.push_back(Context.polyhedron.clockwise_edges.size() - 2);
+		}
+
+		bounds.insert(Geometry.bounds);
+	}
+
+	k3d::mesh::points_t& points;
+	k3d::mesh::selection_t& point_selection;
+	k3d::polyhedron::primitive& polyhedron;
+	k3d::cylinder::primitive* const cylinders;
+	k3d::imaterial* const material;
+	k3d::bounding_box3 bounds;
+};
 
-				Context.polyhedron.edge_selections.push_back(0);
-				Context.polyhedron.edge_selections.push_back(0);
-				Context.polyhedron.edge_selections.push_back(0);
+/// Rotates vectors around an axis
+class rotation
+{
+public:
+	rotation(const k3d::double_t a, const k3d::vector3& n)
+	{
+		k3d::double_t cosa = cos(a);
+		k3d::double_t sina = sin(a);
 
-				Context.polyhedron.vertex_points.push_back(new_points[polygons[t].a]);
-				Context.polyhedron.vertex_points.push_back(new_points[polygons[t].b]);
-				Context.polyhedron.vertex_points.push_back(new_points[polygons[t].c]);
+		k3d::double_t n11 = n[0] * n[0];
+		k3d::double_t n22 = n[1] * n[1];
+		k3d::double_t n33 = n[2] * n[2];
 
-				Context.polyhedron.vertex_selections.push_back(0);
-				Context.polyhedron.vertex_selections.push_back(0);
-				Context.polyhedron.vertex_selections.push_back(0);
-			}
-		}
+		k3d::double_t nxy = n[0] * n[1];
+		k3d::double_t nxz = n[0] * n[2];
+		k3d::double_t nyz = n[1] * n[2];
 
-/*
-		// Set color ...
-		unsigned long color_index = Color;
-		if(color_index > color_number - 1)
-			color_index = 0;
+		C1[0] = n11 + (1.0 - n11) * cosa;
+		C1[1] = nxy * (1.0 - cosa) - n[2] * sina;
+		C1[2] = nxz * (1.0 - cosa) + n[1] * sina;
 
-		new_face->uniform_data["Cs"] = colors[color_index];
-*/
+		C2[0] = nxy * (1.0 - cosa) + n[2] * sina;
+		C2[1] = n22 + (1.0 - n22) * cosa;
+		C2[2] = nyz * (1.0 - cosa) - n[0] * sina;
+
+		C3[0] = nxz * (1.0 - cosa) - n[1] * sina;
+		C3[1] = nyz * (1.0 - cosa) + n[0] * sina;
+		C3[2] = n33 + (1.0 - n33) * cosa;
 	}
 
-	return true;
-}
+	k3d::vector3 operator()(const k3d::vector3& In) const
+	{
+		return k3d::normalize(k3d::vector3(C1 * In, C2 * In, C3 * In));
+	}
+
+private:
+	k3d::vector3 C1, C2, C3;
+};
 
+class branch_scheduler;
 
-// Here we build a cube shape directly on the input vectors
-void add_cube(k3d::point3 start, k3d::point3 end, k3d::vector3 up, unsigned long color, const context& Context, const k3d::signed_axis Orientation)
+/// Draws a production string, storing all drawing state so that independent drawings can run concurrently
+class turtle
 {
-	// Check size
-	k3d::vector3 direction = end - start;
-	k3d::double_t length = direction.length();
-	if(length == 0)
-		return;
-
-	k3d::double_t s = length * thick;
-	s = std::max(s, min_thick);
-	s *= 0.5;
-
-	k3d::vector3 d1 = k3d::normalize(direction);
-	k3d::vector3 d2 = k3d::normalize(up);
-
-	k3d::vector3 d3 = k3d::normalize(d1 ^ d2);
-
-	vertices.clear();
-	vertices.resize(4);
-
-	// Base 1, 3
-	d1 = k3d::normalize(d2 + d3);
-	vertices[0] = start + s * d1;
-	vertices[2] = start + (-s) * d1;
-
-	// Base 2, 4
-	d1 = k3d::normalize(d2 - d3);
-	vertices[1] = start + s * d1;
-	vertices[3] = start + (-s) * d1;
-
-	// Top
-	for(unsigned long i = 0; i < 4; i++)
-		vertices.push_back(vertices[i] + direction);
-
-	// Polygons
-	polygons.clear();
-	polygons.push_back(polygon(0, 4, 5, 1));
-	polygons.push_back(polygon(1, 5, 6, 2));
-	polygons.push_back(polygon(2, 6, 7, 3));
-	polygons.push_back(polygon(3, 7, 4, 0));
-	polygons.push_back(polygon(0, 1, 2, 3));
-	polygons.push_back(polygon(7, 6, 5, 4));
-
-	add_geometry(color, Context);
-}
+public:
+	turtle(const grammar& Grammar, const options& Options) :
+		m_grammar(&Grammar),
+		m_options(&Options),
+		m_output(0),
+		m_random(Options.random_seed),
+		m_stack_offset(0),
+		m_pos(0.0, 0.0, 0.0),
+		m_fow(0.0, 0.0, 1.0),
+		m_lef(0.0, 1.0, 0.0),
+		m_upp(1.0, 0.0, 0.0),
+		m_dis(100.0),
+		m_dis2(50.0),
+		m_ang(Grammar.ang),
+		m_thick(Grammar.thick),
+		m_min_thick(0.0),
+		m_tr(0.2),
+		m_trope_amount(Options.trope_amount),
+		m_col(2),
+		m_last(1.0, 1.0, 1.0),
+		m_last_col(0),
+		m_last_recur(false),
+		m_thick_l(0),
+		m_ang_l(0),
+		m_dis_l(0),
+		m_dis2_l(0),
+		m_trope_l(0),
+		m_poly_on(false),
+		m_sky(0.0, 0.0, 1.0)
+	{
+	}
 
-// The lastxxx vars are used to store the previous top of the cylinder
-// for connecting a next one; since the vars are stacked for [] we can
-// connect correctly according to current nesting level
-void add_cylinder(k3d::point3 start, k3d::point3 end, k3d::vector3 up, unsigned long color, const context& Context, const k3d::signed_axis Orientation)
-{
-	// Check size
-	k3d::vector3 direction = end - start;
-	k3d::double_t length = direction.length();
-	if(length == 0.0)
-		return;
+	/// Returns a turtle for drawing a branch that starts at the current position.  The branch starts from the same s_rec that
+	/// '[' pushes, and the remaining state that a branch can read (growth and trope values) is copied, so the branch is drawn
+	/// exactly as it would be in-place.  The main turtle continues from the matching ']' with its own state unchanged, which
+	/// is the state that ']' would have restored
+	const turtle branch_state() const
+	{
+		turtle result(*m_grammar, *m_options);
+		result.restore_state(save_state());
+		result.m_random = m_random;
+		result.m_stack_offset = m_stack.size() + m_stack_offset + 1;
+		result.m_min_thick = m_min_thick;
+		result.m_trope_amount = m_trope_amount;
+		result.m_trope = m_trope;
+		result.m_last_recur = m_last_recur;
+		result.m_thick_l = m_thick_l;
+		result.m_ang_l = m_ang_l;
+		result.m_dis_l = m_dis_l;
+		result.m_dis2_l = m_dis2_l;
+		result.m_trope_l = m_trope_l;
+
+		return result;
+	}
+
+	/// Process a production string and generate form
+	void draw(production& Production, geometry& Output, branch_scheduler* const Scheduler);
 
-	k3d::double_t s = length * thick;
-	s = std::max(s, min_thick);
-	s *= 0.5;
+private:
+	/// Returns the state that '[' saves and ']' restores
+	const s_rec save_state() const
+	{
+		s_rec result;
+		result.pos = m_pos;
+		result.fow = m_fow;
+		result.lef = m_lef;
+		result.upp = m_upp;
+		result.col = m_col;
+		result.dis = m_dis;
+		result.dis2 = m_dis2;
+		result.ang = m_ang;
+		result.thick = m_thick;
+		result.tr = m_tr;
+
+		if(m_options->closed_form)
+		{
+			result.last = m_last;
+			result.last_col = m_last_col;
+			for(unsigned long j = 0; j < 8; j++)
+				result.last_v[j] = m_last_v[j];
+		}
 
-	k3d::vector3 d1 = k3d::normalize(direction);
-	k3d::vector3 d2 = k3d::normalize(up);
+		return result;
+	}
 
-	k3d::vector3 d3 = k3d::normalize(d1 ^ d2);
+	/// Restores the state saved by save_state()
+	void restore_state(const s_rec& Record)
+	{
+		m_pos = Record.pos;
+		m_fow = Record.fow;
+		m_lef = Record.lef;
+		m_upp = Record.upp;
+		m_col = Record.col;
+		m_dis = Record.dis;
+		m_dis2 = Record.dis2;
+		m_ang = Record.ang;
+		m_thick = Record.thick;
+		m_tr = Record.tr;
+
+		if(m_options->closed_form)
+		{
+			m_last = Record.last;
+			m_last_col = Record.last_col;
+			for(unsigned long j = 0; j < 8; j++)
+				m_last_v[j] = Record.last_v[j];
+		}
+	}
 
-	k3d::point3 t1 = k3d::to_point(k3d::normalize(d2 + d3));
-	k3d::point3 t2 = k3d::to_point(k3d::normalize(d2 - d3));
+	// Read a (xx) value from a production string
+	k3d::double_t parse_value(production& Production)
+	{
+		// Skip '('
+		Production.get();
 
-	vertices.clear();
-	vertices.resize(8);
+		std::string val("");
+		for(char symbol = Production.get(); symbol && symbol != ')'; symbol = Production.get())
+			val += symbol;
 
-	vertices[0] = start + s * t1;
-	vertices[4] = start + (-s) * t1;
-	vertices[2] = start + s * t2;
-	vertices[6] = start + (-s) * t2;
+		std::stringstream scan(val);
+		k3d::double_t r = 0.0;
+		scan >> r;
 
-	s *= 0.7071;
-	vertices[1] = start + s * t1 + s * t2;
-	vertices[3] = start + (-s) * t1 + s * t2;
-	vertices[5] = start + (-s) * t1 + (-s) * t2;
-	vertices[7] = start + s * t1 + (-s) * t2;
+		if(m_last_recur)
+			return r * m_grammar->fraction;
 
-	// Top
-	for(unsigned long i = 0; i < 8; i++)
-		vertices.push_back(vertices[i] + direction);
+		return r;
+	}
 
-	if(last_col == color)
+	void add_geometry(const vectors_t& Vertices, const polygons_t& Polygons)
 	{
-		direction = start - last;
-		length = direction.length();
-		k3d::double_t dd = std::numeric_limits<k3d::double_t>::max();
+		const k3d::uint_t first_point = m_output->points.size();
+		for(unsigned long t = 0; t < Vertices.size(); t++)
+		{
+			const k3d::point3 point = orient(Vertices[t], m_options->orientation);
+			m_output->points.push_back(point);
+			m_output->bounds.insert(point);
+		}
 
-		// Connect cylinders if near enough
-		if(length < 1.0)
+		for(unsigned long t = 0; t < Polygons.size(); t++)
 		{
-			// Find nearest vertex
-			unsigned long ii = 0;
-			for(unsigned long i = 0; i < 8; i++)
+			const polygon& p = Polygons[t];
+			const bool quad = p.c != p.d;
+
+			m_output->polygon_sizes.push_back(quad ? 4 : 3);
+			m_output->polygon_points.push_back(first_point + p.a);
+			if(m_options->flip_normals)
 			{
-				direction = vertices[0] - last_v[i];
-				length = direction.length();
-				if(length < dd)
-				{
-					dd = length;
-					ii = i;
-				}
+				if(quad)
+					m_output->polygon_points.push_back(first_point + p.d);
+				m_output->polygon_points.push_back(first_point + p.c);
+				m_output->polygon_points.push_back(first_point + p.b);
 			}
-
-			for(unsigned long i = 0; i < 8; i++)
+			else
 			{
-				vertices[i] = last_v[ii];
-				ii = (ii + 1) % 8;
+				m_output->polygon_points.push_back(first_point + p.b);
+				m_output->polygon_points.push_back(first_point + p.c);
+				if(quad)
+					m_output->polygon_points.push_back(first_point + p.d);
 			}
 		}
 	}
 
-	// Polygons
-	polygons.clear();
-	polygons.push_back(polygon(0, 8, 9, 1));
-	polygons.push_back(polygon(1, 9, 10, 2));
-	polygons.push_back(polygon(2, 10, 11, 3));
-	polygons.push_back(polygon(3, 11, 12, 4));
-	polygons.push_back(polygon(4, 12, 13, 5));
-	polygons.push_back(polygon(5, 13, 14, 6));
-	polygons.push_back(polygon(6, 14, 15, 7));
-	polygons.push_back(polygon(7, 15, 8, 0));
-
-	add_geometry(color, Context);
-
-	// Save cylinder's parameters and top vertices
-	last_col = color;
-	last = end;
-	for(unsigned long i = 0; i < 8; i++)
-		last_v[i] = vertices[i + 8];
-}
+	// Instead of building polygons, store the segment as a cylinder placed along the input vectors
+	void add_instance(const k3d::point3& start, const k3d::point3& end, const k3d::vector3& up)
+	{
+		// Check size
+		const k3d::vector3 direction = end - start;
+		const k3d::double_t length = direction.length();
+		if(length == 0)
+			return;
 
-// L-system routines ------------------------------------------------------
+		k3d::double_t s = length * m_thick;
+		s = std::max(s, m_min_thick);
+		s *= 0.5;
+
+		const k3d::vector3 look = k3d::normalize(direction);
+		k3d::vector3 right = look ^ up;
+		if(right.length2() == 0)
+			right = look ^ (std::fabs(look[0]) < 0.9 ? k3d::vector3(1, 0, 0) : k3d::vector3(0, 1, 0));
+		right = k3d::normalize(right);
+		const k3d::vector3 upp = look ^ right;
+
+		const k3d::matrix4 place(
+			k3d::vector4(right[0], upp[0], look[0], start[0]),
+			k3d::vector4(right[1], upp[1], look[1], start[1]),
+			k3d::vector4(right[2], upp[2], look[2], start[2]),
+			k3d::vector4(0, 0, 0, 1));
+
+		m_output->segment_matrices.push_back(orientation_matrix(m_options->orientation) * place);
+		m_output->segment_radii.push_back(s);
+		m_output->segment_lengths.push_back(length);
+		m_output->bounds.insert(orient(start, m_options->orientation));
+		m_output->bounds.insert(orient(end, m_options->orientation));
+	}
 
-// Get a line from a .ls file;
-// skips comments (lines beginning with '#') and empty lines
-bool ls_line(std::istream& file, std::string& linebuffer)
-{
-	while(!file.eof())
+	// Here we build a cube shape directly on the input vectors
+	void add_cube(k3d::point3 start, k3d::point3 end, k3d::vector3 up)
 	{
-		k3d::getline(file, linebuffer);
+		// Check size
+		k3d::vector3 direction = end - start;
+		k3d::double_t length = direction.length();
+		if(length == 0)
+			return;
 
-		// Skip comments ...
-		if(linebuffer[0] == '#')
-			continue;
+		k3d::double_t s = length * m_thick;
+		s = std::max(s, m_min_thick);
+		s *= 0.5;
 
-		// Skip blank lines
-		if(!(k3d::trim(linebuffer)).size())
-			continue;
+		k3d::vector3 d1 = k3d::normalize(direction);
+		k3d::vector3 d2 = k3d::normalize(up);
 
-		// Must qualify
-		return true;
-	}
-
-	// end-of-file reached
-	return false;
-}
-
-bool load_configuration_values(const k3d::filesystem::path& file_path, k3d::double_t& recursion, k3d::double_t& basic_angle, k3d::double_t& thickness)
-{
-	// Open configuration file
-	k3d::filesystem::ifstream file(file_path);
-	if(!file.good())
-	{
-		k3d::log() << error << k3d_file_reference << ": error opening [" << file_path.native_console_string() << "]" << std::endl;
-		return 0.0;
-	}
-
-	// Get recursion level
-	std::string temp;
-	return_val_if_fail(ls_line(file, temp), false);
-	std::stringstream scan(temp);
-	scan >> recursion;
-
-	// Get asic angle
-	return_val_if_fail(ls_line(file, temp), false);
-	std::stringstream scan2(temp);
-	scan2 >> basic_angle;
-
-	// Get thickness
-	return_val_if_fail(ls_line(file, temp), false);
-	std::stringstream scan3(temp);
-	scan3 >> thickness;
-
-	return true;
-}
-
-// Process a ls file and setup rules
-bool load_configuration_rules(const k3d::double_t recursion, const k3d::double_t basic_angle, const k3d::double_t thickness, const k3d::filesystem::path& file_path)
-{
-	// Open grammar file
-	k3d::filesystem::ifstream file(file_path);
-	if(!file.good())
-	{
-		k3d::log() << error << k3d_file_reference << ": error opening [" << file_path.native_console_string() << "]" << std::endl;
-		return false;
-	}
-
-	// Set default values
-	trope_set = false;
-	rand_set = false;
-	closed_form = false;
-	last_recur = false;
-
-	min_thick = 0.0; rand_amount = 0.0;
-	trope_amount = 0.0;
-	polcount = 0;
-	poly_limit = 500000L;
-	col = 2; last_col = 0;
-	tr = 0.2;
-	sky = k3d::vector3(0.0, 0.0, 1.0);
-	last = k3d::point3(1.0, 1.0, 1.0);
-
-	// Clear stacks
-	stack = std::stack<s_rec>();
-	pstack = std::stack<vectors_t>();
-
-	// Skip but setup recursion level, basic angle and thickness
-	std::string temp;
-	return_val_if_fail(ls_line(file, temp), false);
-
-	lev = (unsigned long)std::floor(recursion);
-	fraction = recursion - (k3d::double_t)lev;
-	if(fraction > 0)
-		lev++;
-
-	return_val_if_fail(ls_line(file, temp), false);
-	ang = basic_angle / 180 * 3.141592654;
-
-	return_val_if_fail(ls_line(file, temp), false);
-	thick = thickness / 100;
-
-	// Axiom
-	return_val_if_fail(ls_line(file, temp), false);
-
-	object_string = strtok(const_cast<char*>(temp.c_str()), " \r\n\t#");
-
-	// Get rules
-	rules.clear();
-	for(unsigned long i = 0; i < 150; i++)
-	{
-		return_val_if_fail(ls_line(file, temp), false);
-
-		std::string rule = strtok(const_cast<char*>(temp.c_str()), " \r\n\t#");
-
-		if(!rule.size())
-			continue;
-
-		if(rule[0] == '@')
-			break;
-
-		rules.push_back(rule);
-	}
+		k3d::vector3 d3 = k3d::normalize(d1 ^ d2);
 
-	// Add default rules
-	rules.push_back("+=+");
-	rules.push_back("-=-");
-	rules.push_back("&=&");
-	rules.push_back("^=^");
-	rules.push_back("<=<");
-	rules.push_back(">=>");
+		vectors_t vertices(4);
 
-	rules.push_back("%=%");
-	rules.push_back("|=|");
-	rules.push_back("!=!");
-	rules.push_back("?=?");
-	rules.push_back(":=:");
-	rules.push_back(";=;");
-	rules.push_back("\'=\'");
-	rules.push_back("\"=\"");
-	rules.push_back("c=c");
+		// Base 1, 3
+		d1 = k3d::normalize(d2 + d3);
+		vertices[0] = start + s * d1;
+		vertices[2] = start + (-s) * d1;
 
-	rules.push_back("[=[");
-	rules.push_back("]=]");
-	rules.push_back("{={");
-	rules.push_back("}=}");
+		// Base 2, 4
+		d1 = k3d::normalize(d2 - d3);
+		vertices[1] = start + s * d1;
+		vertices[3] = start + (-s) * d1;
 
-	rules.push_back("F=F");
-	rules.push_back("f=f");
-	rules.push_back("t=t");
-	rules.push_back("g=g");
-	rules.push_back("Z=Z");
-	rules.push_back("z=z");
-	rules.push_back("*=*");
-	rules.push_back("$=$");
-	rules.push_back("~=~");
+		// Top
+		for(unsigned long i = 0; i < 4; i++)
+			vertices.push_back(vertices[i] + direction);
 
-	rules.push_back(".=.");
-	rules.push_back("1=1");
-	rules.push_back("2=2");
-	rules.push_back("3=3");
-	rules.push_back("4=4");
-	rules.push_back("5=5");
-	rules.push_back("6=6");
-	rules.push_back("7=7");
-	rules.push_back("8=8");
-	rules.push_back("9=9");
-	rules.push_back("0=0");
-	rules.push_back("(=(");
-	rules.push_back(")=)");
-
-	// Closer default
-	rules.push_back("_=_");
-
-	// Set start values for F and Z distances
-	dis = 100.0;
-	dis2 = dis * 0.5;
-
-	// Get marks
-	marks.clear();
-	for(unsigned long n = 0; n < rules.size(); n++)
-		marks.push_back(false);
-
-	// Check which rules need to be marked for last recursion when growing
-	for(unsigned long n = 0; n < rules.size(); n++)
-	{
-		if(rules[n][0] == '+')
-			break;
-
-		marks[n] = true;
+		// Polygons
+		polygons_t polygons;
+		polygons.push_back(polygon(0, 4, 5, 1));
+		polygons.push_back(polygon(1, 5, 6, 2));
+		polygons.push_back(polygon(2, 6, 7, 3));
+		polygons.push_back(polygon(3, 7, 4, 0));
+		polygons.push_back(polygon(0, 1, 2, 3));
+		polygons.push_back(polygon(7, 6, 5, 4));
 
-		// All rules with basic move/block before '=' mark false
-		if(rules[n][0] == 'F')
-			marks[n] = false;
-		if(rules[n][0] == 'f')
-			marks[n] = false;
-		if(rules[n][0] == 'Z')
-			marks[n] = false;
-		if(rules[n][0] == 'z')
-			marks[n] = false;
+		add_geometry(vertices, polygons);
 	}
 
-	return true;
-}
-
-// Apply mutations to the rules
-const k3d::double_t inv_max = 1.0 / RAND_MAX;
-k3d::double_t Rnd()
-{
-	return rand() * inv_max;
-}
-
-void L_mutate()
-{
-	unsigned long n;
-	for(n = 0; n < rules.size(); n++)
-		if(rules[n][0] == '+')
-			break;
-
-	k3d::double_t rules_n = static_cast<k3d::double_t>(n);
-	const unsigned long max = 1000;
-
-	unsigned long i = static_cast<unsigned long>(Rnd() * 6.0);
-	switch(i)
-	{
-		default:
-			return;
-
-		// Insert
-		case 1:
-		{
-			std::string T("");
-			i = static_cast<unsigned long>(Rnd() * rules_n);
-			T = rules[i][0];
-
-			unsigned long j = static_cast<unsigned long>(Rnd() * rules_n);
-
-			unsigned long k = (unsigned long)(Rnd() * (k3d::double_t)rules[j].length());
-			k = (k < 2) ? 2 : k;
-			std::string rulet = std::string(rules[j], k);
-			rules[j].replace(k, rulet.length(), '[' + T + ']');
-			rules[j].replace(k, rulet.length(), std::string('[' + T + ']'));
-
-			rules[j] += rulet;
-		}
-		break;
-
-		// Replace
-		case 0:
-		case 2:
-		{
-			std::string R("");
-			std::string T("");
-
-			do
-			{
-				unsigned long i = static_cast<unsigned long>(Rnd() * rules_n);
-				unsigned long j = static_cast<unsigned long>(Rnd() * rules_n);
-				T = rules[i][0];
-				R = rules[j][0];
-			}
-			while(T == R);
-
-			for(unsigned long ii = 0; ii < max; ii++)
-			{
-				i = static_cast<unsigned long>(Rnd() * rules_n);
-				for(unsigned long j = 2; j < (rules[i]).length(); j++)
-				{
-					if(rules[i][j] == T[0])
-					{
-						rules[i][j] = R[0];
-						return;
-					}
-				}
-			}
-		}
-		break;
-
-		// Append
-		case 3:
-		{
-			std::string S("");
-			i = static_cast<unsigned long>(Rnd() * rules_n);
-			S = rules[i][0];
-
-			i = static_cast<unsigned long>(Rnd() * rules_n);
-			rules[i] = S;
-		}
-		break;
-
-		// Swap directions
-		case 4:
-			for(unsigned long ii = 0; ii < max; ii++)
-			{
-				i = static_cast<unsigned long>(Rnd() * rules_n);
-				for(unsigned long j = 2; j < rules[i].size(); j++)
-				{
-					char mutations[12][2] = {
-						{ '+', '-' },
-						{ '-', '+' },
-						{ '&', '^' },
-						{ '^', '&' },
-						{ '>', '<' },
-						{ '<', '>' },
-						{ '|', '%' },
-						{ '%', '|' },
-						{ ':', ';' },
-						{ ';', ':' },
-						{ '\'', '"' },
-						{ '"', '\'' } };
-
-					unsigned long random = (unsigned long)(Rnd() * 12.0);
-
-					if(random > 11)
-						return;
-
-					if(rules[i][j] == mutations[random][0])
-					{
-						rules[i][j] = mutations[random][1];
-						return;
-					}
-				}
-			}
-		break;
-
-		// Swap sizes
-		case 5:
-			for(unsigned long ii = 0; ii < max; ii++)
-			{
-				i = static_cast<unsigned long>(Rnd() * rules_n);
-				for(unsigned long j = 2; j < rules[i].size(); j++)
-				{
-					char mutations[6][2] = {
-						{ 'F', 'Z' },
-						{ 'Z', 'F' },
-						{ 'f', 'z' },
-						{ 'z', 'f' },
-						{ '!', '?' },
-						{ '?', '!' } };
-
-					unsigned long random = (unsigned long)(Rnd() * 6.0);
-
-					if(random > 5)
-						return;
-
-					if(rules[i][j] == mutations[random][0])
-					{
-						rules[i][j] = mutations[random][1];
-						return;
-					}
-				}
-			}
-		break;
-	}
-}
-
-// Expand l-system into production string.
-// object_string is read with the k counter and
-// the next generation is built up in otemp
-void L_system()
-{
-	// Map rule names
-	typedef std::map<char, unsigned long> map_t;
-	map_t S;
-
-	// Each char gets a rule number
-	for(unsigned long i = rules.size(); i > 0; i--)
-		if(rules[i - 1].size())
-			S[(rules[i - 1][0])] = i - 1;
-
-	// For each recursion
-	unsigned long max = max_string - 10L;
-	bool incomplete = false;
-	for(unsigned long l = 0; l < lev; l++)
+	// The lastxxx vars are used to store the previous top of the cylinder
+	// for connecting a next one; since the vars are stacked for [] we can
+	// connect correctly according to current nesting level
+	void add_cylinder(k3d::point3 start, k3d::point3 end, k3d::vector3 up)
 	{
-		// Need markers ?
-		bool marker = (l == (lev - 1)) && (fraction != 0.0);
+		// Check size
+		k3d::vector3 direction = end - start;
+		k3d::double_t length = direction.length();
+		if(length == 0.0)
+			return;
 
-		std::string otemp("");
-		unsigned long ss = 0;
+		k3d::double_t s = length * m_thick;
+		s = std::max(s, m_min_thick);
+		s *= 0.5;
 
-		// For each char in the string
-		for(unsigned long k = 0; k < object_string.size(); k++)
-		{
-			// Default rule which does nothing
-			unsigned long i = rules.size() - 1;
-			// i = rule number attached to current char
-			map_t::const_iterator find_rule = S.find(object_string[k]);
-			if(find_rule != S.end())
-				i = find_rule->second;
-
-			// s = size of current rule
-			unsigned long s = rules[i].size() - 2;
-			ss += s;
-
-			// Overflow
-			if(ss >= max)
-			{
-				l = lev;
-				incomplete = true;
-				break;
+		k3d::vector3 d1 = k3d::normalize(direction);
+		k3d::vector3 d2 = k3d::normalize(up);
 
-			}
+		k3d::vector3 d3 = k3d::normalize(d1 ^ d2);
 
-			// Add mark char
-			if(marker && marks[i])
-			{
-				otemp += '@';
-				otemp += std::string(rules[i], 2, s);
-				otemp += '@';
-			}
-			else
-			{
-				// Copy
-				otemp += std::string(rules[i], 2, s);
-			}
-		}
+		k3d::point3 t1 = k3d::to_point(k3d::normalize(d2 + d3));
+		k3d::point3 t2 = k3d::to_point(k3d::normalize(d2 - d3));
 
-		// Copy the temp string to object_string and repeat cycle
-		object_string = otemp;
-	}
-}
+		vectors_t vertices(8);
 
-// Save mutated ls-system for re-run
-void L_save()
-{
-/*
-	remove("mutation.ls");
-	FILE* f = fopen("mutation.ls", "wt");
-	if(!f)
-		User_error("Cannot open file [mutation.ls]");
+		vertices[0] = start + s * t1;
+		vertices[4] = start + (-s) * t1;
+		vertices[2] = start + s * t2;
+		vertices[6] = start + (-s) * t2;
 
-	fprintf(f, "%d\n", lev);
-	fprintf(f, "%g\n", (ang / 3.141592654) * 180.0);
-	fprintf(f, "%g\n", thick * 100.0);
+		s *= 0.7071;
+		vertices[1] = start + s * t1 + s * t2;
+		vertices[3] = start + (-s) * t1 + s * t2;
+		vertices[5] = start + (-s) * t1 + (-s) * t2;
+		vertices[7] = start + s * t1 + (-s) * t2;
 
-	fprintf(f, "%s\n", object_string.c_str());
+		// Top
+		for(unsigned long i = 0; i < 8; i++)
+			vertices.push_back(vertices[i] + direction);
 
-	for(unsigned long i = 0; i < rules.size(); i++)
+		if(m_last_col == m_col)
 		{
-			if(rules[i][0] == '+')
-				break;
+			direction = start - m_last;
+			length = direction.length();
+			k3d::double_t dd = std::numeric_limits<k3d::double_t>::max();
+
+			// Connect cylinders if near enough
+			if(length < 1.0)
+			{
+				// Find nearest vertex
+				unsigned long ii = 0;
+				for(unsigned long i = 0; i < 8; i++)
+				{
+					direction = vertices[0] - m_last_v[i];
+					length = direction.length();
+					if(length < dd)
+					{
+						dd = length;
+						ii = i;
+					}
+				}
 
-			fprintf(f, "%s\n", rules[i].c_str());
+				for(unsigned long i = 0; i < 8; i++)
+				{
+					vertices[i] = m_last_v[ii];
+					ii = (ii + 1) % 8;
+				}
+			}
 		}
 
-	fprintf(f, "@\n");
-	fclose(f);
-*/
-}
+		// Polygons
+		polygons_t polygons;
+		polygons.push_back(polygon(0, 8, 9, 1));
+		polygons.push_back(polygon(1, 9, 10, 2));
+		polygons.push_back(polygon(2, 10, 11, 3));
+		polygons.push_back(polygon(3, 11, 12, 4));
+		polygons.push_back(polygon(4, 12, 13, 5));
+		polygons.push_back(polygon(5, 13, 14, 6));
+		polygons.push_back(polygon(6, 14, 15, 7));
+		polygons.push_back(polygon(7, 15, 8, 0));
+
+		add_geometry(vertices, polygons);
+
+		// Save cylinder's parameters and top vertices
+		m_last_col = m_col;
+		m_last = end;
+		for(unsigned long i = 0; i < 8; i++)
+			m_last_v[i] = vertices[i + 8];
+	}
 
-// Read a (xx) value from a production string
-// at location j and return it as k3d::double_t
-k3d::double_t parse_value(unsigned long& j)
-{
-	// Skip current character and '('
-	j += 2;
+	void add_segment(const k3d::point3& start, const k3d::point3& end)
+	{
+		if(m_options->instances)
+			add_instance(start, end, m_upp);
+		else if(m_options->closed_form)
+			add_cylinder(start, end, m_upp);
+		else
+			add_cube(start, end, m_upp);
+	}
+
+	const grammar* m_grammar;
+	const options* m_options;
+	geometry* m_output;
+	random_generator m_random;
+
+	// Stacks []
+	std::stack<s_rec> m_stack;
+	/// Number of [] records that were pushed before this branch started
+	unsigned long m_stack_offset;
+
+	k3d::point3 m_pos;
+	k3d::vector3 m_fow;
+	k3d::vector3 m_lef;
+	k3d::vector3 m_upp;
+	k3d::double_t m_dis;
+	k3d::double_t m_dis2;
+	k3d::double_t m_ang;
+	k3d::double_t m_thick;
+	k3d::double_t m_min_thick;
+	k3d::double_t m_tr;
+	k3d::double_t m_trope_amount;
+	k3d::vector3 m_trope;
+	unsigned long m_col;
+
+	k3d::point3 m_last;
+	k3d::point3 m_last_v[8];
+	unsigned long m_last_col;
+
+	// Processing the last recursion step, with saved values
+	bool m_last_recur;
+	k3d::double_t m_thick_l;
+	k3d::double_t m_ang_l;
+	k3d::double_t m_dis_l;
+	k3d::double_t m_dis2_l;
+	k3d::double_t m_trope_l;
+
+	// Polygon stack used for solving {} references
+	bool m_poly_on;
+	vectors_t m_vertices;
+	std::stack<vectors_t> m_pstack;
+
+	k3d::vector3 m_sky;
+};
 
-	std::string val("");
-	while(object_string[j] != ')')
-		val += object_string[j++];
+/// Stores a branch to be drawn by a worker thread
+struct branch_task
+{
+	branch_task(const turtle& State, const branch& Segment) :
+		state(State),
+		segment(Segment)
+	{
+	}
 
-	std::stringstream scan(val);
-	k3d::double_t r = 0.0;
-	scan >> r;
+	turtle state;
+	branch segment;
+	geometry output;
+};
 
-	if(last_recur)
-		return r * fraction;
+/// Draws a batch of branches in parallel
+class branch_worker
+{
+public:
+	branch_worker(const grammar& Grammar, std::vector<branch_task>& Tasks) :
+		m_grammar(Grammar),
+		m_tasks(Tasks)
+	{
+	}
 
-	return r;
-}
+	void operator()(const k3d::parallel::blocked_range<k3d::uint_t>& Range) const
+	{
+		for(k3d::uint_t i = Range.begin(); i != Range.end(); ++i)
+		{
+			branch_task& task = m_tasks[i];
+			production stream(m_grammar, task.segment);
+			task.state.draw(stream, task.output, 0);
+		}
+	}
 
-// Set up a rotation matrix
-k3d::vector3 C1, C2, C3;
+private:
+	const grammar& m_grammar;
+	std::vector<branch_task>& m_tasks;
+};
 
-void set_rotation_matrix(k3d::double_t a, k3d::vector3 n)
+/// Collects independent branches while the main production string is drawn, drawing them in parallel batches and adding
+/// the results to the mesh in production-string order
+class branch_scheduler
 {
-	k3d::double_t cosa = cos(a);
-	k3d::double_t sina = sin(a);
+public:
+	branch_scheduler(const grammar& Grammar, context& Context) :
+		m_grammar(Grammar),
+		m_context(Context)
+	{
+		m_chunks.push_back(geometry());
+	}
 
-	k3d::double_t n11 = n[0] * n[0];
-	k3d::double_t n22 = n[1] * n[1];
-	k3d::double_t n33 = n[2] * n[2];
+	/// Returns the geometry that the main production string is drawn into
+	geometry& current()
+	{
+		return m_chunks.back();
+	}
 
-	k3d::double_t nxy = n[0] * n[1];
-	k3d::double_t nxz = n[0] * n[2];
-	k3d::double_t nyz = n[1] * n[2];
+	/// Schedules a branch for drawing, returning the geometry that the main production string should continue drawing into
+	geometry& split(const turtle& Turtle, const branch& Branch)
+	{
+		m_tasks.push_back(branch_task(Turtle.branch_state(), Branch));
+		m_chunks.push_back(geometry());
 
-	C1[0] = n11 + (1.0 - n11) * cosa;
-	C1[1] = nxy * (1.0 - cosa) - n[2] * sina;
-	C1[2] = nxz * (1.0 - cosa) + n[1] * sina;
+		if(m_tasks.size() >= batch_size)
+			flush();
 
-	C2[0] = nxy * (1.0 - cosa) + n[2] * sina;
-	C2[1] = n22 + (1.0 - n22) * cosa;
-	C2[2] = nyz * (1.0 - cosa) - n[0] * sina;
+		return m_chunks.back();
+	}
 
-	C3[0] = nxz * (1.0 - cosa) - n[1] * sina;
-	C3[1] = nyz * (1.0 - cosa) + n[0] * sina;
-	C3[2] = n33 + (1.0 - n33) * cosa;
-}
+	/// Draws any outstanding branches and adds everything drawn so-far to the mesh
+	void flush()
+	{
+		k3d::parallel::parallel_for(k3d::parallel::blocked_range<k3d::uint_t>(0, m_tasks.size(), 1), branch_worker(m_grammar, m_tasks));
 
-k3d::vector3 rotate(const k3d::vector3& In)
-{
-	return k3d::normalize(k3d::vector3(C1 * In, C2 * In, C3 * In));
-}
+		for(k3d::uint_t i = 0; i != m_tasks.size(); ++i)
+		{
+			m_context.add(m_chunks[i]);
+			m_context.add(m_tasks[i].output);
+		}
+		m_context.add(m_chunks.back());
 
-// Process a production string and generate form
-void L_draw(const context& Context, const k3d::signed_axis Orientation)
-{
-	// Save values
-	k3d::double_t thick_l = 0;
-	k3d::double_t ang_l = 0;
-	k3d::double_t dis_l = 0;
-	k3d::double_t dis2_l = 0;
-	k3d::double_t trope_l = 0;
+		m_tasks.clear();
+		m_chunks.clear();
+		m_chunks.push_back(geometry());
+	}
+
+private:
+	/// Limits the number of branches (and their geometry) that are held in memory at once
+	static const k3d::uint_t batch_size = 256;
 
-	bool poly_on = false;
+	const grammar& m_grammar;
+	context& m_context;
+	std::vector<branch_task> m_tasks;
+	std::deque<geometry> m_chunks;
+};
 
-	// Setup vectors
-	k3d::point3 pos(0.0, 0.0, 0.0);
-	k3d::vector3 fow(0.0, 0.0, 1.0);
-	k3d::vector3 lef(0.0, 1.0, 0.0);
-	k3d::vector3 upp(1.0, 0.0, 0.0);
+void turtle::draw(production& Production, geometry& Output, branch_scheduler* const Scheduler)
+{
+	m_output = &Output;
 
-	trope = k3d::normalize(trope);
+	m_trope = k3d::normalize(m_trope);
 
-	for(unsigned long i = 0; i < object_string.size(); i++)
+	for(char symbol = Production.get(); symbol; symbol = Production.get())
 	{
-		// Overflow
-		if(polcount > poly_limit)
-			break;
+		// Save values
+		s_rec save;
 
-		// The next char in the string
-		char next = object_string[i + 1];
-
-		// The current char in the string
-		switch(object_string[i])
+		switch(symbol)
 		{
 			default:
 				break;
 
 			// Marks last recursion level during growing phase
 			case '@':
-				last_recur = !last_recur;
-				if(last_recur)
+				m_last_recur = !m_last_recur;
+				if(m_last_recur)
 				{
 					// Store all variables and do fraction
-					thick_l = thick;
-					ang_l = ang;
-					dis_l = dis;
-					dis2_l = dis2;
-					trope_l = trope_amount;
-
-					dis *= fraction;
-					dis2 *= fraction;
-					thick *= fraction;
-					ang *= fraction;
-					trope_amount *= fraction;
+					m_thick_l = m_thick;
+					m_ang_l = m_ang;
+					m_dis_l = m_dis;
+					m_dis2_l = m_dis2;
+					m_trope_l = m_trope_amount;
+
+					m_dis *= m_grammar->fraction;
+					m_dis2 *= m_grammar->fraction;
+					m_thick *= m_grammar->fraction;
+					m_ang *= m_grammar->fraction;
+					m_trope_amount *= m_grammar->fraction;
 				}
 				else
 				{
 					// Restore
-					thick = thick_l;
-					ang = ang_l;
-					dis = dis_l;
-					dis2 = dis2_l;
-					trope_amount = trope_l;
+					m_thick = m_thick_l;
+					m_ang = m_ang_l;
+					m_dis = m_dis_l;
+					m_dis2 = m_dis2_l;
+					m_trope_amount = m_trope_l;
 				}
 			break;
 
 			case '+':
-				save.ang = ang;
-				if(next == '(')
+			{
+				save.ang = m_ang;
+				if(Production.peek() == '(')
 				{
-					ang = 0.017453 * parse_value(i);
-					if(last_recur)
-						ang *= fraction;
+					m_ang = 0.017453 * parse_value(Production);
+					if(m_last_recur)
+						m_ang *= m_grammar->fraction;
 				}
 
-				set_rotation_matrix(-ang, upp);
-				fow = rotate(fow);
-				lef = rotate(lef);
-				ang = save.ang;
+				const rotation rotate(-m_ang, m_upp);
+				m_fow = rotate(m_fow);
+				m_lef = rotate(m_lef);
+				m_ang = save.ang;
+			}
 			break;
 
 			case '-':
-				save.ang = ang;
-				if(next == '(')
+			{
+				save.ang = m_ang;
+				if(Production.peek() == '(')
 				{
-					ang = 0.017453 * parse_value(i);
-					if(last_recur)
-						ang *= fraction;
+					m_ang = 0.017453 * parse_value(Production);
+					if(m_last_recur)
+						m_ang *= m_grammar->fraction;
 				}
 
-				set_rotation_matrix(ang, upp);
-				fow = rotate(fow);
-				lef = rotate(lef);
-				ang = save.ang;
+				const rotation rotate(m_ang, m_upp);
+				m_fow = rotate(m_fow);
+				m_lef = rotate(m_lef);
+				m_ang = save.ang;
+			}
 			break;
 
 			case '~':
 			{
 				k3d::double_t r = 6.0;
-				if(next == '(')
-					r = 0.017453 * parse_value(i);
-				else if(rand_set)
-					r = 0.017453 * rand_amount;
-
-				k3d::double_t a = Rnd() * r * 2.0 - r;
-				set_rotation_matrix(a, upp);
-				fow = rotate(fow);
-				lef = rotate(lef);
-				a = (Rnd() * r * 2.0) - r;
-				set_rotation_matrix(a, lef);
-				fow = rotate(fow);
-				upp = rotate(upp);
-				a = (Rnd() * r * 2.0) - r;
-				set_rotation_matrix(a, fow);
-				lef = rotate(lef);
-				upp = rotate(upp);
+				if(Production.peek() == '(')
+					r = 0.017453 * parse_value(Production);
+
+				k3d::double_t a = m_random() * r * 2.0 - r;
+				const rotation rotate1(a, m_upp);
+				m_fow = rotate1(m_fow);
+				m_lef = rotate1(m_lef);
+				a = (m_random() * r * 2.0) - r;
+				const rotation rotate2(a, m_lef);
+				m_fow = rotate2(m_fow);
+				m_upp = rotate2(m_upp);
+				a = (m_random() * r * 2.0) - r;
+				const rotation rotate3(a, m_fow);
+				m_lef = rotate3(m_lef);
+				m_upp = rotate3(m_upp);
 			}
 			break;
 
 			case 't':
 			{
-				if((fow[0] == 0.0) && (fow[1] == 0.0))
+				if((m_fow[0] == 0.0) && (m_fow[1] == 0.0))
 					break;
 
-				save.tr = tr;
-				if(trope_set)
-					tr = trope_amount;
+				save.tr = m_tr;
 
-				if(next == '(')
+				if(Production.peek() == '(')
 				{
-					tr = parse_value(i);
-					if(last_recur)
-						tr *= fraction;
+					m_tr = parse_value(Production);
+					if(m_last_recur)
+						m_tr *= m_grammar->fraction;
 				}
 
-				trope = fow;
-				trope[0] = -trope[0];
-				trope[1] = -trope[1];
-				trope[2] = 0.0;
-				trope = k3d::normalize(trope);
-				k3d::double_t r = tr * (fow * trope);
-				set_rotation_matrix(-r, lef);
-				fow = rotate(fow);
-				upp = rotate(upp);
-				tr = save.tr;
+				m_trope = m_fow;
+				m_trope[0] = -m_trope[0];
+				m_trope[1] = -m_trope[1];
+				m_trope[2] = 0.0;
+				m_trope = k3d::normalize(m_trope);
+				k3d::double_t r = m_tr * (m_fow * m_trope);
+				const rotation rotate(-r, m_lef);
+				m_fow = rotate(m_fow);
+				m_upp = rotate(m_upp);
+				m_tr = save.tr;
 			}
 			break;
 
 			case '$':
 			{
-				k3d::vector3 v = fow - sky;
+				k3d::vector3 v = m_fow - m_sky;
 				if(v.length() == 0.0)
 					break;
 
-				lef = fow ^ sky;
-				upp = fow ^ lef;
-				if(upp[2] < 0.0)
+				m_lef = m_fow ^ m_sky;
+				m_upp = m_fow ^ m_lef;
+				if(m_upp[2] < 0.0)
 				{
-					upp = -upp;
-					lef = -lef;
+					m_upp = -m_upp;
+					m_lef = -m_lef;
 				}
 			}
 			break;
 
 			case '&':
-				save.ang = ang;
-				if(next == '(')
+			{
+				save.ang = m_ang;
+				if(Production.peek() == '(')
 				{
-					ang = 0.017453 * parse_value(i);
-					 if(last_recur)
-					ang *= fraction;
+					m_ang = 0.017453 * parse_value(Production);
+					if(m_last_recur)
+						m_ang *= m_grammar->fraction;
 				}
 
-				set_rotation_matrix(ang, lef);
-				fow = rotate(fow);
-				upp = rotate(upp);
-				ang = save.ang;
+				const rotation rotate(m_ang, m_lef);
+				m_fow = rotate(m_fow);
+				m_upp = rotate(m_upp);
+				m_ang = save.ang;
+			}
 			break;
 
 			case '^':
-				save.ang = ang;
-				if(next == '(')
+			{
+				save.ang = m_ang;
+				if(Production.peek() == '(')
 				{
-					ang = 0.017453 * parse_value(i);
-					if(last_recur)
-						ang *= fraction;
+					m_ang = 0.017453 * parse_value(Production);
+					if(m_last_recur)
+						m_ang *= m_grammar->fraction;
 				}
 
-				set_rotation_matrix(-ang, lef);
-				fow = rotate(fow);
-				upp = rotate(upp);
-				ang = save.ang;
+				const rotation rotate(-m_ang, m_lef);
+				m_fow = rotate(m_fow);
+				m_upp = rotate(m_upp);
+				m_ang = save.ang;
+			}
 			break;
 
 			case '<':
-				save.ang = ang;
-				if(next == '(')
+			{
+				save.ang = m_ang;
+				if(Production.peek() == '(')
 				{
-					ang = 0.017453 * parse_value(i);
-					if(last_recur)
-						ang *= fraction;
+					m_ang = 0.017453 * parse_value(Production);
+					if(m_last_recur)
+						m_ang *= m_grammar->fraction;
 				}
 
-				set_rotation_matrix(-ang, fow);
-				lef = rotate(lef);
-				upp = rotate(upp);
-				ang = save.ang;
+				const rotation rotate(-m_ang, m_fow);
+				m_lef = rotate(m_lef);
+				m_upp = rotate(m_upp);
+				m_ang = save.ang;
+			}
 			break;
 
 			case '>':
-				save.ang = ang;
-				if(next == '(')
+			{
+				save.ang = m_ang;
+				if(Production.peek() == '(')
 				{
-					ang = 0.017453 * parse_value(i);
-					if(last_recur)
-						ang *= fraction;
+					m_ang = 0.017453 * parse_value(Production);
+					if(m_last_recur)
+						m_ang *= m_grammar->fraction;
 				}
 
-				set_rotation_matrix(ang, fow);
-				lef = rotate(lef);
-				upp = rotate(upp);
-				ang = save.ang;
+				const rotation rotate(m_ang, m_fow);
+				m_lef = rotate(m_lef);
+				m_upp = rotate(m_upp);
+				m_ang = save.ang;
+			}
 			break;
 
 			case '%':
-				set_rotation_matrix(3.141592654, fow);
-				lef = rotate(lef);
-				upp = rotate(upp);
+			{
+				const rotation rotate(3.141592654, m_fow);
+				m_lef = rotate(m_lef);
+				m_upp = rotate(m_upp);
+			}
 			break;
 
 			case '|':
-				set_rotation_matrix(3.141592654, upp);
-				fow = rotate(fow);
-				lef = rotate(lef);
+			{
+				const rotation rotate(3.141592654, m_upp);
+				m_fow = rotate(m_fow);
+				m_lef = rotate(m_lef);
+			}
 			break;
 
 			case '!':
-				if(next == '(')
+				if(Production.peek() == '(')
 				{
-					if(last_recur)
-						thick *= 1.0 + fraction * (parse_value(i) - 1.0);
+					if(m_last_recur)
+						m_thick *= 1.0 + m_grammar->fraction * (parse_value(Production) - 1.0);
 					else
-						thick *= parse_value(i);
+						m_thick *= parse_value(Production);
 				}
 				else
 				{
-					if(last_recur)
-						thick *= 1.0 + fraction * (0.7 - 1.0);
+					if(m_last_recur)
+						m_thick *= 1.0 + m_grammar->fraction * (0.7 - 1.0);
 					else
-						thick *= 0.7;
+						m_thick *= 0.7;
 				}
 			break;
 
 			case '?':
-				if(next == '(')
+				if(Production.peek() == '(')
 				{
-					if(last_recur)
-						thick *= 1.0 + fraction * (parse_value(i) - 1.0);
+					if(m_last_recur)
+						m_thick *= 1.0 + m_grammar->fraction * (parse_value(Production) - 1.0);
 					else
-						thick *= parse_value(i);
+						m_thick *= parse_value(Production);
 				}
 				else
 				{
-					if(last_recur)
-						thick /= 1.0 + fraction * (0.7 - 1.0);
+					if(m_last_recur)
+						m_thick /= 1.0 + m_grammar->fraction * (0.7 - 1.0);
 					else
-						thick /= 0.7;
+						m_thick /= 0.7;
 				}
 			break;
 
 			case ':':
-				if(next == '(')
+				if(Production.peek() == '(')
 				{
-					if(last_recur)
-						ang *= 1.0 + fraction * (parse_value(i) - 1.0);
+					if(m_last_recur)
+						m_ang *= 1.0 + m_grammar->fraction * (parse_value(Production) - 1.0);
 					else
-						ang *= parse_value(i);
+						m_ang *= parse_value(Production);
 				}
 				else
 				{
-					if(last_recur)
-						ang *= 1.0 + fraction * (0.9 - 1.0);
+					if(m_last_recur)
+						m_ang *= 1.0 + m_grammar->fraction * (0.9 - 1.0);
 					else
-						ang *= 0.9;
+						m_ang *= 0.9;
 				}
 			break;
 
 			case ';':
-				if(next == '(')
+				if(Production.peek() == '(')
 				{
-					if(last_recur)
-						ang *= 1.0 + fraction * (parse_value(i) - 1.0);
+					if(m_last_recur)
+						m_ang *= 1.0 + m_grammar->fraction * (parse_value(Production) - 1.0);
 					else
-						ang *= parse_value(i);
+						m_ang *= parse_value(Production);
 				}
 				else
 				{
-					if(last_recur)
-						ang /= 1.0 + fraction * (0.9 - 1.0);
+					if(m_last_recur)
+						m_ang /= 1.0 + m_grammar->fraction * (0.9 - 1.0);
 					else
-						ang /= 0.9;
+						m_ang /= 0.9;
 				}
 			break;
 
 			case '\'':
-				if(next == '(')
+				if(Production.peek() == '(')
 				{
-					k3d::double_t r = parse_value(i);
-					if(last_recur)
+					k3d::double_t r = parse_value(Production);
+					if(m_last_recur)
 					{
-						dis *= 1.0 + fraction * (r - 1.0);
-						dis2 *= 1.0 + fraction * (r - 1.0);
+						m_dis *= 1.0 + m_grammar->fraction * (r - 1.0);
+						m_dis2 *= 1.0 + m_grammar->fraction * (r - 1.0);
 					}
 					else
 					{
-						dis *= r;
-						dis2 *= r;
+						m_dis *= r;
+						m_dis2 *= r;
 					}
 				}
 				else
 				{
-					if(last_recur)
+					if(m_last_recur)
 					{
-						dis *= 1.0 + fraction * (0.9 - 1.0);
-						dis2 *= 1.0 + fraction * (0.9 - 1.0);
+						m_dis *= 1.0 + m_grammar->fraction * (0.9 - 1.0);
+						m_dis2 *= 1.0 + m_grammar->fraction * (0.9 - 1.0);
 					}
 					else
 					{
-						dis *= 0.9;
-						dis2 *= 0.9;
+						m_dis *= 0.9;
+						m_dis2 *= 0.9;
 					}
 				}
 			break;
 
 			case '"':
-				if(next == '(')
+				if(Production.peek() == '(')
 				{
-					k3d::double_t r = parse_value(i);
-					if(last_recur)
+					k3d::double_t r = parse_value(Production);
+					if(m_last_recur)
 					{
-						dis *= 1.0 + fraction * (r - 1.0);
-						dis2 *= 1.0 + fraction * (r - 1.0);
+						m_dis *= 1.0 + m_grammar->fraction * (r - 1.0);
+						m_dis2 *= 1.0 + m_grammar->fraction * (r - 1.0);
 					}
 					else
 					{
-						dis *= r;
-						dis2 *= r;
+						m_dis *= r;
+						m_dis2 *= r;
 					}
 				}
 				else
 				{
-					if(last_recur)
+					if(m_last_recur)
 					{
-						dis /= 1.0 + fraction * (0.9 - 1.0);
-						dis2 /= 1.0 + fraction * (0.9 - 1.0);
+						m_dis /= 1.0 + m_grammar->fraction * (0.9 - 1.0);
+						m_dis2 /= 1.0 + m_grammar->fraction * (0.9 - 1.0);
 					}
 					else
 					{
-						dis /= 0.9;
-						dis2 /= 0.9;
+						m_dis /= 0.9;
+						m_dis2 /= 0.9;
 					}
 				}
 			break;
 
-			case 'Z':
-			{
-				save.dis2 = dis2;
-				if(next == '(')
-				{
-					dis2 = parse_value(i);
-					if(last_recur)
-						dis2 *= fraction;
-				}
+			case 'Z':
+			{
+				save.dis2 = m_dis2;
+				if(Production.peek() == '(')
+				{
+					m_dis2 = parse_value(Production);
+					if(m_last_recur)
+						m_dis2 *= m_grammar->fraction;
+				}
+
+				k3d::point3 end = m_pos + m_dis2 * m_fow;
+				add_segment(m_pos, end);
+
+				m_pos = end;
+				m_dis2 = save.dis2;
+			}
+			break;
+
+			case 'F':
+			{
+				save.dis = m_dis;
+				if(Production.peek() == '(')
+				{
+					m_dis = parse_value(Production);
+					if(m_last_recur)
+						m_dis *= m_grammar->fraction;
+				}
+
+				k3d::point3 end = m_pos + m_dis * m_fow;
+				add_segment(m_pos, end);
+
+				m_pos = end;
+				m_dis = save.dis;
+			}
+			break;
+
+			case '[':
+			{
+				// Hand self-contained branches to the scheduler, which continues from the matching ']' ...
+				branch segment;
+				if(Scheduler && !m_poly_on && m_stack.size() + m_stack_offset < m_options->max_stack_size && Production.split(segment))
+				{
+					m_output = &Scheduler->split(*this, segment);
+					break;
+				}
+
+				if(m_stack.size() + m_stack_offset < m_options->max_stack_size)
+					m_stack.push(save_state());
+			}
+			break;
+
+			case ']':
+			{
+				if(!m_stack.size())
+					break;
+
+				restore_state(m_stack.top());
+				m_stack.pop();
+			}
+			break;
+
+			case '{':
+				if(m_poly_on)
+				{
+					if(m_pstack.size() < m_options->max_stack_size)
+						m_pstack.push(m_vertices);
+				}
+
+				m_poly_on = true;
+
+				m_vertices.clear();
+				m_vertices.push_back(m_pos);
+			break;
+
+			case 'f':
+				save.dis = m_dis;
+				if(Production.peek() == '(')
+				{
+					m_dis = parse_value(Production);
+					if(m_last_recur)
+						m_dis *= m_grammar->fraction;
+				}
+
+				m_pos = m_pos + m_dis * m_fow;
+				if(m_poly_on)
+					m_vertices.push_back(m_pos);
+
+				m_dis = save.dis;
+			break;
+
+			case '.':
+				if(m_poly_on)
+					m_vertices.push_back(m_pos);
+			break;
+
+			case 'g':
+				save.dis = m_dis;
+				if(Production.peek() == '(')
+				{
+					m_dis = parse_value(Production);
+					if(m_last_recur)
+						m_dis *= m_grammar->fraction;
+				}
+
+				m_pos = m_pos + m_dis * m_fow;
+				m_dis = save.dis;
+			break;
+
+			case 'z':
+				save.dis2 = m_dis2;
+				if(Production.peek() == '(')
+				{
+					m_dis2 = parse_value(Production);
+					if(m_last_recur)
+						m_dis2 *= m_grammar->fraction;
+				}
+
+				m_pos = m_pos + m_dis2 * m_fow;
+				if(m_poly_on)
+					m_vertices.push_back(m_pos);
+
+				m_dis2 = save.dis2;
+			break;
+
+			case '}':
+			{
+				if(m_vertices.size() > 3)
+				{
+					polygons_t polygons;
+					for(unsigned long j = 1; j < m_vertices.size() - 1; j++)
+						polygons.push_back(polygon(0, j, j + 1, j + 1));
+
+					add_geometry(m_vertices, polygons);
+				}
+
+				m_poly_on = false;
+				if(m_pstack.size() > 0)
+				{
+					m_vertices = m_pstack.top();
+					m_pstack.pop();
+
+					m_poly_on = true;
+				}
+			}
+			break;
+
+			case 'c':
+				if(Production.peek() == '(')
+					m_col = (unsigned long)parse_value(Production);
+				else
+					m_col++;
+			break;
+		}
+	}
+}
+
+// L-system routines ------------------------------------------------------
+
+// Get a line from a .ls file;
+// skips comments (lines beginning with '#') and empty lines
+bool ls_line(std::istream& file, std::string& linebuffer)
+{
+	while(!file.eof())
+	{
+		k3d::getline(file, linebuffer);
+
+		// Skip comments ...
+		if(linebuffer[0] == '#')
+			continue;
+
+		// Skip blank lines
+		if(!(k3d::trim(linebuffer)).size())
+			continue;
+
+		// Must qualify
+		return true;
+	}
+
+	// end-of-file reached
+	return false;
+}
+
+// Returns the first token in a line, ignoring trailing comments
+const std::string first_token(const std::string& Line)
+{
+	static const char delimiters[] = " \r\n\t#";
+
+	const std::string::size_type begin = Line.find_first_not_of(delimiters);
+	if(begin == std::string::npos)
+		return std::string();
+
+	const std::string::size_type end = Line.find_first_of(delimiters, begin);
+	return Line.substr(begin, end == std::string::npos ? std::string::npos : end - begin);
+}
+
+bool load_configuration_values(const k3d::filesystem::path& file_path, k3d::double_t& recursion, k3d::double_t& basic_angle, k3d::double_t& thickness)
+{
+	// Open configuration file
+	k3d::filesystem::ifstream file(file_path);
+	if(!file.good())
+	{
+		k3d::log() << error << k3d_file_reference << ": error opening [" << file_path.native_console_string() << "]" << std::endl;
+		return 0.0;
+	}
+
+	// Get recursion level
+	std::string temp;
+	return_val_if_fail(ls_line(file, temp), false);
+	std::stringstream scan(temp);
+	scan >> recursion;
+
+	// Get asic angle
+	return_val_if_fail(ls_line(file, temp), false);
+	std::stringstream scan2(temp);
+	scan2 >> basic_angle;
+
+	// Get thickness
+	return_val_if_fail(ls_line(file, temp), false);
+	std::stringstream scan3(temp);
+	scan3 >> thickness;
+
+	return true;
+}
+
+// Process a ls file and setup rules
+bool load_configuration_rules(const k3d::double_t recursion, const k3d::double_t basic_angle, const k3d::double_t thickness, const k3d::filesystem::path& file_path, grammar& Grammar)
+{
+	// Open grammar file
+	k3d::filesystem::ifstream file(file_path);
+	if(!file.good())
+	{
+		k3d::log() << error << k3d_file_reference << ": error opening [" << file_path.native_console_string() << "]" << std::endl;
+		return false;
+	}
+
+	// Skip but setup recursion level, basic angle and thickness
+	std::string temp;
+	return_val_if_fail(ls_line(file, temp), false);
+
+	Grammar.lev = (unsigned long)std::floor(recursion);
+	Grammar.fraction = recursion - (k3d::double_t)Grammar.lev;
+	if(Grammar.fraction > 0)
+		Grammar.lev++;
+
+	return_val_if_fail(ls_line(file, temp), false);
+	Grammar.ang = basic_angle / 180 * 3.141592654;
+
+	return_val_if_fail(ls_line(file, temp), false);
+	Grammar.thick = thickness / 100;
+
+	// Axiom
+	return_val_if_fail(ls_line(file, temp), false);
+
+	Grammar.axiom = first_token(temp);
+
+	// Get rules
+	std::vector<std::string>& rules = Grammar.rules;
+	rules.clear();
+	for(unsigned long i = 0; i < 150; i++)
+	{
+		return_val_if_fail(ls_line(file, temp), false);
+
+		std::string rule = first_token(temp);
 
-				k3d::point3 end = pos + dis2 * fow;
-				if(closed_form)
-					add_cylinder(pos, end, upp, col, Context, Orientation);
-				else
-					add_cube(pos, end, upp, col, Context, Orientation);
+		if(!rule.size())
+			continue;
 
-				pos = end;
-				dis2 = save.dis2;
-			}
+		if(rule[0] == '@')
 			break;
 
-			case 'F':
-			{
-				save.dis = dis;
-				if(next == '(')
-				{
-					dis = parse_value(i);
-					if(last_recur)
-						dis *= fraction;
-				}
+		rules.push_back(rule);
+	}
 
-				k3d::point3 end = pos + dis * fow;
-				if(closed_form)
-					add_cylinder(pos, end, upp, col, Context, Orientation);
-				else
-					add_cube(pos, end, upp, col, Context, Orientation);
+	// Add default rules
+	rules.push_back("+=+");
+	rules.push_back("-=-");
+	rules.push_back("&=&");
+	rules.push_back("^=^");
+	rules.push_back("<=<");
+	rules.push_back(">=>");
 
-				pos = end;
-				dis = save.dis;
-			}
-			break;
+	rules.push_back("%=%");
+	rules.push_back("|=|");
+	rules.push_back("!=!");
+	rules.push_back("?=?");
+	rules.push_back(":=:");
+	rules.push_back(";=;");
+	rules.push_back("\'=\'");
+	rules.push_back("\"=\"");
+	rules.push_back("c=c");
 
-			case '[':
-			{
-				s_rec new_rec;
-				new_rec.pos = pos;
-				new_rec.fow = fow;
-				new_rec.lef = lef;
-				new_rec.upp = upp;
-				new_rec.col = col;
-				new_rec.dis = dis;
-				new_rec.dis2 = dis2;
-				new_rec.ang = ang;
-				new_rec.thick = thick;
-				new_rec.tr = tr;
-
-				if(closed_form)
-				{
-					new_rec.last = last;
-					new_rec.last_col = last_col;
-					for(unsigned long j = 0; j < 8; j++)
-						new_rec.last_v[j] = last_v[j];
-				}
+	rules.push_back("[=[");
+	rules.push_back("]=]");
+	rules.push_back("{={");
+	rules.push_back("}=}");
 
-				if(stack.size() < max_stack_size)
-					stack.push(new_rec);
-			}
-			break;
+	rules.push_back("F=F");
+	rules.push_back("f=f");
+	rules.push_back("t=t");
+	rules.push_back("g=g");
+	rules.push_back("Z=Z");
+	rules.push_back("z=z");
+	rules.push_back("*=*");
+	rules.push_back("$=$");
+	rules.push_back("~=~");
 
-			case ']':
-			{
-				if(!stack.size())
-					break;
+	rules.push_back(".=.");
+	rules.push_back("1=1");
+	rules.push_back("2=2");
+	rules.push_back("3=3");
+	rules.push_back("4=4");
+	rules.push_back("5=5");
+	rules.push_back("6=6");
+	rules.push_back("7=7");
+	rules.push_back("8=8");
+	rules.push_back("9=9");
+	rules.push_back("0=0");
+	rules.push_back("(=(");
+	rules.push_back(")=)");
 
-				s_rec old_rec = stack.top();
-				pos = old_rec.pos;
-				fow = old_rec.fow;
-				lef = old_rec.lef;
-				upp = old_rec.upp;
-				col = old_rec.col;
-				dis = old_rec.dis;
-				dis2 = old_rec.dis2;
-				ang = old_rec.ang;
-				thick = old_rec.thick;
-				tr = old_rec.tr;
-				if(closed_form)
-				{
-					last = old_rec.last;
-					last_col = old_rec.last_col;
-					for(unsigned long j = 0; j < 8; j++)
-						last_v[j] = old_rec.last_v[j];
-				}
+	// Closer default
+	rules.push_back("_=_");
 
-				stack.pop();
-			}
+	// Get marks
+	std::vector<bool>& marks = Grammar.marks;
+	marks.assign(rules.size(), false);
+
+	// Check which rules need to be marked for last recursion when growing
+	for(unsigned long n = 0; n < rules.size(); n++)
+	{
+		if(rules[n][0] == '+')
 			break;
 
-			case '{':
-				if(poly_on)
-				{
-					vectors_t new_rec = vertices;
-					if(pstack.size() < max_stack_size)
-						pstack.push(new_rec);
-				}
+		marks[n] = true;
+
+		// All rules with basic move/block before '=' mark false
+		if(rules[n][0] == 'F')
+			marks[n] = false;
+		if(rules[n][0] == 'f')
+			marks[n] = false;
+		if(rules[n][0] == 'Z')
+			marks[n] = false;
+		if(rules[n][0] == 'z')
+			marks[n] = false;
+	}
 
-				poly_on = true;
+	return true;
+}
 
-				vertices.clear();
-				vertices.push_back(pos);
+// Apply mutations to the rules
+void L_mutate(std::vector<std::string>& rules, random_generator& Rnd)
+{
+	unsigned long n;
+	for(n = 0; n < rules.size(); n++)
+		if(rules[n][0] == '+')
 			break;
 
-			case 'f':
-				save.dis = dis;
-				if(next == '(')
-				{
-					dis = parse_value(i);
-					if(last_recur)
-						dis *= fraction;
-				}
+	k3d::double_t rules_n = static_cast<k3d::double_t>(n);
+	const unsigned long max = 1000;
 
-				pos = pos + dis * fow;
-				if(poly_on)
-					vertices.push_back(pos);
+	unsigned long i = static_cast<unsigned long>(Rnd() * 6.0);
+	switch(i)
+	{
+		default:
+			return;
 
-				dis = save.dis;
-			break;
+		// Insert
+		case 1:
+		{
+			std::string T("");
+			i = static_cast<unsigned long>(Rnd() * rules_n);
+			T = rules[i][0];
 
-			case '.':
-				if(poly_on)
-					vertices.push_back(pos);
-			break;
+			unsigned long j = static_cast<unsigned long>(Rnd() * rules_n);
 
-			case 'g':
-				save.dis = dis;
-				if(next == '(')
-				{
-					dis = parse_value(i);
-					if(last_recur)
-						dis *= fraction;
-				}
+			unsigned long k = (unsigned long)(Rnd() * (k3d::double_t)rules[j].length());
+			k = (k < 2) ? 2 : k;
+			std::string rulet = std::string(rules[j], k);
+			rules[j].replace(k, rulet.length(), '[' + T + ']');
+			rules[j].replace(k, rulet.length(), std::string('[' + T + ']'));
 
-				pos = pos + dis * fow;
-				dis = save.dis;
-			break;
+			rules[j] += rulet;
+		}
+		break;
 
-			case 'z':
-				save.dis2 = dis2;
-				if(next == '(')
+		// Replace
+		case 0:
+		case 2:
+		{
+			std::string R("");
+			std::string T("");
+
+			do
+			{
+				unsigned long i = static_cast<unsigned long>(Rnd() * rules_n);
+				unsigned long j = static_cast<unsigned long>(Rnd() * rules_n);
+				T = rules[i][0];
+				R = rules[j][0];
+			}
+			while(T == R);
+
+			for(unsigned long ii = 0; ii < max; ii++)
+			{
+				i = static_cast<unsigned long>(Rnd() * rules_n);
+				for(unsigned long j = 2; j < (rules[i]).length(); j++)
 				{
-					dis2 = parse_value(i);
-					if(last_recur)
-						dis2 *= fraction;
+					if(rules[i][j] == T[0])
+					{
+						rules[i][j] = R[0];
+						return;
+					}
 				}
+			}
+		}
+		break;
 
-				pos = pos + dis2 * fow;
-				if(poly_on)
-					vertices.push_back(pos);
+		// Append
+		case 3:
+		{
+			std::string S("");
+			i = static_cast<unsigned long>(Rnd() * rules_n);
+			S = rules[i][0];
 
-				dis2 = save.dis2;
-			break;
+			i = static_cast<unsigned long>(Rnd() * rules_n);
+			rules[i] = S;
+		}
+		break;
 
-			case '}':
-				polygons.clear();
-				if(vertices.size() > 3)
+		// Swap directions
+		case 4:
+			for(unsigned long ii = 0; ii < max; ii++)
+			{
+				i = static_cast<unsigned long>(Rnd() * rules_n);
+				for(unsigned long j = 2; j < rules[i].size(); j++)
 				{
-					for(unsigned long j = 1; j < vertices.size() - 1; j++)
-						polygons.push_back(polygon(0, j, j + 1, j + 1));
+					char mutations[12][2] = {
+						{ '+', '-' },
+						{ '-', '+' },
+						{ '&', '^' },
+						{ '^', '&' },
+						{ '>', '<' },
+						{ '<', '>' },
+						{ '|', '%' },
+						{ '%', '|' },
+						{ ':', ';' },
+						{ ';', ':' },
+						{ '\'', '"' },
+						{ '"', '\'' } };
+
+					unsigned long random = (unsigned long)(Rnd() * 12.0);
+
+					if(random > 11)
+						return;
 
-					add_geometry(col, Context);
+					if(rules[i][j] == mutations[random][0])
+					{
+						rules[i][j] = mutations[random][1];
+						return;
+					}
 				}
+			}
+		break;
 
-				poly_on = false;
-				if(pstack.size() > 0)
+		// Swap sizes
+		case 5:
+			for(unsigned long ii = 0; ii < max; ii++)
+			{
+				i = static_cast<unsigned long>(Rnd() * rules_n);
+				for(unsigned long j = 2; j < rules[i].size(); j++)
 				{
-					vertices.clear();
+					char mutations[6][2] = {
+						{ 'F', 'Z' },
+						{ 'Z', 'F' },
+						{ 'f', 'z' },
+						{ 'z', 'f' },
+						{ '!', '?' },
+						{ '?', '!' } };
 
-					if(!pstack.size())
-						break;
+					unsigned long random = (unsigned long)(Rnd() * 6.0);
 
-					vertices = pstack.top();
-					pstack.pop();
+					if(random > 5)
+						return;
 
-					poly_on = true;
+					if(rules[i][j] == mutations[random][0])
+					{
+						rules[i][j] = mutations[random][1];
+						return;
+					}
 				}
-			break;
-
-			case 'c':
-				if(next == '(')
-					col = (unsigned long)parse_value(i);
-				else
-					col++;
-			break;
-		}
+			}
+		break;
 	}
 }
 
-bool l_parser(const unsigned long RandomSeed, const bool ClosedForm, const k3d::double_t Trope, const unsigned long Mutations, const unsigned long MutationSeed, const unsigned long MaximalStackSize, const context& Context, const k3d::signed_axis Orientation, const bool FlipNormals)
+/// Expands an L-system and draws its production string, optionally drawing independent branches in parallel
+void l_parser(grammar& Grammar, const unsigned long Mutations, const unsigned long MutationSeed, const unsigned long MaximalString, const options& Options, const bool Parallel, context& Context)
 {
-	// set minimum thickness
-	//min_thick = ;
-
-	// set amount of trope
-	trope_amount = Trope;
-
-	// create closed connected cylinders
-	closed_form = ClosedForm;
-
-	// Save face orientation variables
-	orientation = Orientation;
-	flip_normals = FlipNormals;
-
 	// Execute mutations
-	srand(MutationSeed);
+	random_generator mutation_random(MutationSeed);
 	for(unsigned long i = 0; i < Mutations; i++)
 		// Perform mutations on stored rule set
-		L_mutate();
+		L_mutate(Grammar.rules, mutation_random);
 
-	// Create L-system production string
-	L_system();
+	if(!Grammar.compile(MaximalString))
+		k3d::log() << warning << "LSystemParser stopped growing at level " << Grammar.lev << " because the production string would exceed " << MaximalString << " symbols" << std::endl;
 
 	// Parse production string and create geometry
-	srand(RandomSeed);
-	max_stack_size = MaximalStackSize;
-	L_draw(Context, Orientation);
-
-	return true;
+	production stream(Grammar);
+	turtle state(Grammar, Options);
+	if(Parallel)
+	{
+		branch_scheduler scheduler(Grammar, Context);
+		state.draw(stream, scheduler.current(), &scheduler);
+		scheduler.flush();
+	}
+	else
+	{
+		geometry output;
+		state.draw(stream, output, 0);
+		Context.add(output);
+	}
 }
 
 } // namespace lparser
@@ -1610,8 +2089,14 @@ public:
 		m_mutations(init_owner(*this) + init_name("mutations") + init_label(_("Mutations")) + init_description(_("Mutations")) + init_value(0) + init_step_increment(1) + init_units(typeid(k3d::measurement::scalar))),
 		m_mutation_seed(init_owner(*this) + init_name("mutation_seed") + init_label(_("Mutation seed")) + init_description(_("Mutation seed")) + init_value(0) + init_step_increment(1) + init_units(typeid(k3d::measurement::scalar))),
 		m_max_stack_size(init_owner(*this) + init_name("max_stack_size") + init_label(_("Max stack size")) + init_description(_("Max stack size")) + init_value(1000) + init_step_increment(1) + init_units(typeid(k3d::measurement::scalar))),
+		m_max_string(init_owner(*this) + init_name("max_string") + init_label(_("Max string")) + init_description(_("Maximum length of the production string.  Growth stops at the last level that fits, bounding time and memory.")) + init_value(static_cast<k3d::int32_t>(lparser::max_string)) + init_step_increment(1024) + init_constraint(constraint::minimum<k3d::int32_t>(1)) + init_units(typeid(k3d::measurement::scalar))),
 		m_orientation(init_owner(*this) + init_name("orientation") + init_label(_("Orientation")) + init_description(_("Orientation type (forward or backward along X, Y or Z axis)")) + init_value(k3d::PZ) + init_enumeration(k3d::signed_axis_values())),
-		m_flip_normals(init_owner(*this) + init_name("flip_normals") + init_label(_("Flip normals")) + init_description(_("Flip normals in case the faces are reversed")) + init_value(false))
+		m_flip_normals(init_owner(*this) + init_name("flip_normals") + init_label(_("Flip normals")) + init_description(_("Flip normals in case the faces are reversed")) + init_value(false)),
+		m_instances(init_owner(*this) + init_name("instances") + init_label(_("Instances")) + init_description(_("Emit segments as instanced cylinders instead of polygons")) + init_value(false)),
+		m_parallel(init_owner(*this) + init_name("parallel") + init_label(_("Parallel")) + init_description(_("Draw independent branches in parallel (the output is the same either way)")) + init_value(true)),
+		m_bbox_x(0),
+		m_bbox_y(0),
+		m_bbox_z(0)
 	{
 		m_file_path.changed_signal().connect(sigc::mem_fun(*this, &l_parser::on_new_file));
 
@@ -1635,10 +2120,16 @@ public:
 			k3d::hint::convert<k3d::hint::any, k3d::hint::none> >(make_update_mesh_slot()));
 		m_max_stack_size.changed_signal().connect(k3d::hint::converter<
 			k3d::hint::convert<k3d::hint::any, k3d::hint::none> >(make_update_mesh_slot()));
+		m_max_string.changed_signal().connect(k3d::hint::converter<
+			k3d::hint::convert<k3d::hint::any, k3d::hint::none> >(make_update_mesh_slot()));
 		m_orientation.changed_signal().connect(k3d::hint::converter<
 			k3d::hint::convert<k3d::hint::any, k3d::hint::none> >(make_update_mesh_slot()));
 		m_flip_normals.changed_signal().connect(k3d::hint::converter<
 			k3d::hint::convert<k3d::hint::any, k3d::hint::none> >(make_update_mesh_slot()));
+		m_instances.changed_signal().connect(k3d::hint::converter<
+			k3d::hint::convert<k3d::hint::any, k3d::hint::none> >(make_update_mesh_slot()));
+		m_parallel.changed_signal().connect(k3d::hint::converter<
+			k3d::hint::convert<k3d::hint::any, k3d::hint::none> >(make_update_mesh_slot()));
 
 		// Init with default example
 		init_lsystem();
@@ -1658,8 +2149,7 @@ public:
 		k3d::property::set_internal_value(m_thickness, thickness);
 
 		// Reset bounding box
-		lparser::bounding_box = k3d::bounding_box3();
-		lparser::bbox_x = lparser::bbox_y = lparser::bbox_z = 0;
+		m_bbox_x = m_bbox_y = m_bbox_z = 0;
 	}
 
 	void on_new_file(k3d::iunknown*)
@@ -1681,32 +2171,39 @@ public:
 		const unsigned long mutations = m_mutations.pipeline_value();
 		const unsigned long mutation_seed = m_mutation_seed.pipeline_value();
 		const unsigned long max_stack_size = m_max_stack_size.pipeline_value();
+		const unsigned long max_string = m_max_string.pipeline_value();
+		const bool instances = m_instances.pipeline_value();
+		const bool parallel = m_parallel.pipeline_value();
 		k3d::imaterial* const material = m_material.pipeline_value();
 
 		// Load configuration file
 		const k3d::filesystem::path file_path = m_file_path.pipeline_value();
-		if(!lparser::load_configuration_rules(recursion, basic_angle, thickness, file_path))
+		lparser::grammar grammar;
+		if(!lparser::load_configuration_rules(recursion, basic_angle, thickness, file_path, grammar))
 			return;
 
 		// Create geometry ...
 		k3d::mesh::points_t& points = Output.points.create();
 		k3d::mesh::selection_t& point_selection = Output.point_selection.create();
 		boost::scoped_ptr<k3d::polyhedron::primitive> polyhedron(k3d::polyhedron::create(Output));
+		boost::scoped_ptr<k3d::cylinder::primitive> cylinders(instances ? k3d::cylinder::create(Output) : 0);
 
-		lparser::l_parser(random_seed, closed_form, 0, mutations, mutation_seed, max_stack_size, lparser::context(points, point_selection, *polyhedron, material), m_orientation.pipeline_value(), m_flip_normals.pipeline_value());
+		const lparser::options options(closed_form, 0, max_stack_size, m_orientation.pipeline_value(), m_flip_normals.pipeline_value(), instances, random_seed);
+		lparser::context context(points, point_selection, *polyhedron, cylinders.get(), material);
+		lparser::l_parser(grammar, mutations, mutation_seed, max_string, options, parallel, context);
 
 		polyhedron->shell_types.push_back(k3d::polyhedron::POLYGONS);
 
 		// Cache first bounding box to allow growth
-		if(lparser::bbox_x == 0 && lparser::bbox_y == 0 && lparser::bbox_z == 0)
+		if(m_bbox_x == 0 && m_bbox_y == 0 && m_bbox_z == 0 && !context.bounds.empty())
 		{
-			lparser::bbox_x = lparser::bounding_box.width();
-			lparser::bbox_y = lparser::bounding_box.height();
-			lparser::bbox_z = lparser::bounding_box.depth();
+			m_bbox_x = context.bounds.width();
+			m_bbox_y = context.bounds.height();
+			m_bbox_z = context.bounds.depth();
 		}
 
 		// Resize ...
-		k3d::double_t bbox_size = std::max(std::max(lparser::bbox_x, lparser::bbox_y), lparser::bbox_z);
+		k3d::double_t bbox_size = std::max(std::max(m_bbox_x, m_bbox_y), m_bbox_z);
 		if(bbox_size > 0)
 		{
 			k3d::double_t new_size = 1 / bbox_size * size;
@@ -1715,6 +2212,15 @@ public:
 			const k3d::uint_t point_end = point_begin + points.size();
 			for(k3d::uint_t point = point_begin; point != point_end; ++point)
 				points[point] *= new_size;
+
+			if(cylinders)
+			{
+				const k3d::matrix4 scale = k3d::scale3(new_size);
+				const k3d::uint_t cylinder_begin = 0;
+				const k3d::uint_t cylinder_end = cylinder_begin + cylinders->matrices.size();
+				for(k3d::uint_t cylinder = cylinder_begin; cylinder != cylinder_end; ++cylinder)
+					cylinders->matrices[cylinder] = scale * cylinders->matrices[cylinder];
+			}
 		}
 	}
 
@@ -1745,8 +2251,16 @@ private:
 	k3d_data(k3d::int32_t, immutable_name, change_signal, with_undo, local_storage, no_constraint, measurement_property, with_serialization) m_mutations;
 	k3d_data(k3d::int32_t, immutable_name, change_signal, with_undo, local_storage, no_constraint, measurement_property, with_serialization) m_mutation_seed;
 	k3d_data(k3d::int32_t, immutable_name, change_signal, with_undo, local_storage, no_constraint, measurement_property, with_serialization) m_max_stack_size;
+	k3d_data(k3d::int32_t, immutable_name, change_signal, with_undo, local_storage, with_constraint, measurement_property, with_serialization) m_max_string;
 	k3d_data(k3d::signed_axis, immutable_name, change_signal, with_undo, local_storage, no_constraint, enumeration_property, with_serialization) m_orientation;
 	k3d_data(bool, immutable_name, change_signal, with_undo, local_storage, no_constraint, writable_property, with_serialization) m_flip_normals;
+	k3d_data(bool, immutable_name, change_signal, with_undo, local_storage, no_constraint, writable_property, with_serialization) m_instances;
+	k3d_data(bool, immutable_name, change_signal, with_undo, local_storage, no_constraint, writable_property, with_serialization) m_parallel;
+
+	/// Caches the size of the first L-system that was generated, so changes in growth are visible
+	k3d::double_t m_bbox_x;
+	k3d::double_t m_bbox_y;
+	k3d::double_t m_bbox_z;
 };
 
 } // namespace lsystem
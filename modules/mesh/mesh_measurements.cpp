@@ -0,0 +1,417 @@
+// K-3D
+// Copyright (c) 1995-2010, Timothy M. Shead
+//
+// Contact: tshead@k-3d.com
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+/** \file
+	\author Timothy M. Shead (tshead@k-3d.com)
+*/
+
+#include <k3d-i18n-config.h>
+#include <k3dsdk/algebra.h>
+#include <k3dsdk/document_plugin_factory.h>
+#include <k3dsdk/hints.h>
+#include <k3dsdk/log.h>
+#include <k3dsdk/mesh_modifier.h>
+#include <k3dsdk/node.h>
+#include <k3dsdk/parallel/blocked_range.h>
+#include <k3dsdk/parallel/parallel_for.h>
+#include <k3dsdk/parallel/threads.h>
+#include <k3dsdk/polyhedron.h>
+#include <k3dsdk/value_demand_storage.h>
+
+#include <boost/scoped_ptr.hpp>
+
+#include <algorithm>
+#include <vector>
+
+namespace module
+{
+
+namespace mesh
+{
+
+namespace detail
+{
+
+/// Accumulates the integral properties of a closed surface.  Each triangle is measured as the signed tetrahedron it forms
+/// with the origin, so the volume integrals are exact for closed, consistently-oriented surfaces.
+struct moments
+{
+	moments() :
+		area(0),
+		volume(0),
+		first(0, 0, 0)
+	{
+		std::fill(second, second + 6, 0.0);
+	}
+
+	moments& operator+=(const moments& Other)
+	{
+		area += Other.area;
+		volume += Other.volume;
+		first += Other.first;
+		for(k3d::uint_t i = 0; i != 6; ++i)
+			second[i] += Other.second[i];
+		return *this;
+	}
+
+	/// Surface area
+	k3d::double_t area;
+	/// Signed volume
+	k3d::double_t volume;
+	/// Integral of position over the volume
+	k3d::vector3 first;
+	/// Integrals of xx, yy, zz, xy, yz, and zx over the volume
+	k3d::double_t second[6];
+};
+
+/// Adds the tetrahedron formed by the origin and a triangle to a running total
+inline void add_tetrahedron(const k3d::vector3& A, const k3d::vector3& B, const k3d::vector3& C, moments& Moments)
+{
+	const k3d::double_t determinant = A * (B ^ C);
+	const k3d::vector3 sum = A + B + C;
+
+	Moments.volume += determinant / 6;
+	Moments.first += (determinant / 24) * sum;
+
+	const k3d::double_t scale = determinant / 120;
+	Moments.second[0] += scale * (A[0] * A[0] + B[0] * B[0] + C[0] * C[0] + sum[0] * sum[0]);
+	Moments.second[1] += scale * (A[1] * A[1] + B[1] * B[1] + C[1] * C[1] + sum[1] * sum[1]);
+	Moments.second[2] += scale * (A[2] * A[2] + B[2] * B[2] + C[2] * C[2] + sum[2] * sum[2]);
+	Moments.second[3] += scale * (A[0] * A[1] + B[0] * B[1] + C[0] * C[1] + sum[0] * sum[1]);
+	Moments.second[4] += scale * (A[1] * A[2] + B[1] * B[2] + C[1] * C[2] + sum[1] * sum[2]);
+	Moments.second[5] += scale * (A[2] * A[0] + B[2] * B[0] + C[2] * C[0] + sum[2] * sum[0]);
+}
+
+/// Measures one face by fanning each of its loops into triangles (holes are wound opposite their face, so they cancel the area they cover).
+/// Adds the face to a running total, and returns its vector area (the face normal, scaled by its area).
+inline const k3d::vector3 measure_face(const k3d::polyhedron::const_primitive& Polyhedron, const k3d::mesh::points_t& Points, const k3d::uint_t Face, moments& Moments)
+{
+	k3d::vector3 vector_area(0, 0, 0);
+
+	const k3d::uint_t loop_begin = Polyhedron.face_first_loops[Face];
+	const k3d::uint_t loop_end = loop_begin + Polyhedron.face_loop_counts[Face];
+	for(k3d::uint_t loop = loop_begin; loop != loop_end; ++loop)
+	{
+		const k3d::uint_t first_edge = Polyhedron.loop_first_edges[loop];
+		const k3d::vector3 a = k3d::to_vector(Points[Polyhedron.vertex_points[first_edge]]);
+
+		for(k3d::uint_t edge = Polyhedron.clockwise_edges[first_edge]; Polyhedron.clockwise_edges[edge] != first_edge; edge = Polyhedron.clockwise_edges[edge])
+		{
+			const k3d::vector3 b = k3d::to_vector(Points[Polyhedron.vertex_points[edge]]);
+			const k3d::vector3 c = k3d::to_vector(Points[Polyhedron.vertex_points[Polyhedron.clockwise_edges[edge]]]);
+
+			vector_area += 0.5 * ((b - a) ^ (c - a));
+			add_tetrahedron(a, b, c, Moments);
+		}
+	}
+
+	const k3d::double_t area = vector_area.length();
+	Moments.area += area;
+
+	return vector_area;
+}
+
+/// Returns the area-weighted center of a face
+inline const k3d::point3 face_center(const k3d::polyhedron::const_primitive& Polyhedron, const k3d::mesh::points_t& Points, const k3d::uint_t Face, const k3d::vector3& VectorArea)
+{
+	const k3d::double_t area2 = VectorArea.length2();
+
+	k3d::vector3 weighted_sum(0, 0, 0);
+
+	const k3d::uint_t loop_begin = Polyhedron.face_first_loops[Face];
+	const k3d::uint_t loop_end = loop_begin + Polyhedron.face_loop_counts[Face];
+	for(k3d::uint_t loop = loop_begin; loop != loop_end; ++loop)
+	{
+		const k3d::uint_t loop_first_edge = Polyhedron.loop_first_edges[loop];
+		const k3d::vector3 a = k3d::to_vector(Points[Polyhedron.vertex_points[loop_first_edge]]);
+
+		for(k3d::uint_t edge = Polyhedron.clockwise_edges[loop_first_edge]; Polyhedron.clockwise_edges[edge] != loop_first_edge; edge = Polyhedron.clockwise_edges[edge])
+		{
+			const k3d::vector3 b = k3d::to_vector(Points[Polyhedron.vertex_points[edge]]);
+			const k3d::vector3 c = k3d::to_vector(Points[Polyhedron.vertex_points[Polyhedron.clockwise_edges[edge]]]);
+
+			// Each triangle's area, signed relative to the face normal ...
+			weighted_sum += (((b - a) ^ (c - a)) * VectorArea) / 6 * (a + b + c);
+		}
+	}
+
+	if(area2)
+		return k3d::to_point(weighted_sum / area2);
+
+	// Degenerate faces fall-back on the average of their outer loop ...
+	k3d::vector3 sum(0, 0, 0);
+	k3d::uint_t count = 0;
+	const k3d::uint_t first_edge = Polyhedron.loop_first_edges[loop_begin];
+	for(k3d::uint_t edge = first_edge; ; )
+	{
+		sum += k3d::to_vector(Points[Polyhedron.vertex_points[edge]]);
+		++count;
+
+		edge = Polyhedron.clockwise_edges[edge];
+		if(edge == first_edge)
+			break;
+	}
+
+	return k3d::to_point(sum / count);
+}
+
+/// Measures a range of polyhedron faces in parallel, storing one partial total for each chunk of faces so that the totals can be
+/// combined in a fixed order (making the results independent of the number of threads).  Optionally stores per-face results.
+class measure_worker
+{
+public:
+	measure_worker(const k3d::polyhedron::const_primitive& Polyhedron, const k3d::mesh::points_t& Points, const k3d::uint_t ChunkSize, std::vector<moments>& Chunks, k3d::mesh::doubles_t* const FaceAreas, k3d::mesh::points_t* const FaceCenters) :
+		m_polyhedron(Polyhedron),
+		m_points(Points),
+		m_chunk_size(ChunkSize),
+		m_chunks(Chunks),
+		m_face_areas(FaceAreas),
+		m_face_centers(FaceCenters)
+	{
+	}
+
+	void operator()(const k3d::parallel::blocked_range<k3d::uint_t>& Range) const
+	{
+		const k3d::uint_t face_count = m_polyhedron.face_first_loops.size();
+		for(k3d::uint_t chunk = Range.begin(); chunk != Range.end(); ++chunk)
+		{
+			moments& total = m_chunks[chunk];
+
+			const k3d::uint_t face_begin = chunk * m_chunk_size;
+			const k3d::uint_t face_end = std::min(face_count, face_begin + m_chunk_size);
+			for(k3d::uint_t face = face_begin; face != face_end; ++face)
+			{
+				const k3d::vector3 vector_area = measure_face(m_polyhedron, m_points, face, total);
+
+				if(m_face_areas)
+					(*m_face_areas)[face] = vector_area.length();
+				if(m_face_centers)
+					(*m_face_centers)[face] = face_center(m_polyhedron, m_points, face, vector_area);
+			}
+		}
+	}
+
+private:
+	const k3d::polyhedron::const_primitive& m_polyhedron;
+	const k3d::mesh::points_t& m_points;
+	const k3d::uint_t m_chunk_size;
+	std::vector<moments>& m_chunks;
+	k3d::mesh::doubles_t* const m_face_areas;
+	k3d::mesh::points_t* const m_face_centers;
+};
+
+/// Measures every face in a polyhedron, adding them to a running total and optionally storing per-face results
+void measure(const k3d::polyhedron::const_primitive& Polyhedron, const k3d::mesh::points_t& Points, moments& Moments, k3d::mesh::doubles_t* const FaceAreas, k3d::mesh::points_t* const FaceCenters)
+{
+	const k3d::uint_t face_count = Polyhedron.face_first_loops.size();
+	const k3d::uint_t chunk_size = std::max<k3d::uint_t>(1, k3d::parallel::grain_size());
+	const k3d::uint_t chunk_count = (face_count + chunk_size - 1) / chunk_size;
+
+	std::vector<moments> chunks(chunk_count);
+	k3d::parallel::parallel_for(
+		k3d::parallel::blocked_range<k3d::uint_t>(0, chunk_count, 1),
+		measure_worker(Polyhedron, Points, chunk_size, chunks, FaceAreas, FaceCenters));
+
+	for(k3d::uint_t chunk = 0; chunk != chunk_count; ++chunk)
+		Moments += chunks[chunk];
+}
+
+} // namespace detail
+
+/////////////////////////////////////////////////////////////////////////////
+// mesh_measurements
+
+class mesh_measurements :
+	public k3d::mesh_modifier<k3d::node >
+{
+	typedef k3d::mesh_modifier<k3d::node > base;
+
+public:
+	mesh_measurements(k3d::iplugin_factory& Factory, k3d::idocument& Document) :
+		base(Factory, Document),
+		m_face(init_owner(*this) + init_name("face") + init_label(_("Face Measurements")) + init_description(_("Store per-face areas and centers in the output mesh.")) + init_value(false)),
+		m_face_area_array(init_owner(*this) + init_name("face_area_array") + init_label(_("Face Area Array Name")) + init_description(_("Face area output array name.")) + init_value(k3d::string_t("area"))),
+		m_face_center_array(init_owner(*this) + init_name("face_center_array") + init_label(_("Face Center Array Name")) + init_description(_("Face center output array name.")) + init_value(k3d::string_t("center"))),
+		m_area(init_owner(*this) + init_name("area") + init_label(_("Area")) + init_description(_("Total surface area of every polyhedron")) + init_value(0.0)),
+		m_volume(init_owner(*this) + init_name("volume") + init_label(_("Volume")) + init_description(_("Total signed volume of every polyhedron (negative if the polyhedra are inside-out)")) + init_value(0.0)),
+		m_centroid(init_owner(*this) + init_name("centroid") + init_label(_("Centroid")) + init_description(_("Center of mass of the enclosed volume")) + init_value(k3d::point3(0, 0, 0))),
+		m_inertia(init_owner(*this) + init_name("inertia") + init_label(_("Inertia Tensor")) + init_description(_("Inertia tensor of the enclosed volume about its centroid, assuming unit density")) + init_value(k3d::identity3())),
+		m_measured(false)
+	{
+		m_input_mesh.changed_signal().connect(sigc::mem_fun(*this, &mesh_measurements::on_input_changed));
+		m_input_mesh.changed_signal().connect(k3d::hint::converter<
+			k3d::hint::convert<k3d::hint::any, k3d::hint::none> >(m_area.make_slot()));
+		m_input_mesh.changed_signal().connect(k3d::hint::converter<
+			k3d::hint::convert<k3d::hint::any, k3d::hint::none> >(m_volume.make_slot()));
+		m_input_mesh.changed_signal().connect(k3d::hint::converter<
+			k3d::hint::convert<k3d::hint::any, k3d::hint::none> >(m_centroid.make_slot()));
+		m_input_mesh.changed_signal().connect(k3d::hint::converter<
+			k3d::hint::convert<k3d::hint::any, k3d::hint::none> >(m_inertia.make_slot()));
+
+		m_face.changed_signal().connect(make_reset_mesh_slot());
+		m_face_area_array.changed_signal().connect(make_reset_mesh_slot());
+		m_face_center_array.changed_signal().connect(make_reset_mesh_slot());
+
+		m_area.set_update_slot(sigc::mem_fun(*this, &mesh_measurements::execute_area));
+		m_volume.set_update_slot(sigc::mem_fun(*this, &mesh_measurements::execute_volume));
+		m_centroid.set_update_slot(sigc::mem_fun(*this, &mesh_measurements::execute_centroid));
+		m_inertia.set_update_slot(sigc::mem_fun(*this, &mesh_measurements::execute_inertia));
+	}
+
+	void on_create_mesh(const k3d::mesh& Input, k3d::mesh& Output)
+	{
+		Output = Input;
+
+		if(!m_face.pipeline_value() || !Output.points)
+			return;
+
+		const k3d::string_t face_area_array = m_face_area_array.pipeline_value();
+		const k3d::string_t face_center_array = m_face_center_array.pipeline_value();
+		const k3d::mesh::points_t& points = *Output.points;
+
+		for(k3d::uint_t primitive = 0; primitive != Input.primitives.size(); ++primitive)
+		{
+			boost::scoped_ptr<k3d::polyhedron::const_primitive> input_polyhedron(k3d::polyhedron::validate(Input, *Input.primitives[primitive]));
+			if(!input_polyhedron)
+				continue;
+
+			boost::scoped_ptr<k3d::polyhedron::primitive> polyhedron(k3d::polyhedron::validate(Output, Output.primitives[primitive]));
+			return_if_fail(polyhedron);
+
+			const k3d::uint_t face_count = polyhedron->face_first_loops.size();
+			k3d::mesh::doubles_t& face_areas = polyhedron->face_attributes.create(face_area_array, new k3d::mesh::doubles_t(face_count));
+			k3d::mesh::points_t& face_centers = polyhedron->face_attributes.create(face_center_array, new k3d::mesh::points_t(face_count));
+
+			detail::moments moments;
+			detail::measure(*input_polyhedron, points, moments, &face_areas, &face_centers);
+		}
+	}
+
+	void on_update_mesh(const k3d::mesh& Input, k3d::mesh& Output)
+	{
+	}
+
+	static k3d::iplugin_factory& get_factory()
+	{
+		static k3d::document_plugin_factory<mesh_measurements,
+			k3d::interface_list<k3d::imesh_source,
+			k3d::interface_list<k3d::imesh_sink > > > factory(
+				k3d::uuid(0x7e2b94d1, 0x3f6a4c58, 0xa1d7e093, 0x5b8c26f4),
+				"MeshMeasurements",
+				_("Calculates the surface area, volume, centroid and inertia tensor of the input polyhedra"),
+				"Mesh",
+				k3d::iplugin_factory::EXPERIMENTAL);
+
+		return factory;
+	}
+
+private:
+	k3d_data(k3d::bool_t, immutable_name, change_signal, with_undo, local_storage, no_constraint, writable_property, with_serialization) m_face;
+	k3d_data(k3d::string_t, immutable_name, change_signal, with_undo, local_storage, no_constraint, writable_property, with_serialization) m_face_area_array;
+	k3d_data(k3d::string_t, immutable_name, change_signal, with_undo, local_storage, no_constraint, writable_property, with_serialization) m_face_center_array;
+	k3d_data(k3d::double_t, immutable_name, change_signal, no_undo, value_demand_storage, no_constraint, read_only_property, no_serialization) m_area;
+	k3d_data(k3d::double_t, immutable_name, change_signal, no_undo, value_demand_storage, no_constraint, read_only_property, no_serialization) m_volume;
+	k3d_data(k3d::point3, immutable_name, change_signal, no_undo, value_demand_storage, no_constraint, read_only_property, no_serialization) m_centroid;
+	k3d_data(k3d::matrix4, immutable_name, change_signal, no_undo, value_demand_storage, no_constraint, read_only_property, no_serialization) m_inertia;
+
+	/// Set to true once m_moments holds the measurements of the current input, so the output properties share a single pass over the mesh
+	k3d::bool_t m_measured;
+	detail::moments m_moments;
+
+	void on_input_changed(k3d::ihint*)
+	{
+		m_measured = false;
+	}
+
+	const detail::moments& moments()
+	{
+		if(!m_measured)
+		{
+			m_moments = detail::moments();
+
+			if(k3d::mesh* const mesh = m_input_mesh.pipeline_value())
+			{
+				if(mesh->points)
+				{
+					for(k3d::mesh::primitives_t::const_iterator primitive = mesh->primitives.begin(); primitive != mesh->primitives.end(); ++primitive)
+					{
+						boost::scoped_ptr<k3d::polyhedron::const_primitive> polyhedron(k3d::polyhedron::validate(*mesh, **primitive));
+						if(!polyhedron)
+							continue;
+
+						detail::measure(*polyhedron, *mesh->points, m_moments, 0, 0);
+					}
+				}
+			}
+
+			m_measured = true;
+		}
+
+		return m_moments;
+	}
+
+	void execute_area(const std::vector<k3d::ihint*>& Hints, k3d::double_t& Area)
+	{
+		Area = moments().area;
+	}
+
+	void execute_volume(const std::vector<k3d::ihint*>& Hints, k3d::double_t& Volume)
+	{
+		Volume = moments().volume;
+	}
+
+	void execute_centroid(const std::vector<k3d::ihint*>& Hints, k3d::point3& Centroid)
+	{
+		const detail::moments& m = moments();
+		Centroid = m.volume ? k3d::to_point(m.first / m.volume) : k3d::point3(0, 0, 0);
+	}
+
+	void execute_inertia(const std::vector<k3d::ihint*>& Hints, k3d::matrix4& Inertia)
+	{
+		const detail::moments& m = moments();
+
+		// Move the second moments from the origin to the centroid ...
+		const k3d::vector3 c = m.volume ? m.first / m.volume : k3d::vector3(0, 0, 0);
+		const k3d::double_t xx = m.second[0] - m.volume * c[0] * c[0];
+		const k3d::double_t yy = m.second[1] - m.volume * c[1] * c[1];
+		const k3d::double_t zz = m.second[2] - m.volume * c[2] * c[2];
+		const k3d::double_t xy = m.second[3] - m.volume * c[0] * c[1];
+		const k3d::double_t yz = m.second[4] - m.volume * c[1] * c[2];
+		const k3d::double_t zx = m.second[5] - m.volume * c[2] * c[0];
+
+		Inertia = k3d::matrix4(
+			k3d::vector4(yy + zz, -xy, -zx, 0),
+			k3d::vector4(-xy, xx + zz, -yz, 0),
+			k3d::vector4(-zx, -yz, xx + yy, 0),
+			k3d::vector4(0, 0, 0, 1));
+	}
+};
+
+/////////////////////////////////////////////////////////////////////////////
+// mesh_measurements_factory
+
+k3d::iplugin_factory& mesh_measurements_factory()
+{
+	return mesh_measurements::get_factory();
+}
+
+} // namespace mesh
+
+} // namespace module
+
@@ -23,9 +23,13 @@
 
 #include <k3d-i18n-config.h>
 #include <k3dsdk/classes.h>
+#include <k3dsdk/cone.h>
+#include <k3dsdk/cylinder.h>
+#include <k3dsdk/disk.h>
 #include <k3dsdk/document_plugin_factory.h>
 #include <k3dsdk/geometry.h>
 #include <k3dsdk/hints.h>
+#include <k3dsdk/hyperboloid.h>
 #include <k3dsdk/ibounded.h>
 #include <k3dsdk/imesh_painter_gl.h>
 #include <k3dsdk/imesh_painter_ri.h>
@@ -34,9 +38,11 @@
 #include <k3dsdk/ipipeline.h>
 #include <k3dsdk/ipipeline_profiler.h>
 #include <k3dsdk/mesh_selection_sink.h>
+#include <k3dsdk/metadata_keys.h>
 #include <k3dsdk/node.h>
 #include <k3dsdk/painter_render_state_gl.h>
 #include <k3dsdk/painter_selection_state_gl.h>
+#include <k3dsdk/paraboloid.h>
 #include <k3dsdk/parentable.h>
 #include <k3dsdk/pointer_demand_storage.h>
 #include <k3dsdk/property.h>
@@ -44,9 +50,12 @@
 #include <k3dsdk/renderable_ri.h>
 #include <k3dsdk/selection.h>
 #include <k3dsdk/snappable.h>
+#include <k3dsdk/sphere.h>
+#include <k3dsdk/torus.h>
 #include <k3dsdk/transformable.h>
 
 #include <boost/any.hpp>
+#include <boost/scoped_ptr.hpp>
 
 #include <list>
 
@@ -56,6 +65,113 @@ namespace module
 namespace mesh_instance
 {
 
+namespace detail
+{
+
+/// Sets a flag if a primitive has any arrays of point indices
+class references_points
+{
+public:
+	references_points(k3d::bool_t& Result) :
+		result(Result)
+	{
+	}
+
+	void operator()(const k3d::string_t&, const k3d::table&, const k3d::string_t&, const k3d::pipeline_data<k3d::array>& Array)
+	{
+		if(Array->get_metadata_value(k3d::metadata::key::domain()) == k3d::metadata::value::point_indices_domain())
+			result = true;
+	}
+
+	k3d::bool_t& result;
+};
+
+/// Returns a box (in local coordinates) that contains a surface of revolution about the z axis
+const k3d::bounding_box3 revolution_bounds(const k3d::double_t Radius, const k3d::double_t ZMin, const k3d::double_t ZMax)
+{
+	const k3d::double_t radius = std::abs(Radius);
+	return k3d::bounding_box3(radius, -radius, radius, -radius, std::max(ZMin, ZMax), std::min(ZMin, ZMax));
+}
+
+/// Adds the bounds of a primitive to Bounds.  Primitives that use mesh points are already covered by the points, and
+/// quadrics are bounded by their (transformed) parameters.  Returns false for any other primitive, which can't be bounded.
+k3d::bool_t insert_primitive_bounds(const k3d::mesh& Mesh, const k3d::mesh::primitive& Primitive, k3d::bounding_box3& Bounds)
+{
+	k3d::bool_t uses_points = false;
+	k3d::mesh::visit_arrays(Primitive, references_points(uses_points));
+	if(uses_points)
+		return true;
+
+	boost::scoped_ptr<k3d::cone::const_primitive> cone(k3d::cone::validate(Mesh, Primitive));
+	if(cone)
+	{
+		for(k3d::uint_t i = 0; i != cone->matrices.size(); ++i)
+			Bounds.insert(cone->matrices[i] * revolution_bounds(cone->radii[i], 0, cone->heights[i]));
+		return true;
+	}
+
+	boost::scoped_ptr<k3d::cylinder::const_primitive> cylinder(k3d::cylinder::validate(Mesh, Primitive));
+	if(cylinder)
+	{
+		for(k3d::uint_t i = 0; i != cylinder->matrices.size(); ++i)
+			Bounds.insert(cylinder->matrices[i] * revolution_bounds(cylinder->radii[i], cylinder->z_min[i], cylinder->z_max[i]));
+		return true;
+	}
+
+	boost::scoped_ptr<k3d::disk::const_primitive> disk(k3d::disk::validate(Mesh, Primitive));
+	if(disk)
+	{
+		for(k3d::uint_t i = 0; i != disk->matrices.size(); ++i)
+			Bounds.insert(disk->matrices[i] * revolution_bounds(disk->radii[i], disk->heights[i], disk->heights[i]));
+		return true;
+	}
+
+	boost::scoped_ptr<k3d::hyperboloid::const_primitive> hyperboloid(k3d::hyperboloid::validate(Mesh, Primitive));
+	if(hyperboloid)
+	{
+		// The distance from the axis is largest at one of the two end points ...
+		for(k3d::uint_t i = 0; i != hyperboloid->matrices.size(); ++i)
+		{
+			const k3d::point3& start = hyperboloid->start_points[i];
+			const k3d::point3& end = hyperboloid->end_points[i];
+			const k3d::double_t radius = std::max(std::sqrt(start[0] * start[0] + start[1] * start[1]), std::sqrt(end[0] * end[0] + end[1] * end[1]));
+			Bounds.insert(hyperboloid->matrices[i] * revolution_bounds(radius, start[2], end[2]));
+		}
+		return true;
+	}
+
+	boost::scoped_ptr<k3d::paraboloid::const_primitive> paraboloid(k3d::paraboloid::validate(Mesh, Primitive));
+	if(paraboloid)
+	{
+		for(k3d::uint_t i = 0; i != paraboloid->matrices.size(); ++i)
+			Bounds.insert(paraboloid->matrices[i] * revolution_bounds(paraboloid->radii[i], paraboloid->z_min[i], paraboloid->z_max[i]));
+		return true;
+	}
+
+	boost::scoped_ptr<k3d::sphere::const_primitive> sphere(k3d::sphere::validate(Mesh, Primitive));
+	if(sphere)
+	{
+		for(k3d::uint_t i = 0; i != sphere->matrices.size(); ++i)
+			Bounds.insert(sphere->matrices[i] * revolution_bounds(sphere->radii[i], -sphere->radii[i], sphere->radii[i]));
+		return true;
+	}
+
+	boost::scoped_ptr<k3d::torus::const_primitive> torus(k3d::torus::validate(Mesh, Primitive));
+	if(torus)
+	{
+		for(k3d::uint_t i = 0; i != torus->matrices.size(); ++i)
+		{
+			const k3d::double_t minor_radius = std::abs(torus->minor_radii[i]);
+			Bounds.insert(torus->matrices[i] * revolution_bounds(std::abs(torus->major_radii[i]) + minor_radius, -minor_radius, minor_radius));
+		}
+		return true;
+	}
+
+	return false;
+}
+
+} // namespace detail
+
 /////////////////////////////////////////////////////////////////////////////
 // mesh_instance
 
@@ -73,7 +189,8 @@ public:
 		m_output_mesh(init_owner(*this) + init_name("output_mesh") + init_label(_("Output Mesh")) + init_description(_("Output mesh"))),
 		m_gl_painter(init_owner(*this) + init_name("gl_painter") + init_label(_("OpenGL Mesh Painter")) + init_description(_("OpenGL Mesh Painter")) + init_value(static_cast<k3d::gl::imesh_painter*>(0))),
 		m_ri_painter(init_owner(*this) + init_name("ri_painter") + init_label(_("RenderMan Mesh Painter")) + init_description(_("RenderMan Mesh Painter")) + init_value(static_cast<k3d::ri::imesh_painter*>(0))),
-		m_show_component_selection(init_owner(*this) + init_name("show_component_selection") + init_label(_("Show Component Selection")) + init_description(_("Show component selection")) + init_value(false))
+		m_show_component_selection(init_owner(*this) + init_name("show_component_selection") + init_label(_("Show Component Selection")) + init_description(_("Show component selection")) + init_value(false)),
+		m_extents_valid(false)
 	{
 		m_input_mesh.changed_signal().connect(k3d::hint::converter<k3d::hint::convert<k3d::hint::any, k3d::hint::unchanged> >(m_output_mesh.make_slot()));
 		m_mesh_selection.changed_signal().connect(k3d::hint::converter<k3d::hint::convert<k3d::hint::any, k3d::hint::selection_changed> >(m_output_mesh.make_slot()));
@@ -84,8 +201,15 @@ public:
 		m_gl_painter.changed_signal().connect(make_async_redraw_slot());
 		m_show_component_selection.changed_signal().connect(make_async_redraw_slot());
 		
+		m_output_mesh.changed_signal().connect(sigc::mem_fun(*this, &mesh_instance::on_output_mesh_changed));
+
 		m_output_mesh.set_update_slot(sigc::mem_fun(*this, &mesh_instance::execute));
 	}
+
+	void on_output_mesh_changed(k3d::ihint*)
+	{
+		m_extents_valid = false;
+	}
 	
 	void execute(const std::vector<k3d::ihint*>& Hints, k3d::mesh& Output)
 	{
@@ -116,6 +240,10 @@ public:
 
 	const k3d::bounding_box3 extents()
 	{
+		// Render engines ask for our extents on every redraw, so only walk the points when the mesh has changed ...
+		if(m_extents_valid)
+			return m_extents;
+
 		k3d::bounding_box3 results;
 
 		const k3d::mesh* const output_mesh = k3d::property::pipeline_value<k3d::mesh*>(m_output_mesh);
@@ -134,6 +262,20 @@ public:
 			}
 		}
 
+		// Include primitives that don't use points, such as quadrics.  If any primitive can't be bounded (teapots, blobbies),
+		// our extents are unknown, so return empty extents, which render engines never cull ...
+		for(k3d::mesh::primitives_t::const_iterator primitive = output_mesh->primitives.begin(); primitive != output_mesh->primitives.end(); ++primitive)
+		{
+			if(!detail::insert_primitive_bounds(*output_mesh, **primitive, results))
+			{
+				results = k3d::bounding_box3();
+				break;
+			}
+		}
+
+		m_extents = results;
+		m_extents_valid = true;
+
 		return results;
 	}
 	
@@ -242,6 +384,11 @@ private:
 	k3d_data(k3d::gl::imesh_painter*, k3d::data::immutable_name, k3d::data::change_signal, k3d::data::with_undo, k3d::data::node_storage, k3d::data::no_constraint, k3d::data::node_property, k3d::data::node_serialization) m_gl_painter;
 	k3d_data(k3d::ri::imesh_painter*, k3d::data::immutable_name, k3d::data::change_signal, k3d::data::with_undo, k3d::data::node_storage, k3d::data::no_constraint, k3d::data::node_property, k3d::data::node_serialization) m_ri_painter;
 	k3d_data(bool, immutable_name, change_signal, with_undo, local_storage, no_constraint, writable_property, with_serialization) m_show_component_selection;
+
+	/// Caches the extents of the output mesh
+	k3d::bounding_box3 m_extents;
+	/// Set to true iff m_extents is up-to-date
+	k3d::bool_t m_extents_valid;
 };
 
 /////////////////////////////////////////////////////////////////////////////
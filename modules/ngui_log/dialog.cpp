@@ -28,11 +28,14 @@
 #include <k3dsdk/ngui/application_window.h>
 #include <k3dsdk/ngui/console.h>
 
+#include <glibmm/dispatcher.h>
+#include <glibmm/thread.h>
 #include <gtkmm/texttag.h>
 
 #include <boost/assign/list_of.hpp>
 
 #include <sstream>
+#include <vector>
 
 namespace module
 {
@@ -78,12 +81,49 @@ public:
 
 		add(*console);
 
+		log_dispatcher.connect(sigc::mem_fun(*this, &dialog::on_queued_log_messages));
+
 		k3d::get_log_cache(sigc::mem_fun(*this, &dialog::on_log_message));
-		k3d::connect_log_message(sigc::mem_fun(*this, &dialog::on_log_message));
+		log_connection = k3d::connect_log_message(sigc::mem_fun(*this, &dialog::queue_log_message));
 
 		show_all();
 	}
 
+	~dialog()
+	{
+		// Waits for the writer thread to finish calling queue_log_message(), if it is ...
+		k3d::disconnect_log_message(log_connection);
+	}
+
+	/// Called on the log writer thread, hands a message off to the UI thread
+	void queue_log_message(const time_t Timestamp, const k3d::log_level_t Level, const std::string& Message)
+	{
+		k3d::bool_t wake = false;
+		{
+			Glib::Mutex::Lock lock(queued_messages_mutex);
+			wake = queued_messages.empty();
+			queued_messages.push_back(queued_message(Timestamp, Level, Message));
+		}
+
+		// Only wake the UI thread when the queue was empty, so a burst of messages can't fill the dispatcher's pipe (which would
+		// block the writer thread, and deadlock with our destructor) ...
+		if(wake)
+			log_dispatcher.emit();
+	}
+
+	/// Called on the UI thread, displays messages handed-off by queue_log_message()
+	void on_queued_log_messages()
+	{
+		std::vector<queued_message> messages;
+		{
+			Glib::Mutex::Lock lock(queued_messages_mutex);
+			messages.swap(queued_messages);
+		}
+
+		for(std::vector<queued_message>::const_iterator message = messages.begin(); message != messages.end(); ++message)
+			on_log_message(message->timestamp, message->level, message->message);
+	}
+
 	void on_log_message(const time_t Timestamp, const k3d::log_level_t Level, const std::string& Message)
 	{
 		std::string timestamp(256, '\0');
@@ -135,6 +175,25 @@ public:
 		console->print_string(Message);
 	}
 
+	struct queued_message
+	{
+		queued_message(const time_t Timestamp, const k3d::log_level_t Level, const std::string& Message) :
+			timestamp(Timestamp),
+			level(Level),
+			message(Message)
+		{
+		}
+
+		time_t timestamp;
+		k3d::log_level_t level;
+		std::string message;
+	};
+
+	sigc::connection log_connection;
+	Glib::Dispatcher log_dispatcher;
+	Glib::Mutex queued_messages_mutex;
+	std::vector<queued_message> queued_messages;
+
 	k3d::ngui::console::control* const console;
 	Glib::RefPtr<Gtk::TextTag> critical_tag;
 	Glib::RefPtr<Gtk::TextTag> error_tag;
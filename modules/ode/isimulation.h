@@ -27,6 +27,7 @@
 #include <k3dsdk/algebra.h>
 #include <k3dsdk/iunknown.h>
 #include <k3dsdk/signal_system.h>
+#include <k3dsdk/simulation_cache.h>
 
 #include <ode/ode.h>
 
@@ -49,6 +50,10 @@ public:
 	virtual sigc::connection connect_simulation_changed_signal(const sigc::slot<void>& Slot) = 0;
 	virtual sigc::connection connect_initial_state_signal(const sigc::slot<void>& Slot) = 0;
 	virtual sigc::connection connect_update_state_signal(const sigc::slot<void>& Slot) = 0;
+	/// Connects a slot that will be called to append body state to a simulation checkpoint
+	virtual sigc::connection connect_save_state_signal(const sigc::slot<void, k3d::simulation_cache::state_t&>& Slot) = 0;
+	/// Connects a slot that will be called to restore body state from a simulation checkpoint, advancing the given iterator past the consumed values
+	virtual sigc::connection connect_restore_state_signal(const sigc::slot<void, k3d::simulation_cache::state_t::const_iterator&>& Slot) = 0;
 
 	virtual void simulation_changed() = 0;
 	virtual void update() = 0;
@@ -91,6 +91,8 @@ public:
 		m_simulation_changed_connection.disconnect();
 		m_initial_state_connection.disconnect();
 		m_update_state_connection.disconnect();
+		m_save_state_connection.disconnect();
+		m_restore_state_connection.disconnect();
 
 		if(ode::isimulation* const simulation = m_simulation.pipeline_value())
 		{
@@ -101,6 +103,8 @@ public:
 			m_simulation_changed_connection = simulation->connect_simulation_changed_signal(sigc::mem_fun(*this, &node::simulation_changed));
 			m_initial_state_connection = simulation->connect_initial_state_signal(sigc::mem_fun(*this, &node::initial_state));
 			m_update_state_connection = simulation->connect_update_state_signal(sigc::mem_fun(*this, &node::update_state));
+			m_save_state_connection = simulation->connect_save_state_signal(sigc::mem_fun(*this, &node::save_state));
+			m_restore_state_connection = simulation->connect_restore_state_signal(sigc::mem_fun(*this, &node::restore_state));
 
 			simulation->simulation_changed();
 		}
@@ -144,6 +148,37 @@ public:
 		dBodySetMass(m_body_id, &mass);
 	}
 
+	void save_state(k3d::simulation_cache::state_t& State)
+	{
+		if(!m_body_id)
+			return;
+
+		const dReal* const p = dBodyGetPosition(m_body_id);
+		const dReal* const q = dBodyGetQuaternion(m_body_id);
+		const dReal* const l = dBodyGetLinearVel(m_body_id);
+		const dReal* const a = dBodyGetAngularVel(m_body_id);
+
+		State.insert(State.end(), p, p + 3);
+		State.insert(State.end(), q, q + 4);
+		State.insert(State.end(), l, l + 3);
+		State.insert(State.end(), a, a + 3);
+	}
+
+	void restore_state(k3d::simulation_cache::state_t::const_iterator& State)
+	{
+		if(!m_body_id)
+			return;
+
+		const dQuaternion q = { State[3], State[4], State[5], State[6] };
+
+		dBodySetPosition(m_body_id, State[0], State[1], State[2]);
+		dBodySetQuaternion(m_body_id, q);
+		dBodySetLinearVel(m_body_id, State[7], State[8], State[9]);
+		dBodySetAngularVel(m_body_id, State[10], State[11], State[12]);
+
+		State += 13;
+	}
+
 	static k3d::iplugin_factory& get_factory()
 	{
 		static k3d::document_plugin_factory<node,
@@ -168,6 +203,8 @@ private:
 	sigc::connection m_simulation_changed_connection;
 	sigc::connection m_initial_state_connection;
 	sigc::connection m_update_state_connection;
+	sigc::connection m_save_state_connection;
+	sigc::connection m_restore_state_connection;
 
 	dBodyID m_body_id;
 
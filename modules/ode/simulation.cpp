@@ -51,13 +51,15 @@ public:
 		m_space_id(dSimpleSpaceCreate(0)),
 		m_plane_id(dCreatePlane(m_space_id, 0, 0, 1, 0)),
 		m_contact_joint_group_id(dJointGroupCreate(0)),
-		m_last_time(0.0),
+		m_current_step(0),
 		m_modified(false),
+		m_state_valid(false),
 		m_gravity(init_owner(*this) + init_name("gravity") + init_label(_("Gravity")) + init_description(_("Defines the gravity direction and magnitude (if any).")) + init_value(k3d::vector3(0, 0, -9.81)))
 	{
 		dInitODE();
 
 		m_time.changed_signal().connect(sigc::mem_fun(*this, &simulation::time_changed));
+		m_gravity.changed_signal().connect(sigc::mem_fun(*this, &simulation::gravity_changed));
 	}
 
 	~simulation()
@@ -93,8 +95,22 @@ public:
 		return m_update_state_signal.connect(Slot);
 	}
 
+	sigc::connection connect_save_state_signal(const sigc::slot<void, k3d::simulation_cache::state_t&>& Slot)
+	{
+		return m_save_state_signal.connect(Slot);
+	}
+
+	sigc::connection connect_restore_state_signal(const sigc::slot<void, k3d::simulation_cache::state_t::const_iterator&>& Slot)
+	{
+		return m_restore_state_signal.connect(Slot);
+	}
+
 	void simulation_changed()
 	{
+		// Every cached frame is now stale ...
+		m_cache.clear();
+		m_state_valid = false;
+
 		m_modified = true;
 		m_simulation_changed_signal.emit();
 	}
@@ -106,11 +122,36 @@ public:
 
 		m_modified = false;
 
+		// Always advance in whole steps on a fixed grid, so jumping to a time produces the same state as playing every frame up to it ...
 		const k3d::double_t current_time = m_time.pipeline_value();
-		const k3d::double_t delta_time = current_time - m_last_time;
-		m_last_time = current_time;
+		const k3d::int64_t target_step = k3d::simulation_cache::step_index(current_time, step_size);
+
+		// Resume from the nearest checkpoint at-or-before the requested time, unless the current body state is closer ...
+		k3d::double_t checkpoint_time = 0.0;
+		const k3d::simulation_cache::state_t* const checkpoint = m_cache.nearest(target_step * step_size, checkpoint_time);
+		const k3d::int64_t checkpoint_step = checkpoint ? k3d::simulation_cache::step_index(checkpoint_time, step_size) : -1;
+
+		if(!m_state_valid || m_current_step > target_step || m_current_step < checkpoint_step)
+		{
+			m_state_valid = false;
+			if(checkpoint && restore_state(*checkpoint))
+			{
+				m_current_step = checkpoint_step;
+				m_state_valid = true;
+			}
+		}
 
-		if(delta_time > 0.0)
+		if(!m_state_valid)
+		{
+			// Set initial body states ...
+			m_initial_state_signal.emit();
+
+			m_current_step = 0;
+			m_state_valid = true;
+			save_state(0);
+		}
+
+		if(m_current_step < target_step)
 		{
 			// Setup the world state ...
 			const k3d::vector3 gravity = m_gravity.pipeline_value();
@@ -119,19 +160,22 @@ public:
 			// Set body states ...
 			m_update_state_signal.emit();
 
-			// Detect collisions ...
-			dSpaceCollide(m_space_id, this, raw_collision_callback);
+			// Integrate over the gap, checkpointing intermediate frames along the way ...
+			while(m_current_step < target_step)
+			{
+				// Detect collisions ...
+				dSpaceCollide(m_space_id, this, raw_collision_callback);
 
-			// Step the simulation ...
-			dWorldStep(m_world_id, delta_time);
+				// Step the simulation ...
+				dWorldStep(m_world_id, step_size);
 
-			// Reset collisions ...
-			dJointGroupEmpty(m_contact_joint_group_id);
-		}
-		else
-		{
-			// Set initial body states ...
-			m_initial_state_signal.emit();
+				// Reset collisions ...
+				dJointGroupEmpty(m_contact_joint_group_id);
+
+				++m_current_step;
+				if(m_current_step % checkpoint_interval == 0 || m_current_step == target_step)
+					save_state(m_current_step * step_size);
+			}
 		}
 	}
 
@@ -141,6 +185,36 @@ public:
 		m_simulation_changed_signal.emit();
 	}
 
+	void gravity_changed(k3d::ihint*)
+	{
+		simulation_changed();
+	}
+
+	/// Stores the current state of every body in the cache
+	void save_state(const k3d::double_t Time)
+	{
+		k3d::simulation_cache::state_t state;
+		m_save_state_signal.emit(state);
+		m_cache.store(Time, state);
+	}
+
+	/// Restores the state of every body from a checkpoint, returns false (and discards the cache) if the checkpoint doesn't match the current set of bodies
+	k3d::bool_t restore_state(const k3d::simulation_cache::state_t& State)
+	{
+		k3d::simulation_cache::state_t current_state;
+		m_save_state_signal.emit(current_state);
+		if(current_state.size() != State.size())
+		{
+			m_cache.clear();
+			m_state_valid = false;
+			return false;
+		}
+
+		k3d::simulation_cache::state_t::const_iterator state = State.begin();
+		m_restore_state_signal.emit(state);
+		return true;
+	}
+
 	static void raw_collision_callback(void* Data, dGeomID Geometry1, dGeomID Geometry2)
 	{
 		reinterpret_cast<simulation*>(Data)->collision_callback(Geometry1, Geometry2);
@@ -192,12 +266,26 @@ private:
 	sigc::signal<void> m_simulation_changed_signal;
 	sigc::signal<void> m_initial_state_signal;
 	sigc::signal<void> m_update_state_signal;
+	sigc::signal<void, k3d::simulation_cache::state_t&> m_save_state_signal;
+	sigc::signal<void, k3d::simulation_cache::state_t::const_iterator&> m_restore_state_signal;
 
-	k3d::double_t m_last_time;
+	/// Defines the size of a single simulation step, in seconds
+	static const k3d::double_t step_size;
+	/// Defines the number of simulation steps between checkpoints
+	static const k3d::int64_t checkpoint_interval = 4;
+
+	/// Stores the index of the simulation step that the current body states correspond to
+	k3d::int64_t m_current_step;
+	/// Set to true iff the current body states correspond to m_current_step
+	k3d::bool_t m_state_valid;
+	/// Stores per-frame checkpoints of body state
+	k3d::simulation_cache m_cache;
 
 	k3d_data(k3d::vector3, immutable_name, change_signal, with_undo, local_storage, no_constraint, writable_property, with_serialization) m_gravity;
 };
 
+const k3d::double_t simulation::step_size = 0.01;
+
 /////////////////////////////////////////////////////////////////////////////
 // simulation_factory
 
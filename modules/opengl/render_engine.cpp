@@ -29,6 +29,7 @@
 #include <k3dsdk/data.h>
 #include <k3dsdk/document_plugin_factory.h>
 #include <k3dsdk/gl.h>
+#include <k3dsdk/ibounded.h>
 #include <k3dsdk/icamera.h>
 #include <k3dsdk/icrop_window.h>
 #include <k3dsdk/ilight_gl.h>
@@ -48,8 +49,10 @@
 #include <k3dsdk/render_state_gl.h>
 #include <k3dsdk/selection_state_gl.h>
 #include <k3dsdk/time_source.h>
+#include <k3dsdk/transform.h>
 #include <k3dsdk/utility_gl.h>
 
+#include <algorithm>
 #include <iostream>
 
 #ifdef	WIN32
@@ -100,6 +103,90 @@ struct render_order
 	}
 };
 
+/// Stores the six planes of a view frustum in world coordinates, for culling nodes that can't be seen
+class frustum
+{
+public:
+	/// Extracts the frustum planes from OpenGL (column-major) view and projection matrices
+	frustum(const GLdouble ViewMatrix[16], const GLdouble ProjectionMatrix[16])
+	{
+		double clip[16];
+		for(int column = 0; column != 4; ++column)
+		{
+			for(int row = 0; row != 4; ++row)
+			{
+				clip[column * 4 + row] = 0;
+				for(int i = 0; i != 4; ++i)
+					clip[column * 4 + row] += ProjectionMatrix[i * 4 + row] * ViewMatrix[column * 4 + i];
+			}
+		}
+
+		// Each plane is the sum or difference of the fourth row of the clip matrix and one of the other rows ...
+		for(int plane = 0; plane != 6; ++plane)
+		{
+			const int row = plane / 2;
+			const double sign = plane % 2 ? -1.0 : 1.0;
+			for(int i = 0; i != 4; ++i)
+				m_planes[plane][i] = clip[i * 4 + 3] + sign * clip[i * 4 + row];
+		}
+	}
+
+	/// Returns true iff the given (world coordinate) bounding box lies entirely outside the frustum
+	bool outside(const k3d::bounding_box3& Box) const
+	{
+		for(int plane = 0; plane != 6; ++plane)
+		{
+			// Test the corner of the box that lies furthest along the plane normal ...
+			const double x = m_planes[plane][0] >= 0 ? Box.px : Box.nx;
+			const double y = m_planes[plane][1] >= 0 ? Box.py : Box.ny;
+			const double z = m_planes[plane][2] >= 0 ? Box.pz : Box.nz;
+			if(m_planes[plane][0] * x + m_planes[plane][1] * y + m_planes[plane][2] * z + m_planes[plane][3] < 0)
+				return true;
+		}
+
+		return false;
+	}
+
+private:
+	double m_planes[6][4];
+};
+
+/// Predicate that returns true for bounded nodes that lie entirely outside a view frustum.  Nodes that don't
+/// implement k3d::ibounded (or whose extents are empty) are never culled.
+class outside_frustum
+{
+public:
+	outside_frustum(const frustum& Frustum) :
+		m_frustum(Frustum)
+	{
+	}
+
+	bool operator()(k3d::gl::irenderable* const Renderable) const
+	{
+		k3d::ibounded* const bounded = dynamic_cast<k3d::ibounded*>(Renderable);
+		if(!bounded)
+			return false;
+
+		const k3d::bounding_box3 extents = bounded->extents();
+		if(extents.empty())
+			return false;
+
+		return m_frustum.outside(k3d::node_to_world_matrix(*Renderable) * extents);
+	}
+
+private:
+	const frustum& m_frustum;
+};
+
+/// Removes nodes that lie entirely outside a view frustum from a collection of renderables, returning the number of nodes removed
+k3d::uint_t cull(std::vector<k3d::gl::irenderable*>& Renderables, const frustum& Frustum)
+{
+	const std::vector<k3d::gl::irenderable*>::iterator end = std::remove_if(Renderables.begin(), Renderables.end(), outside_frustum(Frustum));
+	const k3d::uint_t result = Renderables.end() - end;
+	Renderables.erase(end, Renderables.end());
+	return result;
+}
+
 /// Functor for drawing objects during OpenGL drawing
 class draw
 {
@@ -318,6 +405,9 @@ public:
 		m_draw_aimpoint(init_owner(*this) + init_name("draw_aimpoint") + init_label(_("Draw Aim Point")) + init_description(_("Draw center screen cross")) + init_value(true)),
 		m_draw_crop_window(init_owner(*this) + init_name("draw_crop_window") + init_label(_("Draw Crop Window")) + init_description(_("Draw bounding rectangle for output rendering")) + init_value(true)),
 		m_draw_frustum(init_owner(*this) + init_name("draw_frustum") + init_label(_("Draw Frustum")) + init_description(_("Draw Camera Frustum")) + init_value(true)),
+		m_frustum_culling(init_owner(*this) + init_name("frustum_culling") + init_label(_("Frustum Culling")) + init_description(_("Skip drawing nodes whose bounds lie entirely outside the camera frustum")) + init_value(true)),
+		m_drawn_nodes(init_owner(*this) + init_name("drawn_nodes") + init_label(_("Drawn Nodes")) + init_description(_("Number of nodes drawn during the most recent redraw")) + init_value(0)),
+		m_culled_nodes(init_owner(*this) + init_name("culled_nodes") + init_label(_("Culled Nodes")) + init_description(_("Number of nodes culled during the most recent redraw")) + init_value(0)),
 		m_node_selection(init_owner(*this) + init_name("node_selection") + init_label(_("Node Selection")) + init_description(_("Node storing the currently selected nodes")) + init_value(static_cast<k3d::inode_selection*>(0)))
 	{
 		k3d::iproperty_group_collection::group visibility_group("Visibility");
@@ -328,6 +418,13 @@ public:
 		visibility_group.properties.push_back(&static_cast<k3d::iproperty&>(m_draw_frustum));
 
 		register_property_group(visibility_group);
+
+		k3d::iproperty_group_collection::group culling_group("Culling");
+		culling_group.properties.push_back(&static_cast<k3d::iproperty&>(m_frustum_culling));
+		culling_group.properties.push_back(&static_cast<k3d::iproperty&>(m_drawn_nodes));
+		culling_group.properties.push_back(&static_cast<k3d::iproperty&>(m_culled_nodes));
+
+		register_property_group(culling_group);
 		
 		m_point_size.changed_signal().connect(sigc::mem_fun(*this, &render_engine::on_redraw));
 		m_background_color.changed_signal().connect(sigc::mem_fun(*this, &render_engine::on_redraw));
@@ -341,6 +438,7 @@ public:
 		m_draw_aimpoint.changed_signal().connect(sigc::mem_fun(*this, &render_engine::on_redraw));
 		m_draw_crop_window.changed_signal().connect(sigc::mem_fun(*this, &render_engine::on_redraw));
 		m_draw_frustum.changed_signal().connect(sigc::mem_fun(*this, &render_engine::on_redraw));
+		m_frustum_culling.changed_signal().connect(sigc::mem_fun(*this, &render_engine::on_redraw));
 		m_node_selection.changed_signal().connect(sigc::mem_fun(*this, &render_engine::on_node_selection_changed));
 	}
 	
@@ -423,9 +521,13 @@ public:
 
 		k3d::inode_selection* const node_selection = m_node_selection.pipeline_value();
 		std::vector<k3d::gl::irenderable*> renderable_nodes = k3d::node::lookup<k3d::gl::irenderable>(document());
+		const k3d::uint_t culled_nodes = m_frustum_culling.pipeline_value() ? detail::cull(renderable_nodes, detail::frustum(ViewMatrix, ProjectionMatrix)) : 0;
 		std::sort(renderable_nodes.begin(), renderable_nodes.end(), detail::render_order());
 		std::for_each(renderable_nodes.begin(), renderable_nodes.end(), detail::draw(state, node_selection));
 
+		m_drawn_nodes.set_value(renderable_nodes.size());
+		m_culled_nodes.set_value(culled_nodes);
+
 /* I really hate to lose this feedback, but the GLU NURBS routines generate large numbers of errors, which ruins its utility :-(
 		for(GLenum gl_error = glGetError(); gl_error != GL_NO_ERROR; gl_error = glGetError())
 			k3d::log() << error << "OpenGL error: " << reinterpret_cast<const char*>(gluErrorString(gl_error)) << std::endl;
@@ -443,6 +545,9 @@ public:
 
 		k3d::inode_selection* const node_selection = m_node_selection.pipeline_value();
 		std::vector<k3d::gl::irenderable*> renderable_nodes = k3d::node::lookup<k3d::gl::irenderable>(document());
+		// Note: the projection matrix includes the pick matrix, so this culls nodes outside the selection region ...
+		if(m_frustum_culling.pipeline_value())
+			detail::cull(renderable_nodes, detail::frustum(ViewMatrix, ProjectionMatrix));
 		std::sort(renderable_nodes.begin(), renderable_nodes.end(), detail::render_order());
 		std::for_each(renderable_nodes.begin(), renderable_nodes.end(), detail::draw_selection(state, SelectState, node_selection));
 	}
@@ -639,6 +744,9 @@ private:
 	k3d_data(bool, immutable_name, change_signal, with_undo, local_storage, no_constraint, writable_property, with_serialization) m_draw_aimpoint;
 	k3d_data(bool, immutable_name, change_signal, with_undo, local_storage, no_constraint, writable_property, with_serialization) m_draw_crop_window;
 	k3d_data(bool, immutable_name, change_signal, with_undo, local_storage, no_constraint, writable_property, with_serialization) m_draw_frustum;
+	k3d_data(bool, immutable_name, change_signal, with_undo, local_storage, no_constraint, writable_property, with_serialization) m_frustum_culling;
+	k3d_data(k3d::int32_t, immutable_name, change_signal, no_undo, local_storage, no_constraint, read_only_property, no_serialization) m_drawn_nodes;
+	k3d_data(k3d::int32_t, immutable_name, change_signal, no_undo, local_storage, no_constraint, read_only_property, no_serialization) m_culled_nodes;
 	k3d_data(k3d::inode_selection*, k3d::data::immutable_name, k3d::data::change_signal, k3d::data::with_undo, k3d::data::node_storage, k3d::data::no_constraint, k3d::data::node_property, k3d::data::node_serialization) m_node_selection;
 	sigc::connection m_selection_changed_connection;
 };
@@ -48,6 +48,7 @@ CompareArgs::CompareArgs()
 	FieldOfView = 45.0f;
 	Gamma = 2.2f;
 	ThresholdPixels = 100;
+	StopAtThreshold = false;
 	Luminance = 100.0f;
 	FailedPixels = 0;
 }
@@ -37,6 +37,7 @@ public:
 	float			Gamma;				// The gamma to convert to linear color space
 	float			Luminance;			// the display's luminance
 	unsigned int		ThresholdPixels;	// How many pixels different to ignore
+	bool			StopAtThreshold;	// Stop testing once ThresholdPixels pixels differ (ignored when ImgDiff is set)
 
 	std::string		ErrorStr;			// Result: Error string
 	unsigned int		FailedPixels;		// Result: How many pixels are different
@@ -16,6 +16,66 @@ if not, write to the Free Software Foundation, Inc., 59 Temple Place, Suite 330,
 
 #include "LPyramid.h"
 
+#include <k3dsdk/parallel/blocked_range.h>
+#include <k3dsdk/parallel/parallel_for.h>
+
+// Convolves a range of rows of one pyramid level
+class ConvolveWorker
+{
+public:
+	ConvolveWorker(float *a, const float *b, int width, int height) :
+		A(a), B(b), Width(width), Height(height)
+	{
+		const float Kernel[] = {0.05f, 0.25f, 0.4f, 0.25f, 0.05f};
+		for (int i = 0; i < 5; i++) {
+			for (int j = 0; j < 5; j++) {
+				Weights[i][j] = Kernel[i] * Kernel[j];
+			}
+		}
+	}
+
+	void operator()(const k3d::parallel::blocked_range<int> &range) const
+	{
+		int y,x,i,j,nx,ny;
+		for (y=range.begin(); y!=range.end(); y++) {
+			const bool interior_row = y >= 2 && y < Height - 2;
+			for (x=0; x<Width; x++) {
+				int index = y * Width + x;
+				float sum = 0.0f;
+				if (interior_row && x >= 2 && x < Width - 2) {
+					// No reflection needed, so skip the edge tests (the summation order is unchanged) ...
+					for (i=-2; i<=2; i++) {
+						const float *column = B + index + i;
+						for (j=-2; j<=2; j++) {
+							sum += Weights[i+2][j+2] * column[j * Width];
+						}
+					}
+				} else {
+					for (i=-2; i<=2; i++) {
+						for (j=-2; j<=2; j++) {
+							nx=x+i;
+							ny=y+j;
+							if (nx<0) nx=-nx;
+							if (ny<0) ny=-ny;
+							if (nx>=Width) nx=2*(Width-1)-nx;
+							if (ny>=Height) ny=2*(Height-1)-ny;
+							sum += Weights[i+2][j+2] * B[ny * Width + nx];
+						}
+					}
+				}
+				A[index] = sum;
+			}
+		}
+	}
+
+private:
+	float *A;
+	const float *B;
+	int Width;
+	int Height;
+	float Weights[5][5];
+};
+
 
 //////////////////////////////////////////////////////////////////////
 // Construction/Destruction
@@ -40,7 +100,7 @@ LPyramid::LPyramid(float *image, int width, int height) :
 LPyramid::~LPyramid()
 {
 	for (int i=0; i<MAX_PYR_LEVELS; i++) {
-		if (Levels[i]) delete Levels[i];
+		if (Levels[i]) delete[] Levels[i];
 	}
 }
 
@@ -56,26 +116,9 @@ float *LPyramid::Copy(float *img)
 void LPyramid::Convolve(float *a, float *b)
 // convolves image b with the filter kernel and stores it in a
 {
-	int y,x,i,j,nx,ny;
-	const float Kernel[] = {0.05f, 0.25f, 0.4f, 0.25f, 0.05f};
-
-	for (y=0; y<Height; y++) {
-		for (x=0; x<Width; x++) {
-			int index = y * Width + x;
-			a[index] = 0.0f;
-			for (i=-2; i<=2; i++) {
-				for (j=-2; j<=2; j++) {
-					nx=x+i;
-					ny=y+j;
-					if (nx<0) nx=-nx;
-					if (ny<0) ny=-ny;
-					if (nx>=Width) nx=2*(Width-1)-nx;
-					if (ny>=Height) ny=2*(Height-1)-ny;
-					a[index] += Kernel[i+2] * Kernel[j+2] * b[ny * Width + nx];
-				} 
-			}
-		}
-	}
+	k3d::parallel::parallel_for(
+		k3d::parallel::blocked_range<int>(0, Height, 16),
+		ConvolveWorker(a, b, Width, Height));
 }
 
 float LPyramid::Get_Value(int x, int y, int level)
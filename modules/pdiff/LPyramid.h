@@ -24,6 +24,7 @@ public:
 	LPyramid(float *image, int width, int height);
 	virtual ~LPyramid();
 	float Get_Value(int x, int y, int level);
+	const float *Get_Level(int level) const { return Levels[level]; }
 protected:
 	float *Copy(float *img);
 	void Convolve(float *a, float *b);
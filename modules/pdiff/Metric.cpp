@@ -20,7 +20,11 @@ if not, write to the Free Software Foundation, Inc., 59 Temple Place, Suite 330,
 #include "LPyramid.h"
 #include <math.h>
 
+#include <k3dsdk/parallel/blocked_range.h>
+#include <k3dsdk/parallel/parallel_for.h>
+
 #include <cstdio>
+#include <vector>
 
 #ifndef M_PI
 #define M_PI 3.14159265f
@@ -59,18 +63,28 @@ float tvi(float adaptation_luminance)
 
 } 
 
+// computes the luminance-dependent terms of the contrast sensitivity function,
+// so they can be shared by every pyramid level at a pixel
+void csf_terms(float lum, float &a, float &b)
+{
+	a = 440.0f * powf((1.0f + 0.7f / lum), -0.2f);
+	b = 0.3f * powf((1.0f + 100.0f / lum), 0.15f);
+}
+
+// computes the contrast sensitivity function (Barten SPIE 1989)
+// given the cycles per degree (cpd) and the terms from csf_terms()
+float csf(float cpd, float a, float b)
+{
+	return a * cpd * expf(-b * cpd) * sqrtf(1.0f + 0.06f * expf(b * cpd));
+}
+
 // computes the contrast sensitivity function (Barten SPIE 1989)
 // given the cycles per degree (cpd) and luminance (lum)
 float csf(float cpd, float lum)
 {
-	float a, b, result; 
-	
-	a = 440.0f * powf((1.0f + 0.7f / lum), -0.2f);
-	b = 0.3f * powf((1.0f + 100.0f / lum), 0.15f);
-		
-	result = a * cpd * expf(-b * cpd) * sqrtf(1.0f + 0.06f * expf(b * cpd)); 
-	
-	return result;	
+	float a, b;
+	csf_terms(lum, a, b);
+	return csf(cpd, a, b);
 }
 
 /*
@@ -96,22 +110,16 @@ void AdobeRGBToXYZ(float r, float g, float b, float &x, float &y, float &z)
 	z = r * 0.0270328f + g * 0.0706879f + b * 0.991248f;
 }
 
-void XYZToLAB(float x, float y, float z, float &L, float &A, float &B)
+// convert XYZ to LAB, given the XYZ coordinates of the reference white
+void XYZToLAB(float x, float y, float z, const float white[3], float &L, float &A, float &B)
 {
-	static float xw = -1;
-	static float yw;
-	static float zw;
-	// reference white
-	if (xw < 0) {
-		AdobeRGBToXYZ(1, 1, 1, xw, yw, zw);
-	}
 	const float epsilon  = 216.0f / 24389.0f;
 	const float kappa = 24389.0f / 27.0f;
 	float f[3];
 	float r[3];
-	r[0] = x / xw;
-	r[1] = y / yw;
-	r[2] = z / zw;
+	r[0] = x / white[0];
+	r[1] = y / white[1];
+	r[2] = z / white[2];
 	for (int i = 0; i < 3; i++) {
 		if (r[i] > epsilon) {
 			f[i] = powf(r[i], 1.0f / 3.0f);
@@ -124,6 +132,183 @@ void XYZToLAB(float x, float y, float z, float &L, float &A, float &B)
 	B = 200.0f * (f[1] - f[2]);
 }
 
+// Number of image rows processed together by one task
+#define TILE_ROWS 16
+// Number of tiles tested between checks of the failure threshold, when stopping early
+#define TILES_PER_WAVE 8
+
+// Converts one image to luminance and the A, B color channels, a tile of rows at a time
+class ConvertWorker
+{
+public:
+	ConvertWorker(RGBAImage &img, const float *gamma, const float *white, float luminance, float *lum, float *a, float *b) :
+		Img(img), Gamma(gamma), White(white), Luminance(luminance), Lum(lum), A(a), B(b)
+	{
+	}
+
+	void operator()(const k3d::parallel::blocked_range<unsigned int> &range) const
+	{
+		const unsigned int w = Img.Get_Width();
+		for (unsigned int y = range.begin(); y != range.end(); y++) {
+			for (unsigned int x = 0; x < w; x++) {
+				unsigned int i = x + y * w;
+				float r, g, b, X, Y, Z, l;
+				// the gamma table holds powf(c / 255.0f, gamma) for every channel value c
+				r = Gamma[Img.Get_Red(i)];
+				g = Gamma[Img.Get_Green(i)];
+				b = Gamma[Img.Get_Blue(i)];
+				AdobeRGBToXYZ(r,g,b,X,Y,Z);
+				XYZToLAB(X, Y, Z, White, l, A[i], B[i]);
+				Lum[i] = Y * Luminance;
+			}
+		}
+	}
+
+private:
+	RGBAImage &Img;
+	const float *Gamma;
+	const float *White;
+	float Luminance;
+	float *Lum;
+	float *A;
+	float *B;
+};
+
+// Builds both Laplacian pyramids concurrently
+class PyramidWorker
+{
+public:
+	PyramidWorker(float *aLum, float *bLum, int w, int h, LPyramid **la, LPyramid **lb) :
+		ALum(aLum), BLum(bLum), Width(w), Height(h), LA(la), LB(lb)
+	{
+	}
+
+	void operator()(const k3d::parallel::blocked_range<unsigned int> &range) const
+	{
+		for (unsigned int i = range.begin(); i != range.end(); i++) {
+			if (i == 0)
+				*LA = new LPyramid(ALum, Width, Height);
+			else
+				*LB = new LPyramid(BLum, Width, Height);
+		}
+	}
+
+private:
+	float *ALum;
+	float *BLum;
+	int Width;
+	int Height;
+	LPyramid **LA;
+	LPyramid **LB;
+};
+
+// Tests every pixel in a range of tiles, storing the number of failed pixels for each tile
+class TestWorker
+{
+public:
+	TestWorker(CompareArgs &args, const LPyramid &la, const LPyramid &lb,
+		const float *aA, const float *bA, const float *aB, const float *bB,
+		const float *cpd, const float *F_freq, unsigned int adaptation_level,
+		std::vector<unsigned int> &failures) :
+		Args(args), LA(la), LB(lb), AA(aA), BA(bA), AB(aB), BB(bB),
+		Cpd(cpd), FFreq(F_freq), AdaptationLevel(adaptation_level), Failures(failures)
+	{
+	}
+
+	void operator()(const k3d::parallel::blocked_range<unsigned int> &range) const
+	{
+		const unsigned int w = Args.ImgA->Get_Width();
+		const unsigned int h = Args.ImgA->Get_Height();
+		for (unsigned int tile = range.begin(); tile != range.end(); tile++) {
+			const unsigned int y_begin = tile * TILE_ROWS;
+			const unsigned int y_end = (y_begin + TILE_ROWS < h) ? y_begin + TILE_ROWS : h;
+			unsigned int failures = 0;
+			for (unsigned int y = y_begin; y < y_end; y++) {
+				for (unsigned int x = 0; x < w; x++) {
+					if (!Test(x + y * w)) failures++;
+				}
+			}
+			Failures[tile] = failures;
+		}
+	}
+
+private:
+	// returns true if the pixel passes, exactly as the original serial loop did
+	bool Test(unsigned int index) const
+	{
+		unsigned int i;
+		float contrast[MAX_PYR_LEVELS - 2];
+		float sum_contrast = 0;
+		for (i = 0; i < MAX_PYR_LEVELS - 2; i++) {
+			float n1 = fabsf(LA.Get_Level(i)[index] - LA.Get_Level(i + 1)[index]);
+			float n2 = fabsf(LB.Get_Level(i)[index] - LB.Get_Level(i + 1)[index]);
+			float numerator = (n1 > n2) ? n1 : n2;
+			float d1 = fabsf(LA.Get_Level(i + 2)[index]);
+			float d2 = fabsf(LB.Get_Level(i + 2)[index]);
+			float denominator = (d1 > d2) ? d1 : d2;
+			if (denominator < 1e-5f) denominator = 1e-5f;
+			contrast[i] = numerator / denominator;
+			sum_contrast += contrast[i];
+		}
+		if (sum_contrast < 1e-5) sum_contrast = 1e-5f;
+		float adapt = LA.Get_Level(AdaptationLevel)[index] + LB.Get_Level(AdaptationLevel)[index];
+		adapt *= 0.5f;
+		if (adapt < 1e-5) adapt = 1e-5f;
+		// the luminance terms of csf() are the same for every level
+		float csf_a, csf_b;
+		csf_terms(adapt, csf_a, csf_b);
+		float factor = 0;
+		for (i = 0; i < MAX_PYR_LEVELS - 2; i++) {
+			float F_mask = mask(contrast[i] * csf(Cpd[i], csf_a, csf_b));
+			factor += contrast[i] * FFreq[i] * F_mask / sum_contrast;
+		}
+		if (factor < 1) factor = 1;
+		if (factor > 10) factor = 10;
+		float delta = fabsf(LA.Get_Level(0)[index] - LB.Get_Level(0)[index]);
+		bool pass = true;
+		// pure luminance test
+		if (delta > factor * tvi(adapt)) {
+			pass = false;
+		} else {
+			// CIE delta E test with modifications
+			float color_scale = 1.0f;
+			// ramp down the color test in scotopic regions
+			if (adapt < 10.0f) {
+				color_scale = 1.0f - (10.0f - color_scale) / 10.0f;
+				color_scale = color_scale * color_scale;
+			}
+			float da = AA[index] - BA[index];
+			float db = AB[index] - BB[index];
+			da = da * da;
+			db = db * db;
+			float delta_e = (da + db) * color_scale;
+			if (delta_e > factor) {
+				pass = false;
+			}
+		}
+		if (Args.ImgDiff) {
+			if (!pass) {
+				Args.ImgDiff->Set(255, 0, 0, 255, index);
+			} else {
+				Args.ImgDiff->Set(0, 0, 0, 255, index);
+			}
+		}
+		return pass;
+	}
+
+	CompareArgs &Args;
+	const LPyramid &LA;
+	const LPyramid &LB;
+	const float *AA;
+	const float *BA;
+	const float *AB;
+	const float *BB;
+	const float *Cpd;
+	const float *FFreq;
+	unsigned int AdaptationLevel;
+	std::vector<unsigned int> &Failures;
+};
+
 bool Yee_Compare(CompareArgs &args)
 {
 	args.FailedPixels = 0;
@@ -149,48 +334,42 @@ bool Yee_Compare(CompareArgs &args)
 	}
 	
 	// assuming colorspaces are in Adobe RGB (1998) convert to XYZ
-	float *aX = new float[dim];
-	float *aY = new float[dim];
-	float *aZ = new float[dim];
-	float *bX = new float[dim];
-	float *bY = new float[dim];
-	float *bZ = new float[dim];
-	float *aLum = new float[dim];
-	float *bLum = new float[dim];
+	std::vector<float> aLum(dim);
+	std::vector<float> bLum(dim);
 	
-	float *aA = new float[dim];
-	float *bA = new float[dim];
-	float *aB = new float[dim];
-	float *bB = new float[dim];
+	std::vector<float> aA(dim);
+	std::vector<float> bA(dim);
+	std::vector<float> aB(dim);
+	std::vector<float> bB(dim);
 
 	if (args.Verbose) printf("Converting RGB to XYZ\n");
 	
-	unsigned int x, y, w, h;
+	unsigned int w, h;
 	w = args.ImgA->Get_Width();
 	h = args.ImgA->Get_Height();
-	for (y = 0; y < h; y++) {
-		for (x = 0; x < w; x++) {
-			float r, g, b, l;
-			i = x + y * w;
-			r = powf(args.ImgA->Get_Red(i) / 255.0f, args.Gamma);
-			g = powf(args.ImgA->Get_Green(i) / 255.0f, args.Gamma);
-			b = powf(args.ImgA->Get_Blue(i) / 255.0f, args.Gamma);						
-			AdobeRGBToXYZ(r,g,b,aX[i],aY[i],aZ[i]);			
-			XYZToLAB(aX[i], aY[i], aZ[i], l, aA[i], aB[i]);
-			r = powf(args.ImgB->Get_Red(i) / 255.0f, args.Gamma);
-			g = powf(args.ImgB->Get_Green(i) / 255.0f, args.Gamma);
-			b = powf(args.ImgB->Get_Blue(i) / 255.0f, args.Gamma);						
-			AdobeRGBToXYZ(r,g,b,bX[i],bY[i],bZ[i]);
-			XYZToLAB(bX[i], bY[i], bZ[i], l, bA[i], bB[i]);
-			aLum[i] = aY[i] * args.Luminance;
-			bLum[i] = bY[i] * args.Luminance;
-		}
-	}
+
+	// there are only 256 possible channel values, so the gamma curve is tabulated up-front
+	float gamma[256];
+	for (i = 0; i < 256; i++) gamma[i] = powf(static_cast<unsigned char>(i) / 255.0f, args.Gamma);
+
+	// reference white
+	float white[3];
+	AdobeRGBToXYZ(1, 1, 1, white[0], white[1], white[2]);
+
+	k3d::parallel::parallel_for(
+		k3d::parallel::blocked_range<unsigned int>(0, h, TILE_ROWS),
+		ConvertWorker(*args.ImgA, gamma, white, args.Luminance, &aLum[0], &aA[0], &aB[0]));
+	k3d::parallel::parallel_for(
+		k3d::parallel::blocked_range<unsigned int>(0, h, TILE_ROWS),
+		ConvertWorker(*args.ImgB, gamma, white, args.Luminance, &bLum[0], &bA[0], &bB[0]));
 	
 	if (args.Verbose) printf("Constructing Laplacian Pyramids\n");
 	
-	LPyramid *la = new LPyramid(aLum, w, h);
-	LPyramid *lb = new LPyramid(bLum, w, h);
+	LPyramid *la = 0;
+	LPyramid *lb = 0;
+	k3d::parallel::parallel_for(
+		k3d::parallel::blocked_range<unsigned int>(0, 2, 1),
+		PyramidWorker(&aLum[0], &bLum[0], w, h, &la, &lb));
 	
 	float num_one_degree_pixels = (float) (2 * tan( args.FieldOfView * 0.5 * M_PI / 180) * 180 / M_PI);
 	float pixels_per_degree = w / num_one_degree_pixels;
@@ -212,86 +391,28 @@ bool Yee_Compare(CompareArgs &args)
 	
 	float F_freq[MAX_PYR_LEVELS - 2];
 	for (i = 0; i < MAX_PYR_LEVELS - 2; i++) F_freq[i] = csf_max / csf( cpd[i], 100.0f);
-	
-	for (y = 0; y < h; y++) {
-	  for (x = 0; x < w; x++) {
-		int index = x + y * w;
-		float contrast[MAX_PYR_LEVELS - 2];
-		float sum_contrast = 0;
-		for (i = 0; i < MAX_PYR_LEVELS - 2; i++) {
-			float n1 = fabsf(la->Get_Value(x,y,i) - la->Get_Value(x,y,i + 1));
-			float n2 = fabsf(lb->Get_Value(x,y,i) - lb->Get_Value(x,y,i + 1));
-			float numerator = (n1 > n2) ? n1 : n2;
-			float d1 = fabsf(la->Get_Value(x,y,i+2));
-			float d2 = fabsf(lb->Get_Value(x,y,i+2));
-			float denominator = (d1 > d2) ? d1 : d2;
-			if (denominator < 1e-5f) denominator = 1e-5f;
-			contrast[i] = numerator / denominator;
-			sum_contrast += contrast[i];
-		}
-		if (sum_contrast < 1e-5) sum_contrast = 1e-5f;
-		float F_mask[MAX_PYR_LEVELS - 2];
-		float adapt = la->Get_Value(x,y,adaptation_level) + lb->Get_Value(x,y,adaptation_level);
-		adapt *= 0.5f;
-		if (adapt < 1e-5) adapt = 1e-5f;
-		for (i = 0; i < MAX_PYR_LEVELS - 2; i++) {
-			F_mask[i] = mask(contrast[i] * csf(cpd[i], adapt)); 
-		}
-		float factor = 0;
-		for (i = 0; i < MAX_PYR_LEVELS - 2; i++) {
-			factor += contrast[i] * F_freq[i] * F_mask[i] / sum_contrast;
-		}
-		if (factor < 1) factor = 1;
-		if (factor > 10) factor = 10;
-		float delta = fabsf(la->Get_Value(x,y,0) - lb->Get_Value(x,y,0));
-		bool pass = true;
-		// pure luminance test
-		if (delta > factor * tvi(adapt)) {
-			pass = false;
-		} else {
-			// CIE delta E test with modifications
-			float color_scale = 1.0f;
-			// ramp down the color test in scotopic regions
-			if (adapt < 10.0f) {
-				color_scale = 1.0f - (10.0f - color_scale) / 10.0f;
-				color_scale = color_scale * color_scale;
-			}
-			float da = aA[index] - bA[index];
-			float db = aB[index] - bB[index];
-			da = da * da;
-			db = db * db;
-			float delta_e = (da + db) * color_scale;
-			if (delta_e > factor) {
-				pass = false;
-			}
-		}
-		if (!pass) {
-			args.FailedPixels++;
-			if (args.ImgDiff) {
-				args.ImgDiff->Set(255, 0, 0, 255, index);
-			}
-		} else {
-			if (args.ImgDiff) {
-				args.ImgDiff->Set(0, 0, 0, 255, index);
-			}
-		}
-	  }
+
+	// Test tiles of rows in parallel.  When the caller only needs pass / fail, test a wave of tiles at a time
+	// and stop as soon as the failure threshold is reached, since testing further tiles can't change the result.
+	const unsigned int tile_count = (h + TILE_ROWS - 1) / TILE_ROWS;
+	std::vector<unsigned int> failures(tile_count, 0);
+	TestWorker test_worker(args, *la, *lb, &aA[0], &bA[0], &aB[0], &bB[0], cpd, F_freq, adaptation_level, failures);
+
+	const bool early_out = args.StopAtThreshold && !args.ImgDiff;
+	const unsigned int wave_size = early_out ? TILES_PER_WAVE : tile_count;
+	for (unsigned int wave_begin = 0; wave_begin < tile_count; wave_begin += wave_size) {
+		const unsigned int wave_end = (wave_begin + wave_size < tile_count) ? wave_begin + wave_size : tile_count;
+		k3d::parallel::parallel_for(
+			k3d::parallel::blocked_range<unsigned int>(wave_begin, wave_end, 1),
+			test_worker);
+
+		for (i = wave_begin; i < wave_end; i++) args.FailedPixels += failures[i];
+
+		if (early_out && args.FailedPixels >= args.ThresholdPixels) break;
 	}
 	
-	if (aX) delete[] aX;
-	if (aY) delete[] aY;
-	if (aZ) delete[] aZ;
-	if (bX) delete[] bX;
-	if (bY) delete[] bY;
-	if (bZ) delete[] bZ;
-	if (aLum) delete[] aLum;
-	if (bLum) delete[] bLum;
-	if (la) delete la;
-	if (lb) delete lb;
-	if (aA) delete[] aA;
-	if (bA) delete[] bA;
-	if (aB) delete[] aB;
-	if (bB) delete[] bB;
+	delete la;
+	delete lb;
 	
 	if (args.FailedPixels < args.ThresholdPixels) {
 		args.ErrorStr = "Images are perceptually indistinguishable\n";
@@ -30,6 +30,7 @@
 #include <k3dsdk/document_plugin_factory.h>
 #include <k3dsdk/hints.h>
 #include <k3dsdk/ibitmap_source.h>
+#include <k3dsdk/measurement.h>
 #include <k3dsdk/pointer_demand_storage.h>
 #include <k3dsdk/value_demand_storage.h>
 #include <k3dsdk/node.h>
@@ -58,6 +59,7 @@ public:
 		m_field_of_view(init_owner(*this) + init_name("field_of_view") + init_label(_("Field-of-view")) + init_description(_("Field-of-view (degrees)")) + init_value(45.0) + init_step_increment(0.01)),
 		m_gamma(init_owner(*this) + init_name("gamma") + init_label(_("Gamma")) + init_description(_("Gamma")) + init_value(2.2) + init_step_increment(0.01)),
 		m_luminance(init_owner(*this) + init_name("luminance") + init_label(_("Luminance")) + init_description(_("Display Luminance (candela per square meter)")) + init_value(100.0) + init_step_increment(1.0)),
+		m_difference_limit(init_owner(*this) + init_name("difference_limit") + init_label(_("Difference Limit")) + init_description(_("Stop testing once this many pixels are perceivably different, for callers that only need pass / fail.  Zero tests every pixel.")) + init_value(0L) + init_step_increment(1) + init_units(typeid(k3d::measurement::scalar)) + init_constraint(constraint::minimum<k3d::int32_t>(0))),
 		m_difference(init_owner(*this) + init_name("difference") + init_label(_("Difference")) + init_description(_("The count of perceivably-different pixels")) + init_value(std::numeric_limits<k3d::uint32_t>::max())),
 		m_output_bitmap(init_owner(*this) + init_name("output_bitmap") + init_label(_("Output Bitmap")) + init_description(_("Output bitmap")))
 	{
@@ -74,6 +76,8 @@ public:
 			k3d::hint::convert<k3d::hint::any, k3d::hint::none> >(m_difference.make_slot()));
 		m_luminance.changed_signal().connect(k3d::hint::converter<
 			k3d::hint::convert<k3d::hint::any, k3d::hint::none> >(m_difference.make_slot()));
+		m_difference_limit.changed_signal().connect(k3d::hint::converter<
+			k3d::hint::convert<k3d::hint::any, k3d::hint::none> >(m_difference.make_slot()));
 
 		m_bitmap_a.changed_signal().connect(k3d::hint::converter<
 			k3d::hint::convert<k3d::hint::any, k3d::hint::none> >(m_output_bitmap.make_slot()));
@@ -108,15 +112,18 @@ public:
 		if(bitmap_a->width() != bitmap_b->width() || bitmap_a->height() != bitmap_b->height())
 			return;
 
+		// We only need the count here, so skip the difference image and stop early if the caller has set a limit ...
+		const k3d::int32_t difference_limit = m_difference_limit.pipeline_value();
+
 		CompareArgs args;
 		args.ImgA = convert(*bitmap_a);
 		args.ImgB = convert(*bitmap_b);
-		args.ImgDiff = new RGBAImage(bitmap_a->width(), bitmap_a->height());
 		args.Verbose = false;
 		args.FieldOfView = m_field_of_view.pipeline_value();
 		args.Gamma = m_gamma.pipeline_value();
 		args.Luminance = m_luminance.pipeline_value();
-		args.ThresholdPixels = 0;
+		args.ThresholdPixels = difference_limit;
+		args.StopAtThreshold = difference_limit > 0;
 
 		Yee_Compare(args);
 	
@@ -212,6 +219,7 @@ private:
 	k3d_data(double, immutable_name, change_signal, with_undo, local_storage, no_constraint, writable_property, with_serialization) m_field_of_view;
 	k3d_data(double, immutable_name, change_signal, with_undo, local_storage, no_constraint, writable_property, with_serialization) m_gamma;
 	k3d_data(double, immutable_name, change_signal, with_undo, local_storage, no_constraint, writable_property, with_serialization) m_luminance;
+	k3d_data(k3d::int32_t, immutable_name, change_signal, with_undo, local_storage, with_constraint, measurement_property, with_serialization) m_difference_limit;
 	k3d_data(k3d::uint32_t, immutable_name, change_signal, no_undo, value_demand_storage, no_constraint, read_only_property, no_serialization) m_difference;
 	k3d_data(k3d::bitmap*, immutable_name, change_signal, no_undo, pointer_demand_storage, no_constraint, read_only_property, no_serialization) m_output_bitmap;
 };
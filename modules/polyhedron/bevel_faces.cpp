@@ -21,18 +21,21 @@
 		\author Romain Behar <romainbehar@yahoo.com>
 */
 
+#include <k3d-i18n-config.h>
 #include <k3dsdk/basic_math.h>
 #include <k3dsdk/document_plugin_factory.h>
 #include <k3dsdk/geometry.h>
+#include <k3dsdk/hints.h>
 #include <k3dsdk/measurement.h>
-#include <k3dsdk/legacy_mesh_modifier.h>
+#include <k3dsdk/mesh_modifier.h>
 #include <k3dsdk/mesh_selection_sink.h>
 #include <k3dsdk/node.h>
-#include <k3dsdk/selection.h>
-#include <k3dsdk/utility.h>
+#include <k3dsdk/polyhedron.h>
+#include <k3dsdk/table_copier.h>
 
-#include "helpers.h"
+#include <boost/scoped_ptr.hpp>
 
+#include <map>
 #include <set>
 
 namespace module
@@ -41,388 +44,615 @@ namespace module
 namespace polyhedron
 {
 
-namespace detail
+/////////////////////////////////////////////////////////////////////////////
+// bevel_faces
+
+/// Bevels selected faces: the points of each face are inset, and the edges that leave the face are split, so the
+/// faces around the bevelled face are cut back to make room for a ring of new "side" faces.  Where bevelled faces
+/// meet, each face is inset onto its own copies of the shared points, the gap along each shared edge is filled with
+/// a new "strip" face, and the gap around each shared point is closed with a new "corner" face.
+///
+/// Selected faces with holes, degenerate faces, and faces with a point that isn't surrounded by a closed fan of
+/// faces without holes (e.g. on a boundary) are left unchanged, and counted in a warning.
+class bevel_faces :
+	public k3d::mesh_selection_sink<k3d::mesh_modifier<k3d::node > >
 {
+	typedef k3d::mesh_selection_sink<k3d::mesh_modifier<k3d::node > > base;
 
-/// Caches new geometry for better interactive performance
-class bevel_edge
-{
 public:
-	bevel_edge(const k3d::point3& StartPosition, const k3d::point3& EndPosition, k3d::legacy::point* Point) :
-		start_position(StartPosition),
-		end_position(EndPosition),
-		point(Point)
+	bevel_faces(k3d::iplugin_factory& Factory, k3d::idocument& Document) :
+		base(Factory, Document),
+		m_offset(init_owner(*this) + init_name("offset") + init_label(_("Offset")) + init_description(_("Offset along external edges")) + init_value(0.3) + init_step_increment(0.1) + init_units(typeid(k3d::measurement::distance))),
+		m_inset(init_owner(*this) + init_name("inset") + init_label(_("Inset")) + init_description(_("Inset of bevelled face")) + init_value(0.3) + init_step_increment(0.01) + init_units(typeid(k3d::measurement::distance))),
+		m_distance(init_owner(*this) + init_name("distance") + init_label(_("Distance")) + init_description(_("Use distance instead of edge offset")) + init_value(false)),
+		m_select_side_faces(init_owner(*this) + init_name("select_side_faces") + init_label(_("Select side faces")) + init_description(_("Select side faces on output, doesn't change selection if off")) + init_value(true))
 	{
+		m_mesh_selection.changed_signal().connect(k3d::hint::converter<
+			k3d::hint::convert<k3d::hint::any, k3d::hint::mesh_topology_changed> >(make_reset_mesh_slot()));
+		m_select_side_faces.changed_signal().connect(k3d::hint::converter<
+			k3d::hint::convert<k3d::hint::any, k3d::hint::mesh_topology_changed> >(make_reset_mesh_slot()));
+
+		m_offset.changed_signal().connect(k3d::hint::converter<
+			k3d::hint::convert<k3d::hint::any, k3d::hint::mesh_geometry_changed> >(make_update_mesh_slot()));
+		m_inset.changed_signal().connect(k3d::hint::converter<
+			k3d::hint::convert<k3d::hint::any, k3d::hint::mesh_geometry_changed> >(make_update_mesh_slot()));
+		m_distance.changed_signal().connect(k3d::hint::converter<
+			k3d::hint::convert<k3d::hint::any, k3d::hint::mesh_geometry_changed> >(make_update_mesh_slot()));
 	}
 
-	void update(const double Offset, const bool Length)
+	void on_create_mesh(const k3d::mesh& Input, k3d::mesh& Output)
 	{
-		double edge_offset = Offset;
-		if(!Length)
-		{
-			// Offset gives position on the edge
-			if(Offset > 1)
-				edge_offset = 1;
-		}
-		else
-		{
-			// Offset is a length from start_position
-			const double length = k3d::distance(end_position, start_position);
-			if(length)
-				edge_offset = Offset / length;
-		}
+		Output = Input;
+		k3d::geometry::selection::merge(m_mesh_selection.pipeline_value(), Output);
 
-		point->position = start_position + (end_position - start_position) * edge_offset;
-	}
+		// Clear previously cached data ...
+		m_edge_points.clear();
+		m_face_points.clear();
 
-private:
-	k3d::point3 start_position;
-	k3d::point3 end_position;
-	k3d::legacy::point* point;
-};
+		if(!Output.points)
+			return;
+		if(!Output.point_selection)
+			return;
 
-typedef std::vector<bevel_edge> bevel_edges_t;
+		const k3d::bool_t select_side_faces = m_select_side_faces.pipeline_value();
 
-class face_point
-{
-public:
-	face_point(const k3d::point3& OldPosition, const k3d::vector3& InsetDirection, k3d::legacy::point& Point) :
-		old_position(OldPosition),
-		inset_direction(InsetDirection),
-		point(&Point)
-	{
-	}
+		k3d::mesh::points_t& points = Output.points.writable();
+		k3d::mesh::selection_t& point_selection = Output.point_selection.writable();
+		k3d::table_copier point_attributes(Output.point_attributes);
 
-	void update(const double Inset)
-	{
-		point->position = old_position + (Inset * inset_direction);
-	}
+		for(k3d::mesh::primitives_t::iterator primitive = Output.primitives.begin(); primitive != Output.primitives.end(); ++primitive)
+		{
+			boost::scoped_ptr<k3d::polyhedron::primitive> polyhedron(k3d::polyhedron::validate(Output, *primitive));
+			if(!polyhedron)
+				continue;
+
+			// Identify selected faces, so we can skip the rest of the work for polyhedra without any ...
+			k3d::mesh::indices_t selected_faces;
+			k3d::uint_t skipped_faces = 0;
+			const k3d::uint_t face_begin = 0;
+			const k3d::uint_t face_end = face_begin + polyhedron->face_shells.size();
+			for(k3d::uint_t face = face_begin; face != face_end; ++face)
+			{
+				if(!polyhedron->face_selections[face])
+					continue;
 
-private:
-	k3d::point3 old_position;
-	k3d::vector3 inset_direction;
-	k3d::legacy::point* point;
-};
+				if(polyhedron->face_loop_counts[face] != 1)
+				{
+					++skipped_faces;
+					continue;
+				}
 
-typedef std::vector<face_point> face_points_t;
+				selected_faces.push_back(face);
+			}
 
-/// Bevel point function
-typedef std::vector<k3d::legacy::split_edge*> edges_t;
-typedef std::map<k3d::legacy::point*, edges_t> points_and_edges_t;
-typedef std::map<k3d::legacy::point*, k3d::imaterial*> point_materials_t;
-typedef std::vector<k3d::legacy::face*> faces_t;
+			k3d::mesh::bools_t boundary_edges;
+			k3d::mesh::indices_t adjacent_edges;
+			k3d::mesh::indices_t edge_faces;
+			if(selected_faces.size())
+			{
+				k3d::polyhedron::create_edge_adjacency_lookup(polyhedron->vertex_points, polyhedron->clockwise_edges, boundary_edges, adjacent_edges);
+				k3d::polyhedron::create_edge_face_lookup(*polyhedron, edge_faces);
+			}
 
-typedef std::vector<edges_t> edge_lists_t;
-edge_lists_t link_edges;
+			// Choose the faces to be bevelled.  Each must be non-degenerate, and each of its points must be surrounded by a
+			// closed fan of faces without holes ...
+			k3d::mesh::bools_t bevelled_faces(polyhedron->face_shells.size(), false);
+			std::map<k3d::uint_t, k3d::mesh::indices_t> fans;
+			for(k3d::mesh::indices_t::const_iterator face = selected_faces.begin(); face != selected_faces.end(); ++face)
+			{
+				const k3d::uint_t first_edge = polyhedron->loop_first_edges[polyhedron->face_first_loops[*face]];
 
-typedef std::map<k3d::legacy::split_edge*, k3d::legacy::face*> edge_to_face_t;
+				k3d::bool_t valid = 0.0 != k3d::polyhedron::normal(polyhedron->vertex_points, polyhedron->clockwise_edges, points, first_edge).length2();
+				for(k3d::uint_t edge = first_edge; valid; )
+				{
+					const k3d::uint_t point = polyhedron->vertex_points[edge];
+					if(!fans.count(point))
+						create_fan(*polyhedron, boundary_edges, adjacent_edges, edge_faces, edge, fans[point]);
+					if(fans[point].empty())
+						valid = false;
+
+					edge = polyhedron->clockwise_edges[edge];
+					if(edge == first_edge)
+						break;
+				}
 
-// Subdivide edges
-bool subdivide_edges(k3d::legacy::face& Face, k3d::legacy::mesh& Mesh, bevel_edges_t& BevelEdges, face_points_t& FacePoints, edge_to_face_t& EdgeToFace)
-{
-	// Calculate the face normal
-	k3d::normal3 face_normal = k3d::legacy::normal(Face);
-	if(0.0 == face_normal.length2())
-		return false;
+				if(valid)
+					bevelled_faces[*face] = true;
+				else
+					++skipped_faces;
+			}
 
-	face_normal = k3d::normalize(face_normal);
+			if(skipped_faces)
+				k3d::log() << warning << "BevelFaces skipped " << skipped_faces << " selected faces that have holes, are degenerate, or touch a boundary or a face with holes." << std::endl;
 
-	// Store face edges
-	edges_t face_edges;
-	k3d::legacy::split_edge* edge = Face.first_edge;
-	do
-	{
-		face_edges.push_back(edge);
+			// Give each bevelled face its own inset point at every corner, reusing the original point for the first face around
+			// each point.  Split the edges between pairs of faces that aren't bevelled, so those faces can be cut back ...
+			std::map<k3d::uint_t, k3d::uint_t> corner_points;
+			std::map<k3d::uint_t, k3d::uint_t> split_points;
+			std::map<k3d::uint_t, k3d::uint_t> bevelled_counts;
+			std::set<k3d::uint_t> cut_faces;
+			std::vector<new_face> corner_faces;
 
-		edge = edge->face_clockwise;
-	}
-	while(edge != Face.first_edge);
+			for(std::map<k3d::uint_t, k3d::mesh::indices_t>::const_iterator fan = fans.begin(); fan != fans.end(); ++fan)
+			{
+				const k3d::uint_t point = fan->first;
+				const k3d::mesh::indices_t& corners = fan->second;
+				const k3d::uint_t corner_count = corners.size();
 
-	// Offset face points
-	const unsigned long n = face_edges.size();
-	for(unsigned long i = 0; i < n; ++i)
-	{
-		edge = face_edges[i];
-		k3d::legacy::split_edge* previous_edge = face_edges[(i + n-1) % n];
+				k3d::uint_t bevelled_count = 0;
+				for(k3d::uint_t i = 0; i != corner_count; ++i)
+				{
+					if(bevelled_faces[edge_faces[corners[i]]])
+						corner_points[corners[i]] = bevelled_count++ ? add_point(point, points, point_selection, point_attributes) : point;
+				}
+				if(!bevelled_count)
+					continue;
 
-		const k3d::vector3 e1 = edge->vertex->position - previous_edge->vertex->position;
-		const k3d::vector3 e2 = edge->face_clockwise->vertex->position - edge->vertex->position;
-		const k3d::vector3 e3 = k3d::normalize(e1 ^ face_normal);
-		const k3d::vector3 e4 = k3d::normalize(e2 ^ face_normal);
+				bevelled_counts[point] = bevelled_count;
 
-		const k3d::vector3 inset_direction = (-1 / cos(acos(e3 * e4) / 2)) * k3d::normalize(e3 + e4);
-		FacePoints.push_back(face_point(edge->vertex->position, inset_direction, *edge->vertex));
-	}
+				for(k3d::uint_t i = 0; i != corner_count; ++i)
+				{
+					const k3d::uint_t corner = corners[i];
+					if(bevelled_faces[edge_faces[corner]])
+						continue;
 
-	// Make sure it's an interior face
-	for(edges_t::reverse_iterator edge_i = face_edges.rbegin(); edge_i != face_edges.rend(); ++edge_i)
-	{
-		edge = *edge_i;
+					cut_faces.insert(edge_faces[corner]);
+					if(!bevelled_faces[edge_faces[adjacent_edges[corner]]])
+						split_points[corner] = add_split_point(point, polyhedron->vertex_points[polyhedron->clockwise_edges[corner]], points, point_selection, point_attributes);
+				}
 
-		if(!edge->companion)
-			return false;
+				// Where more than one bevelled face meets, close the gap between their inset points (and the split points between
+				// them) with a corner face ...
+				if(bevelled_count < 2)
+					continue;
 
-		k3d::legacy::split_edge* stop = k3d::legacy::face_anticlockwise(edge);
+				new_face corner_face;
+				for(k3d::uint_t i = corner_count; i; --i)
+				{
+					const k3d::uint_t corner = corners[i - 1];
+
+					std::map<k3d::uint_t, k3d::uint_t>::const_iterator split_point = split_points.find(corner);
+					if(split_point != split_points.end())
+						corner_face.loop.push_back(loop_vertex(split_point->second, corner));
+
+					std::map<k3d::uint_t, k3d::uint_t>::const_iterator corner_point = corner_points.find(corner);
+					if(corner_point != corner_points.end())
+					{
+						corner_face.face = edge_faces[corner];
+						corner_face.loop.push_back(loop_vertex(corner_point->second, corner));
+					}
+				}
 
-		// Get subdivided edge
-		k3d::legacy::split_edge* subdivided_edge = edge->companion->face_clockwise;
+				if(corner_face.loop.size() > 2)
+					corner_faces.push_back(corner_face);
+			}
 
-		do
-		{
-			if(!subdivided_edge->companion)
-				return false;
+			if(corner_points.empty())
+				continue;
 
-			k3d::legacy::split_edge* next_edge = subdivided_edge->companion->face_clockwise;
+			// Get ready to copy attributes ...
+			k3d::table_copier face_attributes(polyhedron->face_attributes);
+			k3d::table_copier edge_attributes(polyhedron->edge_attributes);
+			k3d::table_copier vertex_attributes(polyhedron->vertex_attributes);
 
-			// Next edge
-			subdivided_edge = next_edge;
-		}
-		while(subdivided_edge->companion != stop);
-	}
+			k3d::mesh::bools_t remove_edges(polyhedron->clockwise_edges.size(), false);
+			std::vector<new_face> strip_faces;
 
-	edges_t bevel_edges;
+			// Inset each bevelled face, moving it onto its own inset points where it shares points with other bevelled faces ...
+			for(k3d::mesh::indices_t::const_iterator face = selected_faces.begin(); face != selected_faces.end(); ++face)
+			{
+				if(!bevelled_faces[*face])
+					continue;
 
-	for(edges_t::reverse_iterator edge_i = face_edges.rbegin(); edge_i != face_edges.rend(); ++edge_i)
-	{
-		edge = *edge_i;
+				const k3d::uint_t loop = polyhedron->face_first_loops[*face];
+				const k3d::uint_t first_edge = polyhedron->loop_first_edges[loop];
 
-		if(!edge->companion)
-			return false;
+				k3d::mesh::indices_t face_edges;
+				for(k3d::uint_t edge = first_edge; ; )
+				{
+					face_edges.push_back(edge);
 
-		k3d::legacy::split_edge* stop = k3d::legacy::face_anticlockwise(edge);
+					edge = polyhedron->clockwise_edges[edge];
+					if(edge == first_edge)
+						break;
+				}
 
-		// Get subdivided edge
-		k3d::legacy::split_edge* subdivided_edge = edge->companion->face_clockwise;
+				const k3d::point3 face_center = k3d::polyhedron::center(polyhedron->vertex_points, polyhedron->clockwise_edges, points, first_edge);
+				const k3d::normal3 face_normal = k3d::normalize(k3d::polyhedron::normal(polyhedron->vertex_points, polyhedron->clockwise_edges, points, first_edge));
 
-		do
-		{
-			k3d::legacy::split_edge* next_edge = subdivided_edge->companion->face_clockwise;
+				loop_t inset_loop;
+				k3d::bool_t moved = false;
+				const k3d::uint_t edge_count = face_edges.size();
+				for(k3d::uint_t i = 0; i != edge_count; ++i)
+				{
+					const k3d::uint_t edge = face_edges[i];
+					const k3d::uint_t point = polyhedron->vertex_points[edge];
+					const k3d::uint_t inset_point = corner_points[edge];
+
+					const k3d::point3 previous_position = points[polyhedron->vertex_points[face_edges[(i + edge_count - 1) % edge_count]]];
+					const k3d::point3 position = points[point];
+					const k3d::point3 next_position = points[polyhedron->vertex_points[polyhedron->clockwise_edges[edge]]];
+
+					m_face_points.push_back(face_point(inset_point, position, inset_direction(previous_position, position, next_position, face_normal, face_center)));
+
+					inset_loop.push_back(loop_vertex(inset_point, edge));
+					if(inset_point != point)
+						moved = true;
+
+					// Fill the gap along an edge shared with another bevelled face, once per edge ...
+					const k3d::uint_t adjacent_edge = adjacent_edges[edge];
+					if(edge < adjacent_edge && bevelled_faces[edge_faces[adjacent_edge]])
+					{
+						new_face strip_face;
+						strip_face.face = *face;
+						strip_face.loop.push_back(loop_vertex(corner_points[polyhedron->clockwise_edges[edge]], polyhedron->clockwise_edges[edge]));
+						strip_face.loop.push_back(loop_vertex(inset_point, edge));
+						strip_face.loop.push_back(loop_vertex(corner_points[polyhedron->clockwise_edges[adjacent_edge]], polyhedron->clockwise_edges[adjacent_edge]));
+						strip_face.loop.push_back(loop_vertex(corner_points[adjacent_edge], adjacent_edge));
+						strip_faces.push_back(strip_face);
+					}
+				}
 
-			// Save original values
-			const k3d::point3& start_position = subdivided_edge->vertex->position;
-			const k3d::point3& end_position = subdivided_edge->face_clockwise->vertex->position;
+				if(!moved)
+					continue;
 
-			// Create new point
-			k3d::legacy::point* new_point = helpers::append_edge(subdivided_edge);
-			Mesh.points.push_back(new_point);
+				for(k3d::uint_t i = 0; i != edge_count; ++i)
+					remove_edges[face_edges[i]] = true;
 
-			// Cache edge
-			BevelEdges.push_back(bevel_edge(start_position, end_position, new_point));
+				polyhedron->loop_first_edges[loop] = add_loop(*polyhedron, inset_loop, edge_attributes, vertex_attributes);
+			}
 
-			// Save new edges' faces
-			EdgeToFace.insert(std::make_pair(subdivided_edge->face_clockwise, EdgeToFace[subdivided_edge]));
-			EdgeToFace.insert(std::make_pair(subdivided_edge->companion, EdgeToFace[subdivided_edge->face_clockwise->companion]));
+			// Cut the faces around the bevelled faces, replacing each run of bevelled points with a pair of split points
+			// on the edges that leave the run, and moving the run into a new side face ...
+			for(std::set<k3d::uint_t>::const_iterator face = cut_faces.begin(); face != cut_faces.end(); ++face)
+			{
+				const k3d::uint_t loop = polyhedron->face_first_loops[*face];
+				const k3d::uint_t first_edge = polyhedron->loop_first_edges[loop];
 
-			// Save vertices to be connected
-			bevel_edges.push_back(subdivided_edge->face_clockwise);
-			bevel_edges.push_back(subdivided_edge->companion);
+				k3d::mesh::indices_t face_edges;
+				for(k3d::uint_t edge = first_edge; ; )
+				{
+					face_edges.push_back(edge);
 
-			// Next edge
-			subdivided_edge = next_edge;
-		}
-		while(subdivided_edge->companion != stop);
-	}
+					edge = polyhedron->clockwise_edges[edge];
+					if(edge == first_edge)
+						break;
+				}
 
-	link_edges.push_back(bevel_edges);
+				// Replace each bevelled point with the inset and split points on either side of it, seen from this face ...
+				boundary_t boundary;
+				const k3d::uint_t edge_count = face_edges.size();
+				for(k3d::uint_t i = 0; i != edge_count; ++i)
+				{
+					const k3d::uint_t edge = face_edges[i];
+					const k3d::uint_t point = polyhedron->vertex_points[edge];
+
+					std::map<k3d::uint_t, k3d::uint_t>::const_iterator bevelled_count = bevelled_counts.find(point);
+					if(bevelled_count == bevelled_counts.end())
+					{
+						add_boundary_vertex(boundary, boundary_vertex(point, edge, boundary_vertex::ORIGINAL));
+						continue;
+					}
+
+					const k3d::uint_t incoming_edge = adjacent_edges[face_edges[(i + edge_count - 1) % edge_count]];
+					if(bevelled_faces[edge_faces[incoming_edge]])
+						add_boundary_vertex(boundary, boundary_vertex(corner_points[incoming_edge], edge, boundary_vertex::INSET));
+					else
+						add_boundary_vertex(boundary, boundary_vertex(split_points[incoming_edge], edge, boundary_vertex::SPLIT));
+
+					if(bevelled_count->second == 1)
+						add_boundary_vertex(boundary, boundary_vertex(point, edge, boundary_vertex::INSET));
+
+					const k3d::uint_t outgoing_edge = adjacent_edges[edge];
+					if(bevelled_faces[edge_faces[outgoing_edge]])
+						add_boundary_vertex(boundary, boundary_vertex(corner_points[polyhedron->clockwise_edges[outgoing_edge]], edge, boundary_vertex::INSET));
+					else
+						add_boundary_vertex(boundary, boundary_vertex(split_points[edge], edge, boundary_vertex::SPLIT));
+				}
+				while(boundary.size() > 1 && boundary.back().vertex.point == boundary.front().vertex.point)
+					boundary.pop_back();
 
-	return true;
-}
+				// The face keeps its original and split points ...
+				loop_t cut_loop;
+				for(k3d::uint_t i = 0; i != boundary.size(); ++i)
+				{
+					if(boundary[i].type != boundary_vertex::INSET)
+						cut_loop.push_back(boundary[i].vertex);
+				}
 
-/// Connects two vertices belonging to the same face
-k3d::legacy::face* connect_vertices(k3d::legacy::face* Face, k3d::legacy::split_edge* Edge1, k3d::legacy::split_edge* Edge2, edge_to_face_t& EdgeToFace, faces_t& SideFaces)
-{
-	// Make new edge loops
-	k3d::legacy::split_edge* new_edge1 = new k3d::legacy::split_edge(Edge1->vertex, Edge2);
-	k3d::legacy::split_edge* new_edge2 = new k3d::legacy::split_edge(Edge2->vertex, Edge1);
+				for(k3d::uint_t i = 0; i != edge_count; ++i)
+					remove_edges[face_edges[i]] = true;
+
+				// ... unless there would be nothing left of it, in which case it keeps its inset points, too ...
+				if(cut_loop.size() < 3)
+				{
+					cut_loop.clear();
+					for(k3d::uint_t i = 0; i != boundary.size(); ++i)
+						cut_loop.push_back(boundary[i].vertex);
 
-	k3d::legacy::split_edge* anti_edge1 = k3d::legacy::face_anticlockwise(Edge1);
-	k3d::legacy::split_edge* anti_edge2 = k3d::legacy::face_anticlockwise(Edge2);
+					polyhedron->loop_first_edges[loop] = add_loop(*polyhedron, cut_loop, edge_attributes, vertex_attributes);
+					continue;
+				}
 
-	anti_edge1->face_clockwise = new_edge1;
-	anti_edge2->face_clockwise = new_edge2;
+				polyhedron->loop_first_edges[loop] = add_loop(*polyhedron, cut_loop, edge_attributes, vertex_attributes);
 
-	k3d::legacy::join_edges(*new_edge1, *new_edge2);
+				// ... and each run of inset points between a pair of split points becomes a side face ...
+				const k3d::uint_t boundary_size = boundary.size();
+				for(k3d::uint_t begin = 0; begin != boundary_size; ++begin)
+				{
+					if(boundary[begin].type != boundary_vertex::SPLIT || boundary[(begin + 1) % boundary_size].type != boundary_vertex::INSET)
+						continue;
+
+					new_face side_face;
+					side_face.face = *face;
+					for(k3d::uint_t i = begin; ; i = (i + 1) % boundary_size)
+					{
+						side_face.loop.push_back(boundary[i].vertex);
+						if(i != begin && boundary[i].type == boundary_vertex::SPLIT)
+							break;
+					}
+
+					add_face(*polyhedron, side_face, select_side_faces, face_attributes, edge_attributes, vertex_attributes);
+				}
+			}
 
-	// Create a second face for ear cut
-	k3d::legacy::face* new_face = 0;
-	if(helpers::edge_in_face(Face->first_edge, Edge1))
-	{
-		new_face = new k3d::legacy::face(Edge2, Face->material);
-		SideFaces.push_back(Face);
-	}
-	else
-	{
-		new_face = new k3d::legacy::face(Edge1, Face->material);
-		SideFaces.push_back(new_face);
+			// Add strip and corner faces ...
+			for(std::vector<new_face>::const_iterator face = strip_faces.begin(); face != strip_faces.end(); ++face)
+				add_face(*polyhedron, *face, select_side_faces, face_attributes, edge_attributes, vertex_attributes);
+			for(std::vector<new_face>::const_iterator face = corner_faces.begin(); face != corner_faces.end(); ++face)
+				add_face(*polyhedron, *face, select_side_faces, face_attributes, edge_attributes, vertex_attributes);
+
+			// Remove the original edges from replaced loops ...
+			remove_edges.resize(polyhedron->clockwise_edges.size(), false);
+			k3d::mesh::bools_t remove_points(points.size(), false);
+			k3d::mesh::bools_t remove_loops(polyhedron->loop_first_edges.size(), false);
+			k3d::mesh::bools_t remove_faces(polyhedron->face_shells.size(), false);
+			k3d::polyhedron::delete_components(Output, *polyhedron, remove_points, remove_edges, remove_loops, remove_faces);
+		}
 	}
 
-	// Assign new face to edges
-	k3d::legacy::split_edge* edge = new_face->first_edge;
-	do
+	void on_update_mesh(const k3d::mesh& Input, k3d::mesh& Output)
 	{
-		EdgeToFace[edge] = new_face;
+		if(m_edge_points.empty() && m_face_points.empty())
+			return;
 
-		edge = edge->face_clockwise;
-	}
-	while(edge != new_face->first_edge);
+		const k3d::double_t offset = m_offset.pipeline_value();
+		const k3d::double_t inset = m_inset.pipeline_value();
+		const k3d::bool_t distance = m_distance.pipeline_value();
 
-	return new_face;
-}
+		k3d::mesh::points_t& points = Output.points.writable();
 
-// Connect subdivision vertices
-void bevel_faces(edge_to_face_t& EdgeToFace, faces_t& NewFaces, faces_t& SideFaces)
-{
-	for(edge_lists_t::iterator list = link_edges.begin(); list != link_edges.end(); ++list)
-	{
-		edges_t& edges = *list;
-		const unsigned long n = edges.size();
-		for(unsigned long i = 1; i < n; i += 2)
+		for(edge_points_t::const_iterator edge_point = m_edge_points.begin(); edge_point != m_edge_points.end(); ++edge_point)
 		{
-			k3d::legacy::split_edge* edge1 = edges[i];
-			k3d::legacy::split_edge* edge2 = edges[(i + 1) % n];
-			k3d::legacy::face* face = connect_vertices(EdgeToFace[edge1], edge1, edge2, EdgeToFace, SideFaces);
-			if(face)
+			k3d::double_t edge_offset = offset;
+			if(distance)
+			{
+				// Offset is a length from the start position ...
+				const k3d::double_t length = k3d::distance(edge_point->start, edge_point->end);
+				if(length)
+					edge_offset = offset / length;
+			}
+			else
 			{
-				NewFaces.push_back(face);
+				// Offset is a position along the edge ...
+				edge_offset = std::min(1.0, offset);
 			}
+
+			points[edge_point->point] = edge_point->start + (edge_point->end - edge_point->start) * edge_offset;
 		}
+
+		for(face_points_t::const_iterator face_point = m_face_points.begin(); face_point != m_face_points.end(); ++face_point)
+			points[face_point->point] = face_point->position + (inset * face_point->inset_direction);
 	}
-}
 
-} // namespace detail
+	static k3d::iplugin_factory& get_factory()
+	{
+		static k3d::document_plugin_factory<bevel_faces,
+			k3d::interface_list<k3d::imesh_source,
+			k3d::interface_list<k3d::imesh_sink > > > factory(
+				k3d::uuid(0xc3ca122a, 0x9e8b46dc, 0xa6649135, 0xd68ac1a6),
+				"BevelFaces",
+				"Bevels each selected face",
+				"Polyhedron",
+				k3d::iplugin_factory::EXPERIMENTAL);
 
-/////////////////////////////////////////////////////////////////////////////
-// bevel_faces_implementation
+		return factory;
+	}
 
-class bevel_faces_implementation :
-	public k3d::mesh_selection_sink<k3d::legacy::mesh_modifier<k3d::node > >
-{
-	typedef k3d::mesh_selection_sink<k3d::legacy::mesh_modifier<k3d::node > > base;
+private:
+	/// Stores one vertex of a new edge loop, along with the original edge that the new edge will copy attributes from
+	struct loop_vertex
+	{
+		loop_vertex(const k3d::uint_t Point, const k3d::uint_t SourceEdge) :
+			point(Point),
+			source_edge(SourceEdge)
+		{
+		}
 
-public:
-	bevel_faces_implementation(k3d::iplugin_factory& Factory, k3d::idocument& Document) :
-		base(Factory, Document),
-		m_offset(init_owner(*this) + init_name("offset") + init_label(_("Offset")) + init_description(_("Offset along external edges")) + init_value(0.3) + init_step_increment(0.1) + init_units(typeid(k3d::measurement::distance))),
-		m_inset(init_owner(*this) + init_name("inset") + init_label(_("Inset")) + init_description(_("Inset of bevelled face")) + init_value(0.3) + init_step_increment(0.01) + init_units(typeid(k3d::measurement::distance))),
-		m_distance(init_owner(*this) + init_name("distance") + init_label(_("Distance")) + init_description(_("Use distance instead of edge offset")) + init_value(false)),
-		m_select_side_faces(init_owner(*this) + init_name("select_side_faces") + init_label(_("Select side faces")) + init_description(_("Select side faces on output, doesn't change selection if off")) + init_value(true))
+		k3d::uint_t point;
+		k3d::uint_t source_edge;
+	};
+
+	typedef std::vector<loop_vertex> loop_t;
+
+	/// Stores a new face, along with the original face that it will copy attributes from
+	struct new_face
 	{
-		m_mesh_selection.changed_signal().connect(make_reset_mesh_slot());
+		new_face() :
+			face(0)
+		{
+		}
 
-		m_offset.changed_signal().connect(make_update_mesh_slot());
-		m_inset.changed_signal().connect(make_update_mesh_slot());
-		m_distance.changed_signal().connect(make_update_mesh_slot());
-		m_select_side_faces.changed_signal().connect(make_update_mesh_slot());
-	}
+		k3d::uint_t face;
+		loop_t loop;
+	};
 
-	/** \todo Improve the implementation so we don't have to do this */
-	k3d::iunknown* on_rewrite_hint(iunknown* const Hint)
+	/// Stores one vertex of the boundary of a face that is cut back around bevelled faces
+	struct boundary_vertex
 	{
-		// Force updates to re-allocate our mesh, for simplicity
-		return 0;
-	}
+		typedef enum
+		{
+			ORIGINAL,
+			SPLIT,
+			INSET
+		} type_t;
+
+		boundary_vertex(const k3d::uint_t Point, const k3d::uint_t SourceEdge, const type_t Type) :
+			vertex(Point, SourceEdge),
+			type(Type)
+		{
+		}
+
+		loop_vertex vertex;
+		type_t type;
+	};
+
+	typedef std::vector<boundary_vertex> boundary_t;
 
-	void on_initialize_mesh(const k3d::legacy::mesh& InputMesh, k3d::legacy::mesh& Mesh)
+	/// Caches a new point on an edge leaving a bevelled face, for better interactive performance
+	struct edge_point
 	{
-		// Clear previously cached data
-		m_bevel_edges.clear();
-		m_face_points.clear();
-		m_new_faces.clear();
-		m_side_faces.clear();
+		edge_point(const k3d::uint_t Point, const k3d::point3& Start, const k3d::point3& End) :
+			point(Point),
+			start(Start),
+			end(End)
+		{
+		}
 
-		detail::link_edges.clear();
+		k3d::uint_t point;
+		k3d::point3 start;
+		k3d::point3 end;
+	};
 
-		// Create output geometry
-		k3d::legacy::deep_copy(InputMesh, Mesh);
-		k3d::geometry::selection::merge(m_mesh_selection.pipeline_value(), Mesh);
+	typedef std::vector<edge_point> edge_points_t;
 
-		for(k3d::legacy::mesh::polyhedra_t::iterator polyhedron_i = Mesh.polyhedra.begin(); polyhedron_i != Mesh.polyhedra.end(); ++polyhedron_i)
+	/// Caches an inset point of a bevelled face, for better interactive performance
+	struct face_point
+	{
+		face_point(const k3d::uint_t Point, const k3d::point3& Position, const k3d::vector3& InsetDirection) :
+			point(Point),
+			position(Position),
+			inset_direction(InsetDirection)
 		{
-			k3d::legacy::polyhedron& polyhedron = **polyhedron_i;
+		}
 
-			// Get the set of all selected faces ...
-			k3d::legacy::polyhedron::faces_t selected_faces;
-			k3d::copy_if(polyhedron.faces.begin(), polyhedron.faces.end(), std::inserter(selected_faces, selected_faces.end()), k3d::is_selected());
+		k3d::uint_t point;
+		k3d::point3 position;
+		k3d::vector3 inset_direction;
+	};
 
-			if(selected_faces.empty())
-				selected_faces = polyhedron.faces;
+	typedef std::vector<face_point> face_points_t;
 
-			// Create an edge-to-face map
-			detail::edge_to_face_t edge_to_face;
-			for(k3d::legacy::polyhedron::faces_t::iterator face = polyhedron.faces.begin(); face != polyhedron.faces.end(); ++face)
-			{
-				k3d::legacy::split_edge* edge = (*face)->first_edge;
-				do
-				{
-					edge_to_face.insert(std::make_pair(edge, *face));
+	/// Returns the direction that moves a face point inwards, scaled so the face edges move by unit distance
+	static const k3d::vector3 inset_direction(const k3d::point3& Previous, const k3d::point3& Point, const k3d::point3& Next, const k3d::normal3& Normal, const k3d::point3& Center)
+	{
+		const k3d::vector3 e1 = k3d::normalize((Point - Previous) ^ Normal);
+		const k3d::vector3 e2 = k3d::normalize((Next - Point) ^ Normal);
+		const k3d::vector3 bisector = e1 + e2;
+		if(0.0 == bisector.length2())
+			return k3d::vector3(0, 0, 0);
 
-					edge = edge->face_clockwise;
-				}
-				while(edge != (*face)->first_edge);
-			}
+		k3d::vector3 result = (1 / std::cos(std::acos(std::max(-1.0, std::min(1.0, e1 * e2))) / 2)) * k3d::normalize(bisector);
+		if(result * (Center - Point) < 0)
+			result = -result;
 
-			// For each face ...
-			for(k3d::legacy::polyhedron::faces_t::iterator selected_face = selected_faces.begin(); selected_face != selected_faces.end(); ++selected_face)
+		return result;
+	}
+
+	/// Stores the corners (half-edges leaving a point) around a point, in order, starting from the given corner.  Leaves Fan
+	/// empty if the faces around the point don't form a closed fan, or if any of them have holes
+	static void create_fan(const k3d::polyhedron::primitive& Polyhedron, const k3d::mesh::bools_t& BoundaryEdges, const k3d::mesh::indices_t& AdjacentEdges, const k3d::mesh::indices_t& EdgeFaces, const k3d::uint_t Corner, k3d::mesh::indices_t& Fan)
+	{
+		std::set<k3d::uint_t> faces;
+		for(k3d::uint_t corner = Corner; ; )
+		{
+			if(BoundaryEdges[corner] || Polyhedron.face_loop_counts[EdgeFaces[corner]] != 1 || !faces.insert(EdgeFaces[corner]).second)
 			{
-				// Save original edges and create new points
-				if(detail::subdivide_edges(**selected_face, Mesh, m_bevel_edges, m_face_points, edge_to_face))
-				{
-					m_new_faces.push_back(*selected_face);
-					break;
-				}
+				Fan.clear();
+				return;
 			}
 
-			// Join new points
-			detail::faces_t new_faces;
-			detail::bevel_faces(edge_to_face, new_faces, m_side_faces);
-			polyhedron.faces.insert(polyhedron.faces.end(), new_faces.begin(), new_faces.end());
-			m_new_faces.insert(m_new_faces.end(), new_faces.begin(), new_faces.end());
+			Fan.push_back(corner);
 
-			assert_warning(k3d::legacy::is_valid(polyhedron));
+			corner = Polyhedron.clockwise_edges[AdjacentEdges[corner]];
+			if(corner == Corner)
+				return;
 		}
 	}
 
-	void on_update_mesh(const k3d::legacy::mesh& InputMesh, k3d::legacy::mesh& Mesh)
+	/// Appends a copy of an existing point, returning its index
+	static const k3d::uint_t add_point(const k3d::uint_t Point, k3d::mesh::points_t& Points, k3d::mesh::selection_t& PointSelection, k3d::table_copier& PointAttributes)
 	{
-		const double offset = m_offset.pipeline_value();
-		const bool distance = m_distance.pipeline_value();
+		const k3d::point3 position = Points[Point];
+		Points.push_back(position);
+		PointSelection.push_back(PointSelection[Point]);
+		PointAttributes.push_back(Point);
 
-		for(detail::bevel_edges_t::iterator point = m_bevel_edges.begin(); point != m_bevel_edges.end(); ++point)
-			point->update(offset, distance);
+		return Points.size() - 1;
+	}
 
-		const double inset = m_inset.pipeline_value();
-		for(detail::face_points_t::iterator face_point = m_face_points.begin(); face_point != m_face_points.end(); ++face_point)
-			face_point->update(inset);
+	/// Appends a new point that splits the edge from Start to End, next to Start, returning its index
+	const k3d::uint_t add_split_point(const k3d::uint_t Start, const k3d::uint_t End, k3d::mesh::points_t& Points, k3d::mesh::selection_t& PointSelection, k3d::table_copier& PointAttributes)
+	{
+		const k3d::uint_t new_point = Points.size();
+		m_edge_points.push_back(edge_point(new_point, Points[Start], Points[End]));
 
-		const double weight = m_select_side_faces.pipeline_value() ? 1.0 : 0.0;
-		for(detail::faces_t::iterator face = m_side_faces.begin(); face != m_side_faces.end(); ++face)
-			(*face)->selection_weight = weight;
+		const k3d::point3 position = Points[Start];
+		Points.push_back(position);
+		PointSelection.push_back(0);
+		PointAttributes.push_back(Start);
+
+		return new_point;
 	}
 
-	static k3d::iplugin_factory& get_factory()
+	/// Appends a vertex to the boundary of a cut face, ignoring repeated points
+	static void add_boundary_vertex(boundary_t& Boundary, const boundary_vertex& Vertex)
 	{
-		static k3d::document_plugin_factory<bevel_faces_implementation,
-			k3d::interface_list<k3d::imesh_source,
-			k3d::interface_list<k3d::imesh_sink > > > factory(
-				k3d::uuid(0xc3ca122a, 0x9e8b46dc, 0xa6649135, 0xd68ac1a6),
-				"BevelFaces",
-				"Bevels each selected face",
-				"Polyhedron",
-				k3d::iplugin_factory::EXPERIMENTAL);
+		if(Boundary.size() && Boundary.back().vertex.point == Vertex.vertex.point)
+			return;
 
-		return factory;
+		Boundary.push_back(Vertex);
 	}
 
-private:
-	detail::bevel_edges_t m_bevel_edges;
-	detail::face_points_t m_face_points;
-	detail::faces_t m_new_faces;
-	detail::faces_t m_side_faces;
-
-	k3d_data(double, immutable_name, change_signal, with_undo, local_storage, no_constraint, measurement_property, with_serialization) m_offset;
-	k3d_data(double, immutable_name, change_signal, with_undo, local_storage, no_constraint, measurement_property, with_serialization) m_inset;
-	k3d_data(bool, immutable_name, change_signal, with_undo, local_storage, no_constraint, writable_property, with_serialization) m_distance;
-	k3d_data(bool, immutable_name, change_signal, with_undo, local_storage, no_constraint, writable_property, with_serialization) m_select_side_faces;
+	/// Appends a closed edge loop to a polyhedron, returning its first edge
+	static const k3d::uint_t add_loop(k3d::polyhedron::primitive& Polyhedron, const loop_t& Loop, k3d::table_copier& EdgeAttributes, k3d::table_copier& VertexAttributes)
+	{
+		const k3d::uint_t first_edge = Polyhedron.clockwise_edges.size();
+		for(loop_t::const_iterator vertex = Loop.begin(); vertex != Loop.end(); ++vertex)
+		{
+			Polyhedron.clockwise_edges.push_back(Polyhedron.clockwise_edges.size() + 1);
+			Polyhedron.edge_selections.push_back(Polyhedron.edge_selections[vertex->source_edge]);
+			Polyhedron.vertex_points.push_back(vertex->point);
+			Polyhedron.vertex_selections.push_back(Polyhedron.vertex_selections[vertex->source_edge]);
+
+			EdgeAttributes.push_back(vertex->source_edge);
+			VertexAttributes.push_back(vertex->source_edge);
+		}
+		Polyhedron.clockwise_edges.back() = first_edge;
+
+		return first_edge;
+	}
+
+	/// Appends a new face to a polyhedron, copying attributes from an existing face
+	static void add_face(k3d::polyhedron::primitive& Polyhedron, const new_face& Face, const k3d::bool_t Select, k3d::table_copier& FaceAttributes, k3d::table_copier& EdgeAttributes, k3d::table_copier& VertexAttributes)
+	{
+		Polyhedron.face_shells.push_back(Polyhedron.face_shells[Face.face]);
+		Polyhedron.face_first_loops.push_back(Polyhedron.loop_first_edges.size());
+		Polyhedron.face_loop_counts.push_back(1);
+		Polyhedron.face_selections.push_back(Select ? 1.0 : Polyhedron.face_selections[Face.face]);
+		Polyhedron.face_materials.push_back(Polyhedron.face_materials[Face.face]);
+		FaceAttributes.push_back(Face.face);
+
+		Polyhedron.loop_first_edges.push_back(add_loop(Polyhedron, Face.loop, EdgeAttributes, VertexAttributes));
+	}
+
+	edge_points_t m_edge_points;
+	face_points_t m_face_points;
+
+	k3d_data(k3d::double_t, immutable_name, change_signal, with_undo, local_storage, no_constraint, measurement_property, with_serialization) m_offset;
+	k3d_data(k3d::double_t, immutable_name, change_signal, with_undo, local_storage, no_constraint, measurement_property, with_serialization) m_inset;
+	k3d_data(k3d::bool_t, immutable_name, change_signal, with_undo, local_storage, no_constraint, writable_property, with_serialization) m_distance;
+	k3d_data(k3d::bool_t, immutable_name, change_signal, with_undo, local_storage, no_constraint, writable_property, with_serialization) m_select_side_faces;
 };
 
 /////////////////////////////////////////////////////////////////////////////
@@ -430,7 +660,7 @@ private:
 
 k3d::iplugin_factory& bevel_faces_factory()
 {
-	return bevel_faces_implementation::get_factory();
+	return bevel_faces::get_factory();
 }
 
 } // namespace polyhedron
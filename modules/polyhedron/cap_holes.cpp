@@ -63,6 +63,8 @@ public:
 			k3d::hint::convert<k3d::hint::any, k3d::hint::mesh_topology_changed> >(make_reset_mesh_slot()));
 		m_cap_faces.changed_signal().connect(k3d::hint::converter<
 			k3d::hint::convert<k3d::hint::any, k3d::hint::mesh_topology_changed> >(make_reset_mesh_slot()));
+
+		enable_geometry_updates();
 	}
 
 	void on_create_mesh(const k3d::mesh& Input, k3d::mesh& Output)
@@ -202,6 +204,8 @@ public:
 
 	void on_update_mesh(const k3d::mesh& Input, k3d::mesh& Output)
 	{
+		// Caps only reuse existing points, so every output point is a copy of the corresponding input point ...
+		Output.points = Input.points;
 	}
 
 	static k3d::iplugin_factory& get_factory()
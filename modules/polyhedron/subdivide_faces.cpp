@@ -24,6 +24,7 @@
 */
 
 #include <k3d-i18n-config.h>
+#include <k3dsdk/derived_points.h>
 #include <k3dsdk/document_plugin_factory.h>
 #include <k3dsdk/geometry.h>
 #include <k3dsdk/hints.h>
@@ -61,6 +62,8 @@ public:
 			k3d::hint::convert<k3d::hint::any, k3d::hint::mesh_topology_changed> >(make_reset_mesh_slot()));
 		m_subdivision_type.changed_signal().connect(k3d::hint::converter<
 			k3d::hint::convert<k3d::hint::any, k3d::hint::mesh_topology_changed> >(make_reset_mesh_slot()));
+
+		enable_geometry_updates();
 	}
 
 	void on_create_mesh(const k3d::mesh& Input, k3d::mesh& Output)
@@ -68,6 +71,8 @@ public:
 		Output = Input;
 		k3d::geometry::selection::merge(m_mesh_selection.pipeline_value(), Output);
 
+		m_output_points.reset(Output.points ? Output.points->size() : 0);
+
 		if(!Output.points)
 			return;
 		if(!Output.point_selection)
@@ -138,6 +143,7 @@ public:
 						points.push_back(average);
 						point_selection.push_back(0);
 						point_attributes.push_back(center_point_indices.size(), &center_point_indices[0], &center_point_weights[0]);
+						m_output_points.push_back(center_point_indices.size(), &center_point_indices[0], &center_point_weights[0]);
 						remove_points.push_back(false);
 
 						// Generate new faces ...
@@ -236,6 +242,7 @@ public:
 						points.push_back(average);
 						point_selection.push_back(0);
 						point_attributes.push_back(center_point_indices.size(), &center_point_indices[0], &center_point_weights[0]);
+						m_output_points.push_back(center_point_indices.size(), &center_point_indices[0], &center_point_weights[0]);
 						remove_points.push_back(false);
 
 						// Generate midpoints ...
@@ -255,6 +262,7 @@ public:
 								const k3d::uint_t point_indices[2] = { polyhedron->vertex_points[edge], polyhedron->vertex_points[polyhedron->clockwise_edges[edge]] };
 								const k3d::double_t point_weights[2] = { 0.5, 0.5 };
 								point_attributes.push_back(2, point_indices, point_weights);
+								m_output_points.push_back(2, point_indices, point_weights);
 								remove_points.push_back(false);
 							}
 
@@ -377,6 +385,7 @@ public:
 								const k3d::uint_t point_indices[2] = { polyhedron->vertex_points[edge], polyhedron->vertex_points[polyhedron->clockwise_edges[edge]] };
 								const k3d::double_t point_weights[2] = { 0.5, 0.5 };
 								point_attributes.push_back(2, point_indices, point_weights);
+								m_output_points.push_back(2, point_indices, point_weights);
 								remove_points.push_back(false);
 							}
 
@@ -502,6 +511,10 @@ public:
 
 	void on_update_mesh(const k3d::mesh& Input, k3d::mesh& Output)
 	{
+		if(!Input.points || !Output.points)
+			return;
+
+		m_output_points.evaluate(*Input.points, Output.points.create(new k3d::mesh::points_t()));
 	}
 
 	static k3d::iplugin_factory& get_factory()
@@ -575,6 +588,9 @@ private:
 
 private:
 	k3d_data(subdivision_t, immutable_name, change_signal, with_undo, local_storage, no_constraint, enumeration_property, with_serialization) m_subdivision_type;
+
+	/// Records how our output points were derived from our input points, so they can be updated without subdividing again
+	k3d::derived_points m_output_points;
 };
 
 /////////////////////////////////////////////////////////////////////////////
@@ -23,6 +23,7 @@
 
 #include <k3d-i18n-config.h>
 #include <k3dsdk/table_copier.h>
+#include <k3dsdk/derived_points.h>
 #include <k3dsdk/document_plugin_factory.h>
 #include <k3dsdk/geometry.h>
 #include <k3dsdk/hints.h>
@@ -51,6 +52,8 @@ public:
 	{
 		m_mesh_selection.changed_signal().connect(k3d::hint::converter<
 			k3d::hint::convert<k3d::hint::any, k3d::hint::none> >(make_reset_mesh_slot()));
+
+		enable_geometry_updates();
 	}
 	
 	void on_create_mesh(const k3d::mesh& Input, k3d::mesh& Output)
@@ -58,18 +61,24 @@ public:
 		Output = Input;
 		k3d::geometry::selection::merge(m_mesh_selection.pipeline_value(), Output);
 
+		m_output_points.reset(Input.points ? Input.points->size() : 0);
+
 		for(k3d::mesh::primitives_t::iterator primitive = Output.primitives.begin(); primitive != Output.primitives.end(); ++primitive)
 		{
 			boost::scoped_ptr<k3d::polyhedron::const_primitive> polyhedron(k3d::polyhedron::validate(Output, **primitive));
 			if(!polyhedron)
 				continue;
 	
-			primitive->create(k3d::polyhedron::triangulate(Input, *polyhedron, Output));
+			primitive->create(k3d::polyhedron::triangulate(Input, *polyhedron, Output, &m_output_points));
 		}
 	}
 	
 	void on_update_mesh(const k3d::mesh& Input, k3d::mesh& Output)
 	{
+		if(!Input.points || !Output.points)
+			return;
+
+		m_output_points.evaluate(*Input.points, Output.points.create(new k3d::mesh::points_t()));
 	}
 	
 	static k3d::iplugin_factory& get_factory()
@@ -83,6 +92,10 @@ public:
 
 		return factory;
 	}
+
+private:
+	/// Records how our output points were derived from our input points, so they can be updated without re-triangulating
+	k3d::derived_points m_output_points;
 };
 
 /////////////////////////////////////////////////////////////////////////////
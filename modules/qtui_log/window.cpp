@@ -47,11 +47,18 @@ window::window() :
 	ui.setupUi(this);
 
 	k3d::get_log_cache(sigc::mem_fun(*this, &window::on_log_message));
-	k3d::connect_log_message(sigc::mem_fun(*this, &window::on_log_message));
+	log_connection = k3d::connect_log_message(sigc::mem_fun(*this, &window::on_log_message));
+	QObject::connect(this, SIGNAL(log_message(const QString&)), ui.console, SLOT(print_html(const QString&)), Qt::QueuedConnection);
 
 	this->setAttribute(Qt::WA_DeleteOnClose);
 }
 
+window::~window()
+{
+	// Waits for the writer thread to finish calling on_log_message(), if it is ...
+	k3d::disconnect_log_message(log_connection);
+}
+
 void window::on_log_message(const time_t Timestamp, const k3d::log_level_t Level, const std::string& Message)
 {
 	QString buffer;
@@ -104,7 +111,8 @@ void window::on_log_message(const time_t Timestamp, const k3d::log_level_t Level
 
 	buffer += "</span>";
 
-	ui.console->print_html(buffer);
+	// We're called on the log writer thread, so the console is updated by a queued connection on the UI thread ...
+	Q_EMIT log_message(buffer);
 }
 
 k3d::iplugin_factory& window::get_factory()
@@ -55,14 +55,20 @@ class window :
 
 public:
 	window();
+	~window();
 
 	void on_log_message(const time_t Timestamp, const k3d::log_level_t Level, const std::string& Message);
 
 	static k3d::iplugin_factory& get_factory();
 
+Q_SIGNALS:
+	/// Carries formatted messages to the console on the UI thread
+	void log_message(const QString& Html);
+
 private:
 	Ui::QTUILog ui;
 	k3d::qtui::application_widget application_widget;
+	sigc::connection log_connection;
 };
 
 } // namespace log
@@ -28,6 +28,7 @@
 #include <k3dsdk/file_range.h>
 #include <k3dsdk/fstream.h>
 #include <k3dsdk/gl.h>
+#include <k3dsdk/gzstream.h>
 #include <k3dsdk/icamera.h>
 #include <k3dsdk/icrop_window.h>
 #include <k3dsdk/iimager_shader_ri.h>
@@ -45,6 +46,7 @@
 #include <k3dsdk/irenderable_ri.h>
 #include <k3dsdk/itexture_ri.h>
 #include <k3dsdk/imatrix_source.h>
+#include <k3dsdk/imesh_sink.h>
 #include <k3dsdk/iuser_interface.h>
 #include <k3dsdk/ivolume_shader_ri.h>
 #include <k3dsdk/measurement.h>
@@ -54,11 +56,13 @@
 #include <k3dsdk/plugin.h>
 #include <k3dsdk/property.h>
 #include <k3dsdk/property_group_collection.h>
+#include <k3dsdk/stream_io_ri.h>
 #include <k3dsdk/stream_ri.h>
 #include <k3dsdk/renderable_ri.h>
 #include <k3dsdk/resolutions.h>
 #include <k3dsdk/shader_cache.h>
 #include <k3dsdk/shader_collection_ri.h>
+#include <k3dsdk/static_geometry_archives_ri.h>
 #include <k3dsdk/string_cast.h>
 #include <k3dsdk/time_source.h>
 #include <k3dsdk/types_ri.h>
@@ -66,6 +70,7 @@
 #include <k3dsdk/utility_gl.h>
 
 #include <iomanip>
+#include <sstream>
 
 #include <boost/scoped_ptr.hpp>
 
@@ -106,6 +111,15 @@ private:
 	k3d::ri::ishader_collection& shaders;
 };
 
+/// Opens a RIB file for writing, optionally gzip-compressed (RenderMan renderers detect and decompress gzipped RIB transparently)
+std::ostream* open_rib_file(const k3d::filesystem::path& Path, const bool Compress)
+{
+	if(Compress)
+		return new k3d::filesystem::ogzstream(Path);
+
+	return new k3d::filesystem::ofstream(Path);
+}
+
 } // namespace detail
 
 /////////////////////////////////////////////////////////////////////////////
@@ -157,7 +171,10 @@ public:
 		m_shading_interpolation(init_owner(*this) + init_name("shading_interpolation") + init_label(_("Shading Interpolation")) + init_description(_("Shading Interpolation")) + init_value(k3d::ri::RI_CONSTANT()) + init_values(shading_interpolation_values())),
 		m_two_sided(init_owner(*this) + init_name("two_sided") + init_label(_("Two-Sided")) + init_description(_("Two Sided")) + init_value(true)),
 		m_motion_blur(init_owner(*this) + init_name("motion_blur") + init_label(_("Motion Blur")) + init_description(_("Motion Blur")) + init_value(false)),
-		m_render_motion_blur(init_owner(*this) + init_name("render_motion_blur") + init_label(_("Render Motion Blur")) + init_description(_("Render Motion Blur")) + init_value(false))
+		m_render_motion_blur(init_owner(*this) + init_name("render_motion_blur") + init_label(_("Render Motion Blur")) + init_description(_("Render Motion Blur")) + init_value(false)),
+		m_archive_static_geometry(init_owner(*this) + init_name("archive_static_geometry") + init_label(_("Archive Static Geometry")) + init_description(_("When rendering animations, write geometry that doesn't change between frames to a shared RIB archive instead of repeating it in every frame.")) + init_value(true)),
+		m_binary_rib(init_owner(*this) + init_name("binary_rib") + init_label(_("Binary RIB")) + init_description(_("Write RIB using the binary encoding, which is smaller and faster for renderers to parse than ASCII.")) + init_value(false)),
+		m_compress_rib(init_owner(*this) + init_name("compress_rib") + init_label(_("Compress RIB")) + init_description(_("Write gzip-compressed RIB files.")) + init_value(false))
 	{
 		k3d::iproperty_group_collection::group output_group("Output");
 		output_group.properties.push_back(&static_cast<k3d::iproperty&>(m_resolution));
@@ -170,6 +187,9 @@ public:
 		output_group.properties.push_back(&static_cast<k3d::iproperty&>(m_default_exterior_shader));
 		output_group.properties.push_back(&static_cast<k3d::iproperty&>(m_imager_shader));
 		output_group.properties.push_back(&static_cast<k3d::iproperty&>(m_render_alpha));
+		output_group.properties.push_back(&static_cast<k3d::iproperty&>(m_archive_static_geometry));
+		output_group.properties.push_back(&static_cast<k3d::iproperty&>(m_binary_rib));
+		output_group.properties.push_back(&static_cast<k3d::iproperty&>(m_compress_rib));
 
 		k3d::iproperty_group_collection::group sampling_group("Sampling");
 		sampling_group.properties.push_back(&static_cast<k3d::iproperty&>(m_bucket_width));
@@ -278,6 +298,10 @@ public:
 		k3d::ri::shader_collection shaders;
 		k3d::inetwork_render_job& job = k3d::get_network_render_farm().create_job("k3d-renderman-render-animation");
 
+		// Keep track of geometry that doesn't change between frames ...
+		k3d::ri::static_geometry_archives static_geometry(job, m_compress_rib.pipeline_value());
+		k3d::ri::static_geometry_archives* const static_geometry_archives = m_archive_static_geometry.pipeline_value() ? &static_geometry : 0;
+
 		// For each frame to be rendered ...
 		k3d::uint_t frame_index = 0;
 		for(k3d::frames::const_iterator frame = Frames.begin(); frame != Frames.end(); ++frame, ++frame_index)
@@ -297,7 +321,7 @@ public:
 			const k3d::filesystem::path output_image = render_frame.add_file("output_image");
 
 			// Render it (hidden rendering) ...
-			return_val_if_fail(render(Camera, render_frame, *render_engine, output_image, false, shaders), false);
+			return_val_if_fail(render(Camera, render_frame, *render_engine, output_image, false, shaders, static_geometry_archives), false);
 
 			// Copy the output image to its requested destination ...
 			render_frame.add_copy_command(output_image, frame->destination);
@@ -332,7 +356,7 @@ public:
 	}
 
 private:
-	bool render(k3d::icamera& Camera, k3d::inetwork_render_frame& Frame, k3d::ri::irender_engine& RenderEngine, const k3d::filesystem::path& OutputImagePath, const bool VisibleRender, k3d::ri::shader_collection& Shaders)
+	bool render(k3d::icamera& Camera, k3d::inetwork_render_frame& Frame, k3d::ri::irender_engine& RenderEngine, const k3d::filesystem::path& OutputImagePath, const bool VisibleRender, k3d::ri::shader_collection& Shaders, k3d::ri::static_geometry_archives* const StaticGeometry = 0)
 	{
 		// Sanity checks ...
 		return_val_if_fail(!OutputImagePath.empty(), false);
@@ -351,14 +375,15 @@ private:
 		const k3d::filesystem::path ribfilepath = Frame.add_file(ribfilename);
 
 		// Open the RIB file stream ...
-		k3d::filesystem::ofstream ribfile(ribfilepath);
-		return_val_if_fail(ribfile.good(), false);
+		boost::scoped_ptr<std::ostream> ribfile(detail::open_rib_file(ribfilepath, m_compress_rib.pipeline_value()));
+		return_val_if_fail(ribfile->good(), false);
 
 		// Setup the frame for RI rendering with the user's preferred engine ...
 		return_val_if_fail(RenderEngine.render(Frame, ribfilepath), false);
 
 		// Create the Ri render engine object ...
-		k3d::ri::stream stream(ribfile);
+		k3d::ri::stream stream(*ribfile);
+		stream.set_binary_encoding(m_binary_rib.pipeline_value());
 
 		// Administrivia ...
 		stream.RiNewline();
@@ -619,7 +644,13 @@ private:
 			for(k3d::inode_collection_property::nodes_t::const_iterator node = visible_nodes.begin(); node != visible_nodes.end(); ++node)
 			{
 				if(k3d::ri::irenderable* const renderable = dynamic_cast<k3d::ri::irenderable*>(*node))
-					renderable->renderman_render(state);
+				{
+					// Geometry that may be unchanged from the previous frame goes through the archive cache ...
+					if(StaticGeometry && !k3d::ri::motion_blur(state) && dynamic_cast<k3d::imesh_sink*>(*node))
+						StaticGeometry->render(*renderable, state, stream, *ribfile);
+					else
+						renderable->renderman_render(state);
+				}
 			}
 
 			// Give nodes a chance to cleanup ...
@@ -647,13 +678,9 @@ private:
 
 	void synchronize_shaders(const k3d::ri::shader_collection& Shaders, k3d::ri::irender_engine& RenderEngine)
 	{
-		// Compile each shader in the given collection ...
-		const k3d::ri::shader_collection::shaders_t& shaders = Shaders.shaders();
-		for(k3d::ri::shader_collection::shaders_t::const_iterator shader = shaders.begin(); shader != shaders.end(); ++shader)
-		{
-			if(!RenderEngine.compile_shader(*shader))
-				k3d::log() << error << k3d::string_cast(boost::format(_("Error compiling shader %1%")) % shader->native_utf8_string().raw()) << std::endl;
-		}
+		// Compile every shader in the given collection up-front, so the engine can compile them in parallel ...
+		if(!RenderEngine.compile_shaders(Shaders.shaders()))
+			k3d::log() << error << _("Error compiling shaders") << std::endl;
 	}
 
 	/// Helper class that limits the list of visible nodes to those that implement k3d::ri::irenderable
@@ -734,6 +761,9 @@ private:
 	k3d_data(bool, immutable_name, change_signal, with_undo, local_storage, no_constraint, writable_property, with_serialization) m_two_sided;
 	k3d_data(bool, immutable_name, change_signal, with_undo, local_storage, no_constraint, writable_property, with_serialization) m_motion_blur;
 	k3d_data(bool, immutable_name, change_signal, with_undo, local_storage, no_constraint, writable_property, with_serialization) m_render_motion_blur;
+	k3d_data(bool, immutable_name, change_signal, with_undo, local_storage, no_constraint, writable_property, with_serialization) m_archive_static_geometry;
+	k3d_data(bool, immutable_name, change_signal, with_undo, local_storage, no_constraint, writable_property, with_serialization) m_binary_rib;
+	k3d_data(bool, immutable_name, change_signal, with_undo, local_storage, no_constraint, writable_property, with_serialization) m_compress_rib;
 
 	const k3d::ilist_property<std::string>::values_t& pixel_filter_values()
 	{
@@ -30,11 +30,9 @@
 #include <k3dsdk/path.h>
 #include <k3dsdk/result.h>
 #include <k3dsdk/shader_cache.h>
-#include <k3dsdk/share.h>
+#include <k3dsdk/shader_compiler_ri.h>
 #include <k3dsdk/system.h>
 
-#include <sstream>
-
 namespace module
 {
 
@@ -52,7 +50,8 @@ class air :
 
 public:
 	air(k3d::iplugin_factory& Factory, k3d::idocument& Document) :
-		base(Factory, Document)
+		base(Factory, Document),
+		m_shader_compiler("shaded -I\"$SOURCE_DIRECTORY\" -I\"$GLOBAL_DIRECTORY\" -o \"$BINARY\" \"$SOURCE\"", ".slb")
 	{
 	}
 
@@ -63,26 +62,12 @@ public:
 
 	k3d::bool_t compile_shader(const k3d::filesystem::path& Shader)
 	{
-		// Compute some paths that will be used by the compiler ...
-		const k3d::filesystem::path shader_source_path = Shader;
-		const k3d::filesystem::path shader_binary_path = k3d::shader_cache_path() / k3d::filesystem::generic_path(k3d::filesystem::replace_extension(Shader, ".slb").leaf());
-		const k3d::filesystem::path shader_source_directory = Shader.branch_path();
-		const k3d::filesystem::path global_source_directory = k3d::share_path() / k3d::filesystem::generic_path("shaders");
-
-		if(k3d::filesystem::up_to_date(shader_source_path, shader_binary_path))
-			return true;
-
-		std::ostringstream command_line;
-		command_line << "shaded";
-		command_line << " -I\"" << shader_source_directory.native_filesystem_string()  << "\"";
-		command_line << " -I\"" << global_source_directory.native_filesystem_string()  << "\"";
-		command_line << " -o \"" << shader_binary_path.native_filesystem_string() << "\"";
-		command_line << " \"" << shader_source_path.native_filesystem_string() << "\"";
-
-		// Make it happen ...
-		return_val_if_fail(k3d::system::spawn_sync(command_line.str()), false);
+		return m_shader_compiler.compile(Shader);
+	}
 
-		return true;
+	k3d::bool_t compile_shaders(const k3d::ri::shader_collection::shaders_t& Shaders)
+	{
+		return m_shader_compiler.compile(Shaders);
 	}
 
 	k3d::bool_t render(k3d::inetwork_render_frame& Frame, const k3d::filesystem::path& RIB)
@@ -110,6 +95,10 @@ public:
 
 		return factory;
 	}
+
+private:
+	/// Compiles shaders into the global shader cache
+	const k3d::ri::shader_compiler m_shader_compiler;
 };
 
 /////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,41 @@
+#python
+
+import k3d
+
+def create_simulation():
+	document = k3d.new_document()
+	source = k3d.plugin.create("PolyGrid", document)
+	simulation = k3d.plugin.create("ClothSimulation", document)
+	k3d.property.connect(document, source.get_property("output_mesh"), simulation.get_property("input_mesh"))
+	return simulation
+
+def points_at(simulation, time):
+	simulation.time = time
+	return list(simulation.output_mesh.points())
+
+def require_same_points(label, expected, actual):
+	if len(expected) != len(actual):
+		raise Exception(label + ": point counts differ")
+	for i in range(len(expected)):
+		if expected[i] != actual[i]:
+			raise Exception(label + ": point " + str(i) + " differs, expected: " + str(expected[i]) + ", result: " + str(actual[i]))
+
+# Play every frame up to one second ...
+sequential = create_simulation()
+for frame in range(25):
+	sequential_end = points_at(sequential, frame / 24.0)
+
+# Jumping straight to the same time must produce the same result ...
+jump = create_simulation()
+require_same_points("jump forward", sequential_end, points_at(jump, 24 / 24.0))
+
+# Scrubbing backwards reads back the cached frame, which must match a fresh simulation of the same time ...
+fresh = create_simulation()
+require_same_points("scrub backward", points_at(fresh, 10 / 24.0), points_at(sequential, 10 / 24.0))
+
+# Jumping forward from an earlier checkpoint must match too ...
+require_same_points("scrub forward", sequential_end, points_at(fresh, 24 / 24.0))
+
+# The cloth must actually have moved ...
+if points_at(create_simulation(), 0.0) == sequential_end:
+	raise Exception("Cloth did not move")
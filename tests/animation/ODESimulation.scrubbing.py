@@ -0,0 +1,42 @@
+#python
+
+import k3d
+
+def create_simulation():
+	document = k3d.new_document()
+	simulation = k3d.plugin.create("ODESimulation", document)
+	body = k3d.plugin.create("ODEPhysicalNode", document)
+	body.input_matrix = k3d.translate3(0, 0, 10)
+	body.linear_velocity = k3d.vector3(1, 0, 0)
+	body.simulation = simulation
+	return simulation, body
+
+def matrix_at(simulation, body, time):
+	simulation.time = time
+	return body.output_matrix
+
+def require_similar_matrix(label, expected, actual):
+	for i in range(4):
+		for j in range(4):
+			if abs(expected[i][j] - actual[i][j]) > 1e-9:
+				raise Exception(label + ": matrices differ, expected: " + str(expected) + ", result: " + str(actual))
+
+# Play every frame up to two seconds, long enough for the body to land on the ground plane ...
+sequential_simulation, sequential_body = create_simulation()
+for frame in range(49):
+	sequential_end = matrix_at(sequential_simulation, sequential_body, frame / 24.0)
+
+# Jumping straight to the same time must produce the same result ...
+jump_simulation, jump_body = create_simulation()
+require_similar_matrix("jump forward", sequential_end, matrix_at(jump_simulation, jump_body, 48 / 24.0))
+
+# Scrubbing backwards reads back the cached frame, which must match a fresh simulation of the same time ...
+fresh_simulation, fresh_body = create_simulation()
+require_similar_matrix("scrub backward", matrix_at(fresh_simulation, fresh_body, 20 / 24.0), matrix_at(sequential_simulation, sequential_body, 20 / 24.0))
+
+# Jumping forward from an earlier checkpoint must match too ...
+require_similar_matrix("scrub forward", sequential_end, matrix_at(fresh_simulation, fresh_body, 48 / 24.0))
+
+# The body must actually have moved ...
+if sequential_end[0][3] <= 0 or sequential_end[2][3] >= 10:
+	raise Exception("Body did not follow its initial velocity and gravity: " + str(sequential_end))
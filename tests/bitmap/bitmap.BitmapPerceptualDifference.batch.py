@@ -0,0 +1,40 @@
+#python
+
+import k3d
+import os
+import testing
+
+# Write two directories of images, one pair identical and one pair visibly different ...
+directory_a = testing.binary_path() + "/bitmaps/batch/a"
+directory_b = testing.binary_path() + "/bitmaps/batch/b"
+for directory in [directory_a, directory_b]:
+	if not os.path.exists(directory):
+		os.makedirs(directory)
+
+document = k3d.new_document()
+
+checker = k3d.plugin.create("BitmapChecker", document)
+invert = k3d.plugin.create("BitmapInvert", document)
+k3d.property.connect(document, checker.get_property("output_bitmap"), invert.get_property("input_bitmap"))
+
+def write(source, path):
+	writer = k3d.plugin.create("PNGBitmapWriter", document)
+	writer.file = k3d.filesystem.generic_path(path)
+	k3d.property.connect(document, source.get_property("output_bitmap"), writer.get_property("input_bitmap"))
+
+write(checker, directory_a + "/same.png")
+write(checker, directory_b + "/same.png")
+write(checker, directory_a + "/different.png")
+write(invert, directory_b + "/different.png")
+
+results = testing.bitmap_perceptual_difference_batch(directory_a, directory_b, 0.01)
+
+if len(results) != 2:
+	raise Exception("incorrect number of results: " + str(len(results)))
+
+if not results["same.png"][2]:
+	raise Exception("identical images should match")
+
+if results["different.png"][2]:
+	raise Exception("inverted images should not match")
+
@@ -0,0 +1,59 @@
+#python
+
+import k3d
+import testing
+
+def require_close(name, value, expected, tolerance = 1e-9):
+	testing.dart_measurement("calculated_" + name, value)
+	testing.dart_measurement("expected_" + name, expected)
+
+	if abs(value - expected) > tolerance * max(1.0, abs(expected)):
+		raise Exception("incorrect " + name + ": " + str(value) + " expected " + str(expected))
+
+# The native measurements must match the GTS versions ...
+for source_name in ["PolyCube", "PolySphere", "PolyTorus", "PolyCylinder"]:
+	document = k3d.new_document()
+	source = k3d.plugin.create(source_name, document)
+
+	native = k3d.plugin.create("MeshMeasurements", document)
+	gts_area = k3d.plugin.create("GTSMeshArea", document)
+	gts_volume = k3d.plugin.create("GTSMeshVolume", document)
+	for node in [native, gts_area, gts_volume]:
+		k3d.property.connect(document, source.get_property("output_mesh"), node.get_property("input_mesh"))
+
+	require_close(source_name + "_area", native.area, gts_area.area)
+	require_close(source_name + "_volume", native.volume, gts_volume.volume)
+
+# Check the centroid and inertia tensor of a box against the analytic values ...
+setup = testing.setup_mesh_modifier_test("PolyCube", "MeshMeasurements")
+setup.source.width = 2
+setup.source.height = 3
+setup.source.depth = 4
+
+require_close("volume", setup.modifier.volume, 24.0)
+require_close("area", setup.modifier.area, 52.0)
+
+centroid = setup.modifier.centroid
+for i in range(3):
+	require_close("centroid", centroid[i], 0.0)
+
+inertia = setup.modifier.inertia
+require_close("inertia_xx", inertia[0][0], 24.0 * (3 * 3 + 4 * 4) / 12.0)
+require_close("inertia_yy", inertia[1][1], 24.0 * (2 * 2 + 4 * 4) / 12.0)
+require_close("inertia_zz", inertia[2][2], 24.0 * (2 * 2 + 3 * 3) / 12.0)
+require_close("inertia_xy", inertia[0][1], 0.0)
+
+# Check the optional per-face outputs ...
+setup.modifier.face = True
+mesh = setup.modifier.output_mesh
+polyhedron = k3d.polyhedron.validate(mesh, mesh.primitives()[0])
+areas = polyhedron.face_attributes()["area"]
+centers = polyhedron.face_attributes()["center"]
+if len(areas) != 6 or len(centers) != 6:
+	raise Exception("missing per-face measurements")
+
+total = 0.0
+for i in range(len(areas)):
+	total += areas[i]
+require_close("face_area_total", total, 52.0)
+
@@ -0,0 +1,17 @@
+#python
+
+import k3d
+import testing
+
+setup = testing.setup_mesh_modifier_test("PolyCube", "BevelFaces")
+
+selection = k3d.geometry.selection.create(0)
+selection.faces = [(0, 6, 1)]
+setup.modifier.mesh_selection = selection
+
+testing.require_valid_mesh(setup.document, setup.modifier.get_property("output_mesh"))
+
+setup.modifier.inset = 0.1
+setup.modifier.distance = True
+testing.require_valid_mesh(setup.document, setup.modifier.get_property("output_mesh"))
+testing.require_similar_mesh(setup.document, setup.modifier.get_property("output_mesh"), "mesh.modifier.BevelFaces.valid", 1)
@@ -0,0 +1,67 @@
+#python
+
+import k3d
+import testing
+import benchmarking
+
+document = k3d.new_document()
+
+# Build a 30 x 30 x 30 lattice of overlapping ellipsoids (27000 in all) added together into a single blobby ...
+source = k3d.plugin.create("MeshSourceScript", document)
+source.script = """#python
+
+import k3d
+
+count = 30
+spacing = 0.75
+
+blobby = k3d.blobby.create(context.output)
+blobby.first_primitives().append(0)
+blobby.primitive_counts().append(count * count * count)
+blobby.first_operators().append(0)
+blobby.operator_counts().append(1)
+blobby.materials().append(None)
+
+for z in range(count):
+	for y in range(count):
+		for x in range(count):
+			blobby.primitives().append(k3d.blobby.primitive_type.ELLIPSOID)
+			blobby.primitive_first_floats().append(len(blobby.floats()))
+			blobby.primitive_float_counts().append(16)
+			for i in (k3d.translate3(x * spacing, y * spacing, z * spacing) * k3d.scale3(1)).column_major_values():
+				blobby.floats().append(i)
+
+blobby.operators().append(k3d.blobby.operator_type.ADD)
+blobby.operator_first_operands().append(0)
+blobby.operator_operand_counts().append(count * count * count + 1)
+blobby.operands().append(count * count * count)
+for i in range(count * count * count):
+	blobby.operands().append(i)
+"""
+
+modifier = k3d.plugin.create("BlobbyToPolyhedron", document)
+modifier.resolution = 8
+k3d.property.connect(document, source.get_property("output_mesh"), modifier.get_property("input_mesh"))
+
+profiler = k3d.plugin.create("PipelineProfiler", document)
+
+testing.require_valid_mesh(document, modifier.get_property("output_mesh"))
+
+mesh = modifier.output_mesh
+polyhedron = k3d.polyhedron.validate(mesh, mesh.primitives()[0])
+if not k3d.polyhedron.is_solid(polyhedron):
+	raise Exception("polygonized blobby should be a closed solid")
+
+benchmarking.print_profiler_records(profiler.records)
+
+total = 0.0
+for (node, timing) in profiler.records.items():
+	if node.name == modifier.name:
+		for t in timing:
+			total += timing[t]
+
+print """<DartMeasurement name="Total Time" type="numeric/float">""" + str(total) + """</DartMeasurement>"""
+
+if total > 2.0:
+	raise Exception("polygonizing 27000 ellipsoids took " + str(total) + " seconds, expected less than 2")
+
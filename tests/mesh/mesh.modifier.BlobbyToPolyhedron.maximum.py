@@ -0,0 +1,36 @@
+#python
+
+import k3d
+import testing
+
+document = k3d.new_document()
+
+source1 = k3d.plugin.create("BlobbyEllipsoid", document)
+
+source2 = k3d.plugin.create("BlobbySegment", document)
+
+operator = k3d.plugin.create("BlobbyMaximum", document)
+k3d.property.create(operator, "k3d::mesh*", "input_mesh1", "Input Mesh 1", "")
+k3d.property.create(operator, "k3d::mesh*", "input_mesh2", "Input Mesh 2", "")
+
+k3d.property.connect(document, source1.get_property("output_mesh"), operator.get_property("input_mesh1"))
+k3d.property.connect(document, source2.get_property("output_mesh"), operator.get_property("input_mesh2"))
+
+modifier = k3d.plugin.create("BlobbyToPolyhedron", document)
+k3d.property.connect(document, operator.get_property("output_mesh"), modifier.get_property("input_mesh"))
+
+testing.require_valid_mesh(document, modifier.get_property("output_mesh"))
+
+mesh = modifier.output_mesh
+if len(mesh.primitives()) != 1:
+	raise Exception("expected a single polyhedron")
+
+polyhedron = k3d.polyhedron.validate(mesh, mesh.primitives()[0])
+if not polyhedron:
+	raise Exception("output is not a polyhedron")
+
+if not k3d.polyhedron.is_solid(polyhedron):
+	raise Exception("polygonized blobby should be a closed solid")
+
+testing.require_similar_mesh(document, modifier.get_property("output_mesh"), "mesh.modifier.BlobbyToPolyhedron.maximum", 8)
+
@@ -0,0 +1,32 @@
+#python
+
+import k3d
+import testing
+
+document = k3d.new_document()
+
+source = k3d.plugin.create("BlobbyEllipsoid", document)
+
+operator = k3d.plugin.create("BlobbyNegate", document)
+k3d.property.connect(document, source.get_property("output_mesh"), operator.get_property("input_mesh"))
+
+# The negated field is above a negative threshold everywhere but the ellipsoid, so the surface has to be closed off at the grid boundary ...
+modifier = k3d.plugin.create("BlobbyToPolyhedron", document)
+modifier.threshold = -0.2
+k3d.property.connect(document, operator.get_property("output_mesh"), modifier.get_property("input_mesh"))
+
+testing.require_valid_mesh(document, modifier.get_property("output_mesh"))
+
+mesh = modifier.output_mesh
+if len(mesh.primitives()) != 1:
+	raise Exception("expected a single polyhedron")
+
+polyhedron = k3d.polyhedron.validate(mesh, mesh.primitives()[0])
+if not polyhedron:
+	raise Exception("output is not a polyhedron")
+
+if not k3d.polyhedron.is_solid(polyhedron):
+	raise Exception("polygonized blobby should be a closed solid")
+
+testing.require_similar_mesh(document, modifier.get_property("output_mesh"), "mesh.modifier.BlobbyToPolyhedron.negate", 8)
+
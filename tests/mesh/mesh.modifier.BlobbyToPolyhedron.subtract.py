@@ -0,0 +1,40 @@
+#python
+
+import k3d
+import testing
+
+document = k3d.new_document()
+
+source1 = k3d.plugin.create("BlobbyEllipsoid", document)
+
+source2 = k3d.plugin.create("BlobbySegment", document)
+source2.radius = 0.5
+
+operator = k3d.plugin.create("BlobbySubtract", document)
+k3d.property.connect(document, source1.get_property("output_mesh"), operator.get_property("input_a"))
+k3d.property.connect(document, source2.get_property("output_mesh"), operator.get_property("input_b"))
+
+modifier = k3d.plugin.create("BlobbyToPolyhedron", document)
+modifier.resolution = 32
+k3d.property.connect(document, operator.get_property("output_mesh"), modifier.get_property("input_mesh"))
+
+testing.require_valid_mesh(document, modifier.get_property("output_mesh"))
+
+mesh = modifier.output_mesh
+if len(mesh.primitives()) != 1:
+	raise Exception("expected a single polyhedron")
+
+polyhedron = k3d.polyhedron.validate(mesh, mesh.primitives()[0])
+if not polyhedron:
+	raise Exception("output is not a polyhedron")
+
+if not k3d.polyhedron.is_solid(polyhedron):
+	raise Exception("polygonized blobby should be a closed solid")
+
+# Samples exactly at the threshold mustn't collapse neighbouring cell vertices onto one point ...
+points = mesh.points()
+if len(set([(point[0], point[1], point[2]) for point in points])) != len(points):
+	raise Exception("polygonized blobby contains duplicate points")
+
+testing.require_similar_mesh(document, modifier.get_property("output_mesh"), "mesh.modifier.BlobbyToPolyhedron.subtract", 8)
+
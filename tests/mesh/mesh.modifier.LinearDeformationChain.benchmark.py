@@ -0,0 +1,50 @@
+#python
+
+import k3d
+import testing
+import time
+
+# Chains of linear deformations with the same selection are evaluated in a single pass, without computing intermediate outputs ...
+document = k3d.new_document()
+
+source = k3d.plugin.create("PolyGrid", document)
+source.rows = 1000
+source.columns = 1000
+
+selection = k3d.select_all()
+
+chain = []
+for (plugin, x) in [("TranslatePoints", 1.0), ("ScalePoints", 2.0), ("TranslatePoints", 3.0), ("ScalePoints", 0.5), ("TranslatePoints", -1.0)]:
+	modifier = k3d.plugin.create(plugin, document)
+	modifier.x = x
+	modifier.mesh_selection = selection
+	if chain:
+		k3d.property.connect(document, chain[-1].get_property("output_mesh"), modifier.get_property("input_mesh"))
+	else:
+		k3d.property.connect(document, source.get_property("output_mesh"), modifier.get_property("input_mesh"))
+	chain.append(modifier)
+
+profiler = k3d.plugin.create("PipelineProfiler", document)
+
+start = time.time()
+output_points = chain[-1].output_mesh.points()
+elapsed = time.time() - start
+
+input_points = source.output_mesh.points()
+
+def require_x(points, expected, label):
+	for i in [0, len(points) / 2, len(points) - 1]:
+		if abs(points[i][0] - expected(input_points[i][0])) > 1e-8 or abs(points[i][1] - input_points[i][1]) > 1e-8:
+			raise Exception(label + " point " + str(i) + " incorrect: " + str(points[i]))
+
+require_x(output_points, lambda x: (((x + 1) * 2) + 3) * 0.5 - 1, "combined")
+
+# Intermediate nodes are only evaluated if something asks for their output ...
+intermediate_names = [node.name for node in chain[:-1]]
+for (node, timing) in profiler.records.items():
+	if node.name in intermediate_names and "Update Mesh" in timing:
+		raise Exception("intermediate node " + node.name + " was evaluated")
+
+require_x(chain[1].output_mesh.points(), lambda x: (x + 1) * 2, "intermediate")
+
+print """<DartMeasurement name="Chain Time" type="numeric/float">""" + str(elapsed) + """</DartMeasurement>"""
@@ -0,0 +1,8 @@
+#python
+
+import k3d
+import testing
+
+for subdivision_type in ["center", "centermidpoints", "midpoints"]:
+	testing.require_mesh_geometry_update("PolyCube", "SubdivideFaces", { "subdivision_type" : subdivision_type })
+
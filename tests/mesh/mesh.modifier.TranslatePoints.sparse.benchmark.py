@@ -0,0 +1,45 @@
+#python
+
+import k3d
+import testing
+import time
+
+# Compare the cost of repeatedly updating a deformer with a small point selection and with every point selected ...
+def time_updates(weights):
+	document = k3d.new_document()
+
+	source = k3d.plugin.create("PolyGrid", document)
+	source.rows = 500
+	source.columns = 500
+
+	modifier = k3d.plugin.create("TranslatePoints", document)
+	k3d.property.connect(document, source.get_property("output_mesh"), modifier.get_property("input_mesh"))
+
+	selection = k3d.geometry.selection.create(0)
+	point_selection = k3d.geometry.point_selection.create(selection)
+	k3d.geometry.point_selection.append(point_selection, 0, weights, 1)
+	modifier.mesh_selection = selection
+
+	modifier.output_mesh
+
+	start = time.time()
+	for i in range(20):
+		modifier.x = i + 1
+		modifier.output_mesh
+	elapsed = time.time() - start
+
+	# Points outside the selection must be left untouched ...
+	input_points = source.output_mesh.points()
+	output_points = modifier.output_mesh.points()
+	if abs(output_points[weights - 1][0] - (input_points[weights - 1][0] + 20)) > 1e-6:
+		raise Exception("selected point wasn't translated")
+	if weights < len(output_points) and output_points[weights][0] != input_points[weights][0]:
+		raise Exception("unselected point was modified")
+
+	return elapsed
+
+sparse_time = time_updates(1000)
+full_time = time_updates(501 * 501)
+
+print """<DartMeasurement name="Sparse Update Time" type="numeric/float">""" + str(sparse_time) + """</DartMeasurement>"""
+print """<DartMeasurement name="Full Update Time" type="numeric/float">""" + str(full_time) + """</DartMeasurement>"""
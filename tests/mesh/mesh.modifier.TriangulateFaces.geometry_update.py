@@ -0,0 +1,7 @@
+#python
+
+import k3d
+import testing
+
+testing.require_mesh_geometry_update("PolyCube", "TriangulateFaces")
+
@@ -0,0 +1,10 @@
+#python
+
+import testing
+
+setup = testing.setup_mesh_source_test("LSystemParser")
+setup.source.growth = 2
+setup.source.instances = True
+
+testing.require_valid_mesh(setup.document, setup.source.get_property("output_mesh"))
+testing.require_similar_mesh(setup.document, setup.source.get_property("output_mesh"), "mesh.source.LSystemParser.instances", 1)
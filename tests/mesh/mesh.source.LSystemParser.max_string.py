@@ -0,0 +1,28 @@
+#python
+
+import k3d
+import testing
+
+# Limiting the length of the production string stops growth at a lower level, producing a smaller mesh ...
+def create_lsystem(document, max_string):
+	source = k3d.plugin.create("LSystemParser", document)
+	source.file = k3d.share_path() / k3d.filesystem.generic_path("lsystem/abop-bush.ls")
+	source.growth = 5
+	if max_string:
+		source.max_string = max_string
+	return source
+
+document = k3d.new_document()
+unlimited = create_lsystem(document, 0)
+limited = create_lsystem(document, 4096)
+
+testing.require_valid_mesh(document, limited.get_property("output_mesh"))
+
+unlimited_count = len(unlimited.output_mesh.points())
+limited_count = len(limited.output_mesh.points())
+
+testing.dart_measurement("unlimited_point_count", unlimited_count)
+testing.dart_measurement("limited_point_count", limited_count)
+
+if limited_count == 0 or limited_count >= unlimited_count:
+	raise Exception("max_string didn't limit growth")
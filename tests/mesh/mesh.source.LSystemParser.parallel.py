@@ -0,0 +1,28 @@
+#python
+
+import k3d
+import testing
+
+# Draw the same L-system with and without parallel branches, which must produce identical meshes ...
+def create_lsystem(document, parallel):
+	source = k3d.plugin.create("LSystemParser", document)
+	source.file = k3d.share_path() / k3d.filesystem.generic_path("lsystem/abop-bush.ls")
+	source.growth = 5
+	source.parallel = parallel
+	return source
+
+document = k3d.new_document()
+serial = create_lsystem(document, False)
+parallel = create_lsystem(document, True)
+
+testing.require_valid_mesh(document, parallel.get_property("output_mesh"))
+
+result = k3d.difference.accumulator()
+k3d.difference.test(parallel.output_mesh, serial.output_mesh, result)
+
+testing.dart_measurement("exact_count", result.exact_count())
+testing.dart_measurement("exact_min", result.exact_min())
+testing.dart_measurement("ulps_max", result.ulps_max())
+
+if (result.exact_count() and result.exact_min() == 0) or result.ulps_max() > 0:
+	raise Exception("parallel output differs from serial output")
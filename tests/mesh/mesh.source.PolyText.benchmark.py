@@ -0,0 +1,39 @@
+#python
+
+import k3d
+import testing
+
+def node_time(profiler, node):
+	total = 0.0
+	for (record_node, timing) in profiler.records.items():
+		if record_node.name == node.name:
+			for t in timing:
+				total += timing[t]
+	return total
+
+paragraph = "The quick brown fox jumps over the lazy dog, while five boxing wizards jump quickly. " * 120
+
+setup = testing.setup_mesh_source_test("PolyText")
+profiler = k3d.plugin.create("PipelineProfiler", setup.document)
+
+setup.source.text = paragraph
+testing.require_valid_mesh(setup.document, setup.source.get_property("output_mesh"))
+print """<DartMeasurement name="Layout Time" type="numeric/float">""" + str(node_time(profiler, setup.source)) + """</DartMeasurement>"""
+
+# Changing one character in the middle of the paragraph only regenerates the characters that follow it ...
+middle = len(paragraph) / 2
+setup.source.text = paragraph[:middle] + "X" + paragraph[middle + 1:]
+testing.require_valid_mesh(setup.document, setup.source.get_property("output_mesh"))
+print """<DartMeasurement name="Edit Time" type="numeric/float">""" + str(node_time(profiler, setup.source)) + """</DartMeasurement>"""
+
+# Changing the height only moves points ...
+setup.source.height = 20
+testing.require_valid_mesh(setup.document, setup.source.get_property("output_mesh"))
+print """<DartMeasurement name="Resize Time" type="numeric/float">""" + str(node_time(profiler, setup.source)) + """</DartMeasurement>"""
+
+# A second node using the same font reuses the glyphs converted for the first ...
+second = k3d.plugin.create("PolyText", setup.document)
+second.name = "Second PolyText"
+second.text = paragraph
+testing.require_valid_mesh(setup.document, second.get_property("output_mesh"))
+print """<DartMeasurement name="Shared Cache Time" type="numeric/float">""" + str(node_time(profiler, second)) + """</DartMeasurement>"""
@@ -0,0 +1,26 @@
+#python
+
+import k3d
+import testing
+
+# Edit the text and height of a PolyText node, which updates its output in-place ...
+document = k3d.new_document()
+edited = k3d.plugin.create("PolyText", document)
+edited.text = "Hello, World!"
+edited.output_mesh
+edited.text = "Hello, Worlds!!"
+edited.output_mesh
+edited.height = 5
+edited.text = "Help, World!"
+
+# ... and compare the result with a node that generates the same text from scratch
+reference = k3d.plugin.create("PolyText", document)
+reference.height = 5
+reference.text = "Help, World!"
+
+result = k3d.difference.accumulator()
+k3d.difference.test(edited.output_mesh, reference.output_mesh, result)
+testing.print_difference(result)
+
+if (result.exact_count() and result.exact_min() == 0) or result.ulps_max() > 0:
+	raise Exception("edited output mesh differs from a full recompute")
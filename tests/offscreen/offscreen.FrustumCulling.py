@@ -0,0 +1,47 @@
+#python
+
+import k3d
+import testing
+
+doc = k3d.new_document()
+
+cube = k3d.plugin.create("PolyCube", doc)
+painter = k3d.plugin.create("OpenGLFacePainter", doc)
+
+# Create one instance in front of the camera, and several behind it ...
+positions = [k3d.vector3(0, 0, 0), k3d.vector3(-30, -45, 30), k3d.vector3(-40, -60, 40), k3d.vector3(-50, -75, 50)]
+for position in positions:
+	mesh_instance = k3d.plugin.create("MeshInstance", doc)
+	mesh_instance.gl_painter = painter
+	mesh_instance.input_matrix = k3d.translate3(position)
+	k3d.property.connect(doc, cube.get_property("output_mesh"), mesh_instance.get_property("input_mesh"))
+
+camera = testing.create_camera(doc)
+
+# Render the scene twice, with and without culling ...
+unculled_engine = testing.create_opengl_engine(doc)
+unculled_engine.frustum_culling = False
+
+unculled_bitmap = k3d.plugin.create("VirtualCameraToBitmap", doc)
+unculled_bitmap.camera = camera
+unculled_bitmap.render_engine = unculled_engine
+unculled_bitmap.output_bitmap
+
+render_engine = testing.create_opengl_engine(doc)
+
+camera_to_bitmap = k3d.plugin.create("VirtualCameraToBitmap", doc)
+camera_to_bitmap.camera = camera
+camera_to_bitmap.render_engine = render_engine
+camera_to_bitmap.output_bitmap
+
+testing.dart_measurement("unculled_drawn_nodes", unculled_engine.drawn_nodes)
+testing.dart_measurement("drawn_nodes", render_engine.drawn_nodes)
+testing.dart_measurement("culled_nodes", render_engine.culled_nodes)
+
+if unculled_engine.culled_nodes != 0:
+	raise Exception("nodes culled with frustum culling disabled")
+if render_engine.culled_nodes != 3:
+	raise Exception("incorrect number of culled nodes")
+if render_engine.drawn_nodes + render_engine.culled_nodes != unculled_engine.drawn_nodes:
+	raise Exception("culled nodes were drawn")
+
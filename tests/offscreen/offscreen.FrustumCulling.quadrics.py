@@ -0,0 +1,49 @@
+#python
+
+import k3d
+import testing
+
+doc = k3d.new_document()
+
+painter = k3d.plugin.create("OpenGLFacePainter", doc)
+
+behind = k3d.vector3(-40, -60, 40)
+
+# A mesh whose points lie behind the camera, but whose sphere is in front of it ...
+cube = k3d.plugin.create("PolyCube", doc)
+front_sphere = k3d.plugin.create("QuadricSphere", doc)
+front_sphere.transformation = k3d.translate3(k3d.vector3(40, 60, -40))
+
+merge_mesh = k3d.plugin.create("MergeMesh", doc)
+k3d.property.create(merge_mesh, "k3d::mesh*", "input_mesh1", "Input Mesh 1", "")
+k3d.property.create(merge_mesh, "k3d::mesh*", "input_mesh2", "Input Mesh 2", "")
+k3d.property.connect(doc, cube.get_property("output_mesh"), merge_mesh.get_property("input_mesh1"))
+k3d.property.connect(doc, front_sphere.get_property("output_mesh"), merge_mesh.get_property("input_mesh2"))
+
+mixed_instance = k3d.plugin.create("MeshInstance", doc)
+mixed_instance.gl_painter = painter
+mixed_instance.input_matrix = k3d.translate3(behind)
+k3d.property.connect(doc, merge_mesh.get_property("output_mesh"), mixed_instance.get_property("input_mesh"))
+
+# ... and a mesh containing nothing but a sphere behind the camera ...
+back_sphere = k3d.plugin.create("QuadricSphere", doc)
+
+sphere_instance = k3d.plugin.create("MeshInstance", doc)
+sphere_instance.gl_painter = painter
+sphere_instance.input_matrix = k3d.translate3(behind)
+k3d.property.connect(doc, back_sphere.get_property("output_mesh"), sphere_instance.get_property("input_mesh"))
+
+camera = testing.create_camera(doc)
+render_engine = testing.create_opengl_engine(doc)
+
+camera_to_bitmap = k3d.plugin.create("VirtualCameraToBitmap", doc)
+camera_to_bitmap.camera = camera
+camera_to_bitmap.render_engine = render_engine
+camera_to_bitmap.output_bitmap
+
+testing.dart_measurement("drawn_nodes", render_engine.drawn_nodes)
+testing.dart_measurement("culled_nodes", render_engine.culled_nodes)
+
+# Quadrics count towards mesh extents, so only the sphere-only mesh is culled ...
+if render_engine.culled_nodes != 1:
+	raise Exception("incorrect number of culled nodes")
@@ -0,0 +1,71 @@
+#python
+
+import k3d
+import os
+import re
+import resource
+import testing
+import time
+
+# Measures load time and peak memory use for a synthetic document, made from many copies of a FrozenMesh node.
+# The default 32 MB document keeps routine test runs fast; set K3D_DOCUMENT_LOAD_BENCHMARK_MEGABYTES=2048 to measure a 2 GB document ...
+target_size = int(os.environ.get("K3D_DOCUMENT_LOAD_BENCHMARK_MEGABYTES", "32")) * 1024 * 1024
+
+document = k3d.new_document()
+
+source = k3d.plugin.create("PolyGrid", document)
+source.rows = 500
+source.columns = 500
+
+frozen = k3d.plugin.create("FrozenMesh", document)
+frozen.name = "Frozen"
+k3d.property.connect(document, source.get_property("output_mesh"), frozen.get_property("input_mesh"))
+expected_point_count = len(frozen.output_mesh.points())
+k3d.property.disconnect(document, frozen.get_property("input_mesh"))
+
+template_path = testing.binary_path() + "/document.load.benchmark.template.k3d"
+document.save(template_path)
+k3d.close_document(document)
+
+# Write the synthetic document, duplicating the frozen mesh until we reach the target size ...
+template = open(template_path).read()
+node = re.search(r'<node [^>]*name="Frozen"[^>]*>.*?</node>', template, re.DOTALL)
+node_text = node.group(0)
+next_id = max([int(id) for id in re.findall(r'<node [^>]* id="(\d+)"', template)]) + 1
+
+path = testing.binary_path() + "/document.load.benchmark.output.k3d"
+output = open(path, "w")
+output.write(template[:node.start()])
+
+copy_count = 0
+while copy_count == 0 or output.tell() < target_size:
+	start_tag = node_text[:node_text.index(">")]
+	start_tag = re.sub(r' id="\d+"', ' id="' + str(next_id) + '"', start_tag)
+	start_tag = re.sub(r' name="Frozen"', ' name="Frozen ' + str(copy_count) + '"', start_tag)
+	output.write(start_tag + node_text[node_text.index(">"):])
+	next_id += 1
+	copy_count += 1
+
+output.write(template[node.end():])
+output.close()
+
+document_size = os.path.getsize(path)
+os.remove(template_path)
+
+# Load it ...
+start = time.time()
+document = k3d.open_document(k3d.filesystem.native_path(path))
+elapsed = time.time() - start
+peak_memory = resource.getrusage(resource.RUSAGE_SELF).ru_maxrss * 1024
+
+for name in ["Frozen 0", "Frozen " + str(copy_count - 1)]:
+	loaded = k3d.node.lookup_one(document, name)
+	if len(loaded.output_mesh.points()) != expected_point_count:
+		raise Exception("incorrect point count for " + name)
+
+k3d.close_document(document)
+os.remove(path)
+
+print """<DartMeasurement name="Document Size" type="numeric/integer">""" + str(document_size) + """</DartMeasurement>"""
+print """<DartMeasurement name="Load Time" type="numeric/float">""" + str(elapsed) + """</DartMeasurement>"""
+print """<DartMeasurement name="Peak Memory" type="numeric/integer">""" + str(peak_memory) + """</DartMeasurement>"""
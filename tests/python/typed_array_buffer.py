@@ -0,0 +1,81 @@
+#python
+
+import array
+import k3d
+import time
+
+document = k3d.new_document()
+frozen_mesh = k3d.plugin.create("FrozenMesh", document)
+mesh = frozen_mesh.create_mesh()
+
+# Bulk assignment from any object that supports the buffer protocol ...
+count = 100000
+values = array.array("d", [float(i) for i in range(3 * count)])
+
+points = mesh.create_points()
+points.assign(values)
+if len(points) != count:
+	raise Exception("incorrect point count after buffer assignment: " + str(len(points)))
+if points[7][0] != 21.0 or points[7][1] != 22.0 or points[7][2] != 23.0:
+	raise Exception("incorrect point after buffer assignment: " + str(points[7]))
+
+try:
+	points.assign(array.array("i", [1, 2, 3]))
+	raise Exception("assignment from a buffer with mismatched format should fail")
+except ValueError:
+	pass
+
+# Writable arrays export writable views that share storage with the array ...
+view = memoryview(points)
+if view.readonly:
+	raise Exception("writable array exported a read-only view")
+if tuple(view.shape) != (count, 3) or tuple(view.strides) != (24, 8) or view.format != "d":
+	raise Exception("incorrect view layout: " + str(view.shape) + " " + str(view.strides) + " " + view.format)
+view[7, 1] = -1.0
+if points[7][1] != -1.0:
+	raise Exception("write through view didn't modify the array")
+
+# Arrays can't be resized while views of their storage exist ...
+for resize in [lambda: points.append(k3d.point3(0, 0, 0)), lambda: points.assign([k3d.point3(0, 0, 0)]), lambda: points.assign(array.array("d", [0, 0, 0]))]:
+	try:
+		resize()
+		raise Exception("resizing an array with an exported view should fail")
+	except BufferError:
+		pass
+if len(points) != count:
+	raise Exception("failed resize modified the array")
+
+points.assign(values)
+del view
+points.append(k3d.point3(0, 0, 0))
+points.assign(values)
+
+# Const arrays export read-only views ...
+const_points = frozen_mesh.output_mesh.points()
+const_view = memoryview(const_points)
+if not const_view.readonly:
+	raise Exception("const array exported a writable view")
+if tuple(const_view.shape) != (count, 3):
+	raise Exception("incorrect const view shape: " + str(const_view.shape))
+del const_view
+
+# Index arrays ...
+polyhedron = k3d.polyhedron.create(mesh)
+vertex_points = polyhedron.vertex_points()
+vertex_points.assign(array.array("L", [0, 1, 2, 3]))
+if len(vertex_points) != 4 or vertex_points[3] != 3:
+	raise Exception("incorrect index array after buffer assignment")
+
+# Compare buffer assignment with assigning a list of values ...
+point_list = [k3d.point3(values[3 * i], values[3 * i + 1], values[3 * i + 2]) for i in range(count)]
+
+start = time.time()
+points.assign(point_list)
+list_time = time.time() - start
+
+start = time.time()
+for i in range(10):
+	points.assign(values)
+buffer_time = (time.time() - start) / 10
+
+print("list assignment: " + str(list_time) + "s buffer assignment: " + str(buffer_time) + "s")
@@ -0,0 +1,77 @@
+#include <k3dsdk/derived_points.h>
+
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+#define test_expression(expression) \
+	if(!(expression)) \
+	{ \
+		std::ostringstream buffer; \
+		buffer << #expression << " failed at " << __FILE__ << ": " << __LINE__; \
+		throw std::runtime_error(buffer.str()); \
+	} \
+
+int main(int argc, char* argv[])
+{
+	try
+	{
+		k3d::mesh::points_t input_points;
+		input_points.push_back(k3d::point3(0, 0, 0));
+		input_points.push_back(k3d::point3(2, 0, 0));
+		input_points.push_back(k3d::point3(2, 4, 0));
+
+		// Copy every input point, then add a midpoint and a point derived from the midpoint ...
+		k3d::derived_points derived_points;
+		derived_points.reset(input_points.size());
+
+		const k3d::uint_t midpoint_indices[2] = { 0, 1 };
+		const k3d::double_t midpoint_weights[2] = { 0.5, 0.5 };
+		derived_points.push_back(2, midpoint_indices, midpoint_weights);
+
+		const k3d::uint_t center_indices[3] = { 3, 2, 1 };
+		const k3d::double_t center_weights[3] = { 0.5, 0.5, 0.0 };
+		derived_points.push_back(3, center_indices, center_weights);
+
+		derived_points.push_back(1);
+
+		test_expression(derived_points.size() == 6);
+		test_expression(derived_points.input_size() == 3);
+
+		k3d::mesh::points_t output_points;
+		derived_points.evaluate(input_points, output_points);
+		test_expression(output_points.size() == 6);
+		test_expression(output_points[0] == k3d::point3(0, 0, 0));
+		test_expression(output_points[2] == k3d::point3(2, 4, 0));
+		test_expression(output_points[3] == k3d::point3(1, 0, 0));
+		test_expression(output_points[4] == k3d::point3(1.5, 2, 0));
+		test_expression(output_points[5] == k3d::point3(2, 0, 0));
+
+		// Moving the input points moves the derived points ...
+		input_points[1] = k3d::point3(4, 0, 0);
+		input_points[2] = k3d::point3(4, 8, 0);
+		derived_points.evaluate(input_points, output_points);
+		test_expression(output_points[1] == k3d::point3(4, 0, 0));
+		test_expression(output_points[3] == k3d::point3(2, 0, 0));
+		test_expression(output_points[4] == k3d::point3(3, 4, 0));
+		test_expression(output_points[5] == k3d::point3(4, 0, 0));
+
+		// Resetting discards everything ...
+		derived_points.reset();
+		test_expression(derived_points.size() == 0);
+		test_expression(derived_points.input_size() == 0);
+	}
+	catch(std::exception& e)
+	{
+		std::cerr << "uncaught exception: " << e.what() << std::endl;
+		return 1;
+	}
+	catch(...)
+	{
+		std::cerr << "unknown exception" << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
+
@@ -0,0 +1,131 @@
+#include <k3dsdk/log.h>
+#include <k3dsdk/log_control.h>
+#include <k3dsdk/parallel/blocked_range.h>
+#include <k3dsdk/parallel/parallel_for.h>
+#include <k3dsdk/parallel/threads.h>
+
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#define test_expression(expression) \
+	if(!(expression)) \
+	{ \
+		std::ostringstream buffer; \
+		buffer << #expression << " failed at " << __FILE__ << ": " << __LINE__; \
+		throw std::runtime_error(buffer.str()); \
+	} \
+
+static const k3d::uint_t message_count = 20000;
+
+/// Logs one message per index, in pieces, so interleaved output from different threads would corrupt messages
+class log_messages
+{
+public:
+	void operator()(const k3d::parallel::blocked_range<k3d::uint_t>& Range) const
+	{
+		for(k3d::uint_t i = Range.begin(); i != Range.end(); ++i)
+			k3d::log() << info << "stress " << i << " " << std::string(i % 50, 'x') << " end" << std::endl;
+	}
+};
+
+/// Collects the messages that reach a log sink
+class log_collector
+{
+public:
+	void on_message(const time_t, const k3d::log_level_t, const k3d::string_t& Message)
+	{
+		messages.push_back(Message);
+	}
+
+	std::vector<k3d::string_t> messages;
+};
+
+/// Returns true iff every message in [0, message_count) was received intact, exactly once
+bool check_messages(const std::vector<k3d::string_t>& Messages)
+{
+	std::vector<k3d::uint_t> counts(message_count, 0);
+	for(k3d::uint_t i = 0; i != Messages.size(); ++i)
+	{
+		if(Messages[i].compare(0, 7, "stress ") != 0)
+			continue;
+
+		std::istringstream buffer(Messages[i]);
+		k3d::string_t prefix;
+		k3d::uint_t index = message_count;
+		buffer >> prefix >> index;
+		if(index >= message_count)
+			return false;
+
+		std::ostringstream expected;
+		expected << "stress " << index << " " << std::string(index % 50, 'x') << " end\n";
+		if(Messages[i] != expected.str())
+			return false;
+
+		++counts[index];
+	}
+
+	for(k3d::uint_t i = 0; i != message_count; ++i)
+	{
+		if(counts[i] != 1)
+			return false;
+	}
+
+	return true;
+}
+
+int main(int argc, char* argv[])
+{
+	try
+	{
+		k3d::parallel::set_thread_count(k3d::parallel::automatic);
+
+		// Observers see every message, even when many threads log at once, once the writer thread catches up ...
+		log_collector observer;
+		sigc::connection connection = k3d::connect_log_message(sigc::mem_fun(observer, &log_collector::on_message));
+
+		k3d::parallel::parallel_for(k3d::parallel::blocked_range<k3d::uint_t>(0, message_count, 10), log_messages());
+
+		test_expression(k3d::log_flush(30.0));
+		test_expression(check_messages(observer.messages));
+
+		// Disconnected observers aren't called again, so they can be destroyed safely ...
+		k3d::disconnect_log_message(connection);
+		const k3d::uint_t observed = observer.messages.size();
+		k3d::log() << info << "after disconnect" << std::endl;
+		test_expression(k3d::log_flush(30.0));
+		test_expression(observer.messages.size() == observed);
+
+		// ... as does the log cache ...
+		log_collector cache;
+		k3d::get_log_cache(sigc::mem_fun(cache, &log_collector::on_message));
+		test_expression(check_messages(cache.messages));
+
+		// Consecutive repetitions of a message are reported once, followed by a count ...
+		for(k3d::uint_t i = 0; i != 1000; ++i)
+			k3d::log() << info << "repeated message" << std::endl;
+		k3d::log() << info << "different message" << std::endl;
+		test_expression(k3d::log_flush(30.0));
+
+		log_collector repetitions;
+		k3d::get_log_cache(sigc::mem_fun(repetitions, &log_collector::on_message));
+		test_expression(repetitions.messages.size() == cache.messages.size() + 3);
+		test_expression(repetitions.messages[cache.messages.size()] == "repeated message\n");
+		test_expression(repetitions.messages[cache.messages.size() + 1] == "last message repeated 999 times\n");
+		test_expression(repetitions.messages[cache.messages.size() + 2] == "different message\n");
+	}
+	catch(std::exception& e)
+	{
+		std::cerr << "uncaught exception: " << e.what() << std::endl;
+		return 1;
+	}
+	catch(...)
+	{
+		std::cerr << "unknown exception" << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
+
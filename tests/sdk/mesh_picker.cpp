@@ -0,0 +1,233 @@
+#include <k3dsdk/high_res_timer.h>
+#include <k3dsdk/mesh.h>
+#include <k3dsdk/mesh_picker.h>
+#include <k3dsdk/polyhedron.h>
+#include <k3dsdk/sphere.h>
+
+#include <boost/lexical_cast.hpp>
+#include <boost/scoped_ptr.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+
+#define test_expression(expression) \
+	if(!(expression)) \
+	{ \
+		std::ostringstream buffer; \
+		buffer << #expression << " failed at " << __FILE__ << ": " << __LINE__; \
+		throw std::runtime_error(buffer.str()); \
+	} \
+
+/// Pixels-per-unit for the test viewport
+const double pixels = 10;
+
+/// Creates a Size x Size grid of unit quads in the XY plane, facing +Z
+void create_grid(k3d::mesh& Mesh, const k3d::uint_t Size)
+{
+	k3d::mesh::points_t vertices;
+	for(k3d::uint_t j = 0; j <= Size; ++j)
+	{
+		for(k3d::uint_t i = 0; i <= Size; ++i)
+			vertices.push_back(k3d::point3(i, j, 0));
+	}
+
+	k3d::mesh::counts_t vertex_counts(Size * Size, 4);
+	k3d::mesh::indices_t vertex_indices;
+	for(k3d::uint_t j = 0; j != Size; ++j)
+	{
+		for(k3d::uint_t i = 0; i != Size; ++i)
+		{
+			vertex_indices.push_back(j * (Size + 1) + i);
+			vertex_indices.push_back((j + 1) * (Size + 1) + i);
+			vertex_indices.push_back((j + 1) * (Size + 1) + i + 1);
+			vertex_indices.push_back(j * (Size + 1) + i + 1);
+		}
+	}
+
+	delete k3d::polyhedron::create(Mesh, vertices, vertex_counts, vertex_indices, 0);
+}
+
+/// Returns an object-to-clip matrix for picking a region of the grid (in object coordinates), using an orthographic projection that fills the viewport
+const k3d::matrix4 pick_region(const k3d::uint_t Size, const double X1, const double X2, const double Y1, const double Y2)
+{
+	const double viewport = Size * pixels;
+	const k3d::rectangle region(X1 * pixels, X2 * pixels, viewport - (Y2 * pixels), viewport - (Y1 * pixels));
+	const k3d::matrix4 projection = k3d::translate3(-1, -1, 0) * k3d::scale3(2.0 / Size, 2.0 / Size, 0.1);
+	return k3d::pick_matrix(region, viewport, viewport) * projection;
+}
+
+/// Returns the set of component ids for a given type from a collection of records
+const std::set<k3d::selection::id> ids(const k3d::selection::records& Records, const k3d::selection::type Type)
+{
+	std::set<k3d::selection::id> results;
+	for(k3d::selection::records::const_iterator record = Records.begin(); record != Records.end(); ++record)
+		results.insert(record->get_id(Type));
+	return results;
+}
+
+/// Returns true iff an axis-aligned edge intersects the given (open) rectangle
+bool edge_inside(const k3d::point3& A, const k3d::point3& B, const double X1, const double X2, const double Y1, const double Y2)
+{
+	return std::max(A[0], B[0]) > X1 && std::min(A[0], B[0]) < X2 && std::max(A[1], B[1]) > Y1 && std::min(A[1], B[1]) < Y2;
+}
+
+void test_grid(const k3d::uint_t Size, const double X1, const double X2, const double Y1, const double Y2)
+{
+	k3d::mesh mesh;
+	create_grid(mesh, Size);
+	const k3d::mesh::points_t& points = *mesh.points;
+	boost::scoped_ptr<k3d::polyhedron::const_primitive> polyhedron(k3d::polyhedron::validate(mesh, *mesh.primitives.front()));
+	test_expression(polyhedron);
+
+	test_expression(k3d::mesh_picker::supported(mesh));
+
+	// Primitives without points (quadrics) can't be picked on the CPU, even alongside pickable polyhedra ...
+	k3d::mesh mixed_mesh(mesh);
+	delete k3d::sphere::create(mixed_mesh);
+	test_expression(!k3d::mesh_picker::supported(mixed_mesh));
+
+	const k3d::mesh_picker picker(mesh);
+	test_expression(picker.up_to_date(mesh));
+
+	const k3d::matrix4 object_to_clip = pick_region(Size, X1, X2, Y1, Y2);
+
+	k3d::selection::record prefix;
+	prefix.tokens.push_back(k3d::selection::token(k3d::selection::MESH, 0));
+
+	// Compare point picks with brute-force ...
+	std::set<k3d::selection::id> expected_points;
+	for(k3d::uint_t point = 0; point != points.size(); ++point)
+	{
+		if(points[point][0] > X1 && points[point][0] < X2 && points[point][1] > Y1 && points[point][1] < Y2)
+			expected_points.insert(point);
+	}
+
+	k3d::selection::records records;
+	picker.pick_points(mesh, object_to_clip, prefix, records);
+	test_expression(records.size() == expected_points.size());
+	test_expression(ids(records, k3d::selection::POINT) == expected_points);
+	for(k3d::uint_t i = 0; i != records.size(); ++i)
+	{
+		test_expression(records[i].tokens.size() == 2);
+		test_expression(records[i].get_id(k3d::selection::MESH) == 0);
+	}
+
+	// Compare edge picks with brute-force ...
+	std::set<k3d::selection::id> expected_edges;
+	for(k3d::uint_t edge = 0; edge != polyhedron->clockwise_edges.size(); ++edge)
+	{
+		if(edge_inside(points[polyhedron->vertex_points[edge]], points[polyhedron->vertex_points[polyhedron->clockwise_edges[edge]]], X1, X2, Y1, Y2))
+			expected_edges.insert(edge);
+	}
+
+	records.clear();
+	picker.pick_edges(mesh, object_to_clip, prefix, records);
+	test_expression(records.size() == expected_edges.size());
+	test_expression(ids(records, k3d::selection::EDGE) == expected_edges);
+	for(k3d::uint_t i = 0; i != records.size(); ++i)
+	{
+		test_expression(records[i].tokens.size() == 3);
+		test_expression(records[i].get_id(k3d::selection::PRIMITIVE) == 0);
+	}
+
+	// Compare face picks with brute-force ...
+	std::set<k3d::selection::id> expected_faces;
+	for(k3d::uint_t j = 0; j != Size; ++j)
+	{
+		for(k3d::uint_t i = 0; i != Size; ++i)
+		{
+			if(i + 1 > X1 && i < X2 && j + 1 > Y1 && j < Y2)
+				expected_faces.insert(j * Size + i);
+		}
+	}
+
+	records.clear();
+	picker.pick_faces(mesh, object_to_clip, false, false, prefix, records);
+	test_expression(ids(records, k3d::selection::FACE) == expected_faces);
+	test_expression(records.size() == expected_faces.size());
+
+	// Mirroring the grid makes every face back-facing, unless the picker is told that the transformation is inside-out ...
+	const k3d::matrix4 mirror = k3d::translate3(Size, 0, 0) * k3d::scale3(-1, 1, 1);
+	const k3d::matrix4 mirrored_object_to_clip = pick_region(Size, Size - X2, Size - X1, Y1, Y2) * mirror;
+
+	records.clear();
+	picker.pick_faces(mesh, mirrored_object_to_clip, false, false, prefix, records);
+	test_expression(records.empty());
+
+	records.clear();
+	picker.pick_faces(mesh, mirrored_object_to_clip, true, false, prefix, records);
+	test_expression(ids(records, k3d::selection::FACE) == expected_faces);
+
+	records.clear();
+	picker.pick_faces(mesh, mirrored_object_to_clip, false, true, prefix, records);
+	test_expression(ids(records, k3d::selection::FACE) == expected_faces);
+
+	// Ray picks hit the face under the ray ...
+	k3d::uint_t primitive = 0;
+	k3d::uint_t face = 0;
+	double distance = 0;
+	const k3d::uint_t i = static_cast<k3d::uint_t>(std::max(X1, 0.0));
+	const k3d::uint_t j = static_cast<k3d::uint_t>(std::max(Y1, 0.0));
+	test_expression(picker.intersect(mesh, k3d::line3(k3d::vector3(0, 0, -1), k3d::point3(i + 0.5, j + 0.5, 10)), primitive, face, distance));
+	test_expression(primitive == 0);
+	test_expression(face == j * Size + i);
+	test_expression(std::abs(distance - 10) < 1e-8);
+
+	test_expression(!picker.intersect(mesh, k3d::line3(k3d::vector3(0, 0, 1), k3d::point3(i + 0.5, j + 0.5, 10)), primitive, face, distance));
+	test_expression(!picker.intersect(mesh, k3d::line3(k3d::vector3(0, 0, -1), k3d::point3(Size + 0.5, 0.5, 10)), primitive, face, distance));
+
+	// Modifying the mesh makes the picker out-of-date ...
+	mesh.points.writable();
+	test_expression(!picker.up_to_date(mesh));
+}
+
+int main(int argc, char* argv[])
+{
+	try
+	{
+		// Small "point-radius" picks and larger rubber-band picks ...
+		test_grid(10, 3.7, 4.3, 5.6, 6.4);
+		test_grid(10, 2.5, 7.5, 1.5, 3.5);
+		test_grid(10, -2.5, 3.5, 7.5, 12.5);
+		test_grid(64, 10.2, 50.7, 3.3, 60.1);
+
+		// Optionally time picking on a large grid ...
+		if(argc > 1)
+		{
+			const k3d::uint_t size = boost::lexical_cast<k3d::uint_t>(argv[1]);
+
+			k3d::mesh mesh;
+			create_grid(mesh, size);
+
+			k3d::timer timer;
+			const k3d::mesh_picker picker(mesh);
+			std::cout << "built hierarchies for " << size * size << " faces in " << timer.elapsed() << "s" << std::endl;
+
+			k3d::selection::records records;
+			const k3d::matrix4 object_to_clip = pick_region(size, size * 0.5 - 0.3, size * 0.5 + 0.3, size * 0.5 - 0.3, size * 0.5 + 0.3);
+
+			timer.restart();
+			picker.pick_points(mesh, object_to_clip, k3d::selection::record(), records);
+			picker.pick_edges(mesh, object_to_clip, k3d::selection::record(), records);
+			picker.pick_faces(mesh, object_to_clip, false, false, k3d::selection::record(), records);
+			std::cout << "picked " << records.size() << " components in " << timer.elapsed() << "s" << std::endl;
+		}
+	}
+	catch(std::exception& e)
+	{
+		std::cerr << "uncaught exception: " << e.what() << std::endl;
+		return 1;
+	}
+	catch(...)
+	{
+		std::cerr << "unknown exception" << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
+
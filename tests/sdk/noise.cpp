@@ -0,0 +1,141 @@
+#include <k3dsdk/noise.h>
+#include <k3dsdk/parallel/threads.h>
+#include <k3dsdk/types.h>
+
+#include <cmath>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#define test_expression(expression) \
+	if(!(expression)) \
+	{ \
+		std::ostringstream buffer; \
+		buffer << #expression << " failed at " << __FILE__ << ": " << __LINE__; \
+		throw std::runtime_error(buffer.str()); \
+	} \
+
+/// Sample count that isn't a multiple of the batch block size, so partial blocks are exercised
+const k3d::uint_t count = 1000;
+
+const std::vector<k3d::double_t> create_coordinates(const k3d::double_t Scale, const k3d::double_t Offset)
+{
+	std::vector<k3d::double_t> result(count);
+	for(k3d::uint_t i = 0; i != count; ++i)
+		result[i] = Scale * std::sin(0.37 * i + Offset) * i / count;
+	return result;
+}
+
+const std::vector<k3d::double_t> x = create_coordinates(40.0, 0.0);
+const std::vector<k3d::double_t> y = create_coordinates(-25.0, 1.0);
+const std::vector<k3d::double_t> z = create_coordinates(30.0, 2.0);
+const std::vector<k3d::double_t> w = create_coordinates(-35.0, 3.0);
+
+/// Tests that the batch form of a 2D generator matches its scalar form, and stays within the given range
+template<typename GeneratorT>
+void test_generator2(const GeneratorT& Generator, const k3d::double_t Min, const k3d::double_t Max)
+{
+	std::vector<k3d::double_t> batch(count);
+	Generator(count, &x[0], &y[0], &batch[0]);
+
+	std::vector<k3d::double_t> sampled(count);
+	k3d::noise::sample(Generator, count, &x[0], &y[0], &sampled[0]);
+
+	for(k3d::uint_t i = 0; i != count; ++i)
+	{
+		test_expression(batch[i] == Generator(x[i], y[i]));
+		test_expression(sampled[i] == batch[i]);
+		test_expression(Min <= batch[i] && batch[i] <= Max);
+	}
+}
+
+/// Tests that the batch form of a 3D generator matches its scalar form, and stays within the given range
+template<typename GeneratorT>
+void test_generator3(const GeneratorT& Generator, const k3d::double_t Min, const k3d::double_t Max)
+{
+	std::vector<k3d::double_t> batch(count);
+	Generator(count, &x[0], &y[0], &z[0], &batch[0]);
+
+	std::vector<k3d::double_t> sampled(count);
+	k3d::noise::sample(Generator, count, &x[0], &y[0], &z[0], &sampled[0]);
+
+	for(k3d::uint_t i = 0; i != count; ++i)
+	{
+		test_expression(batch[i] == Generator(x[i], y[i], z[i]));
+		test_expression(sampled[i] == batch[i]);
+		test_expression(Min <= batch[i] && batch[i] <= Max);
+	}
+}
+
+/// Tests that the batch form of a 4D generator matches its scalar form, and stays within the given range
+template<typename GeneratorT>
+void test_generator4(const GeneratorT& Generator, const k3d::double_t Min, const k3d::double_t Max)
+{
+	std::vector<k3d::double_t> batch(count);
+	Generator(count, &x[0], &y[0], &z[0], &w[0], &batch[0]);
+
+	std::vector<k3d::double_t> sampled(count);
+	k3d::noise::sample(Generator, count, &x[0], &y[0], &z[0], &w[0], &sampled[0]);
+
+	for(k3d::uint_t i = 0; i != count; ++i)
+	{
+		test_expression(batch[i] == Generator(x[i], y[i], z[i], w[i]));
+		test_expression(sampled[i] == batch[i]);
+		test_expression(Min <= batch[i] && batch[i] <= Max);
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	try
+	{
+		// Every generator returns the same values whether points are evaluated one-at-a-time, in batches, or in parallel ...
+		test_generator2(k3d::noise::classic2(), -1.5, 1.5);
+		test_generator3(k3d::noise::classic3(), -1.5, 1.5);
+		test_generator4(k3d::noise::classic4(), -1.5, 1.5);
+		test_generator2(k3d::noise::simplex2(), -1.0, 1.0);
+		test_generator3(k3d::noise::simplex3(), -1.0, 1.0);
+		test_generator4(k3d::noise::simplex4(), -1.0, 1.0);
+
+		// Octave sums are bounded by the sum of the octave gains ...
+		test_generator2(k3d::noise::fbm<k3d::noise::simplex2>(4, 2.0, 0.5), -1.875, 1.875);
+		test_generator3(k3d::noise::fbm<k3d::noise::simplex3>(4, 2.0, 0.5), -1.875, 1.875);
+		test_generator4(k3d::noise::fbm<k3d::noise::simplex4>(4, 2.0, 0.5), -1.875, 1.875);
+		test_generator3(k3d::noise::turbulence<k3d::noise::simplex3>(4, 2.0, 0.5), 0.0, 1.875);
+		test_generator3(k3d::noise::turbulence<k3d::noise::classic3>(3, 1.9, 0.6), 0.0, 3.0);
+
+		// Classic noise is zero at integer lattice points ...
+		test_expression(k3d::noise::classic3()(3, -2, 5) == 0);
+
+		// The first octave of fbm matches the underlying generator ...
+		test_expression(k3d::noise::fbm<k3d::noise::simplex3>(1)(0.3, 1.7, -2.2) == k3d::noise::simplex3()(0.3, 1.7, -2.2));
+		test_expression(k3d::noise::turbulence<k3d::noise::simplex3>(1)(0.3, 1.7, -2.2) == std::abs(k3d::noise::simplex3()(0.3, 1.7, -2.2)));
+
+		// Results don't depend on how the work is divided between threads ...
+		const k3d::noise::fbm<k3d::noise::classic3> fbm;
+
+		std::vector<k3d::double_t> coarse(count);
+		k3d::parallel::set_grain_size(count);
+		k3d::noise::sample(fbm, count, &x[0], &y[0], &z[0], &coarse[0]);
+
+		std::vector<k3d::double_t> fine(count);
+		k3d::parallel::set_grain_size(1);
+		k3d::noise::sample(fbm, count, &x[0], &y[0], &z[0], &fine[0]);
+
+		test_expression(coarse == fine);
+	}
+	catch(std::exception& e)
+	{
+		std::cerr << "uncaught exception: " << e.what() << std::endl;
+		return 1;
+	}
+	catch(...)
+	{
+		std::cerr << "unknown exception" << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
+
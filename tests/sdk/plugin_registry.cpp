@@ -0,0 +1,201 @@
+#include <k3d-version-config.h>
+#include <k3dsdk/fstream.h>
+#include <k3dsdk/iplugin_factory.h>
+#include <k3dsdk/path.h>
+#include <k3dsdk/plugin_factory_collection.h>
+#include <k3dsdk/system.h>
+
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+#include <sys/types.h>
+#include <utime.h>
+
+#define test_expression(expression) \
+	if(!(expression)) \
+	{ \
+		std::ostringstream buffer; \
+		buffer << #expression << " failed at " << __FILE__ << ": " << __LINE__; \
+		throw std::runtime_error(buffer.str()); \
+	} \
+
+static void write_file(const k3d::filesystem::path& File, const std::string& Contents)
+{
+	k3d::filesystem::ofstream stream(File);
+	stream << Contents;
+}
+
+static const std::string read_file(const k3d::filesystem::path& File)
+{
+	k3d::filesystem::ifstream stream(File);
+	std::ostringstream buffer;
+	buffer << stream.rdbuf();
+	return buffer.str();
+}
+
+/// Sets the modification time of a file, so edits can be made "within the same second"
+static void set_modification_time(const k3d::filesystem::path& File, const time_t ModificationTime)
+{
+	struct utimbuf times;
+	times.actime = ModificationTime;
+	times.modtime = ModificationTime;
+	if(0 != utime(File.native_filesystem_string().c_str(), &times))
+		throw std::runtime_error("error setting modification time for " + File.native_console_string());
+}
+
+static const time_t modification_time(const k3d::filesystem::path& File)
+{
+	time_t result = 0;
+	if(!k3d::system::file_modification_time(File, result))
+		throw std::runtime_error("error getting modification time for " + File.native_console_string());
+	return result;
+}
+
+/// Returns the contents of a module proxy file describing a single document plugin
+static const std::string proxy(const std::string& PluginName, const std::string& FactoryID)
+{
+	return
+		"<?xml version=\"1.0\" ?>\n"
+		"<k3dml>\n"
+		"  <module>\n"
+		"    <plugins>\n"
+		"      <plugin name=\"" + PluginName + "\" factory_id=\"" + FactoryID + "\" quality=\"stable\" type=\"document\">\n"
+		"        <short_description>Tests the plugin registry</short_description>\n"
+		"        <categories>\n"
+		"          <category>Test</category>\n"
+		"        </categories>\n"
+		"        <metadata>\n"
+		"          <pair name=\"k3d:test\" value=\"registry\"/>\n"
+		"        </metadata>\n"
+		"      </plugin>\n"
+		"    </plugins>\n"
+		"  </module>\n"
+		"</k3dml>\n";
+}
+
+/// Loads the modules in a directory with a fresh collection, returning the factory with the given name, or NULL
+static k3d::iplugin_factory* load_factory(const k3d::filesystem::path& Directory, const std::string& Name)
+{
+	// Proxy factories are owned by the process, so the collection is intentionally leaked ...
+	k3d::plugin_factory_collection* const collection = new k3d::plugin_factory_collection();
+	collection->load_modules(Directory, false, k3d::plugin_factory_collection::LOAD_PROXIES);
+
+	const k3d::iplugin_factory_collection::factories_t& factories = collection->factories();
+	for(k3d::iplugin_factory_collection::factories_t::const_iterator factory = factories.begin(); factory != factories.end(); ++factory)
+	{
+		if((*factory)->name() == Name)
+			return *factory;
+	}
+
+	return 0;
+}
+
+int main(int argc, char* argv[])
+{
+	try
+	{
+		// Setup a scratch plugin directory containing a single proxied module ...
+		const k3d::filesystem::path root = k3d::system::generate_temp_file();
+		k3d::filesystem::remove(root);
+		k3d::filesystem::create_directories(root);
+
+		const k3d::filesystem::path module_a = root / k3d::filesystem::generic_path("a.module");
+		const k3d::filesystem::path proxy_a = root / k3d::filesystem::generic_path("a.module.proxy");
+		const k3d::filesystem::path module_b = root / k3d::filesystem::generic_path("b.module");
+		const k3d::filesystem::path proxy_b = root / k3d::filesystem::generic_path("b.module.proxy");
+		const k3d::filesystem::path registry = root / k3d::filesystem::generic_path("plugins.registry");
+
+		write_file(module_a, "not a real module");
+		write_file(proxy_a, proxy("RegistryTestA", "9ab1b0d2 8c1f4a6e 97b3e25c 2d1f0a11"));
+		const time_t proxy_time = modification_time(proxy_a);
+
+		// The first load parses the proxy and writes the registry ...
+		test_expression(!k3d::filesystem::exists(registry));
+		test_expression(load_factory(root, "RegistryTestA"));
+		test_expression(k3d::filesystem::exists(registry));
+		const std::string registry_contents = read_file(registry);
+
+		// Changing the proxy without changing its size or modification time isn't detected, so this shows the registry is
+		// being read, and that it round-trips everything in the proxy ...
+		write_file(proxy_a, proxy("RegistryTestZ", "9ab1b0d2 8c1f4a6e 97b3e25c 2d1f0a11"));
+		set_modification_time(proxy_a, proxy_time);
+		test_expression(!load_factory(root, "RegistryTestZ"));
+		k3d::iplugin_factory* const cached = load_factory(root, "RegistryTestA");
+		test_expression(cached);
+		test_expression(cached->factory_id() == k3d::uuid(0x9ab1b0d2, 0x8c1f4a6e, 0x97b3e25c, 0x2d1f0a11));
+		test_expression(cached->short_description() == "Tests the plugin registry");
+		test_expression(cached->quality() == k3d::iplugin_factory::STABLE);
+		test_expression(cached->categories().size() == 1 && cached->categories().front() == "Test");
+		test_expression(cached->metadata()["k3d:test"] == "registry");
+		test_expression(read_file(registry) == registry_contents);
+
+		// A proxy rewritten within the same second is stale if its size changed ...
+		write_file(proxy_a, proxy("RegistryTestLonger", "9ab1b0d2 8c1f4a6e 97b3e25c 2d1f0a11"));
+		set_modification_time(proxy_a, proxy_time);
+		test_expression(load_factory(root, "RegistryTestLonger"));
+		test_expression(!load_factory(root, "RegistryTestA"));
+
+		// ... and a proxy with a new modification time is stale even if its size is unchanged ...
+		write_file(proxy_a, proxy("RegistryTestNewest", "9ab1b0d2 8c1f4a6e 97b3e25c 2d1f0a11"));
+		set_modification_time(proxy_a, proxy_time + 10);
+		test_expression(load_factory(root, "RegistryTestNewest"));
+
+		// ... as is a rebuilt module ...
+		write_file(proxy_a, proxy("RegistryTestModule", "9ab1b0d2 8c1f4a6e 97b3e25c 2d1f0a11"));
+		set_modification_time(proxy_a, proxy_time + 10);
+		write_file(module_a, "still not a real module");
+		test_expression(load_factory(root, "RegistryTestModule"));
+
+		// Adding a module makes the registry stale ...
+		write_file(module_b, "not a real module either");
+		write_file(proxy_b, proxy("RegistryTestB", "5e6b8f40 1c2d4e3f a0b1c2d3 e4f50617"));
+		test_expression(load_factory(root, "RegistryTestModule"));
+		test_expression(load_factory(root, "RegistryTestB"));
+		const std::string complete_registry = read_file(registry);
+
+		// A truncated registry falls back to the proxies, and is rewritten ...
+		write_file(registry, complete_registry.substr(0, complete_registry.size() / 2));
+		test_expression(load_factory(root, "RegistryTestModule"));
+		test_expression(load_factory(root, "RegistryTestB"));
+		test_expression(read_file(registry) == complete_registry);
+
+		write_file(registry, "");
+		test_expression(load_factory(root, "RegistryTestB"));
+		test_expression(read_file(registry) == complete_registry);
+
+		// So is a registry written by a different version of K-3D ...
+		std::string other_version = complete_registry;
+		const std::string::size_type version = other_version.find(K3D_VERSION);
+		test_expression(version != std::string::npos);
+		other_version[version] = other_version[version] == '9' ? '8' : '9';
+		write_file(registry, other_version);
+		test_expression(load_factory(root, "RegistryTestModule"));
+		test_expression(load_factory(root, "RegistryTestB"));
+		test_expression(read_file(registry) == complete_registry);
+
+		// ... or with a different layout ...
+		std::string other_layout = complete_registry;
+		const std::string::size_type magic = other_layout.find("K-3D plugin registry");
+		test_expression(magic != std::string::npos);
+		other_layout[magic] = 'X';
+		write_file(registry, other_layout);
+		test_expression(load_factory(root, "RegistryTestModule"));
+		test_expression(load_factory(root, "RegistryTestB"));
+		test_expression(read_file(registry) == complete_registry);
+
+		k3d::filesystem::remove(module_a);
+		k3d::filesystem::remove(proxy_a);
+		k3d::filesystem::remove(module_b);
+		k3d::filesystem::remove(proxy_b);
+		k3d::filesystem::remove(registry);
+		k3d::filesystem::remove(root);
+	}
+	catch(std::exception& e)
+	{
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
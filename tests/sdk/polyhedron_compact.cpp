@@ -0,0 +1,85 @@
+#include <k3dsdk/mesh.h>
+#include <k3dsdk/polyhedron.h>
+
+#include <boost/assign/list_of.hpp>
+#include <boost/scoped_ptr.hpp>
+
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+#define test_expression(expression) \
+	if(!(expression)) \
+	{ \
+		std::ostringstream buffer; \
+		buffer << #expression << " failed at " << __FILE__ << ": " << __LINE__; \
+		throw std::runtime_error(buffer.str()); \
+	} \
+
+/// Returns the number of compact arrays in a primitive's structure
+const k3d::uint_t compact_array_count(const k3d::mesh::primitive& Primitive)
+{
+	k3d::uint_t result = 0;
+	for(k3d::mesh::named_tables_t::const_iterator structure = Primitive.structure.begin(); structure != Primitive.structure.end(); ++structure)
+	{
+		for(k3d::mesh::table_t::const_iterator array = structure->second.begin(); array != structure->second.end(); ++array)
+		{
+			if(dynamic_cast<const k3d::mesh::compact_indices_t*>(array->second.get()))
+				++result;
+		}
+	}
+
+	return result;
+}
+
+int main(int argc, char* argv[])
+{
+	try
+	{
+		// Create a pair of quads sharing an edge ...
+		const k3d::mesh::points_t vertices = boost::assign::list_of
+			(k3d::point3(0, 0, 0))(k3d::point3(1, 0, 0))(k3d::point3(2, 0, 0))(k3d::point3(0, 1, 0))(k3d::point3(1, 1, 0))(k3d::point3(2, 1, 0));
+		const k3d::mesh::counts_t vertex_counts(2, 4);
+		const k3d::mesh::indices_t vertex_indices = boost::assign::list_of(0)(1)(4)(3)(1)(2)(5)(4);
+
+		k3d::mesh mesh;
+		delete k3d::polyhedron::create(mesh, vertices, vertex_counts, vertex_indices, 0);
+		test_expression(mesh.primitives.size() == 1);
+
+		k3d::mesh::primitive& primitive = mesh.primitives.front().writable();
+		const k3d::uint_t compacted = k3d::polyhedron::compact(primitive);
+		test_expression(compacted > 0);
+		test_expression(compact_array_count(primitive) == compacted);
+
+		// The const validate() reads compact arrays as k3d::uint_t indices, without converting the primitive ...
+		{
+			const k3d::mesh::primitive& const_primitive = primitive;
+			boost::scoped_ptr<k3d::polyhedron::const_primitive> polyhedron(k3d::polyhedron::validate(mesh, const_primitive));
+			test_expression(polyhedron);
+			test_expression(polyhedron->vertex_points == vertex_indices);
+			test_expression(polyhedron->face_first_loops.size() == 2);
+			test_expression(polyhedron->clockwise_edges.size() == 8);
+			test_expression(compact_array_count(primitive) == compacted);
+		}
+
+		// ... while the writable validate() converts them back to k3d::uint_t storage ...
+		{
+			boost::scoped_ptr<k3d::polyhedron::primitive> polyhedron(k3d::polyhedron::validate(mesh, primitive));
+			test_expression(polyhedron);
+			test_expression(polyhedron->vertex_points == vertex_indices);
+			test_expression(compact_array_count(primitive) == 0);
+		}
+
+		test_expression(k3d::polyhedron::compact(primitive) == compacted);
+		test_expression(k3d::polyhedron::expand(primitive) == compacted);
+		test_expression(compact_array_count(primitive) == 0);
+	}
+	catch(std::exception& e)
+	{
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
+
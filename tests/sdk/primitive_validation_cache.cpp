@@ -0,0 +1,115 @@
+#include <k3dsdk/mesh.h>
+#include <k3dsdk/polyhedron.h>
+#include <k3dsdk/primitive_validation.h>
+
+#include <boost/scoped_ptr.hpp>
+
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+#define test_expression(expression) \
+	if(!(expression)) \
+	{ \
+		std::ostringstream buffer; \
+		buffer << #expression << " failed at " << __FILE__ << ": " << __LINE__; \
+		throw std::runtime_error(buffer.str()); \
+	} \
+
+/// Returns true iff the first primitive in a mesh is a valid polyhedron
+bool valid_polyhedron(const k3d::mesh& Mesh)
+{
+	boost::scoped_ptr<k3d::polyhedron::const_primitive> polyhedron(k3d::polyhedron::validate(Mesh, *Mesh.primitives.front()));
+	return polyhedron ? true : false;
+}
+
+int main(int argc, char* argv[])
+{
+	try
+	{
+		k3d::mesh::points_t vertices;
+		vertices.push_back(k3d::point3(0, 0, 0));
+		vertices.push_back(k3d::point3(1, 0, 0));
+		vertices.push_back(k3d::point3(1, 1, 0));
+		vertices.push_back(k3d::point3(0, 1, 0));
+
+		k3d::mesh::counts_t vertex_counts(1, 4);
+
+		k3d::mesh::indices_t vertex_indices;
+		vertex_indices.push_back(0);
+		vertex_indices.push_back(1);
+		vertex_indices.push_back(2);
+		vertex_indices.push_back(3);
+
+		k3d::mesh mesh;
+		delete k3d::polyhedron::create(mesh, vertices, vertex_counts, vertex_indices, 0);
+
+		// Array generations change whenever an array is handed-out for modification ...
+		const k3d::uint_t points_generation = mesh.points->generation();
+		mesh.points.writable();
+		test_expression(mesh.points->generation() != points_generation);
+
+		// ... and copies get their own generation ...
+		k3d::mesh::points_t points_copy(*mesh.points);
+		test_expression(points_copy.generation() != mesh.points->generation());
+
+		// Arrays that may still be modified through a mutable reference aren't frozen, so they are never cached ...
+		test_expression(!mesh.points->frozen());
+		test_expression(valid_polyhedron(mesh));
+		test_expression(!k3d::valid_primitive_cached(mesh, *mesh.primitives.front()));
+
+		// ... sharing a mesh freezes its arrays, so a successfully-validated primitive is cached ...
+		k3d::mesh shared_mesh(mesh);
+		test_expression(mesh.points->frozen());
+		test_expression(!k3d::valid_primitive_cached(mesh, *mesh.primitives.front()));
+		test_expression(valid_polyhedron(mesh));
+		test_expression(k3d::valid_primitive_cached(mesh, *mesh.primitives.front()));
+		test_expression(k3d::valid_primitive_cached(shared_mesh, *shared_mesh.primitives.front()));
+		test_expression(valid_polyhedron(mesh));
+
+		// Modifying the mesh points invalidates the cache ...
+		mesh.points.writable()[0] = k3d::point3(0, 0, 1);
+		test_expression(!mesh.points->frozen());
+		test_expression(!k3d::valid_primitive_cached(mesh, *mesh.primitives.front()));
+		test_expression(valid_polyhedron(mesh));
+		test_expression(!k3d::valid_primitive_cached(mesh, *mesh.primitives.front()));
+		shared_mesh = mesh;
+		test_expression(valid_polyhedron(mesh));
+		test_expression(k3d::valid_primitive_cached(mesh, *mesh.primitives.front()));
+
+		// Modifying primitive arrays invalidates the cache, so topology errors are still reported ...
+		k3d::mesh::indices_t& clockwise_edges = *mesh.primitives.front().writable().structure["edge"].writable<k3d::mesh::indices_t>("clockwise_edges");
+		clockwise_edges[0] = 42;
+		test_expression(!k3d::valid_primitive_cached(mesh, *mesh.primitives.front()));
+		test_expression(!valid_polyhedron(mesh));
+		test_expression(!valid_polyhedron(mesh));
+
+		// ... including modifications made through a mutable reference that is held across validations ...
+		clockwise_edges[0] = 1;
+		test_expression(valid_polyhedron(mesh));
+		clockwise_edges[0] = 42;
+		test_expression(!valid_polyhedron(mesh));
+		clockwise_edges[0] = 1;
+
+		// Adding arrays invalidates the cache ...
+		shared_mesh = mesh;
+		test_expression(valid_polyhedron(mesh));
+		test_expression(k3d::valid_primitive_cached(mesh, *mesh.primitives.front()));
+		mesh.primitives.front().writable().attributes["face"].create<k3d::mesh::doubles_t>("weights", new k3d::mesh::doubles_t(1, 0.5));
+		test_expression(!k3d::valid_primitive_cached(mesh, *mesh.primitives.front()));
+		test_expression(valid_polyhedron(mesh));
+	}
+	catch(std::exception& e)
+	{
+		std::cerr << "uncaught exception: " << e.what() << std::endl;
+		return 1;
+	}
+	catch(...)
+	{
+		std::cerr << "unknown exception" << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
+
@@ -0,0 +1,110 @@
+#include <k3dsdk/parallel/reduction_tree.h>
+#include <k3dsdk/types.h>
+
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+#define test_expression(expression) \
+	if(!(expression)) \
+	{ \
+		std::ostringstream buffer; \
+		buffer << #expression << " failed at " << __FILE__ << ": " << __LINE__; \
+		throw std::runtime_error(buffer.str()); \
+	} \
+
+typedef k3d::parallel::reduction_tree<k3d::string_t> tree_t;
+typedef tree_t::value_ptr value_ptr;
+
+/// Concatenation is associative but not commutative, so it detects operands that are combined out-of-order
+struct concatenate
+{
+	value_ptr operator()(const k3d::string_t& A, const k3d::string_t& B) const
+	{
+		return value_ptr(new k3d::string_t(A + B));
+	}
+};
+
+const std::vector<value_ptr> create_operands(const k3d::string_t& Names)
+{
+	std::vector<value_ptr> result;
+	for(k3d::uint_t i = 0; i != Names.size(); ++i)
+		result.push_back(value_ptr(new k3d::string_t(1, Names[i])));
+	return result;
+}
+
+int main(int argc, char* argv[])
+{
+	try
+	{
+		tree_t tree;
+
+		// Empty and single-operand reductions don't call the operation ...
+		test_expression(!tree.reduce(std::vector<value_ptr>(), concatenate()));
+		test_expression(tree.operation_count() == 0);
+
+		std::vector<value_ptr> operands = create_operands("a");
+		test_expression(tree.reduce(operands, concatenate()) == operands[0]);
+		test_expression(tree.operation_count() == 0);
+
+		// A full reduction calls the operation N - 1 times ...
+		operands = create_operands("abcdefgh");
+		test_expression(*tree.reduce(operands, concatenate()) == "abcdefgh");
+		test_expression(tree.operation_count() == 7);
+
+		// Reducing the same operands again reuses every intermediate result ...
+		const value_ptr result = tree.reduce(operands, concatenate());
+		test_expression(*result == "abcdefgh");
+		test_expression(tree.operation_count() == 0);
+		test_expression(tree.reduce(operands, concatenate()) == result);
+
+		// Changing one operand only recomputes the nodes on its path to the root ...
+		operands[5] = value_ptr(new k3d::string_t("F"));
+		test_expression(*tree.reduce(operands, concatenate()) == "abcdeFgh");
+		test_expression(tree.operation_count() == 3);
+
+		// Odd numbers of operands ...
+		operands = create_operands("abcde");
+		test_expression(*tree.reduce(operands, concatenate()) == "abcde");
+		test_expression(tree.operation_count() == 4);
+
+		operands[4] = value_ptr(new k3d::string_t("E"));
+		test_expression(*tree.reduce(operands, concatenate()) == "abcdE");
+		test_expression(tree.operation_count() == 1);
+
+		// Appending an operand only recomputes the right-hand side of the tree ...
+		operands.push_back(value_ptr(new k3d::string_t("f")));
+		test_expression(*tree.reduce(operands, concatenate()) == "abcdEf");
+		test_expression(tree.operation_count() == 2);
+
+		// Many operands ...
+		std::vector<value_ptr> many;
+		k3d::string_t expected;
+		for(k3d::uint_t i = 0; i != 1000; ++i)
+		{
+			const k3d::string_t name(1, 'a' + (i % 26));
+			many.push_back(value_ptr(new k3d::string_t(name)));
+			expected += name;
+		}
+		test_expression(*tree.reduce(many, concatenate()) == expected);
+		test_expression(tree.operation_count() == 999);
+
+		many[500] = value_ptr(new k3d::string_t("-"));
+		expected[500] = '-';
+		test_expression(*tree.reduce(many, concatenate()) == expected);
+		test_expression(tree.operation_count() <= 10);
+	}
+	catch(std::exception& e)
+	{
+		std::cerr << "uncaught exception: " << e.what() << std::endl;
+		return 1;
+	}
+	catch(...)
+	{
+		std::cerr << "unknown exception" << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
+
@@ -0,0 +1,269 @@
+#include <k3dsdk/algebra.h>
+#include <k3dsdk/istream_ri.h>
+#include <k3dsdk/path.h>
+#include <k3dsdk/stream_ri.h>
+#include <k3dsdk/typed_array.h>
+
+#include <boost/cstdint.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/// Writes the same set of requests to a RIB stream, so we can compare encodings
+void write_rib(std::ostream& Stream, const bool Binary)
+{
+	k3d::ri::stream stream(Stream);
+	stream.set_binary_encoding(Binary);
+
+	stream.RiComment("Binary encoding test");
+	stream.RiFrameBegin(1);
+	stream.RiWorldBegin();
+	stream.RiAttributeBegin();
+	stream.RiTransform(k3d::translate3(1, 2, 3) * k3d::rotate3(0.5, k3d::vector3(0, 0, 1)));
+	stream.RiColor(k3d::color(0.25, 0.5, 0.75));
+	stream.RiSurfaceV(k3d::filesystem::path(), "plastic", k3d::ri::parameter_list(1, k3d::ri::parameter("Kd", k3d::ri::UNIFORM, 1, k3d::ri::real(0.8))));
+
+	k3d::ri::unsigned_integers vertex_counts;
+	vertex_counts.push_back(3);
+	vertex_counts.push_back(4);
+
+	k3d::ri::unsigned_integers vertex_ids;
+	for(k3d::ri::unsigned_integer i = 0; i != 7; ++i)
+		vertex_ids.push_back(i % 5);
+
+	k3d::typed_array<k3d::ri::point>* const points = new k3d::typed_array<k3d::ri::point>();
+	for(int i = 0; i != 5; ++i)
+		points->push_back(k3d::ri::point(i, -i * 0.5, i * 1000.125));
+
+	k3d::ri::parameter_list parameters;
+	parameters.push_back(k3d::ri::parameter(k3d::ri::RI_P(), k3d::ri::VERTEX, 1, points));
+	stream.RiPointsPolygonsV(vertex_counts, vertex_ids, parameters);
+
+	stream.RiSphereV(1.5, -1.5, 1.5, 360);
+	stream.RiTranslate(-70000, 0.001, 42);
+	stream.RiPointsPolygonsV(k3d::ri::unsigned_integers(1, 3), k3d::ri::unsigned_integers(3, 70000));
+	stream.RiAttributeEnd();
+	stream.RiWorldEnd();
+	stream.RiFrameEnd();
+}
+
+/// Reads a big-endian unsigned value from the given position in a buffer
+boost::uint32_t read_big_endian(const std::string& Buffer, std::string::size_type& Position, const unsigned int ByteCount)
+{
+	if(Position + ByteCount > Buffer.size())
+		throw std::runtime_error("unexpected end of binary RIB");
+
+	boost::uint32_t result = 0;
+	for(unsigned int i = 0; i != ByteCount; ++i)
+		result = (result << 8) | static_cast<unsigned char>(Buffer[Position++]);
+	return result;
+}
+
+const std::string read_binary_string(const std::string& Buffer, std::string::size_type& Position)
+{
+	const unsigned char c = static_cast<unsigned char>(Buffer.at(Position++));
+
+	std::string::size_type length = 0;
+	if(c >= 0220 && c <= 0237)
+		length = c - 0220;
+	else if(c >= 0240 && c <= 0243)
+		length = read_big_endian(Buffer, Position, c - 0240 + 1);
+	else
+		throw std::runtime_error("expected binary string");
+
+	if(Position + length > Buffer.size())
+		throw std::runtime_error("unexpected end of binary RIB");
+
+	const std::string result = Buffer.substr(Position, length);
+	Position += length;
+	return result;
+}
+
+const std::string number_token(const double Value)
+{
+	std::ostringstream buffer;
+	buffer.precision(17);
+	buffer << Value;
+	return buffer.str();
+}
+
+/// Splits a RIB stream (which may freely mix ASCII and binary encodings) into a sequence of tokens, discarding comments
+const std::vector<std::string> tokenize(const std::string& Buffer)
+{
+	std::vector<std::string> tokens;
+	std::map<int, std::string> requests;
+	std::string word;
+
+	for(std::string::size_type position = 0; position < Buffer.size(); )
+	{
+		const unsigned char c = static_cast<unsigned char>(Buffer[position]);
+
+		if(c < 0200 && !std::isspace(c) && c != '[' && c != ']' && c != '"' && c != '#')
+		{
+			word += Buffer[position++];
+			continue;
+		}
+
+		if(!word.empty())
+		{
+			tokens.push_back(word);
+			word.clear();
+		}
+
+		if(std::isspace(c))
+		{
+			++position;
+		}
+		else if(c == '[' || c == ']')
+		{
+			tokens.push_back(std::string(1, c));
+			++position;
+		}
+		else if(c == '#')
+		{
+			position = Buffer.find('\n', position);
+		}
+		else if(c == '"')
+		{
+			const std::string::size_type end = Buffer.find('"', position + 1);
+			if(end == std::string::npos)
+				throw std::runtime_error("unterminated string");
+			tokens.push_back(Buffer.substr(position, end - position + 1));
+			position = end + 1;
+		}
+		else if(c >= 0200 && c <= 0217)
+		{
+			++position;
+			const unsigned int byte_count = (c & 03) + 1;
+			const unsigned int fraction_bytes = (c >> 2) & 03;
+			boost::uint32_t bits = read_big_endian(Buffer, position, byte_count);
+			double value = byte_count == 4 ? static_cast<double>(static_cast<boost::int32_t>(bits)) : static_cast<double>(bits);
+			tokens.push_back(number_token(value / std::pow(256.0, static_cast<int>(fraction_bytes))));
+		}
+		else if((c >= 0220 && c <= 0243))
+		{
+			tokens.push_back("\"" + read_binary_string(Buffer, position) + "\"");
+		}
+		else if(c == 0244)
+		{
+			++position;
+			const boost::uint32_t bits = read_big_endian(Buffer, position, 4);
+			float value;
+			std::memcpy(&value, &bits, sizeof(value));
+			tokens.push_back(number_token(value));
+		}
+		else if(c == 0246)
+		{
+			++position;
+			const int code = static_cast<unsigned char>(Buffer.at(position++));
+			if(!requests.count(code))
+				throw std::runtime_error("use of undefined encoded request");
+			tokens.push_back(requests[code]);
+		}
+		else if(c >= 0310 && c <= 0313)
+		{
+			++position;
+			const boost::uint32_t count = read_big_endian(Buffer, position, c - 0310 + 1);
+			tokens.push_back("[");
+			for(boost::uint32_t i = 0; i != count; ++i)
+			{
+				const boost::uint32_t bits = read_big_endian(Buffer, position, 4);
+				float value;
+				std::memcpy(&value, &bits, sizeof(value));
+				tokens.push_back(number_token(value));
+			}
+			tokens.push_back("]");
+		}
+		else if(c == 0314)
+		{
+			++position;
+			const int code = static_cast<unsigned char>(Buffer.at(position++));
+			requests[code] = read_binary_string(Buffer, position);
+		}
+		else
+		{
+			std::ostringstream message;
+			message << "unexpected binary RIB byte 0" << std::oct << static_cast<int>(c);
+			throw std::runtime_error(message.str());
+		}
+	}
+
+	if(!word.empty())
+		tokens.push_back(word);
+
+	return tokens;
+}
+
+/// Returns true iff the given token is a number, storing its value
+bool number(const std::string& Token, double& Value)
+{
+	char* end = 0;
+	Value = std::strtod(Token.c_str(), &end);
+	return !Token.empty() && end == Token.c_str() + Token.size();
+}
+
+int main(int argc, char* argv[])
+{
+	try
+	{
+		std::ostringstream ascii_buffer;
+		write_rib(ascii_buffer, false);
+
+		std::ostringstream binary_buffer;
+		write_rib(binary_buffer, true);
+
+		if(binary_buffer.str().size() >= ascii_buffer.str().size())
+			throw std::runtime_error("binary RIB should be smaller than ASCII RIB");
+
+		const std::vector<std::string> ascii_tokens = tokenize(ascii_buffer.str());
+		const std::vector<std::string> binary_tokens = tokenize(binary_buffer.str());
+
+		if(ascii_tokens.size() != binary_tokens.size())
+		{
+			std::ostringstream message;
+			message << "token count mismatch: " << ascii_tokens.size() << " ASCII tokens, " << binary_tokens.size() << " binary tokens";
+			throw std::runtime_error(message.str());
+		}
+
+		for(std::vector<std::string>::size_type i = 0; i != ascii_tokens.size(); ++i)
+		{
+			double ascii_value = 0;
+			double binary_value = 0;
+			if(number(ascii_tokens[i], ascii_value) && number(binary_tokens[i], binary_value))
+			{
+				if(std::fabs(ascii_value - binary_value) <= 1e-5 * std::max(1.0, std::fabs(ascii_value)))
+					continue;
+			}
+			else if(ascii_tokens[i] == binary_tokens[i])
+			{
+				continue;
+			}
+
+			std::ostringstream message;
+			message << "token " << i << " differs: [" << ascii_tokens[i] << "] versus [" << binary_tokens[i] << "]";
+			throw std::runtime_error(message.str());
+		}
+	}
+	catch(std::exception& e)
+	{
+		std::cerr << "uncaught exception: " << e.what() << std::endl;
+		return 1;
+	}
+	catch(...)
+	{
+		std::cerr << "unknown exception" << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
+
@@ -0,0 +1,327 @@
+#include <k3dsdk/geometry.h>
+#include <k3dsdk/mesh.h>
+#include <k3dsdk/polyhedron.h>
+#include <k3dsdk/selection.h>
+
+#include <boost/scoped_ptr.hpp>
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+#define test_expression(expression) \
+	if(!(expression)) \
+	{ \
+		std::ostringstream buffer; \
+		buffer << #expression << " failed at " << __FILE__ << ": " << __LINE__; \
+		throw std::runtime_error(buffer.str()); \
+	} \
+
+/// Deterministic pseudo-random numbers in [0, Range)
+k3d::uint_t random(const k3d::uint_t Range)
+{
+	static k3d::uint_t seed = 12345;
+	seed = (seed * 1103515245 + 12345) % 2147483648UL;
+	return (seed / 65536) % Range;
+}
+
+/// Creates a Size x Size grid of quads
+void create_grid(k3d::mesh& Mesh, const k3d::uint_t Size)
+{
+	k3d::mesh::points_t vertices;
+	for(k3d::uint_t j = 0; j <= Size; ++j)
+	{
+		for(k3d::uint_t i = 0; i <= Size; ++i)
+			vertices.push_back(k3d::point3(i, j, 0));
+	}
+
+	k3d::mesh::counts_t vertex_counts(Size * Size, 4);
+	k3d::mesh::indices_t vertex_indices;
+	for(k3d::uint_t j = 0; j != Size; ++j)
+	{
+		for(k3d::uint_t i = 0; i != Size; ++i)
+		{
+			vertex_indices.push_back(j * (Size + 1) + i);
+			vertex_indices.push_back((j + 1) * (Size + 1) + i);
+			vertex_indices.push_back((j + 1) * (Size + 1) + i + 1);
+			vertex_indices.push_back(j * (Size + 1) + i + 1);
+		}
+	}
+
+	delete k3d::polyhedron::create(Mesh, vertices, vertex_counts, vertex_indices, 0);
+}
+
+/// Returns a random weight, favoring the values used by interactive selection
+const k3d::double_t random_weight()
+{
+	switch(random(4))
+	{
+		case 0:
+			return 0.0;
+		case 1:
+			return 0.5;
+		default:
+			return 1.0;
+	}
+}
+
+/// Returns a random component type, including one that doesn't match any polyhedron arrays
+const k3d::selection::type random_type()
+{
+	switch(random(4))
+	{
+		case 0:
+			return k3d::selection::FACE;
+		case 1:
+			return k3d::selection::EDGE;
+		case 2:
+			return k3d::selection::VERTEX;
+		default:
+			return k3d::selection::CURVE;
+	}
+}
+
+/// Appends a storage object with one record per component to a selection set, the way interactive point selection does
+void append_point_stroke(k3d::selection::set& Set, const k3d::uint_t PointCount)
+{
+	boost::scoped_ptr<k3d::geometry::point_selection::storage> storage(k3d::geometry::point_selection::create(Set));
+
+	const k3d::uint_t begin = random(PointCount);
+	const k3d::uint_t count = 1 + random(20);
+	const k3d::double_t weight = random_weight();
+	for(k3d::uint_t point = begin; point != begin + count; ++point)
+		k3d::geometry::point_selection::append(*storage, point, point + 1, weight);
+
+	// Include some ranges that are out-of-bounds, empty, or cover "everything" ...
+	switch(random(8))
+	{
+		case 0:
+			k3d::geometry::point_selection::append(*storage, PointCount - 2, PointCount + 10, random_weight());
+			break;
+		case 1:
+			k3d::geometry::point_selection::append(*storage, begin, begin, random_weight());
+			break;
+		case 2:
+			k3d::geometry::point_selection::append(*storage, random_weight());
+			break;
+	}
+}
+
+/// Appends a storage object with one component per primitive, the way interactive component selection does
+void append_primitive_stroke(k3d::selection::set& Set, const k3d::uint_t PrimitiveCount, const k3d::uint_t ComponentCount)
+{
+	boost::scoped_ptr<k3d::geometry::primitive_selection::storage> storage(k3d::geometry::primitive_selection::create(Set));
+
+	const k3d::uint_t stroke_length = 1 + random(3);
+	for(k3d::uint_t i = 0; i != stroke_length; ++i)
+	{
+		const k3d::selection::type type = random_type();
+		const k3d::double_t weight = random_weight();
+
+		switch(random(6))
+		{
+			// Everything ...
+			case 0:
+			{
+				k3d::geometry::primitive_selection::append(*storage, type, weight);
+				break;
+			}
+			// A range of components in a range of primitives ...
+			case 1:
+			{
+				const k3d::uint_t primitive_begin = random(PrimitiveCount + 1);
+				const k3d::uint_t primitive_end = primitive_begin + random(3);
+				const k3d::uint_t begin = random(ComponentCount);
+				k3d::geometry::primitive_selection::append(*storage, primitive_begin, primitive_end, type, begin, begin + random(ComponentCount), weight);
+				break;
+			}
+			// Individual components in one primitive ...
+			default:
+			{
+				const k3d::uint_t primitive = random(PrimitiveCount);
+				const k3d::uint_t begin = random(ComponentCount);
+				const k3d::uint_t count = 1 + random(10);
+				for(k3d::uint_t component = begin; component != begin + count; ++component)
+					k3d::geometry::primitive_selection::append(*storage, primitive, primitive + 1, type, component, component + 1, weight);
+				break;
+			}
+		}
+	}
+}
+
+/// Replays a selection set one record at-a-time, the way merge() did before selections were compacted
+void replay(const k3d::selection::set& Set, k3d::mesh& Mesh)
+{
+	for(k3d::selection::set::const_iterator s = Set.begin(); s != Set.end(); ++s)
+	{
+		boost::scoped_ptr<k3d::geometry::point_selection::const_storage> point_storage(k3d::geometry::point_selection::validate(**s));
+		if(point_storage)
+		{
+			k3d::mesh::selection_t& points = Mesh.point_selection.writable();
+			for(k3d::uint_t record = 0; record != point_storage->index_begin.size(); ++record)
+			{
+				const k3d::uint_t begin = std::min(points.size(), point_storage->index_begin[record]);
+				const k3d::uint_t end = std::min(points.size(), point_storage->index_end[record]);
+				for(k3d::uint_t i = begin; i < end; ++i)
+					points[i] = point_storage->weight[record];
+			}
+			continue;
+		}
+
+		boost::scoped_ptr<k3d::geometry::primitive_selection::const_storage> primitive_storage(k3d::geometry::primitive_selection::validate(**s));
+		test_expression(primitive_storage);
+		for(k3d::uint_t component = 0; component != primitive_storage->primitive_begin.size(); ++component)
+		{
+			const k3d::uint_t primitive_begin = std::min(Mesh.primitives.size(), primitive_storage->primitive_begin[component]);
+			const k3d::uint_t primitive_end = std::min(Mesh.primitives.size(), primitive_storage->primitive_end[component]);
+			for(k3d::uint_t primitive = primitive_begin; primitive < primitive_end; ++primitive)
+			{
+				boost::scoped_ptr<k3d::polyhedron::primitive> polyhedron(k3d::polyhedron::validate(Mesh, Mesh.primitives[primitive]));
+				test_expression(polyhedron);
+
+				k3d::mesh::selection_t* array = 0;
+				switch(primitive_storage->primitive_selection_type[component])
+				{
+					case k3d::selection::FACE:
+						array = &polyhedron->face_selections;
+						break;
+					case k3d::selection::EDGE:
+						array = &polyhedron->edge_selections;
+						break;
+					case k3d::selection::VERTEX:
+						array = &polyhedron->vertex_selections;
+						break;
+				}
+				if(!array)
+					continue;
+
+				const k3d::uint_t range_begin = primitive_storage->primitive_first_range[component];
+				const k3d::uint_t range_end = range_begin + primitive_storage->primitive_range_count[component];
+				for(k3d::uint_t range = range_begin; range != range_end; ++range)
+				{
+					const k3d::uint_t begin = std::min(array->size(), primitive_storage->index_begin[range]);
+					const k3d::uint_t end = std::min(array->size(), primitive_storage->index_end[range]);
+					for(k3d::uint_t i = begin; i < end; ++i)
+						(*array)[i] = primitive_storage->weight[range];
+				}
+			}
+		}
+	}
+}
+
+/// Returns the total number of records in a selection set
+const k3d::uint_t record_count(const k3d::selection::set& Set)
+{
+	k3d::uint_t result = 0;
+	for(k3d::selection::set::const_iterator s = Set.begin(); s != Set.end(); ++s)
+	{
+		boost::scoped_ptr<k3d::geometry::point_selection::const_storage> point_storage(k3d::geometry::point_selection::validate(**s));
+		if(point_storage)
+			result += point_storage->index_begin.size();
+
+		boost::scoped_ptr<k3d::geometry::primitive_selection::const_storage> primitive_storage(k3d::geometry::primitive_selection::validate(**s));
+		if(primitive_storage)
+			result += primitive_storage->index_begin.size();
+	}
+	return result;
+}
+
+/// Returns true iff two meshes have identical point and primitive selections
+bool same_selections(const k3d::mesh& A, const k3d::mesh& B)
+{
+	if(*A.point_selection != *B.point_selection)
+		return false;
+
+	for(k3d::uint_t primitive = 0; primitive != A.primitives.size(); ++primitive)
+	{
+		boost::scoped_ptr<k3d::polyhedron::const_primitive> a(k3d::polyhedron::validate(A, *A.primitives[primitive]));
+		boost::scoped_ptr<k3d::polyhedron::const_primitive> b(k3d::polyhedron::validate(B, *B.primitives[primitive]));
+		if(a->face_selections != b->face_selections || a->edge_selections != b->edge_selections || a->vertex_selections != b->vertex_selections)
+			return false;
+	}
+
+	return true;
+}
+
+void test_compaction(const k3d::uint_t StrokeCount)
+{
+	k3d::mesh mesh;
+	create_grid(mesh, 4);
+	create_grid(mesh, 6);
+	create_grid(mesh, 3);
+
+	const k3d::uint_t point_count = mesh.points->size();
+	const k3d::uint_t primitive_count = mesh.primitives.size();
+
+	k3d::selection::set set;
+	for(k3d::uint_t stroke = 0; stroke != StrokeCount; ++stroke)
+	{
+		if(random(2))
+			append_point_stroke(set, point_count);
+		else
+			append_primitive_stroke(set, primitive_count, 60);
+	}
+
+	const k3d::selection::set compacted = k3d::geometry::selection::compact(set);
+	test_expression(compacted.size() <= 2);
+	test_expression(record_count(compacted) <= record_count(set));
+
+	// Compaction is idempotent ...
+	test_expression(record_count(k3d::geometry::selection::compact(compacted)) == record_count(compacted));
+
+	// Replaying the log, merging the log, and merging the compacted log all produce the same selections ...
+	k3d::mesh expected = mesh;
+	replay(set, expected);
+
+	k3d::mesh merged = mesh;
+	k3d::geometry::selection::merge(set, merged);
+	test_expression(same_selections(expected, merged));
+
+	k3d::mesh compacted_merged = mesh;
+	k3d::geometry::selection::merge(compacted, compacted_merged);
+	test_expression(same_selections(expected, compacted_merged));
+}
+
+int main(int argc, char* argv[])
+{
+	try
+	{
+		// Empty selections stay empty ...
+		test_expression(k3d::geometry::selection::compact(k3d::selection::set()).empty());
+
+		// Records that are completely overridden are dropped, and adjacent records are combined ...
+		k3d::selection::set points;
+		boost::scoped_ptr<k3d::geometry::point_selection::storage> first(k3d::geometry::point_selection::create(points));
+		k3d::geometry::point_selection::append(*first, 5, 10, 1.0);
+		boost::scoped_ptr<k3d::geometry::point_selection::storage> second(k3d::geometry::point_selection::create(points));
+		k3d::geometry::point_selection::append(*second, 0.0);
+		for(k3d::uint_t i = 0; i != 10; ++i)
+			k3d::geometry::point_selection::append(*second, i, i + 1, 1.0);
+
+		const k3d::selection::set compacted_points = k3d::geometry::selection::compact(points);
+		test_expression(compacted_points.size() == 1);
+		boost::scoped_ptr<k3d::geometry::point_selection::const_storage> compacted_storage(k3d::geometry::point_selection::validate(*compacted_points.front()));
+		test_expression(compacted_storage);
+		test_expression(compacted_storage->index_begin.size() == 2);
+		test_expression(compacted_storage->index_begin[0] == 0 && compacted_storage->index_end[0] == 10 && compacted_storage->weight[0] == 1.0);
+		test_expression(compacted_storage->index_begin[1] == 10 && compacted_storage->index_end[1] == k3d::uint_t(-1) && compacted_storage->weight[1] == 0.0);
+
+		// Randomized selection logs ...
+		for(k3d::uint_t i = 0; i != 50; ++i)
+			test_compaction(1 + random(200));
+	}
+	catch(std::exception& e)
+	{
+		std::cerr << "uncaught exception: " << e.what() << std::endl;
+		return 1;
+	}
+	catch(...)
+	{
+		std::cerr << "unknown exception" << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
+
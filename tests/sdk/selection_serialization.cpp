@@ -57,6 +57,19 @@ int main(int argc, char* argv[])
 		end.push_back(5);
 		value.push_back(1);
 
+		// Values that are only loaded exactly by a correctly-rounded parser ...
+		begin.push_back(5);
+		end.push_back(6);
+		value.push_back(-0.97570192310923609);
+
+		begin.push_back(6);
+		end.push_back(7);
+		value.push_back(0.30000000000000004);
+
+		begin.push_back(7);
+		end.push_back(8);
+		value.push_back(2.2250738585072014e-308);
+
 		k3d::selection::storage& components = a.create("components");
 
 		const k3d::filesystem::path root_path;
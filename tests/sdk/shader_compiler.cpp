@@ -0,0 +1,151 @@
+#include <k3dsdk/fstream.h>
+#include <k3dsdk/path.h>
+#include <k3dsdk/shader_cache_detail.h>
+#include <k3dsdk/shader_compiler_ri.h>
+#include <k3dsdk/share_detail.h>
+#include <k3dsdk/system.h>
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+#define test_expression(expression) \
+	if(!(expression)) \
+	{ \
+		std::ostringstream buffer; \
+		buffer << #expression << " failed at " << __FILE__ << ": " << __LINE__; \
+		throw std::runtime_error(buffer.str()); \
+	} \
+
+static void write_file(const k3d::filesystem::path& File, const std::string& Contents)
+{
+	k3d::filesystem::create_directories(File.branch_path());
+
+	k3d::filesystem::ofstream stream(File);
+	stream << Contents;
+}
+
+static const std::string read_file(const k3d::filesystem::path& File)
+{
+	k3d::filesystem::ifstream stream(File);
+	std::ostringstream buffer;
+	buffer << stream.rdbuf();
+	return buffer.str();
+}
+
+/// Returns the number of times the stub compiler has been run
+static int compile_count(const k3d::filesystem::path& Log)
+{
+	const std::string log = read_file(Log);
+	return std::count(log.begin(), log.end(), '\n');
+}
+
+int main(int argc, char* argv[])
+{
+	try
+	{
+		// Setup a scratch directory containing shaders, includes, and a stub shader compiler ...
+		const k3d::filesystem::path root = k3d::system::generate_temp_file();
+		k3d::filesystem::remove(root);
+		k3d::filesystem::create_directories(root);
+
+		k3d::set_share_path(root / k3d::filesystem::generic_path("share"));
+		k3d::set_shader_cache_path(root / k3d::filesystem::generic_path("cache"));
+
+		const k3d::filesystem::path global_include = root / k3d::filesystem::generic_path("share/shaders/global.h");
+		const k3d::filesystem::path local_include = root / k3d::filesystem::generic_path("a/local.h");
+		const k3d::filesystem::path shader_a = root / k3d::filesystem::generic_path("a/plastic.sl");
+		const k3d::filesystem::path shader_b = root / k3d::filesystem::generic_path("b/plastic.sl");
+		const k3d::filesystem::path shader_c = root / k3d::filesystem::generic_path("c/matte.sl");
+		const k3d::filesystem::path shader_d = root / k3d::filesystem::generic_path("c/metal.sl");
+		const k3d::filesystem::path compiler = root / k3d::filesystem::generic_path("compiler.sh");
+		const k3d::filesystem::path log = root / k3d::filesystem::generic_path("compiler.log");
+
+		write_file(global_include, "#define GLOBAL 1\n");
+		write_file(local_include, "#include <global.h>\n#define LOCAL 1\n");
+		write_file(shader_a, "#include \"local.h\"\nsurface plastic() { Ci = 1; }\n");
+		write_file(shader_b, "surface plastic() { Ci = 0; }\n");
+		write_file(shader_c, "  #  include \"../a/local.h\"\nsurface matte() { Ci = 0.5; }\n");
+		write_file(shader_d, "surface metal() { Ci = 0.25; }\n");
+		write_file(compiler, "#!/bin/sh\necho \"$2\" >> \"$1\"\ncp \"$2\" \"$3\"\n");
+		write_file(log, "");
+
+		const k3d::ri::shader_compiler shader_compiler("/bin/sh \"" + compiler.native_filesystem_string() + "\" \"" + log.native_filesystem_string() + "\" \"$SOURCE\" \"$BINARY\"", ".slx");
+		const k3d::filesystem::path binary = shader_compiler.binary_path(shader_a);
+
+		// Dependency scanning should find direct and indirect includes ...
+		std::vector<k3d::filesystem::path> include_paths(1, root / k3d::filesystem::generic_path("share/shaders"));
+		test_expression(k3d::ri::shader_dependencies(shader_a, include_paths).size() == 2);
+		test_expression(k3d::ri::shader_dependencies(shader_b, include_paths).size() == 0);
+		test_expression(k3d::ri::shader_dependencies(shader_c, include_paths).size() == 2);
+
+		// The first compilation runs the compiler ...
+		test_expression(shader_compiler.compile(shader_a));
+		test_expression(compile_count(log) == 1);
+		test_expression(read_file(binary) == read_file(shader_a));
+
+		// Unchanged shaders come from the cache ...
+		test_expression(shader_compiler.compile(shader_a));
+		test_expression(compile_count(log) == 1);
+
+		// A different shader with the same name gets its own binary, and both binaries survive ...
+		test_expression(shader_compiler.key(shader_a) != shader_compiler.key(shader_b));
+		test_expression(shader_compiler.binary_path(shader_a) != shader_compiler.binary_path(shader_b));
+		test_expression(k3d::ri::shader_cache_name(shader_a, "plastic") != k3d::ri::shader_cache_name(shader_b, "plastic"));
+		test_expression(k3d::ri::shader_cache_name(k3d::filesystem::path(), "plastic") == "plastic");
+		test_expression(shader_compiler.compile(shader_b));
+		test_expression(compile_count(log) == 2);
+		test_expression(read_file(binary) == read_file(shader_a));
+		test_expression(read_file(shader_compiler.binary_path(shader_b)) == read_file(shader_b));
+
+		// ... and switching back doesn't require recompilation ...
+		test_expression(shader_compiler.compile(shader_a));
+		test_expression(compile_count(log) == 2);
+		test_expression(read_file(binary) == read_file(shader_a));
+		test_expression(read_file(shader_compiler.binary_path(shader_b)) == read_file(shader_b));
+
+		// Changing a direct or indirect include forces recompilation ...
+		write_file(local_include, "#include <global.h>\n#define LOCAL 2\n");
+		test_expression(shader_compiler.compile(shader_a));
+		test_expression(compile_count(log) == 3);
+
+		write_file(global_include, "#define GLOBAL 2\n");
+		test_expression(shader_compiler.compile(shader_a));
+		test_expression(compile_count(log) == 4);
+
+		// Changing the compiler command changes the key ...
+		const k3d::ri::shader_compiler other_compiler("/bin/sh \"" + compiler.native_filesystem_string() + "\" \"" + log.native_filesystem_string() + "\" \"$SOURCE\" \"$BINARY\" -O2", ".slx");
+		test_expression(shader_compiler.key(shader_a) != other_compiler.key(shader_a));
+
+		// Batch compilation only compiles shaders that aren't already cached ...
+		k3d::ri::shader_collection::shaders_t shaders;
+		shaders.insert(shader_a);
+		shaders.insert(shader_c);
+		shaders.insert(shader_d);
+		test_expression(shader_compiler.compile(shaders));
+		test_expression(compile_count(log) == 6);
+		test_expression(read_file(shader_compiler.binary_path(shader_c)) == read_file(shader_c));
+		test_expression(read_file(shader_compiler.binary_path(shader_d)) == read_file(shader_d));
+
+		test_expression(shader_compiler.compile(shaders));
+		test_expression(compile_count(log) == 6);
+
+		// Compiler failures are reported ...
+		const k3d::ri::shader_compiler broken_compiler("\"" + (root / k3d::filesystem::generic_path("missing-compiler")).native_filesystem_string() + "\" \"$SOURCE\"", ".sdr");
+		test_expression(!broken_compiler.compile(shader_d));
+	}
+	catch(std::exception& e)
+	{
+		std::cerr << "uncaught exception: " << e.what() << std::endl;
+		return 1;
+	}
+	catch(...)
+	{
+		std::cerr << "unknown exception" << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
+
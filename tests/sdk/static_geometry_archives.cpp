@@ -0,0 +1,208 @@
+#include <k3dsdk/fstream.h>
+#include <k3dsdk/inetwork_render_frame.h>
+#include <k3dsdk/inetwork_render_job.h>
+#include <k3dsdk/iprojection.h>
+#include <k3dsdk/irenderable_ri.h>
+#include <k3dsdk/path.h>
+#include <k3dsdk/render_state_ri.h>
+#include <k3dsdk/shader_collection_ri.h>
+#include <k3dsdk/static_geometry_archives_ri.h>
+#include <k3dsdk/stream_ri.h>
+#include <k3dsdk/string_cast.h>
+#include <k3dsdk/system.h>
+#include <k3dsdk/uuid.h>
+
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+/// Stores render job files in a scratch directory, so we can check where shared archives end up
+class test_frame :
+	public k3d::inetwork_render_frame
+{
+public:
+	test_frame(const k3d::filesystem::path& Path) :
+		path(Path)
+	{
+		k3d::filesystem::create_directory(path);
+	}
+
+	const k3d::filesystem::path add_file(const k3d::string_t& Name)
+	{
+		return path / k3d::filesystem::generic_path(Name);
+	}
+
+	void add_exec_command(const k3d::string_t&, const environment&, const arguments&)
+	{
+	}
+
+	void add_copy_command(const k3d::filesystem::path&, const k3d::filesystem::path&)
+	{
+	}
+
+	void add_view_command(const k3d::filesystem::path&)
+	{
+	}
+
+	const k3d::filesystem::path path;
+};
+
+class test_job :
+	public k3d::inetwork_render_job
+{
+public:
+	test_job(const k3d::filesystem::path& Path) :
+		path(Path),
+		file_count(0)
+	{
+		k3d::filesystem::create_directory(path);
+	}
+
+	k3d::inetwork_render_frame& create_frame(const k3d::string_t&)
+	{
+		throw std::runtime_error("unexpected create_frame");
+	}
+
+	const k3d::filesystem::path add_file(const k3d::string_t& Name)
+	{
+		return path / k3d::filesystem::generic_path(Name + "-" + k3d::string_cast(++file_count));
+	}
+
+	const k3d::filesystem::path path;
+	unsigned long file_count;
+};
+
+class test_projection :
+	public k3d::iprojection
+{
+};
+
+/// Renders the same geometry every frame, using an object handle
+class static_renderable :
+	public k3d::ri::irenderable
+{
+public:
+	void renderman_render(const k3d::ri::render_state& State)
+	{
+		const k3d::ri::object_handle handle = State.stream.RiObjectBegin();
+		State.stream.RiSphereV(1, -1, 1, 360);
+		State.stream.RiObjectEnd();
+		State.stream.RiObjectInstance(handle);
+	}
+
+	void renderman_render_complete(const k3d::ri::render_state&)
+	{
+	}
+};
+
+/// Renders geometry that changes every frame
+class moving_renderable :
+	public k3d::ri::irenderable
+{
+public:
+	moving_renderable() :
+		frame(0)
+	{
+	}
+
+	void renderman_render(const k3d::ri::render_state& State)
+	{
+		State.stream.RiTranslate(frame, 0, 0);
+		State.stream.RiSphereV(1, -1, 1, 360);
+	}
+
+	void renderman_render_complete(const k3d::ri::render_state&)
+	{
+	}
+
+	int frame;
+};
+
+void require(const bool Condition, const std::string& Message)
+{
+	if(!Condition)
+		throw std::runtime_error(Message);
+}
+
+const std::string read_file(const k3d::filesystem::path& Path)
+{
+	k3d::filesystem::ifstream stream(Path);
+	return std::string(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+}
+
+int main(int argc, char* argv[])
+{
+	try
+	{
+		const k3d::filesystem::path root = k3d::system::get_temp_directory() / k3d::filesystem::generic_path("k3d-static-geometry-" + k3d::string_cast(k3d::uuid::random()));
+		test_job job(root);
+
+		k3d::ri::shader_collection shaders;
+		test_projection projection;
+		static_renderable still;
+		moving_renderable moving;
+
+		k3d::ri::static_geometry_archives archives(job, false);
+
+		k3d::filesystem::path first_archive;
+		for(int frame = 0; frame != 3; ++frame)
+		{
+			test_frame render_frame(root / k3d::filesystem::generic_path("frame-" + k3d::string_cast(frame)));
+			moving.frame = frame;
+
+			std::ostringstream rib;
+			k3d::ri::stream stream(rib);
+
+			// Allocate a light handle and an object handle before the archived geometry, so that it doesn't start at zero ...
+			require(stream.RiLightSourceV(k3d::filesystem::path(), "pointlight") == 1, "unexpected light handle");
+			require(stream.RiObjectBegin() == 1, "unexpected object handle");
+			stream.RiObjectEnd();
+
+			const k3d::ri::render_state state(render_frame, stream, shaders, projection, k3d::ri::FINAL_FRAME, k3d::ri::sample_times_t(1, 0.0), 0, k3d::identity3());
+			archives.render(still, state, stream, rib);
+			archives.render(moving, state, stream, rib);
+
+			// Handles allocated after the archived geometry must not collide with the handles it used, in every frame ...
+			require(stream.RiObjectBegin() == 3, "object handles inconsistent after frame " + k3d::string_cast(frame));
+			stream.RiObjectEnd();
+
+			const std::string text = rib.str();
+			require(text.find("Translate " + k3d::string_cast(frame)) != std::string::npos, "changing geometry must be written inline");
+
+			if(frame == 0)
+			{
+				require(text.find("ObjectBegin 2") != std::string::npos, "first frame must write static geometry inline");
+				require(text.find("ReadArchive") == std::string::npos, "first frame must not reference an archive");
+				continue;
+			}
+
+			const std::string::size_type read_archive = text.find("ReadArchive");
+			require(read_archive != std::string::npos, "static geometry must be archived after the first frame");
+			require(text.find("ObjectBegin 2") == std::string::npos, "archived geometry must not also be written inline");
+
+			const std::string::size_type begin = text.find('"', read_archive) + 1;
+			const k3d::filesystem::path archive = k3d::filesystem::native_path(k3d::ustring::from_utf8(text.substr(begin, text.find('"', begin) - begin)));
+			if(frame == 1)
+				first_archive = archive;
+
+			// The archive is shared by every frame, so it must live in the job directory and be reused ...
+			require(archive == first_archive, "archive must be reused by later frames");
+			require(archive.branch_path() == root, "archive must be stored with the job, not with a single frame");
+			require(read_file(archive).find("ObjectBegin 2") != std::string::npos, "archive must contain the static geometry");
+		}
+	}
+	catch(std::exception& e)
+	{
+		std::cerr << "uncaught exception: " << e.what() << std::endl;
+		return 1;
+	}
+	catch(...)
+	{
+		std::cerr << "unknown exception" << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
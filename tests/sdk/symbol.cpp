@@ -0,0 +1,189 @@
+#include <k3dsdk/high_res_timer.h>
+#include <k3dsdk/mesh.h>
+#include <k3dsdk/polyhedron.h>
+#include <k3dsdk/symbol.h>
+#include <k3dsdk/table.h>
+#include <k3dsdk/table_copier.h>
+
+#include <boost/lexical_cast.hpp>
+#include <boost/scoped_ptr.hpp>
+
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+
+#define test_expression(expression) \
+	if(!(expression)) \
+	{ \
+		std::ostringstream buffer; \
+		buffer << #expression << " failed at " << __FILE__ << ": " << __LINE__; \
+		throw std::runtime_error(buffer.str()); \
+	} \
+
+/// Creates a Size x Size grid of quads
+void create_grid(k3d::mesh& Mesh, const k3d::uint_t Size)
+{
+	k3d::mesh::points_t vertices;
+	for(k3d::uint_t j = 0; j <= Size; ++j)
+	{
+		for(k3d::uint_t i = 0; i <= Size; ++i)
+			vertices.push_back(k3d::point3(i, j, 0));
+	}
+
+	k3d::mesh::counts_t vertex_counts(Size * Size, 4);
+	k3d::mesh::indices_t vertex_indices;
+	for(k3d::uint_t j = 0; j != Size; ++j)
+	{
+		for(k3d::uint_t i = 0; i != Size; ++i)
+		{
+			vertex_indices.push_back(j * (Size + 1) + i);
+			vertex_indices.push_back((j + 1) * (Size + 1) + i);
+			vertex_indices.push_back((j + 1) * (Size + 1) + i + 1);
+			vertex_indices.push_back(j * (Size + 1) + i + 1);
+		}
+	}
+
+	delete k3d::polyhedron::create(Mesh, vertices, vertex_counts, vertex_indices, 0);
+}
+
+/// Times array lookups, primitive validation, and table copying
+void benchmark(const k3d::uint_t Iterations)
+{
+	const char* const names[] = { "face_first_loops", "face_loop_counts", "face_materials", "face_selections", "face_shells", "face_normals", "face_colors" };
+	const k3d::uint_t name_count = sizeof(names) / sizeof(names[0]);
+
+	// Lookups in a string-keyed map (the old table representation) vs. lookups by string and by symbol in a table ...
+	std::map<k3d::string_t, k3d::pipeline_data<k3d::array> > string_table;
+	k3d::table table;
+	std::vector<k3d::symbol> symbols;
+	for(k3d::uint_t i = 0; i != name_count; ++i)
+	{
+		string_table[names[i]].create(new k3d::mesh::indices_t());
+		table.create<k3d::mesh::indices_t>(names[i]);
+		symbols.push_back(k3d::symbol(names[i]));
+	}
+
+	k3d::uint_t found = 0;
+	k3d::timer timer;
+	for(k3d::uint_t i = 0; i != Iterations; ++i)
+		found += string_table.find(names[i % name_count]) != string_table.end();
+	std::cout << Iterations << " string-keyed map lookups: " << timer.elapsed() << "s" << std::endl;
+
+	timer.restart();
+	for(k3d::uint_t i = 0; i != Iterations; ++i)
+		found += table.lookup(names[i % name_count]) ? 1 : 0;
+	std::cout << Iterations << " table lookups by string: " << timer.elapsed() << "s" << std::endl;
+
+	timer.restart();
+	for(k3d::uint_t i = 0; i != Iterations; ++i)
+		found += table.lookup(symbols[i % name_count]) ? 1 : 0;
+	std::cout << Iterations << " table lookups by symbol: " << timer.elapsed() << "s" << std::endl;
+
+	test_expression(found == 3 * Iterations);
+
+	// Primitive validation (sharing the mesh freezes its arrays, so validation can be cached) ...
+	k3d::mesh mesh;
+	create_grid(mesh, 2);
+	const k3d::mesh shared_mesh(mesh);
+
+	timer.restart();
+	for(k3d::uint_t i = 0; i != Iterations / 10; ++i)
+		delete k3d::polyhedron::validate(mesh, *mesh.primitives.front());
+	std::cout << Iterations / 10 << " cached polyhedron validations: " << timer.elapsed() << "s" << std::endl;
+
+	timer.restart();
+	for(k3d::uint_t i = 0; i != Iterations / 10; ++i)
+		delete k3d::polyhedron::validate(mesh, mesh.primitives.front());
+	std::cout << Iterations / 10 << " uncached polyhedron validations: " << timer.elapsed() << "s" << std::endl;
+
+	// Table copying ...
+	boost::scoped_ptr<k3d::polyhedron::const_primitive> polyhedron(k3d::polyhedron::validate(mesh, *mesh.primitives.front()));
+	test_expression(polyhedron);
+	k3d::table face_table = polyhedron->face_attributes;
+	for(k3d::uint_t i = 0; i != name_count; ++i)
+		face_table.create<k3d::mesh::indices_t>(names[i]).resize(1);
+
+	timer.restart();
+	for(k3d::uint_t i = 0; i != Iterations / 10; ++i)
+	{
+		k3d::table target = face_table.clone_types();
+		k3d::table_copier copier(face_table, target);
+		copier.push_back(0);
+	}
+	std::cout << Iterations / 10 << " table copier constructions: " << timer.elapsed() << "s" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+	try
+	{
+		// Symbols with the same contents are identical ...
+		const k3d::symbol a("face_selections");
+		const k3d::symbol b(k3d::string_t("face_selections"));
+		const k3d::symbol c("face_shells");
+		test_expression(a == b);
+		test_expression(&a.str() == &b.str());
+		test_expression(a != c);
+		test_expression(k3d::symbol().empty());
+		test_expression(k3d::symbol("") == k3d::symbol());
+
+		// ... compare with strings ...
+		test_expression(a == "face_selections");
+		test_expression(a == k3d::string_t("face_selections"));
+		test_expression("face_shells" == c);
+		test_expression(a != "face_shells");
+
+		// ... and are ordered like strings ...
+		test_expression(a < c);
+		test_expression(!(c < a));
+		test_expression(!(a < b));
+		test_expression(k3d::symbol("edge") < k3d::symbol("edge_selections"));
+		test_expression(k3d::symbol("vertex_points") < k3d::symbol("vertex_selections"));
+		test_expression(k3d::symbol("vertex_selections") < k3d::symbol("vertex_selections_2"));
+		test_expression(!(k3d::symbol("vertex_selections_2") < k3d::symbol("vertex_selections")));
+		test_expression(k3d::symbol("") < k3d::symbol("a"));
+		test_expression(k3d::symbol("z") < k3d::symbol("\xff"));
+
+		// Creating an existing symbol doesn't create new storage ...
+		const k3d::uint_t count = k3d::symbol::count();
+		const k3d::symbol d("face_selections");
+		test_expression(k3d::symbol::count() == count);
+
+		// Tables iterate in name order, and can be searched by string or symbol ...
+		k3d::table table;
+		table.create<k3d::mesh::indices_t>("vertex_points");
+		table.create<k3d::mesh::indices_t>("clockwise_edges");
+		table.create<k3d::mesh::selection_t>("edge_selections");
+
+		k3d::table::const_iterator array = table.begin();
+		test_expression(array->first == "clockwise_edges");
+		++array;
+		test_expression(array->first == "edge_selections");
+		++array;
+		test_expression(array->first == "vertex_points");
+
+		test_expression(table.lookup<k3d::mesh::indices_t>("clockwise_edges"));
+		test_expression(table.lookup<k3d::mesh::indices_t>(k3d::string_t("clockwise_edges")));
+		test_expression(table.lookup<k3d::mesh::indices_t>(k3d::symbol("clockwise_edges")));
+		test_expression(!table.lookup<k3d::mesh::indices_t>("edge_selections"));
+		test_expression(!table.lookup("face_selections"));
+
+		// Optionally time lookups, validation, and copying ...
+		if(argc > 1)
+			benchmark(boost::lexical_cast<k3d::uint_t>(argv[1]));
+	}
+	catch(std::exception& e)
+	{
+		std::cerr << "uncaught exception: " << e.what() << std::endl;
+		return 1;
+	}
+	catch(...)
+	{
+		std::cerr << "unknown exception" << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
+
@@ -0,0 +1,115 @@
+// K-3D
+// Copyright (c) 1995-2010, Timothy M. Shead
+//
+// Contact: tshead@k-3d.com
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public
+// License as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public
+// License along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+#include <k3dsdk/xml.h>
+
+using namespace k3d::xml;
+
+#include <iostream>
+#include <stdexcept>
+#include <sstream>
+#include <vector>
+
+#define test_expression(expression) \
+{ \
+  if(!(expression)) \
+    { \
+    std::ostringstream buffer; \
+    buffer << "Expression failed at line " << __LINE__ << ": " << #expression; \
+    throw std::runtime_error(buffer.str()); \
+    } \
+}
+
+/// Records <node> elements as they're parsed, skipping the contents of nodes named "skip" and discarding the rest once they're parsed
+class node_handler :
+	public element_handler
+{
+public:
+	bool start_element(element& Element, const unsigned long Depth)
+	{
+		if(Element.name == "node")
+			depths.push_back(Depth);
+
+		return !(Element.name == "node" && attribute_text(Element, "name") == "skip");
+	}
+
+	bool end_element(element& Element, const unsigned long Depth)
+	{
+		if(Element.name != "node")
+			return false;
+
+		nodes.push_back(Element);
+		return true;
+	}
+
+	std::vector<unsigned long> depths;
+	std::vector<element> nodes;
+};
+
+int main(int argc, char* argv[])
+{
+	try
+	{
+		std::istringstream buffer(
+			"<k3dml version=\"1\">"
+			"<nodes>"
+			"<node name=\"a\"><properties><property name=\"x\">1 2 3</property></properties></node>"
+			"<node name=\"skip\"><properties><property name=\"y\">4 5 6</property><node name=\"nested\"/></properties>text</node>"
+			"<node name=\"b\"> b text </node>"
+			"</nodes>"
+			"<pipeline/>"
+			"</k3dml>");
+
+		element document("k3dml");
+		hide_progress progress;
+		node_handler handler;
+		parse(document, buffer, "", progress, handler);
+
+		// Elements the handler keeps are still added to the tree ...
+		test_expression(document.name == "k3dml");
+		test_expression(attribute_text(document, "version") == "1");
+		test_expression(document.children.size() == 2);
+		test_expression(document.children[0].name == "nodes");
+		test_expression(document.children[1].name == "pipeline");
+
+		// ... elements it discards aren't ...
+		test_expression(document.children[0].children.empty());
+
+		// ... and elements it skips are reported without their contents ...
+		test_expression(handler.depths.size() == 3);
+		test_expression(handler.depths[0] == 2 && handler.depths[1] == 2 && handler.depths[2] == 2);
+		test_expression(handler.nodes.size() == 3);
+		test_expression(attribute_text(handler.nodes[0], "name") == "a");
+		test_expression(element_text(handler.nodes[0], "properties").empty());
+		test_expression(find_element(handler.nodes[0], "properties") && find_element(handler.nodes[0], "properties")->children.size() == 1);
+		test_expression(element_text(*find_element(handler.nodes[0], "properties"), "property") == "1 2 3");
+		test_expression(attribute_text(handler.nodes[1], "name") == "skip");
+		test_expression(handler.nodes[1].children.empty() && handler.nodes[1].text.empty());
+		test_expression(attribute_text(handler.nodes[2], "name") == "b");
+		test_expression(handler.nodes[2].text == "b text");
+	}
+	catch(std::exception& e)
+	{
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
+
@@ -175,6 +175,59 @@ def require_similar_bitmap(document, image_property, image_name, threshold):
 	if difference_measurement > threshold:
 		raise Exception("pixel difference exceeds threshold")
 
+def bitmap_perceptual_difference_batch(directory_a, directory_b, threshold):
+	# Compares every PNG image in directory_a with the image of the same name in directory_b, reusing one pipeline for
+	# every pair.  Returns a dictionary that maps file names to (pixel difference, pixel count, passed) tuples.
+	document = k3d.new_document()
+
+	reader_a = k3d.plugin.create("PNGBitmapReader", document)
+	reader_b = k3d.plugin.create("PNGBitmapReader", document)
+
+	difference = k3d.plugin.create("BitmapPerceptualDifference", document)
+	difference.field_of_view = 10.0
+	difference.luminance = 100
+	k3d.property.connect(document, reader_a.get_property("output_bitmap"), difference.get_property("input_a"))
+	k3d.property.connect(document, reader_b.get_property("output_bitmap"), difference.get_property("input_b"))
+
+	results = {}
+	for name in sorted(os.listdir(directory_a)):
+		if not name.lower().endswith(".png"):
+			continue
+
+		if not os.path.exists(os.path.join(directory_b, name)):
+			results[name] = (0, 0, False)
+			continue
+
+		reader_a.file = k3d.filesystem.generic_path(os.path.join(directory_a, name))
+		reader_b.file = k3d.filesystem.generic_path(os.path.join(directory_b, name))
+
+		pixel_count = reader_a.output_bitmap.width() * reader_a.output_bitmap.height()
+
+		# Only pass / fail matters, so let the comparison stop as soon as the threshold is exceeded ...
+		difference.difference_limit = int(threshold * pixel_count) + 1
+
+		pixel_difference = difference.difference
+		passed = pixel_count != 0 and float(pixel_difference) / float(pixel_count) <= threshold
+		results[name] = (pixel_difference, pixel_count, passed)
+
+	k3d.close_document(document)
+
+	return results
+
+def require_similar_bitmaps(directory_a, directory_b, threshold):
+	results = bitmap_perceptual_difference_batch(directory_a, directory_b, threshold)
+
+	failed = [name for name in sorted(results.keys()) if not results[name][2]]
+
+	dart_measurement("image_count", len(results))
+	dart_measurement("failed_count", len(failed))
+	dart_measurement("threshold", threshold)
+	if len(failed):
+		dart_measurement("failed_images", " ".join(failed))
+
+	if len(failed):
+		raise Exception(str(len(failed)) + " of " + str(len(results)) + " images differ from reference")
+
 #####################################################################################33
 # Mesh-related testing
 
@@ -342,6 +395,61 @@ def require_similar_mesh(document, input_mesh, base_mesh_name, ulps_threshold, c
 
 		raise Exception("output mesh differs from reference")
 
+def require_mesh_geometry_update(source_name, modifier_name, modifier_properties = {}, ulps_threshold = 0):
+	document = k3d.new_document()
+	source = k3d.plugin.create(source_name, document)
+
+	def create_pipeline():
+		deformation = k3d.plugin.create("ScalePoints", document)
+		deformation.mesh_selection = k3d.geometry.selection.create(1)
+		modifier = k3d.plugin.create(modifier_name, document)
+		modifier.mesh_selection = k3d.geometry.selection.create(1)
+		for (name, value) in modifier_properties.items():
+			setattr(modifier, name, value)
+		k3d.property.connect(document, source.get_property("output_mesh"), deformation.get_property("input_mesh"))
+		k3d.property.connect(document, deformation.get_property("output_mesh"), modifier.get_property("input_mesh"))
+		return (deformation, modifier)
+
+	def deform(deformation):
+		deformation.x = 2.0
+		deformation.y = 0.5
+		deformation.z = 3.0
+
+	# Evaluate the modifier, then move its input points, which should only update the modifier output ...
+	(deformation, modifier) = create_pipeline()
+	modifier.output_mesh
+
+	profiler = k3d.plugin.create("PipelineProfiler", document)
+	deform(deformation)
+	updated_mesh = modifier.output_mesh
+
+	timings = {}
+	for (node, timing) in profiler.records.items():
+		if node.name == modifier.name:
+			timings = timing
+	if "Create Mesh" in timings or "Update Mesh" not in timings:
+		raise Exception("moving input points should update the output mesh without recreating it")
+
+	# Compare the result with a full recompute ...
+	(reference_deformation, reference_modifier) = create_pipeline()
+	deform(reference_deformation)
+
+	result = k3d.difference.accumulator()
+	k3d.difference.test(updated_mesh, reference_modifier.output_mesh, result)
+
+	dart_measurement("exact_count", result.exact_count())
+	dart_measurement("exact_min", result.exact_min())
+	dart_measurement("ulps_max", result.ulps_max())
+	dart_measurement("ulps_threshold", ulps_threshold)
+
+	if (result.exact_count() and result.exact_min() == 0) or result.ulps_max() > ulps_threshold:
+		print """<DartMeasurement name="geometry_difference" type="text/html"><![CDATA[\n"""
+		print difflib.HtmlDiff().make_file(str(updated_mesh).splitlines(1), str(reference_modifier.output_mesh).splitlines(1), "Updated Geometry", "Recomputed Geometry")
+		print """]]></DartMeasurement>\n"""
+		sys.stdout.flush()
+
+		raise Exception("updated output mesh differs from a full recompute")
+
 def points_to_string(points):
 	result = ''
 	for point in points: